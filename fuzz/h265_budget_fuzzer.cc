@@ -0,0 +1,99 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+// Resource bound fuzzer (hand-written, not generated by converter.py).
+//
+// Parses the input with a tight per-NAL budget, and aborts if parsing any
+// input takes longer than kMaxTime, or if the heap usage peaks above
+// kMaxPeakBytesPerInputByte bytes per input byte (plus kMaxPeakBytesBase).
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include "h265_bitstream_parser.h"
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "rtc_common.h"
+
+namespace {
+
+const std::chrono::milliseconds kMaxTime(1000);
+const size_t kMaxPeakBytesBase = 4 * 1024 * 1024;
+const size_t kMaxPeakBytesPerInputByte = 64;
+
+// heap accounting (every block carries its size in a header)
+const size_t kHeaderSize = alignof(std::max_align_t);
+size_t current_bytes = 0;
+size_t peak_bytes = 0;
+
+void* Allocate(size_t size) {
+  auto* block = static_cast<uint8_t*>(malloc(kHeaderSize + size));
+  if (block == nullptr) {
+    throw std::bad_alloc();
+  }
+  *reinterpret_cast<size_t*>(block) = size;
+  current_bytes += size;
+  if (current_bytes > peak_bytes) {
+    peak_bytes = current_bytes;
+  }
+  return block + kHeaderSize;
+}
+
+void Deallocate(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  auto* block = static_cast<uint8_t*>(ptr) - kHeaderSize;
+  current_bytes -= *reinterpret_cast<size_t*>(block);
+  free(block);
+}
+
+}  // namespace
+
+void* operator new(size_t size) { return Allocate(size); }
+void* operator new[](size_t size) { return Allocate(size); }
+void operator delete(void* ptr) noexcept { Deallocate(ptr); }
+void operator delete[](void* ptr) noexcept { Deallocate(ptr); }
+void operator delete(void* ptr, size_t) noexcept { Deallocate(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { Deallocate(ptr); }
+
+// libfuzzer infra to test the fuzz target
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  h265nal::ParsingOptions parsing_options;
+  parsing_options.add_checksum = true;
+  parsing_options.max_allocations = 256;
+  parsing_options.max_allocated_bytes = 64 * 1024;
+  parsing_options.max_syntax_elements = 16 * 1024;
+
+  size_t base_bytes = current_bytes;
+  peak_bytes = current_bytes;
+  auto start = std::chrono::steady_clock::now();
+  {
+    h265nal::H265BitstreamParserState bitstream_parser_state;
+    auto bitstream = h265nal::H265BitstreamParser::ParseBitstream(
+        data, size, &bitstream_parser_state, parsing_options);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  if (elapsed > kMaxTime) {
+    fprintf(stderr, "error: parsing took %lld ms (limit: %lld ms)\n",
+            static_cast<long long>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(elapsed)
+                    .count()),
+            static_cast<long long>(kMaxTime.count()));
+    abort();
+  }
+  size_t max_peak_bytes = kMaxPeakBytesBase + kMaxPeakBytesPerInputByte * size;
+  if (peak_bytes - base_bytes > max_peak_bytes) {
+    fprintf(stderr, "error: parsing used %zu heap bytes (limit: %zu)\n",
+            peak_bytes - base_bytes, max_peak_bytes);
+    abort();
+  }
+  return 0;
+}
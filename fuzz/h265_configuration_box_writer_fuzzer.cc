@@ -0,0 +1,29 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+// This file was auto-generated using fuzz/converter.py from
+// h265_configuration_box_writer_unittest.cc.
+// Do not edit directly.
+
+#include "h265_configuration_box_writer.h"
+#include <stdio.h>
+#include <cstdint>
+#include <vector>
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_configuration_box_parser.h"
+#include "rtc_common.h"
+
+
+// libfuzzer infra to test the fuzz target
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  {
+  std::vector<uint8_t> box;
+  h265nal::H265ConfigurationBoxWriter::Options options;
+  options.length_size_minus_one = 1;
+  h265nal::H265ConfigurationBoxWriter::WriteConfigurationBox(data, size,
+                                                    options, &box);
+  }
+  return 0;
+}
@@ -0,0 +1,52 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+// This file was auto-generated using fuzz/converter.py from
+// h265_decoder_params_unittest.cc.
+// Do not edit directly.
+
+#include "h265_decoder_params.h"
+#include <stdio.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "h265_bitstream_parser.h"
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_pps_parser.h"
+#include "h265_pred_weight_table_parser.h"
+#include "h265_scaling_list_data_parser.h"
+#include "h265_slice_parser.h"
+#include "h265_sps_parser.h"
+#include "h265_st_ref_pic_set_parser.h"
+#include "rtc_common.h"
+
+
+// libfuzzer infra to test the fuzz target
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  {
+  h265nal::H265BitstreamParserState bitstream_parser_state;
+  h265nal::ParsingOptions parsing_options;
+  auto bitstream = h265nal::H265BitstreamParser::ParseBitstream(
+      data, size, &bitstream_parser_state, parsing_options);
+  h265nal::H265DecoderParams decoder_params;
+  std::vector<h265nal::H265DecoderParams::SliceParams> slice_params_list;
+  if (bitstream != nullptr) {
+    for (const auto& nal_unit : bitstream->nal_units) {
+      if (nal_unit->nal_unit_payload == nullptr ||
+          nal_unit->nal_unit_payload->slice_segment_layer == nullptr) {
+        continue;
+      }
+      h265nal::H265DecoderParams::SliceParams slice_params;
+      if (decoder_params.GetSliceParams(
+              *nal_unit->nal_unit_payload->slice_segment_layer
+                   ->slice_segment_header,
+              bitstream_parser_state, &slice_params)) {
+        slice_params_list.push_back(slice_params);
+      }
+    }
+  }
+  }
+  return 0;
+}
@@ -0,0 +1,33 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+// This file was auto-generated using fuzz/converter.py from
+// h265_mkv_reader_unittest.cc.
+// Do not edit directly.
+
+#include "h265_mkv_reader.h"
+#include <stdio.h>
+#include <cstdint>
+#include <vector>
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+#include "rtc_common.h"
+
+
+// libfuzzer infra to test the fuzz target
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  {
+  std::vector<h265nal::H265MkvReader::Block> blocks;
+  h265nal::H265MkvReader mkv_reader({});
+  if (mkv_reader.OpenBuffer(data, size)) {
+    mkv_reader.ReadBlocks(
+        [](const h265nal::H265MkvReader::Block& block, void* opaque) {
+          using Blocks = std::vector<h265nal::H265MkvReader::Block>;
+          static_cast<Blocks*>(opaque)->push_back(block);
+        },
+        &blocks);
+  }
+  }
+  return 0;
+}
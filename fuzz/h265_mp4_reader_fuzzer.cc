@@ -0,0 +1,34 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+// This file was auto-generated using fuzz/converter.py from
+// h265_mp4_reader_unittest.cc.
+// Do not edit directly.
+
+#include "h265_mp4_reader.h"
+#include <stdio.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+#include "rtc_common.h"
+
+
+// libfuzzer infra to test the fuzz target
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  {
+  std::vector<h265nal::H265Mp4Reader::Sample> samples;
+  h265nal::H265Mp4Reader mp4_reader({});
+  if (mp4_reader.OpenBuffer(data, size)) {
+    mp4_reader.ReadSamples(
+        [](const h265nal::H265Mp4Reader::Sample& sample, void* opaque) {
+          using Samples = std::vector<h265nal::H265Mp4Reader::Sample>;
+          static_cast<Samples*>(opaque)->push_back(sample);
+        },
+        &samples);
+  }
+  }
+  return 0;
+}
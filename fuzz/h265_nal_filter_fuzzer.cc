@@ -0,0 +1,30 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+// This file was auto-generated using fuzz/converter.py from
+// h265_nal_filter_unittest.cc.
+// Do not edit directly.
+
+#include "h265_nal_filter.h"
+#include <stdio.h>
+#include <cstdint>
+#include <vector>
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+#include "rtc_common.h"
+
+
+// libfuzzer infra to test the fuzz target
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  {
+  h265nal::H265NalFilter filter;
+  filter.AddDropNalUnitTypes({h265nal::NalUnitType::FD_NUT, h265nal::NalUnitType::AUD_NUT});
+  filter.AddDropSeiPayloadTypes({1});
+  filter.AddKeepIrapOnly();
+  filter.AddInsertParameterSets();
+  std::vector<h265nal::BufferSegment> spans;
+  filter.Filter(data, size, &spans);
+  }
+  return 0;
+}
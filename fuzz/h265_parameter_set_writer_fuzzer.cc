@@ -0,0 +1,32 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+// This file was auto-generated using fuzz/converter.py from
+// h265_parameter_set_writer_unittest.cc.
+// Do not edit directly.
+
+#include "h265_parameter_set_writer.h"
+#include <stdio.h>
+#include <cstdint>
+#include <vector>
+#include "h265_common.h"
+#include "h265_pps_parser.h"
+#include "h265_scaling_list_data_parser.h"
+#include "h265_sps_parser.h"
+#include "h265_vps_parser.h"
+#include "rtc_common.h"
+
+
+// libfuzzer infra to test the fuzz target
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  {
+  auto sps = h265nal::H265SpsParser::ParseSps(data, size);
+  std::vector<uint8_t> nal_unit;
+  if (sps != nullptr) {
+    h265nal::H265ParameterSetWriter::WriteSps(*sps, h265nal::H265ParameterSetWriter::Options(),
+                                     &nal_unit);
+  }
+  }
+  return 0;
+}
@@ -0,0 +1,34 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+// This file was auto-generated using fuzz/converter.py from
+// h265_pcap_reader_unittest.cc.
+// Do not edit directly.
+
+#include "h265_pcap_reader.h"
+#include <stdio.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_rtp_parser.h"
+#include "rtc_common.h"
+
+
+// libfuzzer infra to test the fuzz target
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  {
+  std::vector<h265nal::H265PcapReader::Packet> packets;
+  h265nal::H265PcapReader pcap_reader({});
+  pcap_reader.OpenBuffer(data, size);
+  pcap_reader.ReadPackets(
+      [](const h265nal::H265PcapReader::Packet& packet, void* opaque) {
+        using Packets = std::vector<h265nal::H265PcapReader::Packet>;
+        static_cast<Packets*>(opaque)->push_back(packet);
+      },
+      &packets);
+  }
+  return 0;
+}
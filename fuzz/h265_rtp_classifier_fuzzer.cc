@@ -0,0 +1,22 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+// This file was auto-generated using fuzz/converter.py from
+// h265_rtp_classifier_unittest.cc.
+// Do not edit directly.
+
+#include "h265_rtp_classifier.h"
+#include <stdio.h>
+#include <cstdint>
+#include "h265_common.h"
+#include "rtc_common.h"
+
+
+// libfuzzer infra to test the fuzz target
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  {
+  auto descriptor = h265nal::H265RtpClassifier::ClassifyRtp(data, size);
+  }
+  return 0;
+}
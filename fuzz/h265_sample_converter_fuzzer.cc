@@ -0,0 +1,26 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+// This file was auto-generated using fuzz/converter.py from
+// h265_sample_converter_unittest.cc.
+// Do not edit directly.
+
+#include "h265_sample_converter.h"
+#include <stdio.h>
+#include <cstdint>
+#include <vector>
+#include "h265_common.h"
+#include "rtc_common.h"
+
+
+// libfuzzer infra to test the fuzz target
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  {
+  std::vector<uint8_t> length_fields;
+  std::vector<h265nal::BufferSegment> segments;
+  h265nal::H265SampleConverter::AnnexBToLengthPrefixed(data, size, 4,
+                                              &length_fields, &segments);
+  }
+  return 0;
+}
@@ -0,0 +1,45 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+// This file was auto-generated using fuzz/converter.py from
+// h265_segmenter_unittest.cc.
+// Do not edit directly.
+
+#include "h265_segmenter.h"
+#include <stdio.h>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "h265_bitstream_parser.h"
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "rtc_common.h"
+
+
+// libfuzzer infra to test the fuzz target
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  {
+  h265nal::H265BitstreamParserState bitstream_parser_state;
+  h265nal::H265Segmenter::Options options;
+  options.target_duration_ms = 0;
+  options.add_hvcc = true;
+  h265nal::H265Segmenter segmenter(options, &bitstream_parser_state);
+  std::vector<std::pair<h265nal::H265Segmenter::Segment, std::vector<uint8_t>>>
+      segments;
+  segmenter.Process(
+      data, size,
+      [](const h265nal::H265Segmenter::Segment& segment, void* opaque) {
+        std::vector<uint8_t> contents;
+        for (const auto& span : segment.spans) {
+          contents.insert(contents.end(), span.data, span.data + span.length);
+        }
+        static_cast<std::vector<
+            std::pair<h265nal::H265Segmenter::Segment, std::vector<uint8_t>>>*>(
+            opaque)
+            ->emplace_back(segment, contents);
+      },
+      &segments);
+  }
+  return 0;
+}
@@ -0,0 +1,31 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+// This file was auto-generated using fuzz/converter.py from
+// h265_splicer_unittest.cc.
+// Do not edit directly.
+
+#include "h265_splicer.h"
+#include <stdio.h>
+#include <cstdint>
+#include <vector>
+#include "h265_bitstream_parser.h"
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_slice_parser.h"
+#include "rtc_common.h"
+
+
+// libfuzzer infra to test the fuzz target
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  {
+  // the same stream twice (program, then ad), with colliding ids
+  h265nal::H265Splicer splicer;
+  std::vector<h265nal::BufferSegment> program_spans;
+  splicer.Splice(0, data, size, &program_spans);
+  std::vector<h265nal::BufferSegment> ad_spans;
+  splicer.Splice(1, data, size, &ad_spans);
+  }
+  return 0;
+}
@@ -0,0 +1,28 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+// This file was auto-generated using fuzz/converter.py from
+// h265_sub_bitstream_extractor_unittest.cc.
+// Do not edit directly.
+
+#include "h265_sub_bitstream_extractor.h"
+#include <stdio.h>
+#include <cstdint>
+#include <vector>
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+#include "rtc_common.h"
+
+
+// libfuzzer infra to test the fuzz target
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  {
+  h265nal::H265SubBitstreamExtractor::Options options;
+  options.target_temporal_id = 1;
+  h265nal::H265SubBitstreamExtractor extractor(options);
+  std::vector<h265nal::BufferSegment> spans;
+  extractor.Extract(data, size, &spans);
+  }
+  return 0;
+}
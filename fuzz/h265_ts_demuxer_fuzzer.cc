@@ -0,0 +1,40 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+// This file was auto-generated using fuzz/converter.py from
+// h265_ts_demuxer_unittest.cc.
+// Do not edit directly.
+
+#include "h265_ts_demuxer.h"
+#include <stdio.h>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+#include "rtc_common.h"
+
+
+// libfuzzer infra to test the fuzz target
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  {
+  std::vector<std::pair<h265nal::H265TsDemuxer::AccessUnit, std::vector<uint8_t>>>
+      access_units;
+  h265nal::H265TsDemuxer demuxer(
+      {},
+      [](const h265nal::H265TsDemuxer::AccessUnit& access_unit, void* opaque) {
+        using AccessUnitsT = std::vector<
+            std::pair<h265nal::H265TsDemuxer::AccessUnit, std::vector<uint8_t>>>;
+        static_cast<AccessUnitsT*>(opaque)->emplace_back(
+            access_unit,
+            std::vector<uint8_t>(access_unit.data,
+                                 access_unit.data + access_unit.length));
+      },
+      &access_units);
+  demuxer.AddData(data, size);
+  demuxer.Flush();
+  }
+  return 0;
+}
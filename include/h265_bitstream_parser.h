@@ -45,18 +45,39 @@ class H265BitstreamParser {
       const uint8_t* data, size_t length,
       H265BitstreamParserState* bitstream_parser_state,
       ParsingOptions parsing_options) noexcept;
+  // Same, using the scratch buffers and state pools in `context`.
+  static std::unique_ptr<BitstreamState> ParseBitstream(
+      const uint8_t* data, size_t length,
+      H265BitstreamParserState* bitstream_parser_state,
+      ParsingOptions parsing_options, H265ParserContext* context) noexcept;
 
   // Unpack RBSP and parse bitstream (internal state)
   static std::unique_ptr<BitstreamState> ParseBitstream(
       const uint8_t* data, size_t length,
       ParsingOptions parsing_options) noexcept;
 
+  // Scatter-gather version: the bitstream is spread across `segments`
+  // (start codes and NAL units can be split across segments). NAL unit
+  // offsets refer to the concatenated stream.
+  static std::unique_ptr<BitstreamState> ParseBitstream(
+      const BufferSegment* segments, size_t num_segments,
+      H265BitstreamParserState* bitstream_parser_state,
+      ParsingOptions parsing_options) noexcept;
+  static std::unique_ptr<BitstreamState> ParseBitstream(
+      const BufferSegment* segments, size_t num_segments,
+      ParsingOptions parsing_options) noexcept;
+
   // (2) Explicit NAL unit length field version.
   // NALU length
   static std::unique_ptr<BitstreamState> ParseBitstreamNALULength(
       const uint8_t* data, size_t length, size_t nalu_length_bytes,
       H265BitstreamParserState* bitstream_parser_state,
       ParsingOptions parsing_options) noexcept;
+  // Same, using the scratch buffers and state pools in `context`.
+  static std::unique_ptr<BitstreamState> ParseBitstreamNALULength(
+      const uint8_t* data, size_t length, size_t nalu_length_bytes,
+      H265BitstreamParserState* bitstream_parser_state,
+      ParsingOptions parsing_options, H265ParserContext* context) noexcept;
   static std::unique_ptr<BitstreamState> ParseBitstreamNALULength(
       const uint8_t* data, size_t length, size_t nalu_length_bytes,
       ParsingOptions parsing_options) noexcept;
@@ -72,6 +93,8 @@ class H265BitstreamParser {
   // Returns a vector of the NALU indices in the given buffer.
   static std::vector<NaluIndex> FindNaluIndices(const uint8_t* data,
                                                 size_t length) noexcept;
+  static std::vector<NaluIndex> FindNaluIndices(const BufferSegment* segments,
+                                                size_t num_segments) noexcept;
   static std::vector<NaluIndex> FindNaluIndicesExplicitFraming(
       const uint8_t* data, size_t length) noexcept;
 };
@@ -0,0 +1,68 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+
+#include "h265_common.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+// Per-NAL resource budget.
+//
+// Hostile input can make the parsers allocate and loop for a long time
+// out of a few bytes (e.g. a ue(v) element counting the number of entry
+// point offsets). Parsers charge the budget right before every loop or
+// allocation whose size is controlled by the bitstream, so an oversized
+// NAL unit is rejected before doing the work.
+//
+// The budget limits (in ParsingOptions) are:
+// * max_allocations: number of bitstream-sized containers
+// * max_allocated_bytes: bytes in bitstream-sized containers
+// * max_syntax_elements: syntax elements read in bitstream-sized loops
+// A zero limit means unlimited. A parser that exceeds the budget reports
+// an H265ErrorCode_BudgetExceeded error and returns nullptr.
+//
+// The accounting is per thread.
+class H265Budget {
+ public:
+  // Sets the budget for the lifetime of the object. Scopes can be nested:
+  // the previous budget is restored on destruction.
+  class Scope {
+   public:
+    explicit Scope(const ParsingOptions& parsing_options) noexcept;
+    ~Scope() noexcept;
+    // disable copy and move
+    Scope(const Scope&) = delete;
+    Scope(Scope&&) = delete;
+    Scope& operator=(const Scope&) = delete;
+    Scope& operator=(Scope&&) = delete;
+
+   private:
+    uint32_t max_allocations;
+    size_t max_allocated_bytes;
+    uint32_t max_syntax_elements;
+    uint64_t num_allocations;
+    uint64_t num_allocated_bytes;
+    uint64_t num_syntax_elements;
+  };
+
+  // Charge one allocation of `num_bytes` bytes, plus `num_syntax_elements`
+  // syntax elements, to the current budget. Returns false (and reports
+  // the error) if the budget is exceeded.
+  static bool Charge(const char* parser, const char* element,
+                     BitBuffer* bit_buffer, uint64_t num_syntax_elements,
+                     uint64_t num_bytes) noexcept;
+
+  // Usage of the current budget.
+  static uint64_t GetNumAllocations() noexcept;
+  static uint64_t GetNumAllocatedBytes() noexcept;
+  static uint64_t GetNumSyntaxElements() noexcept;
+};
+
+}  // namespace h265nal
@@ -199,6 +199,49 @@ bool IsNalUnitTypeUnspecified(uint32_t nal_unit_type);
 // byte-stream format packetization (e.g. Annex B data), but not for
 // packet-stream format packetization (e.g. RTP payloads).
 std::vector<uint8_t> UnescapeRbsp(const uint8_t* data, size_t length);
+// Same, reusing the `out` buffer (no allocation if it is large enough).
+void UnescapeRbsp(const uint8_t* data, size_t length,
+                  std::vector<uint8_t>* out);
+
+// Add the emulation prevention bytes to an RBSP (the reverse of
+// UnescapeRbsp()). The escaped bytes are appended to `out` (e.g. after a
+// NAL unit header).
+void EscapeRbsp(const uint8_t* data, size_t length, std::vector<uint8_t>* out);
+
+// Scatter-gather input: a single (logical) byte stream spread across a list
+// of buffers, e.g. a NAL unit received as a chain of packet buffers. The
+// buffers are never coalesced: readers walk the segments in order.
+struct BufferSegment {
+  const uint8_t* data;
+  size_t length;
+};
+
+// Total length of a segment list.
+size_t GetBufferSegmentsLength(const BufferSegment* segments,
+                               size_t num_segments);
+
+// Segment list covering the [offset, offset + length) range of the logical
+// stream (pointing into the original buffers).
+std::vector<BufferSegment> GetBufferSegments(const BufferSegment* segments,
+                                             size_t num_segments,
+                                             size_t offset, size_t length);
+
+// UnescapeRbsp() for a segment list. Emulation prevention sequences can be
+// split across segments.
+std::vector<uint8_t> UnescapeRbsp(const BufferSegment* segments,
+                                  size_t num_segments);
+void UnescapeRbsp(const BufferSegment* segments, size_t num_segments,
+                  std::vector<uint8_t>* out);
+
+// Map an offset in the RBSP (the UnescapeRbsp() output) to the escaped
+// buffer it comes from, and back. An emulation prevention byte maps to
+// the RBSP byte after it, and offsets past the end map to the end.
+size_t RbspToEscapedOffset(const uint8_t* data, size_t length,
+                           size_t rbsp_offset);
+size_t RbspToEscapedOffset(const BufferSegment* segments, size_t num_segments,
+                           size_t rbsp_offset);
+size_t EscapedToRbspOffset(const uint8_t* data, size_t length,
+                           size_t escaped_offset);
 
 // Syntax functions and descriptors) (Section 7.2)
 bool byte_aligned(BitBuffer* bit_buffer);
@@ -220,12 +263,19 @@ struct ParsingOptions {
   bool add_parsed_length;
   bool add_checksum;
   bool add_resolution;
+  // per-NAL resource budget (0 means unlimited, see h265_budget.h)
+  uint32_t max_allocations;
+  size_t max_allocated_bytes;
+  uint32_t max_syntax_elements;
   ParsingOptions()
       : add_offset(true),
         add_length(true),
         add_parsed_length(true),
         add_checksum(true),
-        add_resolution(true) {}
+        add_resolution(true),
+        max_allocations(0),
+        max_allocated_bytes(0),
+        max_syntax_elements(0) {}
 };
 
 class NaluChecksum {
@@ -234,6 +284,9 @@ class NaluChecksum {
   const static int kMaxLength = 32;
   static std::shared_ptr<NaluChecksum> GetNaluChecksum(
       BitBuffer* bit_buffer) noexcept;
+  // Same, into an existing object.
+  static void GetNaluChecksum(BitBuffer* bit_buffer,
+                              NaluChecksum* checksum) noexcept;
   void fdump(char* output, int output_len) const;
   const char* GetChecksum() { return checksum; }
   int GetLength() { return length; }
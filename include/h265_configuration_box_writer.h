@@ -0,0 +1,56 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_common.h"
+
+namespace h265nal {
+
+// A class for writing a h265 configuration box (hvcC, aka isobmff
+// HEVCDecoderConfigurationRecord), as defined in ISO/IEC 14496-15:2022,
+// Section 8.3.2.1.2.
+//
+// The record header is derived from the parsed parameter sets: the profile,
+// tier, level and constraint flags, chroma format, bit depths and temporal
+// layers come from the (first) SPS, min_spatial_segmentation_idc from its
+// VUI, and parallelismType from the PPSs. The NAL unit arrays carry the VPS,
+// SPS, PPS and SEI NAL units, in that order.
+class H265ConfigurationBoxWriter {
+ public:
+  struct Options {
+    Options()
+        : length_size_minus_one(3),
+          array_completeness(1),
+          avg_frame_rate(0),
+          constant_frame_rate(0) {}
+    // size of the NAL unit length fields in the samples, minus one
+    uint32_t length_size_minus_one;
+    // all the parameter sets of each type are in the arrays
+    uint32_t array_completeness;
+    // average frame rate (in frames/256 seconds, 0 means unspecified)
+    uint32_t avg_frame_rate;
+    uint32_t constant_frame_rate;
+  };
+
+  // Write an hvcC from a list of NAL units (escaped, without start codes).
+  // VPS, SPS, PPS and SEI NAL units go into the arrays (duplicates are
+  // dropped), and any other NAL unit is ignored. Returns false if there is
+  // no valid SPS.
+  static bool WriteConfigurationBox(const BufferSegment* nal_units,
+                                    size_t num_nal_units,
+                                    const Options& options,
+                                    std::vector<uint8_t>* buffer) noexcept;
+  // Same, taking the NAL units from an Annex B stream.
+  static bool WriteConfigurationBox(const uint8_t* data, size_t length,
+                                    const Options& options,
+                                    std::vector<uint8_t>* buffer) noexcept;
+};
+
+}  // namespace h265nal
@@ -0,0 +1,127 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_nal_unit_parser.h"
+#ifdef RTP_DEFINE
+#include "h265_rtp_depacketizer.h"
+#endif  // RTP_DEFINE
+#include "h265_utils.h"
+
+namespace h265nal {
+
+// A tracker of which pictures can still be decoded after a loss.
+//
+// The tracker follows the reference structure of the stream: for each
+// picture, it applies the reference picture set (short-term RPS from the
+// slice header or the SPS, plus the long-term pictures) to a model of the
+// DPB, where each picture is marked as decodable or not. A picture is
+// decodable if all the pictures it references (the "Curr" RPS lists) are
+// decodable, and none of its slice segments were lost. Pictures not
+// referenced by later pictures (e.g. a lost sub-layer non-reference
+// picture) do not affect them.
+//
+// Each picture costs O(RPS size) (at most 16 short-term plus the long-term
+// pictures), and the tracker does not allocate after the first pictures.
+//
+// Feed it the parsed NAL units in decoding order, and signal the losses
+// (e.g. RTP sequence number gaps) as they are detected.
+class H265DecodabilityTracker {
+ public:
+  // The picture being received.
+  struct PictureState {
+    int32_t poc = 0;
+    uint32_t nal_unit_type = 0;
+    uint32_t temporal_id = 0;
+    // all the pictures referenced by this one are available and decodable
+    bool references_decodable = false;
+    // no slice segment of this picture was lost (so far)
+    bool complete = false;
+    bool IsDecodable() const { return references_decodable && complete; }
+  };
+
+  struct Stats {
+    uint64_t pictures = 0;
+    // pictures with a missing or undecodable reference picture
+    uint64_t pictures_missing_references = 0;
+    // pictures with lost slice segments
+    uint64_t pictures_incomplete = 0;
+    uint64_t losses = 0;
+  };
+
+  H265DecodabilityTracker();
+  ~H265DecodabilityTracker() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265DecodabilityTracker(const H265DecodabilityTracker&) = delete;
+  H265DecodabilityTracker(H265DecodabilityTracker&&) = delete;
+  H265DecodabilityTracker& operator=(const H265DecodabilityTracker&) = delete;
+  H265DecodabilityTracker& operator=(H265DecodabilityTracker&&) = delete;
+
+  // Add a parsed NAL unit. A NAL unit that could not be parsed (nullptr)
+  // is handled as a loss. Returns whether the picture the NAL unit belongs
+  // to is (still) decodable.
+  bool AddNalUnit(const H265NalUnitParser::NalUnitState* nal_unit_state,
+                  const H265BitstreamParserState* bitstream_parser_state)
+      noexcept;
+#ifdef RTP_DEFINE
+  // Add a depacketized NAL unit. Uses the `after_loss` flag to signal
+  // losses, and the marker bit to tell whether the lost packets were part
+  // of the current picture.
+  bool AddNalUnit(const H265RtpDepacketizer::NalUnit& nal_unit,
+                  const H265NalUnitParser::NalUnitState* nal_unit_state,
+                  const H265BitstreamParserState* bitstream_parser_state)
+      noexcept;
+#endif  // RTP_DEFINE
+  // Signal a loss. The picture being received is incomplete, and any
+  // picture lost as a whole will be missing from the DPB.
+  void SignalLoss() noexcept;
+
+  // The picture being received (valid if HasPicture() is true).
+  bool HasPicture() const { return has_picture; }
+  const PictureState& GetPicture() const { return picture; }
+  // A later picture may reference a picture that cannot be decoded: the
+  // receiver should request a keyframe (e.g. send a PLI).
+  bool NeedsKeyframe() const noexcept;
+  const Stats& GetStats() const { return stats; }
+
+ private:
+  struct DpbEntry {
+    int32_t poc;
+    bool decodable;
+  };
+
+  // Start a new picture: apply its RPS to the DPB.
+  void StartPicture(
+      const H265NalUnitParser::NalUnitState& nal_unit_state,
+      const H265BitstreamParserState* bitstream_parser_state) noexcept;
+  // Add the current picture to the DPB (bounded), making it available for
+  // reference.
+  void StorePicture() noexcept;
+  // Move a reference picture from the DPB to the new DPB. Returns whether
+  // the picture is available and decodable.
+  bool KeepReference(int32_t poc, int32_t poc_mask) noexcept;
+  void MarkIncomplete() noexcept;
+
+  H265PocCalculator poc_calculator;
+  bool has_picture = false;
+  PictureState picture;
+  // the current picture is a reference picture (not SLNR)
+  bool picture_is_reference = false;
+  // DPB model (pictures available for reference)
+  std::vector<DpbEntry> dpb;
+  std::vector<DpbEntry> next_dpb;
+  // RTP marker bit of the last NAL unit
+  bool after_marker = false;
+  Stats stats;
+};
+
+}  // namespace h265nal
@@ -0,0 +1,180 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_pps_parser.h"
+#include "h265_slice_parser.h"
+#include "h265_sps_parser.h"
+
+namespace h265nal {
+
+// A class for deriving the picture and slice parameters a decoder needs
+// (e.g. to fill the parameter buffers of a hardware decode API) from the
+// parsed SPS, PPS and slice segment headers.
+//
+// The picture parameters (CTB geometry, tiles, scaling factors) only
+// depend on the PPS and its SPS: they are derived once per PPS, and again
+// only when the PPS or its SPS are replaced in the bitstream parser state.
+// The slice parameters (reference picture set, weighted prediction) are
+// derived per slice segment, into fixed-size arrays. Both are flat structs
+// that hold the derived values only: the syntax elements used as is stay
+// in the parsed states.
+class H265DecoderParams {
+ public:
+  // Table A.8: maximum number of tile columns and rows
+  const static uint32_t kMaxTileColumns = 20;
+  const static uint32_t kMaxTileRows = 22;
+  // Section 7.4.8 (num_negative_pics and num_positive_pics) and 7.4.7.1
+  // (num_ref_idx_l0_active_minus1): at most 16 pictures
+  const static uint32_t kMaxRefs = 16;
+  // Section 7.4.7.1: num_long_term_sps + num_long_term_pics (at most
+  // num_long_term_ref_pics_sps, which is at most 32)
+  const static uint32_t kMaxLongTermRefs = 32;
+
+  struct PicParams {
+    uint32_t sps_id = 0;
+    uint32_t pps_id = 0;
+    // Section 7.4.3.2.1
+    uint32_t ChromaArrayType = 0;
+    uint32_t BitDepthY = 0;
+    uint32_t BitDepthC = 0;
+    uint32_t MinCbLog2SizeY = 0;
+    uint32_t MinCbSizeY = 0;
+    uint32_t CtbLog2SizeY = 0;
+    uint32_t CtbSizeY = 0;
+    uint32_t PicWidthInMinCbsY = 0;
+    uint32_t PicHeightInMinCbsY = 0;
+    uint32_t PicWidthInCtbsY = 0;
+    uint32_t PicHeightInCtbsY = 0;
+    uint32_t PicSizeInCtbsY = 0;
+    uint32_t MinTbLog2SizeY = 0;
+    uint32_t MaxTbLog2SizeY = 0;
+    // Section 7.4.3.3.1
+    uint32_t Log2MinCuQpDeltaSize = 0;
+    uint32_t Log2ParMrgLevel = 0;
+    int32_t init_qp = 0;
+
+    // tiles (Section 6.5.1), in CTBs. A single tile when tiles are not
+    // enabled.
+    uint32_t num_tile_columns = 0;
+    uint32_t num_tile_rows = 0;
+    uint32_t colWidth[kMaxTileColumns] = {};
+    uint32_t rowHeight[kMaxTileRows] = {};
+    uint32_t colBd[kMaxTileColumns + 1] = {};
+    uint32_t rowBd[kMaxTileRows + 1] = {};
+
+    // scaling factors (Section 7.4.5), in matrix (raster) order: the
+    // 16x16 and 32x32 ones are the 8x8 matrices to upsample, plus their DC
+    // values. Flat (16) when scaling lists are not enabled.
+    uint8_t ScalingFactor4x4[6][16] = {};
+    uint8_t ScalingFactor8x8[6][64] = {};
+    uint8_t ScalingFactor16x16[6][64] = {};
+    uint8_t ScalingFactor32x32[2][64] = {};
+    uint8_t ScalingFactorDc16x16[6] = {};
+    uint8_t ScalingFactorDc32x32[2] = {};
+  };
+
+  struct SliceParams {
+    uint32_t pps_id = 0;
+    uint32_t slice_type = 0;
+    uint32_t dependent_slice_segment_flag = 0;
+    uint32_t slice_segment_address = 0;
+    // slice_segment_address in tile scan (CtbAddrRsToTs, Equation 6-5)
+    uint32_t ctb_addr_in_ts = 0;
+    // Equation 7-54
+    int32_t SliceQpY = 0;
+    uint32_t MaxNumMergeCand = 0;
+    // 0 if the list is not used
+    uint32_t num_ref_idx_l0_active = 0;
+    uint32_t num_ref_idx_l1_active = 0;
+
+    // short-term reference picture set (Equations 7-61 and 7-62), as POC
+    // deltas to the current picture
+    uint32_t NumNegativePics = 0;
+    uint32_t NumPositivePics = 0;
+    int32_t DeltaPocS0[kMaxRefs] = {};
+    int32_t DeltaPocS1[kMaxRefs] = {};
+    uint8_t UsedByCurrPicS0[kMaxRefs] = {};
+    uint8_t UsedByCurrPicS1[kMaxRefs] = {};
+    // long-term reference pictures (Equation 7-52)
+    uint32_t num_long_term = 0;
+    uint32_t PocLsbLt[kMaxLongTermRefs] = {};
+    uint8_t UsedByCurrPicLt[kMaxLongTermRefs] = {};
+    uint8_t delta_poc_msb_present_flag[kMaxLongTermRefs] = {};
+    uint32_t DeltaPocMsbCycleLt[kMaxLongTermRefs] = {};
+    // RPS list sizes (Section 8.3.2), and Equation 7-55
+    uint32_t NumPocStCurrBefore = 0;
+    uint32_t NumPocStCurrAfter = 0;
+    uint32_t NumPocLtCurr = 0;
+    uint32_t NumPicTotalCurr = 0;
+
+    // weighted prediction (Section 7.4.7.3), for the L0 entries parsed by
+    // H265PredWeightTableParser. Default weights when not present.
+    uint32_t luma_log2_weight_denom = 0;
+    uint32_t ChromaLog2WeightDenom = 0;
+    int32_t LumaWeightL0[kMaxRefs] = {};
+    int32_t luma_offset_l0[kMaxRefs] = {};
+    int32_t ChromaWeightL0[kMaxRefs][2] = {};
+    int32_t ChromaOffsetL0[kMaxRefs][2] = {};
+  };
+
+  H265DecoderParams() = default;
+  ~H265DecoderParams() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265DecoderParams(const H265DecoderParams&) = delete;
+  H265DecoderParams(H265DecoderParams&&) = delete;
+  H265DecoderParams& operator=(const H265DecoderParams&) = delete;
+  H265DecoderParams& operator=(H265DecoderParams&&) = delete;
+
+  // Picture parameters of PPS `pps_id`. The pointer is valid until the
+  // PPS is derived again. Returns nullptr if the PPS or its SPS are
+  // missing or invalid.
+  const PicParams* GetPicParams(
+      uint32_t pps_id,
+      const H265BitstreamParserState& bitstream_parser_state) noexcept;
+  // CtbAddrRsToTs (Equation 6-5) of PPS `pps_id`, derived with the
+  // picture parameters.
+  const std::vector<uint32_t>* GetCtbAddrRsToTs(
+      uint32_t pps_id,
+      const H265BitstreamParserState& bitstream_parser_state) noexcept;
+
+  // Slice parameters of a slice segment header. Dependent slice segments
+  // take the values of the last independent one. Returns false if the
+  // parameters cannot be derived.
+  bool GetSliceParams(
+      const H265SliceSegmentHeaderParser::SliceSegmentHeaderState&
+          slice_segment_header,
+      const H265BitstreamParserState& bitstream_parser_state,
+      SliceParams* slice_params) noexcept;
+
+ private:
+  // Derived state of a PPS.
+  struct PpsEntry {
+    // the states it was derived from
+    std::shared_ptr<struct H265PpsParser::PpsState> pps;
+    std::shared_ptr<struct H265SpsParser::SpsState> sps;
+    PicParams pic_params;
+    std::vector<uint32_t> ctb_addr_rs_to_ts;
+  };
+
+  const PpsEntry* GetPpsEntry(
+      uint32_t pps_id,
+      const H265BitstreamParserState& bitstream_parser_state) noexcept;
+
+  std::map<uint32_t, PpsEntry> pps_entries;
+  // last independent slice segment
+  SliceParams last_slice_params;
+  bool has_last_slice_params = false;
+};
+
+}  // namespace h265nal
@@ -0,0 +1,93 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "rtc_common.h"
+
+namespace h265nal {
+
+enum H265ErrorCode : uint8_t {
+  H265ErrorCode_None = 0,
+  // a syntax element has a value outside its valid range
+  H265ErrorCode_OutOfRange = 1,
+  // a fixed/reserved syntax element has an unexpected value
+  H265ErrorCode_InvalidValue = 2,
+  // the bitstream uses a syntax structure we do not parse
+  H265ErrorCode_Unimplemented = 3,
+  // the slice refers to a parameter set we have not seen
+  H265ErrorCode_MissingParameterSet = 4,
+  // the input is too short
+  H265ErrorCode_Truncated = 5,
+  // a sub-parser (e.g. the NAL unit header) failed
+  H265ErrorCode_ParseFailed = 6,
+  // the NAL unit exceeds the resource budget (see h265_budget.h)
+  H265ErrorCode_BudgetExceeded = 7,
+};
+
+// A parse error.
+struct H265Error {
+  H265ErrorCode code = H265ErrorCode_None;
+  // parser that produced the error (e.g. "sps")
+  const char* parser = nullptr;
+  // offending syntax element (or a short description)
+  const char* element = nullptr;
+  // offending value and its valid range (OutOfRange errors), or the
+  // resource usage and its limit (BudgetExceeded errors)
+  int64_t value = 0;
+  int64_t min = 0;
+  int64_t max = 0;
+  // index of the NAL unit in the bitstream
+  size_t nal_index = 0;
+  // bit offset in the (unescaped) NAL unit where the error was found
+  size_t bit_offset = 0;
+};
+
+// Error channel for the parsers.
+//
+// Every parser error is stored in a bounded ring (the last kRingSize
+// errors are kept), and then either delivered to a user callback or, if
+// there is no callback, logged to stderr (only in FPRINT_ERRORS builds).
+// Default logging is rate-limited to kMaxLogsPerSecond lines per second,
+// so a corrupted feed cannot stall the parsing thread on I/O.
+//
+// All the state is per thread: callbacks must be installed from the
+// thread that runs the parser.
+class H265ErrorReporter {
+ public:
+  static constexpr size_t kRingSize = 64;
+  static constexpr uint32_t kMaxLogsPerSecond = 10;
+
+  typedef void (*Callback)(const H265Error& error, void* opaque);
+
+  // Set the error callback (nullptr restores the default logging).
+  static void SetCallback(Callback callback, void* opaque) noexcept;
+  // Set the index of the NAL unit being parsed.
+  static void SetNalIndex(size_t nal_index) noexcept;
+
+  // Report an error. `bit_buffer` (may be nullptr) provides the bit offset.
+  static void Report(H265ErrorCode code, const char* parser,
+                     const char* element, BitBuffer* bit_buffer) noexcept;
+  static void Report(H265ErrorCode code, const char* parser,
+                     const char* element, BitBuffer* bit_buffer,
+                     int64_t value, int64_t min, int64_t max) noexcept;
+
+  // Total number of errors reported since the last Reset().
+  static uint64_t GetErrorCount() noexcept;
+  // The last (up to kRingSize) errors, oldest first.
+  static std::vector<H265Error> GetErrors() noexcept;
+  // Clear the ring, the error count, and the logging rate limiter.
+  static void Reset() noexcept;
+
+  static const char* ErrorCodeToString(H265ErrorCode code) noexcept;
+  // Write a one-line description of the error.
+  static void Print(FILE* outfp, const H265Error& error) noexcept;
+};
+
+}  // namespace h265nal
@@ -0,0 +1,158 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_common.h"
+#include "h265_utils.h"
+
+namespace h265nal {
+
+// A reader of H.265 blocks from Matroska and WebM files (codec ID
+// "V_MPEGH/ISO/HEVC").
+//
+// The file is memory-mapped and walked in place. Open() only reads the
+// segment elements before the first cluster (plus the ones the SeekHead
+// points to, e.g. Cues at the end of the file): it finds the H.265 tracks
+// and their CodecPrivate (an hvcC box). ReadBlocks() then walks the
+// clusters lazily, from the current position, and returns the
+// SimpleBlock and BlockGroup payloads as pointers into the mapping. Use
+// Seek() to start at the cluster that the Cues list for a given time:
+// the clusters before it are not read.
+//
+// Block payloads are length-prefixed (`Track::length_size` bytes): feed
+// them to `H265BitstreamParser::ParseBitstreamNALULength()`. Laced blocks
+// are not supported (video blocks are not laced).
+class H265MkvReader {
+ public:
+  struct Options {
+    Options() : track_number(0) {}
+    // only read this track (0 means all the H.265 tracks)
+    uint64_t track_number;
+  };
+
+  struct Track {
+    uint64_t track_number = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // nanoseconds per frame (0 if unknown)
+    uint64_t default_duration = 0;
+    // CodecPrivate contents (HEVCDecoderConfigurationRecord)
+    const uint8_t* codec_private = nullptr;
+    size_t codec_private_length = 0;
+    // NAL unit length field size (lengthSizeMinusOne + 1)
+    size_t length_size = 4;
+  };
+
+  // A cue point: the position of the cluster to start at for a time.
+  struct CuePoint {
+    // in TimecodeScale units
+    uint64_t time;
+    uint64_t track_number;
+    // cluster offset (from the start of the file)
+    size_t cluster_offset;
+  };
+
+  // A block (access unit). `data` is valid while the reader is open.
+  struct Block {
+    uint64_t track_number;
+    // block timecode (in TimecodeScale units), and timestamp
+    int64_t timecode;
+    int64_t timestamp_ns;
+    // keyframe (SimpleBlock flag, or BlockGroup without ReferenceBlock)
+    bool keyframe;
+    // block data (length-prefixed NAL units)
+    const uint8_t* data;
+    size_t length;
+    size_t length_size;
+  };
+  typedef void (*Callback)(const Block& block, void* opaque);
+
+  struct Stats {
+    uint64_t clusters = 0;
+    uint64_t blocks = 0;
+    // laced or truncated blocks
+    uint64_t blocks_invalid = 0;
+  };
+
+  explicit H265MkvReader(const Options& options);
+  ~H265MkvReader() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265MkvReader(const H265MkvReader&) = delete;
+  H265MkvReader(H265MkvReader&&) = delete;
+  H265MkvReader& operator=(const H265MkvReader&) = delete;
+  H265MkvReader& operator=(H265MkvReader&&) = delete;
+
+  // Open (memory-map) a Matroska file, and read its headers. Returns false
+  // on error, or if the file has no H.265 track.
+  bool Open(const char* filename) noexcept;
+  // Use a file already in memory (not copied: it must outlive the reader).
+  bool OpenBuffer(const uint8_t* data, size_t length) noexcept;
+  void Close() noexcept;
+
+  // H.265 tracks (with their CodecPrivate).
+  const std::vector<Track>& GetTracks() const { return tracks; }
+  // Cue points (sorted by time, if the file is).
+  const std::vector<CuePoint>& GetCuePoints() const { return cue_points; }
+  // Nanoseconds per timecode unit.
+  uint64_t GetTimecodeScale() const { return timecode_scale; }
+
+  // Move to the last cluster whose cue point time is at or before
+  // `timestamp_ns` (to the first cluster if there is none). Returns false
+  // if the file has no cues.
+  bool Seek(int64_t timestamp_ns) noexcept;
+
+  // Walk the clusters from the current position to the end of the
+  // segment, calling `callback` for each block of the H.265 tracks.
+  // Returns false if the file is invalid.
+  bool ReadBlocks(Callback callback, void* opaque) noexcept;
+
+  const Stats& GetStats() const { return stats; }
+
+ private:
+  bool ParseSegmentHeaders() noexcept;
+  void ParseSeekHead(const uint8_t* seek_head, size_t length) noexcept;
+  // Parse the level 1 element at `offset` (from a SeekHead).
+  void ParseElementAt(size_t offset, uint32_t id) noexcept;
+  void ParseInfo(const uint8_t* info, size_t length) noexcept;
+  void ParseTracks(const uint8_t* tracks_data, size_t length) noexcept;
+  void ParseTrackEntry(const uint8_t* track_entry, size_t length) noexcept;
+  void ParseCues(const uint8_t* cues, size_t length) noexcept;
+  // Returns the offset after the cluster.
+  size_t ReadCluster(size_t offset, size_t end, Callback callback,
+                     void* opaque) noexcept;
+  void ReadBlock(const uint8_t* block, size_t length, int64_t cluster_timecode,
+                 bool simple_block, bool has_reference, Callback callback,
+                 void* opaque) noexcept;
+  const Track* GetTrack(uint64_t track_number) const noexcept;
+
+  Options options;
+  Stats stats;
+  std::vector<Track> tracks;
+  std::vector<CuePoint> cue_points;
+  uint64_t timecode_scale = 1000000;
+
+  // file
+  const uint8_t* data = nullptr;
+  size_t length = 0;
+  H265MappedFile file;
+  // segment data (offsets from the start of the file)
+  size_t segment_start = 0;
+  size_t segment_end = 0;
+  // Tracks and Cues positions (from the SeekHead, 0 if unknown)
+  size_t seek_tracks = 0;
+  size_t seek_cues = 0;
+  bool has_tracks = false;
+  bool has_cues = false;
+  // first cluster, and next cluster to read
+  size_t first_cluster = 0;
+  size_t next_cluster = 0;
+};
+
+}  // namespace h265nal
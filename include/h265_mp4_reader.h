@@ -0,0 +1,149 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_common.h"
+#include "h265_utils.h"
+
+namespace h265nal {
+
+// A reader of H.265 samples from ISO BMFF files (mp4, including fragmented
+// mp4), as defined in ISO/IEC 14496-12 and ISO/IEC 14496-15.
+//
+// The file is memory-mapped and walked in place. Open() only reads the
+// moov box: it finds the tracks with an hvc1/hev1 sample entry and their
+// hvcC. ReadSamples() then returns the samples, in decoding order, as
+// pointers into the mapping: first the ones described by the moov sample
+// tables (stsz/stco/co64, stsc, stts, ctts, stss), then the ones in each
+// moof fragment (tfhd/tfdt/trun). The sample tables are walked with
+// cursors, so neither the mdat nor the tables are copied: very long files
+// use no more memory than short ones.
+//
+// Samples are length-prefixed (`Track::length_size` bytes): feed them to
+// `H265BitstreamParser::ParseBitstreamNALULength()`.
+class H265Mp4Reader {
+ public:
+  struct Options {
+    Options() : track_id(0) {}
+    // only read this track (0 means all the H.265 tracks)
+    uint32_t track_id;
+  };
+
+  struct Track {
+    uint32_t track_id = 0;
+    // media timescale (ticks per second)
+    uint32_t timescale = 0;
+    // sample entry type ('hvc1' or 'hev1')
+    uint32_t sample_entry_type = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // hvcC box contents (HEVCDecoderConfigurationRecord)
+    const uint8_t* hvcc = nullptr;
+    size_t hvcc_length = 0;
+    // NAL unit length field size (lengthSizeMinusOne + 1)
+    size_t length_size = 4;
+
+    // sample tables (box payloads, pointing into the file)
+    BufferSegment stsz = {nullptr, 0};
+    BufferSegment stco = {nullptr, 0};
+    bool co64 = false;
+    BufferSegment stsc = {nullptr, 0};
+    BufferSegment stts = {nullptr, 0};
+    BufferSegment ctts = {nullptr, 0};
+    BufferSegment stss = {nullptr, 0};
+    // track extends defaults (trex)
+    uint32_t default_sample_duration = 0;
+    uint32_t default_sample_size = 0;
+    uint32_t default_sample_flags = 0;
+    // sample number and decode time of the next sample
+    uint64_t next_index = 0;
+    uint64_t next_decode_time = 0;
+  };
+
+  // A sample (access unit). `data` is valid while the reader is open.
+  struct Sample {
+    uint32_t track_id;
+    // sample number in the track (0-based)
+    uint64_t index;
+    // decode and composition (presentation) times, in timescale units
+    uint64_t decode_time;
+    int64_t composition_time;
+    uint32_t duration;
+    uint32_t timescale;
+    // sync sample (e.g. IRAP)
+    bool sync;
+    // sample data (length-prefixed NAL units)
+    const uint8_t* data;
+    size_t length;
+    size_t length_size;
+  };
+  typedef void (*Callback)(const Sample& sample, void* opaque);
+
+  struct Stats {
+    uint64_t samples = 0;
+    // samples outside the file or with an invalid size
+    uint64_t samples_invalid = 0;
+    uint64_t fragments = 0;
+  };
+
+  explicit H265Mp4Reader(const Options& options);
+  ~H265Mp4Reader() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265Mp4Reader(const H265Mp4Reader&) = delete;
+  H265Mp4Reader(H265Mp4Reader&&) = delete;
+  H265Mp4Reader& operator=(const H265Mp4Reader&) = delete;
+  H265Mp4Reader& operator=(H265Mp4Reader&&) = delete;
+
+  // Open (memory-map) an mp4 file, and read its moov box. Returns false on
+  // error, or if the file has no H.265 track.
+  bool Open(const char* filename) noexcept;
+  // Use a file already in memory (not copied: it must outlive the reader).
+  bool OpenBuffer(const uint8_t* data, size_t length) noexcept;
+  void Close() noexcept;
+
+  // H.265 tracks (with their hvcC).
+  const std::vector<Track>& GetTracks() const { return tracks; }
+
+  // Walk the samples of the H.265 tracks, calling `callback` for each of
+  // them (track by track for the moov sample tables, then in fragment
+  // order). Returns false if the file is invalid.
+  bool ReadSamples(Callback callback, void* opaque) noexcept;
+
+  const Stats& GetStats() const { return stats; }
+
+ private:
+  bool ParseMoov(const uint8_t* moov, size_t moov_length) noexcept;
+  bool ParseTrak(const uint8_t* trak, size_t trak_length) noexcept;
+  bool ReadTrackSamples(Track* track, Callback callback,
+                        void* opaque) noexcept;
+  bool ReadMoof(const uint8_t* moof, size_t moof_length, Callback callback,
+                void* opaque) noexcept;
+  Track* GetTrack(uint32_t track_id) noexcept;
+  // Bound a sample count that is not backed by a sample table (e.g. a
+  // constant sample size) by the samples the file can still hold. The
+  // other samples are counted as invalid.
+  uint64_t ClaimSamples(uint64_t count) noexcept;
+  void Emit(Track* track, uint64_t offset, uint64_t size, uint32_t duration,
+            int64_t composition_offset, bool sync, Callback callback,
+            void* opaque) noexcept;
+
+  Options options;
+  Stats stats;
+  std::vector<Track> tracks;
+  // samples left to claim (see ClaimSamples())
+  uint64_t sample_budget = 0;
+
+  // file
+  const uint8_t* data = nullptr;
+  size_t length = 0;
+  H265MappedFile file;
+};
+
+}  // namespace h265nal
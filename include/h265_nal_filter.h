@@ -0,0 +1,133 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "h265_common.h"
+
+namespace h265nal {
+
+// A NAL unit filter/edit pipeline over Annex B streams, e.g. to strip the
+// filler data, AUDs or some SEI messages of a stream, to keep only its
+// IRAP pictures (trick play), or to repeat the parameter sets before each
+// IRAP picture.
+//
+// Each NAL unit goes through the stages in order. A stage gets the NAL
+// unit (with its header already parsed) and returns whether to keep it. It
+// can also rewrite it (by pointing it to a buffer from GetBuffer()), or
+// insert NAL units before it (InsertNalUnit()). A dropped NAL unit does
+// not reach the next stages, and the NAL units inserted before it are
+// dropped with it.
+//
+// The output is a rope: a list of spans pointing into the input buffer
+// (the NAL units that pass unchanged, start codes included, merged when
+// contiguous) and into small buffers owned by the filter (the rewritten
+// and the inserted NAL units). The bytes of the unchanged NAL units are
+// never copied. The owned buffers are valid until the next Filter() call.
+class H265NalFilter {
+ public:
+  // A NAL unit, as seen by the stages.
+  struct NalUnit {
+    // NAL unit (header included, no start code)
+    const uint8_t* data;
+    size_t length;
+    // nal_unit_header() fields
+    uint32_t nal_unit_type;
+    uint32_t nuh_layer_id;
+    uint32_t temporal_id;
+  };
+  // A stage. Returns false to drop the NAL unit.
+  typedef bool (*Stage)(NalUnit* nal_unit, H265NalFilter* filter,
+                        void* opaque);
+
+  struct Stats {
+    uint64_t nal_units = 0;
+    uint64_t nal_units_dropped = 0;
+    uint64_t nal_units_rewritten = 0;
+    uint64_t nal_units_inserted = 0;
+  };
+
+  H265NalFilter() = default;
+  ~H265NalFilter() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265NalFilter(const H265NalFilter&) = delete;
+  H265NalFilter(H265NalFilter&&) = delete;
+  H265NalFilter& operator=(const H265NalFilter&) = delete;
+  H265NalFilter& operator=(H265NalFilter&&) = delete;
+
+  // Add a stage at the end of the pipeline.
+  void AddStage(Stage stage, void* opaque);
+
+  // Built-in stages. Calling one of them again adds another stage with the
+  // same (merged) configuration.
+  // Drop the NAL units of some types (e.g. FD_NUT, AUD_NUT).
+  void AddDropNalUnitTypes(const std::vector<uint32_t>& nal_unit_types);
+  // Remove the SEI messages of some payload types. SEI NAL units with other
+  // messages are rewritten, and the ones left empty are dropped.
+  void AddDropSeiPayloadTypes(const std::vector<uint32_t>& payload_types);
+  // Drop the non-IRAP VCL NAL units.
+  void AddKeepIrapOnly();
+  // Insert the last VPSs, SPSs and PPSs (one per id) before each IRAP
+  // picture that is not already preceded by parameter sets.
+  void AddInsertParameterSets();
+
+  // Filter an Annex B buffer. The output spans are appended to `spans`.
+  // Returns the output size.
+  size_t Filter(const uint8_t* data, size_t length,
+                std::vector<BufferSegment>* spans) noexcept;
+
+  // For stages: an empty buffer owned by the filter, valid until the next
+  // Filter() call.
+  std::vector<uint8_t>* GetBuffer() noexcept;
+  // For stages: insert a NAL unit (no start code, copied) before the
+  // current one.
+  void InsertNalUnit(const uint8_t* data, size_t length) noexcept;
+
+  const Stats& GetStats() const { return stats; }
+
+ private:
+  static bool DropNalUnitTypesStage(NalUnit* nal_unit, H265NalFilter* filter,
+                                    void* opaque);
+  static bool DropSeiPayloadTypesStage(NalUnit* nal_unit,
+                                       H265NalFilter* filter, void* opaque);
+  static bool KeepIrapOnlyStage(NalUnit* nal_unit, H265NalFilter* filter,
+                                void* opaque);
+  static bool InsertParameterSetsStage(NalUnit* nal_unit,
+                                       H265NalFilter* filter, void* opaque);
+
+  struct StageEntry {
+    Stage stage;
+    void* opaque;
+  };
+  std::vector<StageEntry> stages;
+  Stats stats;
+
+  // owned buffers (the first `num_buffers` ones are in use)
+  std::deque<std::vector<uint8_t>> buffers;
+  size_t num_buffers = 0;
+  // spans inserted before the current NAL unit
+  std::vector<BufferSegment> inserted_spans;
+
+  // built-in stages configuration and state
+  // NAL unit types to drop (bitmask)
+  uint64_t drop_nal_unit_types = 0;
+  std::vector<uint32_t> drop_sei_payload_types;
+  std::vector<uint8_t> rbsp_buffer;
+  std::vector<uint8_t> sei_buffer;
+  // last parameter sets (by id)
+  std::map<uint32_t, std::vector<uint8_t>> vps;
+  std::map<uint32_t, std::vector<uint8_t>> sps;
+  std::map<uint32_t, std::vector<uint8_t>> pps;
+  // parameter sets found since the last VCL NAL unit
+  bool parameter_sets_seen = false;
+};
+
+}  // namespace h265nal
@@ -15,6 +15,8 @@
 
 namespace h265nal {
 
+class H265ParserContext;
+
 // A class for parsing out an H265 NAL Unit.
 class H265NalUnitParser {
  public:
@@ -56,6 +58,10 @@ class H265NalUnitParser {
       const uint8_t* data, size_t length,
       struct H265BitstreamParserState* bitstream_parser_state,
       ParsingOptions parsing_options) noexcept;
+  static std::unique_ptr<NalUnitState> ParseNalUnitUnescaped(
+      const uint8_t* data, size_t length,
+      struct H265BitstreamParserState* bitstream_parser_state,
+      ParsingOptions parsing_options, H265ParserContext* context) noexcept;
   // Unpack RBSP and parse NAL unit state from the supplied buffer.
   // Use this function to parse NALUs that have been escaped
   // to avoid the start code prefix (0x000001/0x00000001)
@@ -63,6 +69,21 @@ class H265NalUnitParser {
       const uint8_t* data, size_t length,
       struct H265BitstreamParserState* bitstream_parser_state,
       ParsingOptions parsing_options) noexcept;
+  // Same, using the scratch buffers and state pools in `context` (see
+  // h265_parser_context.h).
+  static std::unique_ptr<NalUnitState> ParseNalUnit(
+      const uint8_t* data, size_t length,
+      struct H265BitstreamParserState* bitstream_parser_state,
+      ParsingOptions parsing_options, H265ParserContext* context) noexcept;
+  // Scatter-gather version: the NAL unit is spread across `segments`.
+  static std::unique_ptr<NalUnitState> ParseNalUnit(
+      const BufferSegment* segments, size_t num_segments,
+      struct H265BitstreamParserState* bitstream_parser_state,
+      ParsingOptions parsing_options) noexcept;
+  static std::unique_ptr<NalUnitState> ParseNalUnit(
+      const BufferSegment* segments, size_t num_segments,
+      struct H265BitstreamParserState* bitstream_parser_state,
+      ParsingOptions parsing_options, H265ParserContext* context) noexcept;
   static std::unique_ptr<NalUnitState> ParseNalUnit(
       BitBuffer* bit_buffer,
       struct H265BitstreamParserState* bitstream_parser_state,
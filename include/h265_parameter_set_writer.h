@@ -0,0 +1,61 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_pps_parser.h"
+#include "h265_sps_parser.h"
+#include "h265_vps_parser.h"
+
+namespace h265nal {
+
+// A class for writing parameter sets (VPS, SPS and PPS) from their parsed
+// state, e.g. to patch the VUI colour description or timing, or to drop
+// the HRD parameters, without a transcode:
+//
+//   auto sps = H265SpsParser::ParseSps(data + 2, length - 2);
+//   sps->vui_parameters->colour_primaries = 9;
+//   H265ParameterSetWriter::WriteSps(*sps, options, &nal_unit);
+//
+// The writers are the inverse of the parsers: each syntax element is
+// written under the same conditions the parser reads it, so that parsing
+// the output gives back the same state, and an unmodified state gives back
+// the original NAL unit. The presence flags must be kept consistent with
+// the fields and vectors they control (e.g. clear
+// vui_hrd_parameters_present_flag when dropping hrd_parameters).
+//
+// Writing fails if a value does not fit its syntax element, if a vector is
+// shorter than its count, or if the state misses syntax that the parsers
+// do not keep: VPS extension data, more than one VPS hrd_parameters(), SPS
+// and PPS extension data (sps_extension_4bits, pps_extension_4bits), PPS
+// range and 3D extensions, and PPS colour mapping tables.
+class H265ParameterSetWriter {
+ public:
+  struct Options {
+    Options() : nuh_layer_id(0), nuh_temporal_id_plus1(1) {}
+    // NAL unit header fields
+    uint32_t nuh_layer_id;
+    uint32_t nuh_temporal_id_plus1;
+  };
+
+  // Write a parameter set NAL unit (NAL unit header and escaped RBSP,
+  // without start code) into `buffer`, replacing its contents. Returns
+  // false if the state cannot be written.
+  static bool WriteVps(const H265VpsParser::VpsState& vps,
+                       const Options& options,
+                       std::vector<uint8_t>* buffer) noexcept;
+  static bool WriteSps(const H265SpsParser::SpsState& sps,
+                       const Options& options,
+                       std::vector<uint8_t>* buffer) noexcept;
+  static bool WritePps(const H265PpsParser::PpsState& pps,
+                       const Options& options,
+                       std::vector<uint8_t>* buffer) noexcept;
+};
+
+}  // namespace h265nal
@@ -0,0 +1,196 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "h265_common.h"
+#include "h265_nal_unit_header_parser.h"
+#include "h265_nal_unit_parser.h"
+#include "h265_nal_unit_payload_parser.h"
+#include "h265_pred_weight_table_parser.h"
+#include "h265_slice_parser.h"
+#include "h265_st_ref_pic_set_parser.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+// Reusable parser context.
+//
+// A context owns the scratch buffers used by the parsers (e.g. the RBSP
+// unescape buffer), plus pools of recycled state objects. Pass it to the
+// parser entry points, and give the parsed NAL units back with Recycle()
+// once done with them: after a warm-up period, parsing a steady-state
+// stream of slices does not touch the heap.
+//
+// Recycled states keep the buffers of their vectors (e.g. the entry point
+// offsets, the reference picture set deltas or the weighted prediction
+// tables), so a warm context only allocates when a NAL unit needs more
+// entries than any previous one.
+//
+// The VPS, SPS and PPS states are shared with the bitstream parser state,
+// and are not pooled.
+//
+// A context must only be used by one thread at a time.
+class H265ParserContext {
+ public:
+  H265ParserContext() = default;
+  ~H265ParserContext() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265ParserContext(const H265ParserContext&) = delete;
+  H265ParserContext(H265ParserContext&&) = delete;
+  H265ParserContext& operator=(const H265ParserContext&) = delete;
+  H265ParserContext& operator=(H265ParserContext&&) = delete;
+
+  // Return a parsed NAL unit (and its sub-states) to the pools.
+  void Recycle(std::unique_ptr<H265NalUnitParser::NalUnitState> nal_unit);
+
+  // Sets the context used by the parsers in this thread for the lifetime
+  // of the object (a nullptr context is a no-op). Scopes can be nested.
+  class Scope {
+   public:
+    explicit Scope(H265ParserContext* context) noexcept;
+    ~Scope() noexcept;
+    // disable copy and move
+    Scope(const Scope&) = delete;
+    Scope(Scope&&) = delete;
+    Scope& operator=(const Scope&) = delete;
+    Scope& operator=(Scope&&) = delete;
+
+   private:
+    H265ParserContext* previous;
+  };
+
+  // Context used by the parsers in this thread (may be nullptr).
+  static H265ParserContext* GetCurrent() noexcept;
+
+  // Get a (default-initialized) state object, from the current context
+  // pools if possible.
+  template <typename T>
+  static std::unique_ptr<T> MakeState() {
+    H265ParserContext* context = GetCurrent();
+    if (context == nullptr) {
+      return std::make_unique<T>();
+    }
+    return context->GetPool<T>()->Get();
+  }
+  static std::shared_ptr<NaluChecksum> MakeChecksum();
+  // Get an empty vector (e.g. for the inner vectors of a state), from the
+  // current context pool if possible.
+  static std::vector<int32_t> MakeInt32Vector();
+
+  // RBSP unescape buffer.
+  std::vector<uint8_t>* GetUnescapeBuffer() { return &unescape_buffer; }
+
+ private:
+  template <typename T>
+  class StatePool {
+   public:
+    std::unique_ptr<T> Get() {
+      if (states.empty()) {
+        return std::make_unique<T>();
+      }
+      std::unique_ptr<T> state = std::move(states.back());
+      states.pop_back();
+      return state;
+    }
+    // Reset `state` in place, and keep it for reuse. The buffers of the
+    // `members` vectors are kept.
+    template <typename... V>
+    void Put(std::unique_ptr<T> state, std::vector<V> T::*... members) {
+      if (state == nullptr) {
+        return;
+      }
+      ResetState(state.get(), members...);
+      states.push_back(std::move(state));
+    }
+
+   private:
+    std::vector<std::unique_ptr<T>> states;
+  };
+
+  // Reset a state to its default-constructed value, keeping the buffers
+  // (capacity) of the `member` vectors: each one is moved out before the
+  // reset, and moved back (cleared) after it.
+  template <typename T>
+  static void ResetState(T* state) {
+    state->~T();
+    new (state) T();
+  }
+  template <typename T, typename V, typename... Rest>
+  static void ResetState(T* state, std::vector<V> T::*member,
+                         Rest... rest) {
+    std::vector<V> buffer = std::move(state->*member);
+    ResetState(state, rest...);
+    buffer.clear();
+    state->*member = std::move(buffer);
+  }
+
+  template <typename T>
+  StatePool<T>* GetPool();
+
+  std::vector<uint8_t> unescape_buffer;
+  std::vector<std::shared_ptr<NaluChecksum>> checksums;
+  std::vector<std::vector<int32_t>> int32_vectors;
+  StatePool<H265NalUnitParser::NalUnitState> nal_units;
+  StatePool<H265NalUnitHeaderParser::NalUnitHeaderState> nal_unit_headers;
+  StatePool<H265NalUnitPayloadParser::NalUnitPayloadState> nal_unit_payloads;
+  StatePool<H265SliceSegmentLayerParser::SliceSegmentLayerState>
+      slice_segment_layers;
+  StatePool<H265SliceSegmentHeaderParser::SliceSegmentHeaderState>
+      slice_segment_headers;
+  StatePool<H265StRefPicSetParser::StRefPicSetState> st_ref_pic_sets;
+  StatePool<H265PredWeightTableParser::PredWeightTableState>
+      pred_weight_tables;
+};
+
+template <>
+inline H265ParserContext::StatePool<H265NalUnitParser::NalUnitState>*
+H265ParserContext::GetPool() {
+  return &nal_units;
+}
+template <>
+inline H265ParserContext::StatePool<
+    H265NalUnitHeaderParser::NalUnitHeaderState>*
+H265ParserContext::GetPool() {
+  return &nal_unit_headers;
+}
+template <>
+inline H265ParserContext::StatePool<
+    H265NalUnitPayloadParser::NalUnitPayloadState>*
+H265ParserContext::GetPool() {
+  return &nal_unit_payloads;
+}
+template <>
+inline H265ParserContext::StatePool<
+    H265SliceSegmentLayerParser::SliceSegmentLayerState>*
+H265ParserContext::GetPool() {
+  return &slice_segment_layers;
+}
+template <>
+inline H265ParserContext::StatePool<
+    H265SliceSegmentHeaderParser::SliceSegmentHeaderState>*
+H265ParserContext::GetPool() {
+  return &slice_segment_headers;
+}
+template <>
+inline H265ParserContext::StatePool<H265StRefPicSetParser::StRefPicSetState>*
+H265ParserContext::GetPool() {
+  return &st_ref_pic_sets;
+}
+template <>
+inline H265ParserContext::StatePool<
+    H265PredWeightTableParser::PredWeightTableState>*
+H265ParserContext::GetPool() {
+  return &pred_weight_tables;
+}
+
+}  // namespace h265nal
@@ -0,0 +1,116 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_common.h"
+#include "h265_rtp_header.h"
+#include "h265_utils.h"
+
+namespace h265nal {
+
+// A reader of RTP packets from network captures (pcap and pcapng files).
+//
+// The capture is memory-mapped and walked in place: packets are returned
+// in capture order, as pointers into the mapping, without copies. Only
+// UDP over IPv4 or IPv6 is supported (unfragmented), on Ethernet (with
+// VLAN tags), Linux cooked (v1 and v2), raw IP, and BSD loopback links.
+// UDP flows can be filtered by port, and RTP packets by SSRC and payload
+// type. RTCP packets are skipped.
+class H265PcapReader {
+ public:
+  struct Options {
+    Options()
+        : port(0), filter_ssrc(false), ssrc(0), filter_payload_type(false),
+          payload_type(0) {}
+    // UDP port (source or destination, 0 means any)
+    uint16_t port;
+    // RTP SSRC
+    bool filter_ssrc;
+    uint32_t ssrc;
+    // RTP payload type
+    bool filter_payload_type;
+    uint32_t payload_type;
+  };
+
+  // An RTP packet. The pointers are valid while the reader is open.
+  struct Packet {
+    // capture timestamp (nanoseconds since the epoch)
+    int64_t timestamp_ns;
+    uint16_t src_port;
+    uint16_t dst_port;
+    RtpHeader rtp_header;
+    // full RTP packet (RTP header included)
+    const uint8_t* data;
+    size_t length;
+    // RTP payload (RTP header and padding stripped)
+    const uint8_t* payload;
+    size_t payload_length;
+  };
+  typedef void (*Callback)(const Packet& packet, void* opaque);
+
+  struct Stats {
+    // capture records (packets)
+    uint64_t records = 0;
+    // records that are not UDP over IP (or are fragmented or truncated)
+    uint64_t records_skipped = 0;
+    // UDP datagrams that are not RTP (e.g. RTCP)
+    uint64_t udp_not_rtp = 0;
+    // RTP packets dropped by the filters
+    uint64_t rtp_filtered = 0;
+    // RTP packets returned
+    uint64_t rtp_packets = 0;
+  };
+
+  explicit H265PcapReader(const Options& options);
+  ~H265PcapReader();
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265PcapReader(const H265PcapReader&) = delete;
+  H265PcapReader(H265PcapReader&&) = delete;
+  H265PcapReader& operator=(const H265PcapReader&) = delete;
+  H265PcapReader& operator=(H265PcapReader&&) = delete;
+
+  // Open (memory-map) a capture file. Returns false on error.
+  bool Open(const char* filename) noexcept;
+  // Use a capture already in memory (not copied: it must outlive the
+  // reader).
+  bool OpenBuffer(const uint8_t* data, size_t length) noexcept;
+  void Close() noexcept;
+
+  // Walk the capture, calling `callback` for each RTP packet (in capture
+  // order). Returns false if the capture is not a valid pcap or pcapng
+  // file (a truncated last record is ignored).
+  bool ReadPackets(Callback callback, void* opaque) noexcept;
+
+  const Stats& GetStats() const { return stats; }
+
+  // Get the UDP payload of a link-layer frame. Returns false if the frame
+  // is not an (unfragmented) UDP datagram.
+  static bool GetUdpPayload(uint32_t link_type, const uint8_t* data,
+                            size_t length, uint16_t* src_port,
+                            uint16_t* dst_port, const uint8_t** payload,
+                            size_t* payload_length) noexcept;
+
+ private:
+  bool ReadPcap(Callback callback, void* opaque) noexcept;
+  bool ReadPcapng(Callback callback, void* opaque) noexcept;
+  void ProcessFrame(uint32_t link_type, int64_t timestamp_ns,
+                    const uint8_t* data, size_t length, Callback callback,
+                    void* opaque) noexcept;
+
+  Options options;
+  Stats stats;
+
+  // capture
+  const uint8_t* data = nullptr;
+  size_t length = 0;
+  H265MappedFile file;
+};
+
+}  // namespace h265nal
@@ -0,0 +1,131 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_nal_unit_parser.h"
+#include "h265_parser_context.h"
+#ifdef RTP_DEFINE
+#include "h265_rtp_depacketizer.h"
+#endif  // RTP_DEFINE
+
+namespace h265nal {
+
+// A streaming slice QP monitor.
+//
+// Consumes NAL units (or RTP packets) one at a time, aggregates the slice
+// QP_Y values (Equation 7-54) of each frame, and calls back when a frame
+// is complete, with the frame statistics and the statistics over a sliding
+// window of the last `window_size` frames. Averages are weighted by the
+// slice segment sizes.
+//
+// A frame is complete when the first NAL unit of the next access unit
+// arrives (Section 7.4.2.4.4), on an RTP packet with the marker bit set, or
+// on Flush().
+//
+// NAL units are parsed with a reusable `H265ParserContext`, and the window
+// is a fixed ring: after warm-up, the monitor does not allocate.
+class H265QpMonitor {
+ public:
+  struct Options {
+    Options() : window_size(30) {}
+    // number of frames in the sliding window
+    size_t window_size;
+    ParsingOptions parsing_options;
+#ifdef RTP_DEFINE
+    H265RtpDepacketizer::Options depacketizer_options;
+#endif  // RTP_DEFINE
+  };
+
+  struct FrameQp {
+    // slice segments with a known QP
+    uint32_t num_slices = 0;
+    // bytes of slice segment NAL units
+    size_t bytes = 0;
+    int32_t min_qp = 0;
+    int32_t max_qp = 0;
+    double avg_qp = 0.0;
+    // the frame contains an IRAP picture
+    bool keyframe = false;
+  };
+
+  struct WindowQp {
+    size_t num_frames = 0;
+    size_t bytes = 0;
+    int32_t min_qp = 0;
+    int32_t max_qp = 0;
+    double avg_qp = 0.0;
+  };
+
+  typedef void (*Callback)(const FrameQp& frame, const WindowQp& window,
+                           void* opaque);
+
+  H265QpMonitor(const Options& options, Callback callback, void* opaque);
+  ~H265QpMonitor() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265QpMonitor(const H265QpMonitor&) = delete;
+  H265QpMonitor(H265QpMonitor&&) = delete;
+  H265QpMonitor& operator=(const H265QpMonitor&) = delete;
+  H265QpMonitor& operator=(H265QpMonitor&&) = delete;
+
+  // Add a NAL unit (no start code, still escaped). Parameter sets are kept
+  // in the monitor state.
+  void AddNalUnit(const uint8_t* data, size_t length) noexcept;
+  // Add an already-parsed NAL unit. `length` is its size in bytes.
+  void AddNalUnit(const H265NalUnitParser::NalUnitState& nal_unit_state,
+                  size_t length,
+                  const H265BitstreamParserState* bitstream_parser_state)
+      noexcept;
+#ifdef RTP_DEFINE
+  // Add a full RTP packet. Returns false if the packet is invalid.
+  bool AddRtpPacket(const uint8_t* data, size_t length) noexcept;
+#endif  // RTP_DEFINE
+  // Complete the current frame (if any).
+  void Flush() noexcept;
+
+  const WindowQp& GetWindowQp() const { return window; }
+
+ private:
+#ifdef RTP_DEFINE
+  static void OnNalUnit(const H265RtpDepacketizer::NalUnit& nal_unit,
+                        void* opaque);
+#endif  // RTP_DEFINE
+  void EndFrame() noexcept;
+  void UpdateWindow() noexcept;
+
+  Options options;
+  Callback callback;
+  void* opaque;
+
+  H265BitstreamParserState bitstream_parser_state;
+  H265ParserContext context;
+#ifdef RTP_DEFINE
+  std::unique_ptr<H265RtpDepacketizer> depacketizer;
+#endif  // RTP_DEFINE
+
+  // current frame
+  bool in_frame = false;
+  FrameQp frame;
+  // sum of qp * bytes over the frame slices
+  double frame_qp_sum = 0.0;
+  // QP of the last independent slice segment (for dependent ones)
+  int32_t last_slice_qp = 0;
+  bool has_last_slice_qp = false;
+
+  // sliding window (ring of the last frames)
+  std::vector<FrameQp> ring;
+  size_t ring_next = 0;
+  size_t ring_size = 0;
+  WindowQp window;
+};
+
+}  // namespace h265nal
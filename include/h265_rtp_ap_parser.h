@@ -11,6 +11,7 @@
 
 #include "h265_common.h"
 #include "h265_nal_unit_parser.h"
+#include "h265_rtp_don.h"
 #include "rtc_common.h"
 
 namespace h265nal {
@@ -36,6 +37,15 @@ class H265RtpApParser {
     // common header
     std::unique_ptr<struct H265NalUnitHeaderParser::NalUnitHeaderState> header;
 
+    // decoding order numbers (only when sprop-max-don-diff > 0): the first
+    // NAL unit carries a DONL, the next ones a DOND (`nal_unit_donds[0]` is
+    // unused)
+    bool don_present = false;
+    uint32_t donl = 0;
+    std::vector<uint32_t> nal_unit_donds;
+    // derived DON of each NAL unit
+    std::vector<uint32_t> nal_unit_dons;
+
     // payload
     std::vector<size_t> nal_unit_sizes;
     std::vector<
@@ -53,6 +63,15 @@ class H265RtpApParser {
   static std::unique_ptr<RtpApState> ParseRtpAp(
       BitBuffer* bit_buffer,
       struct H265BitstreamParserState* bitstream_parser_state) noexcept;
+  // DON-aware versions.
+  static std::unique_ptr<RtpApState> ParseRtpAp(
+      const uint8_t* data, size_t length,
+      struct H265BitstreamParserState* bitstream_parser_state,
+      const RtpDonParameters& don_parameters) noexcept;
+  static std::unique_ptr<RtpApState> ParseRtpAp(
+      BitBuffer* bit_buffer,
+      struct H265BitstreamParserState* bitstream_parser_state,
+      const RtpDonParameters& don_parameters) noexcept;
 };
 
 }  // namespace h265nal
@@ -0,0 +1,70 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+
+#include "h265_common.h"
+
+namespace h265nal {
+
+// A packed description of an RTP packet, for forwarding decisions.
+struct RtpPacketDescriptor {
+  enum PacketType : uint32_t {
+    kSingle = 0,
+    kAp = 1,
+    kFu = 2,
+    kOther = 3,
+  };
+
+  // the packet was classified
+  uint32_t valid : 1;
+  // PacketType
+  uint32_t packet_type : 2;
+  // type of the first VCL NAL unit (FuType for an FU), or of the first NAL
+  // unit if there is no VCL NAL unit
+  uint32_t nal_unit_type : 6;
+  // from the payload header (the lowest ones in an AP)
+  uint32_t layer_id : 6;
+  uint32_t temporal_id : 3;
+  // contains (part of) an IRAP picture
+  uint32_t keyframe : 1;
+  // contains the start of a picture (first_slice_segment_in_pic_flag)
+  uint32_t start_of_frame : 1;
+  // RTP marker bit: last packet of an access unit
+  uint32_t end_of_frame : 1;
+  // contains a VPS, SPS, or PPS
+  uint32_t parameter_sets : 1;
+  // contains (part of) an IRAP, TSA, or STSA picture, where a receiver can
+  // switch up temporal layers
+  uint32_t switching_point : 1;
+  // FU start and end bits
+  uint32_t fu_start : 1;
+  uint32_t fu_end : 1;
+  // number of NAL units (saturated at 63)
+  uint32_t num_nal_units : 6;
+};
+static_assert(sizeof(RtpPacketDescriptor) == sizeof(uint32_t),
+              "RtpPacketDescriptor must be packed in 32 bits");
+
+// A class for classifying RTP packets (rfc7798) without parsing them.
+//
+// Classification reads only the payload header, the FU header, the AP NAL
+// unit headers, and the first byte of each slice segment. It does not
+// unescape, allocate, or keep any state.
+class H265RtpClassifier {
+ public:
+  // Classify a full RTP packet (fixed header included).
+  static RtpPacketDescriptor ClassifyRtp(const uint8_t* data, size_t length,
+                                         bool don_present = false) noexcept;
+  // Classify an RTP payload. `marker` is the RTP marker bit.
+  static RtpPacketDescriptor ClassifyPayload(const uint8_t* data,
+                                             size_t length, bool marker,
+                                             bool don_present = false) noexcept;
+};
+
+}  // namespace h265nal
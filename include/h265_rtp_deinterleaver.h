@@ -0,0 +1,101 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_rtp_depacketizer.h"
+#include "h265_rtp_don.h"
+
+namespace h265nal {
+
+// A de-interleaving buffer for RTP streams with decoding order numbers
+// (rfc7798 Section 6).
+//
+// Takes the NAL units produced by an `H265RtpDepacketizer` (in transmission
+// order), and emits them in decoding (DON) order. A NAL unit is released as
+// soon as no NAL unit that precedes it in decoding order can still arrive,
+// i.e. when a NAL unit more than sprop-max-don-diff DONs after it has been
+// received, or when the buffer holds more than sprop-depack-buf-nalus NAL
+// units or sprop-depack-buf-bytes bytes. This bounds the added latency.
+//
+// NAL units that arrive after a NAL unit that follows them in decoding order
+// has been released are dropped.
+//
+// Buffered NAL units are copied into a pool of buffers that is reused:
+// after warm-up, the de-interleaver does not allocate.
+class H265RtpDeinterleaver {
+ public:
+  struct Stats {
+    uint64_t nal_units_received = 0;
+    uint64_t nal_units_emitted = 0;
+    // NAL units that arrived too late
+    uint64_t nal_units_dropped = 0;
+    // maximum number of NAL units buffered at the same time
+    uint64_t max_buffered_nal_units = 0;
+  };
+
+  H265RtpDeinterleaver(const RtpDonParameters& don_parameters,
+                       H265RtpDepacketizer::Callback callback, void* opaque);
+  ~H265RtpDeinterleaver() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265RtpDeinterleaver(const H265RtpDeinterleaver&) = delete;
+  H265RtpDeinterleaver(H265RtpDeinterleaver&&) = delete;
+  H265RtpDeinterleaver& operator=(const H265RtpDeinterleaver&) = delete;
+  H265RtpDeinterleaver& operator=(H265RtpDeinterleaver&&) = delete;
+
+  // Add a NAL unit (e.g. from an `H265RtpDepacketizer` callback).
+  void AddNalUnit(const H265RtpDepacketizer::NalUnit& nal_unit) noexcept;
+  // Emit all the buffered NAL units (e.g. at the end of the stream).
+  void Flush() noexcept;
+  // Drop all the state.
+  void Reset() noexcept;
+
+  const Stats& GetStats() const { return stats; }
+
+  // Convenience callback to chain a depacketizer into a de-interleaver
+  // (`opaque` is the de-interleaver).
+  static void AddNalUnitCallback(const H265RtpDepacketizer::NalUnit& nal_unit,
+                                 void* opaque);
+
+ private:
+  struct Entry {
+    // DON extended to 64 bits (no wraparound)
+    int64_t extended_don;
+    // arrival order (keeps NAL units with the same DON in order)
+    uint64_t arrival;
+    H265RtpDepacketizer::NalUnit nal_unit;
+    std::vector<uint8_t> data;
+  };
+
+  // Whether entry `a` comes after entry `b` (min-heap order).
+  bool After(size_t a, size_t b) const;
+  // Emit the first NAL unit in decoding order.
+  void EmitFirst() noexcept;
+
+  RtpDonParameters don_parameters;
+  H265RtpDepacketizer::Callback callback;
+  void* opaque;
+  Stats stats;
+
+  // entry pool, and heap (of entry indices) of buffered NAL units
+  std::vector<Entry> entries;
+  std::vector<size_t> free_entries;
+  std::vector<size_t> heap;
+  size_t buffered_bytes = 0;
+
+  bool started = false;
+  // highest extended DON received
+  int64_t max_extended_don = 0;
+  // extended DON of the last emitted NAL unit
+  bool emitted = false;
+  int64_t last_emitted_don = 0;
+  uint64_t arrival_counter = 0;
+};
+
+}  // namespace h265nal
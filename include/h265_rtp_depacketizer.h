@@ -0,0 +1,162 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_common.h"
+#include "h265_rtp_don.h"
+#include "h265_rtp_header.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+// An RFC 7798 depacketizer.
+//
+// Takes full RTP packets (fixed header included), reorders them in a
+// bounded window keyed by sequence number, splits APs, reassembles FUs,
+// and emits complete NAL units (without start code, still escaped) through
+// a callback.
+//
+// Packets are copied once, into a fixed pool of slot buffers (one per
+// reorder window position). Single NAL unit packets and AP NAL units are
+// emitted directly from the slot buffers, and FUs are reassembled in a
+// reusable buffer: after warm-up, the depacketizer does not allocate.
+//
+// When the stream carries decoding order numbers (sprop-max-don-diff > 0 in
+// `Options::don_parameters`), the DONL/DOND fields are stripped and each
+// NAL unit gets its DON. NAL units are still emitted in transmission order:
+// use an `H265RtpDeinterleaver` to restore decoding order.
+//
+// A NAL unit emitted after a sequence number gap (lost packets, or packets
+// that arrived too late for the reorder window) is flagged with
+// `after_loss`. Partial FUs around a gap are dropped. Two sequential packets
+// far behind the expected sequence number are taken as a sequence number
+// restart (rfc3550 Appendix A.1): the depacketizer flushes and resyncs on
+// them, instead of dropping the new stream as too late.
+class H265RtpDepacketizer {
+ public:
+  struct Options {
+    Options()
+        : reorder_window(64),
+          max_packet_size(65535),
+          max_nal_unit_size(1 << 22) {}
+    // reorder window size (in packets)
+    uint16_t reorder_window;
+    // maximum RTP packet size
+    size_t max_packet_size;
+    // maximum size of an FU-reassembled NAL unit
+    size_t max_nal_unit_size;
+    // DON parameters (from the SDP)
+    RtpDonParameters don_parameters;
+  };
+
+  // A depacketized NAL unit. `data` is only valid during the callback.
+  struct NalUnit {
+    const uint8_t* data;
+    size_t length;
+    uint32_t rtp_timestamp;
+    // sequence number of the (last) packet carrying the NAL unit
+    uint16_t sequence_number;
+    // last NAL unit in a packet with the marker bit set
+    bool marker;
+    // first NAL unit after a loss
+    bool after_loss;
+    // decoding order number (only when sprop-max-don-diff > 0)
+    uint32_t don;
+  };
+  typedef void (*Callback)(const NalUnit& nal_unit, void* opaque);
+
+  struct Stats {
+    uint64_t packets_received = 0;
+    // packets that were never received
+    uint64_t packets_lost = 0;
+    // packets received out of order (but in time)
+    uint64_t packets_reordered = 0;
+    // duplicate or too late packets
+    uint64_t packets_dropped = 0;
+    // sequence number restarts (e.g. a sender restart), resynced on
+    uint64_t sequence_restarts = 0;
+    // invalid (or unsupported) packets
+    uint64_t packets_invalid = 0;
+    uint64_t nal_units = 0;
+    // partially-reassembled FU NAL units dropped because of a loss or an
+    // invalid FU (NAL units whose start fragment was lost are not counted)
+    uint64_t nal_units_dropped = 0;
+  };
+
+  H265RtpDepacketizer(const Options& options, Callback callback,
+                      void* opaque);
+  ~H265RtpDepacketizer() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265RtpDepacketizer(const H265RtpDepacketizer&) = delete;
+  H265RtpDepacketizer(H265RtpDepacketizer&&) = delete;
+  H265RtpDepacketizer& operator=(const H265RtpDepacketizer&) = delete;
+  H265RtpDepacketizer& operator=(H265RtpDepacketizer&&) = delete;
+
+  // Add an RTP packet. Returns false if the packet is invalid.
+  bool AddPacket(const uint8_t* data, size_t length) noexcept;
+  // Process all the buffered packets (e.g. at the end of the stream).
+  void Flush() noexcept;
+  // Drop all the state (e.g. on an SSRC change).
+  void Reset() noexcept;
+
+  const Stats& GetStats() const { return stats; }
+  // Heap memory held by the depacketizer buffers (in bytes).
+  size_t GetMemoryUsage() const noexcept;
+
+ private:
+  struct Slot {
+    bool used = false;
+    RtpHeader header;
+    std::vector<uint8_t> packet;
+  };
+
+  // Process the packet at `next_sequence_number` (if any).
+  void ProcessNext() noexcept;
+  void ProcessPayload(const RtpHeader& header, uint8_t* payload,
+                      size_t length) noexcept;
+  void ProcessFu(const RtpHeader& header, const uint8_t* payload,
+                 size_t length) noexcept;
+  void Emit(const RtpHeader& header, const uint8_t* data, size_t length,
+            bool marker, uint32_t don) noexcept;
+  void SignalLoss() noexcept;
+
+  Options options;
+  Callback callback;
+  void* opaque;
+  Stats stats;
+
+  // reorder window
+  std::vector<Slot> slots;
+  bool started = false;
+  uint16_t next_sequence_number = 0;
+  // slot of `next_sequence_number`: packets go to the slot at their
+  // distance from it, which stays continuous across the sequence number
+  // wraparound whatever the window size
+  size_t next_slot = 0;
+  size_t num_buffered = 0;
+  // sequence number that confirms a restart (rfc3550 Appendix A.1
+  // `bad_seq`): the one after the last packet far behind the window
+  // (0x10000 if none)
+  uint32_t bad_sequence_number = 0x10000;
+  // sum of the slot packet capacities (kept up to date, so that
+  // GetMemoryUsage() does not walk the window)
+  size_t slots_capacity = 0;
+
+  // FU reassembly
+  std::vector<uint8_t> fu_buffer;
+  bool fu_active = false;
+  uint32_t fu_don = 0;
+
+  // highest sequence number received
+  uint16_t highest_sequence_number = 0;
+  bool loss_pending = false;
+};
+
+}  // namespace h265nal
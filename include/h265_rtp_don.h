@@ -0,0 +1,42 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+
+namespace h265nal {
+
+// RTP decoding order number (DON) parameters (rfc7798 Section 7.1).
+//
+// When `sprop_max_don_diff` is larger than 0, single NAL unit packets and
+// FUs carry a 16-bit DONL field, and APs carry a DONL field (first NAL
+// unit) plus 8-bit DOND fields (following NAL units).
+struct RtpDonParameters {
+  // sprop-max-don-diff
+  uint32_t sprop_max_don_diff = 0;
+  // sprop-depack-buf-nalus
+  uint32_t sprop_depack_buf_nalus = 0;
+  // sprop-depack-buf-bytes
+  uint32_t sprop_depack_buf_bytes = 0;
+
+  // Whether the packets carry DONL/DOND fields.
+  bool DonPresent() const { return sprop_max_don_diff > 0; }
+
+  // Parse the DON parameters from an SDP fmtp parameter list (e.g.
+  // "sprop-max-don-diff=2;sprop-depack-buf-nalus=4"). Other parameters are
+  // ignored. Returns false on an invalid value.
+  static bool ParseFmtp(const char* fmtp,
+                        RtpDonParameters* don_parameters) noexcept;
+
+  // Signed distance from DON `m` to DON `n` (rfc7798 Section 4.4.1,
+  // don_diff(m, n)).
+  static int32_t DonDiff(uint32_t m, uint32_t n) noexcept {
+    return static_cast<int16_t>(static_cast<uint16_t>(n - m));
+  }
+};
+
+}  // namespace h265nal
@@ -10,6 +10,7 @@
 
 #include "h265_common.h"
 #include "h265_nal_unit_parser.h"
+#include "h265_rtp_don.h"
 #include "rtc_common.h"
 
 namespace h265nal {
@@ -40,6 +41,11 @@ class H265RtpFuParser {
     uint32_t e_bit;
     uint32_t fu_type;
 
+    // decoding order number (only in the first fragment, and only when
+    // sprop-max-don-diff > 0)
+    bool don_present = false;
+    uint32_t donl = 0;
+
     // optional payload
     std::unique_ptr<struct H265NalUnitPayloadParser::NalUnitPayloadState>
         nal_unit_payload;
@@ -52,6 +58,15 @@ class H265RtpFuParser {
   static std::unique_ptr<RtpFuState> ParseRtpFu(
       BitBuffer* bit_buffer,
       struct H265BitstreamParserState* bitstream_parser_state) noexcept;
+  // DON-aware versions.
+  static std::unique_ptr<RtpFuState> ParseRtpFu(
+      const uint8_t* data, size_t length,
+      struct H265BitstreamParserState* bitstream_parser_state,
+      const RtpDonParameters& don_parameters) noexcept;
+  static std::unique_ptr<RtpFuState> ParseRtpFu(
+      BitBuffer* bit_buffer,
+      struct H265BitstreamParserState* bitstream_parser_state,
+      const RtpDonParameters& don_parameters) noexcept;
 };
 
 }  // namespace h265nal
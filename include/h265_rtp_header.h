@@ -0,0 +1,34 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+
+namespace h265nal {
+
+// RTP fixed header (rfc3550 Section 5.1).
+struct RtpHeader {
+  uint32_t version = 0;
+  uint32_t padding = 0;
+  uint32_t extension = 0;
+  uint32_t csrc_count = 0;
+  uint32_t marker = 0;
+  uint32_t payload_type = 0;
+  uint16_t sequence_number = 0;
+  uint32_t timestamp = 0;
+  uint32_t ssrc = 0;
+  // payload location (after CSRCs and header extension, before padding)
+  size_t payload_offset = 0;
+  size_t payload_length = 0;
+
+  // Parse the fixed header of an RTP packet. Returns false if the packet
+  // is not a valid RTP (version 2) packet.
+  static bool Parse(const uint8_t* data, size_t length,
+                    RtpHeader* header) noexcept;
+};
+
+}  // namespace h265nal
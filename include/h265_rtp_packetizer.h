@@ -0,0 +1,107 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+// An RFC 7798 packetizer.
+//
+// Takes the NAL units of an access unit (without start code), and splits
+// them into RTP payloads: NAL units larger than the maximum payload size are
+// fragmented (FU), consecutive small NAL units are aggregated (AP), and the
+// rest are sent as single NAL unit packets.
+//
+// Payloads are produced as scatter-gather lists (`BufferSegment`s, the
+// iovec equivalent) that point into the NAL unit buffers: only the payload
+// headers, FU headers, and AP NAL unit sizes are written, into a buffer
+// owned by the packetizer. The output is valid until the next Packetize()
+// call, and as long as the NAL unit buffers are. After warm-up, the
+// packetizer does not allocate.
+//
+// DONL/DOND fields (sprop-max-don-diff > 0) are not produced.
+class H265RtpPacketizer {
+ public:
+  struct Options {
+    Options() : max_payload_size(1200), aggregate(true) {}
+    // maximum RTP payload size (MTU minus the RTP/UDP/IP headers)
+    size_t max_payload_size;
+    // aggregate small NAL units into APs
+    bool aggregate;
+  };
+
+  enum PacketType {
+    kSingle = 0,
+    kAp = 1,
+    kFu = 2,
+  };
+
+  // An RTP payload.
+  struct Packet {
+    PacketType type;
+    // segments of the payload (see GetSegments())
+    size_t first_segment;
+    size_t num_segments;
+    // payload length (in bytes)
+    size_t length;
+    // last packet of the access unit (RTP marker bit)
+    bool marker;
+  };
+
+  explicit H265RtpPacketizer(const Options& options);
+  ~H265RtpPacketizer() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265RtpPacketizer(const H265RtpPacketizer&) = delete;
+  H265RtpPacketizer(H265RtpPacketizer&&) = delete;
+  H265RtpPacketizer& operator=(const H265RtpPacketizer&) = delete;
+  H265RtpPacketizer& operator=(H265RtpPacketizer&&) = delete;
+
+  // Packetize the NAL units of an access unit. Returns false if a NAL unit
+  // is invalid (shorter than its header), or if the maximum payload size is
+  // too small to fragment it.
+  bool Packetize(const BufferSegment* nal_units,
+                 size_t num_nal_units) noexcept;
+  // Same, for NAL units found with H265BitstreamParser::FindNaluIndices().
+  bool Packetize(
+      const uint8_t* data,
+      const std::vector<H265BitstreamParser::NaluIndex>& nalu_indices) noexcept;
+
+  const std::vector<Packet>& GetPackets() const { return packets; }
+  // Segments of a packet payload.
+  const BufferSegment* GetSegments(const Packet& packet) const {
+    return segments.data() + packet.first_segment;
+  }
+
+ private:
+  // Add the pending (aggregated) NAL units as a single or AP packet.
+  void FlushAggregation() noexcept;
+  void AddFragments(const BufferSegment& nal_unit) noexcept;
+  // Reserve `length` bytes in the header buffer.
+  uint8_t* AddHeader(size_t length) noexcept;
+  void AddSegment(const uint8_t* data, size_t length) noexcept;
+  void StartPacket(PacketType type) noexcept;
+
+  Options options;
+  std::vector<Packet> packets;
+  std::vector<BufferSegment> segments;
+  // header storage (never reallocated during a Packetize() call)
+  std::vector<uint8_t> header_buffer;
+  size_t header_length = 0;
+  // NAL units pending aggregation
+  std::vector<BufferSegment> pending;
+  size_t pending_length = 0;
+  // scratch list for the NaluIndex version
+  std::vector<BufferSegment> nal_unit_list;
+};
+
+}  // namespace h265nal
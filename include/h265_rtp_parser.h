@@ -10,6 +10,7 @@
 
 #include "h265_common.h"
 #include "h265_rtp_ap_parser.h"
+#include "h265_rtp_don.h"
 #include "h265_rtp_fu_parser.h"
 #include "h265_rtp_single_parser.h"
 #include "rtc_common.h"
@@ -45,9 +46,41 @@ class H265RtpParser {
   static std::unique_ptr<RtpState> ParseRtp(
       const uint8_t* data, size_t length,
       struct H265BitstreamParserState* bitstream_parser_state) noexcept;
+  // Same, using the scratch buffers and state pools in `context`.
+  static std::unique_ptr<RtpState> ParseRtp(
+      const uint8_t* data, size_t length,
+      struct H265BitstreamParserState* bitstream_parser_state,
+      H265ParserContext* context) noexcept;
+  // Scatter-gather version: the RTP payload is spread across `segments`.
+  static std::unique_ptr<RtpState> ParseRtp(
+      const BufferSegment* segments, size_t num_segments,
+      struct H265BitstreamParserState* bitstream_parser_state) noexcept;
+  static std::unique_ptr<RtpState> ParseRtp(
+      const BufferSegment* segments, size_t num_segments,
+      struct H265BitstreamParserState* bitstream_parser_state,
+      H265ParserContext* context) noexcept;
   static std::unique_ptr<RtpState> ParseRtp(
       BitBuffer* bit_buffer,
       struct H265BitstreamParserState* bitstream_parser_state) noexcept;
+  // DON-aware versions (for streams with sprop-max-don-diff > 0).
+  static std::unique_ptr<RtpState> ParseRtp(
+      const uint8_t* data, size_t length,
+      struct H265BitstreamParserState* bitstream_parser_state,
+      const RtpDonParameters& don_parameters) noexcept;
+  static std::unique_ptr<RtpState> ParseRtp(
+      const uint8_t* data, size_t length,
+      struct H265BitstreamParserState* bitstream_parser_state,
+      const RtpDonParameters& don_parameters,
+      H265ParserContext* context) noexcept;
+  static std::unique_ptr<RtpState> ParseRtp(
+      BitBuffer* bit_buffer,
+      struct H265BitstreamParserState* bitstream_parser_state,
+      const RtpDonParameters& don_parameters) noexcept;
+  static std::unique_ptr<RtpState> ParseRtp(
+      BitBuffer* bit_buffer,
+      struct H265BitstreamParserState* bitstream_parser_state,
+      const RtpDonParameters& don_parameters,
+      H265ParserContext* context) noexcept;
 };
 
 }  // namespace h265nal
@@ -0,0 +1,172 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "h265_common.h"
+#include "h265_nal_unit_parser.h"
+#include "h265_rtp_depacketizer.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+// A manager for many concurrent RTP streams, keyed by SSRC.
+//
+// Each session keeps its own parser state: parameter sets, an
+// `H265RtpDepacketizer`, a reusable `H265ParserContext`, and the POC of the
+// last picture seen. Sessions are created on the first packet of a new SSRC,
+// and evicted when idle for longer than `idle_timeout_ms`, or (least
+// recently used first) when over the `max_sessions` or `max_total_bytes`
+// limits. A session whose buffers grow over `max_session_bytes` has its
+// depacketization state dropped. Memory usage is a lower-bound estimate
+// (the depacketizer buffers, plus the parameter set state sizes without the
+// heap memory they own, e.g. scaling lists or VUI/HRD parameters), updated
+// after each packet in constant time: the memory caps may be exceeded by
+// sessions with large parameter sets.
+//
+// Sessions are spread over `num_shards` independently-locked shards: there
+// is no global lock, so packets for different shards can be processed from
+// several threads in parallel. Batches are grouped by shard, so each shard
+// lock is taken once per batch. The `max_sessions` and `max_total_bytes`
+// limits are split evenly over the shards, and each shard evicts its own
+// least recently used sessions: a shard never has to take another shard
+// lock, and a new session is never rejected because the sessions to evict
+// live in other shards. There are at most `max_sessions` shards. Each
+// shard keeps its sessions in an LRU list, so evicting one is O(1).
+//
+// The callback is called with the shard lock held: it must not call back
+// into the manager.
+class H265RtpSessionManager {
+ public:
+  struct Options {
+    Options()
+        : num_shards(16),
+          max_sessions(4096),
+          idle_timeout_ms(30000),
+          max_session_bytes(4 << 20),
+          max_total_bytes(static_cast<size_t>(1) << 30),
+          parse_nal_units(true) {}
+    // number of independently-locked shards
+    size_t num_shards;
+    // maximum number of sessions (0 means unlimited)
+    size_t max_sessions;
+    // idle time before a session is evicted (0 means never)
+    int64_t idle_timeout_ms;
+    // maximum memory per session (0 means unlimited)
+    size_t max_session_bytes;
+    // maximum memory for all the sessions (0 means unlimited)
+    size_t max_total_bytes;
+    // parse the NAL units (needed for the parameter sets and the POC)
+    bool parse_nal_units;
+    H265RtpDepacketizer::Options depacketizer_options;
+    ParsingOptions parsing_options;
+  };
+
+  // A parsed NAL unit. `nal_unit_state` is nullptr if the NAL unit could not
+  // be parsed. Both are only valid during the callback.
+  typedef void (*Callback)(
+      uint32_t ssrc, const H265RtpDepacketizer::NalUnit& nal_unit,
+      const H265NalUnitParser::NalUnitState* nal_unit_state, void* opaque);
+
+  struct Stats {
+    uint64_t packets = 0;
+    // invalid packets, or packets of new sessions over the session limit
+    uint64_t packets_rejected = 0;
+    uint64_t sessions_created = 0;
+    uint64_t sessions_evicted_idle = 0;
+    uint64_t sessions_evicted_memory = 0;
+    uint64_t sessions_evicted_count = 0;
+    // sessions whose depacketization state was dropped (memory cap)
+    uint64_t session_resets = 0;
+  };
+
+  struct SessionStats {
+    uint64_t packets = 0;
+    uint64_t nal_units = 0;
+    int64_t last_seen_ms = 0;
+    // POC of the last picture (valid if `has_poc` is true)
+    bool has_poc = false;
+    int32_t last_poc = 0;
+    // memory usage (lower-bound estimate)
+    size_t memory_bytes = 0;
+    size_t num_vps = 0;
+    size_t num_sps = 0;
+    size_t num_pps = 0;
+    H265RtpDepacketizer::Stats depacketizer;
+  };
+
+  H265RtpSessionManager(const Options& options, Callback callback,
+                        void* opaque);
+  ~H265RtpSessionManager();
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265RtpSessionManager(const H265RtpSessionManager&) = delete;
+  H265RtpSessionManager(H265RtpSessionManager&&) = delete;
+  H265RtpSessionManager& operator=(const H265RtpSessionManager&) = delete;
+  H265RtpSessionManager& operator=(H265RtpSessionManager&&) = delete;
+
+  // Route a batch of RTP packets (one packet per segment) to their
+  // sessions. Thread-safe. `now_ms` is any monotonic clock.
+  void ProcessPackets(const BufferSegment* packets, size_t num_packets,
+                      int64_t now_ms) noexcept;
+  // Route a single RTP packet. Returns false if the packet was rejected.
+  bool ProcessPacket(const uint8_t* data, size_t length,
+                     int64_t now_ms) noexcept;
+
+  // Flush and evict the sessions idle since before `now_ms -
+  // idle_timeout_ms`. Returns the number of evicted sessions.
+  size_t EvictIdleSessions(int64_t now_ms) noexcept;
+  // Flush and remove a session. Returns false if there is no such session.
+  bool RemoveSession(uint32_t ssrc) noexcept;
+
+  // Get a snapshot of a session state. Returns false if there is no such
+  // session.
+  bool GetSessionStats(uint32_t ssrc, SessionStats* session_stats) const
+      noexcept;
+  size_t GetNumSessions() const noexcept { return num_sessions.load(); }
+  size_t GetTotalBytes() const noexcept { return total_bytes.load(); }
+  Stats GetStats() const noexcept;
+
+ private:
+  struct Session;
+  struct Shard;
+
+  size_t GetShardIndex(uint32_t ssrc) const noexcept;
+  // Process a packet with the shard lock held.
+  bool ProcessPacketLocked(Shard* shard, uint32_t ssrc, const uint8_t* data,
+                           size_t length, int64_t now_ms) noexcept;
+  // Evict a session with the shard lock held.
+  void EvictLocked(Shard* shard, uint32_t ssrc) noexcept;
+  // Evict the least recently used session in the shard (other than
+  // `keep_ssrc`, the session of the current packet). Returns false if
+  // there is none.
+  bool EvictLruLocked(Shard* shard, uint32_t keep_ssrc) noexcept;
+  // Update the memory accounting of a session (and its shard).
+  void UpdateMemoryLocked(Shard* shard, Session* session) noexcept;
+
+  Options options;
+  Callback callback;
+  void* opaque;
+
+  std::vector<std::unique_ptr<Shard>> shards;
+  std::atomic<size_t> num_sessions;
+  std::atomic<size_t> total_bytes;
+
+  // stats
+  std::atomic<uint64_t> packets;
+  std::atomic<uint64_t> packets_rejected;
+  std::atomic<uint64_t> sessions_created;
+  std::atomic<uint64_t> sessions_evicted_idle;
+  std::atomic<uint64_t> sessions_evicted_memory;
+  std::atomic<uint64_t> sessions_evicted_count;
+  std::atomic<uint64_t> session_resets;
+};
+
+}  // namespace h265nal
@@ -11,6 +11,7 @@
 #include "h265_bitstream_parser_state.h"
 #include "h265_common.h"
 #include "h265_nal_unit_parser.h"
+#include "h265_rtp_don.h"
 #include "rtc_common.h"
 
 namespace h265nal {
@@ -35,6 +36,9 @@ class H265RtpSingleParser {
 
     std::unique_ptr<struct H265NalUnitHeaderParser::NalUnitHeaderState>
         nal_unit_header;
+    // decoding order number (only when sprop-max-don-diff > 0)
+    bool don_present = false;
+    uint32_t donl = 0;
     std::unique_ptr<struct H265NalUnitPayloadParser::NalUnitPayloadState>
         nal_unit_payload;
   };
@@ -46,6 +50,15 @@ class H265RtpSingleParser {
   static std::unique_ptr<RtpSingleState> ParseRtpSingle(
       BitBuffer* bit_buffer,
       struct H265BitstreamParserState* bitstream_parser_state) noexcept;
+  // DON-aware versions.
+  static std::unique_ptr<RtpSingleState> ParseRtpSingle(
+      const uint8_t* data, size_t length,
+      struct H265BitstreamParserState* bitstream_parser_state,
+      const RtpDonParameters& don_parameters) noexcept;
+  static std::unique_ptr<RtpSingleState> ParseRtpSingle(
+      BitBuffer* bit_buffer,
+      struct H265BitstreamParserState* bitstream_parser_state,
+      const RtpDonParameters& don_parameters) noexcept;
 };
 
 }  // namespace h265nal
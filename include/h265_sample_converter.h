@@ -0,0 +1,60 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_common.h"
+
+namespace h265nal {
+
+// A class for converting samples between the Annex B byte stream format
+// (start codes) and the length-prefixed format used by ISO BMFF (mp4) and
+// Matroska, where each NAL unit follows a big-endian length field of
+// `length_size` (lengthSizeMinusOne + 1 in the hvcC) bytes.
+//
+// Each conversion comes in two flavours:
+// * a zero-copy one, which returns the converted sample as a list of
+//   `BufferSegment`s pointing into the input sample (plus small buffers
+//   for the length fields or start codes), ready for a gather write.
+// * an in-place one, which rewrites the sample in its own buffer.
+//
+// The trailing_zero_8bits after each NAL unit of an Annex B stream are
+// dropped. NAL units are not unescaped: both formats use escaped NAL units.
+class H265SampleConverter {
+ public:
+  // Annex B to length-prefixed, zero-copy. Two segments are produced per
+  // NAL unit: its length field (in `length_fields`, which is resized) and
+  // its data (in `data`). Returns false if a NAL unit is too large for the
+  // length field.
+  static bool AnnexBToLengthPrefixed(
+      const uint8_t* data, size_t length, size_t length_size,
+      std::vector<uint8_t>* length_fields,
+      std::vector<BufferSegment>* segments) noexcept;
+  // Annex B to length-prefixed, in place. `length` is updated with the new
+  // sample length. Returns false (and leaves the sample untouched) if the
+  // converted sample does not fit in place, i.e. if the start codes are
+  // shorter than the length fields (e.g. 3-byte start codes with 4-byte
+  // length fields).
+  static bool AnnexBToLengthPrefixedInPlace(uint8_t* data, size_t* length,
+                                            size_t length_size) noexcept;
+
+  // Length-prefixed to Annex B, zero-copy. Two segments are produced per
+  // NAL unit: a (static) 4-byte start code, and its data. Returns false if
+  // the sample is truncated.
+  static bool LengthPrefixedToAnnexB(
+      const uint8_t* data, size_t length, size_t length_size,
+      std::vector<BufferSegment>* segments) noexcept;
+  // Length-prefixed to Annex B, in place (4-byte length fields are replaced
+  // by 4-byte start codes). Returns false (and leaves the sample untouched)
+  // if the length fields are not 4 bytes, or if the sample is truncated.
+  static bool LengthPrefixedToAnnexBInPlace(uint8_t* data, size_t length,
+                                            size_t length_size) noexcept;
+};
+
+}  // namespace h265nal
@@ -0,0 +1,149 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+
+namespace h265nal {
+
+// A segmenter of Annex B streams, e.g. for packaging: it cuts a stream into
+// segments that start at IRAP pictures, once a target duration or size is
+// reached.
+//
+// Each segment is made self-contained: the current VPSs, SPSs and PPSs are
+// injected at its start (after the AUD, if any), except the ones already
+// present in its first access unit. The parameter sets are also parsed into
+// a bitstream parser state (the SPS VUI timing information gives the
+// picture duration), and an hvcC can be written for each segment.
+//
+// The stream is read in one pass (no NAL unit index), and each segment is
+// returned as soon as the next one starts. A segment is a list of spans:
+// ranges of the input (a memory-mapped file with ProcessFile(), so they can
+// be written with sendfile() or from the mapping) and the injected
+// parameter sets.
+class H265Segmenter {
+ public:
+  struct Options {
+    Options()
+        : target_duration_ms(2000),
+          target_size(0),
+          frames_per_second(30),
+          add_hvcc(false) {}
+    // start a new segment at the first IRAP picture after this duration
+    // (0 means no duration target)
+    uint32_t target_duration_ms;
+    // ... or after this size, in bytes (0 means no size target). With no
+    // target at all, every IRAP picture starts a segment.
+    size_t target_size;
+    // picture rate, when the SPS has no VUI timing information
+    uint32_t frames_per_second;
+    // write an hvcC (from the current parameter sets) for each segment
+    bool add_hvcc;
+  };
+
+  // A segment. The spans and the hvcC are valid during the callback.
+  struct Segment {
+    uint64_t index;
+    // pictures (access units)
+    uint64_t first_picture;
+    uint64_t num_pictures;
+    // in nanoseconds, from the picture duration
+    uint64_t start_time_ns;
+    uint64_t duration_ns;
+    // whether the segment starts with an IRAP picture (only the first
+    // segment may not)
+    bool starts_with_irap;
+    // input range of the segment
+    size_t offset;
+    size_t length;
+    // segment contents (Annex B): the input range, and the injected
+    // parameter sets
+    std::vector<BufferSegment> spans;
+    // hvcC (empty unless `Options::add_hvcc` is set)
+    std::vector<uint8_t> hvcc;
+  };
+  typedef void (*Callback)(const Segment& segment, void* opaque);
+
+  struct Stats {
+    uint64_t nal_units = 0;
+    uint64_t pictures = 0;
+    uint64_t segments = 0;
+    uint64_t parameter_sets_injected = 0;
+  };
+
+  // `bitstream_parser_state` gets the parsed parameter sets (and may
+  // already have some, e.g. from an hvcC).
+  H265Segmenter(const Options& options,
+                H265BitstreamParserState* bitstream_parser_state);
+  ~H265Segmenter() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265Segmenter(const H265Segmenter&) = delete;
+  H265Segmenter(H265Segmenter&&) = delete;
+  H265Segmenter& operator=(const H265Segmenter&) = delete;
+  H265Segmenter& operator=(H265Segmenter&&) = delete;
+
+  // Segment an Annex B buffer, calling `callback` for each segment.
+  void Process(const uint8_t* data, size_t length, Callback callback,
+               void* opaque) noexcept;
+  // Same, with a memory-mapped file. Returns false if the file cannot be
+  // read.
+  bool ProcessFile(const char* filename, Callback callback,
+                   void* opaque) noexcept;
+
+  const Stats& GetStats() const { return stats; }
+
+ private:
+  void ProcessNalUnit(size_t offset, const uint8_t* nal_unit,
+                      size_t length) noexcept;
+  void UpdateParameterSet(uint32_t nal_unit_type, const uint8_t* nal_unit,
+                          size_t length) noexcept;
+  // Start a segment at the current access unit.
+  void StartSegment(uint64_t start_time_ns) noexcept;
+  void WriteHvcc() noexcept;
+  // Emit the current segment, up to `end`.
+  void EmitSegment(size_t end, uint64_t end_time_ns) noexcept;
+
+  Options options;
+  H265BitstreamParserState* bitstream_parser_state;
+  Stats stats;
+
+  // last parameter sets (NAL units), by type and id
+  std::map<std::pair<uint32_t, uint32_t>, std::vector<uint8_t>>
+      parameter_sets;
+  // picture duration, from the SPS VUI (0 means from the options)
+  uint64_t picture_duration_ns = 0;
+
+  // current input
+  const uint8_t* data = nullptr;
+  Callback callback = nullptr;
+  void* opaque = nullptr;
+
+  // current access unit
+  size_t au_start = 0;
+  bool au_has_vcl = false;
+  // first NAL unit of the access unit: AUD, and its end
+  bool au_starts_with_aud = false;
+  size_t au_first_nal_unit_end = 0;
+  // parameter sets (type and id) in the access unit
+  std::vector<std::pair<uint32_t, uint32_t>> au_parameter_sets;
+
+  // current segment
+  Segment segment;
+  // injected parameter sets (Annex B), and the AUD placed before them
+  std::vector<uint8_t> segment_prefix;
+  size_t segment_aud_length = 0;
+  // start time of the next picture
+  uint64_t time_ns = 0;
+};
+
+}  // namespace h265nal
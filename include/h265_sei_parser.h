@@ -473,4 +473,38 @@ class H265SeiMessageParser {
       const uint8_t* data, size_t length) noexcept;
 };
 
+// Walk the sei_message()s of a SEI RBSP (Section 7.3.5) without parsing
+// their payloads, e.g. to find or to remove some of them. The walk stops at
+// the rbsp_trailing_bits(): the last non-zero byte of the RBSP
+// (more_rbsp_data(), Section 7.2). Any byte before it, including 0x80 (e.g.
+// payloadType 128), is SEI message data.
+class H265SeiMessageIterator {
+ public:
+  struct SeiMessage {
+    uint32_t payload_type;
+    size_t payload_size;
+    // RBSP offsets of the sei_message() and of its payload
+    size_t offset;
+    size_t payload_offset;
+  };
+
+  H265SeiMessageIterator(const uint8_t* rbsp, size_t length) noexcept;
+
+  // Get the next SEI message. Returns false after the last one, or if the
+  // next one is invalid (truncated).
+  bool Next(SeiMessage* sei_message) noexcept;
+  // Whether the walk stopped at an invalid SEI message.
+  bool IsInvalid() const { return invalid; }
+
+ private:
+  // Read a payloadType or payloadSize value (0xff bytes, then a last byte).
+  bool ReadValue(size_t* value) noexcept;
+
+  const uint8_t* rbsp;
+  size_t length;
+  size_t offset = 0;
+  size_t trailing_bits_offset;
+  bool invalid = false;
+};
+
 }  // namespace h265nal
@@ -10,6 +10,7 @@
 #include <vector>
 
 #include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
 #include "h265_pps_parser.h"
 #include "h265_pred_weight_table_parser.h"
 #include "h265_sps_parser.h"
@@ -147,6 +148,12 @@ class H265SliceSegmentLayerParser {
   // The parsed state of the slice. Only some select values are stored.
   // Add more as they are actually needed.
   struct SliceSegmentLayerState {
+    // A slice segment data subset (Section 7.4.7.1), in the escaped buffer.
+    struct Substream {
+      size_t offset;
+      size_t length;
+    };
+
     SliceSegmentLayerState() = default;
     ~SliceSegmentLayerState() = default;
     // disable copy ctor, move ctor, and copy&move assignments
@@ -159,6 +166,18 @@ class H265SliceSegmentLayerParser {
     void fdump(FILE* outfp, int indent_level) const;
 #endif  // FDUMP_DEFINE
 
+    // Set the escaped offsets and the substreams from the escaped buffer
+    // that was unescaped for parsing. Until then, the buffer is assumed to
+    // have no emulation prevention bytes.
+    void MapEscapedOffsets(const uint8_t* data, size_t length) noexcept;
+    void MapEscapedOffsets(const BufferSegment* segments,
+                           size_t num_segments) noexcept;
+    // Slice segment data subsets, as set by entry_point_offset_minus1 (one
+    // if there are no entry points), in the escaped buffer. The last one
+    // runs to the end of the buffer. Returns false if the entry points do
+    // not fit in the buffer.
+    bool GetSubstreams(std::vector<Substream>* substreams) const noexcept;
+
     // input parameters
     uint32_t nal_unit_type = 0;
 
@@ -168,6 +187,22 @@ class H265SliceSegmentLayerParser {
         slice_segment_header;
     // slice_segment_data()
     // rbsp_slice_segment_trailing_bits()
+
+    // slice_segment_data() location, e.g. for a hardware decoder. Offsets
+    // are in bytes from the start of the parsed buffer (the NAL unit header
+    // when parsed as a NAL unit), either in the RBSP or in the escaped
+    // buffer (emulation prevention bytes included).
+    // end of slice_segment_header(), before byte_alignment()
+    size_t header_end_rbsp_offset = 0;
+    size_t header_end_offset = 0;
+    size_t header_end_bit_offset = 0;
+    // start of slice_segment_data()
+    size_t slice_segment_data_rbsp_offset = 0;
+    size_t slice_segment_data_offset = 0;
+    // emulation prevention bytes before slice_segment_data()
+    size_t num_emulation_prevention_bytes = 0;
+    // escaped bytes from slice_segment_data() to the end of the buffer
+    size_t slice_segment_data_length = 0;
   };
 
   // Unpack RBSP and parse slice state from the supplied buffer.
@@ -0,0 +1,106 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_nal_filter.h"
+
+namespace h265nal {
+
+// A splicer for Annex B streams, e.g. to insert ads into program content,
+// that keeps the parameter set ids of the spliced streams from colliding.
+//
+// Each input buffer belongs to a stream (identified by the caller). The
+// splicer maps the SPS and PPS ids of each stream to output ids that no
+// other stream uses: an id is kept when it is free, and moved to the
+// lowest free one otherwise. The renumbered SPSs and PPSs are written
+// again (H265ParameterSetWriter), and the slices referring to a renumbered
+// PPS get their slice_pic_parameter_set_id rewritten: the rest of the
+// slice segment header is bit-shifted, the byte_alignment() redone, and
+// the slice segment data copied as is (it is never decoded). All other NAL
+// units (including the VPSs) pass unchanged.
+//
+// A stream resumed after a splice (e.g. the program after an ad) keeps its
+// ids, so it does not need to resend its parameter sets. The NAL units that
+// cannot be mapped (e.g. slices whose PPS has not been seen, or parameter
+// sets when all the ids are taken) are dropped.
+//
+// The input is read in a single pass. As with H265NalFilter, the output is
+// a list of spans pointing into the input buffer (the unchanged NAL units)
+// and into buffers owned by the splicer (the rewritten ones), valid until
+// the next Splice() call.
+class H265Splicer {
+ public:
+  struct Stats {
+    uint64_t parameter_sets_renumbered = 0;
+    uint64_t slices_rewritten = 0;
+    uint64_t nal_units_dropped = 0;
+  };
+
+  H265Splicer();
+  ~H265Splicer() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265Splicer(const H265Splicer&) = delete;
+  H265Splicer(H265Splicer&&) = delete;
+  H265Splicer& operator=(const H265Splicer&) = delete;
+  H265Splicer& operator=(H265Splicer&&) = delete;
+
+  // Splice an Annex B buffer of stream `stream_id` at the end of the
+  // output. The output spans are appended to `spans`. Returns the output
+  // size.
+  size_t Splice(uint32_t stream_id, const uint8_t* data, size_t length,
+                std::vector<BufferSegment>* spans) noexcept;
+  // Forget a stream that will not be resumed, releasing its ids.
+  void RemoveStream(uint32_t stream_id) noexcept;
+
+  // Output id of a stream SPS/PPS id. Returns false if it is not mapped.
+  bool GetSpsId(uint32_t stream_id, uint32_t sps_id,
+                uint32_t* output_sps_id) const noexcept;
+  bool GetPpsId(uint32_t stream_id, uint32_t pps_id,
+                uint32_t* output_pps_id) const noexcept;
+
+  const Stats& GetStats() const { return stats; }
+
+ private:
+  // A spliced stream.
+  struct Stream {
+    // parameter sets, by (stream) id
+    H265BitstreamParserState bitstream_parser_state;
+    // stream id to output id
+    std::map<uint32_t, uint32_t> sps_ids;
+    std::map<uint32_t, uint32_t> pps_ids;
+  };
+
+  static bool SpliceStage(H265NalFilter::NalUnit* nal_unit,
+                          H265NalFilter* filter, void* opaque);
+  bool RenumberSps(H265NalFilter::NalUnit* nal_unit) noexcept;
+  bool RenumberPps(H265NalFilter::NalUnit* nal_unit) noexcept;
+  bool RewriteSlice(H265NalFilter::NalUnit* nal_unit) noexcept;
+  // Map a stream id (`ids`), picking an output id not used by the other
+  // streams (`owners`, output id to stream). Returns false if none is left.
+  bool MapId(uint32_t id, uint32_t max_id, std::map<uint32_t, uint32_t>* ids,
+             std::map<uint32_t, uint32_t>* owners) noexcept;
+
+  H265NalFilter filter;
+  std::map<uint32_t, Stream> streams;
+  // output id to stream
+  std::map<uint32_t, uint32_t> sps_owners;
+  std::map<uint32_t, uint32_t> pps_owners;
+  // current stream
+  uint32_t stream_id = 0;
+  Stream* stream = nullptr;
+  std::vector<uint8_t> rbsp_buffer;
+  std::vector<uint8_t> slice_buffer;
+  Stats stats;
+};
+
+}  // namespace h265nal
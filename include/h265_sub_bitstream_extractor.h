@@ -0,0 +1,97 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+
+namespace h265nal {
+
+// The sub-bitstream extraction process (Section 10), e.g. to derive lower
+// frame rate variants of a stream without re-encoding it.
+//
+// Keeps the NAL units with TemporalId <= tIdTarget and a nuh_layer_id in
+// the target layer set (TargetDecLayerIdList, from the VPS
+// layer_id_included_flag). When the extraction drops temporal sub-layers,
+// the non-nested buffering period, picture timing, and decoding unit info
+// SEI messages (whose HRD parameters describe the full bitstream) are
+// dropped too. Parameter sets follow the general rule (e.g. PPSs with a
+// TemporalId above the target are dropped).
+//
+// The extraction works over the NAL unit index and the NAL unit headers:
+// only VPSs and SEIs are parsed. The output is a list of spans pointing
+// into the input buffer (consecutive NAL units are merged into a single
+// span), so producing the sub-bitstream costs at most one copy.
+//
+// The layer set and the number of sub-layers come from the last VPS seen.
+// An extractor keeps that state across calls, so a stream can be extracted
+// in chunks (of whole NAL units).
+class H265SubBitstreamExtractor {
+ public:
+  static constexpr uint32_t kMaxTemporalId = 6;
+
+  struct Options {
+    Options() : target_temporal_id(kMaxTemporalId), layer_set_idx(0) {}
+    // tIdTarget
+    uint32_t target_temporal_id;
+    // target layer set (0 is the base layer)
+    uint32_t layer_set_idx;
+  };
+
+  struct Stats {
+    uint64_t nal_units = 0;
+    uint64_t nal_units_removed = 0;
+    // SEI NAL units removed because of their HRD SEI messages
+    uint64_t sei_removed = 0;
+  };
+
+  explicit H265SubBitstreamExtractor(const Options& options);
+  ~H265SubBitstreamExtractor() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265SubBitstreamExtractor(const H265SubBitstreamExtractor&) = delete;
+  H265SubBitstreamExtractor(H265SubBitstreamExtractor&&) = delete;
+  H265SubBitstreamExtractor& operator=(const H265SubBitstreamExtractor&) =
+      delete;
+  H265SubBitstreamExtractor& operator=(H265SubBitstreamExtractor&&) = delete;
+
+  // Extract the sub-bitstream of an Annex B buffer. The spans (start codes
+  // included) are appended to `spans`. Returns the sub-bitstream size.
+  size_t Extract(const uint8_t* data, size_t length,
+                 std::vector<BufferSegment>* spans) noexcept;
+  // Same, with the NAL unit index of the buffer (from
+  // `H265BitstreamParser::FindNaluIndices()`).
+  size_t Extract(
+      const uint8_t* data, size_t length,
+      const std::vector<H265BitstreamParser::NaluIndex>& nalu_indices,
+      std::vector<BufferSegment>* spans) noexcept;
+
+  // Decide whether to keep a NAL unit (no start code, NAL unit header
+  // included).
+  bool KeepNalUnit(const uint8_t* data, size_t length) noexcept;
+
+  // nuh_layer_id values of the target layer set (bitmask).
+  uint64_t GetTargetLayerIds() const { return target_layer_ids; }
+  const Stats& GetStats() const { return stats; }
+
+ private:
+  void UpdateVps(const uint8_t* data, size_t length) noexcept;
+  bool HasHrdSeiMessage(const uint8_t* data, size_t length) noexcept;
+
+  Options options;
+  Stats stats;
+  // TargetDecLayerIdList (bitmask of nuh_layer_id values)
+  uint64_t target_layer_ids = 1;
+  // vps_max_sub_layers_minus1 of the last VPS
+  uint32_t max_temporal_id = kMaxTemporalId;
+  // SEI RBSP buffer
+  std::vector<uint8_t> rbsp_buffer;
+};
+
+}  // namespace h265nal
@@ -0,0 +1,92 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+
+#include "h265_common.h"
+#ifdef RTP_DEFINE
+#include "h265_rtp_classifier.h"
+#endif  // RTP_DEFINE
+
+namespace h265nal {
+
+// A temporal layer (TemporalId) selector, for forwarding a subset of the
+// temporal layers of a stream (e.g. a lower frame rate per receiver in an
+// SFU) without rewriting it.
+//
+// The switcher decides, for each NAL unit (Annex B) or RTP packet, whether
+// to forward or drop it. Lowering the target takes effect immediately (the
+// rest of the current picture is still forwarded, so that no picture is
+// cut in half). Raising the target is pending until a switching point
+// (Section 7.4.2.2):
+//   * an IRAP picture: switch up to the target,
+//   * a TSA picture with TemporalId = current + 1: switch up to the target,
+//   * an STSA picture with TemporalId = current + 1: switch up one layer.
+//
+// The switcher assumes that its input is the full stream, in decoding
+// order, and that it sees every NAL unit forwarded to the receiver.
+class H265TemporalLayerSwitcher {
+ public:
+  static constexpr uint32_t kMaxTemporalId = 6;
+
+  struct Stats {
+    uint64_t forwarded = 0;
+    uint64_t dropped = 0;
+    uint64_t switches_up = 0;
+    uint64_t switches_down = 0;
+  };
+
+  explicit H265TemporalLayerSwitcher(
+      uint32_t target_temporal_id = kMaxTemporalId);
+  ~H265TemporalLayerSwitcher() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265TemporalLayerSwitcher(const H265TemporalLayerSwitcher&) = delete;
+  H265TemporalLayerSwitcher(H265TemporalLayerSwitcher&&) = delete;
+  H265TemporalLayerSwitcher& operator=(const H265TemporalLayerSwitcher&) =
+      delete;
+  H265TemporalLayerSwitcher& operator=(H265TemporalLayerSwitcher&&) = delete;
+
+  // Set the highest TemporalId to forward (clamped to kMaxTemporalId).
+  void SetTargetTemporalId(uint32_t target_temporal_id) noexcept;
+
+  // Decide whether to forward a NAL unit (no start code, NAL unit header
+  // included). Returns true if the NAL unit must be forwarded.
+  bool ProcessNalUnit(const uint8_t* data, size_t length) noexcept;
+  // Same, from the NAL unit header fields, plus the
+  // first_slice_segment_in_pic_flag of slice segments.
+  bool ProcessNalUnit(uint32_t nal_unit_type, uint32_t temporal_id,
+                      bool first_slice_segment_in_pic_flag) noexcept;
+#ifdef RTP_DEFINE
+  // Decide whether to forward an RTP packet. An AP is forwarded (as a
+  // whole) if its lowest TemporalId is forwarded.
+  bool ProcessRtpPacket(const RtpPacketDescriptor& descriptor) noexcept;
+#endif  // RTP_DEFINE
+
+  // Highest TemporalId being forwarded.
+  uint32_t GetCurrentTemporalId() const { return current_temporal_id; }
+  uint32_t GetTargetTemporalId() const { return target_temporal_id; }
+  // The target is higher than the current layer (waiting for a switching
+  // point).
+  bool IsSwitchPending() const {
+    return target_temporal_id > current_temporal_id;
+  }
+  const Stats& GetStats() const { return stats; }
+
+ private:
+  bool Decide(uint32_t nal_unit_type, uint32_t temporal_id,
+              bool first_slice_segment_in_pic_flag) noexcept;
+
+  uint32_t target_temporal_id;
+  uint32_t current_temporal_id;
+  // decision for the current picture (applied to its remaining slices)
+  bool in_picture = false;
+  bool picture_forwarded = false;
+  Stats stats;
+};
+
+}  // namespace h265nal
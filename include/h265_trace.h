@@ -0,0 +1,157 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+
+#include "rtc_common.h"
+
+namespace h265nal {
+
+// Syntax element descriptors (Section 7.2).
+enum TraceDescriptor : uint8_t {
+  TraceDescriptor_f = 0,   // fixed-pattern bit string
+  TraceDescriptor_u = 1,   // unsigned integer using n bits
+  TraceDescriptor_b = 2,   // byte having any pattern of bit string
+  TraceDescriptor_ue = 3,  // unsigned integer 0-th order Exp-Golomb
+  TraceDescriptor_se = 4,  // signed integer 0-th order Exp-Golomb
+};
+
+// A trace policy receives a callback for every syntax element read by the
+// parsers. A policy is a class with the following static members:
+//
+//   static constexpr bool kEnabled;
+//   static void NalUnit(uint32_t nal_unit_type);
+//   static void SyntaxElement(const char* name, uint64_t i, uint64_t j,
+//                             TraceDescriptor descriptor, size_t bit_offset,
+//                             size_t bit_count, int64_t value);
+//
+// `bit_offset` is the offset of the first bit of the syntax element, counted
+// from the start of the (unescaped) buffer being parsed. `i` and `j` are the
+// element subscripts (kNoIndex when the element is not an array).
+
+// The default (no-op) trace policy. Everything compiles out.
+struct H265NullTracePolicy {
+  static constexpr bool kEnabled = false;
+  static void NalUnit(uint32_t /* nal_unit_type */) {}
+  static void SyntaxElement(const char* /* name */, uint64_t /* i */,
+                            uint64_t /* j */, TraceDescriptor /* descriptor */,
+                            size_t /* bit_offset */, size_t /* bit_count */,
+                            int64_t /* value */) {}
+};
+
+// A trace policy producing output compatible with ffmpeg's `trace_headers`
+// bitstream filter (`ffmpeg -bsf:v trace_headers`), minus the log prefix.
+struct H265TraceHeadersPolicy {
+  static constexpr bool kEnabled = true;
+  // Output file (default: stderr).
+  static void SetOutput(FILE* outfp);
+  static void NalUnit(uint32_t nal_unit_type);
+  static void SyntaxElement(const char* name, uint64_t i, uint64_t j,
+                            TraceDescriptor descriptor, size_t bit_offset,
+                            size_t bit_count, int64_t value);
+};
+
+// Front-end used by the parsers. It converts each read into a policy
+// callback, calculating the bit offset and the bit count of the element.
+// Calls must be placed right after the corresponding read.
+template <typename Policy>
+class H265SyntaxTracer {
+ public:
+  static constexpr uint64_t kNoIndex = UINT64_MAX;
+
+  // Called before parsing a NAL unit header.
+  static void nal_unit(BitBuffer* bit_buffer) {
+    if (!Policy::kEnabled) {
+      return;
+    }
+    uint32_t nal_unit_header;
+    if (bit_buffer->PeekBits(16, nal_unit_header)) {
+      Policy::NalUnit((nal_unit_header >> 9) & 0x3f);
+    }
+  }
+
+  // f(n)
+  static void f(BitBuffer* bit_buffer, const char* name, size_t bit_count,
+                uint64_t value, uint64_t i = kNoIndex,
+                uint64_t j = kNoIndex) {
+    Trace(bit_buffer, name, i, j, TraceDescriptor_f, bit_count,
+          static_cast<int64_t>(value));
+  }
+  // u(n)/u(v)
+  static void u(BitBuffer* bit_buffer, const char* name, size_t bit_count,
+                uint64_t value, uint64_t i = kNoIndex,
+                uint64_t j = kNoIndex) {
+    Trace(bit_buffer, name, i, j, TraceDescriptor_u, bit_count,
+          static_cast<int64_t>(value));
+  }
+  // b(8)
+  static void b(BitBuffer* bit_buffer, const char* name, size_t bit_count,
+                uint64_t value, uint64_t i = kNoIndex,
+                uint64_t j = kNoIndex) {
+    Trace(bit_buffer, name, i, j, TraceDescriptor_b, bit_count,
+          static_cast<int64_t>(value));
+  }
+  // ue(v)
+  static void ue(BitBuffer* bit_buffer, const char* name, uint32_t value,
+                 uint64_t i = kNoIndex, uint64_t j = kNoIndex) {
+    if (!Policy::kEnabled) {
+      return;
+    }
+    Trace(bit_buffer, name, i, j, TraceDescriptor_ue,
+          GolombBitCount(static_cast<uint64_t>(value) + 1), value);
+  }
+  // se(v)
+  static void se(BitBuffer* bit_buffer, const char* name, int32_t value,
+                 uint64_t i = kNoIndex, uint64_t j = kNoIndex) {
+    if (!Policy::kEnabled) {
+      return;
+    }
+    // Table 9-3: k > 0 maps to 2k - 1, and k <= 0 maps to -2k
+    uint64_t code_num = (value > 0)
+                            ? (2 * static_cast<uint64_t>(value) - 1)
+                            : (2 * static_cast<uint64_t>(-(int64_t)value));
+    Trace(bit_buffer, name, i, j, TraceDescriptor_se,
+          GolombBitCount(code_num + 1), value);
+  }
+
+ private:
+  static size_t GolombBitCount(uint64_t code_num_plus1) {
+    size_t bit_count = 0;
+    while (code_num_plus1 != 0) {
+      bit_count++;
+      code_num_plus1 >>= 1;
+    }
+    return 2 * bit_count - 1;
+  }
+
+  static void Trace(BitBuffer* bit_buffer, const char* name, uint64_t i,
+                    uint64_t j, TraceDescriptor descriptor, size_t bit_count,
+                    int64_t value) {
+    if (!Policy::kEnabled) {
+      return;
+    }
+    size_t byte_offset, bit_offset;
+    bit_buffer->GetCurrentOffset(&byte_offset, &bit_offset);
+    size_t end_bit_offset = byte_offset * 8 + bit_offset;
+    Policy::SyntaxElement(name, i, j, descriptor, end_bit_offset - bit_count,
+                          bit_count, value);
+  }
+};
+
+template <typename Policy>
+constexpr uint64_t H265SyntaxTracer<Policy>::kNoIndex;
+
+// The tracer used by the parsers. Build with TRACE_DEFINE (cmake
+// -DH265NAL_TRACE=ON) to get trace_headers-compatible output.
+#ifdef TRACE_DEFINE
+typedef H265SyntaxTracer<H265TraceHeadersPolicy> H265Trace;
+#else
+typedef H265SyntaxTracer<H265NullTracePolicy> H265Trace;
+#endif  // TRACE_DEFINE
+
+}  // namespace h265nal
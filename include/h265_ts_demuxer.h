@@ -0,0 +1,158 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_common.h"
+
+namespace h265nal {
+
+// An MPEG-2 transport stream (ISO/IEC 13818-1) demuxer for H.265 video
+// (stream_type 0x24).
+//
+// Takes the stream in chunks of any size (e.g. a memory-mapped file, or
+// reads from stdin), finds the H.265 elementary streams through the
+// PAT/PMT, reassembles their PES packets, and emits each PES payload (an
+// Annex B access unit, as per ISO/IEC 13818-1 Section 2.17) with its
+// PTS/DTS through a callback. Feed it to `H265BitstreamParser::
+// ParseBitstream()`.
+//
+// Full packets are read in place: only the PES (and PSI) payloads are
+// copied, into reusable buffers, so after warm-up the demuxer does not
+// allocate. Packets split across chunks are carried over, and the
+// demuxer re-synchronizes on the sync bytes after garbage.
+//
+// Continuity counter errors (lost packets) and packets with the
+// transport_error_indicator set drop the PES packet being reassembled, and
+// flag the next access unit of the elementary stream with `after_loss`.
+class H265TsDemuxer {
+ public:
+  static constexpr size_t kPacketSize = 188;
+  // ISO/IEC 13818-1 Table 2-34
+  static constexpr uint32_t kStreamTypeHevc = 0x24;
+
+  struct Options {
+    Options() : program_number(0), pid(0), max_pes_size(1 << 24) {}
+    // only use this program (0 means the first program in the PAT)
+    uint32_t program_number;
+    // only use this elementary stream PID (0 means all the H.265 streams
+    // of the program)
+    uint32_t pid;
+    // maximum size of a PES packet payload (larger ones are dropped)
+    size_t max_pes_size;
+  };
+
+  // An access unit (a PES packet payload). `data` is only valid during the
+  // callback.
+  struct AccessUnit {
+    uint32_t pid;
+    // timestamps (90 kHz clock, 33 bits). The DTS is equal to the PTS when
+    // not present in the PES header.
+    bool has_pts;
+    uint64_t pts;
+    uint64_t dts;
+    // random_access_indicator of the first packet
+    bool random_access;
+    // first access unit after a loss
+    bool after_loss;
+    // Annex B data
+    const uint8_t* data;
+    size_t length;
+  };
+  typedef void (*Callback)(const AccessUnit& access_unit, void* opaque);
+
+  struct Stats {
+    uint64_t packets = 0;
+    // bytes skipped to find the sync byte
+    uint64_t bytes_skipped = 0;
+    // packets with the transport_error_indicator set, or invalid
+    uint64_t packets_invalid = 0;
+    // continuity counter errors in the H.265 elementary streams
+    uint64_t continuity_errors = 0;
+    // PSI sections with a CRC error
+    uint64_t sections_invalid = 0;
+    uint64_t access_units = 0;
+    // PES packets dropped (invalid, too large, or incomplete after a loss)
+    uint64_t access_units_dropped = 0;
+  };
+
+  H265TsDemuxer(const Options& options, Callback callback, void* opaque);
+  ~H265TsDemuxer() = default;
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265TsDemuxer(const H265TsDemuxer&) = delete;
+  H265TsDemuxer(H265TsDemuxer&&) = delete;
+  H265TsDemuxer& operator=(const H265TsDemuxer&) = delete;
+  H265TsDemuxer& operator=(H265TsDemuxer&&) = delete;
+
+  // Add a chunk of the transport stream.
+  void AddData(const uint8_t* data, size_t length) noexcept;
+  // Emit the access units still being reassembled (e.g. at the end of the
+  // stream).
+  void Flush() noexcept;
+  // Demux a whole file (memory-mapped, or read from stdin if `filename` is
+  // "-"), and flush. Returns false if the file cannot be read.
+  bool ProcessFile(const char* filename) noexcept;
+
+  // PIDs of the H.265 elementary streams found in the PMT.
+  std::vector<uint32_t> GetPids() const noexcept;
+  const Stats& GetStats() const { return stats; }
+
+ private:
+  // A PSI (PAT/PMT) section being reassembled.
+  struct Section {
+    uint32_t table_id = 0;
+    std::vector<uint8_t> buffer;
+    bool active = false;
+  };
+  // An H.265 elementary stream.
+  struct Stream {
+    uint32_t pid = 0;
+    int32_t continuity_counter = -1;
+    // PES packet being reassembled
+    std::vector<uint8_t> pes;
+    bool pes_active = false;
+    bool random_access = false;
+    bool after_loss = false;
+  };
+
+  void ProcessPacket(const uint8_t* packet) noexcept;
+  void ProcessSectionPayload(Section* section, bool unit_start,
+                             const uint8_t* payload, size_t length) noexcept;
+  // Append section bytes. Returns the number of bytes used.
+  size_t AppendSection(Section* section, const uint8_t* data,
+                       size_t length) noexcept;
+  void ProcessSection(const Section& section) noexcept;
+  void ProcessPat(const uint8_t* section, size_t length) noexcept;
+  void ProcessPmt(const uint8_t* section, size_t length) noexcept;
+  void ProcessPesPayload(Stream* stream, bool unit_start, bool random_access,
+                         const uint8_t* payload, size_t length) noexcept;
+  void EmitPes(Stream* stream) noexcept;
+  void SignalLoss(Stream* stream) noexcept;
+  Stream* GetStream(uint32_t pid) noexcept;
+
+  Options options;
+  Callback callback;
+  void* opaque;
+  Stats stats;
+
+  // PSI
+  uint32_t pmt_pid = 0;
+  bool has_pmt_pid = false;
+  uint32_t program_number = 0;
+  int32_t pmt_version = -1;
+  Section pat_section;
+  Section pmt_section;
+  std::vector<Stream> streams;
+
+  // packet split across chunks
+  uint8_t partial_packet[kPacketSize];
+  size_t partial_length = 0;
+};
+
+}  // namespace h265nal
@@ -11,6 +11,7 @@
 #include <vector>
 
 #include "h265_bitstream_parser_state.h"
+#include "h265_nal_unit_parser.h"
 #ifdef RTP_DEFINE
 #include "h265_rtp_parser.h"
 #endif  // RTP_DEFINE
@@ -29,8 +30,73 @@ class H265Utils {
   static std::vector<int32_t> GetSliceQpY(
       const uint8_t* data, size_t length,
       H265BitstreamParserState* bitstream_parser_state) noexcept;
+  // Get the slice QP for the Y component of a parsed slice segment, without
+  // allocating. Returns false if it is not available.
+  static bool GetSliceQpY(
+      const H265NalUnitParser::NalUnitState& nal_unit,
+      const H265BitstreamParserState* bitstream_parser_state,
+      int32_t* slice_qp_y) noexcept;
 
   static int ReadFile(const char* filename, std::vector<uint8_t>& buffer);
 };
 
+// A class for deriving the picture order count (Section 8.3.1) of the
+// pictures of a stream. Feed it all the NAL units, in decoding order.
+class H265PocCalculator {
+ public:
+  // Update the state with a parsed NAL unit. Returns true if the NAL unit
+  // is the first slice segment of a new picture (whose POC is then returned
+  // by GetPoc()).
+  bool Update(const H265NalUnitParser::NalUnitState& nal_unit_state) noexcept;
+  // Forget the previous pictures (e.g. after a loss of sync).
+  void Reset() noexcept;
+
+  // A picture has been seen.
+  bool HasPoc() const { return has_poc; }
+  // POC of the last picture (PicOrderCntVal).
+  int32_t GetPoc() const { return poc; }
+
+ private:
+  bool has_poc = false;
+  int32_t poc = 0;
+  // POC of the previous TemporalId 0 picture (prevTid0Pic)
+  int32_t prev_tid0_poc = 0;
+  // the next picture follows an end of sequence NAL unit
+  bool after_eos = false;
+};
+
+// A read-only memory mapping of a whole file. Large files (captures,
+// containers) can be walked in place: pages are read on demand instead of
+// loading the file in memory. Where mmap is not available, and for stdin
+// ("-"), the file is read into memory.
+class H265MappedFile {
+ public:
+  H265MappedFile() = default;
+  ~H265MappedFile();
+  // disable copy ctor, move ctor, and copy&move assignments
+  H265MappedFile(const H265MappedFile&) = delete;
+  H265MappedFile(H265MappedFile&&) = delete;
+  H265MappedFile& operator=(const H265MappedFile&) = delete;
+  H265MappedFile& operator=(H265MappedFile&&) = delete;
+
+  // Map a file (for sequential access). Returns false on error.
+  bool Open(const char* filename) noexcept;
+  void Close() noexcept;
+
+  const uint8_t* GetData() const { return data; }
+  size_t GetLength() const { return length; }
+
+ private:
+#if !(defined WIN32 || defined _WIN32 || defined __CYGWIN__)
+  // Map a (non-stdin) file.
+  bool Map(const char* filename) noexcept;
+#endif
+
+  const uint8_t* data = nullptr;
+  size_t length = 0;
+  // memory mapping (or file contents, where mmap is not available)
+  void* mapping = nullptr;
+  std::vector<uint8_t> buffer;
+};
+
 }  // namespace h265nal
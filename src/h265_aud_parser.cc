@@ -11,6 +11,7 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_trace.h"
 
 namespace h265nal {
 
@@ -37,6 +38,7 @@ std::unique_ptr<H265AudParser::AudState> H265AudParser::ParseAud(
   if (!bit_buffer->ReadBits(3, aud->pic_type)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "pic_type", 3, aud->pic_type);
 
   rbsp_trailing_bits(bit_buffer);
 
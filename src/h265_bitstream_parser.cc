@@ -18,6 +18,7 @@
 
 #include "h265_bitstream_parser_state.h"
 #include "h265_common.h"
+#include "h265_error.h"
 #include "h265_nal_unit_parser.h"
 
 namespace {
@@ -90,6 +91,51 @@ H265BitstreamParser::FindNaluIndices(const uint8_t* data,
   return sequences;
 }
 
+// NALU search for segment lists. Same results as the contiguous version,
+// but a start code can be split across segments.
+std::vector<H265BitstreamParser::NaluIndex>
+H265BitstreamParser::FindNaluIndices(const BufferSegment* segments,
+                                     size_t num_segments) noexcept {
+  std::vector<NaluIndex> sequences;
+  size_t length = GetBufferSegmentsLength(segments, num_segments);
+  if (length < kNaluShortStartSequenceSize) {
+    return sequences;
+  }
+
+  // number of consecutive 0x00 bytes just before the current one
+  size_t num_zeros = 0;
+  size_t offset = 0;
+  for (size_t i = 0; i < num_segments; i++) {
+    const uint8_t* data = segments[i].data;
+    for (size_t j = 0; j < segments[i].length; j++, offset++) {
+      if (data[j] == 0x01 && num_zeros >= 2 && offset + 1 < length) {
+        // We found a start sequence, now check if it was a 3 of 4 byte one.
+        NaluIndex index = {offset - 2, offset + 1, 0};
+        if (num_zeros >= 3) {
+          --index.start_offset;
+        }
+
+        // Update length of previous entry.
+        auto it = sequences.rbegin();
+        if (it != sequences.rend())
+          it->payload_size = index.start_offset - it->payload_start_offset;
+
+        sequences.push_back(index);
+        num_zeros = 0;
+      } else {
+        num_zeros = (data[j] == 0x00) ? (num_zeros + 1) : 0;
+      }
+    }
+  }
+
+  // Update length of last entry, if any.
+  auto it = sequences.rbegin();
+  if (it != sequences.rend())
+    it->payload_size = length - it->payload_start_offset;
+
+  return sequences;
+}
+
 // NALU search for buffers with explicit nal unit size fields
 std::vector<H265BitstreamParser::NaluIndex>
 H265BitstreamParser::FindNaluIndicesExplicitFraming(const uint8_t* data,
@@ -129,28 +175,36 @@ H265BitstreamParser::ParseBitstream(
     const uint8_t* data, size_t length,
     H265BitstreamParserState* bitstream_parser_state,
     ParsingOptions parsing_options) noexcept {
+  return ParseBitstream(data, length, bitstream_parser_state, parsing_options,
+                        nullptr);
+}
+
+std::unique_ptr<H265BitstreamParser::BitstreamState>
+H265BitstreamParser::ParseBitstream(
+    const uint8_t* data, size_t length,
+    H265BitstreamParserState* bitstream_parser_state,
+    ParsingOptions parsing_options, H265ParserContext* context) noexcept {
   auto bitstream = std::make_unique<BitstreamState>();
 
   // (1) split the input string into a vector of NAL units
   std::vector<NaluIndex> nalu_indices = FindNaluIndices(data, length);
   if (nalu_indices.size() == 0) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "error: no NAL units found on bitstream (zero NALU indices)\n");
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_ParseFailed, "bitstream",
+                              "no nal units found", nullptr);
   }
 
   // process each of the NAL units
+  size_t nal_index = 0;
   for (const NaluIndex& nalu_index : nalu_indices) {
+    H265ErrorReporter::SetNalIndex(nal_index++);
     // (2) parse the NAL units, and add them to the vector
     auto nal_unit = H265NalUnitParser::ParseNalUnit(
         &data[nalu_index.payload_start_offset], nalu_index.payload_size,
-        bitstream_parser_state, parsing_options);
+        bitstream_parser_state, parsing_options, context);
     if (nal_unit == nullptr) {
       // cannot parse the NalUnit
-#ifdef FPRINT_ERRORS
-      fprintf(stderr, "error: cannot parse buffer into NalUnit\n");
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_ParseFailed, "bitstream",
+                                "nal_unit", nullptr);
       continue;
     }
     // store the offset
@@ -174,9 +228,73 @@ H265BitstreamParser::ParseBitstream(const uint8_t* data, size_t length,
       ParseBitstream(data, length, &bitstream_parser_state, parsing_options);
   if (bitstream == nullptr) {
     // did not work
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "Could not init h265 bitstream parser\n");
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_ParseFailed, "bitstream",
+                              "bitstream", nullptr);
+    return nullptr;
+  }
+  bitstream->parsing_options_ = parsing_options;
+  return bitstream;
+}
+
+// Scatter-gather version of ParseBitstream(). Each NAL unit is unpacked
+// directly from the segments that hold it.
+std::unique_ptr<H265BitstreamParser::BitstreamState>
+H265BitstreamParser::ParseBitstream(
+    const BufferSegment* segments, size_t num_segments,
+    H265BitstreamParserState* bitstream_parser_state,
+    ParsingOptions parsing_options) noexcept {
+  auto bitstream = std::make_unique<BitstreamState>();
+
+  // (1) split the input segments into a vector of NAL units
+  std::vector<NaluIndex> nalu_indices =
+      FindNaluIndices(segments, num_segments);
+  if (nalu_indices.size() == 0) {
+    H265ErrorReporter::Report(H265ErrorCode_ParseFailed, "bitstream",
+                              "no nal units found", nullptr);
+  }
+
+  // process each of the NAL units
+  size_t nal_index = 0;
+  for (const NaluIndex& nalu_index : nalu_indices) {
+    H265ErrorReporter::SetNalIndex(nal_index++);
+    // (2) parse the NAL units, and add them to the vector
+    std::vector<BufferSegment> nalu_segments =
+        GetBufferSegments(segments, num_segments,
+                          nalu_index.payload_start_offset,
+                          nalu_index.payload_size);
+    auto nal_unit = H265NalUnitParser::ParseNalUnit(
+        nalu_segments.data(), nalu_segments.size(), bitstream_parser_state,
+        parsing_options);
+    if (nal_unit == nullptr) {
+      // cannot parse the NalUnit
+      H265ErrorReporter::Report(H265ErrorCode_ParseFailed, "bitstream",
+                                "nal_unit", nullptr);
+      continue;
+    }
+    // store the offset
+    nal_unit->offset = nalu_index.payload_start_offset;
+    nal_unit->length = nalu_index.payload_size;
+
+    bitstream->nal_units.push_back(std::move(nal_unit));
+  }
+
+  return bitstream;
+}
+
+std::unique_ptr<H265BitstreamParser::BitstreamState>
+H265BitstreamParser::ParseBitstream(const BufferSegment* segments,
+                                    size_t num_segments,
+                                    ParsingOptions parsing_options) noexcept {
+  // keep a bitstream parser state (to keep the VPS/PPS/SPS NALUs)
+  H265BitstreamParserState bitstream_parser_state;
+
+  // parse the segments
+  auto bitstream = ParseBitstream(segments, num_segments,
+                                  &bitstream_parser_state, parsing_options);
+  if (bitstream == nullptr) {
+    // did not work
+    H265ErrorReporter::Report(H265ErrorCode_ParseFailed, "bitstream",
+                              "bitstream", nullptr);
     return nullptr;
   }
   bitstream->parsing_options_ = parsing_options;
@@ -194,19 +312,29 @@ H265BitstreamParser::ParseBitstreamNALULength(
     const uint8_t* data, size_t length, size_t nalu_length_bytes,
     H265BitstreamParserState* bitstream_parser_state,
     ParsingOptions parsing_options) noexcept {
+  return ParseBitstreamNALULength(data, length, nalu_length_bytes,
+                                  bitstream_parser_state, parsing_options,
+                                  nullptr);
+}
+
+std::unique_ptr<H265BitstreamParser::BitstreamState>
+H265BitstreamParser::ParseBitstreamNALULength(
+    const uint8_t* data, size_t length, size_t nalu_length_bytes,
+    H265BitstreamParserState* bitstream_parser_state,
+    ParsingOptions parsing_options, H265ParserContext* context) noexcept {
   auto bitstream = std::make_unique<BitstreamState>();
 
   size_t i = 0;
 
   if (length < nalu_length_bytes) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "error: got %zu bytes, less than the NALU length size (%zu)\n",
-            length, nalu_length_bytes);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_Truncated, "bitstream",
+                              "nalu length", nullptr,
+                              static_cast<int64_t>(length), 0,
+                              static_cast<int64_t>(nalu_length_bytes));
   }
 
   // process each of the NAL units
+  size_t nal_index = 0;
   for (i = 0; i < length;) {
     size_t nalu_length = 0;
     if (nalu_length_bytes > 0) {
@@ -225,13 +353,15 @@ H265BitstreamParser::ParseBitstreamNALULength(
     }
 
     // (2) parse the NAL unit, and add it to the vector
-    auto nal_unit = H265NalUnitParser::ParseNalUnit(
-        &data[i], nalu_length, bitstream_parser_state, parsing_options);
+    H265ErrorReporter::SetNalIndex(nal_index++);
+    auto nal_unit =
+        H265NalUnitParser::ParseNalUnit(&data[i], nalu_length,
+                                        bitstream_parser_state,
+                                        parsing_options, context);
     if (nal_unit == nullptr) {
       // cannot parse the NalUnit
-#ifdef FPRINT_ERRORS
-      fprintf(stderr, "error: cannot parse buffer into NalUnit\n");
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_ParseFailed, "bitstream",
+                                "nal_unit", nullptr);
       i += nalu_length;
       continue;
     }
@@ -261,9 +391,8 @@ H265BitstreamParser::ParseBitstreamNALULength(
                                &bitstream_parser_state, parsing_options);
   if (bitstream == nullptr) {
     // did not work
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "Could not init h265 bitstream parser\n");
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_ParseFailed, "bitstream",
+                              "bitstream", nullptr);
     return nullptr;
   }
   bitstream->parsing_options_ = parsing_options;
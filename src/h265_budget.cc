@@ -0,0 +1,102 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_budget.h"
+
+#include <stdio.h>
+
+#include <cstdint>
+
+#include "h265_error.h"
+
+namespace {
+
+struct BudgetState {
+  // limits (0 means unlimited)
+  uint32_t max_allocations = 0;
+  size_t max_allocated_bytes = 0;
+  uint32_t max_syntax_elements = 0;
+  // usage
+  uint64_t num_allocations = 0;
+  uint64_t num_allocated_bytes = 0;
+  uint64_t num_syntax_elements = 0;
+};
+
+thread_local BudgetState state;
+
+}  // namespace
+
+namespace h265nal {
+
+H265Budget::Scope::Scope(const ParsingOptions& parsing_options) noexcept
+    : max_allocations(state.max_allocations),
+      max_allocated_bytes(state.max_allocated_bytes),
+      max_syntax_elements(state.max_syntax_elements),
+      num_allocations(state.num_allocations),
+      num_allocated_bytes(state.num_allocated_bytes),
+      num_syntax_elements(state.num_syntax_elements) {
+  state.max_allocations = parsing_options.max_allocations;
+  state.max_allocated_bytes = parsing_options.max_allocated_bytes;
+  state.max_syntax_elements = parsing_options.max_syntax_elements;
+  state.num_allocations = 0;
+  state.num_allocated_bytes = 0;
+  state.num_syntax_elements = 0;
+}
+
+H265Budget::Scope::~Scope() noexcept {
+  state.max_allocations = max_allocations;
+  state.max_allocated_bytes = max_allocated_bytes;
+  state.max_syntax_elements = max_syntax_elements;
+  state.num_allocations = num_allocations;
+  state.num_allocated_bytes = num_allocated_bytes;
+  state.num_syntax_elements = num_syntax_elements;
+}
+
+bool H265Budget::Charge(const char* parser, const char* element,
+                        BitBuffer* bit_buffer, uint64_t num_syntax_elements,
+                        uint64_t num_bytes) noexcept {
+  state.num_allocations++;
+  state.num_allocated_bytes += num_bytes;
+  state.num_syntax_elements += num_syntax_elements;
+
+  if (state.max_allocations > 0 &&
+      state.num_allocations > state.max_allocations) {
+    H265ErrorReporter::Report(
+        H265ErrorCode_BudgetExceeded, parser, element, bit_buffer,
+        static_cast<int64_t>(state.num_allocations), 0,
+        static_cast<int64_t>(state.max_allocations));
+    return false;
+  }
+  if (state.max_allocated_bytes > 0 &&
+      state.num_allocated_bytes > state.max_allocated_bytes) {
+    H265ErrorReporter::Report(
+        H265ErrorCode_BudgetExceeded, parser, element, bit_buffer,
+        static_cast<int64_t>(state.num_allocated_bytes), 0,
+        static_cast<int64_t>(state.max_allocated_bytes));
+    return false;
+  }
+  if (state.max_syntax_elements > 0 &&
+      state.num_syntax_elements > state.max_syntax_elements) {
+    H265ErrorReporter::Report(
+        H265ErrorCode_BudgetExceeded, parser, element, bit_buffer,
+        static_cast<int64_t>(state.num_syntax_elements), 0,
+        static_cast<int64_t>(state.max_syntax_elements));
+    return false;
+  }
+  return true;
+}
+
+uint64_t H265Budget::GetNumAllocations() noexcept {
+  return state.num_allocations;
+}
+
+uint64_t H265Budget::GetNumAllocatedBytes() noexcept {
+  return state.num_allocated_bytes;
+}
+
+uint64_t H265Budget::GetNumSyntaxElements() noexcept {
+  return state.num_syntax_elements;
+}
+
+}  // namespace h265nal
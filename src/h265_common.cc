@@ -527,6 +527,14 @@ void profileTypeToString(enum ProfileType profile, std::string& str) {
 // has been inserted as third byte), and returns the unescaped one.
 std::vector<uint8_t> UnescapeRbsp(const uint8_t* data, size_t length) {
   std::vector<uint8_t> out;
+  UnescapeRbsp(data, length, &out);
+  return out;
+}
+
+void UnescapeRbsp(const uint8_t* data, size_t length,
+                  std::vector<uint8_t>* out_buffer) {
+  std::vector<uint8_t>& out = *out_buffer;
+  out.clear();
   out.reserve(length);
 
   for (size_t i = 0; i < length;) {
@@ -546,9 +554,142 @@ std::vector<uint8_t> UnescapeRbsp(const uint8_t* data, size_t length) {
       out.push_back(data[i++]);
     }
   }
+}
+
+// EscapeRbsp() inserts an emulation prevention byte ("\x03") after any
+// 2x "\x00" bytes followed by a "\x00", "\x01", "\x02", or "\x03" byte
+// (Section 7.4.2). A final "\x00" byte (e.g. cabac_zero_words) is escaped
+// too.
+void EscapeRbsp(const uint8_t* data, size_t length,
+                std::vector<uint8_t>* out_buffer) {
+  std::vector<uint8_t>& out = *out_buffer;
+  out.reserve(out.size() + length + length / 64);
+
+  size_t zeros = 0;
+  for (size_t i = 0; i < length; i++) {
+    if (zeros == 2 && data[i] <= 0x03) {
+      out.push_back(0x03);
+      zeros = 0;
+    }
+    out.push_back(data[i]);
+    zeros = (data[i] == 0x00) ? zeros + 1 : 0;
+  }
+  if (length > 0 && data[length - 1] == 0x00) {
+    out.push_back(0x03);
+  }
+}
+
+size_t GetBufferSegmentsLength(const BufferSegment* segments,
+                               size_t num_segments) {
+  size_t length = 0;
+  for (size_t i = 0; i < num_segments; i++) {
+    length += segments[i].length;
+  }
+  return length;
+}
+
+std::vector<BufferSegment> GetBufferSegments(const BufferSegment* segments,
+                                             size_t num_segments,
+                                             size_t offset, size_t length) {
+  std::vector<BufferSegment> out;
+  for (size_t i = 0; i < num_segments && length > 0; i++) {
+    if (offset >= segments[i].length) {
+      // range starts after this segment
+      offset -= segments[i].length;
+      continue;
+    }
+    size_t segment_length = segments[i].length - offset;
+    if (segment_length > length) {
+      segment_length = length;
+    }
+    out.push_back({segments[i].data + offset, segment_length});
+    length -= segment_length;
+    offset = 0;
+  }
   return out;
 }
 
+// Same algorithm as the contiguous UnescapeRbsp(), but run as a state
+// machine over the bytes so that an emulation prevention sequence
+// ("\x00\x00\x03") can be split across segments.
+std::vector<uint8_t> UnescapeRbsp(const BufferSegment* segments,
+                                  size_t num_segments) {
+  std::vector<uint8_t> out;
+  UnescapeRbsp(segments, num_segments, &out);
+  return out;
+}
+
+void UnescapeRbsp(const BufferSegment* segments, size_t num_segments,
+                  std::vector<uint8_t>* out_buffer) {
+  std::vector<uint8_t>& out = *out_buffer;
+  out.clear();
+  out.reserve(GetBufferSegmentsLength(segments, num_segments));
+
+  // number of consecutive 0x00 bytes just before the current one
+  size_t num_zeros = 0;
+  for (size_t i = 0; i < num_segments; i++) {
+    const uint8_t* data = segments[i].data;
+    for (size_t j = 0; j < segments[i].length; j++) {
+      if (num_zeros >= 2 && data[j] == 0x03) {
+        // Skip the emulation byte.
+        num_zeros = 0;
+        continue;
+      }
+      num_zeros = (data[j] == 0x00) ? (num_zeros + 1) : 0;
+      out.push_back(data[j]);
+    }
+  }
+}
+
+// Same state machine as the segment list UnescapeRbsp().
+size_t RbspToEscapedOffset(const uint8_t* data, size_t length,
+                           size_t rbsp_offset) {
+  const BufferSegment segment = {data, length};
+  return RbspToEscapedOffset(&segment, 1, rbsp_offset);
+}
+
+size_t RbspToEscapedOffset(const BufferSegment* segments, size_t num_segments,
+                           size_t rbsp_offset) {
+  size_t escaped_offset = 0;
+  size_t num_rbsp_bytes = 0;
+  size_t num_zeros = 0;
+  for (size_t i = 0; i < num_segments; i++) {
+    const uint8_t* data = segments[i].data;
+    for (size_t j = 0; j < segments[i].length; j++, escaped_offset++) {
+      if (num_zeros >= 2 && data[j] == 0x03) {
+        // emulation byte
+        num_zeros = 0;
+        continue;
+      }
+      if (num_rbsp_bytes == rbsp_offset) {
+        return escaped_offset;
+      }
+      num_zeros = (data[j] == 0x00) ? (num_zeros + 1) : 0;
+      num_rbsp_bytes++;
+    }
+  }
+  return escaped_offset;
+}
+
+size_t EscapedToRbspOffset(const uint8_t* data, size_t length,
+                           size_t escaped_offset) {
+  if (escaped_offset > length) {
+    escaped_offset = length;
+  }
+  size_t rbsp_offset = 0;
+  size_t num_zeros = 0;
+  for (size_t i = 0; i < escaped_offset; i++) {
+    if (num_zeros >= 2 && data[i] == 0x03) {
+      // emulation byte
+      num_zeros = 0;
+      continue;
+    }
+    num_zeros = (data[i] == 0x00) ? (num_zeros + 1) : 0;
+    rbsp_offset++;
+  }
+  return rbsp_offset;
+}
+
 // Syntax functions and descriptors) (Section 7.2)
 bool byte_aligned(BitBuffer* bit_buffer) {
   // If the current position in the bitstream is on a byte boundary, i.e.,
@@ -667,12 +808,18 @@ void fdump_indent_level(FILE* outfp, int indent_level) {
 
 std::shared_ptr<NaluChecksum> NaluChecksum::GetNaluChecksum(
     BitBuffer* bit_buffer) noexcept {
+  auto checksum = std::make_shared<NaluChecksum>();
+  GetNaluChecksum(bit_buffer, checksum.get());
+  return checksum;
+}
+
+void NaluChecksum::GetNaluChecksum(BitBuffer* bit_buffer,
+                                   NaluChecksum* checksum) noexcept {
   // save the bit buffer current state
   size_t byte_offset = 0;
   size_t bit_offset = 0;
   bit_buffer->GetCurrentOffset(&byte_offset, &bit_offset);
 
-  auto checksum = std::make_shared<NaluChecksum>();
   // implement simple IP-like checksum (extended from 16/32 to 32/64 bits)
   // Inspired in https://stackoverflow.com/questions/26774761
 
@@ -714,8 +861,6 @@ std::shared_ptr<NaluChecksum> NaluChecksum::GetNaluChecksum(
 
   // return the bit buffer to the original state
   bit_buffer->Seek(byte_offset, bit_offset);
-
-  return checksum;
 }
 
 void NaluChecksum::fdump(char* output, int output_len) const {
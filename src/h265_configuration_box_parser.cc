@@ -11,7 +11,9 @@
 #include <memory>
 #include <vector>
 
+#include "h265_budget.h"
 #include "h265_common.h"
+#include "h265_error.h"
 #include "h265_nal_unit_parser.h"
 
 namespace h265nal {
@@ -42,16 +44,17 @@ H265ConfigurationBoxParser::ParseConfigurationBox(
 
   // H265 configuration box (HEVCDecoderConfigurationRecord()) blob.
   auto configuration_box = std::make_shared<ConfigurationBoxState>();
+  // the box gets its own budget (each NAL unit in it gets a fresh one)
+  H265Budget::Scope budget_scope(parsing_options);
 
   // unsigned int(8) configurationVersion = 1;
   if (!bit_buffer->ReadBits(8, configuration_box->configurationVersion)) {
     return nullptr;
   }
   if (configuration_box->configurationVersion != 1) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "error: configurationVersion is not 1: %u\n",
-            configuration_box->configurationVersion);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_InvalidValue, "configuration_box",
+                              "configurationVersion", bit_buffer,
+                              configuration_box->configurationVersion, 0, 0);
     return nullptr;
   }
 
@@ -94,10 +97,9 @@ H265ConfigurationBoxParser::ParseConfigurationBox(
     return nullptr;
   }
   if (configuration_box->reserved1 != 0b1111) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "error: reserved1 is not 0b1111: %u\n",
-            configuration_box->reserved1);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_InvalidValue, "configuration_box",
+                              "reserved1", bit_buffer,
+                              configuration_box->reserved1, 0, 0);
     return nullptr;
   }
 
@@ -112,10 +114,9 @@ H265ConfigurationBoxParser::ParseConfigurationBox(
     return nullptr;
   }
   if (configuration_box->reserved2 != 0b111111) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "error: reserved2 is not 0b111111: %u\n",
-            configuration_box->reserved2);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_InvalidValue, "configuration_box",
+                              "reserved2", bit_buffer,
+                              configuration_box->reserved2, 0, 0);
     return nullptr;
   }
 
@@ -129,10 +130,9 @@ H265ConfigurationBoxParser::ParseConfigurationBox(
     return nullptr;
   }
   if (configuration_box->reserved3 != 0b111111) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "error: reserved3 is not 0b111111: %u\n",
-            configuration_box->reserved3);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_InvalidValue, "configuration_box",
+                              "reserved3", bit_buffer,
+                              configuration_box->reserved3, 0, 0);
     return nullptr;
   }
 
@@ -146,10 +146,9 @@ H265ConfigurationBoxParser::ParseConfigurationBox(
     return nullptr;
   }
   if (configuration_box->reserved4 != 0b11111) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "error: reserved4 is not 0b11111: %u\n",
-            configuration_box->reserved4);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_InvalidValue, "configuration_box",
+                              "reserved4", bit_buffer,
+                              configuration_box->reserved4, 0, 0);
     return nullptr;
   }
 
@@ -163,10 +162,9 @@ H265ConfigurationBoxParser::ParseConfigurationBox(
     return nullptr;
   }
   if (configuration_box->reserved5 != 0b11111) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "error: reserved5 is not 0b11111: %u\n",
-            configuration_box->reserved5);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_InvalidValue, "configuration_box",
+                              "reserved5", bit_buffer,
+                              configuration_box->reserved5, 0, 0);
     return nullptr;
   }
 
@@ -218,10 +216,9 @@ H265ConfigurationBoxParser::ParseConfigurationBox(
     }
     configuration_box->reserved6.push_back(bits_tmp);
     if (configuration_box->reserved6.back() != 0) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr, "error: reserved6[%u] is not 0: %u\n", j,
-              configuration_box->reserved6.back());
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_InvalidValue, "configuration_box",
+                                "reserved6", bit_buffer,
+                                configuration_box->reserved6.back(), 0, 0);
       return nullptr;
     }
 
@@ -237,6 +234,12 @@ H265ConfigurationBoxParser::ParseConfigurationBox(
     }
     configuration_box->numNalus.push_back(bits_tmp);
 
+    if (!H265Budget::Charge("configuration_box", "numNalus", bit_buffer,
+                            configuration_box->numNalus.back(),
+                            configuration_box->numNalus.back() *
+                                sizeof(uint32_t))) {
+      return nullptr;
+    }
     configuration_box->nalUnitLength.emplace_back();
     configuration_box->nalUnit.emplace_back();
     for (uint32_t i = 0; i < configuration_box->numNalus.back(); i++) {
@@ -248,6 +251,10 @@ H265ConfigurationBoxParser::ParseConfigurationBox(
 
       // bit(8*nalUnitLength) nalUnit;
       size_t length = configuration_box->nalUnitLength.back().back();
+      if (!H265Budget::Charge("configuration_box", "nalUnit", bit_buffer, 0,
+                              length)) {
+        return nullptr;
+      }
       std::vector<uint8_t> data(length);
       if (!bit_buffer->ReadBytes(length, data.data())) {
         return nullptr;
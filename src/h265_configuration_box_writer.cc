@@ -0,0 +1,238 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_configuration_box_writer.h"
+
+#include <stdio.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_nal_unit_parser.h"
+#include "h265_pps_parser.h"
+#include "h265_sps_parser.h"
+#include "rtc_common.h"
+
+namespace {
+// NAL unit types allowed in the hvcC arrays, in array order
+constexpr uint32_t kArrayNalUnitTypes[] = {
+    h265nal::NalUnitType::VPS_NUT, h265nal::NalUnitType::SPS_NUT,
+    h265nal::NalUnitType::PPS_NUT, h265nal::NalUnitType::PREFIX_SEI_NUT,
+    h265nal::NalUnitType::SUFFIX_SEI_NUT};
+constexpr size_t kNumArrays =
+    sizeof(kArrayNalUnitTypes) / sizeof(kArrayNalUnitTypes[0]);
+// size of the hvcC header (up to and including numOfArrays)
+constexpr size_t kHeaderSize = 23;
+// RBSP offset of general_constraint_indicator_flags in an SPS: NAL unit
+// header (2 bytes), sps_video_parameter_set_id/sps_max_sub_layers_minus1/
+// sps_temporal_id_nesting_flag (1 byte), general_profile_space/
+// general_tier_flag/general_profile_idc (1 byte), and
+// general_profile_compatibility_flag[32] (4 bytes)
+constexpr size_t kSpsConstraintFlagsOffset = 8;
+
+// parallelismType of a PPS (ISO/IEC 14496-15:2022, Section 8.3.2.1.3)
+uint32_t GetParallelismType(const h265nal::H265PpsParser::PpsState& pps) {
+  if (pps.entropy_coding_sync_enabled_flag && pps.tiles_enabled_flag) {
+    // mixed
+    return 0;
+  } else if (pps.entropy_coding_sync_enabled_flag) {
+    // wavefront
+    return 3;
+  } else if (pps.tiles_enabled_flag) {
+    // tile
+    return 2;
+  }
+  // slice
+  return 1;
+}
+}  // namespace
+
+namespace h265nal {
+
+bool H265ConfigurationBoxWriter::WriteConfigurationBox(
+    const BufferSegment* nal_units, size_t num_nal_units,
+    const Options& options, std::vector<uint8_t>* buffer) noexcept {
+  if (buffer == nullptr || options.length_size_minus_one > 3 ||
+      options.length_size_minus_one == 2) {
+    return false;
+  }
+
+  // 1. sort the NAL units into the arrays
+  std::array<std::vector<BufferSegment>, kNumArrays> arrays;
+  for (size_t i = 0; i < num_nal_units; i++) {
+    const BufferSegment& nal_unit = nal_units[i];
+    // nalUnitLength is 16 bits
+    if (nal_unit.data == nullptr || nal_unit.length < 2 ||
+        nal_unit.length > 0xffff) {
+      continue;
+    }
+    uint32_t nal_unit_type = (nal_unit.data[0] >> 1) & 0x3f;
+    for (size_t j = 0; j < kNumArrays; j++) {
+      if (nal_unit_type != kArrayNalUnitTypes[j]) {
+        continue;
+      }
+      bool duplicate = false;
+      for (const BufferSegment& other : arrays[j]) {
+        if (other.length == nal_unit.length &&
+            memcmp(other.data, nal_unit.data, nal_unit.length) == 0) {
+          duplicate = true;
+          break;
+        }
+      }
+      if (!duplicate) {
+        arrays[j].push_back(nal_unit);
+      }
+    }
+  }
+
+  // 2. parse the parameter sets (VPS first)
+  H265BitstreamParserState bitstream_parser_state;
+  ParsingOptions parsing_options;
+  std::shared_ptr<H265SpsParser::SpsState> sps;
+  const BufferSegment* sps_nal_unit = nullptr;
+  bool has_parallelism_type = false;
+  uint32_t parallelism_type = 0;
+  for (size_t j = 0; j < 3; j++) {
+    for (const BufferSegment& nal_unit : arrays[j]) {
+      auto nal_unit_state = H265NalUnitParser::ParseNalUnit(
+          nal_unit.data, nal_unit.length, &bitstream_parser_state,
+          parsing_options);
+      if (nal_unit_state == nullptr ||
+          nal_unit_state->nal_unit_payload == nullptr) {
+        continue;
+      }
+      const auto& payload = nal_unit_state->nal_unit_payload;
+      if (sps == nullptr && payload->sps != nullptr &&
+          payload->sps->profile_tier_level != nullptr &&
+          payload->sps->profile_tier_level->general != nullptr) {
+        sps = payload->sps;
+        sps_nal_unit = &nal_unit;
+      }
+      if (payload->pps != nullptr) {
+        uint32_t pps_parallelism_type = GetParallelismType(*payload->pps);
+        if (has_parallelism_type && parallelism_type != pps_parallelism_type) {
+          parallelism_type = 0;
+        } else {
+          parallelism_type = pps_parallelism_type;
+        }
+        has_parallelism_type = true;
+      }
+    }
+  }
+  if (sps == nullptr) {
+    return false;
+  }
+
+  // 3. derive the header fields
+  const auto& general = *sps->profile_tier_level->general;
+  uint64_t general_constraint_indicator_flags = 0;
+  // the 48 constraint bits are profile-dependent: copy them verbatim
+  std::vector<uint8_t> rbsp;
+  UnescapeRbsp(sps_nal_unit->data, sps_nal_unit->length, &rbsp);
+  if (rbsp.size() < kSpsConstraintFlagsOffset + 6) {
+    return false;
+  }
+  for (size_t i = 0; i < 6; i++) {
+    general_constraint_indicator_flags =
+        (general_constraint_indicator_flags << 8) |
+        rbsp[kSpsConstraintFlagsOffset + i];
+  }
+  uint32_t min_spatial_segmentation_idc = 0;
+  if (sps->vui_parameters_present_flag && sps->vui_parameters != nullptr) {
+    min_spatial_segmentation_idc =
+        sps->vui_parameters->min_spatial_segmentation_idc;
+  }
+  if (min_spatial_segmentation_idc == 0) {
+    // no parallelism can be assumed
+    parallelism_type = 0;
+  }
+  uint32_t num_temporal_layers = sps->sps_max_sub_layers_minus1 + 1;
+
+  // 4. write the box
+  size_t num_arrays = 0;
+  size_t size = kHeaderSize;
+  for (const auto& array : arrays) {
+    if (array.empty()) {
+      continue;
+    }
+    num_arrays++;
+    size += 3;
+    for (const BufferSegment& nal_unit : array) {
+      size += 2 + nal_unit.length;
+    }
+  }
+  buffer->resize(size);
+  BitBufferWriter writer(buffer->data(), buffer->size());
+  // configurationVersion
+  writer.WriteBits(1, 8);
+  writer.WriteBits(general.profile_space, 2);
+  writer.WriteBits(general.tier_flag, 1);
+  writer.WriteBits(general.profile_idc, 5);
+  for (uint32_t j = 0; j < 32; j++) {
+    writer.WriteBits(general.profile_compatibility_flag[j], 1);
+  }
+  writer.WriteBits(general_constraint_indicator_flags, 48);
+  writer.WriteBits(sps->profile_tier_level->general_level_idc, 8);
+  writer.WriteBits(0b1111, 4);
+  writer.WriteBits(min_spatial_segmentation_idc, 12);
+  writer.WriteBits(0b111111, 6);
+  writer.WriteBits(parallelism_type, 2);
+  writer.WriteBits(0b111111, 6);
+  writer.WriteBits(sps->chroma_format_idc, 2);
+  writer.WriteBits(0b11111, 5);
+  writer.WriteBits(sps->bit_depth_luma_minus8, 3);
+  writer.WriteBits(0b11111, 5);
+  writer.WriteBits(sps->bit_depth_chroma_minus8, 3);
+  writer.WriteBits(options.avg_frame_rate, 16);
+  writer.WriteBits(options.constant_frame_rate, 2);
+  writer.WriteBits(num_temporal_layers, 3);
+  writer.WriteBits(sps->sps_temporal_id_nesting_flag, 1);
+  writer.WriteBits(options.length_size_minus_one, 2);
+  writer.WriteBits(num_arrays, 8);
+  for (size_t j = 0; j < kNumArrays; j++) {
+    if (arrays[j].empty()) {
+      continue;
+    }
+    writer.WriteBits(options.array_completeness, 1);
+    // reserved
+    writer.WriteBits(0, 1);
+    writer.WriteBits(kArrayNalUnitTypes[j], 6);
+    writer.WriteBits(arrays[j].size(), 16);
+    for (const BufferSegment& nal_unit : arrays[j]) {
+      writer.WriteBits(nal_unit.length, 16);
+      size_t byte_offset, bit_offset;
+      writer.GetCurrentOffset(&byte_offset, &bit_offset);
+      memcpy(buffer->data() + byte_offset, nal_unit.data, nal_unit.length);
+      writer.ConsumeBytes(nal_unit.length);
+    }
+  }
+  return true;
+}
+
+bool H265ConfigurationBoxWriter::WriteConfigurationBox(
+    const uint8_t* data, size_t length, const Options& options,
+    std::vector<uint8_t>* buffer) noexcept {
+  std::vector<BufferSegment> nal_units;
+  for (const auto& nalu_index :
+       H265BitstreamParser::FindNaluIndices(data, length)) {
+    // drop the trailing_zero_8bits
+    size_t nal_unit_length = nalu_index.payload_size;
+    while (nal_unit_length > 0 &&
+           data[nalu_index.payload_start_offset + nal_unit_length - 1] == 0) {
+      nal_unit_length--;
+    }
+    nal_units.push_back(
+        {data + nalu_index.payload_start_offset, nal_unit_length});
+  }
+  return WriteConfigurationBox(nal_units.data(), nal_units.size(), options,
+                               buffer);
+}
+
+}  // namespace h265nal
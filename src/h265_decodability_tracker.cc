@@ -0,0 +1,299 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_decodability_tracker.h"
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_nal_unit_parser.h"
+
+namespace {
+// maximum number of pictures in an RPS (16 short-term, plus long-term)
+constexpr size_t kMaxDpbEntries = 64;
+// mask to compare full POC values
+constexpr int32_t kFullPoc = -1;
+
+bool IsRasl(uint32_t nal_unit_type) {
+  return nal_unit_type == h265nal::NalUnitType::RASL_N ||
+         nal_unit_type == h265nal::NalUnitType::RASL_R;
+}
+}  // namespace
+
+namespace h265nal {
+
+H265DecodabilityTracker::H265DecodabilityTracker() {
+  dpb.reserve(kMaxDpbEntries);
+  next_dpb.reserve(kMaxDpbEntries);
+}
+
+bool H265DecodabilityTracker::AddNalUnit(
+    const H265NalUnitParser::NalUnitState* nal_unit_state,
+    const H265BitstreamParserState* bitstream_parser_state) noexcept {
+  if (nal_unit_state == nullptr ||
+      nal_unit_state->nal_unit_header == nullptr) {
+    SignalLoss();
+    return false;
+  }
+  uint32_t nal_unit_type = nal_unit_state->nal_unit_header->nal_unit_type;
+  if (poc_calculator.Update(*nal_unit_state)) {
+    StartPicture(*nal_unit_state, bitstream_parser_state);
+    return picture.IsDecodable();
+  }
+  if (!IsSliceSegment(nal_unit_type)) {
+    return true;
+  }
+  // a slice segment of the current picture
+  if (!has_picture) {
+    // the start of its picture was lost
+    return false;
+  }
+  if (nal_unit_state->nal_unit_payload == nullptr ||
+      nal_unit_state->nal_unit_payload->slice_segment_layer == nullptr) {
+    MarkIncomplete();
+  }
+  return picture.IsDecodable();
+}
+
+#ifdef RTP_DEFINE
+bool H265DecodabilityTracker::AddNalUnit(
+    const H265RtpDepacketizer::NalUnit& nal_unit,
+    const H265NalUnitParser::NalUnitState* nal_unit_state,
+    const H265BitstreamParserState* bitstream_parser_state) noexcept {
+  if (nal_unit.after_loss) {
+    if (after_marker && has_picture) {
+      // the current picture was complete: only whole access units were
+      // lost (if any)
+      stats.losses++;
+      StorePicture();
+      has_picture = false;
+    } else {
+      SignalLoss();
+    }
+  }
+  after_marker = nal_unit.marker;
+  return AddNalUnit(nal_unit_state, bitstream_parser_state);
+}
+#endif  // RTP_DEFINE
+
+void H265DecodabilityTracker::SignalLoss() noexcept {
+  stats.losses++;
+  MarkIncomplete();
+}
+
+bool H265DecodabilityTracker::NeedsKeyframe() const noexcept {
+  for (const auto& entry : dpb) {
+    if (!entry.decodable) {
+      return true;
+    }
+  }
+  return has_picture && !picture.IsDecodable() && picture_is_reference;
+}
+
+void H265DecodabilityTracker::MarkIncomplete() noexcept {
+  if (has_picture && picture.complete) {
+    picture.complete = false;
+    stats.pictures_incomplete++;
+  }
+}
+
+bool H265DecodabilityTracker::KeepReference(int32_t poc,
+                                            int32_t poc_mask) noexcept {
+  for (const auto& entry : next_dpb) {
+    if ((entry.poc & poc_mask) == (poc & poc_mask)) {
+      return entry.decodable;
+    }
+  }
+  for (const auto& entry : dpb) {
+    if ((entry.poc & poc_mask) == (poc & poc_mask)) {
+      if (next_dpb.size() < kMaxDpbEntries) {
+        next_dpb.push_back(entry);
+      }
+      return entry.decodable;
+    }
+  }
+  // a missing picture: keep a placeholder so that later pictures
+  // referencing it are not decodable either, except for IRAP and RASL
+  // pictures (a RASL picture associated with an IRAP picture that starts
+  // the stream references pictures that were never sent)
+  uint32_t nal_unit_type = picture.nal_unit_type;
+  bool irap = (nal_unit_type >= NalUnitType::BLA_W_LP &&
+               nal_unit_type <= NalUnitType::RSV_IRAP_VCL23);
+  if (!irap && !IsRasl(nal_unit_type) && next_dpb.size() < kMaxDpbEntries) {
+    next_dpb.push_back({poc, false});
+  }
+  return false;
+}
+
+void H265DecodabilityTracker::StorePicture() noexcept {
+  // RASL pictures that cannot be decoded are skipped
+  if ((picture.IsDecodable() || !IsRasl(picture.nal_unit_type)) &&
+      dpb.size() < kMaxDpbEntries) {
+    dpb.push_back({picture.poc, picture.IsDecodable()});
+  }
+}
+
+void H265DecodabilityTracker::StartPicture(
+    const H265NalUnitParser::NalUnitState& nal_unit_state,
+    const H265BitstreamParserState* bitstream_parser_state) noexcept {
+  // the previous picture is now available for reference
+  if (has_picture) {
+    StorePicture();
+  }
+
+  const auto& slice_segment_header =
+      nal_unit_state.nal_unit_payload->slice_segment_layer
+          ->slice_segment_header;
+  uint32_t nal_unit_type = nal_unit_state.nal_unit_header->nal_unit_type;
+  has_picture = true;
+  picture.poc = poc_calculator.GetPoc();
+  picture.nal_unit_type = nal_unit_type;
+  picture.temporal_id =
+      nal_unit_state.nal_unit_header->nuh_temporal_id_plus1 - 1;
+  picture.references_decodable = true;
+  picture.complete = true;
+  bool sub_layer_non_reference =
+      (nal_unit_type <= NalUnitType::RSV_VCL_N14) && (nal_unit_type % 2 == 0);
+  picture_is_reference = !sub_layer_non_reference && !IsRasl(nal_unit_type);
+  stats.pictures++;
+
+  // IDR and BLA pictures empty the DPB (Section 8.3.2)
+  if (nal_unit_type >= NalUnitType::BLA_W_LP &&
+      nal_unit_type <= NalUnitType::IDR_N_LP) {
+    dpb.clear();
+    return;
+  }
+
+  // get the RPS (Section 8.3.2)
+  std::shared_ptr<struct H265SpsParser::SpsState> sps;
+  if (bitstream_parser_state != nullptr) {
+    auto pps = bitstream_parser_state->GetPps(
+        slice_segment_header->slice_pic_parameter_set_id);
+    if (pps != nullptr) {
+      sps = bitstream_parser_state->GetSps(pps->pps_seq_parameter_set_id);
+    }
+  }
+  const H265StRefPicSetParser::StRefPicSetState* st_ref_pic_set = nullptr;
+  if (!slice_segment_header->short_term_ref_pic_set_sps_flag) {
+    st_ref_pic_set = slice_segment_header->st_ref_pic_set.get();
+  } else {
+    uint32_t idx = slice_segment_header->short_term_ref_pic_set_idx;
+    if (sps != nullptr && idx < sps->st_ref_pic_set.size()) {
+      st_ref_pic_set = sps->st_ref_pic_set[idx].get();
+    }
+  }
+  if (st_ref_pic_set == nullptr || sps == nullptr) {
+    // unknown references
+    picture.references_decodable = false;
+    stats.pictures_missing_references++;
+    return;
+  }
+
+  next_dpb.clear();
+  bool references_decodable = true;
+  // short-term pictures (Equation 8-5)
+  int32_t delta_poc = 0;
+  for (uint32_t i = 0; i < st_ref_pic_set->num_negative_pics &&
+                       i < st_ref_pic_set->delta_poc_s0_minus1.size() &&
+                       i < st_ref_pic_set->used_by_curr_pic_s0_flag.size();
+       i++) {
+    delta_poc -=
+        static_cast<int32_t>(st_ref_pic_set->delta_poc_s0_minus1[i]) + 1;
+    bool decodable = KeepReference(picture.poc + delta_poc, kFullPoc);
+    if (st_ref_pic_set->used_by_curr_pic_s0_flag[i] && !decodable) {
+      references_decodable = false;
+    }
+  }
+  delta_poc = 0;
+  for (uint32_t i = 0; i < st_ref_pic_set->num_positive_pics &&
+                       i < st_ref_pic_set->delta_poc_s1_minus1.size() &&
+                       i < st_ref_pic_set->used_by_curr_pic_s1_flag.size();
+       i++) {
+    delta_poc +=
+        static_cast<int32_t>(st_ref_pic_set->delta_poc_s1_minus1[i]) + 1;
+    bool decodable = KeepReference(picture.poc + delta_poc, kFullPoc);
+    if (st_ref_pic_set->used_by_curr_pic_s1_flag[i] && !decodable) {
+      references_decodable = false;
+    }
+  }
+
+  // long-term pictures (Equations 7-52 and 8-5)
+  int32_t max_poc_lsb =
+      1 << (slice_segment_header->log2_max_pic_order_cnt_lsb_minus4 + 4);
+  uint32_t num_long_term_sps = slice_segment_header->num_long_term_sps;
+  uint32_t num_long_term =
+      num_long_term_sps + slice_segment_header->num_long_term_pics;
+  size_t msb_cycle_index = 0;
+  int32_t delta_poc_msb_cycle_lt = 0;
+  for (uint32_t i = 0; i < num_long_term; i++) {
+    uint32_t poc_lsb_lt = 0;
+    uint32_t used_by_curr_pic_lt = 0;
+    if (i < num_long_term_sps) {
+      uint32_t lt_idx_sps = (i < slice_segment_header->lt_idx_sps.size())
+                                ? slice_segment_header->lt_idx_sps[i]
+                                : 0;
+      if (lt_idx_sps >= sps->lt_ref_pic_poc_lsb_sps.size() ||
+          lt_idx_sps >= sps->used_by_curr_pic_lt_sps_flag.size()) {
+        references_decodable = false;
+        continue;
+      }
+      poc_lsb_lt = sps->lt_ref_pic_poc_lsb_sps[lt_idx_sps];
+      used_by_curr_pic_lt = sps->used_by_curr_pic_lt_sps_flag[lt_idx_sps];
+    } else {
+      size_t j = i - num_long_term_sps;
+      if (j >= slice_segment_header->poc_lsb_lt.size() ||
+          j >= slice_segment_header->used_by_curr_pic_lt_flag.size()) {
+        references_decodable = false;
+        continue;
+      }
+      poc_lsb_lt = slice_segment_header->poc_lsb_lt[j];
+      used_by_curr_pic_lt = slice_segment_header->used_by_curr_pic_lt_flag[j];
+    }
+    if (i == 0 || i == num_long_term_sps) {
+      delta_poc_msb_cycle_lt = 0;
+    }
+    bool delta_poc_msb_present =
+        (i < slice_segment_header->delta_poc_msb_present_flag.size()) &&
+        slice_segment_header->delta_poc_msb_present_flag[i];
+    if (delta_poc_msb_present &&
+        msb_cycle_index < slice_segment_header->delta_poc_msb_cycle_lt.size()) {
+      delta_poc_msb_cycle_lt += static_cast<int32_t>(
+          slice_segment_header->delta_poc_msb_cycle_lt[msb_cycle_index++]);
+    }
+    bool decodable;
+    if (!delta_poc_msb_present) {
+      decodable =
+          KeepReference(static_cast<int32_t>(poc_lsb_lt), max_poc_lsb - 1);
+    } else {
+      int32_t poc_lt =
+          picture.poc - delta_poc_msb_cycle_lt * max_poc_lsb -
+          (static_cast<int32_t>(slice_segment_header->slice_pic_order_cnt_lsb) -
+           static_cast<int32_t>(poc_lsb_lt));
+      decodable = KeepReference(poc_lt, kFullPoc);
+    }
+    if (used_by_curr_pic_lt && !decodable) {
+      references_decodable = false;
+    }
+  }
+
+  // pictures not in the RPS are no longer available for reference
+  dpb.swap(next_dpb);
+  // IRAP pictures are intra-coded (their RPS only lists pictures kept for
+  // their leading pictures)
+  if (nal_unit_type >= NalUnitType::BLA_W_LP &&
+      nal_unit_type <= NalUnitType::RSV_IRAP_VCL23) {
+    references_decodable = true;
+  }
+  picture.references_decodable = references_decodable;
+  if (!references_decodable) {
+    stats.pictures_missing_references++;
+  }
+}
+
+}  // namespace h265nal
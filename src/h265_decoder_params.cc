@@ -0,0 +1,665 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_decoder_params.h"
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "h265_common.h"
+#include "h265_pps_scc_extension_parser.h"
+#include "h265_pred_weight_table_parser.h"
+#include "h265_scaling_list_data_parser.h"
+#include "h265_sps_range_extension_parser.h"
+#include "h265_st_ref_pic_set_parser.h"
+
+namespace h265nal {
+
+namespace {
+
+bool IsIdr(uint32_t nal_unit_type) {
+  return nal_unit_type == IDR_W_RADL || nal_unit_type == IDR_N_LP;
+}
+
+// Section 7.4.7.3 ranges (the parser does not check them).
+bool IsInRange(int32_t value, int32_t min, int32_t max) {
+  return value >= min && value <= max;
+}
+
+// Table 7-6: default values of ScalingList[1..3][matrixId][i], in
+// up-right diagonal scan order
+const uint8_t kDefaultScalingListIntra[64] = {
+    16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 17, 16, 17, 16, 17, 18,
+    17, 18, 18, 17, 18, 21, 19, 20, 21, 20, 19, 21, 24, 22, 22, 24,
+    24, 22, 22, 24, 25, 25, 27, 30, 27, 25, 25, 29, 31, 35, 35, 31,
+    29, 36, 41, 44, 41, 36, 47, 54, 54, 47, 65, 70, 65, 88, 88, 115};
+const uint8_t kDefaultScalingListInter[64] = {
+    16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 17, 17, 17, 17, 17, 18,
+    18, 18, 18, 18, 18, 20, 20, 20, 20, 20, 20, 20, 24, 24, 24, 24,
+    24, 24, 24, 24, 25, 25, 25, 25, 25, 25, 25, 28, 28, 28, 28, 28,
+    28, 33, 33, 33, 33, 33, 41, 41, 41, 41, 54, 54, 54, 71, 71, 91};
+
+// Up-right diagonal scan (Section 6.5.3) of a `size`x`size` block: raster
+// position (y * size + x) of each scan position.
+void GetDiagonalScan(uint32_t size, uint32_t* scan) {
+  uint32_t i = 0;
+  for (uint32_t line = 0; i < size * size; line++) {
+    // walk the anti-diagonal x + y = line, from bottom-left to top-right
+    for (uint32_t x = 0; x <= line; x++) {
+      uint32_t y = line - x;
+      if (x < size && y < size) {
+        scan[i++] = y * size + x;
+      }
+    }
+  }
+}
+
+// Derive the scaling factors (Section 7.4.5) from a scaling_list_data()
+// (nullptr for the default lists).
+bool DeriveScalingFactors(
+    const H265ScalingListDataParser::ScalingListDataState* scaling_list_data,
+    H265DecoderParams::PicParams* pic_params) {
+  // coefficients in scan order, and DC values
+  uint8_t lists[4][6][64] = {};
+  uint8_t dc[4][6] = {};
+  uint32_t scan4x4[16];
+  uint32_t scan8x8[64];
+  GetDiagonalScan(4, scan4x4);
+  GetDiagonalScan(8, scan8x8);
+
+  for (uint32_t sizeId = 0; sizeId < 4; sizeId++) {
+    uint32_t coefNum = (sizeId == 0) ? 16 : 64;
+    uint32_t matrixIdStep = (sizeId == 3) ? 3 : 1;
+    for (uint32_t matrixId = 0; matrixId < 6; matrixId += matrixIdStep) {
+      uint8_t* list = lists[sizeId][matrixId];
+      uint32_t scaling_list_pred_mode_flag = 0;
+      uint32_t scaling_list_pred_matrix_id_delta = 0;
+      if (scaling_list_data != nullptr) {
+        scaling_list_pred_mode_flag =
+            scaling_list_data->scaling_list_pred_mode_flag[sizeId][matrixId];
+        scaling_list_pred_matrix_id_delta =
+            scaling_list_data
+                ->scaling_list_pred_matrix_id_delta[sizeId][matrixId];
+      }
+
+      if (scaling_list_pred_mode_flag) {
+        // explicit list
+        const auto& coefs = scaling_list_data->ScalingList[sizeId][matrixId];
+        if (coefs.size() != coefNum) {
+          return false;
+        }
+        for (uint32_t i = 0; i < coefNum; i++) {
+          // Section 7.4.5: "The value of ScalingList[][][] shall be greater
+          // than 0."
+          if (coefs[i] == 0 || coefs[i] > 255) {
+            return false;
+          }
+          list[i] = static_cast<uint8_t>(coefs[i]);
+        }
+        if (sizeId > 1) {
+          int32_t dc_coef = scaling_list_data->scaling_list_dc_coef_minus8
+                                [sizeId - 2][matrixId] +
+                            8;
+          if (dc_coef <= 0 || dc_coef > 255) {
+            return false;
+          }
+          dc[sizeId][matrixId] = static_cast<uint8_t>(dc_coef);
+        }
+
+      } else if (scaling_list_pred_matrix_id_delta == 0) {
+        // default list (Tables 7-5 and 7-6)
+        for (uint32_t i = 0; i < coefNum; i++) {
+          if (sizeId == 0) {
+            list[i] = 16;
+          } else if (matrixId < 3) {
+            list[i] = kDefaultScalingListIntra[i];
+          } else {
+            list[i] = kDefaultScalingListInter[i];
+          }
+        }
+        dc[sizeId][matrixId] = 16;
+
+      } else {
+        // copy of a previous list (Equation 7-42)
+        uint32_t delta = scaling_list_pred_matrix_id_delta * matrixIdStep;
+        if (delta > matrixId) {
+          return false;
+        }
+        uint32_t refMatrixId = matrixId - delta;
+        for (uint32_t i = 0; i < coefNum; i++) {
+          list[i] = lists[sizeId][refMatrixId][i];
+        }
+        dc[sizeId][matrixId] = dc[sizeId][refMatrixId];
+      }
+    }
+  }
+
+  // scan order to matrix order (Equations 7-39 to 7-41)
+  for (uint32_t matrixId = 0; matrixId < 6; matrixId++) {
+    for (uint32_t i = 0; i < 16; i++) {
+      pic_params->ScalingFactor4x4[matrixId][scan4x4[i]] =
+          lists[0][matrixId][i];
+    }
+    for (uint32_t i = 0; i < 64; i++) {
+      pic_params->ScalingFactor8x8[matrixId][scan8x8[i]] =
+          lists[1][matrixId][i];
+      pic_params->ScalingFactor16x16[matrixId][scan8x8[i]] =
+          lists[2][matrixId][i];
+    }
+    pic_params->ScalingFactorDc16x16[matrixId] = dc[2][matrixId];
+  }
+  for (uint32_t matrixId = 0; matrixId < 2; matrixId++) {
+    for (uint32_t i = 0; i < 64; i++) {
+      pic_params->ScalingFactor32x32[matrixId][scan8x8[i]] =
+          lists[3][matrixId * 3][i];
+    }
+    pic_params->ScalingFactorDc32x32[matrixId] = dc[3][matrixId * 3];
+  }
+  return true;
+}
+
+// Derive the tile column widths and row heights, and their boundaries
+// (Equations 6-3 to 6-6).
+bool DeriveTiles(const H265PpsParser::PpsState& pps,
+                 H265DecoderParams::PicParams* pic_params) {
+  uint32_t num_tile_columns = 1;
+  uint32_t num_tile_rows = 1;
+  if (pps.tiles_enabled_flag) {
+    if (pps.num_tile_columns_minus1 >= H265DecoderParams::kMaxTileColumns ||
+        pps.num_tile_rows_minus1 >= H265DecoderParams::kMaxTileRows) {
+      return false;
+    }
+    num_tile_columns = pps.num_tile_columns_minus1 + 1;
+    num_tile_rows = pps.num_tile_rows_minus1 + 1;
+  }
+  if (num_tile_columns > pic_params->PicWidthInCtbsY ||
+      num_tile_rows > pic_params->PicHeightInCtbsY) {
+    return false;
+  }
+  pic_params->num_tile_columns = num_tile_columns;
+  pic_params->num_tile_rows = num_tile_rows;
+
+  if (!pps.tiles_enabled_flag || pps.uniform_spacing_flag) {
+    for (uint32_t i = 0; i < num_tile_columns; i++) {
+      pic_params->colWidth[i] =
+          ((i + 1) * pic_params->PicWidthInCtbsY) / num_tile_columns -
+          (i * pic_params->PicWidthInCtbsY) / num_tile_columns;
+    }
+    for (uint32_t j = 0; j < num_tile_rows; j++) {
+      pic_params->rowHeight[j] =
+          ((j + 1) * pic_params->PicHeightInCtbsY) / num_tile_rows -
+          (j * pic_params->PicHeightInCtbsY) / num_tile_rows;
+    }
+  } else {
+    if (pps.column_width_minus1.size() < num_tile_columns - 1 ||
+        pps.row_height_minus1.size() < num_tile_rows - 1) {
+      return false;
+    }
+    uint32_t remaining = pic_params->PicWidthInCtbsY;
+    for (uint32_t i = 0; i < num_tile_columns - 1; i++) {
+      pic_params->colWidth[i] = pps.column_width_minus1[i] + 1;
+      if (pic_params->colWidth[i] >= remaining) {
+        return false;
+      }
+      remaining -= pic_params->colWidth[i];
+    }
+    pic_params->colWidth[num_tile_columns - 1] = remaining;
+    remaining = pic_params->PicHeightInCtbsY;
+    for (uint32_t j = 0; j < num_tile_rows - 1; j++) {
+      pic_params->rowHeight[j] = pps.row_height_minus1[j] + 1;
+      if (pic_params->rowHeight[j] >= remaining) {
+        return false;
+      }
+      remaining -= pic_params->rowHeight[j];
+    }
+    pic_params->rowHeight[num_tile_rows - 1] = remaining;
+  }
+
+  pic_params->colBd[0] = 0;
+  for (uint32_t i = 0; i < num_tile_columns; i++) {
+    pic_params->colBd[i + 1] = pic_params->colBd[i] + pic_params->colWidth[i];
+  }
+  pic_params->rowBd[0] = 0;
+  for (uint32_t j = 0; j < num_tile_rows; j++) {
+    pic_params->rowBd[j + 1] = pic_params->rowBd[j] + pic_params->rowHeight[j];
+  }
+  return true;
+}
+
+// Derive CtbAddrRsToTs (Equation 6-5).
+void DeriveCtbAddrRsToTs(const H265DecoderParams::PicParams& pic_params,
+                         std::vector<uint32_t>* ctb_addr_rs_to_ts) {
+  ctb_addr_rs_to_ts->resize(pic_params.PicSizeInCtbsY);
+  for (uint32_t ctbAddrRs = 0; ctbAddrRs < pic_params.PicSizeInCtbsY;
+       ctbAddrRs++) {
+    uint32_t tbX = ctbAddrRs % pic_params.PicWidthInCtbsY;
+    uint32_t tbY = ctbAddrRs / pic_params.PicWidthInCtbsY;
+    uint32_t tileX = 0;
+    for (uint32_t i = 0; i < pic_params.num_tile_columns; i++) {
+      if (tbX >= pic_params.colBd[i]) {
+        tileX = i;
+      }
+    }
+    uint32_t tileY = 0;
+    for (uint32_t j = 0; j < pic_params.num_tile_rows; j++) {
+      if (tbY >= pic_params.rowBd[j]) {
+        tileY = j;
+      }
+    }
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < tileX; i++) {
+      value += pic_params.rowHeight[tileY] * pic_params.colWidth[i];
+    }
+    for (uint32_t j = 0; j < tileY; j++) {
+      value += pic_params.PicWidthInCtbsY * pic_params.rowHeight[j];
+    }
+    value += (tbY - pic_params.rowBd[tileY]) * pic_params.colWidth[tileX] +
+             tbX - pic_params.colBd[tileX];
+    (*ctb_addr_rs_to_ts)[ctbAddrRs] = value;
+  }
+}
+
+// Derive the reference picture set sizes and POC deltas (Equations 7-52,
+// 7-55, 7-61 and 7-62).
+bool DeriveRps(
+    const H265SliceSegmentHeaderParser::SliceSegmentHeaderState& header,
+    const H265SpsParser::SpsState& sps, const H265PpsParser::PpsState& pps,
+    H265DecoderParams::SliceParams* slice_params) {
+  // short-term
+  const H265StRefPicSetParser::StRefPicSetState* st_ref_pic_set = nullptr;
+  if (IsIdr(header.nal_unit_type)) {
+    // no reference pictures
+  } else if (header.short_term_ref_pic_set_sps_flag) {
+    if (header.short_term_ref_pic_set_idx >= sps.st_ref_pic_set.size()) {
+      return false;
+    }
+    st_ref_pic_set =
+        sps.st_ref_pic_set[header.short_term_ref_pic_set_idx].get();
+  } else {
+    st_ref_pic_set = header.st_ref_pic_set.get();
+  }
+  if (st_ref_pic_set != nullptr) {
+    if (st_ref_pic_set->num_negative_pics > H265DecoderParams::kMaxRefs ||
+        st_ref_pic_set->num_positive_pics > H265DecoderParams::kMaxRefs ||
+        st_ref_pic_set->delta_poc_s0_minus1.size() <
+            st_ref_pic_set->num_negative_pics ||
+        st_ref_pic_set->used_by_curr_pic_s0_flag.size() <
+            st_ref_pic_set->num_negative_pics ||
+        st_ref_pic_set->delta_poc_s1_minus1.size() <
+            st_ref_pic_set->num_positive_pics ||
+        st_ref_pic_set->used_by_curr_pic_s1_flag.size() <
+            st_ref_pic_set->num_positive_pics) {
+      return false;
+    }
+    slice_params->NumNegativePics = st_ref_pic_set->num_negative_pics;
+    slice_params->NumPositivePics = st_ref_pic_set->num_positive_pics;
+    int32_t delta_poc = 0;
+    for (uint32_t i = 0; i < st_ref_pic_set->num_negative_pics; i++) {
+      delta_poc -=
+          static_cast<int32_t>(st_ref_pic_set->delta_poc_s0_minus1[i]) + 1;
+      slice_params->DeltaPocS0[i] = delta_poc;
+      slice_params->UsedByCurrPicS0[i] =
+          st_ref_pic_set->used_by_curr_pic_s0_flag[i] ? 1 : 0;
+      slice_params->NumPocStCurrBefore += slice_params->UsedByCurrPicS0[i];
+    }
+    delta_poc = 0;
+    for (uint32_t i = 0; i < st_ref_pic_set->num_positive_pics; i++) {
+      delta_poc +=
+          static_cast<int32_t>(st_ref_pic_set->delta_poc_s1_minus1[i]) + 1;
+      slice_params->DeltaPocS1[i] = delta_poc;
+      slice_params->UsedByCurrPicS1[i] =
+          st_ref_pic_set->used_by_curr_pic_s1_flag[i] ? 1 : 0;
+      slice_params->NumPocStCurrAfter += slice_params->UsedByCurrPicS1[i];
+    }
+  }
+
+  // long-term
+  uint32_t num_long_term_sps = 0;
+  uint32_t num_long_term = 0;
+  if (header.long_term_ref_pics_present_flag && !IsIdr(header.nal_unit_type)) {
+    if (static_cast<uint64_t>(header.num_long_term_sps) +
+            header.num_long_term_pics >
+        H265DecoderParams::kMaxLongTermRefs) {
+      return false;
+    }
+    num_long_term_sps = header.num_long_term_sps;
+    num_long_term = num_long_term_sps + header.num_long_term_pics;
+  }
+  if (header.delta_poc_msb_present_flag.size() < num_long_term ||
+      header.poc_lsb_lt.size() < num_long_term - num_long_term_sps ||
+      header.used_by_curr_pic_lt_flag.size() <
+          num_long_term - num_long_term_sps) {
+    return false;
+  }
+  slice_params->num_long_term = num_long_term;
+  // delta_poc_msb_cycle_lt[] only has the present values
+  size_t msb_cycle_index = 0;
+  for (uint32_t i = 0; i < num_long_term; i++) {
+    if (i < num_long_term_sps) {
+      // lt_idx_sps[i] is inferred to be 0 when not present
+      uint32_t lt_idx_sps =
+          (i < header.lt_idx_sps.size()) ? header.lt_idx_sps[i] : 0;
+      if (lt_idx_sps >= sps.lt_ref_pic_poc_lsb_sps.size() ||
+          lt_idx_sps >= sps.used_by_curr_pic_lt_sps_flag.size()) {
+        return false;
+      }
+      slice_params->PocLsbLt[i] = sps.lt_ref_pic_poc_lsb_sps[lt_idx_sps];
+      slice_params->UsedByCurrPicLt[i] =
+          sps.used_by_curr_pic_lt_sps_flag[lt_idx_sps] ? 1 : 0;
+    } else {
+      slice_params->PocLsbLt[i] = header.poc_lsb_lt[i - num_long_term_sps];
+      slice_params->UsedByCurrPicLt[i] =
+          header.used_by_curr_pic_lt_flag[i - num_long_term_sps] ? 1 : 0;
+    }
+    slice_params->NumPocLtCurr += slice_params->UsedByCurrPicLt[i];
+
+    uint32_t delta_poc_msb_cycle_lt = 0;
+    if (header.delta_poc_msb_present_flag[i]) {
+      slice_params->delta_poc_msb_present_flag[i] = 1;
+      if (msb_cycle_index >= header.delta_poc_msb_cycle_lt.size()) {
+        return false;
+      }
+      delta_poc_msb_cycle_lt =
+          header.delta_poc_msb_cycle_lt[msb_cycle_index++];
+    }
+    slice_params->DeltaPocMsbCycleLt[i] =
+        (i == 0 || i == num_long_term_sps)
+            ? delta_poc_msb_cycle_lt
+            : delta_poc_msb_cycle_lt + slice_params->DeltaPocMsbCycleLt[i - 1];
+  }
+
+  slice_params->NumPicTotalCurr = slice_params->NumPocStCurrBefore +
+                                  slice_params->NumPocStCurrAfter +
+                                  slice_params->NumPocLtCurr;
+  if (pps.pps_scc_extension != nullptr &&
+      pps.pps_scc_extension->pps_curr_pic_ref_enabled_flag) {
+    slice_params->NumPicTotalCurr++;
+  }
+  return true;
+}
+
+// Derive the weighted prediction variables (Equations 7-56 and 7-57).
+bool DerivePredWeightTable(
+    const H265SliceSegmentHeaderParser::SliceSegmentHeaderState& header,
+    const H265SpsParser::SpsState& sps,
+    H265DecoderParams::SliceParams* slice_params) {
+  const auto* pred_weight_table = header.pred_weight_table.get();
+  uint32_t luma_log2_weight_denom = 0;
+  int32_t ChromaLog2WeightDenom = 0;
+  if (pred_weight_table != nullptr) {
+    luma_log2_weight_denom = pred_weight_table->luma_log2_weight_denom;
+    ChromaLog2WeightDenom =
+        static_cast<int32_t>(luma_log2_weight_denom) +
+        pred_weight_table->delta_chroma_log2_weight_denom;
+  }
+  // Section 7.4.7.3: both shall be in the range of 0 to 7, inclusive
+  if (luma_log2_weight_denom > 7 || ChromaLog2WeightDenom < 0 ||
+      ChromaLog2WeightDenom > 7) {
+    return false;
+  }
+  slice_params->luma_log2_weight_denom = luma_log2_weight_denom;
+  slice_params->ChromaLog2WeightDenom =
+      static_cast<uint32_t>(ChromaLog2WeightDenom);
+
+  // default weights
+  for (uint32_t i = 0; i < H265DecoderParams::kMaxRefs; i++) {
+    slice_params->LumaWeightL0[i] = 1 << luma_log2_weight_denom;
+    for (uint32_t j = 0; j < 2; j++) {
+      slice_params->ChromaWeightL0[i][j] = 1 << ChromaLog2WeightDenom;
+    }
+  }
+  if (pred_weight_table == nullptr) {
+    return true;
+  }
+
+  const auto& luma_weight_l0_flag = pred_weight_table->luma_weight_l0_flag;
+  const auto& chroma_weight_l0_flag = pred_weight_table->chroma_weight_l0_flag;
+  if (luma_weight_l0_flag.size() > H265DecoderParams::kMaxRefs) {
+    return false;
+  }
+  uint32_t BitDepthC = sps.bit_depth_chroma_minus8 + 8;
+  bool high_precision_offsets_enabled_flag =
+      sps.sps_range_extension != nullptr &&
+      sps.sps_range_extension->high_precision_offsets_enabled_flag;
+  int32_t wpOffsetHalfRangeC =
+      1 << (high_precision_offsets_enabled_flag ? (BitDepthC - 1) : 7);
+  // the delta vectors only have the entries whose flag is set
+  size_t luma_index = 0;
+  size_t chroma_index = 0;
+  for (size_t i = 0; i < luma_weight_l0_flag.size(); i++) {
+    if (luma_weight_l0_flag[i]) {
+      if (luma_index >= pred_weight_table->delta_luma_weight_l0.size() ||
+          luma_index >= pred_weight_table->luma_offset_l0.size() ||
+          !IsInRange(pred_weight_table->delta_luma_weight_l0[luma_index],
+                     -128, 127)) {
+        return false;
+      }
+      slice_params->LumaWeightL0[i] +=
+          pred_weight_table->delta_luma_weight_l0[luma_index];
+      slice_params->luma_offset_l0[i] =
+          pred_weight_table->luma_offset_l0[luma_index];
+      luma_index++;
+    }
+    if (i < chroma_weight_l0_flag.size() && chroma_weight_l0_flag[i]) {
+      if (chroma_index >= pred_weight_table->delta_chroma_weight_l0.size() ||
+          chroma_index >= pred_weight_table->delta_chroma_offset_l0.size()) {
+        return false;
+      }
+      const auto& delta_chroma_weight =
+          pred_weight_table->delta_chroma_weight_l0[chroma_index];
+      const auto& delta_chroma_offset =
+          pred_weight_table->delta_chroma_offset_l0[chroma_index];
+      if (delta_chroma_weight.size() < 2 || delta_chroma_offset.size() < 2) {
+        return false;
+      }
+      for (uint32_t j = 0; j < 2; j++) {
+        if (!IsInRange(delta_chroma_weight[j], -128, 127) ||
+            !IsInRange(delta_chroma_offset[j], -4 * wpOffsetHalfRangeC,
+                       4 * wpOffsetHalfRangeC - 1)) {
+          return false;
+        }
+        int32_t ChromaWeight =
+            slice_params->ChromaWeightL0[i][j] + delta_chroma_weight[j];
+        int32_t ChromaOffset =
+            wpOffsetHalfRangeC + delta_chroma_offset[j] -
+            ((wpOffsetHalfRangeC * ChromaWeight) >> ChromaLog2WeightDenom);
+        if (ChromaOffset < -wpOffsetHalfRangeC) {
+          ChromaOffset = -wpOffsetHalfRangeC;
+        } else if (ChromaOffset > wpOffsetHalfRangeC - 1) {
+          ChromaOffset = wpOffsetHalfRangeC - 1;
+        }
+        slice_params->ChromaWeightL0[i][j] = ChromaWeight;
+        slice_params->ChromaOffsetL0[i][j] = ChromaOffset;
+      }
+      chroma_index++;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+const H265DecoderParams::PpsEntry* H265DecoderParams::GetPpsEntry(
+    uint32_t pps_id,
+    const H265BitstreamParserState& bitstream_parser_state) noexcept {
+  auto pps = bitstream_parser_state.GetPps(pps_id);
+  if (pps == nullptr) {
+    return nullptr;
+  }
+  auto sps = bitstream_parser_state.GetSps(pps->pps_seq_parameter_set_id);
+  if (sps == nullptr) {
+    return nullptr;
+  }
+
+  // cached (the entry keeps the states alive, so their addresses cannot be
+  // reused by new ones)
+  auto it = pps_entries.find(pps_id);
+  if (it != pps_entries.end() && it->second.pps == pps &&
+      it->second.sps == sps) {
+    return &it->second;
+  }
+  if (it != pps_entries.end()) {
+    pps_entries.erase(it);
+  }
+
+  PpsEntry entry;
+  PicParams& pic_params = entry.pic_params;
+  pic_params.sps_id = pps->pps_seq_parameter_set_id;
+  pic_params.pps_id = pps_id;
+  pic_params.ChromaArrayType =
+      sps->separate_colour_plane_flag ? 0 : sps->chroma_format_idc;
+  pic_params.BitDepthY = sps->bit_depth_luma_minus8 + 8;
+  pic_params.BitDepthC = sps->bit_depth_chroma_minus8 + 8;
+  pic_params.MinCbLog2SizeY = sps->getMinCbLog2SizeY();
+  pic_params.MinCbSizeY = sps->getMinCbSizeY();
+  pic_params.CtbLog2SizeY = sps->getCtbLog2SizeY();
+  pic_params.CtbSizeY = sps->getCtbSizeY();
+  pic_params.PicWidthInMinCbsY = sps->getPicWidthInMinCbsY();
+  pic_params.PicHeightInMinCbsY = sps->getPicHeightInMinCbsY();
+  pic_params.PicWidthInCtbsY = sps->getPicWidthInCtbsY();
+  pic_params.PicHeightInCtbsY = sps->getPicHeightInCtbsY();
+  pic_params.PicSizeInCtbsY = sps->getPicSizeInCtbsY();
+  pic_params.MinTbLog2SizeY =
+      sps->log2_min_luma_transform_block_size_minus2 + 2;
+  pic_params.MaxTbLog2SizeY =
+      pic_params.MinTbLog2SizeY +
+      sps->log2_diff_max_min_luma_transform_block_size;
+  if (pic_params.PicSizeInCtbsY == 0 ||
+      pps->diff_cu_qp_delta_depth > pic_params.CtbLog2SizeY) {
+    return nullptr;
+  }
+  pic_params.Log2MinCuQpDeltaSize =
+      pic_params.CtbLog2SizeY - pps->diff_cu_qp_delta_depth;
+  pic_params.Log2ParMrgLevel = pps->log2_parallel_merge_level_minus2 + 2;
+  pic_params.init_qp = 26 + pps->init_qp_minus26;
+
+  if (!DeriveTiles(*pps, &pic_params)) {
+    return nullptr;
+  }
+
+  // the PPS scaling lists replace the SPS ones
+  const H265ScalingListDataParser::ScalingListDataState* scaling_list_data =
+      nullptr;
+  if (pps->pps_scaling_list_data_present_flag) {
+    scaling_list_data = pps->scaling_list_data.get();
+  } else if (sps->sps_scaling_list_data_present_flag) {
+    scaling_list_data = sps->scaling_list_data.get();
+  }
+  if (!sps->scaling_list_enabled_flag) {
+    // flat
+    memset(pic_params.ScalingFactor4x4, 16,
+           sizeof(pic_params.ScalingFactor4x4));
+    memset(pic_params.ScalingFactor8x8, 16,
+           sizeof(pic_params.ScalingFactor8x8));
+    memset(pic_params.ScalingFactor16x16, 16,
+           sizeof(pic_params.ScalingFactor16x16));
+    memset(pic_params.ScalingFactor32x32, 16,
+           sizeof(pic_params.ScalingFactor32x32));
+    memset(pic_params.ScalingFactorDc16x16, 16,
+           sizeof(pic_params.ScalingFactorDc16x16));
+    memset(pic_params.ScalingFactorDc32x32, 16,
+           sizeof(pic_params.ScalingFactorDc32x32));
+  } else if (!DeriveScalingFactors(scaling_list_data, &pic_params)) {
+    return nullptr;
+  }
+
+  DeriveCtbAddrRsToTs(pic_params, &entry.ctb_addr_rs_to_ts);
+  entry.pps = pps;
+  entry.sps = sps;
+  it = pps_entries.emplace(pps_id, std::move(entry)).first;
+  return &it->second;
+}
+
+const H265DecoderParams::PicParams* H265DecoderParams::GetPicParams(
+    uint32_t pps_id,
+    const H265BitstreamParserState& bitstream_parser_state) noexcept {
+  const PpsEntry* entry = GetPpsEntry(pps_id, bitstream_parser_state);
+  return (entry != nullptr) ? &entry->pic_params : nullptr;
+}
+
+const std::vector<uint32_t>* H265DecoderParams::GetCtbAddrRsToTs(
+    uint32_t pps_id,
+    const H265BitstreamParserState& bitstream_parser_state) noexcept {
+  const PpsEntry* entry = GetPpsEntry(pps_id, bitstream_parser_state);
+  return (entry != nullptr) ? &entry->ctb_addr_rs_to_ts : nullptr;
+}
+
+bool H265DecoderParams::GetSliceParams(
+    const H265SliceSegmentHeaderParser::SliceSegmentHeaderState&
+        slice_segment_header,
+    const H265BitstreamParserState& bitstream_parser_state,
+    SliceParams* slice_params) noexcept {
+  const PpsEntry* entry = GetPpsEntry(
+      slice_segment_header.slice_pic_parameter_set_id, bitstream_parser_state);
+  if (entry == nullptr) {
+    return false;
+  }
+  uint32_t slice_segment_address =
+      slice_segment_header.first_slice_segment_in_pic_flag
+          ? 0
+          : slice_segment_header.slice_segment_address;
+  if (slice_segment_address >= entry->ctb_addr_rs_to_ts.size()) {
+    return false;
+  }
+
+  if (slice_segment_header.dependent_slice_segment_flag) {
+    // the slice segment header only has the address
+    if (!has_last_slice_params ||
+        last_slice_params.pps_id !=
+            slice_segment_header.slice_pic_parameter_set_id) {
+      return false;
+    }
+    *slice_params = last_slice_params;
+    slice_params->dependent_slice_segment_flag = 1;
+    slice_params->slice_segment_address = slice_segment_address;
+    slice_params->ctb_addr_in_ts =
+        entry->ctb_addr_rs_to_ts[slice_segment_address];
+    return true;
+  }
+
+  *slice_params = SliceParams();
+  const H265PpsParser::PpsState& pps = *entry->pps;
+  slice_params->pps_id = slice_segment_header.slice_pic_parameter_set_id;
+  slice_params->slice_type = slice_segment_header.slice_type;
+  slice_params->slice_segment_address = slice_segment_address;
+  slice_params->ctb_addr_in_ts =
+      entry->ctb_addr_rs_to_ts[slice_segment_address];
+  slice_params->SliceQpY =
+      entry->pic_params.init_qp + slice_segment_header.slice_qp_delta;
+  slice_params->MaxNumMergeCand =
+      5 - slice_segment_header.five_minus_max_num_merge_cand;
+  if (slice_segment_header.slice_type != SliceType_I) {
+    // Section 7.4.7.1: the PPS defaults unless overridden
+    if (slice_segment_header.num_ref_idx_active_override_flag) {
+      slice_params->num_ref_idx_l0_active =
+          slice_segment_header.num_ref_idx_l0_active_minus1 + 1;
+      slice_params->num_ref_idx_l1_active =
+          slice_segment_header.num_ref_idx_l1_active_minus1 + 1;
+    } else {
+      slice_params->num_ref_idx_l0_active =
+          pps.num_ref_idx_l0_default_active_minus1 + 1;
+      slice_params->num_ref_idx_l1_active =
+          pps.num_ref_idx_l1_default_active_minus1 + 1;
+    }
+    if (slice_segment_header.slice_type != SliceType_B) {
+      slice_params->num_ref_idx_l1_active = 0;
+    }
+  }
+
+  if (!DeriveRps(slice_segment_header, *entry->sps, pps, slice_params) ||
+      !DerivePredWeightTable(slice_segment_header, *entry->sps,
+                             slice_params)) {
+    return false;
+  }
+
+  last_slice_params = *slice_params;
+  has_last_slice_params = true;
+  return true;
+}
+
+}  // namespace h265nal
@@ -0,0 +1,170 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_error.h"
+
+#include <stdio.h>
+
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+struct ErrorReporterState {
+  // error ring
+  std::array<h265nal::H265Error, h265nal::H265ErrorReporter::kRingSize> ring;
+  uint64_t error_count = 0;
+  size_t nal_index = 0;
+  // callback
+  h265nal::H265ErrorReporter::Callback callback = nullptr;
+  void* opaque = nullptr;
+  // default logging rate limiter
+  int64_t log_window = -1;
+  uint32_t log_count = 0;
+  uint64_t log_suppressed = 0;
+};
+
+thread_local ErrorReporterState state;
+
+#ifdef FPRINT_ERRORS
+void LogError(const h265nal::H265Error& error) {
+  // fixed 1-second windows
+  int64_t window = std::chrono::duration_cast<std::chrono::seconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                       .count();
+  if (window != state.log_window) {
+    if (state.log_suppressed > 0) {
+      fprintf(stderr, "error: %" PRIu64 " more errors suppressed\n",
+              state.log_suppressed);
+    }
+    state.log_window = window;
+    state.log_count = 0;
+    state.log_suppressed = 0;
+  }
+  if (state.log_count >= h265nal::H265ErrorReporter::kMaxLogsPerSecond) {
+    state.log_suppressed++;
+    return;
+  }
+  state.log_count++;
+  h265nal::H265ErrorReporter::Print(stderr, error);
+}
+#endif  // FPRINT_ERRORS
+
+}  // namespace
+
+namespace h265nal {
+
+constexpr size_t H265ErrorReporter::kRingSize;
+constexpr uint32_t H265ErrorReporter::kMaxLogsPerSecond;
+
+void H265ErrorReporter::SetCallback(Callback callback, void* opaque) noexcept {
+  state.callback = callback;
+  state.opaque = opaque;
+}
+
+void H265ErrorReporter::SetNalIndex(size_t nal_index) noexcept {
+  state.nal_index = nal_index;
+}
+
+void H265ErrorReporter::Report(H265ErrorCode code, const char* parser,
+                               const char* element,
+                               BitBuffer* bit_buffer) noexcept {
+  Report(code, parser, element, bit_buffer, 0, 0, 0);
+}
+
+void H265ErrorReporter::Report(H265ErrorCode code, const char* parser,
+                               const char* element, BitBuffer* bit_buffer,
+                               int64_t value, int64_t min,
+                               int64_t max) noexcept {
+  H265Error& error = state.ring[state.error_count % kRingSize];
+  state.error_count++;
+  error.code = code;
+  error.parser = parser;
+  error.element = element;
+  error.value = value;
+  error.min = min;
+  error.max = max;
+  error.nal_index = state.nal_index;
+  error.bit_offset = 0;
+  if (bit_buffer != nullptr) {
+    size_t byte_offset, bit_offset;
+    bit_buffer->GetCurrentOffset(&byte_offset, &bit_offset);
+    error.bit_offset = byte_offset * 8 + bit_offset;
+  }
+
+  if (state.callback != nullptr) {
+    state.callback(error, state.opaque);
+    return;
+  }
+#ifdef FPRINT_ERRORS
+  LogError(error);
+#endif  // FPRINT_ERRORS
+}
+
+uint64_t H265ErrorReporter::GetErrorCount() noexcept {
+  return state.error_count;
+}
+
+std::vector<H265Error> H265ErrorReporter::GetErrors() noexcept {
+  std::vector<H265Error> errors;
+  uint64_t first =
+      (state.error_count > kRingSize) ? (state.error_count - kRingSize) : 0;
+  for (uint64_t i = first; i < state.error_count; i++) {
+    errors.push_back(state.ring[i % kRingSize]);
+  }
+  return errors;
+}
+
+void H265ErrorReporter::Reset() noexcept {
+  state.error_count = 0;
+  state.nal_index = 0;
+  state.log_window = -1;
+  state.log_count = 0;
+  state.log_suppressed = 0;
+}
+
+const char* H265ErrorReporter::ErrorCodeToString(H265ErrorCode code) noexcept {
+  switch (code) {
+    case H265ErrorCode_None:
+      return "none";
+    case H265ErrorCode_OutOfRange:
+      return "out of range";
+    case H265ErrorCode_InvalidValue:
+      return "invalid value";
+    case H265ErrorCode_Unimplemented:
+      return "unimplemented";
+    case H265ErrorCode_MissingParameterSet:
+      return "missing parameter set";
+    case H265ErrorCode_Truncated:
+      return "truncated";
+    case H265ErrorCode_ParseFailed:
+      return "parse failed";
+    case H265ErrorCode_BudgetExceeded:
+      return "budget exceeded";
+  }
+  return "unknown";
+}
+
+void H265ErrorReporter::Print(FILE* outfp, const H265Error& error) noexcept {
+  fprintf(outfp, "error: %s: nal_index: %zu bit_offset: %zu: %s",
+          (error.parser != nullptr) ? error.parser : "", error.nal_index,
+          error.bit_offset, (error.element != nullptr) ? error.element : "");
+  if (error.code == H265ErrorCode_OutOfRange) {
+    fprintf(outfp, ": %" PRId64 " not in range [%" PRId64 ", %" PRId64 "]",
+            error.value, error.min, error.max);
+  } else if (error.code == H265ErrorCode_BudgetExceeded) {
+    fprintf(outfp, ": %" PRId64 " over limit %" PRId64, error.value,
+            error.max);
+  } else if (error.code == H265ErrorCode_InvalidValue ||
+             error.code == H265ErrorCode_MissingParameterSet ||
+             error.code == H265ErrorCode_Truncated) {
+    fprintf(outfp, ": %" PRId64, error.value);
+  }
+  fprintf(outfp, " (%s)\n", ErrorCodeToString(error.code));
+}
+
+}  // namespace h265nal
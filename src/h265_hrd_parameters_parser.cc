@@ -12,6 +12,7 @@
 
 #include "h265_common.h"
 #include "h265_sub_layer_hrd_parameters_parser.h"
+#include "h265_trace.h"
 
 namespace h265nal {
 
@@ -52,12 +53,16 @@ H265HrdParametersParser::ParseHrdParameters(
             1, hrd_parameters->nal_hrd_parameters_present_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "nal_hrd_parameters_present_flag", 1,
+                 hrd_parameters->nal_hrd_parameters_present_flag);
 
     // vcl_hrd_parameters_present_flag  u(1)
     if (!bit_buffer->ReadBits(
             1, hrd_parameters->vcl_hrd_parameters_present_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "vcl_hrd_parameters_present_flag", 1,
+                 hrd_parameters->vcl_hrd_parameters_present_flag);
 
     if (hrd_parameters->nal_hrd_parameters_present_flag ||
         hrd_parameters->vcl_hrd_parameters_present_flag) {
@@ -66,12 +71,16 @@ H265HrdParametersParser::ParseHrdParameters(
               1, hrd_parameters->sub_pic_hrd_params_present_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "sub_pic_hrd_params_present_flag", 1,
+                   hrd_parameters->sub_pic_hrd_params_present_flag);
 
       if (hrd_parameters->sub_pic_hrd_params_present_flag) {
         // tick_divisor_minus2  u(8)
         if (!bit_buffer->ReadBits(8, hrd_parameters->tick_divisor_minus2)) {
           return nullptr;
         }
+        H265Trace::u(bit_buffer, "tick_divisor_minus2", 8,
+                     hrd_parameters->tick_divisor_minus2);
 
         // du_cpb_removal_delay_increment_length_minus1  u(5)
         if (!bit_buffer->ReadBits(
@@ -79,35 +88,48 @@ H265HrdParametersParser::ParseHrdParameters(
                 hrd_parameters->du_cpb_removal_delay_increment_length_minus1)) {
           return nullptr;
         }
+        H265Trace::u(
+            bit_buffer, "du_cpb_removal_delay_increment_length_minus1", 5,
+            hrd_parameters->du_cpb_removal_delay_increment_length_minus1);
 
         // sub_pic_cpb_params_in_pic_timing_sei_flag  u(1)
         if (!bit_buffer->ReadBits(
                 1, hrd_parameters->sub_pic_cpb_params_in_pic_timing_sei_flag)) {
           return nullptr;
         }
+        H265Trace::u(bit_buffer, "sub_pic_cpb_params_in_pic_timing_sei_flag", 1,
+                     hrd_parameters->sub_pic_cpb_params_in_pic_timing_sei_flag);
 
         // dpb_output_delay_du_length_minus1  u(5)
         if (!bit_buffer->ReadBits(
                 5, hrd_parameters->dpb_output_delay_du_length_minus1)) {
           return nullptr;
         }
+        H265Trace::u(bit_buffer, "dpb_output_delay_du_length_minus1", 5,
+                     hrd_parameters->dpb_output_delay_du_length_minus1);
       }
 
       // bit_rate_scale  u(4)
       if (!bit_buffer->ReadBits(4, hrd_parameters->bit_rate_scale)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "bit_rate_scale", 4,
+                   hrd_parameters->bit_rate_scale);
 
       // cpb_size_scale  u(4)
       if (!bit_buffer->ReadBits(4, hrd_parameters->cpb_size_scale)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "cpb_size_scale", 4,
+                   hrd_parameters->cpb_size_scale);
 
       if (hrd_parameters->sub_pic_hrd_params_present_flag) {
         // cpb_size_du_scale  u(4)
         if (!bit_buffer->ReadBits(4, hrd_parameters->cpb_size_du_scale)) {
           return nullptr;
         }
+        H265Trace::u(bit_buffer, "cpb_size_du_scale", 4,
+                     hrd_parameters->cpb_size_du_scale);
       }
 
       // initial_cpb_removal_delay_length_minus1  u(5)
@@ -115,18 +137,24 @@ H265HrdParametersParser::ParseHrdParameters(
               5, hrd_parameters->initial_cpb_removal_delay_length_minus1)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "initial_cpb_removal_delay_length_minus1", 5,
+                   hrd_parameters->initial_cpb_removal_delay_length_minus1);
 
       // au_cpb_removal_delay_length_minus1  u(5)
       if (!bit_buffer->ReadBits(
               5, hrd_parameters->au_cpb_removal_delay_length_minus1)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "au_cpb_removal_delay_length_minus1", 5,
+                   hrd_parameters->au_cpb_removal_delay_length_minus1);
 
       // dpb_output_delay_length_minus1  u(5)
       if (!bit_buffer->ReadBits(
               5, hrd_parameters->dpb_output_delay_length_minus1)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "dpb_output_delay_length_minus1", 5,
+                   hrd_parameters->dpb_output_delay_length_minus1);
     }
   }
 
@@ -135,6 +163,7 @@ H265HrdParametersParser::ParseHrdParameters(
     if (!bit_buffer->ReadBits(1, bits_tmp)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "fixed_pic_rate_general_flag", 1, bits_tmp, i);
     hrd_parameters->fixed_pic_rate_general_flag.push_back(bits_tmp);
 
     if (!hrd_parameters->fixed_pic_rate_general_flag[i]) {
@@ -142,6 +171,8 @@ H265HrdParametersParser::ParseHrdParameters(
       if (!bit_buffer->ReadBits(1, bits_tmp)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "fixed_pic_rate_within_cvs_flag", 1, bits_tmp,
+                   i);
       hrd_parameters->fixed_pic_rate_within_cvs_flag.push_back(bits_tmp);
     } else {
       hrd_parameters->fixed_pic_rate_within_cvs_flag.push_back(0);
@@ -152,6 +183,8 @@ H265HrdParametersParser::ParseHrdParameters(
       if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
         return nullptr;
       }
+      H265Trace::ue(bit_buffer, "elemental_duration_in_tc_minus1", golomb_tmp,
+                    i);
       hrd_parameters->elemental_duration_in_tc_minus1.push_back(golomb_tmp);
 
       // need to set low_delay_hrd_flag[i] to 0
@@ -164,6 +197,7 @@ H265HrdParametersParser::ParseHrdParameters(
       if (!bit_buffer->ReadBits(1, bits_tmp)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "low_delay_hrd_flag", 1, bits_tmp, i);
       hrd_parameters->low_delay_hrd_flag.push_back(bits_tmp);
     }
 
@@ -172,6 +206,7 @@ H265HrdParametersParser::ParseHrdParameters(
       if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
         return nullptr;
       }
+      H265Trace::ue(bit_buffer, "cpb_cnt_minus1", golomb_tmp, i);
       hrd_parameters->cpb_cnt_minus1.push_back(golomb_tmp);
     } else {
       // need to set cpb_cnt_minus1[i] to 0
@@ -0,0 +1,549 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_mkv_reader.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_common.h"
+#include "h265_utils.h"
+
+namespace {
+// EBML and Matroska element IDs (RFC 8794, RFC 9559)
+constexpr uint32_t kIdEbml = 0x1a45dfa3;
+constexpr uint32_t kIdSegment = 0x18538067;
+constexpr uint32_t kIdSeekHead = 0x114d9b74;
+constexpr uint32_t kIdSeek = 0x4dbb;
+constexpr uint32_t kIdSeekId = 0x53ab;
+constexpr uint32_t kIdSeekPosition = 0x53ac;
+constexpr uint32_t kIdInfo = 0x1549a966;
+constexpr uint32_t kIdTimecodeScale = 0x2ad7b1;
+constexpr uint32_t kIdTracks = 0x1654ae6b;
+constexpr uint32_t kIdTrackEntry = 0xae;
+constexpr uint32_t kIdTrackNumber = 0xd7;
+constexpr uint32_t kIdCodecId = 0x86;
+constexpr uint32_t kIdCodecPrivate = 0x63a2;
+constexpr uint32_t kIdDefaultDuration = 0x23e383;
+constexpr uint32_t kIdVideo = 0xe0;
+constexpr uint32_t kIdPixelWidth = 0xb0;
+constexpr uint32_t kIdPixelHeight = 0xba;
+constexpr uint32_t kIdCluster = 0x1f43b675;
+constexpr uint32_t kIdTimecode = 0xe7;
+constexpr uint32_t kIdSimpleBlock = 0xa3;
+constexpr uint32_t kIdBlockGroup = 0xa0;
+constexpr uint32_t kIdBlock = 0xa1;
+constexpr uint32_t kIdReferenceBlock = 0xfb;
+constexpr uint32_t kIdCues = 0x1c53bb6b;
+constexpr uint32_t kIdCuePoint = 0xbb;
+constexpr uint32_t kIdCueTime = 0xb3;
+constexpr uint32_t kIdCueTrackPositions = 0xb7;
+constexpr uint32_t kIdCueTrack = 0xf7;
+constexpr uint32_t kIdCueClusterPosition = 0xf1;
+constexpr uint32_t kIdChapters = 0x1043a770;
+constexpr uint32_t kIdTags = 0x1254c367;
+constexpr uint32_t kIdAttachments = 0x1941a469;
+
+constexpr char kCodecIdHevc[] = "V_MPEGH/ISO/HEVC";
+// block header flags: keyframe (SimpleBlock), and lacing
+constexpr uint8_t kBlockFlagKeyframe = 0x80;
+constexpr uint8_t kBlockFlagLacing = 0x06;
+
+// Level 1 elements (the end of an unknown-size cluster).
+bool IsLevel1Id(uint32_t id) {
+  return id == kIdCluster || id == kIdCues || id == kIdSeekHead ||
+         id == kIdInfo || id == kIdTracks || id == kIdChapters ||
+         id == kIdTags || id == kIdAttachments;
+}
+
+// Variable-size integer (RFC 8794 Section 4). Element IDs keep their
+// length marker. Returns the number of bytes read (0 if invalid).
+size_t ReadVint(const uint8_t* p, size_t length, size_t max_size,
+                bool keep_marker, uint64_t* value, bool* all_ones) {
+  if (length == 0 || p[0] == 0) {
+    return 0;
+  }
+  size_t size = 1;
+  while (!(p[0] & (0x80 >> (size - 1)))) {
+    size++;
+  }
+  if (size > max_size || size > length) {
+    return 0;
+  }
+  uint8_t mask = static_cast<uint8_t>(0xff >> size);
+  *value = keep_marker ? p[0] : (p[0] & mask);
+  *all_ones = ((p[0] & mask) == mask);
+  for (size_t i = 1; i < size; i++) {
+    *value = (*value << 8) | p[i];
+    *all_ones = *all_ones && (p[i] == 0xff);
+  }
+  return size;
+}
+
+uint64_t ReadUint(const uint8_t* p, size_t length) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < length && i < 8; i++) {
+    value = (value << 8) | p[i];
+  }
+  return value;
+}
+
+// An element: its ID, and its payload (the data after the element
+// header).
+struct Element {
+  uint32_t id;
+  // full element (header included)
+  size_t size;
+  const uint8_t* payload;
+  size_t payload_length;
+  // unknown-size elements extend to the end of their parent
+  bool unknown_size;
+};
+
+// Read the element at `offset` in a list of elements (e.g. the children of
+// an element). Returns false at the end of the list, or if the element is
+// invalid (e.g. truncated).
+bool ReadElement(const uint8_t* data, size_t offset, size_t length,
+                 Element* element) {
+  if (data == nullptr || offset >= length) {
+    return false;
+  }
+  uint64_t id, size;
+  bool all_ones;
+  size_t id_size =
+      ReadVint(data + offset, length - offset, 4, true, &id, &all_ones);
+  if (id_size == 0) {
+    return false;
+  }
+  size_t size_size = ReadVint(data + offset + id_size,
+                              length - offset - id_size, 8, false, &size,
+                              &all_ones);
+  if (size_size == 0) {
+    return false;
+  }
+  size_t header_size = id_size + size_size;
+  element->id = static_cast<uint32_t>(id);
+  element->payload = data + offset + header_size;
+  element->unknown_size = all_ones;
+  if (all_ones) {
+    size = length - offset - header_size;
+  } else if (size > length - offset - header_size) {
+    return false;
+  }
+  element->payload_length = static_cast<size_t>(size);
+  element->size = header_size + static_cast<size_t>(size);
+  return true;
+}
+
+// Find the first child element with a given ID.
+bool FindElement(const uint8_t* data, size_t length, uint32_t id,
+                 Element* element) {
+  for (size_t offset = 0; ReadElement(data, offset, length, element);
+       offset += element->size) {
+    if (element->id == id) {
+      return true;
+    }
+  }
+  return false;
+}
+}  // namespace
+
+namespace h265nal {
+
+H265MkvReader::H265MkvReader(const Options& options_in)
+    : options(options_in) {}
+
+bool H265MkvReader::Open(const char* filename) noexcept {
+  Close();
+  if (!file.Open(filename)) {
+    return false;
+  }
+  return OpenBuffer(file.GetData(), file.GetLength());
+}
+
+bool H265MkvReader::OpenBuffer(const uint8_t* data_in,
+                               size_t length_in) noexcept {
+  tracks.clear();
+  cue_points.clear();
+  timecode_scale = 1000000;
+  seek_tracks = 0;
+  seek_cues = 0;
+  has_tracks = false;
+  has_cues = false;
+  if (data_in == nullptr) {
+    return false;
+  }
+  data = data_in;
+  length = length_in;
+  if (!ParseSegmentHeaders()) {
+    return false;
+  }
+  return !tracks.empty();
+}
+
+void H265MkvReader::Close() noexcept {
+  file.Close();
+  tracks.clear();
+  cue_points.clear();
+  data = nullptr;
+  length = 0;
+  segment_start = segment_end = 0;
+  first_cluster = next_cluster = 0;
+}
+
+bool H265MkvReader::ParseSegmentHeaders() noexcept {
+  // EBML header, and segment
+  Element element;
+  if (!ReadElement(data, 0, length, &element) || element.id != kIdEbml) {
+    return false;
+  }
+  size_t offset = element.size;
+  if (!ReadElement(data, offset, length, &element) ||
+      element.id != kIdSegment) {
+    return false;
+  }
+  segment_start = static_cast<size_t>(element.payload - data);
+  segment_end = segment_start + element.payload_length;
+
+  // level 1 elements, up to the first cluster
+  first_cluster = segment_end;
+  for (offset = segment_start; ReadElement(data, offset, segment_end,
+                                           &element);
+       offset += element.size) {
+    if (element.id == kIdCluster) {
+      first_cluster = offset;
+      break;
+    } else if (element.id == kIdSeekHead) {
+      ParseSeekHead(element.payload, element.payload_length);
+    } else if (element.id == kIdInfo) {
+      ParseInfo(element.payload, element.payload_length);
+    } else if (element.id == kIdTracks) {
+      ParseTracks(element.payload, element.payload_length);
+    } else if (element.id == kIdCues) {
+      ParseCues(element.payload, element.payload_length);
+    }
+    if (element.unknown_size) {
+      break;
+    }
+  }
+  next_cluster = first_cluster;
+
+  // elements after the clusters (only read where the SeekHead points)
+  if (!has_tracks && seek_tracks != 0) {
+    ParseElementAt(seek_tracks, kIdTracks);
+  }
+  if (!has_cues && seek_cues != 0) {
+    ParseElementAt(seek_cues, kIdCues);
+  }
+  return true;
+}
+
+void H265MkvReader::ParseSeekHead(const uint8_t* seek_head,
+                                  size_t seek_head_length) noexcept {
+  Element seek;
+  for (size_t offset = 0;
+       ReadElement(seek_head, offset, seek_head_length, &seek);
+       offset += seek.size) {
+    if (seek.id != kIdSeek) {
+      continue;
+    }
+    Element seek_id, seek_position;
+    if (!FindElement(seek.payload, seek.payload_length, kIdSeekId,
+                     &seek_id) ||
+        !FindElement(seek.payload, seek.payload_length, kIdSeekPosition,
+                     &seek_position)) {
+      continue;
+    }
+    uint64_t id = ReadUint(seek_id.payload, seek_id.payload_length);
+    uint64_t position =
+        ReadUint(seek_position.payload, seek_position.payload_length);
+    if (position >= segment_end - segment_start) {
+      continue;
+    }
+    // positions are relative to the segment data
+    if (id == kIdTracks) {
+      seek_tracks = segment_start + static_cast<size_t>(position);
+    } else if (id == kIdCues) {
+      seek_cues = segment_start + static_cast<size_t>(position);
+    }
+  }
+}
+
+void H265MkvReader::ParseElementAt(size_t offset, uint32_t id) noexcept {
+  Element element;
+  if (!ReadElement(data, offset, segment_end, &element) ||
+      element.id != id) {
+    return;
+  }
+  if (id == kIdTracks) {
+    ParseTracks(element.payload, element.payload_length);
+  } else if (id == kIdCues) {
+    ParseCues(element.payload, element.payload_length);
+  }
+}
+
+void H265MkvReader::ParseInfo(const uint8_t* info,
+                              size_t info_length) noexcept {
+  Element element;
+  if (FindElement(info, info_length, kIdTimecodeScale, &element)) {
+    uint64_t value = ReadUint(element.payload, element.payload_length);
+    if (value != 0) {
+      timecode_scale = value;
+    }
+  }
+}
+
+void H265MkvReader::ParseTracks(const uint8_t* tracks_data,
+                                size_t tracks_length) noexcept {
+  has_tracks = true;
+  Element element;
+  for (size_t offset = 0;
+       ReadElement(tracks_data, offset, tracks_length, &element);
+       offset += element.size) {
+    if (element.id == kIdTrackEntry) {
+      ParseTrackEntry(element.payload, element.payload_length);
+    }
+  }
+}
+
+void H265MkvReader::ParseTrackEntry(const uint8_t* track_entry,
+                                    size_t track_entry_length) noexcept {
+  Element codec_id, track_number, codec_private;
+  if (!FindElement(track_entry, track_entry_length, kIdCodecId, &codec_id) ||
+      codec_id.payload_length < strlen(kCodecIdHevc) ||
+      memcmp(codec_id.payload, kCodecIdHevc, strlen(kCodecIdHevc)) != 0) {
+    return;
+  }
+  // strings can be zero-padded
+  for (size_t i = strlen(kCodecIdHevc); i < codec_id.payload_length; i++) {
+    if (codec_id.payload[i] != 0) {
+      return;
+    }
+  }
+  Track track;
+  if (!FindElement(track_entry, track_entry_length, kIdTrackNumber,
+                   &track_number)) {
+    return;
+  }
+  track.track_number =
+      ReadUint(track_number.payload, track_number.payload_length);
+  if (options.track_number != 0 &&
+      options.track_number != track.track_number) {
+    return;
+  }
+  if (!FindElement(track_entry, track_entry_length, kIdCodecPrivate,
+                   &codec_private) ||
+      codec_private.payload_length < 23) {
+    return;
+  }
+  track.codec_private = codec_private.payload;
+  track.codec_private_length = codec_private.payload_length;
+  // unsigned int(2) lengthSizeMinusOne;
+  track.length_size = (codec_private.payload[21] & 0x03) + 1u;
+
+  Element element;
+  if (FindElement(track_entry, track_entry_length, kIdDefaultDuration,
+                  &element)) {
+    track.default_duration = ReadUint(element.payload, element.payload_length);
+  }
+  Element video;
+  if (FindElement(track_entry, track_entry_length, kIdVideo, &video)) {
+    if (FindElement(video.payload, video.payload_length, kIdPixelWidth,
+                    &element)) {
+      track.width = static_cast<uint32_t>(
+          ReadUint(element.payload, element.payload_length));
+    }
+    if (FindElement(video.payload, video.payload_length, kIdPixelHeight,
+                    &element)) {
+      track.height = static_cast<uint32_t>(
+          ReadUint(element.payload, element.payload_length));
+    }
+  }
+  tracks.push_back(track);
+}
+
+void H265MkvReader::ParseCues(const uint8_t* cues,
+                              size_t cues_length) noexcept {
+  has_cues = true;
+  Element cue_point;
+  for (size_t offset = 0; ReadElement(cues, offset, cues_length, &cue_point);
+       offset += cue_point.size) {
+    Element cue_time;
+    if (cue_point.id != kIdCuePoint ||
+        !FindElement(cue_point.payload, cue_point.payload_length, kIdCueTime,
+                     &cue_time)) {
+      continue;
+    }
+    uint64_t time = ReadUint(cue_time.payload, cue_time.payload_length);
+    Element element;
+    for (size_t position_offset = 0;
+         ReadElement(cue_point.payload, position_offset,
+                     cue_point.payload_length, &element);
+         position_offset += element.size) {
+      Element cue_track, cue_cluster_position;
+      if (element.id != kIdCueTrackPositions ||
+          !FindElement(element.payload, element.payload_length, kIdCueTrack,
+                       &cue_track) ||
+          !FindElement(element.payload, element.payload_length,
+                       kIdCueClusterPosition, &cue_cluster_position)) {
+        continue;
+      }
+      uint64_t position = ReadUint(cue_cluster_position.payload,
+                                   cue_cluster_position.payload_length);
+      if (position >= segment_end - segment_start) {
+        continue;
+      }
+      CuePoint cue;
+      cue.time = time;
+      cue.track_number = ReadUint(cue_track.payload, cue_track.payload_length);
+      cue.cluster_offset = segment_start + static_cast<size_t>(position);
+      cue_points.push_back(cue);
+    }
+  }
+}
+
+bool H265MkvReader::Seek(int64_t timestamp_ns) noexcept {
+  bool found = false;
+  uint64_t best_time = 0;
+  size_t best_offset = first_cluster;
+  for (const auto& cue : cue_points) {
+    if (GetTrack(cue.track_number) == nullptr) {
+      continue;
+    }
+    found = true;
+    int64_t cue_timestamp_ns = static_cast<int64_t>(cue.time * timecode_scale);
+    if (cue_timestamp_ns <= timestamp_ns && cue.time >= best_time) {
+      best_time = cue.time;
+      best_offset = cue.cluster_offset;
+    }
+  }
+  next_cluster = best_offset;
+  return found;
+}
+
+bool H265MkvReader::ReadBlocks(Callback callback, void* opaque) noexcept {
+  if (data == nullptr) {
+    return false;
+  }
+  Element element;
+  size_t offset = next_cluster;
+  while (offset < segment_end) {
+    if (!ReadElement(data, offset, segment_end, &element)) {
+      next_cluster = segment_end;
+      return false;
+    }
+    if (element.id == kIdCluster) {
+      offset = ReadCluster(offset, segment_end, callback, opaque);
+    } else {
+      offset += element.size;
+    }
+  }
+  next_cluster = offset;
+  return true;
+}
+
+size_t H265MkvReader::ReadCluster(size_t offset, size_t end,
+                                  Callback callback, void* opaque) noexcept {
+  Element cluster;
+  if (!ReadElement(data, offset, end, &cluster)) {
+    return end;
+  }
+  stats.clusters++;
+  size_t cluster_start = static_cast<size_t>(cluster.payload - data);
+  int64_t cluster_timecode = 0;
+  Element element;
+  size_t child_offset = 0;
+  for (; ReadElement(cluster.payload, child_offset, cluster.payload_length,
+                     &element);
+       child_offset += element.size) {
+    if (cluster.unknown_size && IsLevel1Id(element.id)) {
+      // end of an unknown-size cluster
+      break;
+    }
+    if (element.id == kIdTimecode) {
+      cluster_timecode = static_cast<int64_t>(
+          ReadUint(element.payload, element.payload_length));
+    } else if (element.id == kIdSimpleBlock) {
+      ReadBlock(element.payload, element.payload_length, cluster_timecode,
+                true, false, callback, opaque);
+    } else if (element.id == kIdBlockGroup) {
+      Element block, reference_block;
+      if (FindElement(element.payload, element.payload_length, kIdBlock,
+                      &block)) {
+        bool has_reference =
+            FindElement(element.payload, element.payload_length,
+                        kIdReferenceBlock, &reference_block);
+        ReadBlock(block.payload, block.payload_length, cluster_timecode,
+                  false, has_reference, callback, opaque);
+      }
+    }
+    if (element.unknown_size) {
+      child_offset = cluster.payload_length;
+      break;
+    }
+  }
+  if (!cluster.unknown_size) {
+    return offset + cluster.size;
+  }
+  return cluster_start + child_offset;
+}
+
+void H265MkvReader::ReadBlock(const uint8_t* block, size_t block_length,
+                              int64_t cluster_timecode, bool simple_block,
+                              bool has_reference, Callback callback,
+                              void* opaque) noexcept {
+  // track number, timecode (int16, relative to the cluster), and flags
+  uint64_t track_number;
+  bool all_ones;
+  size_t size = ReadVint(block, block_length, 8, false, &track_number,
+                         &all_ones);
+  if (size == 0 || block_length - size < 3) {
+    stats.blocks_invalid++;
+    return;
+  }
+  const Track* track = GetTrack(track_number);
+  if (track == nullptr) {
+    return;
+  }
+  int16_t relative_timecode =
+      static_cast<int16_t>((block[size] << 8) | block[size + 1]);
+  uint8_t flags = block[size + 2];
+  if (flags & kBlockFlagLacing) {
+    stats.blocks_invalid++;
+    return;
+  }
+  size_t header_size = size + 3;
+
+  Block out;
+  out.track_number = track_number;
+  // (wrapping arithmetic: the values come from the file)
+  out.timecode = static_cast<int64_t>(static_cast<uint64_t>(cluster_timecode) +
+                                      static_cast<uint64_t>(relative_timecode));
+  out.timestamp_ns = static_cast<int64_t>(static_cast<uint64_t>(out.timecode) *
+                                          timecode_scale);
+  out.keyframe = simple_block ? ((flags & kBlockFlagKeyframe) != 0)
+                              : !has_reference;
+  out.data = block + header_size;
+  out.length = block_length - header_size;
+  out.length_size = track->length_size;
+  stats.blocks++;
+  if (callback != nullptr) {
+    callback(out, opaque);
+  }
+}
+
+const H265MkvReader::Track* H265MkvReader::GetTrack(
+    uint64_t track_number) const noexcept {
+  for (const auto& track : tracks) {
+    if (track.track_number == track_number) {
+      return &track;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace h265nal
@@ -0,0 +1,622 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_mp4_reader.h"
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_common.h"
+#include "h265_utils.h"
+
+namespace {
+constexpr uint32_t FourCc(char a, char b, char c, char d) {
+  return (static_cast<uint32_t>(a) << 24) | (static_cast<uint32_t>(b) << 16) |
+         (static_cast<uint32_t>(c) << 8) | static_cast<uint32_t>(d);
+}
+
+constexpr uint32_t kBoxMoov = FourCc('m', 'o', 'o', 'v');
+constexpr uint32_t kBoxTrak = FourCc('t', 'r', 'a', 'k');
+constexpr uint32_t kBoxTkhd = FourCc('t', 'k', 'h', 'd');
+constexpr uint32_t kBoxMdia = FourCc('m', 'd', 'i', 'a');
+constexpr uint32_t kBoxMdhd = FourCc('m', 'd', 'h', 'd');
+constexpr uint32_t kBoxMinf = FourCc('m', 'i', 'n', 'f');
+constexpr uint32_t kBoxStbl = FourCc('s', 't', 'b', 'l');
+constexpr uint32_t kBoxStsd = FourCc('s', 't', 's', 'd');
+constexpr uint32_t kBoxHvc1 = FourCc('h', 'v', 'c', '1');
+constexpr uint32_t kBoxHev1 = FourCc('h', 'e', 'v', '1');
+constexpr uint32_t kBoxHvcC = FourCc('h', 'v', 'c', 'C');
+constexpr uint32_t kBoxStsz = FourCc('s', 't', 's', 'z');
+constexpr uint32_t kBoxStco = FourCc('s', 't', 'c', 'o');
+constexpr uint32_t kBoxCo64 = FourCc('c', 'o', '6', '4');
+constexpr uint32_t kBoxStsc = FourCc('s', 't', 's', 'c');
+constexpr uint32_t kBoxStts = FourCc('s', 't', 't', 's');
+constexpr uint32_t kBoxCtts = FourCc('c', 't', 't', 's');
+constexpr uint32_t kBoxStss = FourCc('s', 't', 's', 's');
+constexpr uint32_t kBoxMvex = FourCc('m', 'v', 'e', 'x');
+constexpr uint32_t kBoxTrex = FourCc('t', 'r', 'e', 'x');
+constexpr uint32_t kBoxMoof = FourCc('m', 'o', 'o', 'f');
+constexpr uint32_t kBoxTraf = FourCc('t', 'r', 'a', 'f');
+constexpr uint32_t kBoxTfhd = FourCc('t', 'f', 'h', 'd');
+constexpr uint32_t kBoxTfdt = FourCc('t', 'f', 'd', 't');
+constexpr uint32_t kBoxTrun = FourCc('t', 'r', 'u', 'n');
+
+// VisualSampleEntry fields before the child boxes (ISO/IEC 14496-12,
+// Section 12.1.3)
+constexpr size_t kVisualSampleEntrySize = 78;
+// full box version and flags
+constexpr size_t kFullBoxHeaderSize = 4;
+
+// tfhd flags
+constexpr uint32_t kTfhdBaseDataOffsetPresent = 0x000001;
+constexpr uint32_t kTfhdSampleDescriptionIndexPresent = 0x000002;
+constexpr uint32_t kTfhdDefaultSampleDurationPresent = 0x000008;
+constexpr uint32_t kTfhdDefaultSampleSizePresent = 0x000010;
+constexpr uint32_t kTfhdDefaultSampleFlagsPresent = 0x000020;
+constexpr uint32_t kTfhdDefaultBaseIsMoof = 0x020000;
+// trun flags
+constexpr uint32_t kTrunDataOffsetPresent = 0x000001;
+constexpr uint32_t kTrunFirstSampleFlagsPresent = 0x000004;
+constexpr uint32_t kTrunSampleDurationPresent = 0x000100;
+constexpr uint32_t kTrunSampleSizePresent = 0x000200;
+constexpr uint32_t kTrunSampleFlagsPresent = 0x000400;
+constexpr uint32_t kTrunSampleCompositionTimeOffsetPresent = 0x000800;
+// sample flags: sample_is_non_sync_sample
+constexpr uint32_t kSampleIsNonSyncSample = 0x00010000;
+
+uint32_t ReadU16(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 8) | static_cast<uint32_t>(p[1]);
+}
+
+uint32_t ReadU32(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 24) |
+         (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+uint64_t ReadU64(const uint8_t* p) {
+  return (static_cast<uint64_t>(ReadU32(p)) << 32) | ReadU32(p + 4);
+}
+
+// A box: its type, and its payload (the data after the box header).
+struct Box {
+  uint32_t type;
+  // full box (header included)
+  const uint8_t* start;
+  size_t size;
+  const uint8_t* payload;
+  size_t payload_length;
+};
+
+// Iterator over a list of boxes (e.g. the children of a box).
+class BoxIterator {
+ public:
+  BoxIterator(const uint8_t* data, size_t length)
+      : data_(data), length_(length) {}
+
+  // Get the next box. Returns false at the end of the list, or if the next
+  // box is invalid (e.g. truncated).
+  bool Next(Box* box) {
+    if (data_ == nullptr || length_ - offset_ < 8) {
+      return false;
+    }
+    const uint8_t* p = data_ + offset_;
+    uint64_t size = ReadU32(p);
+    size_t header_size = 8;
+    if (size == 1) {
+      // largesize
+      if (length_ - offset_ < 16) {
+        return false;
+      }
+      size = ReadU64(p + 8);
+      header_size = 16;
+    } else if (size == 0) {
+      // box extends to the end of the list
+      size = length_ - offset_;
+    }
+    if (size < header_size || size > length_ - offset_) {
+      return false;
+    }
+    box->type = ReadU32(p + 4);
+    box->start = p;
+    box->size = static_cast<size_t>(size);
+    box->payload = p + header_size;
+    box->payload_length = static_cast<size_t>(size) - header_size;
+    offset_ += static_cast<size_t>(size);
+    return true;
+  }
+
+ private:
+  const uint8_t* data_;
+  size_t length_;
+  size_t offset_ = 0;
+};
+
+// Find the first child box of a given type.
+bool FindBox(const uint8_t* data, size_t length, uint32_t type, Box* box) {
+  BoxIterator it(data, length);
+  while (it.Next(box)) {
+    if (box->type == type) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Number of entries of a sample table that fit in its payload.
+// `header_size` is the size of the fields before the entries, which end
+// with the entry count.
+size_t GetEntryCount(const h265nal::BufferSegment& table, size_t header_size,
+                     size_t entry_size) {
+  if (table.data == nullptr || table.length < header_size) {
+    return 0;
+  }
+  size_t entry_count = ReadU32(table.data + header_size - 4);
+  size_t max_entry_count = (table.length - header_size) / entry_size;
+  return (entry_count < max_entry_count) ? entry_count : max_entry_count;
+}
+
+// Cursor over a run-length table (stts, ctts), i.e. a list of
+// (sample_count, value) entries.
+class RunLengthCursor {
+ public:
+  explicit RunLengthCursor(const h265nal::BufferSegment& table)
+      : table_(table), entry_count_(GetEntryCount(table, 8, 8)) {}
+
+  // Value for the next sample (0 after the end of the table).
+  uint32_t Next() {
+    while (remaining_ == 0) {
+      if (index_ >= entry_count_) {
+        return 0;
+      }
+      const uint8_t* entry = table_.data + 8 + index_ * 8;
+      remaining_ = ReadU32(entry);
+      value_ = ReadU32(entry + 4);
+      index_++;
+    }
+    remaining_--;
+    return value_;
+  }
+
+ private:
+  const h265nal::BufferSegment& table_;
+  size_t entry_count_;
+  size_t index_ = 0;
+  uint32_t remaining_ = 0;
+  uint32_t value_ = 0;
+};
+}  // namespace
+
+namespace h265nal {
+
+H265Mp4Reader::H265Mp4Reader(const Options& options_in)
+    : options(options_in) {}
+
+bool H265Mp4Reader::Open(const char* filename) noexcept {
+  Close();
+  if (!file.Open(filename)) {
+    return false;
+  }
+  return OpenBuffer(file.GetData(), file.GetLength());
+}
+
+bool H265Mp4Reader::OpenBuffer(const uint8_t* data_in,
+                               size_t length_in) noexcept {
+  tracks.clear();
+  if (data_in == nullptr) {
+    return false;
+  }
+  data = data_in;
+  length = length_in;
+  // the moov box can be anywhere (e.g. after the mdat)
+  Box moov;
+  if (!FindBox(data, length, kBoxMoov, &moov)) {
+    return false;
+  }
+  if (!ParseMoov(moov.payload, moov.payload_length)) {
+    return false;
+  }
+  return !tracks.empty();
+}
+
+void H265Mp4Reader::Close() noexcept {
+  file.Close();
+  tracks.clear();
+  data = nullptr;
+  length = 0;
+}
+
+bool H265Mp4Reader::ParseMoov(const uint8_t* moov,
+                              size_t moov_length) noexcept {
+  Box box;
+  BoxIterator it(moov, moov_length);
+  while (it.Next(&box)) {
+    if (box.type == kBoxTrak) {
+      ParseTrak(box.payload, box.payload_length);
+    }
+  }
+  // track extends defaults (for fragmented files)
+  Box mvex;
+  if (FindBox(moov, moov_length, kBoxMvex, &mvex)) {
+    BoxIterator mvex_it(mvex.payload, mvex.payload_length);
+    while (mvex_it.Next(&box)) {
+      if (box.type != kBoxTrex || box.payload_length < 24) {
+        continue;
+      }
+      Track* track = GetTrack(ReadU32(box.payload + 4));
+      if (track != nullptr) {
+        track->default_sample_duration = ReadU32(box.payload + 12);
+        track->default_sample_size = ReadU32(box.payload + 16);
+        track->default_sample_flags = ReadU32(box.payload + 20);
+      }
+    }
+  }
+  return true;
+}
+
+bool H265Mp4Reader::ParseTrak(const uint8_t* trak,
+                              size_t trak_length) noexcept {
+  Track track;
+  Box tkhd, mdia, mdhd, minf, stbl, stsd;
+  // track header
+  if (!FindBox(trak, trak_length, kBoxTkhd, &tkhd) ||
+      tkhd.payload_length < 24) {
+    return false;
+  }
+  track.track_id = (tkhd.payload[0] == 1) ? ReadU32(tkhd.payload + 20)
+                                          : ReadU32(tkhd.payload + 12);
+  if (options.track_id != 0 && options.track_id != track.track_id) {
+    return false;
+  }
+  // media header
+  if (!FindBox(trak, trak_length, kBoxMdia, &mdia) ||
+      !FindBox(mdia.payload, mdia.payload_length, kBoxMdhd, &mdhd) ||
+      mdhd.payload_length < 24) {
+    return false;
+  }
+  track.timescale = (mdhd.payload[0] == 1) ? ReadU32(mdhd.payload + 20)
+                                           : ReadU32(mdhd.payload + 12);
+  if (!FindBox(mdia.payload, mdia.payload_length, kBoxMinf, &minf) ||
+      !FindBox(minf.payload, minf.payload_length, kBoxStbl, &stbl) ||
+      !FindBox(stbl.payload, stbl.payload_length, kBoxStsd, &stsd) ||
+      stsd.payload_length < 8) {
+    return false;
+  }
+
+  // sample description: only the first entry is used
+  Box entry;
+  BoxIterator stsd_it(stsd.payload + 8, stsd.payload_length - 8);
+  if (!stsd_it.Next(&entry) ||
+      (entry.type != kBoxHvc1 && entry.type != kBoxHev1) ||
+      entry.payload_length < kVisualSampleEntrySize) {
+    return false;
+  }
+  track.sample_entry_type = entry.type;
+  track.width = ReadU16(entry.payload + 24);
+  track.height = ReadU16(entry.payload + 26);
+  Box hvcc;
+  if (!FindBox(entry.payload + kVisualSampleEntrySize,
+               entry.payload_length - kVisualSampleEntrySize, kBoxHvcC,
+               &hvcc) ||
+      hvcc.payload_length < 23) {
+    return false;
+  }
+  track.hvcc = hvcc.payload;
+  track.hvcc_length = hvcc.payload_length;
+  // unsigned int(2) lengthSizeMinusOne;
+  track.length_size = (hvcc.payload[21] & 0x03) + 1u;
+
+  // sample tables
+  Box box;
+  BoxIterator stbl_it(stbl.payload, stbl.payload_length);
+  while (stbl_it.Next(&box)) {
+    BufferSegment table = {box.payload, box.payload_length};
+    if (box.type == kBoxStsz) {
+      track.stsz = table;
+    } else if (box.type == kBoxStco || box.type == kBoxCo64) {
+      track.stco = table;
+      track.co64 = (box.type == kBoxCo64);
+    } else if (box.type == kBoxStsc) {
+      track.stsc = table;
+    } else if (box.type == kBoxStts) {
+      track.stts = table;
+    } else if (box.type == kBoxCtts) {
+      track.ctts = table;
+    } else if (box.type == kBoxStss) {
+      track.stss = table;
+    }
+  }
+  tracks.push_back(track);
+  return true;
+}
+
+H265Mp4Reader::Track* H265Mp4Reader::GetTrack(uint32_t track_id) noexcept {
+  for (Track& track : tracks) {
+    if (track.track_id == track_id) {
+      return &track;
+    }
+  }
+  return nullptr;
+}
+
+bool H265Mp4Reader::ReadSamples(Callback callback, void* opaque) noexcept {
+  if (data == nullptr || tracks.empty()) {
+    return false;
+  }
+  // a file cannot hold more (non-empty) samples than bytes
+  sample_budget = length;
+  // 1. samples in the moov sample tables
+  for (Track& track : tracks) {
+    track.next_index = 0;
+    track.next_decode_time = 0;
+    ReadTrackSamples(&track, callback, opaque);
+  }
+  // 2. samples in the movie fragments
+  Box box;
+  BoxIterator it(data, length);
+  while (it.Next(&box)) {
+    if (box.type == kBoxMoof) {
+      stats.fragments++;
+      ReadMoof(box.start, box.size, callback, opaque);
+    }
+  }
+  return true;
+}
+
+bool H265Mp4Reader::ReadTrackSamples(Track* track, Callback callback,
+                                     void* opaque) noexcept {
+  // stsz: sample_size, sample_count, entry_size[sample_count]
+  if (track->stsz.data == nullptr || track->stsz.length < 12) {
+    return false;
+  }
+  uint32_t sample_size = ReadU32(track->stsz.data + 4);
+  size_t sample_count = GetEntryCount(track->stsz, 12, 4);
+  if (sample_size != 0) {
+    // no size table
+    sample_count = ReadU32(track->stsz.data + 8);
+  }
+  // the sample count is not backed by a table: bound it
+  sample_count = static_cast<size_t>(ClaimSamples(sample_count));
+  // stco/co64: entry_count, chunk_offset[entry_count]
+  size_t chunk_offset_size = track->co64 ? 8 : 4;
+  size_t chunk_count = GetEntryCount(track->stco, 8, chunk_offset_size);
+  // stsc: entry_count, {first_chunk, samples_per_chunk, sdi}[entry_count]
+  size_t stsc_count = GetEntryCount(track->stsc, 8, 12);
+  // stss: entry_count, sample_number[entry_count] (all samples are sync
+  // samples if there is no stss)
+  bool has_stss = (track->stss.data != nullptr);
+  size_t stss_count = GetEntryCount(track->stss, 8, 4);
+  RunLengthCursor stts(track->stts);
+  RunLengthCursor ctts(track->ctts);
+
+  size_t sample = 0;
+  size_t stsc_index = 0;
+  size_t stss_index = 0;
+  uint32_t samples_per_chunk = 0;
+  for (size_t chunk = 0; chunk < chunk_count && sample < sample_count;
+       chunk++) {
+    // stsc first_chunk values are 1-based
+    while (stsc_index < stsc_count &&
+           ReadU32(track->stsc.data + 8 + stsc_index * 12) <= chunk + 1) {
+      samples_per_chunk = ReadU32(track->stsc.data + 8 + stsc_index * 12 + 4);
+      stsc_index++;
+    }
+    const uint8_t* chunk_offset_ptr =
+        track->stco.data + 8 + chunk * chunk_offset_size;
+    uint64_t offset = track->co64 ? ReadU64(chunk_offset_ptr)
+                                  : ReadU32(chunk_offset_ptr);
+    for (uint32_t i = 0; i < samples_per_chunk && sample < sample_count;
+         i++, sample++) {
+      uint64_t size = (sample_size != 0)
+                          ? sample_size
+                          : ReadU32(track->stsz.data + 12 + sample * 4);
+      uint32_t duration = stts.Next();
+      // ctts version 0 offsets are unsigned, but are used as signed values
+      // by most writers
+      int64_t composition_offset = static_cast<int32_t>(ctts.Next());
+      bool sync = !has_stss;
+      while (stss_index < stss_count &&
+             ReadU32(track->stss.data + 8 + stss_index * 4) <= sample + 1) {
+        sync = (ReadU32(track->stss.data + 8 + stss_index * 4) == sample + 1);
+        stss_index++;
+      }
+      Emit(track, offset, size, duration, composition_offset, sync, callback,
+           opaque);
+      offset += size;
+    }
+  }
+  return true;
+}
+
+bool H265Mp4Reader::ReadMoof(const uint8_t* moof, size_t moof_length,
+                             Callback callback, void* opaque) noexcept {
+  const uint64_t moof_offset = static_cast<uint64_t>(moof - data);
+  // end of the data of the previous track fragment
+  uint64_t data_end = moof_offset;
+  // skip the moof box header
+  Box moof_box;
+  BoxIterator moof_it(moof, moof_length);
+  if (!moof_it.Next(&moof_box)) {
+    return false;
+  }
+  Box traf;
+  BoxIterator it(moof_box.payload, moof_box.payload_length);
+  bool first_traf = true;
+  while (it.Next(&traf)) {
+    if (traf.type != kBoxTraf) {
+      continue;
+    }
+    // track fragment header
+    Box tfhd;
+    if (!FindBox(traf.payload, traf.payload_length, kBoxTfhd, &tfhd) ||
+        tfhd.payload_length < 8) {
+      continue;
+    }
+    uint32_t tfhd_flags = ReadU32(tfhd.payload) & 0xffffff;
+    Track* track = GetTrack(ReadU32(tfhd.payload + 4));
+    if (track == nullptr) {
+      first_traf = false;
+      continue;
+    }
+    size_t field_offset = 8;
+    uint64_t base_data_offset =
+        (first_traf || (tfhd_flags & kTfhdDefaultBaseIsMoof)) ? moof_offset
+                                                              : data_end;
+    first_traf = false;
+    uint32_t default_sample_duration = track->default_sample_duration;
+    uint32_t default_sample_size = track->default_sample_size;
+    uint32_t default_sample_flags = track->default_sample_flags;
+    const uint32_t optional_fields[] = {
+        kTfhdBaseDataOffsetPresent, kTfhdSampleDescriptionIndexPresent,
+        kTfhdDefaultSampleDurationPresent, kTfhdDefaultSampleSizePresent,
+        kTfhdDefaultSampleFlagsPresent};
+    for (uint32_t field : optional_fields) {
+      if (!(tfhd_flags & field)) {
+        continue;
+      }
+      size_t field_size = (field == kTfhdBaseDataOffsetPresent) ? 8 : 4;
+      if (field_offset + field_size > tfhd.payload_length) {
+        return false;
+      }
+      const uint8_t* p = tfhd.payload + field_offset;
+      if (field == kTfhdBaseDataOffsetPresent) {
+        base_data_offset = ReadU64(p);
+      } else if (field == kTfhdDefaultSampleDurationPresent) {
+        default_sample_duration = ReadU32(p);
+      } else if (field == kTfhdDefaultSampleSizePresent) {
+        default_sample_size = ReadU32(p);
+      } else if (field == kTfhdDefaultSampleFlagsPresent) {
+        default_sample_flags = ReadU32(p);
+      }
+      field_offset += field_size;
+    }
+
+    // track fragment decode time
+    Box tfdt;
+    if (FindBox(traf.payload, traf.payload_length, kBoxTfdt, &tfdt) &&
+        tfdt.payload_length >= 8) {
+      track->next_decode_time = (tfdt.payload[0] == 1 &&
+                                 tfdt.payload_length >= 12)
+                                    ? ReadU64(tfdt.payload + 4)
+                                    : ReadU32(tfdt.payload + 4);
+    }
+
+    // track fragment runs
+    uint64_t offset = base_data_offset;
+    Box trun;
+    BoxIterator traf_it(traf.payload, traf.payload_length);
+    while (traf_it.Next(&trun)) {
+      if (trun.type != kBoxTrun || trun.payload_length < 8) {
+        continue;
+      }
+      uint32_t trun_flags = ReadU32(trun.payload) & 0xffffff;
+      uint32_t sample_count = ReadU32(trun.payload + 4);
+      size_t trun_offset = 8;
+      if (trun_flags & kTrunDataOffsetPresent) {
+        if (trun_offset + 4 > trun.payload_length) {
+          return false;
+        }
+        int32_t data_offset =
+            static_cast<int32_t>(ReadU32(trun.payload + trun_offset));
+        offset = static_cast<uint64_t>(static_cast<int64_t>(base_data_offset) +
+                                       data_offset);
+        trun_offset += 4;
+      }
+      bool has_first_sample_flags = (trun_flags & kTrunFirstSampleFlagsPresent);
+      uint32_t first_sample_flags = 0;
+      if (has_first_sample_flags) {
+        if (trun_offset + 4 > trun.payload_length) {
+          return false;
+        }
+        first_sample_flags = ReadU32(trun.payload + trun_offset);
+        trun_offset += 4;
+      }
+      const uint32_t sample_fields[] = {
+          kTrunSampleDurationPresent, kTrunSampleSizePresent,
+          kTrunSampleFlagsPresent, kTrunSampleCompositionTimeOffsetPresent};
+      size_t sample_entry_size = 0;
+      for (uint32_t field : sample_fields) {
+        sample_entry_size += (trun_flags & field) ? 4 : 0;
+      }
+      if (sample_entry_size == 0) {
+        // the sample count is not backed by a table: bound it
+        sample_count = static_cast<uint32_t>(ClaimSamples(sample_count));
+      }
+      for (uint32_t i = 0; i < sample_count; i++) {
+        if (trun_offset + sample_entry_size > trun.payload_length) {
+          return false;
+        }
+        uint32_t duration = default_sample_duration;
+        uint32_t size = default_sample_size;
+        uint32_t flags = (i == 0 && has_first_sample_flags)
+                             ? first_sample_flags
+                             : default_sample_flags;
+        int64_t composition_offset = 0;
+        const uint8_t* p = trun.payload + trun_offset;
+        if (trun_flags & kTrunSampleDurationPresent) {
+          duration = ReadU32(p);
+          p += 4;
+        }
+        if (trun_flags & kTrunSampleSizePresent) {
+          size = ReadU32(p);
+          p += 4;
+        }
+        if (trun_flags & kTrunSampleFlagsPresent) {
+          flags = ReadU32(p);
+          p += 4;
+        }
+        if (trun_flags & kTrunSampleCompositionTimeOffsetPresent) {
+          // version 0 offsets are unsigned, but are used as signed values
+          // by most writers
+          composition_offset = static_cast<int32_t>(ReadU32(p));
+        }
+        trun_offset += sample_entry_size;
+        Emit(track, offset, size, duration, composition_offset,
+             !(flags & kSampleIsNonSyncSample), callback, opaque);
+        offset += size;
+      }
+    }
+    data_end = offset;
+  }
+  return true;
+}
+
+uint64_t H265Mp4Reader::ClaimSamples(uint64_t count) noexcept {
+  if (count > sample_budget) {
+    stats.samples_invalid += count - sample_budget;
+    count = sample_budget;
+  }
+  sample_budget -= count;
+  return count;
+}
+
+void H265Mp4Reader::Emit(Track* track, uint64_t offset, uint64_t size,
+                         uint32_t duration, int64_t composition_offset,
+                         bool sync, Callback callback, void* opaque) noexcept {
+  Sample sample;
+  sample.track_id = track->track_id;
+  sample.index = track->next_index++;
+  sample.decode_time = track->next_decode_time;
+  sample.composition_time =
+      static_cast<int64_t>(track->next_decode_time) + composition_offset;
+  sample.duration = duration;
+  sample.timescale = track->timescale;
+  sample.sync = sync;
+  sample.length_size = track->length_size;
+  track->next_decode_time += duration;
+  if (offset > length || size > length - offset) {
+    stats.samples_invalid++;
+    return;
+  }
+  sample.data = data + offset;
+  sample.length = static_cast<size_t>(size);
+  stats.samples++;
+  if (callback != nullptr) {
+    callback(sample, opaque);
+  }
+}
+
+}  // namespace h265nal
@@ -0,0 +1,266 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_nal_filter.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+#include "h265_sei_parser.h"
+#include "h265_sps_parser.h"
+#include "rtc_common.h"
+
+namespace {
+// NAL unit header size
+constexpr size_t kNalUnitHeaderSize = 2;
+// start code for the inserted NAL units
+const uint8_t kStartCode[] = {0x00, 0x00, 0x00, 0x01};
+// RBSP trailing bits (after the last SEI message)
+constexpr uint8_t kRbspTrailingBits = 0x80;
+
+bool IsIrap(uint32_t nal_unit_type) {
+  return nal_unit_type >= h265nal::BLA_W_LP &&
+         nal_unit_type <= h265nal::RSV_IRAP_VCL23;
+}
+}  // namespace
+
+namespace h265nal {
+
+void H265NalFilter::AddStage(Stage stage, void* opaque) {
+  stages.push_back({stage, opaque});
+}
+
+void H265NalFilter::AddDropNalUnitTypes(
+    const std::vector<uint32_t>& nal_unit_types) {
+  for (uint32_t nal_unit_type : nal_unit_types) {
+    if (nal_unit_type < 64) {
+      drop_nal_unit_types |= (1ull << nal_unit_type);
+    }
+  }
+  AddStage(DropNalUnitTypesStage, this);
+}
+
+void H265NalFilter::AddDropSeiPayloadTypes(
+    const std::vector<uint32_t>& payload_types) {
+  drop_sei_payload_types.insert(drop_sei_payload_types.end(),
+                                payload_types.begin(), payload_types.end());
+  AddStage(DropSeiPayloadTypesStage, this);
+}
+
+void H265NalFilter::AddKeepIrapOnly() { AddStage(KeepIrapOnlyStage, this); }
+
+void H265NalFilter::AddInsertParameterSets() {
+  AddStage(InsertParameterSetsStage, this);
+}
+
+size_t H265NalFilter::Filter(const uint8_t* data, size_t length,
+                             std::vector<BufferSegment>* spans) noexcept {
+  num_buffers = 0;
+  size_t size = 0;
+  // whether the last output span points into the input buffer (and can be
+  // extended)
+  bool merge = false;
+  auto append = [&](const uint8_t* span_data, size_t span_length,
+                    bool from_input) {
+    if (merge && from_input &&
+        spans->back().data + spans->back().length == span_data) {
+      spans->back().length += span_length;
+    } else {
+      spans->push_back({span_data, span_length});
+    }
+    merge = from_input;
+    size += span_length;
+  };
+
+  auto nalu_indices = H265BitstreamParser::FindNaluIndices(data, length);
+  for (const auto& nalu_index : nalu_indices) {
+    if (nalu_index.payload_start_offset + nalu_index.payload_size > length) {
+      break;
+    }
+    stats.nal_units++;
+    const uint8_t* start_code = data + nalu_index.start_offset;
+    size_t start_code_length =
+        nalu_index.payload_start_offset - nalu_index.start_offset;
+    NalUnit nal_unit;
+    nal_unit.data = data + nalu_index.payload_start_offset;
+    nal_unit.length = nalu_index.payload_size;
+    if (nal_unit.length < kNalUnitHeaderSize) {
+      // not a NAL unit: pass it through
+      append(start_code, start_code_length + nal_unit.length, true);
+      continue;
+    }
+    // nal_unit_header() (Section 7.3.1.2)
+    nal_unit.nal_unit_type = (nal_unit.data[0] >> 1) & 0x3f;
+    nal_unit.nuh_layer_id =
+        ((nal_unit.data[0] & 0x01) << 5) | (nal_unit.data[1] >> 3);
+    nal_unit.temporal_id = (nal_unit.data[1] & 0x07) - 1u;
+
+    bool keep = true;
+    inserted_spans.clear();
+    for (const auto& entry : stages) {
+      if (!entry.stage(&nal_unit, this, entry.opaque)) {
+        keep = false;
+        break;
+      }
+    }
+    if (!keep) {
+      // the NAL units inserted before it are dropped too
+      stats.nal_units_dropped++;
+      continue;
+    }
+    for (const auto& span : inserted_spans) {
+      append(span.data, span.length, false);
+    }
+    stats.nal_units_inserted += inserted_spans.size();
+    if (nal_unit.data == data + nalu_index.payload_start_offset &&
+        nal_unit.length == nalu_index.payload_size) {
+      append(start_code, start_code_length + nal_unit.length, true);
+    } else {
+      // rewritten: keep the original start code
+      stats.nal_units_rewritten++;
+      append(start_code, start_code_length, true);
+      append(nal_unit.data, nal_unit.length, false);
+    }
+  }
+  return size;
+}
+
+std::vector<uint8_t>* H265NalFilter::GetBuffer() noexcept {
+  if (num_buffers == buffers.size()) {
+    buffers.emplace_back();
+  }
+  std::vector<uint8_t>* buffer = &buffers[num_buffers++];
+  buffer->clear();
+  return buffer;
+}
+
+void H265NalFilter::InsertNalUnit(const uint8_t* data,
+                                  size_t length) noexcept {
+  std::vector<uint8_t>* buffer = GetBuffer();
+  buffer->insert(buffer->end(), kStartCode, kStartCode + sizeof(kStartCode));
+  buffer->insert(buffer->end(), data, data + length);
+  inserted_spans.push_back({buffer->data(), buffer->size()});
+}
+
+bool H265NalFilter::DropNalUnitTypesStage(NalUnit* nal_unit,
+                                          H265NalFilter* filter,
+                                          void* /* opaque */) {
+  return !(filter->drop_nal_unit_types & (1ull << nal_unit->nal_unit_type));
+}
+
+bool H265NalFilter::DropSeiPayloadTypesStage(NalUnit* nal_unit,
+                                             H265NalFilter* filter,
+                                             void* /* opaque */) {
+  if (nal_unit->nal_unit_type != PREFIX_SEI_NUT &&
+      nal_unit->nal_unit_type != SUFFIX_SEI_NUT) {
+    return true;
+  }
+  std::vector<uint8_t>& rbsp = filter->rbsp_buffer;
+  UnescapeRbsp(nal_unit->data + kNalUnitHeaderSize,
+               nal_unit->length - kNalUnitHeaderSize, &rbsp);
+  // copy the sei_message()s to keep (Section 7.3.5)
+  std::vector<uint8_t>& sei = filter->sei_buffer;
+  sei.clear();
+  bool dropped = false;
+  H265SeiMessageIterator it(rbsp.data(), rbsp.size());
+  H265SeiMessageIterator::SeiMessage sei_message;
+  while (it.Next(&sei_message)) {
+    if (std::find(filter->drop_sei_payload_types.begin(),
+                  filter->drop_sei_payload_types.end(),
+                  sei_message.payload_type) !=
+        filter->drop_sei_payload_types.end()) {
+      dropped = true;
+    } else {
+      sei.insert(sei.end(), rbsp.data() + sei_message.offset,
+                 rbsp.data() + sei_message.payload_offset +
+                     sei_message.payload_size);
+    }
+  }
+  if (it.IsInvalid()) {
+    // invalid SEI: keep it as is
+    return true;
+  }
+  if (!dropped) {
+    return true;
+  }
+  if (sei.empty()) {
+    return false;
+  }
+  sei.push_back(kRbspTrailingBits);
+  std::vector<uint8_t>* buffer = filter->GetBuffer();
+  buffer->insert(buffer->end(), nal_unit->data,
+                 nal_unit->data + kNalUnitHeaderSize);
+  EscapeRbsp(sei.data(), sei.size(), buffer);
+  nal_unit->data = buffer->data();
+  nal_unit->length = buffer->size();
+  return true;
+}
+
+bool H265NalFilter::KeepIrapOnlyStage(NalUnit* nal_unit,
+                                      H265NalFilter* /* filter */,
+                                      void* /* opaque */) {
+  return !IsNalUnitTypeVcl(nal_unit->nal_unit_type) ||
+         IsIrap(nal_unit->nal_unit_type);
+}
+
+bool H265NalFilter::InsertParameterSetsStage(NalUnit* nal_unit,
+                                             H265NalFilter* filter,
+                                             void* /* opaque */) {
+  const uint8_t* data = nal_unit->data;
+  size_t length = nal_unit->length;
+  switch (nal_unit->nal_unit_type) {
+    case VPS_NUT:
+      if (length > kNalUnitHeaderSize) {
+        // vps_video_parameter_set_id  u(4)
+        filter->vps[data[2] >> 4].assign(data, data + length);
+      }
+      filter->parameter_sets_seen = true;
+      break;
+    case SPS_NUT: {
+      auto sps = H265SpsParser::ParseSps(data + kNalUnitHeaderSize,
+                                         length - kNalUnitHeaderSize);
+      if (sps != nullptr) {
+        filter->sps[sps->sps_seq_parameter_set_id].assign(data,
+                                                         data + length);
+      }
+      filter->parameter_sets_seen = true;
+    } break;
+    case PPS_NUT: {
+      UnescapeRbsp(data + kNalUnitHeaderSize, length - kNalUnitHeaderSize,
+                   &filter->rbsp_buffer);
+      BitBuffer bit_buffer(filter->rbsp_buffer.data(),
+                           filter->rbsp_buffer.size());
+      uint32_t pps_pic_parameter_set_id;
+      if (bit_buffer.ReadExponentialGolomb(pps_pic_parameter_set_id)) {
+        filter->pps[pps_pic_parameter_set_id].assign(data, data + length);
+      }
+      filter->parameter_sets_seen = true;
+    } break;
+    default:
+      if (!IsNalUnitTypeVcl(nal_unit->nal_unit_type)) {
+        break;
+      }
+      // first_slice_segment_in_pic_flag  u(1)
+      if (IsIrap(nal_unit->nal_unit_type) && length > kNalUnitHeaderSize &&
+          (data[2] & 0x80) && !filter->parameter_sets_seen) {
+        for (const auto* parameter_sets :
+             {&filter->vps, &filter->sps, &filter->pps}) {
+          for (const auto& it : *parameter_sets) {
+            filter->InsertNalUnit(it.second.data(), it.second.size());
+          }
+        }
+      }
+      filter->parameter_sets_seen = false;
+      break;
+  }
+  return true;
+}
+
+}  // namespace h265nal
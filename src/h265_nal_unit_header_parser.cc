@@ -11,6 +11,8 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_parser_context.h"
+#include "h265_trace.h"
 
 namespace h265nal {
 
@@ -45,27 +47,33 @@ H265NalUnitHeaderParser::ParseNalUnitHeader(BitBuffer* bit_buffer) noexcept {
   // H265 NAL Unit Header (nal_unit_header()) parser.
   // Section 7.3.1.2 ("NAL unit header syntax") of the H.265
   // standard for a complete description.
-  auto nal_unit_header = std::make_unique<NalUnitHeaderState>();
+  auto nal_unit_header = H265ParserContext::MakeState<NalUnitHeaderState>();
 
   // forbidden_zero_bit  f(1)
   if (!bit_buffer->ReadBits(1, nal_unit_header->forbidden_zero_bit)) {
     return nullptr;
   }
+  H265Trace::f(bit_buffer, "forbidden_zero_bit", 1,
+               nal_unit_header->forbidden_zero_bit);
 
   // nal_unit_type  u(6)
   if (!bit_buffer->ReadBits(6, nal_unit_header->nal_unit_type)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "nal_unit_type", 6, nal_unit_header->nal_unit_type);
 
   // nuh_layer_id  u(6)
   if (!bit_buffer->ReadBits(6, nal_unit_header->nuh_layer_id)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "nuh_layer_id", 6, nal_unit_header->nuh_layer_id);
 
   // nuh_temporal_id_plus1  u(3)
   if (!bit_buffer->ReadBits(3, nal_unit_header->nuh_temporal_id_plus1)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "nuh_temporal_id_plus1", 3,
+               nal_unit_header->nuh_temporal_id_plus1);
 
   return nal_unit_header;
 }
@@ -10,9 +10,13 @@
 #include <memory>
 #include <vector>
 
+#include "h265_budget.h"
 #include "h265_common.h"
+#include "h265_error.h"
 #include "h265_nal_unit_header_parser.h"
 #include "h265_nal_unit_payload_parser.h"
+#include "h265_parser_context.h"
+#include "h265_trace.h"
 
 namespace h265nal {
 
@@ -26,6 +30,16 @@ H265NalUnitParser::ParseNalUnitUnescaped(
     const uint8_t* data, size_t length,
     struct H265BitstreamParserState* bitstream_parser_state,
     ParsingOptions parsing_options) noexcept {
+  return ParseNalUnitUnescaped(data, length, bitstream_parser_state,
+                               parsing_options, nullptr);
+}
+
+std::unique_ptr<H265NalUnitParser::NalUnitState>
+H265NalUnitParser::ParseNalUnitUnescaped(
+    const uint8_t* data, size_t length,
+    struct H265BitstreamParserState* bitstream_parser_state,
+    ParsingOptions parsing_options, H265ParserContext* context) noexcept {
+  H265ParserContext::Scope context_scope(context);
   BitBuffer bit_buffer(data, length);
 
   return ParseNalUnit(&bit_buffer, bitstream_parser_state, parsing_options);
@@ -37,10 +51,61 @@ H265NalUnitParser::ParseNalUnit(
     const uint8_t* data, size_t length,
     struct H265BitstreamParserState* bitstream_parser_state,
     ParsingOptions parsing_options) noexcept {
-  std::vector<uint8_t> unpacked_buffer = UnescapeRbsp(data, length);
-  BitBuffer bit_buffer(unpacked_buffer.data(), unpacked_buffer.size());
+  return ParseNalUnit(data, length, bitstream_parser_state, parsing_options,
+                      nullptr);
+}
 
-  return ParseNalUnit(&bit_buffer, bitstream_parser_state, parsing_options);
+std::unique_ptr<H265NalUnitParser::NalUnitState>
+H265NalUnitParser::ParseNalUnit(
+    const uint8_t* data, size_t length,
+    struct H265BitstreamParserState* bitstream_parser_state,
+    ParsingOptions parsing_options, H265ParserContext* context) noexcept {
+  H265ParserContext::Scope context_scope(context);
+  std::vector<uint8_t> local_buffer;
+  std::vector<uint8_t>* unpacked_buffer =
+      (context != nullptr) ? context->GetUnescapeBuffer() : &local_buffer;
+  UnescapeRbsp(data, length, unpacked_buffer);
+  BitBuffer bit_buffer(unpacked_buffer->data(), unpacked_buffer->size());
+
+  auto nal_unit =
+      ParseNalUnit(&bit_buffer, bitstream_parser_state, parsing_options);
+  if (nal_unit != nullptr &&
+      nal_unit->nal_unit_payload->slice_segment_layer != nullptr) {
+    nal_unit->nal_unit_payload->slice_segment_layer->MapEscapedOffsets(data,
+                                                                       length);
+  }
+  return nal_unit;
+}
+
+// Unpack RBSP and parse NAL Unit state from the supplied segment list.
+std::unique_ptr<H265NalUnitParser::NalUnitState>
+H265NalUnitParser::ParseNalUnit(
+    const BufferSegment* segments, size_t num_segments,
+    struct H265BitstreamParserState* bitstream_parser_state,
+    ParsingOptions parsing_options) noexcept {
+  return ParseNalUnit(segments, num_segments, bitstream_parser_state,
+                      parsing_options, nullptr);
+}
+
+std::unique_ptr<H265NalUnitParser::NalUnitState>
+H265NalUnitParser::ParseNalUnit(
+    const BufferSegment* segments, size_t num_segments,
+    struct H265BitstreamParserState* bitstream_parser_state,
+    ParsingOptions parsing_options, H265ParserContext* context) noexcept {
+  H265ParserContext::Scope context_scope(context);
+  std::vector<uint8_t> local_buffer;
+  std::vector<uint8_t>* unpacked_buffer =
+      (context != nullptr) ? context->GetUnescapeBuffer() : &local_buffer;
+  UnescapeRbsp(segments, num_segments, unpacked_buffer);
+  BitBuffer bit_buffer(unpacked_buffer->data(), unpacked_buffer->size());
+  auto nal_unit =
+      ParseNalUnit(&bit_buffer, bitstream_parser_state, parsing_options);
+  if (nal_unit != nullptr &&
+      nal_unit->nal_unit_payload->slice_segment_layer != nullptr) {
+    nal_unit->nal_unit_payload->slice_segment_layer->MapEscapedOffsets(
+        segments, num_segments);
+  }
+  return nal_unit;
 }
 
 std::unique_ptr<H265NalUnitParser::NalUnitState>
@@ -51,21 +116,23 @@ H265NalUnitParser::ParseNalUnit(
   // H265 NAL Unit (nal_unit()) parser.
   // Section 7.3.1.1 ("General NAL unit header syntax") of the H.265
   // standard for a complete description.
-  auto nal_unit = std::make_unique<NalUnitState>();
+  auto nal_unit = H265ParserContext::MakeState<NalUnitState>();
+  H265Budget::Scope budget_scope(parsing_options);
 
   // need to calculate the checksum before parsing the bit buffer
   if (parsing_options.add_checksum) {
     // set the checksum
-    nal_unit->checksum = NaluChecksum::GetNaluChecksum(bit_buffer);
+    nal_unit->checksum = H265ParserContext::MakeChecksum();
+    NaluChecksum::GetNaluChecksum(bit_buffer, nal_unit->checksum.get());
   }
 
   // nal_unit_header()
+  H265Trace::nal_unit(bit_buffer);
   nal_unit->nal_unit_header =
       H265NalUnitHeaderParser::ParseNalUnitHeader(bit_buffer);
   if (nal_unit->nal_unit_header == nullptr) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "error: cannot ParseNalUnitHeader in nal unit\n");
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_ParseFailed, "nal_unit",
+                              "nal_unit_header", bit_buffer);
     return nullptr;
   }
 
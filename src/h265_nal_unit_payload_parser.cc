@@ -12,6 +12,7 @@
 
 #include "h265_aud_parser.h"
 #include "h265_common.h"
+#include "h265_parser_context.h"
 #include "h265_pps_parser.h"
 #include "h265_slice_parser.h"
 #include "h265_sps_parser.h"
@@ -31,8 +32,13 @@ H265NalUnitPayloadParser::ParseNalUnitPayload(
   std::vector<uint8_t> unpacked_buffer = UnescapeRbsp(data, length);
   BitBuffer bit_buffer(unpacked_buffer.data(), unpacked_buffer.size());
 
-  return ParseNalUnitPayload(&bit_buffer, nal_unit_type,
-                             bitstream_parser_state);
+  auto nal_unit_payload = ParseNalUnitPayload(&bit_buffer, nal_unit_type,
+                                              bitstream_parser_state);
+  if (nal_unit_payload != nullptr &&
+      nal_unit_payload->slice_segment_layer != nullptr) {
+    nal_unit_payload->slice_segment_layer->MapEscapedOffsets(data, length);
+  }
+  return nal_unit_payload;
 }
 
 std::unique_ptr<H265NalUnitPayloadParser::NalUnitPayloadState>
@@ -42,7 +48,7 @@ H265NalUnitPayloadParser::ParseNalUnitPayload(
   // H265 NAL Unit Payload (nal_unit()) parser.
   // Section 7.3.1.1 ("General NAL unit header syntax") of the H.265
   // standard for a complete description.
-  auto nal_unit_payload = std::make_unique<NalUnitPayloadState>();
+  auto nal_unit_payload = H265ParserContext::MakeState<NalUnitPayloadState>();
 
   // payload (Table 7-1, Section 7.4.2.2)
   switch (nal_unit_type) {
@@ -0,0 +1,1639 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_parameter_set_writer.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+#include "h265_common.h"
+#include "h265_hrd_parameters_parser.h"
+#include "h265_pps_multilayer_extension_parser.h"
+#include "h265_pps_parser.h"
+#include "h265_pps_scc_extension_parser.h"
+#include "h265_profile_tier_level_parser.h"
+#include "h265_scaling_list_data_parser.h"
+#include "h265_sps_3d_extension_parser.h"
+#include "h265_sps_multilayer_extension_parser.h"
+#include "h265_sps_parser.h"
+#include "h265_sps_range_extension_parser.h"
+#include "h265_sps_scc_extension_parser.h"
+#include "h265_st_ref_pic_set_parser.h"
+#include "h265_sub_layer_hrd_parameters_parser.h"
+#include "h265_vps_parser.h"
+#include "h265_vui_parameters_parser.h"
+#include "rtc_common.h"
+
+namespace {
+using h265nal::BitBufferWriter;
+
+// RBSP buffer sizes: the buffer is doubled until the RBSP fits
+constexpr size_t kInitialRbspSize = 256;
+constexpr size_t kMaxRbspSize = 1 << 20;
+// a failed write this close to the end of the buffer may have run out of
+// space (the longest syntax element is a 63-bit ue(v))
+constexpr size_t kMaxSyntaxElementSize = 8;
+
+// u(n), failing if `value` does not fit in `bit_count` bits
+bool WriteBits(BitBufferWriter* bit_buffer, uint64_t value,
+               size_t bit_count) {
+  if (bit_count == 0) {
+    return value == 0;
+  }
+  if (bit_count > 64 || (bit_count < 64 && (value >> bit_count) != 0)) {
+    return false;
+  }
+  return bit_buffer->WriteBits(value, bit_count);
+}
+
+// u(1) for a list of flags
+bool WriteFlags(BitBufferWriter* bit_buffer,
+                std::initializer_list<uint32_t> flags) {
+  for (uint32_t flag : flags) {
+    if (!WriteBits(bit_buffer, flag, 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// rbsp_trailing_bits() (Section 7.3.2.11)
+bool WriteRbspTrailingBits(BitBufferWriter* bit_buffer) {
+  // rbsp_stop_one_bit  f(1)
+  if (!bit_buffer->WriteBits(1, 1)) {
+    return false;
+  }
+  size_t byte_offset, bit_offset;
+  bit_buffer->GetCurrentOffset(&byte_offset, &bit_offset);
+  // rbsp_alignment_zero_bit  f(1)
+  return bit_offset == 0 || bit_buffer->WriteBits(0, 8 - bit_offset);
+}
+
+// profile_tier_level() profile fields (Section 7.3.3)
+bool WriteProfileInfo(
+    BitBufferWriter* bit_buffer,
+    const h265nal::H265ProfileInfoParser::ProfileInfoState& profile_info) {
+  auto profile = [&profile_info](uint32_t j) {
+    return profile_info.profile_idc == j ||
+           profile_info.profile_compatibility_flag[j] == 1;
+  };
+  // profile_space  u(2)
+  // tier_flag  u(1)
+  // profile_idc  u(5)
+  if (!WriteBits(bit_buffer, profile_info.profile_space, 2) ||
+      !WriteBits(bit_buffer, profile_info.tier_flag, 1) ||
+      !WriteBits(bit_buffer, profile_info.profile_idc, 5)) {
+    return false;
+  }
+  for (uint32_t j = 0; j < 32; j++) {
+    // profile_compatibility_flag[j]  u(1)
+    if (!WriteBits(bit_buffer, profile_info.profile_compatibility_flag[j],
+                   1)) {
+      return false;
+    }
+  }
+  // progressive_source_flag  u(1)
+  // interlaced_source_flag  u(1)
+  // non_packed_constraint_flag  u(1)
+  // frame_only_constraint_flag  u(1)
+  if (!WriteFlags(bit_buffer, {profile_info.progressive_source_flag,
+                               profile_info.interlaced_source_flag,
+                               profile_info.non_packed_constraint_flag,
+                               profile_info.frame_only_constraint_flag})) {
+    return false;
+  }
+  if (profile(4) || profile(5) || profile(6) || profile(7) || profile(8) ||
+      profile(9) || profile(10) || profile(11)) {
+    // max_12bit_constraint_flag  u(1)
+    // max_10bit_constraint_flag  u(1)
+    // max_8bit_constraint_flag  u(1)
+    // max_422chroma_constraint_flag  u(1)
+    // max_420chroma_constraint_flag  u(1)
+    // max_monochrome_constraint_flag  u(1)
+    // intra_constraint_flag  u(1)
+    // one_picture_only_constraint_flag  u(1)
+    // lower_bit_rate_constraint_flag  u(1)
+    if (!WriteFlags(bit_buffer,
+                    {profile_info.max_12bit_constraint_flag,
+                     profile_info.max_10bit_constraint_flag,
+                     profile_info.max_8bit_constraint_flag,
+                     profile_info.max_422chroma_constraint_flag,
+                     profile_info.max_420chroma_constraint_flag,
+                     profile_info.max_monochrome_constraint_flag,
+                     profile_info.intra_constraint_flag,
+                     profile_info.one_picture_only_constraint_flag,
+                     profile_info.lower_bit_rate_constraint_flag})) {
+      return false;
+    }
+    if (profile(5) || profile(9) || profile(10) || profile(11)) {
+      // max_14bit_constraint_flag  u(1)
+      // reserved_zero_33bits  u(33)
+      if (!WriteBits(bit_buffer, profile_info.max_14bit_constraint_flag, 1) ||
+          !WriteBits(bit_buffer, profile_info.reserved_zero_33bits, 33)) {
+        return false;
+      }
+    } else {
+      // reserved_zero_34bits  u(34)
+      if (!WriteBits(bit_buffer, profile_info.reserved_zero_34bits, 34)) {
+        return false;
+      }
+    }
+  } else if (profile(2)) {
+    // reserved_zero_7bits  u(7)
+    // one_picture_only_constraint_flag  u(1)
+    // reserved_zero_35bits  u(35)
+    if (!WriteBits(bit_buffer, profile_info.reserved_zero_7bits, 7) ||
+        !WriteBits(bit_buffer, profile_info.one_picture_only_constraint_flag,
+                   1) ||
+        !WriteBits(bit_buffer, profile_info.reserved_zero_35bits, 35)) {
+      return false;
+    }
+  } else {
+    // reserved_zero_43bits  u(43)
+    if (!WriteBits(bit_buffer, profile_info.reserved_zero_43bits, 43)) {
+      return false;
+    }
+  }
+  if (profile(1) || profile(2) || profile(3) || profile(4) || profile(5) ||
+      profile(9) || profile(11)) {
+    // inbld_flag  u(1)
+    return WriteBits(bit_buffer, profile_info.inbld_flag, 1);
+  }
+  // reserved_zero_bit  u(1)
+  return WriteBits(bit_buffer, profile_info.reserved_zero_bit, 1);
+}
+
+// profile_tier_level(1, maxNumSubLayersMinus1) (Section 7.3.3)
+bool WriteProfileTierLevel(
+    BitBufferWriter* bit_buffer,
+    const h265nal::H265ProfileTierLevelParser::ProfileTierLevelState* ptl,
+    uint32_t maxNumSubLayersMinus1) {
+  if (ptl == nullptr || ptl->general == nullptr ||
+      ptl->sub_layer_profile_present_flag.size() < maxNumSubLayersMinus1 ||
+      ptl->sub_layer_level_present_flag.size() < maxNumSubLayersMinus1) {
+    return false;
+  }
+  // general_level_idc  u(8)
+  if (!WriteProfileInfo(bit_buffer, *ptl->general) ||
+      !WriteBits(bit_buffer, ptl->general_level_idc, 8)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < maxNumSubLayersMinus1; i++) {
+    // sub_layer_profile_present_flag[i]  u(1)
+    // sub_layer_level_present_flag[i]  u(1)
+    if (!WriteBits(bit_buffer, ptl->sub_layer_profile_present_flag[i], 1) ||
+        !WriteBits(bit_buffer, ptl->sub_layer_level_present_flag[i], 1)) {
+      return false;
+    }
+  }
+  if (maxNumSubLayersMinus1 > 0) {
+    if (ptl->reserved_zero_2bits.size() < 8 - maxNumSubLayersMinus1) {
+      return false;
+    }
+    for (uint32_t i = maxNumSubLayersMinus1; i < 8; i++) {
+      // reserved_zero_2bits[i]  u(2)
+      if (!WriteBits(bit_buffer,
+                     ptl->reserved_zero_2bits[i - maxNumSubLayersMinus1],
+                     2)) {
+        return false;
+      }
+    }
+  }
+  // the sub-layer profiles and levels are only stored when present, and
+  // (as in the parser) the level follows sub_layer_profile_present_flag
+  size_t k = 0;
+  for (uint32_t i = 0; i < maxNumSubLayersMinus1; i++) {
+    if (!ptl->sub_layer_profile_present_flag[i]) {
+      continue;
+    }
+    if (k >= ptl->sub_layer.size() || ptl->sub_layer[k] == nullptr ||
+        k >= ptl->sub_layer_level_idc.size()) {
+      return false;
+    }
+    // sub_layer_level_idc[i]  u(8)
+    if (!WriteProfileInfo(bit_buffer, *ptl->sub_layer[k]) ||
+        !WriteBits(bit_buffer, ptl->sub_layer_level_idc[k], 8)) {
+      return false;
+    }
+    k++;
+  }
+  return true;
+}
+
+// sub_layer_hrd_parameters() (Section E.2.3)
+bool WriteSubLayerHrdParameters(
+    BitBufferWriter* bit_buffer,
+    const h265nal::H265SubLayerHrdParametersParser::SubLayerHrdParametersState*
+        sub_layer_hrd_parameters,
+    uint32_t CpbCnt, uint32_t sub_pic_hrd_params_present_flag) {
+  const auto* state = sub_layer_hrd_parameters;
+  if (state == nullptr || state->bit_rate_value_minus1.size() < CpbCnt ||
+      state->cpb_size_value_minus1.size() < CpbCnt ||
+      state->cpb_size_du_value_minus1.size() < CpbCnt ||
+      state->bit_rate_du_value_minus1.size() < CpbCnt ||
+      state->cbr_flag.size() < CpbCnt) {
+    return false;
+  }
+  for (uint32_t i = 0; i < CpbCnt; i++) {
+    // bit_rate_value_minus1[i]  ue(v)
+    // cpb_size_value_minus1[i]  ue(v)
+    if (!bit_buffer->WriteExponentialGolomb(state->bit_rate_value_minus1[i]) ||
+        !bit_buffer->WriteExponentialGolomb(state->cpb_size_value_minus1[i])) {
+      return false;
+    }
+    if (sub_pic_hrd_params_present_flag) {
+      // cpb_size_du_value_minus1[i]  ue(v)
+      // bit_rate_du_value_minus1[i]  ue(v)
+      if (!bit_buffer->WriteExponentialGolomb(
+              state->cpb_size_du_value_minus1[i]) ||
+          !bit_buffer->WriteExponentialGolomb(
+              state->bit_rate_du_value_minus1[i])) {
+        return false;
+      }
+    }
+    // cbr_flag[i]  u(1)
+    if (!WriteBits(bit_buffer, state->cbr_flag[i], 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// hrd_parameters(commonInfPresentFlag, maxNumSubLayersMinus1)
+// (Section E.2.2)
+bool WriteHrdParameters(
+    BitBufferWriter* bit_buffer,
+    const h265nal::H265HrdParametersParser::HrdParametersState* hrd,
+    uint32_t commonInfPresentFlag, uint32_t maxNumSubLayersMinus1) {
+  if (hrd == nullptr) {
+    return false;
+  }
+  if (commonInfPresentFlag) {
+    // nal_hrd_parameters_present_flag  u(1)
+    // vcl_hrd_parameters_present_flag  u(1)
+    if (!WriteFlags(bit_buffer, {hrd->nal_hrd_parameters_present_flag,
+                                 hrd->vcl_hrd_parameters_present_flag})) {
+      return false;
+    }
+    if (hrd->nal_hrd_parameters_present_flag ||
+        hrd->vcl_hrd_parameters_present_flag) {
+      // sub_pic_hrd_params_present_flag  u(1)
+      if (!WriteBits(bit_buffer, hrd->sub_pic_hrd_params_present_flag, 1)) {
+        return false;
+      }
+      if (hrd->sub_pic_hrd_params_present_flag) {
+        // tick_divisor_minus2  u(8)
+        // du_cpb_removal_delay_increment_length_minus1  u(5)
+        // sub_pic_cpb_params_in_pic_timing_sei_flag  u(1)
+        // dpb_output_delay_du_length_minus1  u(5)
+        if (!WriteBits(bit_buffer, hrd->tick_divisor_minus2, 8) ||
+            !WriteBits(bit_buffer,
+                       hrd->du_cpb_removal_delay_increment_length_minus1, 5) ||
+            !WriteBits(bit_buffer,
+                       hrd->sub_pic_cpb_params_in_pic_timing_sei_flag, 1) ||
+            !WriteBits(bit_buffer, hrd->dpb_output_delay_du_length_minus1,
+                       5)) {
+          return false;
+        }
+      }
+      // bit_rate_scale  u(4)
+      // cpb_size_scale  u(4)
+      if (!WriteBits(bit_buffer, hrd->bit_rate_scale, 4) ||
+          !WriteBits(bit_buffer, hrd->cpb_size_scale, 4)) {
+        return false;
+      }
+      if (hrd->sub_pic_hrd_params_present_flag) {
+        // cpb_size_du_scale  u(4)
+        if (!WriteBits(bit_buffer, hrd->cpb_size_du_scale, 4)) {
+          return false;
+        }
+      }
+      // initial_cpb_removal_delay_length_minus1  u(5)
+      // au_cpb_removal_delay_length_minus1  u(5)
+      // dpb_output_delay_length_minus1  u(5)
+      if (!WriteBits(bit_buffer, hrd->initial_cpb_removal_delay_length_minus1,
+                     5) ||
+          !WriteBits(bit_buffer, hrd->au_cpb_removal_delay_length_minus1, 5) ||
+          !WriteBits(bit_buffer, hrd->dpb_output_delay_length_minus1, 5)) {
+        return false;
+      }
+    }
+  }
+
+  if (hrd->fixed_pic_rate_general_flag.size() <= maxNumSubLayersMinus1 ||
+      hrd->fixed_pic_rate_within_cvs_flag.size() <= maxNumSubLayersMinus1 ||
+      hrd->elemental_duration_in_tc_minus1.size() <= maxNumSubLayersMinus1 ||
+      hrd->low_delay_hrd_flag.size() <= maxNumSubLayersMinus1 ||
+      hrd->cpb_cnt_minus1.size() <= maxNumSubLayersMinus1) {
+    return false;
+  }
+  size_t k = 0;
+  for (uint32_t i = 0; i <= maxNumSubLayersMinus1; i++) {
+    // fixed_pic_rate_general_flag[i]  u(1)
+    if (!WriteBits(bit_buffer, hrd->fixed_pic_rate_general_flag[i], 1)) {
+      return false;
+    }
+    if (!hrd->fixed_pic_rate_general_flag[i]) {
+      // fixed_pic_rate_within_cvs_flag[i]  u(1)
+      if (!WriteBits(bit_buffer, hrd->fixed_pic_rate_within_cvs_flag[i], 1)) {
+        return false;
+      }
+    }
+    if (hrd->fixed_pic_rate_within_cvs_flag[i]) {
+      // elemental_duration_in_tc_minus1[i]  ue(v)
+      if (!bit_buffer->WriteExponentialGolomb(
+              hrd->elemental_duration_in_tc_minus1[i])) {
+        return false;
+      }
+    } else {
+      // low_delay_hrd_flag[i]  u(1)
+      if (!WriteBits(bit_buffer, hrd->low_delay_hrd_flag[i], 1)) {
+        return false;
+      }
+    }
+    if (!hrd->low_delay_hrd_flag[i]) {
+      // cpb_cnt_minus1[i]  ue(v)
+      if (!bit_buffer->WriteExponentialGolomb(hrd->cpb_cnt_minus1[i])) {
+        return false;
+      }
+    }
+    uint64_t CpbCnt = static_cast<uint64_t>(hrd->cpb_cnt_minus1[i]) + 1;
+    for (uint32_t present_flag : {hrd->nal_hrd_parameters_present_flag,
+                                  hrd->vcl_hrd_parameters_present_flag}) {
+      if (!present_flag) {
+        continue;
+      }
+      // sub_layer_hrd_parameters(i)
+      if (k >= hrd->sub_layer_hrd_parameters_vector.size() ||
+          CpbCnt > UINT32_MAX ||
+          !WriteSubLayerHrdParameters(
+              bit_buffer, hrd->sub_layer_hrd_parameters_vector[k].get(),
+              static_cast<uint32_t>(CpbCnt),
+              hrd->sub_pic_hrd_params_present_flag)) {
+        return false;
+      }
+      k++;
+    }
+  }
+  return true;
+}
+
+// scaling_list_data() (Section 7.3.4)
+bool WriteScalingListData(
+    BitBufferWriter* bit_buffer,
+    const h265nal::H265ScalingListDataParser::ScalingListDataState*
+        scaling_list_data) {
+  const auto* state = scaling_list_data;
+  if (state == nullptr || state->scaling_list_pred_mode_flag.size() < 4 ||
+      state->scaling_list_pred_matrix_id_delta.size() < 4 ||
+      state->scaling_list_dc_coef_minus8.size() < 2 ||
+      state->ScalingList.size() < 4) {
+    return false;
+  }
+  for (uint32_t sizeId = 0; sizeId < 4; sizeId++) {
+    if (state->scaling_list_pred_mode_flag[sizeId].size() < 6 ||
+        state->scaling_list_pred_matrix_id_delta[sizeId].size() < 6 ||
+        state->ScalingList[sizeId].size() < 6 ||
+        (sizeId > 1 &&
+         state->scaling_list_dc_coef_minus8[sizeId - 2].size() < 6)) {
+      return false;
+    }
+    for (uint32_t matrixId = 0; matrixId < 6;
+         matrixId += (sizeId == 3) ? 3 : 1) {
+      // scaling_list_pred_mode_flag[sizeId][matrixId]  u(1)
+      uint32_t pred_mode_flag =
+          state->scaling_list_pred_mode_flag[sizeId][matrixId];
+      if (!WriteBits(bit_buffer, pred_mode_flag, 1)) {
+        return false;
+      }
+      if (!pred_mode_flag) {
+        // scaling_list_pred_matrix_id_delta[sizeId][matrixId]  ue(v)
+        if (!bit_buffer->WriteExponentialGolomb(
+                state->scaling_list_pred_matrix_id_delta[sizeId][matrixId])) {
+          return false;
+        }
+        continue;
+      }
+      uint32_t nextCoef = 8;
+      uint32_t coefNum =
+          std::min(64U, static_cast<uint32_t>(1 << (4 + (sizeId << 1))));
+      const auto& scaling_list = state->ScalingList[sizeId][matrixId];
+      if (scaling_list.size() < coefNum) {
+        return false;
+      }
+      if (sizeId > 1) {
+        // scaling_list_dc_coef_minus8[sizeId - 2][matrixId]  se(v)
+        int32_t dc_coef_minus8 =
+            state->scaling_list_dc_coef_minus8[sizeId - 2][matrixId];
+        if (!bit_buffer->WriteSignedExponentialGolomb(dc_coef_minus8)) {
+          return false;
+        }
+        nextCoef = static_cast<uint32_t>(dc_coef_minus8 + 8);
+      }
+      for (uint32_t i = 0; i < coefNum; i++) {
+        // scaling_list_delta_coef  se(v), in the range of -128 to 127
+        // (ScalingList keeps the coefficients, modulo 256)
+        int32_t scaling_list_delta_coef =
+            static_cast<int32_t>((scaling_list[i] - nextCoef + 128) & 0xff) -
+            128;
+        if (!bit_buffer->WriteSignedExponentialGolomb(
+                scaling_list_delta_coef)) {
+          return false;
+        }
+        nextCoef = scaling_list[i];
+      }
+    }
+  }
+  return true;
+}
+
+// st_ref_pic_set(stRpsIdx) (Section 7.3.7)
+bool WriteStRefPicSet(
+    BitBufferWriter* bit_buffer,
+    const std::vector<
+        std::unique_ptr<h265nal::H265StRefPicSetParser::StRefPicSetState>>&
+        st_ref_pic_set_vector,
+    uint32_t stRpsIdx, uint32_t num_short_term_ref_pic_sets) {
+  if (stRpsIdx >= st_ref_pic_set_vector.size() ||
+      st_ref_pic_set_vector[stRpsIdx] == nullptr) {
+    return false;
+  }
+  const auto& st_ref_pic_set = *st_ref_pic_set_vector[stRpsIdx];
+  if (stRpsIdx != 0) {
+    // inter_ref_pic_set_prediction_flag  u(1)
+    if (!WriteBits(bit_buffer, st_ref_pic_set.inter_ref_pic_set_prediction_flag,
+                   1)) {
+      return false;
+    }
+  } else if (st_ref_pic_set.inter_ref_pic_set_prediction_flag) {
+    return false;
+  }
+
+  if (st_ref_pic_set.inter_ref_pic_set_prediction_flag) {
+    if (stRpsIdx == num_short_term_ref_pic_sets) {
+      // delta_idx_minus1  ue(v)
+      if (!bit_buffer->WriteExponentialGolomb(
+              st_ref_pic_set.delta_idx_minus1)) {
+        return false;
+      }
+    }
+    // delta_rps_sign  u(1)
+    // abs_delta_rps_minus1  ue(v)
+    if (!WriteBits(bit_buffer, st_ref_pic_set.delta_rps_sign, 1) ||
+        !bit_buffer->WriteExponentialGolomb(
+            st_ref_pic_set.abs_delta_rps_minus1)) {
+      return false;
+    }
+    // Equation 7-59
+    if (st_ref_pic_set.delta_idx_minus1 >= stRpsIdx) {
+      return false;
+    }
+    uint32_t RefRpsIdx = stRpsIdx - (st_ref_pic_set.delta_idx_minus1 + 1);
+    const auto& ref = st_ref_pic_set_vector[RefRpsIdx];
+    if (ref == nullptr) {
+      return false;
+    }
+    // Equation 7-71
+    uint64_t NumDeltaPocs_RefRpsIdx =
+        static_cast<uint64_t>(ref->num_negative_pics) + ref->num_positive_pics;
+    if (st_ref_pic_set.used_by_curr_pic_flag.size() <=
+            NumDeltaPocs_RefRpsIdx ||
+        st_ref_pic_set.use_delta_flag.size() <= NumDeltaPocs_RefRpsIdx) {
+      return false;
+    }
+    for (size_t j = 0; j <= NumDeltaPocs_RefRpsIdx; j++) {
+      // used_by_curr_pic_flag[j]  u(1)
+      if (!WriteBits(bit_buffer, st_ref_pic_set.used_by_curr_pic_flag[j], 1)) {
+        return false;
+      }
+      if (!st_ref_pic_set.used_by_curr_pic_flag[j]) {
+        // use_delta_flag[j]  u(1)
+        if (!WriteBits(bit_buffer, st_ref_pic_set.use_delta_flag[j], 1)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  uint32_t num_negative_pics = st_ref_pic_set.num_negative_pics;
+  uint32_t num_positive_pics = st_ref_pic_set.num_positive_pics;
+  if (st_ref_pic_set.delta_poc_s0_minus1.size() < num_negative_pics ||
+      st_ref_pic_set.used_by_curr_pic_s0_flag.size() < num_negative_pics ||
+      st_ref_pic_set.delta_poc_s1_minus1.size() < num_positive_pics ||
+      st_ref_pic_set.used_by_curr_pic_s1_flag.size() < num_positive_pics) {
+    return false;
+  }
+  // num_negative_pics  ue(v)
+  // num_positive_pics  ue(v)
+  if (!bit_buffer->WriteExponentialGolomb(num_negative_pics) ||
+      !bit_buffer->WriteExponentialGolomb(num_positive_pics)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < num_negative_pics; i++) {
+    // delta_poc_s0_minus1[i]  ue(v)
+    // used_by_curr_pic_s0_flag[i]  u(1)
+    if (!bit_buffer->WriteExponentialGolomb(
+            st_ref_pic_set.delta_poc_s0_minus1[i]) ||
+        !WriteBits(bit_buffer, st_ref_pic_set.used_by_curr_pic_s0_flag[i],
+                   1)) {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < num_positive_pics; i++) {
+    // delta_poc_s1_minus1[i]  ue(v)
+    // used_by_curr_pic_s1_flag[i]  u(1)
+    if (!bit_buffer->WriteExponentialGolomb(
+            st_ref_pic_set.delta_poc_s1_minus1[i]) ||
+        !WriteBits(bit_buffer, st_ref_pic_set.used_by_curr_pic_s1_flag[i],
+                   1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// vui_parameters() (Section E.2.1)
+bool WriteVuiParameters(
+    BitBufferWriter* bit_buffer,
+    const h265nal::H265VuiParametersParser::VuiParametersState* vui,
+    uint32_t sps_max_sub_layers_minus1) {
+  if (vui == nullptr) {
+    return false;
+  }
+  // aspect_ratio_info_present_flag  u(1)
+  if (!WriteBits(bit_buffer, vui->aspect_ratio_info_present_flag, 1)) {
+    return false;
+  }
+  if (vui->aspect_ratio_info_present_flag) {
+    // aspect_ratio_idc  u(8)
+    if (!WriteBits(bit_buffer, vui->aspect_ratio_idc, 8)) {
+      return false;
+    }
+    if (vui->aspect_ratio_idc == h265nal::AR_EXTENDED_SAR) {
+      // sar_width  u(16)
+      // sar_height  u(16)
+      if (!WriteBits(bit_buffer, vui->sar_width, 16) ||
+          !WriteBits(bit_buffer, vui->sar_height, 16)) {
+        return false;
+      }
+    }
+  }
+  // overscan_info_present_flag  u(1)
+  if (!WriteBits(bit_buffer, vui->overscan_info_present_flag, 1)) {
+    return false;
+  }
+  if (vui->overscan_info_present_flag) {
+    // overscan_appropriate_flag  u(1)
+    if (!WriteBits(bit_buffer, vui->overscan_appropriate_flag, 1)) {
+      return false;
+    }
+  }
+  // video_signal_type_present_flag  u(1)
+  if (!WriteBits(bit_buffer, vui->video_signal_type_present_flag, 1)) {
+    return false;
+  }
+  if (vui->video_signal_type_present_flag) {
+    // video_format  u(3)
+    // video_full_range_flag  u(1)
+    // colour_description_present_flag  u(1)
+    if (!WriteBits(bit_buffer, vui->video_format, 3) ||
+        !WriteBits(bit_buffer, vui->video_full_range_flag, 1) ||
+        !WriteBits(bit_buffer, vui->colour_description_present_flag, 1)) {
+      return false;
+    }
+    if (vui->colour_description_present_flag) {
+      // colour_primaries  u(8)
+      // transfer_characteristics  u(8)
+      // matrix_coeffs  u(8)
+      if (!WriteBits(bit_buffer, vui->colour_primaries, 8) ||
+          !WriteBits(bit_buffer, vui->transfer_characteristics, 8) ||
+          !WriteBits(bit_buffer, vui->matrix_coeffs, 8)) {
+        return false;
+      }
+    }
+  }
+  // chroma_loc_info_present_flag  u(1)
+  if (!WriteBits(bit_buffer, vui->chroma_loc_info_present_flag, 1)) {
+    return false;
+  }
+  if (vui->chroma_loc_info_present_flag) {
+    // chroma_sample_loc_type_top_field  ue(v)
+    // chroma_sample_loc_type_bottom_field  ue(v)
+    if (!bit_buffer->WriteExponentialGolomb(
+            vui->chroma_sample_loc_type_top_field) ||
+        !bit_buffer->WriteExponentialGolomb(
+            vui->chroma_sample_loc_type_bottom_field)) {
+      return false;
+    }
+  }
+  // neutral_chroma_indication_flag  u(1)
+  // field_seq_flag  u(1)
+  // frame_field_info_present_flag  u(1)
+  // default_display_window_flag  u(1)
+  if (!WriteFlags(bit_buffer, {vui->neutral_chroma_indication_flag,
+                               vui->field_seq_flag,
+                               vui->frame_field_info_present_flag,
+                               vui->default_display_window_flag})) {
+    return false;
+  }
+  if (vui->default_display_window_flag) {
+    // def_disp_win_left_offset  ue(v)
+    // def_disp_win_right_offset  ue(v)
+    // def_disp_win_top_offset  ue(v)
+    // def_disp_win_bottom_offset  ue(v)
+    if (!bit_buffer->WriteExponentialGolomb(vui->def_disp_win_left_offset) ||
+        !bit_buffer->WriteExponentialGolomb(vui->def_disp_win_right_offset) ||
+        !bit_buffer->WriteExponentialGolomb(vui->def_disp_win_top_offset) ||
+        !bit_buffer->WriteExponentialGolomb(vui->def_disp_win_bottom_offset)) {
+      return false;
+    }
+  }
+  // vui_timing_info_present_flag  u(1)
+  if (!WriteBits(bit_buffer, vui->vui_timing_info_present_flag, 1)) {
+    return false;
+  }
+  if (vui->vui_timing_info_present_flag) {
+    // vui_num_units_in_tick  u(32)
+    // vui_time_scale  u(32)
+    // vui_poc_proportional_to_timing_flag  u(1)
+    if (!WriteBits(bit_buffer, vui->vui_num_units_in_tick, 32) ||
+        !WriteBits(bit_buffer, vui->vui_time_scale, 32) ||
+        !WriteBits(bit_buffer, vui->vui_poc_proportional_to_timing_flag, 1)) {
+      return false;
+    }
+    if (vui->vui_poc_proportional_to_timing_flag) {
+      // vui_num_ticks_poc_diff_one_minus1  ue(v)
+      if (!bit_buffer->WriteExponentialGolomb(
+              vui->vui_num_ticks_poc_diff_one_minus1)) {
+        return false;
+      }
+    }
+    // vui_hrd_parameters_present_flag  u(1)
+    if (!WriteBits(bit_buffer, vui->vui_hrd_parameters_present_flag, 1)) {
+      return false;
+    }
+    if (vui->vui_hrd_parameters_present_flag) {
+      // hrd_parameters(1, sps_max_sub_layers_minus1)
+      if (!WriteHrdParameters(bit_buffer, vui->hrd_parameters.get(), 1,
+                              sps_max_sub_layers_minus1)) {
+        return false;
+      }
+    }
+  }
+  // bitstream_restriction_flag  u(1)
+  if (!WriteBits(bit_buffer, vui->bitstream_restriction_flag, 1)) {
+    return false;
+  }
+  if (vui->bitstream_restriction_flag) {
+    // tiles_fixed_structure_flag  u(1)
+    // motion_vectors_over_pic_boundaries_flag  u(1)
+    // restricted_ref_pic_lists_flag  u(1)
+    // min_spatial_segmentation_idc  ue(v)
+    // max_bytes_per_pic_denom  ue(v)
+    // max_bits_per_min_cu_denom  ue(v)
+    // log2_max_mv_length_horizontal  ue(v)
+    // log2_max_mv_length_vertical  ue(v)
+    if (!WriteFlags(bit_buffer, {vui->tiles_fixed_structure_flag,
+                                 vui->motion_vectors_over_pic_boundaries_flag,
+                                 vui->restricted_ref_pic_lists_flag}) ||
+        !bit_buffer->WriteExponentialGolomb(
+            vui->min_spatial_segmentation_idc) ||
+        !bit_buffer->WriteExponentialGolomb(vui->max_bytes_per_pic_denom) ||
+        !bit_buffer->WriteExponentialGolomb(vui->max_bits_per_min_cu_denom) ||
+        !bit_buffer->WriteExponentialGolomb(
+            vui->log2_max_mv_length_horizontal) ||
+        !bit_buffer->WriteExponentialGolomb(vui->log2_max_mv_length_vertical)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// sps_range_extension() (Section 7.3.2.2.2)
+bool WriteSpsRangeExtension(
+    BitBufferWriter* bit_buffer,
+    const h265nal::H265SpsRangeExtensionParser::SpsRangeExtensionState* ext) {
+  // transform_skip_rotation_enabled_flag  u(1)
+  // transform_skip_context_enabled_flag  u(1)
+  // implicit_rdpcm_enabled_flag  u(1)
+  // explicit_rdpcm_enabled_flag  u(1)
+  // extended_precision_processing_flag  u(1)
+  // intra_smoothing_disabled_flag  u(1)
+  // high_precision_offsets_enabled_flag  u(1)
+  // persistent_rice_adaptation_enabled_flag  u(1)
+  // cabac_bypass_alignment_enabled_flag  u(1)
+  return ext != nullptr &&
+         WriteFlags(bit_buffer, {ext->transform_skip_rotation_enabled_flag,
+                                 ext->transform_skip_context_enabled_flag,
+                                 ext->implicit_rdpcm_enabled_flag,
+                                 ext->explicit_rdpcm_enabled_flag,
+                                 ext->extended_precision_processing_flag,
+                                 ext->intra_smoothing_disabled_flag,
+                                 ext->high_precision_offsets_enabled_flag,
+                                 ext->persistent_rice_adaptation_enabled_flag,
+                                 ext->cabac_bypass_alignment_enabled_flag});
+}
+
+// sps_3d_extension() (Section I.7.3.2.2.5)
+bool WriteSps3dExtension(
+    BitBufferWriter* bit_buffer,
+    const h265nal::H265Sps3dExtensionParser::Sps3dExtensionState* ext) {
+  if (ext == nullptr || ext->iv_di_mc_enabled_flag.size() < 2 ||
+      ext->iv_mv_scal_enabled_flag.size() < 2) {
+    return false;
+  }
+  for (uint32_t d = 0; d <= 1; d++) {
+    // iv_di_mc_enabled_flag[d]  u(1)
+    // iv_mv_scal_enabled_flag[d]  u(1)
+    if (!WriteFlags(bit_buffer, {ext->iv_di_mc_enabled_flag[d],
+                                 ext->iv_mv_scal_enabled_flag[d]})) {
+      return false;
+    }
+    if (d == 0) {
+      // log2_ivmc_sub_pb_size_minus3[d]  ue(v)
+      // iv_res_pred_enabled_flag[d]  u(1)
+      // depth_ref_enabled_flag[d]  u(1)
+      // vsp_mc_enabled_flag[d]  u(1)
+      // dbbp_enabled_flag[d]  u(1)
+      if (!bit_buffer->WriteExponentialGolomb(
+              ext->log2_ivmc_sub_pb_size_minus3) ||
+          !WriteFlags(bit_buffer,
+                      {ext->iv_res_pred_enabled_flag,
+                       ext->depth_ref_enabled_flag, ext->vsp_mc_enabled_flag,
+                       ext->dbbp_enabled_flag})) {
+        return false;
+      }
+    } else {
+      // tex_mc_enabled_flag[d]  u(1)
+      // log2_texmc_sub_pb_size_minus3[d]  ue(v)
+      // intra_contour_enabled_flag[d]  u(1)
+      // intra_dc_only_wedge_enabled_flag[d]  u(1)
+      // cqt_cu_part_pred_enabled_flag[d]  u(1)
+      // inter_dc_only_enabled_flag[d]  u(1)
+      // skip_intra_enabled_flag[d]  u(1)
+      if (!WriteBits(bit_buffer, ext->tex_mc_enabled_flag, 1) ||
+          !bit_buffer->WriteExponentialGolomb(
+              ext->log2_texmc_sub_pb_size_minus3) ||
+          !WriteFlags(bit_buffer, {ext->intra_contour_enabled_flag,
+                                   ext->intra_dc_only_wedge_enabled_flag,
+                                   ext->cqt_cu_part_pred_enabled_flag,
+                                   ext->inter_dc_only_enabled_flag,
+                                   ext->skip_intra_enabled_flag})) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// sps_scc_extension() (Section 7.3.2.2.3)
+bool WriteSpsSccExtension(
+    BitBufferWriter* bit_buffer,
+    const h265nal::H265SpsSccExtensionParser::SpsSccExtensionState* ext,
+    uint32_t chroma_format_idc, uint32_t bit_depth_luma_minus8,
+    uint32_t bit_depth_chroma_minus8) {
+  if (ext == nullptr) {
+    return false;
+  }
+  // sps_curr_pic_ref_enabled_flag  u(1)
+  // palette_mode_enabled_flag  u(1)
+  if (!WriteFlags(bit_buffer, {ext->sps_curr_pic_ref_enabled_flag,
+                               ext->palette_mode_enabled_flag})) {
+    return false;
+  }
+  if (ext->palette_mode_enabled_flag) {
+    // palette_max_size  ue(v)
+    // delta_palette_max_predictor_size  ue(v)
+    // sps_palette_predictor_initializers_present_flag  u(1)
+    if (!bit_buffer->WriteExponentialGolomb(ext->palette_max_size) ||
+        !bit_buffer->WriteExponentialGolomb(
+            ext->delta_palette_max_predictor_size) ||
+        !WriteBits(bit_buffer,
+                   ext->sps_palette_predictor_initializers_present_flag, 1)) {
+      return false;
+    }
+    if (ext->sps_palette_predictor_initializers_present_flag) {
+      // sps_num_palette_predictor_initializers_minus1  ue(v)
+      uint64_t num_initializers =
+          static_cast<uint64_t>(
+              ext->sps_num_palette_predictor_initializers_minus1) +
+          1;
+      if (!bit_buffer->WriteExponentialGolomb(
+              ext->sps_num_palette_predictor_initializers_minus1)) {
+        return false;
+      }
+      uint32_t numComps = (chroma_format_idc == 0) ? 1 : 3;
+      if (ext->sps_palette_predictor_initializers.size() < numComps) {
+        return false;
+      }
+      for (uint32_t comp = 0; comp < numComps; comp++) {
+        const auto& initializers =
+            ext->sps_palette_predictor_initializers[comp];
+        if (initializers.size() < num_initializers) {
+          return false;
+        }
+        // Equations 7-4 and 7-6
+        uint32_t bit_depth = 8 + ((comp == 0) ? bit_depth_luma_minus8
+                                              : bit_depth_chroma_minus8);
+        for (size_t i = 0; i < num_initializers; i++) {
+          // sps_palette_predictor_initializers[comp][i]  u(v)
+          if (!WriteBits(bit_buffer, initializers[i], bit_depth)) {
+            return false;
+          }
+        }
+      }
+    }
+  }
+  // motion_vector_resolution_control_idc  u(2)
+  // intra_boundary_filtering_disabled_flag  u(1)
+  return WriteBits(bit_buffer, ext->motion_vector_resolution_control_idc, 2) &&
+         WriteBits(bit_buffer, ext->intra_boundary_filtering_disabled_flag, 1);
+}
+
+// pps_multilayer_extension() (Section F.7.3.2.3.4)
+bool WritePpsMultilayerExtension(
+    BitBufferWriter* bit_buffer,
+    const h265nal::H265PpsMultilayerExtensionParser::
+        PpsMultilayerExtensionState* ext) {
+  // colour_mapping_table() is not kept by the parser
+  if (ext == nullptr || ext->colour_mapping_enabled_flag) {
+    return false;
+  }
+  // poc_reset_info_present_flag  u(1)
+  // pps_infer_scaling_list_flag  u(1)
+  if (!WriteFlags(bit_buffer, {ext->poc_reset_info_present_flag,
+                               ext->pps_infer_scaling_list_flag})) {
+    return false;
+  }
+  if (ext->pps_infer_scaling_list_flag) {
+    // pps_scaling_list_ref_layer_id  u(6)
+    if (!WriteBits(bit_buffer, ext->pps_scaling_list_ref_layer_id, 6)) {
+      return false;
+    }
+  }
+  // num_ref_loc_offsets  ue(v)
+  uint32_t num_ref_loc_offsets = ext->num_ref_loc_offsets;
+  if (!bit_buffer->WriteExponentialGolomb(num_ref_loc_offsets) ||
+      ext->ref_loc_offset_layer_id.size() < num_ref_loc_offsets ||
+      ext->scaled_ref_layer_offset_present_flag.size() < num_ref_loc_offsets ||
+      ext->ref_region_offset_present_flag.size() < num_ref_loc_offsets ||
+      ext->resample_phase_set_present_flag.size() < num_ref_loc_offsets) {
+    return false;
+  }
+  // the offsets and phases are only stored when present
+  auto write_offsets = [bit_buffer](
+                           size_t* k,
+                           std::initializer_list<const std::vector<int32_t>*>
+                               offsets) {
+    for (const auto* offset : offsets) {
+      if (*k >= offset->size() ||
+          !bit_buffer->WriteSignedExponentialGolomb((*offset)[*k])) {
+        return false;
+      }
+    }
+    (*k)++;
+    return true;
+  };
+  size_t scaled_ref_layer_k = 0;
+  size_t ref_region_k = 0;
+  size_t resample_phase_k = 0;
+  for (uint32_t i = 0; i < num_ref_loc_offsets; i++) {
+    // ref_loc_offset_layer_id[i]  u(6)
+    // scaled_ref_layer_offset_present_flag[i]  u(1)
+    if (!WriteBits(bit_buffer, ext->ref_loc_offset_layer_id[i], 6) ||
+        !WriteBits(bit_buffer, ext->scaled_ref_layer_offset_present_flag[i],
+                   1)) {
+      return false;
+    }
+    if (ext->scaled_ref_layer_offset_present_flag[i]) {
+      // scaled_ref_layer_{left,top,right,bottom}_offset  se(v)
+      if (!write_offsets(&scaled_ref_layer_k,
+                         {&ext->scaled_ref_layer_left_offset,
+                          &ext->scaled_ref_layer_top_offset,
+                          &ext->scaled_ref_layer_right_offset,
+                          &ext->scaled_ref_layer_bottom_offset})) {
+        return false;
+      }
+    }
+    // ref_region_offset_present_flag[i]  u(1)
+    if (!WriteBits(bit_buffer, ext->ref_region_offset_present_flag[i], 1)) {
+      return false;
+    }
+    if (ext->ref_region_offset_present_flag[i]) {
+      // ref_region_{left,top,right,bottom}_offset  se(v)
+      if (!write_offsets(&ref_region_k, {&ext->ref_region_left_offset,
+                                         &ext->ref_region_top_offset,
+                                         &ext->ref_region_right_offset,
+                                         &ext->ref_region_bottom_offset})) {
+        return false;
+      }
+    }
+    // resample_phase_set_present_flag[i]  u(1)
+    if (!WriteBits(bit_buffer, ext->resample_phase_set_present_flag[i], 1)) {
+      return false;
+    }
+    if (ext->resample_phase_set_present_flag[i]) {
+      // phase_{hor,ver}_luma, phase_{hor,ver}_chroma_plus8  se(v)
+      if (!write_offsets(&resample_phase_k, {&ext->phase_hor_luma,
+                                             &ext->phase_ver_luma,
+                                             &ext->phase_hor_chroma_plus8,
+                                             &ext->phase_ver_chroma_plus8})) {
+        return false;
+      }
+    }
+  }
+  // colour_mapping_enabled_flag  u(1)
+  return WriteBits(bit_buffer, ext->colour_mapping_enabled_flag, 1);
+}
+
+// pps_scc_extension() (Section 7.3.2.3.3)
+bool WritePpsSccExtension(
+    BitBufferWriter* bit_buffer,
+    const h265nal::H265PpsSccExtensionParser::PpsSccExtensionState* ext) {
+  if (ext == nullptr) {
+    return false;
+  }
+  // pps_curr_pic_ref_enabled_flag  u(1)
+  // residual_adaptive_colour_transform_enabled_flag  u(1)
+  if (!WriteFlags(bit_buffer,
+                  {ext->pps_curr_pic_ref_enabled_flag,
+                   ext->residual_adaptive_colour_transform_enabled_flag})) {
+    return false;
+  }
+  if (ext->residual_adaptive_colour_transform_enabled_flag) {
+    // pps_slice_act_qp_offsets_present_flag  u(1)
+    // pps_act_y_qp_offset_plus5  se(v)
+    // pps_act_cb_qp_offset_plus5  se(v)
+    // pps_act_cr_qp_offset_plus3  se(v)
+    if (!WriteBits(bit_buffer, ext->pps_slice_act_qp_offsets_present_flag,
+                   1) ||
+        !bit_buffer->WriteSignedExponentialGolomb(
+            ext->pps_act_y_qp_offset_plus5) ||
+        !bit_buffer->WriteSignedExponentialGolomb(
+            ext->pps_act_cb_qp_offset_plus5) ||
+        !bit_buffer->WriteSignedExponentialGolomb(
+            ext->pps_act_cr_qp_offset_plus3)) {
+      return false;
+    }
+  }
+  // pps_palette_predictor_initializer_present_flag  u(1)
+  if (!WriteBits(bit_buffer,
+                 ext->pps_palette_predictor_initializer_present_flag, 1)) {
+    return false;
+  }
+  if (!ext->pps_palette_predictor_initializer_present_flag) {
+    return true;
+  }
+  // pps_num_palette_predictor_initializer  ue(v)
+  uint32_t num_initializers = ext->pps_num_palette_predictor_initializer;
+  if (!bit_buffer->WriteExponentialGolomb(num_initializers)) {
+    return false;
+  }
+  if (num_initializers == 0) {
+    return true;
+  }
+  // monochrome_palette_flag  u(1)
+  // luma_bit_depth_entry_minus8  ue(v)
+  if (!WriteBits(bit_buffer, ext->monochrome_palette_flag, 1) ||
+      !bit_buffer->WriteExponentialGolomb(ext->luma_bit_depth_entry_minus8)) {
+    return false;
+  }
+  // (as in the parser)
+  if (ext->monochrome_palette_flag) {
+    // chroma_bit_depth_entry_minus8  ue(v)
+    if (!bit_buffer->WriteExponentialGolomb(
+            ext->chroma_bit_depth_entry_minus8)) {
+      return false;
+    }
+  }
+  uint32_t numComps = ext->monochrome_palette_flag ? 1 : 3;
+  if (ext->pps_palette_predictor_initializers.size() < numComps) {
+    return false;
+  }
+  for (uint32_t comp = 0; comp < numComps; comp++) {
+    const auto& initializers = ext->pps_palette_predictor_initializers[comp];
+    uint64_t bit_depth =
+        8ull + ((comp == 0) ? ext->luma_bit_depth_entry_minus8
+                            : ext->chroma_bit_depth_entry_minus8);
+    if (initializers.size() < num_initializers || bit_depth > 32) {
+      return false;
+    }
+    for (uint32_t i = 0; i < num_initializers; i++) {
+      // pps_palette_predictor_initializers[comp][i]  u(v)
+      if (!WriteBits(bit_buffer, initializers[i],
+                     static_cast<size_t>(bit_depth))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// video_parameter_set_rbsp() (Section 7.3.2.1)
+bool WriteVpsRbsp(BitBufferWriter* bit_buffer,
+                  const h265nal::H265VpsParser::VpsState& vps) {
+  // the parser keeps neither the VPS extension data nor more than one
+  // hrd_parameters()
+  if (vps.vps_extension_flag || vps.vps_num_hrd_parameters > 1) {
+    return false;
+  }
+  // vps_video_parameter_set_id  u(4)
+  // vps_base_layer_internal_flag  u(1)
+  // vps_base_layer_available_flag  u(1)
+  // vps_max_layers_minus1  u(6)
+  // vps_max_sub_layers_minus1  u(3)
+  // vps_temporal_id_nesting_flag  u(1)
+  // vps_reserved_0xffff_16bits  u(16)
+  if (!WriteBits(bit_buffer, vps.vps_video_parameter_set_id, 4) ||
+      !WriteBits(bit_buffer, vps.vps_base_layer_internal_flag, 1) ||
+      !WriteBits(bit_buffer, vps.vps_base_layer_available_flag, 1) ||
+      !WriteBits(bit_buffer, vps.vps_max_layers_minus1, 6) ||
+      !WriteBits(bit_buffer, vps.vps_max_sub_layers_minus1, 3) ||
+      !WriteBits(bit_buffer, vps.vps_temporal_id_nesting_flag, 1) ||
+      !WriteBits(bit_buffer, vps.vps_reserved_0xffff_16bits, 16)) {
+    return false;
+  }
+  // profile_tier_level(1, vps_max_sub_layers_minus1)
+  if (!WriteProfileTierLevel(bit_buffer, vps.profile_tier_level.get(),
+                             vps.vps_max_sub_layers_minus1)) {
+    return false;
+  }
+  // vps_sub_layer_ordering_info_present_flag  u(1)
+  if (!WriteBits(bit_buffer, vps.vps_sub_layer_ordering_info_present_flag,
+                 1)) {
+    return false;
+  }
+  size_t num_sub_layers = vps.vps_sub_layer_ordering_info_present_flag
+                              ? vps.vps_max_sub_layers_minus1 + 1
+                              : 1;
+  if (vps.vps_max_dec_pic_buffering_minus1.size() < num_sub_layers ||
+      vps.vps_max_num_reorder_pics.size() < num_sub_layers ||
+      vps.vps_max_latency_increase_plus1.size() < num_sub_layers) {
+    return false;
+  }
+  for (size_t i = 0; i < num_sub_layers; i++) {
+    // vps_max_dec_pic_buffering_minus1[i]  ue(v)
+    // vps_max_num_reorder_pics[i]  ue(v)
+    // vps_max_latency_increase_plus1[i]  ue(v)
+    if (!bit_buffer->WriteExponentialGolomb(
+            vps.vps_max_dec_pic_buffering_minus1[i]) ||
+        !bit_buffer->WriteExponentialGolomb(vps.vps_max_num_reorder_pics[i]) ||
+        !bit_buffer->WriteExponentialGolomb(
+            vps.vps_max_latency_increase_plus1[i])) {
+      return false;
+    }
+  }
+  // vps_max_layer_id  u(6)
+  // vps_num_layer_sets_minus1  ue(v)
+  if (!WriteBits(bit_buffer, vps.vps_max_layer_id, 6) ||
+      !bit_buffer->WriteExponentialGolomb(vps.vps_num_layer_sets_minus1) ||
+      vps.layer_id_included_flag.size() < vps.vps_num_layer_sets_minus1) {
+    return false;
+  }
+  for (uint32_t i = 1; i <= vps.vps_num_layer_sets_minus1; i++) {
+    const auto& layer_id_included_flag = vps.layer_id_included_flag[i - 1];
+    if (layer_id_included_flag.size() <= vps.vps_max_layer_id) {
+      return false;
+    }
+    for (uint32_t j = 0; j <= vps.vps_max_layer_id; j++) {
+      // layer_id_included_flag[i][j]  u(1)
+      if (!WriteBits(bit_buffer, layer_id_included_flag[j], 1)) {
+        return false;
+      }
+    }
+  }
+  // vps_timing_info_present_flag  u(1)
+  if (!WriteBits(bit_buffer, vps.vps_timing_info_present_flag, 1)) {
+    return false;
+  }
+  if (vps.vps_timing_info_present_flag) {
+    // vps_num_units_in_tick  u(32)
+    // vps_time_scale  u(32)
+    // vps_poc_proportional_to_timing_flag  u(1)
+    if (!WriteBits(bit_buffer, vps.vps_num_units_in_tick, 32) ||
+        !WriteBits(bit_buffer, vps.vps_time_scale, 32) ||
+        !WriteBits(bit_buffer, vps.vps_poc_proportional_to_timing_flag, 1)) {
+      return false;
+    }
+    if (vps.vps_poc_proportional_to_timing_flag) {
+      // vps_num_ticks_poc_diff_one_minus1  ue(v)
+      if (!bit_buffer->WriteExponentialGolomb(
+              vps.vps_num_ticks_poc_diff_one_minus1)) {
+        return false;
+      }
+    }
+    // vps_num_hrd_parameters  ue(v)
+    if (!bit_buffer->WriteExponentialGolomb(vps.vps_num_hrd_parameters)) {
+      return false;
+    }
+    if (vps.vps_num_hrd_parameters > 0) {
+      if (vps.hrd_layer_set_idx.empty() || vps.cprms_present_flag.empty()) {
+        return false;
+      }
+      // hrd_layer_set_idx[0]  ue(v)
+      // hrd_parameters(cprms_present_flag[0], vps_max_sub_layers_minus1)
+      if (!bit_buffer->WriteExponentialGolomb(vps.hrd_layer_set_idx[0]) ||
+          !WriteHrdParameters(bit_buffer, vps.hrd_parameters.get(),
+                              vps.cprms_present_flag[0],
+                              vps.vps_max_sub_layers_minus1)) {
+        return false;
+      }
+    }
+  }
+  // vps_extension_flag  u(1)
+  return WriteBits(bit_buffer, vps.vps_extension_flag, 1) &&
+         WriteRbspTrailingBits(bit_buffer);
+}
+
+// seq_parameter_set_rbsp() (Section 7.3.2.2)
+bool WriteSpsRbsp(BitBufferWriter* bit_buffer,
+                  const h265nal::H265SpsParser::SpsState& sps) {
+  // the parser does not keep the SPS extension data
+  if (sps.sps_extension_4bits) {
+    return false;
+  }
+  // sps_video_parameter_set_id  u(4)
+  // sps_max_sub_layers_minus1  u(3)
+  // sps_temporal_id_nesting_flag  u(1)
+  if (!WriteBits(bit_buffer, sps.sps_video_parameter_set_id, 4) ||
+      !WriteBits(bit_buffer, sps.sps_max_sub_layers_minus1, 3) ||
+      !WriteBits(bit_buffer, sps.sps_temporal_id_nesting_flag, 1)) {
+    return false;
+  }
+  // profile_tier_level(1, sps_max_sub_layers_minus1)
+  if (!WriteProfileTierLevel(bit_buffer, sps.profile_tier_level.get(),
+                             sps.sps_max_sub_layers_minus1)) {
+    return false;
+  }
+  // sps_seq_parameter_set_id  ue(v)
+  // chroma_format_idc  ue(v)
+  if (!bit_buffer->WriteExponentialGolomb(sps.sps_seq_parameter_set_id) ||
+      !bit_buffer->WriteExponentialGolomb(sps.chroma_format_idc)) {
+    return false;
+  }
+  if (sps.chroma_format_idc == 3) {
+    // separate_colour_plane_flag  u(1)
+    if (!WriteBits(bit_buffer, sps.separate_colour_plane_flag, 1)) {
+      return false;
+    }
+  }
+  // pic_width_in_luma_samples  ue(v)
+  // pic_height_in_luma_samples  ue(v)
+  // conformance_window_flag  u(1)
+  if (!bit_buffer->WriteExponentialGolomb(sps.pic_width_in_luma_samples) ||
+      !bit_buffer->WriteExponentialGolomb(sps.pic_height_in_luma_samples) ||
+      !WriteBits(bit_buffer, sps.conformance_window_flag, 1)) {
+    return false;
+  }
+  if (sps.conformance_window_flag) {
+    // conf_win_left_offset  ue(v)
+    // conf_win_right_offset  ue(v)
+    // conf_win_top_offset  ue(v)
+    // conf_win_bottom_offset  ue(v)
+    if (!bit_buffer->WriteExponentialGolomb(sps.conf_win_left_offset) ||
+        !bit_buffer->WriteExponentialGolomb(sps.conf_win_right_offset) ||
+        !bit_buffer->WriteExponentialGolomb(sps.conf_win_top_offset) ||
+        !bit_buffer->WriteExponentialGolomb(sps.conf_win_bottom_offset)) {
+      return false;
+    }
+  }
+  // bit_depth_luma_minus8  ue(v)
+  // bit_depth_chroma_minus8  ue(v)
+  // log2_max_pic_order_cnt_lsb_minus4  ue(v)
+  // sps_sub_layer_ordering_info_present_flag  u(1)
+  if (!bit_buffer->WriteExponentialGolomb(sps.bit_depth_luma_minus8) ||
+      !bit_buffer->WriteExponentialGolomb(sps.bit_depth_chroma_minus8) ||
+      !bit_buffer->WriteExponentialGolomb(
+          sps.log2_max_pic_order_cnt_lsb_minus4) ||
+      !WriteBits(bit_buffer, sps.sps_sub_layer_ordering_info_present_flag,
+                 1)) {
+    return false;
+  }
+  size_t num_sub_layers = sps.sps_sub_layer_ordering_info_present_flag
+                              ? sps.sps_max_sub_layers_minus1 + 1
+                              : 1;
+  if (sps.sps_max_dec_pic_buffering_minus1.size() < num_sub_layers ||
+      sps.sps_max_num_reorder_pics.size() < num_sub_layers ||
+      sps.sps_max_latency_increase_plus1.size() < num_sub_layers) {
+    return false;
+  }
+  for (size_t i = 0; i < num_sub_layers; i++) {
+    // sps_max_dec_pic_buffering_minus1[i]  ue(v)
+    // sps_max_num_reorder_pics[i]  ue(v)
+    // sps_max_latency_increase_plus1[i]  ue(v)
+    if (!bit_buffer->WriteExponentialGolomb(
+            sps.sps_max_dec_pic_buffering_minus1[i]) ||
+        !bit_buffer->WriteExponentialGolomb(sps.sps_max_num_reorder_pics[i]) ||
+        !bit_buffer->WriteExponentialGolomb(
+            sps.sps_max_latency_increase_plus1[i])) {
+      return false;
+    }
+  }
+  // log2_min_luma_coding_block_size_minus3  ue(v)
+  // log2_diff_max_min_luma_coding_block_size  ue(v)
+  // log2_min_luma_transform_block_size_minus2  ue(v)
+  // log2_diff_max_min_luma_transform_block_size  ue(v)
+  // max_transform_hierarchy_depth_inter  ue(v)
+  // max_transform_hierarchy_depth_intra  ue(v)
+  // scaling_list_enabled_flag  u(1)
+  if (!bit_buffer->WriteExponentialGolomb(
+          sps.log2_min_luma_coding_block_size_minus3) ||
+      !bit_buffer->WriteExponentialGolomb(
+          sps.log2_diff_max_min_luma_coding_block_size) ||
+      !bit_buffer->WriteExponentialGolomb(
+          sps.log2_min_luma_transform_block_size_minus2) ||
+      !bit_buffer->WriteExponentialGolomb(
+          sps.log2_diff_max_min_luma_transform_block_size) ||
+      !bit_buffer->WriteExponentialGolomb(
+          sps.max_transform_hierarchy_depth_inter) ||
+      !bit_buffer->WriteExponentialGolomb(
+          sps.max_transform_hierarchy_depth_intra) ||
+      !WriteBits(bit_buffer, sps.scaling_list_enabled_flag, 1)) {
+    return false;
+  }
+  if (sps.scaling_list_enabled_flag) {
+    // sps_scaling_list_data_present_flag  u(1)
+    if (!WriteBits(bit_buffer, sps.sps_scaling_list_data_present_flag, 1)) {
+      return false;
+    }
+    if (sps.sps_scaling_list_data_present_flag) {
+      // scaling_list_data()
+      if (!WriteScalingListData(bit_buffer, sps.scaling_list_data.get())) {
+        return false;
+      }
+    }
+  }
+  // amp_enabled_flag  u(1)
+  // sample_adaptive_offset_enabled_flag  u(1)
+  // pcm_enabled_flag  u(1)
+  if (!WriteFlags(bit_buffer, {sps.amp_enabled_flag,
+                               sps.sample_adaptive_offset_enabled_flag,
+                               sps.pcm_enabled_flag})) {
+    return false;
+  }
+  if (sps.pcm_enabled_flag) {
+    // pcm_sample_bit_depth_luma_minus1  u(4)
+    // pcm_sample_bit_depth_chroma_minus1  u(4)
+    // log2_min_pcm_luma_coding_block_size_minus3  ue(v)
+    // log2_diff_max_min_pcm_luma_coding_block_size  ue(v)
+    // pcm_loop_filter_disabled_flag  u(1)
+    if (!WriteBits(bit_buffer, sps.pcm_sample_bit_depth_luma_minus1, 4) ||
+        !WriteBits(bit_buffer, sps.pcm_sample_bit_depth_chroma_minus1, 4) ||
+        !bit_buffer->WriteExponentialGolomb(
+            sps.log2_min_pcm_luma_coding_block_size_minus3) ||
+        !bit_buffer->WriteExponentialGolomb(
+            sps.log2_diff_max_min_pcm_luma_coding_block_size) ||
+        !WriteBits(bit_buffer, sps.pcm_loop_filter_disabled_flag, 1)) {
+      return false;
+    }
+  }
+  // num_short_term_ref_pic_sets  ue(v)
+  if (!bit_buffer->WriteExponentialGolomb(sps.num_short_term_ref_pic_sets)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < sps.num_short_term_ref_pic_sets; i++) {
+    // st_ref_pic_set(i)
+    if (!WriteStRefPicSet(bit_buffer, sps.st_ref_pic_set, i,
+                          sps.num_short_term_ref_pic_sets)) {
+      return false;
+    }
+  }
+  // long_term_ref_pics_present_flag  u(1)
+  if (!WriteBits(bit_buffer, sps.long_term_ref_pics_present_flag, 1)) {
+    return false;
+  }
+  if (sps.long_term_ref_pics_present_flag) {
+    // num_long_term_ref_pics_sps  ue(v)
+    uint32_t num_long_term_ref_pics_sps = sps.num_long_term_ref_pics_sps;
+    if (!bit_buffer->WriteExponentialGolomb(num_long_term_ref_pics_sps) ||
+        sps.lt_ref_pic_poc_lsb_sps.size() < num_long_term_ref_pics_sps ||
+        sps.used_by_curr_pic_lt_sps_flag.size() < num_long_term_ref_pics_sps) {
+      return false;
+    }
+    uint64_t poc_lsb_bits =
+        static_cast<uint64_t>(sps.log2_max_pic_order_cnt_lsb_minus4) + 4;
+    if (poc_lsb_bits > 32) {
+      return false;
+    }
+    for (uint32_t i = 0; i < num_long_term_ref_pics_sps; i++) {
+      // lt_ref_pic_poc_lsb_sps[i]  u(v)
+      // used_by_curr_pic_lt_sps_flag[i]  u(1)
+      if (!WriteBits(bit_buffer, sps.lt_ref_pic_poc_lsb_sps[i],
+                     static_cast<size_t>(poc_lsb_bits)) ||
+          !WriteBits(bit_buffer, sps.used_by_curr_pic_lt_sps_flag[i], 1)) {
+        return false;
+      }
+    }
+  }
+  // sps_temporal_mvp_enabled_flag  u(1)
+  // strong_intra_smoothing_enabled_flag  u(1)
+  // vui_parameters_present_flag  u(1)
+  if (!WriteFlags(bit_buffer, {sps.sps_temporal_mvp_enabled_flag,
+                               sps.strong_intra_smoothing_enabled_flag,
+                               sps.vui_parameters_present_flag})) {
+    return false;
+  }
+  if (sps.vui_parameters_present_flag) {
+    // vui_parameters()
+    if (!WriteVuiParameters(bit_buffer, sps.vui_parameters.get(),
+                            sps.sps_max_sub_layers_minus1)) {
+      return false;
+    }
+  }
+  // sps_extension_present_flag  u(1)
+  if (!WriteBits(bit_buffer, sps.sps_extension_present_flag, 1)) {
+    return false;
+  }
+  if (sps.sps_extension_present_flag) {
+    // sps_range_extension_flag  u(1)
+    // sps_multilayer_extension_flag  u(1)
+    // sps_3d_extension_flag  u(1)
+    // sps_scc_extension_flag  u(1)
+    // sps_extension_4bits  u(4)
+    if (!WriteFlags(bit_buffer, {sps.sps_range_extension_flag,
+                                 sps.sps_multilayer_extension_flag,
+                                 sps.sps_3d_extension_flag,
+                                 sps.sps_scc_extension_flag}) ||
+        !WriteBits(bit_buffer, sps.sps_extension_4bits, 4)) {
+      return false;
+    }
+  } else if (sps.sps_range_extension_flag ||
+             sps.sps_multilayer_extension_flag || sps.sps_3d_extension_flag ||
+             sps.sps_scc_extension_flag) {
+    return false;
+  }
+  if (sps.sps_range_extension_flag) {
+    // sps_range_extension()
+    if (!WriteSpsRangeExtension(bit_buffer, sps.sps_range_extension.get())) {
+      return false;
+    }
+  }
+  if (sps.sps_multilayer_extension_flag) {
+    // sps_multilayer_extension()
+    // inter_view_mv_vert_constraint_flag  u(1)
+    if (sps.sps_multilayer_extension == nullptr ||
+        !WriteBits(
+            bit_buffer,
+            sps.sps_multilayer_extension->inter_view_mv_vert_constraint_flag,
+            1)) {
+      return false;
+    }
+  }
+  if (sps.sps_3d_extension_flag) {
+    // sps_3d_extension()
+    if (!WriteSps3dExtension(bit_buffer, sps.sps_3d_extension.get())) {
+      return false;
+    }
+  }
+  if (sps.sps_scc_extension_flag) {
+    // sps_scc_extension()
+    if (!WriteSpsSccExtension(bit_buffer, sps.sps_scc_extension.get(),
+                              sps.chroma_format_idc, sps.bit_depth_luma_minus8,
+                              sps.bit_depth_chroma_minus8)) {
+      return false;
+    }
+  }
+  return WriteRbspTrailingBits(bit_buffer);
+}
+
+// pic_parameter_set_rbsp() (Section 7.3.2.3)
+bool WritePpsRbsp(BitBufferWriter* bit_buffer,
+                  const h265nal::H265PpsParser::PpsState& pps) {
+  // the parser keeps neither the PPS range and 3D extensions nor the PPS
+  // extension data
+  if (pps.pps_range_extension_flag || pps.pps_3d_extension_flag ||
+      pps.pps_extension_4bits) {
+    return false;
+  }
+  // pps_pic_parameter_set_id  ue(v)
+  // pps_seq_parameter_set_id  ue(v)
+  // dependent_slice_segments_enabled_flag  u(1)
+  // output_flag_present_flag  u(1)
+  // num_extra_slice_header_bits  u(3)
+  // sign_data_hiding_enabled_flag  u(1)
+  // cabac_init_present_flag  u(1)
+  // num_ref_idx_l0_default_active_minus1  ue(v)
+  // num_ref_idx_l1_default_active_minus1  ue(v)
+  // init_qp_minus26  se(v)
+  // constrained_intra_pred_flag  u(1)
+  // transform_skip_enabled_flag  u(1)
+  // cu_qp_delta_enabled_flag  u(1)
+  if (!bit_buffer->WriteExponentialGolomb(pps.pps_pic_parameter_set_id) ||
+      !bit_buffer->WriteExponentialGolomb(pps.pps_seq_parameter_set_id) ||
+      !WriteFlags(bit_buffer, {pps.dependent_slice_segments_enabled_flag,
+                               pps.output_flag_present_flag}) ||
+      !WriteBits(bit_buffer, pps.num_extra_slice_header_bits, 3) ||
+      !WriteFlags(bit_buffer, {pps.sign_data_hiding_enabled_flag,
+                               pps.cabac_init_present_flag}) ||
+      !bit_buffer->WriteExponentialGolomb(
+          pps.num_ref_idx_l0_default_active_minus1) ||
+      !bit_buffer->WriteExponentialGolomb(
+          pps.num_ref_idx_l1_default_active_minus1) ||
+      !bit_buffer->WriteSignedExponentialGolomb(pps.init_qp_minus26) ||
+      !WriteFlags(bit_buffer, {pps.constrained_intra_pred_flag,
+                               pps.transform_skip_enabled_flag,
+                               pps.cu_qp_delta_enabled_flag})) {
+    return false;
+  }
+  if (pps.cu_qp_delta_enabled_flag) {
+    // diff_cu_qp_delta_depth  ue(v)
+    if (!bit_buffer->WriteExponentialGolomb(pps.diff_cu_qp_delta_depth)) {
+      return false;
+    }
+  }
+  // pps_cb_qp_offset  se(v)
+  // pps_cr_qp_offset  se(v)
+  // pps_slice_chroma_qp_offsets_present_flag  u(1)
+  // weighted_pred_flag  u(1)
+  // weighted_bipred_flag  u(1)
+  // transquant_bypass_enabled_flag  u(1)
+  // tiles_enabled_flag  u(1)
+  // entropy_coding_sync_enabled_flag  u(1)
+  if (!bit_buffer->WriteSignedExponentialGolomb(pps.pps_cb_qp_offset) ||
+      !bit_buffer->WriteSignedExponentialGolomb(pps.pps_cr_qp_offset) ||
+      !WriteFlags(bit_buffer, {pps.pps_slice_chroma_qp_offsets_present_flag,
+                               pps.weighted_pred_flag,
+                               pps.weighted_bipred_flag,
+                               pps.transquant_bypass_enabled_flag,
+                               pps.tiles_enabled_flag,
+                               pps.entropy_coding_sync_enabled_flag})) {
+    return false;
+  }
+  if (pps.tiles_enabled_flag) {
+    // num_tile_columns_minus1  ue(v)
+    // num_tile_rows_minus1  ue(v)
+    // uniform_spacing_flag  u(1)
+    if (!bit_buffer->WriteExponentialGolomb(pps.num_tile_columns_minus1) ||
+        !bit_buffer->WriteExponentialGolomb(pps.num_tile_rows_minus1) ||
+        !WriteBits(bit_buffer, pps.uniform_spacing_flag, 1)) {
+      return false;
+    }
+    if (!pps.uniform_spacing_flag) {
+      if (pps.column_width_minus1.size() < pps.num_tile_columns_minus1 ||
+          pps.row_height_minus1.size() < pps.num_tile_rows_minus1) {
+        return false;
+      }
+      for (uint32_t i = 0; i < pps.num_tile_columns_minus1; i++) {
+        // column_width_minus1[i]  ue(v)
+        if (!bit_buffer->WriteExponentialGolomb(pps.column_width_minus1[i])) {
+          return false;
+        }
+      }
+      for (uint32_t i = 0; i < pps.num_tile_rows_minus1; i++) {
+        // row_height_minus1[i]  ue(v)
+        if (!bit_buffer->WriteExponentialGolomb(pps.row_height_minus1[i])) {
+          return false;
+        }
+      }
+    }
+    // loop_filter_across_tiles_enabled_flag  u(1)
+    if (!WriteBits(bit_buffer, pps.loop_filter_across_tiles_enabled_flag, 1)) {
+      return false;
+    }
+  }
+  // pps_loop_filter_across_slices_enabled_flag  u(1)
+  // deblocking_filter_control_present_flag  u(1)
+  if (!WriteFlags(bit_buffer, {pps.pps_loop_filter_across_slices_enabled_flag,
+                               pps.deblocking_filter_control_present_flag})) {
+    return false;
+  }
+  if (pps.deblocking_filter_control_present_flag) {
+    // deblocking_filter_override_enabled_flag  u(1)
+    // pps_deblocking_filter_disabled_flag  u(1)
+    if (!WriteFlags(bit_buffer, {pps.deblocking_filter_override_enabled_flag,
+                                 pps.pps_deblocking_filter_disabled_flag})) {
+      return false;
+    }
+    if (!pps.pps_deblocking_filter_disabled_flag) {
+      // pps_beta_offset_div2  se(v)
+      // pps_tc_offset_div2  se(v)
+      if (!bit_buffer->WriteSignedExponentialGolomb(pps.pps_beta_offset_div2) ||
+          !bit_buffer->WriteSignedExponentialGolomb(pps.pps_tc_offset_div2)) {
+        return false;
+      }
+    }
+  }
+  // pps_scaling_list_data_present_flag  u(1)
+  if (!WriteBits(bit_buffer, pps.pps_scaling_list_data_present_flag, 1)) {
+    return false;
+  }
+  if (pps.pps_scaling_list_data_present_flag) {
+    // scaling_list_data()
+    if (!WriteScalingListData(bit_buffer, pps.scaling_list_data.get())) {
+      return false;
+    }
+  }
+  // lists_modification_present_flag  u(1)
+  // log2_parallel_merge_level_minus2  ue(v)
+  // slice_segment_header_extension_present_flag  u(1)
+  // pps_extension_present_flag  u(1)
+  if (!WriteBits(bit_buffer, pps.lists_modification_present_flag, 1) ||
+      !bit_buffer->WriteExponentialGolomb(
+          pps.log2_parallel_merge_level_minus2) ||
+      !WriteFlags(bit_buffer, {pps.slice_segment_header_extension_present_flag,
+                               pps.pps_extension_present_flag})) {
+    return false;
+  }
+  if (pps.pps_extension_present_flag) {
+    // pps_range_extension_flag  u(1)
+    // pps_multilayer_extension_flag  u(1)
+    // pps_3d_extension_flag  u(1)
+    // pps_scc_extension_flag  u(1)
+    // pps_extension_4bits  u(4)
+    if (!WriteFlags(bit_buffer, {pps.pps_range_extension_flag,
+                                 pps.pps_multilayer_extension_flag,
+                                 pps.pps_3d_extension_flag,
+                                 pps.pps_scc_extension_flag}) ||
+        !WriteBits(bit_buffer, pps.pps_extension_4bits, 4)) {
+      return false;
+    }
+  } else if (pps.pps_multilayer_extension_flag || pps.pps_scc_extension_flag) {
+    return false;
+  }
+  if (pps.pps_multilayer_extension_flag) {
+    // pps_multilayer_extension()
+    if (!WritePpsMultilayerExtension(bit_buffer,
+                                     pps.pps_multilayer_extension.get())) {
+      return false;
+    }
+  }
+  if (pps.pps_scc_extension_flag) {
+    // pps_scc_extension()
+    if (!WritePpsSccExtension(bit_buffer, pps.pps_scc_extension.get())) {
+      return false;
+    }
+  }
+  return WriteRbspTrailingBits(bit_buffer);
+}
+
+// Write the NAL unit header, and the RBSP written by `write_rbsp` (escaped).
+template <typename State>
+bool WriteNalUnit(uint32_t nal_unit_type, const State& state,
+                  bool (*write_rbsp)(BitBufferWriter*, const State&),
+                  const h265nal::H265ParameterSetWriter::Options& options,
+                  std::vector<uint8_t>* buffer) {
+  if (buffer == nullptr || options.nuh_layer_id > 63 ||
+      options.nuh_temporal_id_plus1 == 0 ||
+      options.nuh_temporal_id_plus1 > 7) {
+    return false;
+  }
+  std::vector<uint8_t> rbsp;
+  size_t rbsp_size = 0;
+  for (size_t size = kInitialRbspSize; rbsp_size == 0; size *= 2) {
+    if (size > kMaxRbspSize) {
+      return false;
+    }
+    rbsp.assign(size, 0);
+    BitBufferWriter bit_buffer(rbsp.data(), rbsp.size());
+    bool written = write_rbsp(&bit_buffer, state);
+    size_t byte_offset, bit_offset;
+    bit_buffer.GetCurrentOffset(&byte_offset, &bit_offset);
+    if (written) {
+      rbsp_size = byte_offset;
+    } else if (byte_offset + kMaxSyntaxElementSize < size) {
+      // the state cannot be written
+      return false;
+    }
+  }
+  // nal_unit_header() (Section 7.3.1.2)
+  buffer->clear();
+  buffer->push_back(static_cast<uint8_t>((nal_unit_type << 1) |
+                                         (options.nuh_layer_id >> 5)));
+  buffer->push_back(static_cast<uint8_t>(((options.nuh_layer_id & 0x1f) << 3) |
+                                         options.nuh_temporal_id_plus1));
+  h265nal::EscapeRbsp(rbsp.data(), rbsp_size, buffer);
+  return true;
+}
+}  // namespace
+
+namespace h265nal {
+
+bool H265ParameterSetWriter::WriteVps(const H265VpsParser::VpsState& vps,
+                                      const Options& options,
+                                      std::vector<uint8_t>* buffer) noexcept {
+  return WriteNalUnit(NalUnitType::VPS_NUT, vps, WriteVpsRbsp, options,
+                      buffer);
+}
+
+bool H265ParameterSetWriter::WriteSps(const H265SpsParser::SpsState& sps,
+                                      const Options& options,
+                                      std::vector<uint8_t>* buffer) noexcept {
+  return WriteNalUnit(NalUnitType::SPS_NUT, sps, WriteSpsRbsp, options,
+                      buffer);
+}
+
+bool H265ParameterSetWriter::WritePps(const H265PpsParser::PpsState& pps,
+                                      const Options& options,
+                                      std::vector<uint8_t>* buffer) noexcept {
+  return WriteNalUnit(NalUnitType::PPS_NUT, pps, WritePpsRbsp, options,
+                      buffer);
+}
+
+}  // namespace h265nal
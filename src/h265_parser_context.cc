@@ -0,0 +1,124 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_parser_context.h"
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace {
+thread_local h265nal::H265ParserContext* current_context = nullptr;
+}  // namespace
+
+namespace h265nal {
+
+H265ParserContext::Scope::Scope(H265ParserContext* context) noexcept
+    : previous(current_context) {
+  if (context != nullptr) {
+    current_context = context;
+  }
+}
+
+H265ParserContext::Scope::~Scope() noexcept { current_context = previous; }
+
+H265ParserContext* H265ParserContext::GetCurrent() noexcept {
+  return current_context;
+}
+
+std::shared_ptr<NaluChecksum> H265ParserContext::MakeChecksum() {
+  H265ParserContext* context = GetCurrent();
+  if (context == nullptr || context->checksums.empty()) {
+    return std::make_shared<NaluChecksum>();
+  }
+  std::shared_ptr<NaluChecksum> checksum = std::move(context->checksums.back());
+  context->checksums.pop_back();
+  return checksum;
+}
+
+std::vector<int32_t> H265ParserContext::MakeInt32Vector() {
+  H265ParserContext* context = GetCurrent();
+  if (context == nullptr || context->int32_vectors.empty()) {
+    return std::vector<int32_t>();
+  }
+  std::vector<int32_t> vector = std::move(context->int32_vectors.back());
+  context->int32_vectors.pop_back();
+  return vector;
+}
+
+void H265ParserContext::Recycle(
+    std::unique_ptr<H265NalUnitParser::NalUnitState> nal_unit) {
+  if (nal_unit == nullptr) {
+    return;
+  }
+  // checksums can be shared with the caller: only keep the unique ones
+  if (nal_unit->checksum != nullptr && nal_unit->checksum.use_count() == 1) {
+    checksums.push_back(std::move(nal_unit->checksum));
+  }
+  nal_unit_headers.Put(std::move(nal_unit->nal_unit_header));
+  auto& nal_unit_payload = nal_unit->nal_unit_payload;
+  if (nal_unit_payload != nullptr &&
+      nal_unit_payload->slice_segment_layer != nullptr) {
+    auto& slice_segment_layer = nal_unit_payload->slice_segment_layer;
+    auto& slice_segment_header = slice_segment_layer->slice_segment_header;
+    if (slice_segment_header != nullptr) {
+      using StRefPicSetState = H265StRefPicSetParser::StRefPicSetState;
+      st_ref_pic_sets.Put(std::move(slice_segment_header->st_ref_pic_set),
+                          &StRefPicSetState::used_by_curr_pic_flag,
+                          &StRefPicSetState::use_delta_flag,
+                          &StRefPicSetState::delta_poc_s0_minus1,
+                          &StRefPicSetState::used_by_curr_pic_s0_flag,
+                          &StRefPicSetState::delta_poc_s1_minus1,
+                          &StRefPicSetState::used_by_curr_pic_s1_flag);
+      auto& pred_weight_table = slice_segment_header->pred_weight_table;
+      if (pred_weight_table != nullptr) {
+        // the per-reference chroma vectors go back to their own pool
+        for (auto* chroma : {&pred_weight_table->delta_chroma_weight_l0,
+                             &pred_weight_table->delta_chroma_offset_l0,
+                             &pred_weight_table->delta_chroma_weight_l1,
+                             &pred_weight_table->delta_chroma_offset_l1}) {
+          for (auto& vector : *chroma) {
+            vector.clear();
+            int32_vectors.push_back(std::move(vector));
+          }
+        }
+      }
+      using PredWeightTableState =
+          H265PredWeightTableParser::PredWeightTableState;
+      pred_weight_tables.Put(std::move(pred_weight_table),
+                             &PredWeightTableState::luma_weight_l0_flag,
+                             &PredWeightTableState::chroma_weight_l0_flag,
+                             &PredWeightTableState::delta_luma_weight_l0,
+                             &PredWeightTableState::luma_offset_l0,
+                             &PredWeightTableState::delta_chroma_weight_l0,
+                             &PredWeightTableState::delta_chroma_offset_l0,
+                             &PredWeightTableState::luma_weight_l1_flag,
+                             &PredWeightTableState::chroma_weight_l1_flag,
+                             &PredWeightTableState::delta_luma_weight_l1,
+                             &PredWeightTableState::luma_offset_l1,
+                             &PredWeightTableState::delta_chroma_weight_l1,
+                             &PredWeightTableState::delta_chroma_offset_l1);
+      using SliceSegmentHeaderState =
+          H265SliceSegmentHeaderParser::SliceSegmentHeaderState;
+      slice_segment_headers.Put(
+          std::move(slice_segment_header),
+          &SliceSegmentHeaderState::slice_reserved_flag,
+          &SliceSegmentHeaderState::lt_idx_sps,
+          &SliceSegmentHeaderState::poc_lsb_lt,
+          &SliceSegmentHeaderState::used_by_curr_pic_lt_flag,
+          &SliceSegmentHeaderState::delta_poc_msb_present_flag,
+          &SliceSegmentHeaderState::delta_poc_msb_cycle_lt,
+          &SliceSegmentHeaderState::entry_point_offset_minus1,
+          &SliceSegmentHeaderState::slice_segment_header_extension_data_byte);
+    }
+    slice_segment_layers.Put(std::move(slice_segment_layer));
+  }
+  nal_unit_payloads.Put(std::move(nal_unit_payload));
+  nal_units.Put(std::move(nal_unit));
+}
+
+}  // namespace h265nal
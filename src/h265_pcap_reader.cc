@@ -0,0 +1,443 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_pcap_reader.h"
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_rtp_header.h"
+#include "h265_utils.h"
+
+namespace {
+// pcap (https://www.ietf.org/archive/id/draft-ietf-opsawg-pcap-03.html)
+constexpr uint32_t kPcapMagicMicroseconds = 0xa1b2c3d4;
+constexpr uint32_t kPcapMagicNanoseconds = 0xa1b23c4d;
+constexpr size_t kPcapHeaderSize = 24;
+constexpr size_t kPcapRecordHeaderSize = 16;
+
+// pcapng (https://www.ietf.org/archive/id/draft-ietf-opsawg-pcapng-01.html)
+constexpr uint32_t kPcapngSectionHeaderBlock = 0x0a0d0d0a;
+constexpr uint32_t kPcapngByteOrderMagic = 0x1a2b3c4d;
+constexpr uint32_t kPcapngInterfaceDescriptionBlock = 1;
+constexpr uint32_t kPcapngPacketBlock = 2;
+constexpr uint32_t kPcapngSimplePacketBlock = 3;
+constexpr uint32_t kPcapngEnhancedPacketBlock = 6;
+constexpr uint16_t kPcapngOptionEnd = 0;
+constexpr uint16_t kPcapngOptionIfTsresol = 9;
+
+// link types (https://www.tcpdump.org/linktypes.html)
+constexpr uint32_t kLinkTypeNull = 0;
+constexpr uint32_t kLinkTypeEthernet = 1;
+constexpr uint32_t kLinkTypeRaw = 101;
+constexpr uint32_t kLinkTypeLoop = 108;
+constexpr uint32_t kLinkTypeLinuxSll = 113;
+constexpr uint32_t kLinkTypeIpv4 = 228;
+constexpr uint32_t kLinkTypeIpv6 = 229;
+constexpr uint32_t kLinkTypeLinuxSll2 = 276;
+
+constexpr uint16_t kEtherTypeIpv4 = 0x0800;
+constexpr uint16_t kEtherTypeIpv6 = 0x86dd;
+constexpr uint16_t kEtherTypeVlan = 0x8100;
+constexpr uint16_t kEtherTypeQinQ = 0x88a8;
+constexpr uint8_t kIpProtocolUdp = 17;
+
+uint16_t ReadU16(const uint8_t* p, bool big_endian) {
+  return big_endian ? static_cast<uint16_t>((p[0] << 8) | p[1])
+                    : static_cast<uint16_t>((p[1] << 8) | p[0]);
+}
+
+uint32_t ReadU32(const uint8_t* p, bool big_endian) {
+  if (big_endian) {
+    return (static_cast<uint32_t>(p[0]) << 24) |
+           (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+  }
+  return (static_cast<uint32_t>(p[3]) << 24) |
+         (static_cast<uint32_t>(p[2]) << 16) |
+         (static_cast<uint32_t>(p[1]) << 8) | static_cast<uint32_t>(p[0]);
+}
+
+// Get the UDP payload of an IP packet.
+bool GetUdpPayloadFromIp(const uint8_t* data, size_t length,
+                         uint16_t* src_port, uint16_t* dst_port,
+                         const uint8_t** payload, size_t* payload_length) {
+  if (length < 1) {
+    return false;
+  }
+  const uint8_t* udp = nullptr;
+  size_t udp_length = 0;
+  uint32_t version = data[0] >> 4;
+  if (version == 4) {
+    // IPv4 (rfc791)
+    if (length < 20) {
+      return false;
+    }
+    size_t header_length = static_cast<size_t>(data[0] & 0x0f) * 4;
+    size_t total_length = ReadU16(data + 2, true);
+    uint16_t fragment = ReadU16(data + 6, true);
+    // more fragments, or a fragment offset
+    if ((fragment & 0x3fff) != 0 || data[9] != kIpProtocolUdp ||
+        header_length < 20 || total_length < header_length ||
+        total_length > length) {
+      return false;
+    }
+    udp = data + header_length;
+    udp_length = total_length - header_length;
+  } else if (version == 6) {
+    // IPv6 (rfc8200)
+    if (length < 40) {
+      return false;
+    }
+    size_t total_length = 40 + static_cast<size_t>(ReadU16(data + 4, true));
+    if (total_length > length) {
+      return false;
+    }
+    uint8_t next_header = data[6];
+    size_t offset = 40;
+    // skip the hop-by-hop, routing, and destination options headers
+    while (next_header == 0 || next_header == 43 || next_header == 60) {
+      if (offset + 8 > total_length) {
+        return false;
+      }
+      next_header = data[offset];
+      offset += (static_cast<size_t>(data[offset + 1]) + 1) * 8;
+    }
+    if (next_header != kIpProtocolUdp || offset > total_length) {
+      return false;
+    }
+    udp = data + offset;
+    udp_length = total_length - offset;
+  } else {
+    return false;
+  }
+
+  // UDP (rfc768)
+  if (udp_length < 8) {
+    return false;
+  }
+  size_t datagram_length = ReadU16(udp + 4, true);
+  if (datagram_length < 8 || datagram_length > udp_length) {
+    return false;
+  }
+  *src_port = ReadU16(udp, true);
+  *dst_port = ReadU16(udp + 2, true);
+  *payload = udp + 8;
+  *payload_length = datagram_length - 8;
+  return true;
+}
+
+// Convert a pcapng timestamp to nanoseconds. `tsresol` is the
+// if_tsresol option value.
+int64_t PcapngTimestampToNs(uint64_t timestamp, uint8_t tsresol) {
+  uint32_t exponent = tsresol & 0x7f;
+  if (tsresol & 0x80) {
+    // 2^-exponent seconds
+    if (exponent >= 64) {
+      return 0;
+    }
+    uint64_t seconds = timestamp >> exponent;
+    uint64_t fraction = timestamp & ((uint64_t(1) << exponent) - 1);
+    // keep the fraction product in range
+    uint32_t shift = (exponent > 32) ? exponent - 32 : 0;
+    fraction >>= shift;
+    fraction = (fraction * 1000000000) >> (exponent - shift);
+    return static_cast<int64_t>(seconds * 1000000000 + fraction);
+  }
+  // 10^-exponent seconds
+  if (exponent <= 9) {
+    uint64_t multiplier = 1;
+    for (uint32_t i = exponent; i < 9; i++) {
+      multiplier *= 10;
+    }
+    return static_cast<int64_t>(timestamp * multiplier);
+  }
+  uint64_t divisor = 1;
+  for (uint32_t i = 9; i < exponent && i < 28; i++) {
+    divisor *= 10;
+  }
+  return static_cast<int64_t>(timestamp / divisor);
+}
+}  // namespace
+
+namespace h265nal {
+
+H265PcapReader::H265PcapReader(const Options& options_in)
+    : options(options_in) {}
+
+H265PcapReader::~H265PcapReader() { Close(); }
+
+bool H265PcapReader::Open(const char* filename) noexcept {
+  Close();
+  if (!file.Open(filename)) {
+    return false;
+  }
+  return OpenBuffer(file.GetData(), file.GetLength());
+}
+
+bool H265PcapReader::OpenBuffer(const uint8_t* data_in,
+                                size_t length_in) noexcept {
+  if (data_in == nullptr || length_in < 4) {
+    return false;
+  }
+  data = data_in;
+  length = length_in;
+  return true;
+}
+
+void H265PcapReader::Close() noexcept {
+  file.Close();
+  data = nullptr;
+  length = 0;
+}
+
+bool H265PcapReader::ReadPackets(Callback callback, void* opaque) noexcept {
+  if (data == nullptr || length < 4) {
+    return false;
+  }
+  uint32_t magic = ReadU32(data, true);
+  if (magic == kPcapngSectionHeaderBlock) {
+    return ReadPcapng(callback, opaque);
+  }
+  return ReadPcap(callback, opaque);
+}
+
+bool H265PcapReader::ReadPcap(Callback callback, void* opaque) noexcept {
+  if (length < kPcapHeaderSize) {
+    return false;
+  }
+  bool big_endian;
+  bool nanoseconds;
+  uint32_t magic = ReadU32(data, true);
+  if (magic == kPcapMagicMicroseconds || magic == kPcapMagicNanoseconds) {
+    big_endian = true;
+    nanoseconds = (magic == kPcapMagicNanoseconds);
+  } else {
+    magic = ReadU32(data, false);
+    if (magic != kPcapMagicMicroseconds && magic != kPcapMagicNanoseconds) {
+      return false;
+    }
+    big_endian = false;
+    nanoseconds = (magic == kPcapMagicNanoseconds);
+  }
+  // the link type is in the lower 16 bits (the upper ones are FCS info)
+  uint32_t link_type = ReadU32(data + 20, big_endian) & 0xffff;
+
+  size_t offset = kPcapHeaderSize;
+  while (offset + kPcapRecordHeaderSize <= length) {
+    const uint8_t* record = data + offset;
+    uint32_t ts_sec = ReadU32(record, big_endian);
+    uint32_t ts_frac = ReadU32(record + 4, big_endian);
+    size_t incl_len = ReadU32(record + 8, big_endian);
+    offset += kPcapRecordHeaderSize;
+    if (incl_len > length - offset) {
+      // truncated capture
+      break;
+    }
+    int64_t timestamp_ns = static_cast<int64_t>(ts_sec) * 1000000000 +
+                           static_cast<int64_t>(ts_frac) *
+                               (nanoseconds ? 1 : 1000);
+    ProcessFrame(link_type, timestamp_ns, data + offset, incl_len, callback,
+                 opaque);
+    offset += incl_len;
+  }
+  return true;
+}
+
+bool H265PcapReader::ReadPcapng(Callback callback, void* opaque) noexcept {
+  struct Interface {
+    uint32_t link_type;
+    uint8_t tsresol;
+  };
+  // interfaces of the current section
+  std::vector<Interface> interfaces;
+  bool big_endian = false;
+
+  size_t offset = 0;
+  while (offset + 12 <= length) {
+    const uint8_t* block = data + offset;
+    uint32_t block_type = ReadU32(block, big_endian);
+    if (ReadU32(block, true) == kPcapngSectionHeaderBlock) {
+      // a new section: get its byte order
+      uint32_t byte_order_magic = ReadU32(block + 8, true);
+      if (byte_order_magic == kPcapngByteOrderMagic) {
+        big_endian = true;
+      } else if (ReadU32(block + 8, false) == kPcapngByteOrderMagic) {
+        big_endian = false;
+      } else {
+        return false;
+      }
+      block_type = kPcapngSectionHeaderBlock;
+      interfaces.clear();
+    }
+    size_t block_length = ReadU32(block + 4, big_endian);
+    if (block_length < 12 || (block_length % 4) != 0) {
+      return false;
+    }
+    if (block_length > length - offset) {
+      // truncated capture
+      break;
+    }
+    const uint8_t* body = block + 8;
+    size_t body_length = block_length - 12;
+
+    if (block_type == kPcapngInterfaceDescriptionBlock && body_length >= 8) {
+      Interface interface_info = {ReadU16(body, big_endian), 6};
+      // options
+      size_t option_offset = 8;
+      while (option_offset + 4 <= body_length) {
+        uint16_t code = ReadU16(body + option_offset, big_endian);
+        size_t option_length = ReadU16(body + option_offset + 2, big_endian);
+        if (code == kPcapngOptionEnd) {
+          break;
+        }
+        if (code == kPcapngOptionIfTsresol && option_length >= 1 &&
+            option_offset + 4 < body_length) {
+          interface_info.tsresol = body[option_offset + 4];
+        }
+        option_offset += 4 + ((option_length + 3) & ~static_cast<size_t>(3));
+      }
+      interfaces.push_back(interface_info);
+
+    } else if ((block_type == kPcapngEnhancedPacketBlock ||
+                block_type == kPcapngPacketBlock) &&
+               body_length >= 20) {
+      uint32_t interface_id = (block_type == kPcapngEnhancedPacketBlock)
+                                  ? ReadU32(body, big_endian)
+                                  : ReadU16(body, big_endian);
+      uint64_t timestamp =
+          (static_cast<uint64_t>(ReadU32(body + 4, big_endian)) << 32) |
+          ReadU32(body + 8, big_endian);
+      size_t captured_length = ReadU32(body + 12, big_endian);
+      if (interface_id < interfaces.size() &&
+          captured_length <= body_length - 20) {
+        const Interface& interface_info = interfaces[interface_id];
+        ProcessFrame(interface_info.link_type,
+                     PcapngTimestampToNs(timestamp, interface_info.tsresol),
+                     body + 20, captured_length, callback, opaque);
+      } else {
+        stats.records++;
+        stats.records_skipped++;
+      }
+
+    } else if (block_type == kPcapngSimplePacketBlock && body_length >= 4) {
+      // no timestamp, interface 0
+      size_t original_length = ReadU32(body, big_endian);
+      size_t captured_length =
+          (original_length < body_length - 4) ? original_length
+                                              : body_length - 4;
+      if (!interfaces.empty()) {
+        ProcessFrame(interfaces[0].link_type, 0, body + 4, captured_length,
+                     callback, opaque);
+      } else {
+        stats.records++;
+        stats.records_skipped++;
+      }
+    }
+    offset += block_length;
+  }
+  return true;
+}
+
+void H265PcapReader::ProcessFrame(uint32_t link_type, int64_t timestamp_ns,
+                                  const uint8_t* frame, size_t frame_length,
+                                  Callback callback, void* opaque) noexcept {
+  stats.records++;
+  Packet packet;
+  packet.timestamp_ns = timestamp_ns;
+  if (!GetUdpPayload(link_type, frame, frame_length, &packet.src_port,
+                     &packet.dst_port, &packet.data, &packet.length)) {
+    stats.records_skipped++;
+    return;
+  }
+  if (options.port != 0 && packet.src_port != options.port &&
+      packet.dst_port != options.port) {
+    stats.rtp_filtered++;
+    return;
+  }
+  // RTCP packet types (SR, RR, SDES, BYE, APP, RTPFB, PSFB, XR) are
+  // 200-207 (rfc5761 Section 4)
+  if (packet.length >= 2 && packet.data[1] >= 200 && packet.data[1] <= 207) {
+    stats.udp_not_rtp++;
+    return;
+  }
+  if (!RtpHeader::Parse(packet.data, packet.length, &packet.rtp_header)) {
+    stats.udp_not_rtp++;
+    return;
+  }
+  if ((options.filter_ssrc && packet.rtp_header.ssrc != options.ssrc) ||
+      (options.filter_payload_type &&
+       packet.rtp_header.payload_type != options.payload_type)) {
+    stats.rtp_filtered++;
+    return;
+  }
+  packet.payload = packet.data + packet.rtp_header.payload_offset;
+  packet.payload_length = packet.rtp_header.payload_length;
+  stats.rtp_packets++;
+  if (callback != nullptr) {
+    callback(packet, opaque);
+  }
+}
+
+bool H265PcapReader::GetUdpPayload(uint32_t link_type, const uint8_t* frame,
+                                   size_t frame_length, uint16_t* src_port,
+                                   uint16_t* dst_port, const uint8_t** payload,
+                                   size_t* payload_length) noexcept {
+  if (frame == nullptr) {
+    return false;
+  }
+  size_t offset = 0;
+  uint16_t ether_type = 0;
+  switch (link_type) {
+    case kLinkTypeEthernet:
+      if (frame_length < 14) {
+        return false;
+      }
+      ether_type = ReadU16(frame + 12, true);
+      offset = 14;
+      // VLAN tags
+      while ((ether_type == kEtherTypeVlan || ether_type == kEtherTypeQinQ) &&
+             offset + 4 <= frame_length) {
+        ether_type = ReadU16(frame + offset + 2, true);
+        offset += 4;
+      }
+      if (ether_type != kEtherTypeIpv4 && ether_type != kEtherTypeIpv6) {
+        return false;
+      }
+      break;
+    case kLinkTypeLinuxSll:
+      if (frame_length < 16) {
+        return false;
+      }
+      offset = 16;
+      break;
+    case kLinkTypeLinuxSll2:
+      if (frame_length < 20) {
+        return false;
+      }
+      offset = 20;
+      break;
+    case kLinkTypeNull:
+    case kLinkTypeLoop:
+      // 4-byte address family (host byte order)
+      offset = 4;
+      break;
+    case kLinkTypeRaw:
+    case kLinkTypeIpv4:
+    case kLinkTypeIpv6:
+      offset = 0;
+      break;
+    default:
+      return false;
+  }
+  if (offset > frame_length) {
+    return false;
+  }
+  return GetUdpPayloadFromIp(frame + offset, frame_length - offset, src_port,
+                             dst_port, payload, payload_length);
+}
+
+}  // namespace h265nal
@@ -11,7 +11,10 @@
 #include <memory>
 #include <vector>
 
+#include "h265_budget.h"
 #include "h265_common.h"
+#include "h265_error.h"
+#include "h265_trace.h"
 
 namespace h265nal {
 
@@ -46,12 +49,16 @@ H265PpsMultilayerExtensionParser::ParsePpsMultilayerExtension(
           1, pps_multilayer_extension->poc_reset_info_present_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "poc_reset_info_present_flag", 1,
+               pps_multilayer_extension->poc_reset_info_present_flag);
 
   // pps_infer_scaling_list_flag  u(1)
   if (!bit_buffer->ReadBits(
           1, pps_multilayer_extension->pps_infer_scaling_list_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "pps_infer_scaling_list_flag", 1,
+               pps_multilayer_extension->pps_infer_scaling_list_flag);
 
   if (pps_multilayer_extension->pps_infer_scaling_list_flag) {
     // pps_scaling_list_ref_layer_id  u(6)
@@ -59,6 +66,8 @@ H265PpsMultilayerExtensionParser::ParsePpsMultilayerExtension(
             6, pps_multilayer_extension->pps_scaling_list_ref_layer_id)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "pps_scaling_list_ref_layer_id", 6,
+                 pps_multilayer_extension->pps_scaling_list_ref_layer_id);
   }
 
   // num_ref_loc_offsets  ue(v)
@@ -66,18 +75,31 @@ H265PpsMultilayerExtensionParser::ParsePpsMultilayerExtension(
           pps_multilayer_extension->num_ref_loc_offsets)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "num_ref_loc_offsets",
+                pps_multilayer_extension->num_ref_loc_offsets);
+
+  if (!H265Budget::Charge(
+          "pps_multilayer_extension", "num_ref_loc_offsets", bit_buffer,
+          pps_multilayer_extension->num_ref_loc_offsets,
+          static_cast<uint64_t>(pps_multilayer_extension->num_ref_loc_offsets) *
+              16 * sizeof(uint32_t))) {
+    return nullptr;
+  }
 
   for (uint32_t i = 0; i < pps_multilayer_extension->num_ref_loc_offsets; i++) {
     // ref_loc_offset_layer_id[i]  u(6)
     if (!bit_buffer->ReadBits(6, bits_tmp)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "ref_loc_offset_layer_id", 6, bits_tmp, i);
     pps_multilayer_extension->ref_loc_offset_layer_id.push_back(bits_tmp);
 
     // scaled_ref_layer_offset_present_flag[i]  u(1)
     if (!bit_buffer->ReadBits(1, bits_tmp)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "scaled_ref_layer_offset_present_flag", 1,
+                 bits_tmp, i);
     pps_multilayer_extension->scaled_ref_layer_offset_present_flag.push_back(
         bits_tmp);
 
@@ -87,6 +109,8 @@ H265PpsMultilayerExtensionParser::ParsePpsMultilayerExtension(
       if (!bit_buffer->ReadSignedExponentialGolomb(sgolomb_tmp)) {
         return nullptr;
       }
+      H265Trace::se(bit_buffer, "scaled_ref_layer_left_offset", sgolomb_tmp,
+                    pps_multilayer_extension->ref_loc_offset_layer_id[i]);
       pps_multilayer_extension->scaled_ref_layer_left_offset.push_back(
           sgolomb_tmp);
 
@@ -94,6 +118,8 @@ H265PpsMultilayerExtensionParser::ParsePpsMultilayerExtension(
       if (!bit_buffer->ReadSignedExponentialGolomb(sgolomb_tmp)) {
         return nullptr;
       }
+      H265Trace::se(bit_buffer, "scaled_ref_layer_top_offset", sgolomb_tmp,
+                    pps_multilayer_extension->ref_loc_offset_layer_id[i]);
       pps_multilayer_extension->scaled_ref_layer_top_offset.push_back(
           sgolomb_tmp);
 
@@ -101,6 +127,8 @@ H265PpsMultilayerExtensionParser::ParsePpsMultilayerExtension(
       if (!bit_buffer->ReadSignedExponentialGolomb(sgolomb_tmp)) {
         return nullptr;
       }
+      H265Trace::se(bit_buffer, "scaled_ref_layer_right_offset", sgolomb_tmp,
+                    pps_multilayer_extension->ref_loc_offset_layer_id[i]);
       pps_multilayer_extension->scaled_ref_layer_right_offset.push_back(
           sgolomb_tmp);
 
@@ -108,6 +136,8 @@ H265PpsMultilayerExtensionParser::ParsePpsMultilayerExtension(
       if (!bit_buffer->ReadSignedExponentialGolomb(sgolomb_tmp)) {
         return nullptr;
       }
+      H265Trace::se(bit_buffer, "scaled_ref_layer_bottom_offset", sgolomb_tmp,
+                    pps_multilayer_extension->ref_loc_offset_layer_id[i]);
       pps_multilayer_extension->scaled_ref_layer_bottom_offset.push_back(
           sgolomb_tmp);
     }
@@ -116,6 +146,7 @@ H265PpsMultilayerExtensionParser::ParsePpsMultilayerExtension(
     if (!bit_buffer->ReadBits(1, bits_tmp)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "ref_region_offset_present_flag", 1, bits_tmp, i);
     pps_multilayer_extension->ref_region_offset_present_flag.push_back(
         bits_tmp);
 
@@ -124,24 +155,32 @@ H265PpsMultilayerExtensionParser::ParsePpsMultilayerExtension(
       if (!bit_buffer->ReadSignedExponentialGolomb(sgolomb_tmp)) {
         return nullptr;
       }
+      H265Trace::se(bit_buffer, "ref_region_left_offset", sgolomb_tmp,
+                    pps_multilayer_extension->ref_loc_offset_layer_id[i]);
       pps_multilayer_extension->ref_region_left_offset.push_back(sgolomb_tmp);
 
       // ref_region_top_offset[ref_loc_offset_layer_id[i]]  se(v)
       if (!bit_buffer->ReadSignedExponentialGolomb(sgolomb_tmp)) {
         return nullptr;
       }
+      H265Trace::se(bit_buffer, "ref_region_top_offset", sgolomb_tmp,
+                    pps_multilayer_extension->ref_loc_offset_layer_id[i]);
       pps_multilayer_extension->ref_region_top_offset.push_back(sgolomb_tmp);
 
       // ref_region_right_offset[ref_loc_offset_layer_id[i]]  se(v)
       if (!bit_buffer->ReadSignedExponentialGolomb(sgolomb_tmp)) {
         return nullptr;
       }
+      H265Trace::se(bit_buffer, "ref_region_right_offset", sgolomb_tmp,
+                    pps_multilayer_extension->ref_loc_offset_layer_id[i]);
       pps_multilayer_extension->ref_region_right_offset.push_back(sgolomb_tmp);
 
       // ref_region_bottom_offset[ref_loc_offset_layer_id[i]]  se(v)
       if (!bit_buffer->ReadSignedExponentialGolomb(sgolomb_tmp)) {
         return nullptr;
       }
+      H265Trace::se(bit_buffer, "ref_region_bottom_offset", sgolomb_tmp,
+                    pps_multilayer_extension->ref_loc_offset_layer_id[i]);
       pps_multilayer_extension->ref_region_bottom_offset.push_back(sgolomb_tmp);
     }
 
@@ -149,6 +188,7 @@ H265PpsMultilayerExtensionParser::ParsePpsMultilayerExtension(
     if (!bit_buffer->ReadBits(1, bits_tmp)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "resample_phase_set_present_flag", 1, bits_tmp, i);
     pps_multilayer_extension->resample_phase_set_present_flag.push_back(
         bits_tmp);
 
@@ -157,24 +197,32 @@ H265PpsMultilayerExtensionParser::ParsePpsMultilayerExtension(
       if (!bit_buffer->ReadSignedExponentialGolomb(sgolomb_tmp)) {
         return nullptr;
       }
+      H265Trace::se(bit_buffer, "phase_hor_luma", sgolomb_tmp,
+                    pps_multilayer_extension->ref_loc_offset_layer_id[i]);
       pps_multilayer_extension->phase_hor_luma.push_back(sgolomb_tmp);
 
       // phase_ver_luma[ref_loc_offset_layer_id[i]]  se(v)
       if (!bit_buffer->ReadSignedExponentialGolomb(sgolomb_tmp)) {
         return nullptr;
       }
+      H265Trace::se(bit_buffer, "phase_ver_luma", sgolomb_tmp,
+                    pps_multilayer_extension->ref_loc_offset_layer_id[i]);
       pps_multilayer_extension->phase_ver_luma.push_back(sgolomb_tmp);
 
       // phase_hor_chroma_plus8[ref_loc_offset_layer_id[i]]  se(v)
       if (!bit_buffer->ReadSignedExponentialGolomb(sgolomb_tmp)) {
         return nullptr;
       }
+      H265Trace::se(bit_buffer, "phase_hor_chroma_plus8", sgolomb_tmp,
+                    pps_multilayer_extension->ref_loc_offset_layer_id[i]);
       pps_multilayer_extension->phase_hor_chroma_plus8.push_back(sgolomb_tmp);
 
       // phase_ver_chroma_plus8[ref_loc_offset_layer_id[i]]  se(v)
       if (!bit_buffer->ReadSignedExponentialGolomb(sgolomb_tmp)) {
         return nullptr;
       }
+      H265Trace::se(bit_buffer, "phase_ver_chroma_plus8", sgolomb_tmp,
+                    pps_multilayer_extension->ref_loc_offset_layer_id[i]);
       pps_multilayer_extension->phase_ver_chroma_plus8.push_back(sgolomb_tmp);
     }
   }
@@ -184,15 +232,15 @@ H265PpsMultilayerExtensionParser::ParsePpsMultilayerExtension(
           1, pps_multilayer_extension->colour_mapping_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "colour_mapping_enabled_flag", 1,
+               pps_multilayer_extension->colour_mapping_enabled_flag);
 
   if (pps_multilayer_extension->colour_mapping_enabled_flag) {
     // colour_mapping_table(()
     // TODO(chemag): add support for colour_mapping_table(()
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "error: unimplemented colour_mapping_table(() in "
-            "pps_multilayer_extension(\n");
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_Unimplemented,
+                              "pps_multilayer_extension",
+                              "colour_mapping_table", bit_buffer);
     return nullptr;
   }
 
@@ -10,11 +10,14 @@
 #include <memory>
 #include <vector>
 
+#include "h265_budget.h"
 #include "h265_common.h"
+#include "h265_error.h"
 #include "h265_pps_multilayer_extension_parser.h"
 #include "h265_pps_scc_extension_parser.h"
 #include "h265_profile_tier_level_parser.h"
 #include "h265_scaling_list_data_parser.h"
+#include "h265_trace.h"
 
 namespace h265nal {
 
@@ -43,136 +46,189 @@ std::shared_ptr<H265PpsParser::PpsState> H265PpsParser::ParsePps(
   if (!bit_buffer->ReadExponentialGolomb(pps->pps_pic_parameter_set_id)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "pps_pic_parameter_set_id",
+                pps->pps_pic_parameter_set_id);
 
   // pps_seq_parameter_set_id  ue(v)
   if (!bit_buffer->ReadExponentialGolomb(pps->pps_seq_parameter_set_id)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "pps_seq_parameter_set_id",
+                pps->pps_seq_parameter_set_id);
 
   // dependent_slice_segments_enabled_flag  u(1)
   if (!bit_buffer->ReadBits(1, pps->dependent_slice_segments_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "dependent_slice_segments_enabled_flag", 1,
+               pps->dependent_slice_segments_enabled_flag);
 
   // output_flag_present_flag  u(1)
   if (!bit_buffer->ReadBits(1, pps->output_flag_present_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "output_flag_present_flag", 1,
+               pps->output_flag_present_flag);
 
   // num_extra_slice_header_bits  u(3)
   if (!bit_buffer->ReadBits(3, pps->num_extra_slice_header_bits)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "num_extra_slice_header_bits", 3,
+               pps->num_extra_slice_header_bits);
 
   // sign_data_hiding_enabled_flag  u(1)
   if (!bit_buffer->ReadBits(1, pps->sign_data_hiding_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "sign_data_hiding_enabled_flag", 1,
+               pps->sign_data_hiding_enabled_flag);
 
   // cabac_init_present_flag  u(1)
   if (!bit_buffer->ReadBits(1, pps->cabac_init_present_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "cabac_init_present_flag", 1,
+               pps->cabac_init_present_flag);
 
   // num_ref_idx_l0_default_active_minus1  ue(v)
   if (!bit_buffer->ReadExponentialGolomb(
           pps->num_ref_idx_l0_default_active_minus1)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "num_ref_idx_l0_default_active_minus1",
+                pps->num_ref_idx_l0_default_active_minus1);
 
   // num_ref_idx_l1_default_active_minus1  ue(v)
   if (!bit_buffer->ReadExponentialGolomb(
           pps->num_ref_idx_l1_default_active_minus1)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "num_ref_idx_l1_default_active_minus1",
+                pps->num_ref_idx_l1_default_active_minus1);
 
   // init_qp_minus26  se(v)
   if (!bit_buffer->ReadSignedExponentialGolomb(pps->init_qp_minus26)) {
     return nullptr;
   }
+  H265Trace::se(bit_buffer, "init_qp_minus26", pps->init_qp_minus26);
 
   // constrained_intra_pred_flag  u(1)
   if (!bit_buffer->ReadBits(1, pps->constrained_intra_pred_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "constrained_intra_pred_flag", 1,
+               pps->constrained_intra_pred_flag);
 
   // transform_skip_enabled_flag  u(1)
   if (!bit_buffer->ReadBits(1, pps->transform_skip_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "transform_skip_enabled_flag", 1,
+               pps->transform_skip_enabled_flag);
 
   // cu_qp_delta_enabled_flag  u(1)
   if (!bit_buffer->ReadBits(1, pps->cu_qp_delta_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "cu_qp_delta_enabled_flag", 1,
+               pps->cu_qp_delta_enabled_flag);
 
   if (pps->cu_qp_delta_enabled_flag) {
     // diff_cu_qp_delta_depth  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(pps->diff_cu_qp_delta_depth)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "diff_cu_qp_delta_depth",
+                  pps->diff_cu_qp_delta_depth);
   }
 
   // pps_cb_qp_offset  se(v)
   if (!bit_buffer->ReadSignedExponentialGolomb(pps->pps_cb_qp_offset)) {
     return nullptr;
   }
+  H265Trace::se(bit_buffer, "pps_cb_qp_offset", pps->pps_cb_qp_offset);
 
   // pps_cr_qp_offset  se(v)
   if (!bit_buffer->ReadSignedExponentialGolomb(pps->pps_cr_qp_offset)) {
     return nullptr;
   }
+  H265Trace::se(bit_buffer, "pps_cr_qp_offset", pps->pps_cr_qp_offset);
 
   // pps_slice_chroma_qp_offsets_present_flag  u(1)
   if (!bit_buffer->ReadBits(1, pps->pps_slice_chroma_qp_offsets_present_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "pps_slice_chroma_qp_offsets_present_flag", 1,
+               pps->pps_slice_chroma_qp_offsets_present_flag);
 
   // weighted_pred_flag  u(1)
   if (!bit_buffer->ReadBits(1, pps->weighted_pred_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "weighted_pred_flag", 1, pps->weighted_pred_flag);
 
   // weighted_bipred_flag  u(1)
   if (!bit_buffer->ReadBits(1, pps->weighted_bipred_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "weighted_bipred_flag", 1,
+               pps->weighted_bipred_flag);
 
   // transquant_bypass_enabled_flag  u(1)
   if (!bit_buffer->ReadBits(1, pps->transquant_bypass_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "transquant_bypass_enabled_flag", 1,
+               pps->transquant_bypass_enabled_flag);
 
   // tiles_enabled_flag  u(1)
   if (!bit_buffer->ReadBits(1, pps->tiles_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "tiles_enabled_flag", 1, pps->tiles_enabled_flag);
 
   // entropy_coding_sync_enabled_flag  u(1)
   if (!bit_buffer->ReadBits(1, pps->entropy_coding_sync_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "entropy_coding_sync_enabled_flag", 1,
+               pps->entropy_coding_sync_enabled_flag);
 
   if (pps->tiles_enabled_flag) {
     // num_tile_columns_minus1  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(pps->num_tile_columns_minus1)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "num_tile_columns_minus1",
+                  pps->num_tile_columns_minus1);
     // num_tile_rows_minus1  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(pps->num_tile_rows_minus1)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "num_tile_rows_minus1",
+                  pps->num_tile_rows_minus1);
     // uniform_spacing_flag  u(1)
     if (!bit_buffer->ReadBits(1, pps->uniform_spacing_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "uniform_spacing_flag", 1,
+                 pps->uniform_spacing_flag);
 
     if (!pps->uniform_spacing_flag) {
+      uint64_t num_tile_sizes = (uint64_t)pps->num_tile_columns_minus1 +
+                                pps->num_tile_rows_minus1;
+      if (!H265Budget::Charge("pps", "column_width_minus1", bit_buffer,
+                              num_tile_sizes,
+                              num_tile_sizes * sizeof(uint32_t))) {
+        return nullptr;
+      }
       for (uint32_t i = 0; i < pps->num_tile_columns_minus1; i++) {
         // column_width_minus1[i]  ue(v)
         if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
           return nullptr;
         }
+        H265Trace::ue(bit_buffer, "column_width_minus1", golomb_tmp, i);
         pps->column_width_minus1.push_back(golomb_tmp);
       }
       for (uint32_t i = 0; i < pps->num_tile_rows_minus1; i++) {
@@ -180,6 +236,7 @@ std::shared_ptr<H265PpsParser::PpsState> H265PpsParser::ParsePps(
         if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
           return nullptr;
         }
+        H265Trace::ue(bit_buffer, "row_height_minus1", golomb_tmp, i);
         pps->row_height_minus1.push_back(golomb_tmp);
       }
     }
@@ -188,6 +245,8 @@ std::shared_ptr<H265PpsParser::PpsState> H265PpsParser::ParsePps(
     if (!bit_buffer->ReadBits(1, pps->loop_filter_across_tiles_enabled_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "loop_filter_across_tiles_enabled_flag", 1,
+                 pps->loop_filter_across_tiles_enabled_flag);
   }
 
   // pps_loop_filter_across_slices_enabled_flag u(1)
@@ -195,11 +254,15 @@ std::shared_ptr<H265PpsParser::PpsState> H265PpsParser::ParsePps(
                             pps->pps_loop_filter_across_slices_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "pps_loop_filter_across_slices_enabled_flag", 1,
+               pps->pps_loop_filter_across_slices_enabled_flag);
 
   // deblocking_filter_control_present_flag  u(1)
   if (!bit_buffer->ReadBits(1, pps->deblocking_filter_control_present_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "deblocking_filter_control_present_flag", 1,
+               pps->deblocking_filter_control_present_flag);
 
   if (pps->deblocking_filter_control_present_flag) {
     // deblocking_filter_override_enabled_flag u(1)
@@ -207,22 +270,29 @@ std::shared_ptr<H265PpsParser::PpsState> H265PpsParser::ParsePps(
                               pps->deblocking_filter_override_enabled_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "deblocking_filter_override_enabled_flag", 1,
+                 pps->deblocking_filter_override_enabled_flag);
 
     // pps_deblocking_filter_disabled_flag  u(1)
     if (!bit_buffer->ReadBits(1, pps->pps_deblocking_filter_disabled_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "pps_deblocking_filter_disabled_flag", 1,
+                 pps->pps_deblocking_filter_disabled_flag);
 
     if (!pps->pps_deblocking_filter_disabled_flag) {
       // pps_beta_offset_div2  se(v)
       if (!bit_buffer->ReadSignedExponentialGolomb(pps->pps_beta_offset_div2)) {
         return nullptr;
       }
+      H265Trace::se(bit_buffer, "pps_beta_offset_div2",
+                    pps->pps_beta_offset_div2);
 
       // pps_tc_offset_div2  se(v)
       if (!bit_buffer->ReadSignedExponentialGolomb(pps->pps_tc_offset_div2)) {
         return nullptr;
       }
+      H265Trace::se(bit_buffer, "pps_tc_offset_div2", pps->pps_tc_offset_div2);
     }
   }
 
@@ -230,6 +300,8 @@ std::shared_ptr<H265PpsParser::PpsState> H265PpsParser::ParsePps(
   if (!bit_buffer->ReadBits(1, pps->pps_scaling_list_data_present_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "pps_scaling_list_data_present_flag", 1,
+               pps->pps_scaling_list_data_present_flag);
 
   if (pps->pps_scaling_list_data_present_flag) {
     // scaling_list_data()
@@ -244,57 +316,74 @@ std::shared_ptr<H265PpsParser::PpsState> H265PpsParser::ParsePps(
   if (!bit_buffer->ReadBits(1, pps->lists_modification_present_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "lists_modification_present_flag", 1,
+               pps->lists_modification_present_flag);
 
   // log2_parallel_merge_level_minus2  ue(v)
   if (!bit_buffer->ReadExponentialGolomb(
           pps->log2_parallel_merge_level_minus2)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "log2_parallel_merge_level_minus2",
+                pps->log2_parallel_merge_level_minus2);
 
   // slice_segment_header_extension_present_flag  u(1)
   if (!bit_buffer->ReadBits(1,
                             pps->slice_segment_header_extension_present_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "slice_segment_header_extension_present_flag", 1,
+               pps->slice_segment_header_extension_present_flag);
 
   // pps_extension_present_flag  u(1)
   if (!bit_buffer->ReadBits(1, pps->pps_extension_present_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "pps_extension_present_flag", 1,
+               pps->pps_extension_present_flag);
 
   if (pps->pps_extension_present_flag) {
     // pps_range_extension_flag  u(1)
     if (!bit_buffer->ReadBits(1, pps->pps_range_extension_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "pps_range_extension_flag", 1,
+                 pps->pps_range_extension_flag);
 
     // pps_multilayer_extension_flag  u(1)
     if (!bit_buffer->ReadBits(1, pps->pps_multilayer_extension_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "pps_multilayer_extension_flag", 1,
+                 pps->pps_multilayer_extension_flag);
 
     // pps_3d_extension_flag  u(1)
     if (!bit_buffer->ReadBits(1, pps->pps_3d_extension_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "pps_3d_extension_flag", 1,
+                 pps->pps_3d_extension_flag);
 
     // pps_scc_extension_flag  u(1)
     if (!bit_buffer->ReadBits(1, pps->pps_scc_extension_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "pps_scc_extension_flag", 1,
+                 pps->pps_scc_extension_flag);
 
     // pps_extension_4bits  u(4)
     if (!bit_buffer->ReadBits(4, pps->pps_extension_4bits)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "pps_extension_4bits", 4,
+                 pps->pps_extension_4bits);
   }
 
   if (pps->pps_range_extension_flag) {
     // pps_range_extension()
     // TODO(chemag): add support for pps_range_extension()
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "error: unimplemented pps_range_extension() in pps\n");
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_Unimplemented, "pps",
+                              "pps_range_extension", bit_buffer);
     return nullptr;
   }
 
@@ -308,9 +397,8 @@ std::shared_ptr<H265PpsParser::PpsState> H265PpsParser::ParsePps(
   if (pps->pps_3d_extension_flag) {
     // pps_3d_extension() // specified in Annex I
     // TODO(chemag): add support for pps_3d_extension()
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "error: unimplemented pps_3d_extension() in pps\n");
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_Unimplemented, "pps",
+                              "pps_3d_extension", bit_buffer);
     return nullptr;
   }
 
@@ -329,6 +417,8 @@ std::shared_ptr<H265PpsParser::PpsState> H265PpsParser::ParsePps(
       if (!bit_buffer->ReadBits(1, pps->pps_extension_data_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "pps_extension_data_flag", 1,
+                   pps->pps_extension_data_flag);
     }
   }
 
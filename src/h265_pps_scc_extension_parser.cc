@@ -11,7 +11,10 @@
 #include <memory>
 #include <vector>
 
+#include "h265_budget.h"
 #include "h265_common.h"
+#include "h265_error.h"
+#include "h265_trace.h"
 
 namespace h265nal {
 
@@ -43,6 +46,8 @@ H265PpsSccExtensionParser::ParsePpsSccExtension(
                             pps_scc_extension->pps_curr_pic_ref_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "pps_curr_pic_ref_enabled_flag", 1,
+               pps_scc_extension->pps_curr_pic_ref_enabled_flag);
 
   // residual_adaptive_colour_transform_enabled_flag  u(1)
   if (!bit_buffer->ReadBits(
@@ -50,6 +55,9 @@ H265PpsSccExtensionParser::ParsePpsSccExtension(
           pps_scc_extension->residual_adaptive_colour_transform_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(
+      bit_buffer, "residual_adaptive_colour_transform_enabled_flag", 1,
+      pps_scc_extension->residual_adaptive_colour_transform_enabled_flag);
 
   if (pps_scc_extension->residual_adaptive_colour_transform_enabled_flag) {
     // pps_slice_act_qp_offsets_present_flag  u(1)
@@ -57,24 +65,32 @@ H265PpsSccExtensionParser::ParsePpsSccExtension(
             1, pps_scc_extension->pps_slice_act_qp_offsets_present_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "pps_slice_act_qp_offsets_present_flag", 1,
+                 pps_scc_extension->pps_slice_act_qp_offsets_present_flag);
 
     // pps_act_y_qp_offset_plus5  se(v)
     if (!bit_buffer->ReadSignedExponentialGolomb(
             pps_scc_extension->pps_act_y_qp_offset_plus5)) {
       return nullptr;
     }
+    H265Trace::se(bit_buffer, "pps_act_y_qp_offset_plus5",
+                  pps_scc_extension->pps_act_y_qp_offset_plus5);
 
     // pps_act_cb_qp_offset_plus5  se(v)
     if (!bit_buffer->ReadSignedExponentialGolomb(
             pps_scc_extension->pps_act_cb_qp_offset_plus5)) {
       return nullptr;
     }
+    H265Trace::se(bit_buffer, "pps_act_cb_qp_offset_plus5",
+                  pps_scc_extension->pps_act_cb_qp_offset_plus5);
 
     // pps_act_cr_qp_offset_plus3  se(v)
     if (!bit_buffer->ReadSignedExponentialGolomb(
             pps_scc_extension->pps_act_cr_qp_offset_plus3)) {
       return nullptr;
     }
+    H265Trace::se(bit_buffer, "pps_act_cr_qp_offset_plus3",
+                  pps_scc_extension->pps_act_cr_qp_offset_plus3);
   }
 
   // pps_palette_predictor_initializer_present_flag  u(1)
@@ -83,6 +99,9 @@ H265PpsSccExtensionParser::ParsePpsSccExtension(
           pps_scc_extension->pps_palette_predictor_initializer_present_flag)) {
     return nullptr;
   }
+  H265Trace::u(
+      bit_buffer, "pps_palette_predictor_initializer_present_flag", 1,
+      pps_scc_extension->pps_palette_predictor_initializer_present_flag);
 
   if (pps_scc_extension->pps_palette_predictor_initializer_present_flag) {
     // pps_num_palette_predictor_initializer  ue(v)
@@ -90,6 +109,8 @@ H265PpsSccExtensionParser::ParsePpsSccExtension(
             pps_scc_extension->pps_num_palette_predictor_initializer)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "pps_num_palette_predictor_initializer",
+                  pps_scc_extension->pps_num_palette_predictor_initializer);
 
     if (pps_scc_extension->pps_num_palette_predictor_initializer > 0) {
       // monochrome_palette_flag  u(1)
@@ -97,12 +118,16 @@ H265PpsSccExtensionParser::ParsePpsSccExtension(
                                 pps_scc_extension->monochrome_palette_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "monochrome_palette_flag", 1,
+                   pps_scc_extension->monochrome_palette_flag);
 
       // luma_bit_depth_entry_minus8  ue(v)
       if (!bit_buffer->ReadExponentialGolomb(
               pps_scc_extension->luma_bit_depth_entry_minus8)) {
         return nullptr;
       }
+      H265Trace::ue(bit_buffer, "luma_bit_depth_entry_minus8",
+                    pps_scc_extension->luma_bit_depth_entry_minus8);
 
       if (pps_scc_extension->monochrome_palette_flag) {
         // chroma_bit_depth_entry_minus8  ue(v)
@@ -110,9 +135,21 @@ H265PpsSccExtensionParser::ParsePpsSccExtension(
                 pps_scc_extension->chroma_bit_depth_entry_minus8)) {
           return nullptr;
         }
+        H265Trace::ue(bit_buffer, "chroma_bit_depth_entry_minus8",
+                      pps_scc_extension->chroma_bit_depth_entry_minus8);
       }
 
       uint32_t numComps = pps_scc_extension->monochrome_palette_flag ? 1 : 3;
+      if (!H265Budget::Charge(
+              "pps_scc_extension", "pps_palette_predictor_initializers",
+              bit_buffer,
+              static_cast<uint64_t>(numComps) *
+                  pps_scc_extension->pps_num_palette_predictor_initializer,
+              static_cast<uint64_t>(numComps) *
+                  pps_scc_extension->pps_num_palette_predictor_initializer *
+                  sizeof(uint32_t))) {
+        return nullptr;
+      }
       for (uint32_t comp = 0; comp < numComps; comp++) {
         pps_scc_extension->pps_palette_predictor_initializers.emplace_back();
 
@@ -130,20 +167,17 @@ H265PpsSccExtensionParser::ParsePpsSccExtension(
                   ? (pps_scc_extension->luma_bit_depth_entry_minus8 + 8)
                   : (pps_scc_extension->chroma_bit_depth_entry_minus8 + 8);
           if (bit_depth == 0) {
-#ifdef FPRINT_ERRORS
-            fprintf(stderr,
-                    "error: invalid luma_bit_depth_entry_minus8: "
-                    "%" PRIu32
-                    " or chroma_bit_depth_entry_minus8: "
-                    "%" PRIu32 "\n",
-                    pps_scc_extension->luma_bit_depth_entry_minus8,
-                    pps_scc_extension->chroma_bit_depth_entry_minus8);
-#endif  // FPRINT_ERRORS
+            H265ErrorReporter::Report(H265ErrorCode_InvalidValue,
+                                      "pps_scc_extension",
+                                      "bit_depth_entry_minus8", bit_buffer,
+                                      bit_depth, 0, 0);
             return nullptr;
           }
           if (!bit_buffer->ReadBits(bit_depth, bits_tmp)) {
             return nullptr;
           }
+          H265Trace::u(bit_buffer, "pps_palette_predictor_initializers",
+                       bit_depth, bits_tmp, comp, i);
           pps_scc_extension->pps_palette_predictor_initializers[comp].push_back(
               bits_tmp);
         }
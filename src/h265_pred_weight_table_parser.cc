@@ -12,6 +12,8 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_parser_context.h"
+#include "h265_trace.h"
 
 namespace h265nal {
 
@@ -40,7 +42,7 @@ H265PredWeightTableParser::ParsePredWeightTable(
   // H265 pred_weight_table() NAL Unit.
   // Section 7.3.6.3 ("Weighted prediction parameters syntax") of the
   // H.265 standard for a complete description.
-  auto pred_weight_table = std::make_unique<PredWeightTableState>();
+  auto pred_weight_table = H265ParserContext::MakeState<PredWeightTableState>();
 
   pred_weight_table->ChromaArrayType = ChromaArrayType;
   pred_weight_table->num_ref_idx_l0_active_minus1 =
@@ -51,6 +53,8 @@ H265PredWeightTableParser::ParsePredWeightTable(
           pred_weight_table->luma_log2_weight_denom)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "luma_log2_weight_denom",
+                pred_weight_table->luma_log2_weight_denom);
 
   if (pred_weight_table->ChromaArrayType != 0) {
     // delta_chroma_log2_weight_denom  se(v)
@@ -58,6 +62,8 @@ H265PredWeightTableParser::ParsePredWeightTable(
             pred_weight_table->delta_chroma_log2_weight_denom)) {
       return nullptr;
     }
+    H265Trace::se(bit_buffer, "delta_chroma_log2_weight_denom",
+                  pred_weight_table->delta_chroma_log2_weight_denom);
   }
 
   for (uint32_t i = 0; i <= pred_weight_table->num_ref_idx_l0_active_minus1;
@@ -68,6 +74,7 @@ H265PredWeightTableParser::ParsePredWeightTable(
     if (!bit_buffer->ReadBits(1, bits_tmp)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "luma_weight_l0_flag", 1, bits_tmp, i);
     pred_weight_table->luma_weight_l0_flag.push_back(bits_tmp);
   }
 
@@ -80,6 +87,7 @@ H265PredWeightTableParser::ParsePredWeightTable(
       if (!bit_buffer->ReadBits(1, bits_tmp)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "chroma_weight_l0_flag", 1, bits_tmp, i);
       pred_weight_table->chroma_weight_l0_flag.push_back(bits_tmp);
     }
   }
@@ -91,22 +99,28 @@ H265PredWeightTableParser::ParsePredWeightTable(
       if (!bit_buffer->ReadSignedExponentialGolomb(sgolomb_tmp)) {
         return nullptr;
       }
+      H265Trace::se(bit_buffer, "delta_luma_weight_l0", sgolomb_tmp, i);
       pred_weight_table->delta_luma_weight_l0.push_back(sgolomb_tmp);
       // luma_offset_l0[i]  se(v)
       if (!bit_buffer->ReadSignedExponentialGolomb(sgolomb_tmp)) {
         return nullptr;
       }
+      H265Trace::se(bit_buffer, "luma_offset_l0", sgolomb_tmp, i);
       pred_weight_table->luma_offset_l0.push_back(sgolomb_tmp);
     }
     if (pred_weight_table->ChromaArrayType != 0) {
       if (pred_weight_table->chroma_weight_l0_flag[i]) {
-        pred_weight_table->delta_chroma_weight_l0.emplace_back();
-        pred_weight_table->delta_chroma_offset_l0.emplace_back();
-        for (int j = 0; j < 2; ++j) {
+        pred_weight_table->delta_chroma_weight_l0.push_back(
+            H265ParserContext::MakeInt32Vector());
+        pred_weight_table->delta_chroma_offset_l0.push_back(
+            H265ParserContext::MakeInt32Vector());
+        for (uint32_t j = 0; j < 2; ++j) {
           // delta_chroma_weight_l0[i][j]  se(v)
           if (!bit_buffer->ReadSignedExponentialGolomb(sgolomb_tmp)) {
             return nullptr;
           }
+          H265Trace::se(bit_buffer, "delta_chroma_weight_l0", sgolomb_tmp, i,
+                        j);
           pred_weight_table->delta_chroma_weight_l0.back().push_back(
               sgolomb_tmp);
 
@@ -114,6 +128,8 @@ H265PredWeightTableParser::ParsePredWeightTable(
           if (!bit_buffer->ReadSignedExponentialGolomb(sgolomb_tmp)) {
             return nullptr;
           }
+          H265Trace::se(bit_buffer, "delta_chroma_offset_l0", sgolomb_tmp, i,
+                        j);
           pred_weight_table->delta_chroma_offset_l0.back().push_back(
               sgolomb_tmp);
         }
@@ -12,6 +12,7 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_trace.h"
 
 namespace h265nal {
 
@@ -58,18 +59,22 @@ H265ProfileTierLevelParser::ParseProfileTierLevel(
   if (!bit_buffer->ReadBits(8, profile_tier_level->general_level_idc)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "general_level_idc", 8,
+               profile_tier_level->general_level_idc);
 
   for (uint32_t i = 0; i < maxNumSubLayersMinus1; i++) {
     // sub_layer_profile_present_flag[i]  u(1)
     if (!bit_buffer->ReadBits(1, bits_tmp)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "sub_layer_profile_present_flag", 1, bits_tmp, i);
     profile_tier_level->sub_layer_profile_present_flag.push_back(bits_tmp);
 
     // sub_layer_level_present_flag[i]  u(1)
     if (!bit_buffer->ReadBits(1, bits_tmp)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "sub_layer_level_present_flag", 1, bits_tmp, i);
     profile_tier_level->sub_layer_level_present_flag.push_back(bits_tmp);
   }
 
@@ -79,6 +84,7 @@ H265ProfileTierLevelParser::ParseProfileTierLevel(
       if (!bit_buffer->ReadBits(2, bits_tmp)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "reserved_zero_2bits", 2, bits_tmp, i);
       profile_tier_level->reserved_zero_2bits.push_back(bits_tmp);
     }
   }
@@ -97,6 +103,7 @@ H265ProfileTierLevelParser::ParseProfileTierLevel(
       if (!bit_buffer->ReadBits(8, bits_tmp)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "sub_layer_level_idc", 8, bits_tmp);
       profile_tier_level->sub_layer_level_idc.push_back(bits_tmp);
     }
   }
@@ -121,38 +128,51 @@ H265ProfileInfoParser::ParseProfileInfo(BitBuffer* bit_buffer) noexcept {
   if (!bit_buffer->ReadBits(2, profile_info->profile_space)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "profile_space", 2, profile_info->profile_space);
   // tier_flag  u(1)
   if (!bit_buffer->ReadBits(1, profile_info->tier_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "tier_flag", 1, profile_info->tier_flag);
   // profile_idc  u(5)
   if (!bit_buffer->ReadBits(5, profile_info->profile_idc)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "profile_idc", 5, profile_info->profile_idc);
   // for (j = 0; j < 32; j++)
   for (uint32_t j = 0; j < 32; j++) {
     // profile_compatibility_flag[j]  u(1)
     if (!bit_buffer->ReadBits(1, profile_info->profile_compatibility_flag[j])) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "profile_compatibility_flag", 1,
+                 profile_info->profile_compatibility_flag[j], j);
   }
 
   // progressive_source_flag  u(1)
   if (!bit_buffer->ReadBits(1, profile_info->progressive_source_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "progressive_source_flag", 1,
+               profile_info->progressive_source_flag);
   // interlaced_source_flag  u(1)
   if (!bit_buffer->ReadBits(1, profile_info->interlaced_source_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "interlaced_source_flag", 1,
+               profile_info->interlaced_source_flag);
   // non_packed_constraint_flag  u(1)
   if (!bit_buffer->ReadBits(1, profile_info->non_packed_constraint_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "non_packed_constraint_flag", 1,
+               profile_info->non_packed_constraint_flag);
   // frame_only_constraint_flag  u(1)
   if (!bit_buffer->ReadBits(1, profile_info->frame_only_constraint_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "frame_only_constraint_flag", 1,
+               profile_info->frame_only_constraint_flag);
   if (profile_info->profile_idc == 4 ||
       profile_info->profile_compatibility_flag[4] == 1 ||
       profile_info->profile_idc == 5 ||
@@ -175,41 +195,59 @@ H265ProfileInfoParser::ParseProfileInfo(BitBuffer* bit_buffer) noexcept {
     if (!bit_buffer->ReadBits(1, profile_info->max_12bit_constraint_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "max_12bit_constraint_flag", 1,
+                 profile_info->max_12bit_constraint_flag);
     // max_10bit_constraint_flag  u(1)
     if (!bit_buffer->ReadBits(1, profile_info->max_10bit_constraint_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "max_10bit_constraint_flag", 1,
+                 profile_info->max_10bit_constraint_flag);
     // max_8bit_constraint_flag  u(1)
     if (!bit_buffer->ReadBits(1, profile_info->max_8bit_constraint_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "max_8bit_constraint_flag", 1,
+                 profile_info->max_8bit_constraint_flag);
     // max_422chroma_constraint_flag  u(1)
     if (!bit_buffer->ReadBits(1, profile_info->max_422chroma_constraint_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "max_422chroma_constraint_flag", 1,
+                 profile_info->max_422chroma_constraint_flag);
     // max_420chroma_constraint_flag  u(1)
     if (!bit_buffer->ReadBits(1, profile_info->max_420chroma_constraint_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "max_420chroma_constraint_flag", 1,
+                 profile_info->max_420chroma_constraint_flag);
     // max_monochrome_constraint_flag  u(1)
     if (!bit_buffer->ReadBits(1,
                               profile_info->max_monochrome_constraint_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "max_monochrome_constraint_flag", 1,
+                 profile_info->max_monochrome_constraint_flag);
     // intra_constraint_flag  u(1)
     if (!bit_buffer->ReadBits(1, profile_info->intra_constraint_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "intra_constraint_flag", 1,
+                 profile_info->intra_constraint_flag);
     // one_picture_only_constraint_flag  u(1)
     if (!bit_buffer->ReadBits(1,
                               profile_info->one_picture_only_constraint_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "one_picture_only_constraint_flag", 1,
+                 profile_info->one_picture_only_constraint_flag);
     // lower_bit_rate_constraint_flag  u(1)
     if (!bit_buffer->ReadBits(1,
                               profile_info->lower_bit_rate_constraint_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "lower_bit_rate_constraint_flag", 1,
+                 profile_info->lower_bit_rate_constraint_flag);
     if (profile_info->profile_idc == 5 ||
         profile_info->profile_compatibility_flag[5] == 1 ||
         profile_info->profile_idc == 9 ||
@@ -222,6 +260,8 @@ H265ProfileInfoParser::ParseProfileInfo(BitBuffer* bit_buffer) noexcept {
       if (!bit_buffer->ReadBits(1, profile_info->max_14bit_constraint_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "max_14bit_constraint_flag", 1,
+                   profile_info->max_14bit_constraint_flag);
       // reserved_zero_33bits  u(33)
       if (!bit_buffer->ReadBits(1, bits_tmp_hi)) {
         return nullptr;
@@ -231,6 +271,8 @@ H265ProfileInfoParser::ParseProfileInfo(BitBuffer* bit_buffer) noexcept {
       }
       profile_info->reserved_zero_33bits =
           ((uint64_t)bits_tmp_hi << 32) | bits_tmp;
+      H265Trace::u(bit_buffer, "reserved_zero_33bits", 33,
+                   profile_info->reserved_zero_33bits);
     } else {
       // reserved_zero_34bits  u(34)
       if (!bit_buffer->ReadBits(2, bits_tmp_hi)) {
@@ -241,6 +283,8 @@ H265ProfileInfoParser::ParseProfileInfo(BitBuffer* bit_buffer) noexcept {
       }
       profile_info->reserved_zero_34bits =
           ((uint64_t)bits_tmp_hi << 32) | bits_tmp;
+      H265Trace::u(bit_buffer, "reserved_zero_34bits", 34,
+                   profile_info->reserved_zero_34bits);
     }
   } else if (profile_info->profile_idc == 2 ||
              profile_info->profile_compatibility_flag[2] == 1) {
@@ -248,11 +292,15 @@ H265ProfileInfoParser::ParseProfileInfo(BitBuffer* bit_buffer) noexcept {
     if (!bit_buffer->ReadBits(7, profile_info->reserved_zero_7bits)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "reserved_zero_7bits", 7,
+                 profile_info->reserved_zero_7bits);
     // one_picture_only_constraint_flag  u(1)
     if (!bit_buffer->ReadBits(1,
                               profile_info->one_picture_only_constraint_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "one_picture_only_constraint_flag", 1,
+                 profile_info->one_picture_only_constraint_flag);
     // reserved_zero_35bits  u(35)
     if (!bit_buffer->ReadBits(3, bits_tmp_hi)) {
       return nullptr;
@@ -262,6 +310,8 @@ H265ProfileInfoParser::ParseProfileInfo(BitBuffer* bit_buffer) noexcept {
     }
     profile_info->reserved_zero_35bits =
         ((uint64_t)bits_tmp_hi << 32) | bits_tmp;
+    H265Trace::u(bit_buffer, "reserved_zero_35bits", 35,
+                 profile_info->reserved_zero_35bits);
   } else {
     // reserved_zero_43bits  u(43)
     if (!bit_buffer->ReadBits(11, bits_tmp_hi)) {
@@ -272,6 +322,8 @@ H265ProfileInfoParser::ParseProfileInfo(BitBuffer* bit_buffer) noexcept {
     }
     profile_info->reserved_zero_43bits =
         ((uint64_t)bits_tmp_hi << 32) | bits_tmp;
+    H265Trace::u(bit_buffer, "reserved_zero_43bits", 43,
+                 profile_info->reserved_zero_43bits);
   }
   // get profile type
   profile_info->profile_type = profile_info->GetProfileType();
@@ -295,11 +347,14 @@ H265ProfileInfoParser::ParseProfileInfo(BitBuffer* bit_buffer) noexcept {
     if (!bit_buffer->ReadBits(1, profile_info->inbld_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "inbld_flag", 1, profile_info->inbld_flag);
   } else {
     // reserved_zero_bit  u(1)
     if (!bit_buffer->ReadBits(1, profile_info->reserved_zero_bit)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "reserved_zero_bit", 1,
+                 profile_info->reserved_zero_bit);
   }
 
   return profile_info;
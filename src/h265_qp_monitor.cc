@@ -0,0 +1,183 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_qp_monitor.h"
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_nal_unit_parser.h"
+#include "h265_utils.h"
+
+namespace {
+// The NAL unit starts a new access unit when it follows the last VCL NAL
+// unit of a picture (Section 7.4.2.4.4).
+bool StartsAccessUnit(uint32_t nal_unit_type) {
+  return (nal_unit_type >= h265nal::NalUnitType::VPS_NUT &&
+          nal_unit_type <= h265nal::NalUnitType::AUD_NUT) ||
+         nal_unit_type == h265nal::NalUnitType::PREFIX_SEI_NUT ||
+         (nal_unit_type >= h265nal::NalUnitType::RSV_NVCL41 &&
+          nal_unit_type <= h265nal::NalUnitType::RSV_NVCL44) ||
+         (nal_unit_type >= 48 && nal_unit_type <= 55);
+}
+}  // namespace
+
+namespace h265nal {
+
+H265QpMonitor::H265QpMonitor(const Options& options_in, Callback callback_in,
+                             void* opaque_in)
+    : options(options_in), callback(callback_in), opaque(opaque_in) {
+  if (options.window_size == 0) {
+    options.window_size = 1;
+  }
+  ring.resize(options.window_size);
+#ifdef RTP_DEFINE
+  depacketizer = std::make_unique<H265RtpDepacketizer>(
+      options.depacketizer_options, OnNalUnit, this);
+#endif  // RTP_DEFINE
+}
+
+void H265QpMonitor::AddNalUnit(const uint8_t* data, size_t length) noexcept {
+  auto nal_unit_state =
+      H265NalUnitParser::ParseNalUnit(data, length, &bitstream_parser_state,
+                                      options.parsing_options, &context);
+  if (nal_unit_state == nullptr) {
+    return;
+  }
+  AddNalUnit(*nal_unit_state, length, &bitstream_parser_state);
+  context.Recycle(std::move(nal_unit_state));
+}
+
+void H265QpMonitor::AddNalUnit(
+    const H265NalUnitParser::NalUnitState& nal_unit_state, size_t length,
+    const H265BitstreamParserState* bitstream_parser_state_in) noexcept {
+  if (nal_unit_state.nal_unit_header == nullptr) {
+    return;
+  }
+  uint32_t nal_unit_type = nal_unit_state.nal_unit_header->nal_unit_type;
+  if (!IsSliceSegment(nal_unit_type)) {
+    if (in_frame && StartsAccessUnit(nal_unit_type)) {
+      EndFrame();
+    }
+    return;
+  }
+  if (nal_unit_state.nal_unit_payload == nullptr ||
+      nal_unit_state.nal_unit_payload->slice_segment_layer == nullptr ||
+      nal_unit_state.nal_unit_payload->slice_segment_layer
+              ->slice_segment_header == nullptr) {
+    return;
+  }
+  const auto& slice_segment_header =
+      nal_unit_state.nal_unit_payload->slice_segment_layer
+          ->slice_segment_header;
+  if (in_frame && slice_segment_header->first_slice_segment_in_pic_flag) {
+    EndFrame();
+  }
+
+  // dependent slice segments use the QP of the previous slice segment
+  int32_t slice_qp = 0;
+  if (slice_segment_header->dependent_slice_segment_flag) {
+    if (!has_last_slice_qp) {
+      return;
+    }
+    slice_qp = last_slice_qp;
+  } else {
+    if (!H265Utils::GetSliceQpY(nal_unit_state, bitstream_parser_state_in,
+                                &slice_qp)) {
+      has_last_slice_qp = false;
+      return;
+    }
+    last_slice_qp = slice_qp;
+    has_last_slice_qp = true;
+  }
+
+  if (!in_frame || frame.num_slices == 0) {
+    frame.min_qp = slice_qp;
+    frame.max_qp = slice_qp;
+  } else {
+    frame.min_qp = (slice_qp < frame.min_qp) ? slice_qp : frame.min_qp;
+    frame.max_qp = (slice_qp > frame.max_qp) ? slice_qp : frame.max_qp;
+  }
+  in_frame = true;
+  frame.num_slices++;
+  frame.bytes += length;
+  frame_qp_sum += static_cast<double>(slice_qp) * static_cast<double>(length);
+  if (nal_unit_type >= NalUnitType::BLA_W_LP &&
+      nal_unit_type <= NalUnitType::RSV_IRAP_VCL23) {
+    frame.keyframe = true;
+  }
+}
+
+#ifdef RTP_DEFINE
+bool H265QpMonitor::AddRtpPacket(const uint8_t* data, size_t length) noexcept {
+  return depacketizer->AddPacket(data, length);
+}
+
+void H265QpMonitor::OnNalUnit(const H265RtpDepacketizer::NalUnit& nal_unit,
+                              void* opaque) {
+  auto* monitor = static_cast<H265QpMonitor*>(opaque);
+  monitor->AddNalUnit(nal_unit.data, nal_unit.length);
+  // the marker bit ends the access unit
+  if (nal_unit.marker && monitor->in_frame) {
+    monitor->EndFrame();
+  }
+}
+#endif  // RTP_DEFINE
+
+void H265QpMonitor::Flush() noexcept {
+#ifdef RTP_DEFINE
+  depacketizer->Flush();
+#endif  // RTP_DEFINE
+  if (in_frame) {
+    EndFrame();
+  }
+}
+
+void H265QpMonitor::EndFrame() noexcept {
+  in_frame = false;
+  if (frame.num_slices > 0) {
+    frame.avg_qp = (frame.bytes > 0)
+                       ? frame_qp_sum / static_cast<double>(frame.bytes)
+                       : static_cast<double>(frame.min_qp);
+    ring[ring_next] = frame;
+    ring_next = (ring_next + 1) % ring.size();
+    if (ring_size < ring.size()) {
+      ring_size++;
+    }
+    UpdateWindow();
+    if (callback != nullptr) {
+      callback(frame, window, opaque);
+    }
+  }
+  frame = FrameQp();
+  frame_qp_sum = 0.0;
+}
+
+void H265QpMonitor::UpdateWindow() noexcept {
+  window = WindowQp();
+  double qp_sum = 0.0;
+  for (size_t i = 0; i < ring_size; i++) {
+    const FrameQp& entry = ring[i];
+    if (i == 0 || entry.min_qp < window.min_qp) {
+      window.min_qp = entry.min_qp;
+    }
+    if (i == 0 || entry.max_qp > window.max_qp) {
+      window.max_qp = entry.max_qp;
+    }
+    window.bytes += entry.bytes;
+    qp_sum += entry.avg_qp * static_cast<double>(entry.bytes);
+  }
+  window.num_frames = ring_size;
+  window.avg_qp = (window.bytes > 0)
+                      ? qp_sum / static_cast<double>(window.bytes)
+                      : 0.0;
+}
+
+}  // namespace h265nal
@@ -12,6 +12,7 @@
 
 #include "h265_bitstream_parser_state.h"
 #include "h265_common.h"
+#include "h265_error.h"
 #include "h265_nal_unit_parser.h"
 #include "rtc_common.h"
 
@@ -25,27 +26,62 @@ namespace h265nal {
 std::unique_ptr<H265RtpApParser::RtpApState> H265RtpApParser::ParseRtpAp(
     const uint8_t* data, size_t length,
     struct H265BitstreamParserState* bitstream_parser_state) noexcept {
+  return ParseRtpAp(data, length, bitstream_parser_state, RtpDonParameters());
+}
+
+std::unique_ptr<H265RtpApParser::RtpApState> H265RtpApParser::ParseRtpAp(
+    const uint8_t* data, size_t length,
+    struct H265BitstreamParserState* bitstream_parser_state,
+    const RtpDonParameters& don_parameters) noexcept {
   std::vector<uint8_t> unpacked_buffer = UnescapeRbsp(data, length);
   BitBuffer bit_buffer(unpacked_buffer.data(), unpacked_buffer.size());
-  return ParseRtpAp(&bit_buffer, bitstream_parser_state);
+  return ParseRtpAp(&bit_buffer, bitstream_parser_state, don_parameters);
 }
 
 std::unique_ptr<H265RtpApParser::RtpApState> H265RtpApParser::ParseRtpAp(
     BitBuffer* bit_buffer,
     struct H265BitstreamParserState* bitstream_parser_state) noexcept {
+  return ParseRtpAp(bit_buffer, bitstream_parser_state, RtpDonParameters());
+}
+
+std::unique_ptr<H265RtpApParser::RtpApState> H265RtpApParser::ParseRtpAp(
+    BitBuffer* bit_buffer,
+    struct H265BitstreamParserState* bitstream_parser_state,
+    const RtpDonParameters& don_parameters) noexcept {
   // H265 RTP AP pseudo-NAL Unit.
   auto rtp_ap = std::make_unique<RtpApState>();
 
   // first read the common header
   rtp_ap->header = H265NalUnitHeaderParser::ParseNalUnitHeader(bit_buffer);
   if (rtp_ap->header == nullptr) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "error: cannot ParseNalUnitHeader in rtp ap\n");
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_ParseFailed, "rtp_ap",
+                              "nal_unit_header", bit_buffer);
     return nullptr;
   }
 
+  rtp_ap->don_present = don_parameters.DonPresent();
   while (bit_buffer->RemainingBitCount() > 0) {
+    if (rtp_ap->don_present) {
+      uint32_t don;
+      if (rtp_ap->nal_unit_dons.empty()) {
+        // DONL
+        if (!bit_buffer->ReadBits(16, rtp_ap->donl)) {
+          return nullptr;
+        }
+        rtp_ap->nal_unit_donds.push_back(0);
+        don = rtp_ap->donl;
+      } else {
+        // DOND: DON = (previous DON + DOND + 1) % 65536
+        uint32_t dond;
+        if (!bit_buffer->ReadBits(8, dond)) {
+          return nullptr;
+        }
+        rtp_ap->nal_unit_donds.push_back(dond);
+        don = (rtp_ap->nal_unit_dons.back() + dond + 1) % 65536;
+      }
+      rtp_ap->nal_unit_dons.push_back(don);
+    }
+
     // NALU size
     uint32_t nalu_size;
     if (!bit_buffer->ReadBits(16, nalu_size)) {
@@ -61,9 +97,8 @@ std::unique_ptr<H265RtpApParser::RtpApState> H265RtpApParser::ParseRtpAp(
     rtp_ap->nal_unit_headers.push_back(
         H265NalUnitHeaderParser::ParseNalUnitHeader(bit_buffer));
     if (rtp_ap->nal_unit_headers.back() == nullptr) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr, "error: cannot ParseNalUnitHeader in rtp ap\n");
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_ParseFailed, "rtp_ap",
+                                "nal_unit_header", bit_buffer);
       return nullptr;
     }
 
@@ -89,6 +124,15 @@ void H265RtpApParser::RtpApState::fdump(FILE* outfp, int indent_level,
   header->fdump(outfp, indent_level);
 
   for (size_t i = 0; i < nal_unit_sizes.size(); ++i) {
+    if (don_present) {
+      fdump_indent_level(outfp, indent_level);
+      if (i == 0) {
+        fprintf(outfp, "donl: %i", donl);
+      } else {
+        fprintf(outfp, "dond: %i", nal_unit_donds[i]);
+      }
+    }
+
     fdump_indent_level(outfp, indent_level);
     fprintf(outfp, "nal_unit_size: %zu", nal_unit_sizes[i]);
 
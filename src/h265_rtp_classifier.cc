@@ -0,0 +1,156 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_rtp_classifier.h"
+
+#include <stdio.h>
+
+#include <cstdint>
+
+#include "h265_common.h"
+#include "h265_rtp_header.h"
+
+namespace h265nal {
+
+namespace {
+RtpPacketDescriptor EmptyDescriptor() {
+  RtpPacketDescriptor descriptor = {};
+  return descriptor;
+}
+
+bool IsIrap(uint32_t nal_unit_type) {
+  return nal_unit_type >= NalUnitType::BLA_W_LP &&
+         nal_unit_type <= NalUnitType::RSV_IRAP_VCL23;
+}
+
+bool IsSwitchingPoint(uint32_t nal_unit_type) {
+  return IsIrap(nal_unit_type) ||
+         (nal_unit_type >= NalUnitType::TSA_N &&
+          nal_unit_type <= NalUnitType::STSA_R);
+}
+
+bool IsParameterSet(uint32_t nal_unit_type) {
+  return nal_unit_type >= NalUnitType::VPS_NUT &&
+         nal_unit_type <= NalUnitType::PPS_NUT;
+}
+
+// Add a NAL unit to the descriptor. `first_byte` points to the first byte
+// after the NAL unit header (nullptr if not available).
+void AddNalUnit(RtpPacketDescriptor* descriptor, uint32_t nal_unit_type,
+                const uint8_t* first_byte, bool* has_vcl) {
+  if (descriptor->num_nal_units < 63) {
+    descriptor->num_nal_units++;
+  }
+  bool vcl = (nal_unit_type <= NalUnitType::RSV_VCL31);
+  if (vcl && !*has_vcl) {
+    descriptor->nal_unit_type = nal_unit_type & 0x3f;
+    *has_vcl = true;
+  }
+  if (IsIrap(nal_unit_type)) {
+    descriptor->keyframe = 1;
+  }
+  if (IsSwitchingPoint(nal_unit_type)) {
+    descriptor->switching_point = 1;
+  }
+  if (IsParameterSet(nal_unit_type)) {
+    descriptor->parameter_sets = 1;
+  }
+  // first_slice_segment_in_pic_flag is the first slice segment header bit
+  if (vcl && first_byte != nullptr && (*first_byte & 0x80)) {
+    descriptor->start_of_frame = 1;
+  }
+}
+}  // namespace
+
+RtpPacketDescriptor H265RtpClassifier::ClassifyRtp(const uint8_t* data,
+                                                   size_t length,
+                                                   bool don_present) noexcept {
+  RtpHeader header;
+  if (!RtpHeader::Parse(data, length, &header)) {
+    return EmptyDescriptor();
+  }
+  return ClassifyPayload(data + header.payload_offset, header.payload_length,
+                         header.marker != 0, don_present);
+}
+
+RtpPacketDescriptor H265RtpClassifier::ClassifyPayload(
+    const uint8_t* data, size_t length, bool marker,
+    bool don_present) noexcept {
+  RtpPacketDescriptor descriptor = EmptyDescriptor();
+  // payload header (same format as a NAL unit header)
+  if (data == nullptr || length < 2 || (data[0] & 0x80) ||
+      (data[1] & 0x07) == 0) {
+    return descriptor;
+  }
+  uint32_t type = (data[0] >> 1) & 0x3f;
+  descriptor.layer_id = ((data[0] & 0x01) << 5) | (data[1] >> 3);
+  descriptor.temporal_id = (data[1] & 0x07) - 1;
+  descriptor.end_of_frame = marker ? 1 : 0;
+  descriptor.nal_unit_type = type;
+  bool has_vcl = false;
+  size_t don_length = don_present ? 2 : 0;
+
+  if (type < NalUnitType::AP) {
+    // single NAL unit packet
+    descriptor.packet_type = RtpPacketDescriptor::kSingle;
+    size_t offset = 2 + don_length;
+    AddNalUnit(&descriptor, type, (offset < length) ? data + offset : nullptr,
+               &has_vcl);
+
+  } else if (type == NalUnitType::AP) {
+    // aggregation packet: ([DONL|DOND], 16-bit size, NAL unit)+
+    descriptor.packet_type = RtpPacketDescriptor::kAp;
+    size_t offset = 2;
+    bool first = true;
+    uint32_t first_nal_unit_type = 0;
+    while (offset < length) {
+      offset += first ? don_length : (don_present ? 1 : 0);
+      first = false;
+      if (offset + 4 > length) {
+        return EmptyDescriptor();
+      }
+      size_t size =
+          static_cast<size_t>((data[offset] << 8) | data[offset + 1]);
+      offset += 2;
+      if (size < 2 || size > length - offset) {
+        return EmptyDescriptor();
+      }
+      uint32_t nal_unit_type = (data[offset] >> 1) & 0x3f;
+      if (descriptor.num_nal_units == 0) {
+        first_nal_unit_type = nal_unit_type;
+      }
+      AddNalUnit(&descriptor, nal_unit_type,
+                 (size > 2) ? data + offset + 2 : nullptr, &has_vcl);
+      offset += size;
+    }
+    if (!has_vcl) {
+      descriptor.nal_unit_type = first_nal_unit_type;
+    }
+
+  } else if (type == NalUnitType::FU) {
+    // fragmentation unit: FU header, [DONL], FU payload
+    descriptor.packet_type = RtpPacketDescriptor::kFu;
+    if (length < 3) {
+      return EmptyDescriptor();
+    }
+    descriptor.fu_start = data[2] >> 7;
+    descriptor.fu_end = (data[2] >> 6) & 0x01;
+    uint32_t fu_type = data[2] & 0x3f;
+    size_t offset = 3 + (descriptor.fu_start ? don_length : 0);
+    // only the first fragment contains the slice segment header
+    const uint8_t* first_byte =
+        (descriptor.fu_start && offset < length) ? data + offset : nullptr;
+    AddNalUnit(&descriptor, fu_type, first_byte, &has_vcl);
+    descriptor.nal_unit_type = fu_type;
+
+  } else {
+    // PACI and unspecified types
+    descriptor.packet_type = RtpPacketDescriptor::kOther;
+  }
+
+  descriptor.valid = 1;
+  return descriptor;
+}
+
+}  // namespace h265nal
@@ -0,0 +1,135 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_rtp_deinterleaver.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace h265nal {
+
+H265RtpDeinterleaver::H265RtpDeinterleaver(
+    const RtpDonParameters& don_parameters_in,
+    H265RtpDepacketizer::Callback callback_in, void* opaque_in)
+    : don_parameters(don_parameters_in),
+      callback(callback_in),
+      opaque(opaque_in) {}
+
+void H265RtpDeinterleaver::AddNalUnitCallback(
+    const H265RtpDepacketizer::NalUnit& nal_unit, void* opaque) {
+  static_cast<H265RtpDeinterleaver*>(opaque)->AddNalUnit(nal_unit);
+}
+
+bool H265RtpDeinterleaver::After(size_t a, size_t b) const {
+  const Entry& entry_a = entries[a];
+  const Entry& entry_b = entries[b];
+  if (entry_a.extended_don != entry_b.extended_don) {
+    return entry_a.extended_don > entry_b.extended_don;
+  }
+  return entry_a.arrival > entry_b.arrival;
+}
+
+void H265RtpDeinterleaver::AddNalUnit(
+    const H265RtpDepacketizer::NalUnit& nal_unit) noexcept {
+  stats.nal_units_received++;
+
+  // extend the DON relative to the highest one received
+  int64_t extended_don;
+  if (!started) {
+    started = true;
+    extended_don = nal_unit.don;
+    max_extended_don = extended_don;
+  } else {
+    extended_don = max_extended_don +
+                   RtpDonParameters::DonDiff(
+                       static_cast<uint32_t>(max_extended_don & 0xffff),
+                       nal_unit.don);
+    max_extended_don = std::max(max_extended_don, extended_don);
+  }
+  if (emitted && extended_don < last_emitted_don) {
+    // a NAL unit that follows it in decoding order was already emitted
+    stats.nal_units_dropped++;
+    return;
+  }
+
+  // copy the NAL unit into a pooled entry
+  size_t index;
+  if (!free_entries.empty()) {
+    index = free_entries.back();
+    free_entries.pop_back();
+  } else {
+    index = entries.size();
+    entries.emplace_back();
+  }
+  Entry& entry = entries[index];
+  entry.extended_don = extended_don;
+  entry.arrival = arrival_counter++;
+  entry.nal_unit = nal_unit;
+  entry.data.assign(nal_unit.data, nal_unit.data + nal_unit.length);
+  buffered_bytes += nal_unit.length;
+  heap.push_back(index);
+  std::push_heap(heap.begin(), heap.end(),
+                 [this](size_t a, size_t b) { return After(a, b); });
+  stats.max_buffered_nal_units =
+      std::max<uint64_t>(stats.max_buffered_nal_units, heap.size());
+
+  // release the NAL units that cannot be preceded by a later arrival
+  while (!heap.empty()) {
+    const Entry& first = entries[heap.front()];
+    bool release =
+        (max_extended_don - first.extended_don >
+         static_cast<int64_t>(don_parameters.sprop_max_don_diff)) ||
+        (don_parameters.sprop_depack_buf_nalus > 0 &&
+         heap.size() > don_parameters.sprop_depack_buf_nalus) ||
+        (don_parameters.sprop_depack_buf_bytes > 0 &&
+         buffered_bytes > don_parameters.sprop_depack_buf_bytes);
+    if (!release) {
+      break;
+    }
+    EmitFirst();
+  }
+}
+
+void H265RtpDeinterleaver::EmitFirst() noexcept {
+  std::pop_heap(heap.begin(), heap.end(),
+                [this](size_t a, size_t b) { return After(a, b); });
+  size_t index = heap.back();
+  heap.pop_back();
+  Entry& entry = entries[index];
+  buffered_bytes -= entry.data.size();
+  emitted = true;
+  last_emitted_don = entry.extended_don;
+
+  H265RtpDepacketizer::NalUnit nal_unit = entry.nal_unit;
+  nal_unit.data = entry.data.data();
+  nal_unit.length = entry.data.size();
+  stats.nal_units_emitted++;
+  if (callback != nullptr) {
+    callback(nal_unit, opaque);
+  }
+  free_entries.push_back(index);
+}
+
+void H265RtpDeinterleaver::Flush() noexcept {
+  while (!heap.empty()) {
+    EmitFirst();
+  }
+}
+
+void H265RtpDeinterleaver::Reset() noexcept {
+  free_entries.clear();
+  for (size_t i = 0; i < entries.size(); ++i) {
+    free_entries.push_back(i);
+  }
+  heap.clear();
+  buffered_bytes = 0;
+  started = false;
+  emitted = false;
+  arrival_counter = 0;
+}
+
+}  // namespace h265nal
@@ -0,0 +1,311 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_rtp_depacketizer.h"
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_common.h"
+
+namespace {
+// packets further behind are not late packets, but may be a sequence
+// number restart (rfc3550 Appendix A.1 MAX_MISORDER)
+constexpr int32_t kMaxMisorder = 100;
+// no candidate packet for a sequence number restart (not a 16-bit value)
+constexpr uint32_t kNoBadSequenceNumber = 0x10000;
+}  // namespace
+
+namespace h265nal {
+
+H265RtpDepacketizer::H265RtpDepacketizer(const Options& options_in,
+                                         Callback callback_in,
+                                         void* opaque_in)
+    : options(options_in), callback(callback_in), opaque(opaque_in) {
+  if (options.reorder_window == 0) {
+    options.reorder_window = 1;
+  }
+  slots.resize(options.reorder_window);
+}
+
+bool H265RtpDepacketizer::AddPacket(const uint8_t* data,
+                                    size_t length) noexcept {
+  RtpHeader header;
+  if (length > options.max_packet_size ||
+      !RtpHeader::Parse(data, length, &header) || header.payload_length < 2) {
+    stats.packets_invalid++;
+    return false;
+  }
+  stats.packets_received++;
+
+  if (!started) {
+    started = true;
+    next_sequence_number = header.sequence_number;
+    highest_sequence_number = header.sequence_number;
+  }
+
+  // distance from the next expected packet (rfc3550 16-bit wraparound)
+  int32_t diff =
+      static_cast<int16_t>(header.sequence_number - next_sequence_number);
+  if (diff < 0) {
+    if (diff >= -kMaxMisorder ||
+        header.sequence_number != bad_sequence_number) {
+      // already processed (or considered lost)
+      if (diff < -kMaxMisorder) {
+        bad_sequence_number =
+            static_cast<uint16_t>(header.sequence_number + 1);
+      }
+      stats.packets_dropped++;
+      return true;
+    }
+    // two sequential packets far behind: the sender restarted its sequence
+    // numbers (rfc3550 Appendix A.1), so resync on them
+    Flush();
+    SignalLoss();
+    stats.sequence_restarts++;
+    next_sequence_number = header.sequence_number;
+    highest_sequence_number = header.sequence_number;
+    bad_sequence_number = kNoBadSequenceNumber;
+    diff = 0;
+  }
+
+  // make room in the reorder window
+  const int32_t window = options.reorder_window;
+  while (diff >= window && num_buffered > 0) {
+    ProcessNext();
+    diff--;
+  }
+  if (diff >= window) {
+    // nothing buffered: jump directly
+    int32_t skipped = diff - window + 1;
+    stats.packets_lost += static_cast<uint64_t>(skipped);
+    SignalLoss();
+    next_sequence_number =
+        static_cast<uint16_t>(next_sequence_number + skipped);
+    next_slot = (next_slot + static_cast<size_t>(skipped)) % slots.size();
+    diff = window - 1;
+  }
+
+  Slot& slot = slots[(next_slot + static_cast<size_t>(diff)) % slots.size()];
+  if (slot.used) {
+    // duplicate
+    stats.packets_dropped++;
+    return true;
+  }
+  if (static_cast<int16_t>(header.sequence_number -
+                           highest_sequence_number) < 0) {
+    stats.packets_reordered++;
+  } else {
+    highest_sequence_number = header.sequence_number;
+  }
+
+  // the one copy: keep only the payload
+  slot.used = true;
+  slot.header = header;
+  // assign() never shrinks the capacity
+  size_t capacity = slot.packet.capacity();
+  slot.packet.assign(data + header.payload_offset,
+                     data + header.payload_offset + header.payload_length);
+  slots_capacity += slot.packet.capacity() - capacity;
+  num_buffered++;
+
+  // process all the in-order packets
+  while (slots[next_slot].used) {
+    ProcessNext();
+  }
+  return true;
+}
+
+void H265RtpDepacketizer::Flush() noexcept {
+  while (num_buffered > 0) {
+    ProcessNext();
+  }
+}
+
+void H265RtpDepacketizer::Reset() noexcept {
+  for (auto& slot : slots) {
+    slot.used = false;
+  }
+  started = false;
+  next_slot = 0;
+  bad_sequence_number = kNoBadSequenceNumber;
+  num_buffered = 0;
+  fu_active = false;
+  fu_buffer.clear();
+  loss_pending = false;
+}
+
+size_t H265RtpDepacketizer::GetMemoryUsage() const noexcept {
+  return slots.capacity() * sizeof(Slot) + slots_capacity +
+         fu_buffer.capacity();
+}
+
+void H265RtpDepacketizer::ProcessNext() noexcept {
+  Slot& slot = slots[next_slot];
+  if (slot.used) {
+    ProcessPayload(slot.header, slot.packet.data(), slot.packet.size());
+    slot.used = false;
+    num_buffered--;
+  } else {
+    stats.packets_lost++;
+    SignalLoss();
+  }
+  next_sequence_number++;
+  next_slot = (next_slot + 1) % slots.size();
+}
+
+void H265RtpDepacketizer::ProcessPayload(const RtpHeader& header,
+                                         uint8_t* payload,
+                                         size_t length) noexcept {
+  // payload header (rfc7798 Section 4.4): same format as a NAL unit header
+  uint32_t type = (payload[0] >> 1) & 0x3f;
+  if (type != NalUnitType::FU && fu_active) {
+    // FU without an end fragment
+    fu_active = false;
+    stats.nal_units_dropped++;
+  }
+
+  const bool don_present = options.don_parameters.DonPresent();
+  if (type < NalUnitType::AP) {
+    // single NAL unit packet
+    if (!don_present) {
+      Emit(header, payload, length, header.marker, 0);
+      return;
+    }
+    // payload header, DONL, NAL unit payload: move the payload header over
+    // the DONL to get a contiguous NAL unit
+    if (length < 4) {
+      stats.packets_invalid++;
+      return;
+    }
+    uint32_t donl = static_cast<uint32_t>((payload[2] << 8) | payload[3]);
+    payload[3] = payload[1];
+    payload[2] = payload[0];
+    Emit(header, payload + 2, length - 2, header.marker, donl);
+
+  } else if (type == NalUnitType::AP) {
+    // aggregation packet: ([DONL|DOND], 16-bit size, NAL unit)+
+    size_t offset = 2;
+    uint32_t don = 0;
+    bool first = true;
+    while (offset + 2 <= length) {
+      if (don_present) {
+        // DONL (first NAL unit) or DOND (next ones)
+        size_t don_size = first ? 2 : 1;
+        if (offset + don_size + 2 > length) {
+          stats.packets_invalid++;
+          return;
+        }
+        if (first) {
+          don = static_cast<uint32_t>((payload[offset] << 8) |
+                                      payload[offset + 1]);
+        } else {
+          don = (don + payload[offset] + 1) % 65536;
+        }
+        offset += don_size;
+      }
+      first = false;
+      size_t size = static_cast<size_t>((payload[offset] << 8) |
+                                        payload[offset + 1]);
+      offset += 2;
+      if (size < 2 || size > length - offset) {
+        stats.packets_invalid++;
+        return;
+      }
+      bool last = (offset + size + 2 > length);
+      Emit(header, payload + offset, size, last && header.marker, don);
+      offset += size;
+    }
+
+  } else if (type == NalUnitType::FU) {
+    ProcessFu(header, payload, length);
+
+  } else {
+    // PACI packets and reserved types are not supported
+    stats.packets_invalid++;
+  }
+}
+
+void H265RtpDepacketizer::ProcessFu(const RtpHeader& header,
+                                    const uint8_t* payload,
+                                    size_t length) noexcept {
+  // payload header (2 bytes) + FU header (1 byte) + DONL (2 bytes, first
+  // fragment only)
+  if (length < 3) {
+    stats.packets_invalid++;
+    return;
+  }
+  uint32_t s_bit = payload[2] >> 7;
+  uint32_t e_bit = (payload[2] >> 6) & 0x01;
+  uint32_t fu_type = payload[2] & 0x3f;
+  size_t offset = 3;
+  if (s_bit && options.don_parameters.DonPresent()) {
+    if (length < 5) {
+      stats.packets_invalid++;
+      return;
+    }
+    fu_don = static_cast<uint32_t>((payload[3] << 8) | payload[4]);
+    offset = 5;
+  }
+
+  if (s_bit) {
+    if (fu_active) {
+      // FU without an end fragment
+      stats.nal_units_dropped++;
+    }
+    // rebuild the NAL unit header from the payload header and FuType
+    fu_buffer.clear();
+    fu_buffer.push_back(
+        static_cast<uint8_t>((payload[0] & 0x81) | (fu_type << 1)));
+    fu_buffer.push_back(payload[1]);
+    fu_active = true;
+
+  } else if (!fu_active) {
+    // fragment of a NAL unit whose start was not received (or that was
+    // already dropped)
+    return;
+  }
+
+  if (fu_buffer.size() + (length - offset) > options.max_nal_unit_size) {
+    fu_active = false;
+    stats.nal_units_dropped++;
+    return;
+  }
+  fu_buffer.insert(fu_buffer.end(), payload + offset, payload + length);
+
+  if (e_bit) {
+    fu_active = false;
+    Emit(header, fu_buffer.data(), fu_buffer.size(), header.marker, fu_don);
+  }
+}
+
+void H265RtpDepacketizer::Emit(const RtpHeader& header, const uint8_t* data,
+                               size_t length, bool marker,
+                               uint32_t don) noexcept {
+  NalUnit nal_unit;
+  nal_unit.data = data;
+  nal_unit.length = length;
+  nal_unit.rtp_timestamp = header.timestamp;
+  nal_unit.sequence_number = header.sequence_number;
+  nal_unit.marker = marker;
+  nal_unit.after_loss = loss_pending;
+  nal_unit.don = don;
+  loss_pending = false;
+  stats.nal_units++;
+  if (callback != nullptr) {
+    callback(nal_unit, opaque);
+  }
+}
+
+void H265RtpDepacketizer::SignalLoss() noexcept {
+  if (fu_active) {
+    fu_active = false;
+    stats.nal_units_dropped++;
+  }
+  loss_pending = true;
+}
+
+}  // namespace h265nal
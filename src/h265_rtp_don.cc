@@ -0,0 +1,78 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_rtp_don.h"
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <cstring>
+
+namespace h265nal {
+
+namespace {
+// Parse a decimal value from [data, end). Returns false on an invalid or
+// out-of-range value.
+bool ParseValue(const char* data, const char* end, uint32_t* value) {
+  uint64_t result = 0;
+  if (data == end) {
+    return false;
+  }
+  for (; data < end; ++data) {
+    if (*data < '0' || *data > '9') {
+      return false;
+    }
+    result = result * 10 + static_cast<uint64_t>(*data - '0');
+    if (result > UINT32_MAX) {
+      return false;
+    }
+  }
+  *value = static_cast<uint32_t>(result);
+  return true;
+}
+}  // namespace
+
+bool RtpDonParameters::ParseFmtp(const char* fmtp,
+                                 RtpDonParameters* don_parameters) noexcept {
+  if (fmtp == nullptr || don_parameters == nullptr) {
+    return false;
+  }
+  const char* data = fmtp;
+  while (*data != '\0') {
+    // parameter := key "=" value, separated by ";"
+    while (*data == ' ' || *data == ';') {
+      data++;
+    }
+    const char* end = data;
+    while (*end != '\0' && *end != ';') {
+      end++;
+    }
+    const char* equal = data;
+    while (equal < end && *equal != '=') {
+      equal++;
+    }
+    size_t key_length = static_cast<size_t>(equal - data);
+    uint32_t* field = nullptr;
+    if (key_length == strlen("sprop-max-don-diff") &&
+        strncmp(data, "sprop-max-don-diff", key_length) == 0) {
+      field = &don_parameters->sprop_max_don_diff;
+    } else if (key_length == strlen("sprop-depack-buf-nalus") &&
+               strncmp(data, "sprop-depack-buf-nalus", key_length) == 0) {
+      field = &don_parameters->sprop_depack_buf_nalus;
+    } else if (key_length == strlen("sprop-depack-buf-bytes") &&
+               strncmp(data, "sprop-depack-buf-bytes", key_length) == 0) {
+      field = &don_parameters->sprop_depack_buf_bytes;
+    }
+    if (field != nullptr) {
+      if (equal == end || !ParseValue(equal + 1, end, field)) {
+        return false;
+      }
+    }
+    data = end;
+  }
+  // sprop-max-don-diff is in the range 0..32767
+  return don_parameters->sprop_max_don_diff <= 32767;
+}
+
+}  // namespace h265nal
@@ -24,14 +24,28 @@ namespace h265nal {
 std::unique_ptr<H265RtpFuParser::RtpFuState> H265RtpFuParser::ParseRtpFu(
     const uint8_t* data, size_t length,
     struct H265BitstreamParserState* bitstream_parser_state) noexcept {
+  return ParseRtpFu(data, length, bitstream_parser_state, RtpDonParameters());
+}
+
+std::unique_ptr<H265RtpFuParser::RtpFuState> H265RtpFuParser::ParseRtpFu(
+    const uint8_t* data, size_t length,
+    struct H265BitstreamParserState* bitstream_parser_state,
+    const RtpDonParameters& don_parameters) noexcept {
   std::vector<uint8_t> unpacked_buffer = UnescapeRbsp(data, length);
   BitBuffer bit_buffer(unpacked_buffer.data(), unpacked_buffer.size());
-  return ParseRtpFu(&bit_buffer, bitstream_parser_state);
+  return ParseRtpFu(&bit_buffer, bitstream_parser_state, don_parameters);
 }
 
 std::unique_ptr<H265RtpFuParser::RtpFuState> H265RtpFuParser::ParseRtpFu(
     BitBuffer* bit_buffer,
     struct H265BitstreamParserState* bitstream_parser_state) noexcept {
+  return ParseRtpFu(bit_buffer, bitstream_parser_state, RtpDonParameters());
+}
+
+std::unique_ptr<H265RtpFuParser::RtpFuState> H265RtpFuParser::ParseRtpFu(
+    BitBuffer* bit_buffer,
+    struct H265BitstreamParserState* bitstream_parser_state,
+    const RtpDonParameters& don_parameters) noexcept {
   // H265 RTP FU pseudo-NAL Unit.
   auto rtp_fu = std::make_unique<RtpFuState>();
 
@@ -57,6 +71,14 @@ std::unique_ptr<H265RtpFuParser::RtpFuState> H265RtpFuParser::ParseRtpFu(
     return rtp_fu;
   }
 
+  if (don_parameters.DonPresent()) {
+    // DONL
+    rtp_fu->don_present = true;
+    if (!bit_buffer->ReadBits(16, rtp_fu->donl)) {
+      return nullptr;
+    }
+  }
+
   // start of a fragmented NAL: keep reading
   rtp_fu->nal_unit_payload = H265NalUnitPayloadParser::ParseNalUnitPayload(
       bit_buffer, rtp_fu->fu_type, bitstream_parser_state);
@@ -85,6 +107,11 @@ void H265RtpFuParser::RtpFuState::fdump(FILE* outfp, int indent_level,
   fdump_indent_level(outfp, indent_level);
   fprintf(outfp, "fu_type: %i", fu_type);
 
+  if (s_bit == 1 && don_present) {
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "donl: %i", donl);
+  }
+
   if (s_bit == 1) {
     // start of a fragmented NAL: dump payload
     fdump_indent_level(outfp, indent_level);
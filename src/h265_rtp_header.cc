@@ -0,0 +1,68 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_rtp_header.h"
+
+#include <stdio.h>
+
+#include <cstdint>
+
+namespace h265nal {
+
+bool RtpHeader::Parse(const uint8_t* data, size_t length,
+                      RtpHeader* header) noexcept {
+  if (data == nullptr || header == nullptr || length < 12) {
+    return false;
+  }
+  header->version = data[0] >> 6;
+  if (header->version != 2) {
+    return false;
+  }
+  header->padding = (data[0] >> 5) & 0x01;
+  header->extension = (data[0] >> 4) & 0x01;
+  header->csrc_count = data[0] & 0x0f;
+  header->marker = data[1] >> 7;
+  header->payload_type = data[1] & 0x7f;
+  header->sequence_number = static_cast<uint16_t>((data[2] << 8) | data[3]);
+  header->timestamp = (static_cast<uint32_t>(data[4]) << 24) |
+                      (static_cast<uint32_t>(data[5]) << 16) |
+                      (static_cast<uint32_t>(data[6]) << 8) |
+                      static_cast<uint32_t>(data[7]);
+  header->ssrc = (static_cast<uint32_t>(data[8]) << 24) |
+                 (static_cast<uint32_t>(data[9]) << 16) |
+                 (static_cast<uint32_t>(data[10]) << 8) |
+                 static_cast<uint32_t>(data[11]);
+
+  // CSRC list
+  size_t offset = 12 + 4 * static_cast<size_t>(header->csrc_count);
+  if (offset > length) {
+    return false;
+  }
+  // header extension (rfc3550 Section 5.3.1)
+  if (header->extension) {
+    if (offset + 4 > length) {
+      return false;
+    }
+    size_t extension_length =
+        4 * static_cast<size_t>((data[offset + 2] << 8) | data[offset + 3]);
+    offset += 4 + extension_length;
+    if (offset > length) {
+      return false;
+    }
+  }
+  // padding: the last octet contains the padding count
+  size_t end = length;
+  if (header->padding) {
+    size_t padding_length = data[length - 1];
+    if (padding_length == 0 || padding_length > end - offset) {
+      return false;
+    }
+    end -= padding_length;
+  }
+  header->payload_offset = offset;
+  header->payload_length = end - offset;
+  return true;
+}
+
+}  // namespace h265nal
@@ -0,0 +1,188 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_rtp_packetizer.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "h265_common.h"
+
+namespace h265nal {
+
+namespace {
+// payload header (2 bytes)
+constexpr size_t kPayloadHeaderSize = 2;
+// FU header (1 byte)
+constexpr size_t kFuHeaderSize = 1;
+// AP NAL unit size field (2 bytes)
+constexpr size_t kApNalUnitSizeSize = 2;
+// maximum AP NAL unit size
+constexpr size_t kApMaxNalUnitSize = 0xffff;
+}  // namespace
+
+H265RtpPacketizer::H265RtpPacketizer(const Options& options_in)
+    : options(options_in) {}
+
+bool H265RtpPacketizer::Packetize(
+    const uint8_t* data,
+    const std::vector<H265BitstreamParser::NaluIndex>& nalu_indices) noexcept {
+  nal_unit_list.clear();
+  for (const auto& nalu_index : nalu_indices) {
+    nal_unit_list.push_back(
+        {data + nalu_index.payload_start_offset, nalu_index.payload_size});
+  }
+  return Packetize(nal_unit_list.data(), nal_unit_list.size());
+}
+
+bool H265RtpPacketizer::Packetize(const BufferSegment* nal_units,
+                                  size_t num_nal_units) noexcept {
+  packets.clear();
+  segments.clear();
+  pending.clear();
+  pending_length = 0;
+  header_length = 0;
+  const size_t max_payload_size = options.max_payload_size;
+  if (max_payload_size <= kPayloadHeaderSize + kFuHeaderSize) {
+    return false;
+  }
+
+  // reserve the worst-case header storage, so that the header pointers
+  // stay valid
+  const size_t max_fragment_size =
+      max_payload_size - kPayloadHeaderSize - kFuHeaderSize;
+  size_t max_header_length = 0;
+  for (size_t i = 0; i < num_nal_units; ++i) {
+    size_t length = nal_units[i].length;
+    if (nal_units[i].data == nullptr || length < kPayloadHeaderSize) {
+      return false;
+    }
+    if (length > max_payload_size) {
+      size_t num_fragments =
+          (length - kPayloadHeaderSize + max_fragment_size - 1) /
+          max_fragment_size;
+      max_header_length +=
+          num_fragments * (kPayloadHeaderSize + kFuHeaderSize);
+    } else {
+      max_header_length += kPayloadHeaderSize + kApNalUnitSizeSize;
+    }
+  }
+  if (header_buffer.size() < max_header_length) {
+    header_buffer.resize(max_header_length);
+  }
+
+  for (size_t i = 0; i < num_nal_units; ++i) {
+    const BufferSegment& nal_unit = nal_units[i];
+    if (nal_unit.length > max_payload_size) {
+      FlushAggregation();
+      AddFragments(nal_unit);
+      continue;
+    }
+    // AP size: payload header + (size + NAL unit)+
+    size_t ap_length = (pending.empty() ? kPayloadHeaderSize : pending_length) +
+                       kApNalUnitSizeSize + nal_unit.length;
+    if (!options.aggregate || ap_length > max_payload_size ||
+        nal_unit.length > kApMaxNalUnitSize) {
+      FlushAggregation();
+      ap_length = kPayloadHeaderSize + kApNalUnitSizeSize + nal_unit.length;
+    }
+    pending.push_back(nal_unit);
+    pending_length = ap_length;
+  }
+  FlushAggregation();
+
+  if (!packets.empty()) {
+    packets.back().marker = true;
+  }
+  return true;
+}
+
+void H265RtpPacketizer::FlushAggregation() noexcept {
+  if (pending.empty()) {
+    return;
+  }
+  if (pending.size() == 1) {
+    // single NAL unit packet: the NAL unit itself
+    StartPacket(kSingle);
+    AddSegment(pending[0].data, pending[0].length);
+
+  } else {
+    // aggregation packet (rfc7798 Section 4.4.2): the payload header uses
+    // the F bit OR, and the lowest LayerId and TID
+    uint32_t f_bit = 0;
+    uint32_t layer_id = 63;
+    uint32_t tid = 7;
+    for (const auto& nal_unit : pending) {
+      f_bit |= nal_unit.data[0] >> 7;
+      layer_id = std::min<uint32_t>(
+          layer_id, ((nal_unit.data[0] & 0x01) << 5) | (nal_unit.data[1] >> 3));
+      tid = std::min<uint32_t>(tid, nal_unit.data[1] & 0x07);
+    }
+    StartPacket(kAp);
+    uint8_t* header = AddHeader(kPayloadHeaderSize);
+    header[0] = static_cast<uint8_t>((f_bit << 7) | (NalUnitType::AP << 1) |
+                                     (layer_id >> 5));
+    header[1] = static_cast<uint8_t>(((layer_id & 0x1f) << 3) | tid);
+    AddSegment(header, kPayloadHeaderSize);
+    for (const auto& nal_unit : pending) {
+      uint8_t* size = AddHeader(kApNalUnitSizeSize);
+      size[0] = static_cast<uint8_t>(nal_unit.length >> 8);
+      size[1] = static_cast<uint8_t>(nal_unit.length & 0xff);
+      AddSegment(size, kApNalUnitSizeSize);
+      AddSegment(nal_unit.data, nal_unit.length);
+    }
+  }
+  pending.clear();
+  pending_length = 0;
+}
+
+void H265RtpPacketizer::AddFragments(const BufferSegment& nal_unit) noexcept {
+  // fragmentation units (rfc7798 Section 4.4.3)
+  const size_t max_fragment_size =
+      options.max_payload_size - kPayloadHeaderSize - kFuHeaderSize;
+  const uint8_t* data = nal_unit.data + kPayloadHeaderSize;
+  size_t remaining = nal_unit.length - kPayloadHeaderSize;
+  uint32_t fu_type = (nal_unit.data[0] >> 1) & 0x3f;
+  bool first = true;
+  while (remaining > 0) {
+    size_t fragment_size = std::min(remaining, max_fragment_size);
+    bool last = (fragment_size == remaining);
+    StartPacket(kFu);
+    uint8_t* header = AddHeader(kPayloadHeaderSize + kFuHeaderSize);
+    // payload header: the NAL unit header, with Type = 49
+    header[0] = static_cast<uint8_t>((nal_unit.data[0] & 0x81) |
+                                     (NalUnitType::FU << 1));
+    header[1] = nal_unit.data[1];
+    // FU header: S, E, FuType
+    header[2] = static_cast<uint8_t>((first ? 0x80 : 0x00) |
+                                     (last ? 0x40 : 0x00) | fu_type);
+    AddSegment(header, kPayloadHeaderSize + kFuHeaderSize);
+    AddSegment(data, fragment_size);
+    data += fragment_size;
+    remaining -= fragment_size;
+    first = false;
+  }
+}
+
+uint8_t* H265RtpPacketizer::AddHeader(size_t length) noexcept {
+  uint8_t* header = header_buffer.data() + header_length;
+  header_length += length;
+  return header;
+}
+
+void H265RtpPacketizer::AddSegment(const uint8_t* data,
+                                   size_t length) noexcept {
+  segments.push_back({data, length});
+  packets.back().num_segments++;
+  packets.back().length += length;
+}
+
+void H265RtpPacketizer::StartPacket(PacketType type) noexcept {
+  packets.push_back({type, segments.size(), 0, 0, false});
+}
+
+}  // namespace h265nal
@@ -11,7 +11,9 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_error.h"
 #include "h265_nal_unit_parser.h"
+#include "h265_parser_context.h"
 
 namespace h265nal {
 
@@ -23,14 +25,79 @@ namespace h265nal {
 std::unique_ptr<H265RtpParser::RtpState> H265RtpParser::ParseRtp(
     const uint8_t* data, size_t length,
     struct H265BitstreamParserState* bitstream_parser_state) noexcept {
-  std::vector<uint8_t> unpacked_buffer = UnescapeRbsp(data, length);
-  BitBuffer bit_buffer(unpacked_buffer.data(), unpacked_buffer.size());
+  return ParseRtp(data, length, bitstream_parser_state, RtpDonParameters(),
+                  nullptr);
+}
+
+std::unique_ptr<H265RtpParser::RtpState> H265RtpParser::ParseRtp(
+    const uint8_t* data, size_t length,
+    struct H265BitstreamParserState* bitstream_parser_state,
+    H265ParserContext* context) noexcept {
+  return ParseRtp(data, length, bitstream_parser_state, RtpDonParameters(),
+                  context);
+}
+
+// Unpack RBSP and parse RTP NAL Unit state from the supplied segment list.
+std::unique_ptr<H265RtpParser::RtpState> H265RtpParser::ParseRtp(
+    const BufferSegment* segments, size_t num_segments,
+    struct H265BitstreamParserState* bitstream_parser_state) noexcept {
+  return ParseRtp(segments, num_segments, bitstream_parser_state, nullptr);
+}
+
+std::unique_ptr<H265RtpParser::RtpState> H265RtpParser::ParseRtp(
+    const BufferSegment* segments, size_t num_segments,
+    struct H265BitstreamParserState* bitstream_parser_state,
+    H265ParserContext* context) noexcept {
+  H265ParserContext::Scope context_scope(context);
+  std::vector<uint8_t> local_buffer;
+  std::vector<uint8_t>* unpacked_buffer =
+      (context != nullptr) ? context->GetUnescapeBuffer() : &local_buffer;
+  UnescapeRbsp(segments, num_segments, unpacked_buffer);
+  BitBuffer bit_buffer(unpacked_buffer->data(), unpacked_buffer->size());
   return ParseRtp(&bit_buffer, bitstream_parser_state);
 }
 
+std::unique_ptr<H265RtpParser::RtpState> H265RtpParser::ParseRtp(
+    const uint8_t* data, size_t length,
+    struct H265BitstreamParserState* bitstream_parser_state,
+    const RtpDonParameters& don_parameters) noexcept {
+  return ParseRtp(data, length, bitstream_parser_state, don_parameters,
+                  nullptr);
+}
+
+std::unique_ptr<H265RtpParser::RtpState> H265RtpParser::ParseRtp(
+    const uint8_t* data, size_t length,
+    struct H265BitstreamParserState* bitstream_parser_state,
+    const RtpDonParameters& don_parameters,
+    H265ParserContext* context) noexcept {
+  H265ParserContext::Scope context_scope(context);
+  std::vector<uint8_t> local_buffer;
+  std::vector<uint8_t>* unpacked_buffer =
+      (context != nullptr) ? context->GetUnescapeBuffer() : &local_buffer;
+  UnescapeRbsp(data, length, unpacked_buffer);
+  BitBuffer bit_buffer(unpacked_buffer->data(), unpacked_buffer->size());
+  return ParseRtp(&bit_buffer, bitstream_parser_state, don_parameters);
+}
+
+std::unique_ptr<H265RtpParser::RtpState> H265RtpParser::ParseRtp(
+    BitBuffer* bit_buffer,
+    struct H265BitstreamParserState* bitstream_parser_state,
+    const RtpDonParameters& don_parameters,
+    H265ParserContext* context) noexcept {
+  H265ParserContext::Scope context_scope(context);
+  return ParseRtp(bit_buffer, bitstream_parser_state, don_parameters);
+}
+
 std::unique_ptr<H265RtpParser::RtpState> H265RtpParser::ParseRtp(
     BitBuffer* bit_buffer,
     struct H265BitstreamParserState* bitstream_parser_state) noexcept {
+  return ParseRtp(bit_buffer, bitstream_parser_state, RtpDonParameters());
+}
+
+std::unique_ptr<H265RtpParser::RtpState> H265RtpParser::ParseRtp(
+    BitBuffer* bit_buffer,
+    struct H265BitstreamParserState* bitstream_parser_state,
+    const RtpDonParameters& don_parameters) noexcept {
   // H265 RTP NAL Unit pseudo-NAL Unit.
   auto rtp = std::make_unique<RtpState>();
 
@@ -38,33 +105,32 @@ std::unique_ptr<H265RtpParser::RtpState> H265RtpParser::ParseRtp(
   rtp->nal_unit_header =
       H265NalUnitHeaderParser::ParseNalUnitHeader(bit_buffer);
   if (rtp->nal_unit_header == nullptr) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "error: cannot ParseNalUnitHeader in rtp packet\n");
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_ParseFailed, "rtp",
+                              "nal_unit_header", bit_buffer);
     return nullptr;
   }
   bit_buffer->Seek(0, 0);
 
   if (rtp->nal_unit_header->nal_unit_type <= 47) {
     // rtp_single()
-    rtp->rtp_single =
-        H265RtpSingleParser::ParseRtpSingle(bit_buffer, bitstream_parser_state);
+    rtp->rtp_single = H265RtpSingleParser::ParseRtpSingle(
+        bit_buffer, bitstream_parser_state, don_parameters);
     if (rtp->rtp_single == nullptr) {
       return nullptr;
     }
 
   } else if (rtp->nal_unit_header->nal_unit_type == AP) {
     // rtp_ap()
-    rtp->rtp_ap =
-        H265RtpApParser::ParseRtpAp(bit_buffer, bitstream_parser_state);
+    rtp->rtp_ap = H265RtpApParser::ParseRtpAp(
+        bit_buffer, bitstream_parser_state, don_parameters);
     if (rtp->rtp_ap == nullptr) {
       return nullptr;
     }
 
   } else if (rtp->nal_unit_header->nal_unit_type == FU) {
     // rtp_fu()
-    rtp->rtp_fu =
-        H265RtpFuParser::ParseRtpFu(bit_buffer, bitstream_parser_state);
+    rtp->rtp_fu = H265RtpFuParser::ParseRtpFu(
+        bit_buffer, bitstream_parser_state, don_parameters);
     if (rtp->rtp_fu == nullptr) {
       return nullptr;
     }
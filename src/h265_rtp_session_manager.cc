@@ -0,0 +1,377 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_rtp_session_manager.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_nal_unit_parser.h"
+#include "h265_parser_context.h"
+#include "h265_rtp_depacketizer.h"
+#include "h265_utils.h"
+
+namespace {
+// Get the SSRC of an RTP packet.
+bool GetSsrc(const uint8_t* data, size_t length, uint32_t* ssrc) {
+  if (data == nullptr || length < 12 || (data[0] >> 6) != 2) {
+    return false;
+  }
+  *ssrc = (static_cast<uint32_t>(data[8]) << 24) |
+          (static_cast<uint32_t>(data[9]) << 16) |
+          (static_cast<uint32_t>(data[10]) << 8) |
+          static_cast<uint32_t>(data[11]);
+  return true;
+}
+
+// Get the share of a limit for shard `index` (0 means unlimited). The
+// shares add up to the limit, but are at least 1.
+size_t GetShardLimit(size_t limit, size_t index, size_t num_shards) {
+  if (limit == 0) {
+    return 0;
+  }
+  size_t share = limit / num_shards + ((index < limit % num_shards) ? 1 : 0);
+  return std::max<size_t>(share, 1);
+}
+}  // namespace
+
+namespace h265nal {
+
+struct H265RtpSessionManager::Session {
+  Session(H265RtpSessionManager* manager_in, uint32_t ssrc_in)
+      : manager(manager_in),
+        ssrc(ssrc_in),
+        depacketizer(std::make_unique<H265RtpDepacketizer>(
+            manager_in->options.depacketizer_options, OnNalUnit, this)) {}
+
+  static void OnNalUnit(const H265RtpDepacketizer::NalUnit& nal_unit,
+                        void* opaque);
+  size_t GetMemoryUsage() const;
+
+  H265RtpSessionManager* manager;
+  uint32_t ssrc;
+  H265BitstreamParserState bitstream_parser_state;
+  H265ParserContext context;
+  std::unique_ptr<H265RtpDepacketizer> depacketizer;
+
+  uint64_t packets = 0;
+  uint64_t nal_units = 0;
+  int64_t last_seen_ms = 0;
+  size_t memory_bytes = 0;
+  // shard LRU list links (towards the most and the least recently used)
+  Session* lru_prev = nullptr;
+  Session* lru_next = nullptr;
+
+  // POC tracking
+  H265PocCalculator poc_calculator;
+};
+
+struct H265RtpSessionManager::Shard {
+  std::mutex mutex;
+  std::unordered_map<uint32_t, std::unique_ptr<Session>> sessions;
+  // share of the `max_sessions` and `max_total_bytes` limits
+  size_t max_sessions = 0;
+  size_t max_bytes = 0;
+  size_t memory_bytes = 0;
+  // intrusive LRU list of the sessions, from the most recently used one
+  Session* lru_head = nullptr;
+  Session* lru_tail = nullptr;
+
+  void LruUnlink(Session* session) {
+    (session->lru_prev ? session->lru_prev->lru_next : lru_head) =
+        session->lru_next;
+    (session->lru_next ? session->lru_next->lru_prev : lru_tail) =
+        session->lru_prev;
+    session->lru_prev = nullptr;
+    session->lru_next = nullptr;
+  }
+  void LruPushFront(Session* session) {
+    session->lru_next = lru_head;
+    (lru_head ? lru_head->lru_prev : lru_tail) = session;
+    lru_head = session;
+  }
+};
+
+void H265RtpSessionManager::Session::OnNalUnit(
+    const H265RtpDepacketizer::NalUnit& nal_unit, void* opaque) {
+  auto* session = static_cast<Session*>(opaque);
+  H265RtpSessionManager* manager = session->manager;
+  session->nal_units++;
+  std::unique_ptr<H265NalUnitParser::NalUnitState> nal_unit_state;
+  if (manager->options.parse_nal_units) {
+    nal_unit_state = H265NalUnitParser::ParseNalUnit(
+        nal_unit.data, nal_unit.length, &session->bitstream_parser_state,
+        manager->options.parsing_options, &session->context);
+    if (nal_unit_state != nullptr) {
+      session->poc_calculator.Update(*nal_unit_state);
+    }
+  }
+  if (manager->callback != nullptr) {
+    manager->callback(session->ssrc, nal_unit, nal_unit_state.get(),
+                      manager->opaque);
+  }
+  session->context.Recycle(std::move(nal_unit_state));
+}
+
+size_t H265RtpSessionManager::Session::GetMemoryUsage() const {
+  // the parameter sets are counted by their state size only (not the heap
+  // memory they own): this is a lower bound
+  return sizeof(Session) + depacketizer->GetMemoryUsage() +
+         bitstream_parser_state.vps.size() * sizeof(H265VpsParser::VpsState) +
+         bitstream_parser_state.sps.size() * sizeof(H265SpsParser::SpsState) +
+         bitstream_parser_state.pps.size() * sizeof(H265PpsParser::PpsState);
+}
+
+H265RtpSessionManager::H265RtpSessionManager(const Options& options_in,
+                                             Callback callback_in,
+                                             void* opaque_in)
+    : options(options_in),
+      callback(callback_in),
+      opaque(opaque_in),
+      num_sessions(0),
+      total_bytes(0),
+      packets(0),
+      packets_rejected(0),
+      sessions_created(0),
+      sessions_evicted_idle(0),
+      sessions_evicted_memory(0),
+      sessions_evicted_count(0),
+      session_resets(0) {
+  if (options.num_shards == 0) {
+    options.num_shards = 1;
+  }
+  // every shard must be able to hold a session
+  if (options.max_sessions > 0 && options.num_shards > options.max_sessions) {
+    options.num_shards = options.max_sessions;
+  }
+  for (size_t i = 0; i < options.num_shards; ++i) {
+    shards.push_back(std::make_unique<Shard>());
+    shards.back()->max_sessions =
+        GetShardLimit(options.max_sessions, i, options.num_shards);
+    shards.back()->max_bytes =
+        GetShardLimit(options.max_total_bytes, i, options.num_shards);
+  }
+}
+
+H265RtpSessionManager::~H265RtpSessionManager() = default;
+
+size_t H265RtpSessionManager::GetShardIndex(uint32_t ssrc) const noexcept {
+  // SSRCs are random, but mix them anyway (Fibonacci hashing)
+  uint32_t hash = ssrc * 2654435761u;
+  return (hash >> 16) % options.num_shards;
+}
+
+void H265RtpSessionManager::ProcessPackets(const BufferSegment* packets_in,
+                                           size_t num_packets,
+                                           int64_t now_ms) noexcept {
+  // group the packets by shard (keeping the arrival order in each shard)
+  thread_local std::vector<std::pair<size_t, size_t>> routes;
+  routes.clear();
+  for (size_t i = 0; i < num_packets; ++i) {
+    uint32_t ssrc;
+    if (!GetSsrc(packets_in[i].data, packets_in[i].length, &ssrc)) {
+      packets++;
+      packets_rejected++;
+      continue;
+    }
+    routes.emplace_back(GetShardIndex(ssrc), i);
+  }
+  std::sort(routes.begin(), routes.end());
+
+  size_t i = 0;
+  while (i < routes.size()) {
+    Shard* shard = shards[routes[i].first].get();
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    for (; i < routes.size() && shards[routes[i].first].get() == shard; ++i) {
+      const BufferSegment& packet = packets_in[routes[i].second];
+      uint32_t ssrc = 0;
+      GetSsrc(packet.data, packet.length, &ssrc);
+      ProcessPacketLocked(shard, ssrc, packet.data, packet.length, now_ms);
+    }
+  }
+}
+
+bool H265RtpSessionManager::ProcessPacket(const uint8_t* data, size_t length,
+                                          int64_t now_ms) noexcept {
+  uint32_t ssrc;
+  if (!GetSsrc(data, length, &ssrc)) {
+    packets++;
+    packets_rejected++;
+    return false;
+  }
+  Shard* shard = shards[GetShardIndex(ssrc)].get();
+  std::lock_guard<std::mutex> lock(shard->mutex);
+  return ProcessPacketLocked(shard, ssrc, data, length, now_ms);
+}
+
+bool H265RtpSessionManager::ProcessPacketLocked(Shard* shard, uint32_t ssrc,
+                                                const uint8_t* data,
+                                                size_t length,
+                                                int64_t now_ms) noexcept {
+  packets++;
+  Session* session;
+  auto it = shard->sessions.find(ssrc);
+  if (it != shard->sessions.end()) {
+    session = it->second.get();
+    shard->LruUnlink(session);
+  } else {
+    // new session
+    if (shard->max_sessions > 0 &&
+        shard->sessions.size() >= shard->max_sessions) {
+      if (!EvictLruLocked(shard, ssrc)) {
+        packets_rejected++;
+        return false;
+      }
+      sessions_evicted_count++;
+    }
+    auto new_session = std::make_unique<Session>(this, ssrc);
+    session = new_session.get();
+    shard->sessions[ssrc] = std::move(new_session);
+    num_sessions++;
+    sessions_created++;
+  }
+  shard->LruPushFront(session);
+
+  session->last_seen_ms = now_ms;
+  session->packets++;
+  bool valid = session->depacketizer->AddPacket(data, length);
+  if (!valid) {
+    packets_rejected++;
+  }
+
+  // memory caps
+  UpdateMemoryLocked(shard, session);
+  if (options.max_session_bytes > 0 &&
+      session->memory_bytes > options.max_session_bytes) {
+    // drop the depacketization state (and its buffers)
+    session->depacketizer = std::make_unique<H265RtpDepacketizer>(
+        options.depacketizer_options, Session::OnNalUnit, session);
+    session_resets++;
+    UpdateMemoryLocked(shard, session);
+  }
+  while (shard->max_bytes > 0 && shard->memory_bytes > shard->max_bytes &&
+         EvictLruLocked(shard, ssrc)) {
+    sessions_evicted_memory++;
+  }
+  return valid;
+}
+
+void H265RtpSessionManager::UpdateMemoryLocked(Shard* shard,
+                                               Session* session) noexcept {
+  size_t memory_bytes = session->GetMemoryUsage();
+  if (memory_bytes >= session->memory_bytes) {
+    total_bytes += memory_bytes - session->memory_bytes;
+  } else {
+    total_bytes -= session->memory_bytes - memory_bytes;
+  }
+  shard->memory_bytes -= session->memory_bytes;
+  shard->memory_bytes += memory_bytes;
+  session->memory_bytes = memory_bytes;
+}
+
+void H265RtpSessionManager::EvictLocked(Shard* shard, uint32_t ssrc) noexcept {
+  auto it = shard->sessions.find(ssrc);
+  if (it == shard->sessions.end()) {
+    return;
+  }
+  it->second->depacketizer->Flush();
+  total_bytes -= it->second->memory_bytes;
+  shard->memory_bytes -= it->second->memory_bytes;
+  shard->LruUnlink(it->second.get());
+  shard->sessions.erase(it);
+  num_sessions--;
+}
+
+bool H265RtpSessionManager::EvictLruLocked(Shard* shard,
+                                           uint32_t keep_ssrc) noexcept {
+  Session* lru = shard->lru_tail;
+  if (lru != nullptr && lru->ssrc == keep_ssrc) {
+    lru = lru->lru_prev;
+  }
+  if (lru == nullptr) {
+    return false;
+  }
+  EvictLocked(shard, lru->ssrc);
+  return true;
+}
+
+size_t H265RtpSessionManager::EvictIdleSessions(int64_t now_ms) noexcept {
+  if (options.idle_timeout_ms <= 0) {
+    return 0;
+  }
+  size_t num_evicted = 0;
+  std::vector<uint32_t> idle_ssrcs;
+  for (auto& shard : shards) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    idle_ssrcs.clear();
+    for (const auto& it : shard->sessions) {
+      if (now_ms - it.second->last_seen_ms > options.idle_timeout_ms) {
+        idle_ssrcs.push_back(it.first);
+      }
+    }
+    for (uint32_t ssrc : idle_ssrcs) {
+      EvictLocked(shard.get(), ssrc);
+    }
+    num_evicted += idle_ssrcs.size();
+  }
+  sessions_evicted_idle += num_evicted;
+  return num_evicted;
+}
+
+bool H265RtpSessionManager::RemoveSession(uint32_t ssrc) noexcept {
+  Shard* shard = shards[GetShardIndex(ssrc)].get();
+  std::lock_guard<std::mutex> lock(shard->mutex);
+  if (shard->sessions.find(ssrc) == shard->sessions.end()) {
+    return false;
+  }
+  EvictLocked(shard, ssrc);
+  return true;
+}
+
+bool H265RtpSessionManager::GetSessionStats(
+    uint32_t ssrc, SessionStats* session_stats) const noexcept {
+  Shard* shard = shards[GetShardIndex(ssrc)].get();
+  std::lock_guard<std::mutex> lock(shard->mutex);
+  auto it = shard->sessions.find(ssrc);
+  if (it == shard->sessions.end()) {
+    return false;
+  }
+  const Session* session = it->second.get();
+  session_stats->packets = session->packets;
+  session_stats->nal_units = session->nal_units;
+  session_stats->last_seen_ms = session->last_seen_ms;
+  session_stats->has_poc = session->poc_calculator.HasPoc();
+  session_stats->last_poc = session->poc_calculator.GetPoc();
+  session_stats->memory_bytes = session->memory_bytes;
+  session_stats->num_vps = session->bitstream_parser_state.vps.size();
+  session_stats->num_sps = session->bitstream_parser_state.sps.size();
+  session_stats->num_pps = session->bitstream_parser_state.pps.size();
+  session_stats->depacketizer = session->depacketizer->GetStats();
+  return true;
+}
+
+H265RtpSessionManager::Stats H265RtpSessionManager::GetStats() const
+    noexcept {
+  Stats stats;
+  stats.packets = packets.load();
+  stats.packets_rejected = packets_rejected.load();
+  stats.sessions_created = sessions_created.load();
+  stats.sessions_evicted_idle = sessions_evicted_idle.load();
+  stats.sessions_evicted_memory = sessions_evicted_memory.load();
+  stats.sessions_evicted_count = sessions_evicted_count.load();
+  stats.session_resets = session_resets.load();
+  return stats;
+}
+
+}  // namespace h265nal
@@ -11,6 +11,7 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_error.h"
 #include "h265_nal_unit_parser.h"
 
 namespace h265nal {
@@ -24,15 +25,33 @@ std::unique_ptr<H265RtpSingleParser::RtpSingleState>
 H265RtpSingleParser::ParseRtpSingle(
     const uint8_t* data, size_t length,
     struct H265BitstreamParserState* bitstream_parser_state) noexcept {
+  return ParseRtpSingle(data, length, bitstream_parser_state,
+                        RtpDonParameters());
+}
+
+std::unique_ptr<H265RtpSingleParser::RtpSingleState>
+H265RtpSingleParser::ParseRtpSingle(
+    const uint8_t* data, size_t length,
+    struct H265BitstreamParserState* bitstream_parser_state,
+    const RtpDonParameters& don_parameters) noexcept {
   std::vector<uint8_t> unpacked_buffer = UnescapeRbsp(data, length);
   BitBuffer bit_buffer(unpacked_buffer.data(), unpacked_buffer.size());
-  return ParseRtpSingle(&bit_buffer, bitstream_parser_state);
+  return ParseRtpSingle(&bit_buffer, bitstream_parser_state, don_parameters);
 }
 
 std::unique_ptr<H265RtpSingleParser::RtpSingleState>
 H265RtpSingleParser::ParseRtpSingle(
     BitBuffer* bit_buffer,
     struct H265BitstreamParserState* bitstream_parser_state) noexcept {
+  return ParseRtpSingle(bit_buffer, bitstream_parser_state,
+                        RtpDonParameters());
+}
+
+std::unique_ptr<H265RtpSingleParser::RtpSingleState>
+H265RtpSingleParser::ParseRtpSingle(
+    BitBuffer* bit_buffer,
+    struct H265BitstreamParserState* bitstream_parser_state,
+    const RtpDonParameters& don_parameters) noexcept {
   // H265 RTP Single NAL Unit pseudo-NAL Unit.
   auto rtp_single = std::make_unique<RtpSingleState>();
 
@@ -40,12 +59,21 @@ H265RtpSingleParser::ParseRtpSingle(
   rtp_single->nal_unit_header =
       H265NalUnitHeaderParser::ParseNalUnitHeader(bit_buffer);
   if (rtp_single->nal_unit_header == nullptr) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "error: cannot ParseNalUnitHeader in rtp single\n");
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_ParseFailed, "rtp_single",
+                              "nal_unit_header", bit_buffer);
     return nullptr;
   }
 
+  if (don_parameters.DonPresent()) {
+    // DONL
+    rtp_single->don_present = true;
+    if (!bit_buffer->ReadBits(16, rtp_single->donl)) {
+      H265ErrorReporter::Report(H265ErrorCode_Truncated, "rtp_single", "donl",
+                                bit_buffer);
+      return nullptr;
+    }
+  }
+
   // nal_unit_payload()
   rtp_single->nal_unit_payload = H265NalUnitPayloadParser::ParseNalUnitPayload(
       bit_buffer, rtp_single->nal_unit_header->nal_unit_type,
@@ -67,6 +95,11 @@ void H265RtpSingleParser::RtpSingleState::fdump(
   fdump_indent_level(outfp, indent_level);
   nal_unit_header->fdump(outfp, indent_level);
 
+  if (don_present) {
+    fdump_indent_level(outfp, indent_level);
+    fprintf(outfp, "donl: %i", donl);
+  }
+
   // payload
   fdump_indent_level(outfp, indent_level);
   nal_unit_payload->fdump(outfp, indent_level, nal_unit_header->nal_unit_type,
@@ -0,0 +1,174 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_sample_converter.h"
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+
+namespace {
+const uint8_t kStartCode[] = {0x00, 0x00, 0x00, 0x01};
+
+bool IsValidLengthSize(size_t length_size) {
+  return length_size >= 1 && length_size <= 4;
+}
+
+// Largest NAL unit that fits in a length field.
+size_t GetMaxNalUnitLength(size_t length_size) {
+  return (length_size >= sizeof(size_t))
+             ? static_cast<size_t>(-1)
+             : (static_cast<size_t>(1) << (8 * length_size)) - 1;
+}
+
+void WriteLengthField(uint8_t* p, size_t length_size, size_t value) {
+  for (size_t i = 0; i < length_size; i++) {
+    p[i] = static_cast<uint8_t>(value >> (8 * (length_size - 1 - i)));
+  }
+}
+
+size_t ReadLengthField(const uint8_t* p, size_t length_size) {
+  size_t value = 0;
+  for (size_t i = 0; i < length_size; i++) {
+    value = (value << 8) | p[i];
+  }
+  return value;
+}
+
+// Get the NAL units of an Annex B sample, without the trailing_zero_8bits.
+std::vector<h265nal::H265BitstreamParser::NaluIndex> FindNalUnits(
+    const uint8_t* data, size_t length) {
+  auto nalu_indices =
+      h265nal::H265BitstreamParser::FindNaluIndices(data, length);
+  for (auto& nalu_index : nalu_indices) {
+    while (nalu_index.payload_size > 0 &&
+           data[nalu_index.payload_start_offset + nalu_index.payload_size -
+                1] == 0) {
+      nalu_index.payload_size--;
+    }
+  }
+  return nalu_indices;
+}
+}  // namespace
+
+namespace h265nal {
+
+bool H265SampleConverter::AnnexBToLengthPrefixed(
+    const uint8_t* data, size_t length, size_t length_size,
+    std::vector<uint8_t>* length_fields,
+    std::vector<BufferSegment>* segments) noexcept {
+  if (data == nullptr || !IsValidLengthSize(length_size) ||
+      length_fields == nullptr || segments == nullptr) {
+    return false;
+  }
+  auto nalu_indices = FindNalUnits(data, length);
+  size_t max_nal_unit_length = GetMaxNalUnitLength(length_size);
+  for (const auto& nalu_index : nalu_indices) {
+    if (nalu_index.payload_size > max_nal_unit_length) {
+      return false;
+    }
+  }
+  // size the length field buffer first: the segments point into it
+  length_fields->resize(nalu_indices.size() * length_size);
+  segments->clear();
+  for (size_t i = 0; i < nalu_indices.size(); i++) {
+    uint8_t* length_field = length_fields->data() + i * length_size;
+    WriteLengthField(length_field, length_size, nalu_indices[i].payload_size);
+    segments->push_back({length_field, length_size});
+    segments->push_back({data + nalu_indices[i].payload_start_offset,
+                         nalu_indices[i].payload_size});
+  }
+  return true;
+}
+
+bool H265SampleConverter::AnnexBToLengthPrefixedInPlace(
+    uint8_t* data, size_t* length, size_t length_size) noexcept {
+  if (data == nullptr || length == nullptr ||
+      !IsValidLengthSize(length_size)) {
+    return false;
+  }
+  auto nalu_indices = FindNalUnits(data, *length);
+  // check the output never overtakes the input (NAL units only move
+  // towards the start of the buffer)
+  size_t max_nal_unit_length = GetMaxNalUnitLength(length_size);
+  size_t out_offset = 0;
+  for (const auto& nalu_index : nalu_indices) {
+    if (nalu_index.payload_size > max_nal_unit_length ||
+        out_offset + length_size > nalu_index.payload_start_offset) {
+      return false;
+    }
+    out_offset += length_size + nalu_index.payload_size;
+  }
+  out_offset = 0;
+  for (const auto& nalu_index : nalu_indices) {
+    WriteLengthField(data + out_offset, length_size, nalu_index.payload_size);
+    out_offset += length_size;
+    memmove(data + out_offset, data + nalu_index.payload_start_offset,
+            nalu_index.payload_size);
+    out_offset += nalu_index.payload_size;
+  }
+  *length = out_offset;
+  return true;
+}
+
+bool H265SampleConverter::LengthPrefixedToAnnexB(
+    const uint8_t* data, size_t length, size_t length_size,
+    std::vector<BufferSegment>* segments) noexcept {
+  if (data == nullptr || !IsValidLengthSize(length_size) ||
+      segments == nullptr) {
+    return false;
+  }
+  segments->clear();
+  size_t offset = 0;
+  while (offset < length) {
+    if (length_size > length - offset) {
+      return false;
+    }
+    size_t nal_unit_length = ReadLengthField(data + offset, length_size);
+    offset += length_size;
+    if (nal_unit_length > length - offset) {
+      return false;
+    }
+    if (nal_unit_length > 0) {
+      segments->push_back({kStartCode, sizeof(kStartCode)});
+      segments->push_back({data + offset, nal_unit_length});
+    }
+    offset += nal_unit_length;
+  }
+  return true;
+}
+
+bool H265SampleConverter::LengthPrefixedToAnnexBInPlace(
+    uint8_t* data, size_t length, size_t length_size) noexcept {
+  if (data == nullptr || length_size != sizeof(kStartCode)) {
+    return false;
+  }
+  // validate the whole sample before touching it
+  size_t offset = 0;
+  while (offset < length) {
+    if (length_size > length - offset) {
+      return false;
+    }
+    size_t nal_unit_length = ReadLengthField(data + offset, length_size);
+    offset += length_size;
+    if (nal_unit_length > length - offset) {
+      return false;
+    }
+    offset += nal_unit_length;
+  }
+  offset = 0;
+  while (offset < length) {
+    size_t nal_unit_length = ReadLengthField(data + offset, length_size);
+    memcpy(data + offset, kStartCode, sizeof(kStartCode));
+    offset += length_size + nal_unit_length;
+  }
+  return true;
+}
+
+}  // namespace h265nal
@@ -13,6 +13,7 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_trace.h"
 
 namespace h265nal {
 
@@ -62,6 +63,10 @@ H265ScalingListDataParser::ParseScalingListData(
                      ->scaling_list_pred_mode_flag[sizeId][matrixId])) {
         return nullptr;
       }
+      H265Trace::u(
+          bit_buffer, "scaling_list_pred_mode_flag", 1,
+          scaling_list_data->scaling_list_pred_mode_flag[sizeId][matrixId],
+          sizeId, matrixId);
 
       if (!scaling_list_data->scaling_list_pred_mode_flag[sizeId][matrixId]) {
         // scaling_list_pred_matrix_id_delta[sizeId][matrixId]  ue(v)
@@ -70,6 +75,10 @@ H265ScalingListDataParser::ParseScalingListData(
                     ->scaling_list_pred_matrix_id_delta[sizeId][matrixId])) {
           return nullptr;
         }
+        H265Trace::ue(bit_buffer, "scaling_list_pred_matrix_id_delta",
+                      scaling_list_data
+                          ->scaling_list_pred_matrix_id_delta[sizeId][matrixId],
+                      sizeId, matrixId);
 
       } else {
         uint32_t nextCoef = 8;
@@ -82,6 +91,11 @@ H265ScalingListDataParser::ParseScalingListData(
                       ->scaling_list_dc_coef_minus8[sizeId - 2][matrixId])) {
             return nullptr;
           }
+          H265Trace::se(
+              bit_buffer, "scaling_list_dc_coef_minus8",
+              scaling_list_data
+                  ->scaling_list_dc_coef_minus8[sizeId - 2][matrixId],
+              sizeId - 2, matrixId);
           nextCoef = static_cast<uint32_t>(
               scaling_list_data
                   ->scaling_list_dc_coef_minus8[sizeId - 2][matrixId] +
@@ -94,6 +108,8 @@ H265ScalingListDataParser::ParseScalingListData(
                   scaling_list_delta_coef)) {
             return nullptr;
           }
+          H265Trace::se(bit_buffer, "scaling_list_delta_coef",
+                        scaling_list_delta_coef, i);
           nextCoef = static_cast<uint32_t>(static_cast<int32_t>(nextCoef) +
                                            scaling_list_delta_coef + 256) %
                      256;
@@ -0,0 +1,314 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_segmenter.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_configuration_box_writer.h"
+#include "h265_pps_parser.h"
+#include "h265_sps_parser.h"
+#include "h265_utils.h"
+#include "h265_vps_parser.h"
+
+namespace {
+// NAL unit header size
+constexpr size_t kNalUnitHeaderSize = 2;
+// start code for the injected parameter sets
+const uint8_t kStartCode[] = {0x00, 0x00, 0x00, 0x01};
+// unknown offset
+constexpr size_t kUnknownOffset = std::numeric_limits<size_t>::max();
+constexpr uint64_t kNanosecondsPerSecond = 1000000000;
+constexpr uint64_t kNanosecondsPerMillisecond = 1000000;
+
+// Offset of the next start code prefix (0x000001) at or after `offset`, or
+// `length` if there is none.
+size_t FindStartCode(const uint8_t* data, size_t length, size_t offset) {
+  while (length >= 3 && offset <= length - 3) {
+    const void* one = memchr(data + offset + 2, 0x01, length - offset - 2);
+    if (one == nullptr) {
+      break;
+    }
+    size_t pos = static_cast<size_t>(static_cast<const uint8_t*>(one) - data);
+    if (data[pos - 1] == 0x00 && data[pos - 2] == 0x00) {
+      return pos - 2;
+    }
+    offset = pos - 1;
+  }
+  return length;
+}
+
+bool IsIrap(uint32_t nal_unit_type) {
+  return nal_unit_type >= h265nal::BLA_W_LP &&
+         nal_unit_type <= h265nal::RSV_IRAP_VCL23;
+}
+
+// NAL unit types that start an access unit, when they follow the last VCL
+// NAL unit of a picture (Section 7.4.2.4.4).
+bool StartsAccessUnit(uint32_t nal_unit_type) {
+  return (nal_unit_type >= h265nal::VPS_NUT &&
+          nal_unit_type <= h265nal::AUD_NUT) ||
+         nal_unit_type == h265nal::PREFIX_SEI_NUT ||
+         (nal_unit_type >= h265nal::RSV_NVCL41 &&
+          nal_unit_type <= h265nal::RSV_NVCL44) ||
+         (nal_unit_type >= h265nal::AP && nal_unit_type <= h265nal::UNSPEC55);
+}
+}  // namespace
+
+namespace h265nal {
+
+H265Segmenter::H265Segmenter(
+    const Options& options_in,
+    H265BitstreamParserState* bitstream_parser_state_in)
+    : options(options_in), bitstream_parser_state(bitstream_parser_state_in) {}
+
+void H265Segmenter::Process(const uint8_t* data_in, size_t length,
+                            Callback callback_in, void* opaque_in) noexcept {
+  data = data_in;
+  callback = callback_in;
+  opaque = opaque_in;
+  au_start = kUnknownOffset;
+  au_has_vcl = false;
+  au_starts_with_aud = false;
+  au_first_nal_unit_end = kUnknownOffset;
+  au_parameter_sets.clear();
+  time_ns = 0;
+  // the first segment starts at the beginning of the stream
+  segment.index = stats.segments;
+  segment.first_picture = stats.pictures;
+  segment.num_pictures = 0;
+  segment.start_time_ns = 0;
+  segment.starts_with_irap = false;
+  segment.offset = 0;
+  segment.hvcc.clear();
+  segment_prefix.clear();
+  segment_aud_length = 0;
+
+  // walk the NAL units (Annex B, Section B.2)
+  size_t start_code = FindStartCode(data, length, 0);
+  while (start_code < length) {
+    size_t payload_start = start_code + 3;
+    size_t next_start_code = FindStartCode(data, length, payload_start);
+    // 4-byte start codes (zero_byte + start_code_prefix_one_3bytes)
+    size_t offset =
+        (start_code > 0 && data[start_code - 1] == 0x00) ? start_code - 1
+                                                         : start_code;
+    size_t payload_end = (next_start_code < length &&
+                          data[next_start_code - 1] == 0x00)
+                             ? next_start_code - 1
+                             : next_start_code;
+    ProcessNalUnit(offset, data + payload_start, payload_end - payload_start);
+    start_code = next_start_code;
+  }
+  if (length > 0) {
+    EmitSegment(length, time_ns);
+  }
+  data = nullptr;
+}
+
+bool H265Segmenter::ProcessFile(const char* filename, Callback callback_in,
+                                void* opaque_in) noexcept {
+  H265MappedFile file;
+  if (!file.Open(filename)) {
+    return false;
+  }
+  Process(file.GetData(), file.GetLength(), callback_in, opaque_in);
+  return true;
+}
+
+void H265Segmenter::ProcessNalUnit(size_t offset, const uint8_t* nal_unit,
+                                   size_t length) noexcept {
+  stats.nal_units++;
+  if (au_first_nal_unit_end == kUnknownOffset && au_start != kUnknownOffset &&
+      offset > au_start) {
+    au_first_nal_unit_end = offset;
+  }
+  if (length < kNalUnitHeaderSize) {
+    return;
+  }
+  // nal_unit_header() (Section 7.3.1.2)
+  uint32_t nal_unit_type = (nal_unit[0] >> 1) & 0x3f;
+  uint32_t nuh_layer_id = ((nal_unit[0] & 0x01) << 5) | (nal_unit[1] >> 3);
+  bool is_vcl = IsNalUnitTypeVcl(nal_unit_type);
+  // first_slice_segment_in_pic_flag  u(1)
+  bool first_slice = is_vcl && length > kNalUnitHeaderSize &&
+                     (nal_unit[kNalUnitHeaderSize] & 0x80);
+
+  // access unit detection
+  if (au_start == kUnknownOffset ||
+      (nuh_layer_id == 0 && au_has_vcl &&
+       (first_slice || StartsAccessUnit(nal_unit_type)))) {
+    au_start = offset;
+    au_has_vcl = false;
+    au_starts_with_aud = (nal_unit_type == AUD_NUT);
+    au_first_nal_unit_end = kUnknownOffset;
+    au_parameter_sets.clear();
+  }
+
+  if (nal_unit_type == VPS_NUT || nal_unit_type == SPS_NUT ||
+      nal_unit_type == PPS_NUT) {
+    UpdateParameterSet(nal_unit_type, nal_unit, length);
+    return;
+  }
+  if (!is_vcl || nuh_layer_id != 0) {
+    return;
+  }
+  au_has_vcl = true;
+  if (!first_slice) {
+    return;
+  }
+
+  // new picture
+  stats.pictures++;
+  uint64_t picture_time_ns = time_ns;
+  if (picture_duration_ns > 0) {
+    time_ns += picture_duration_ns;
+  } else if (options.frames_per_second > 0) {
+    time_ns += kNanosecondsPerSecond / options.frames_per_second;
+  }
+  bool irap = IsIrap(nal_unit_type);
+  if (segment.num_pictures == 0) {
+    // first picture of the stream
+    segment.starts_with_irap = irap;
+    if (options.add_hvcc) {
+      WriteHvcc();
+    }
+  } else if (irap) {
+    bool duration_reached =
+        options.target_duration_ms > 0 &&
+        picture_time_ns - segment.start_time_ns >=
+            options.target_duration_ms * kNanosecondsPerMillisecond;
+    bool size_reached = options.target_size > 0 &&
+                        au_start - segment.offset >= options.target_size;
+    bool no_target =
+        options.target_duration_ms == 0 && options.target_size == 0;
+    if (duration_reached || size_reached || no_target) {
+      EmitSegment(au_start, picture_time_ns);
+      StartSegment(picture_time_ns);
+    }
+  }
+  segment.num_pictures++;
+}
+
+void H265Segmenter::UpdateParameterSet(uint32_t nal_unit_type,
+                                       const uint8_t* nal_unit,
+                                       size_t length) noexcept {
+  const uint8_t* payload = nal_unit + kNalUnitHeaderSize;
+  size_t payload_length = length - kNalUnitHeaderSize;
+  uint32_t id;
+  if (nal_unit_type == VPS_NUT) {
+    auto vps = H265VpsParser::ParseVps(payload, payload_length);
+    if (vps == nullptr) {
+      return;
+    }
+    id = vps->vps_video_parameter_set_id;
+    bitstream_parser_state->vps[id] = vps;
+  } else if (nal_unit_type == SPS_NUT) {
+    auto sps = H265SpsParser::ParseSps(payload, payload_length);
+    if (sps == nullptr) {
+      return;
+    }
+    id = sps->sps_seq_parameter_set_id;
+    if (sps->vui_parameters_present_flag && sps->vui_parameters != nullptr &&
+        sps->vui_parameters->vui_timing_info_present_flag &&
+        sps->vui_parameters->vui_time_scale > 0) {
+      picture_duration_ns = kNanosecondsPerSecond *
+                            sps->vui_parameters->vui_num_units_in_tick /
+                            sps->vui_parameters->vui_time_scale;
+    }
+    bitstream_parser_state->sps[id] = sps;
+  } else {
+    auto pps = H265PpsParser::ParsePps(payload, payload_length);
+    if (pps == nullptr) {
+      return;
+    }
+    id = pps->pps_pic_parameter_set_id;
+    bitstream_parser_state->pps[id] = pps;
+  }
+  parameter_sets[std::make_pair(nal_unit_type, id)].assign(nal_unit,
+                                                          nal_unit + length);
+  au_parameter_sets.emplace_back(nal_unit_type, id);
+}
+
+void H265Segmenter::StartSegment(uint64_t start_time_ns) noexcept {
+  segment.index = stats.segments;
+  segment.first_picture = stats.pictures - 1;
+  segment.num_pictures = 0;
+  segment.start_time_ns = start_time_ns;
+  segment.starts_with_irap = true;
+  segment.offset = au_start;
+
+  // inject the parameter sets that the access unit does not carry
+  segment_prefix.clear();
+  for (const auto& it : parameter_sets) {
+    bool in_access_unit = false;
+    for (const auto& key : au_parameter_sets) {
+      if (key == it.first) {
+        in_access_unit = true;
+        break;
+      }
+    }
+    if (in_access_unit) {
+      continue;
+    }
+    segment_prefix.insert(segment_prefix.end(), kStartCode,
+                          kStartCode + sizeof(kStartCode));
+    segment_prefix.insert(segment_prefix.end(), it.second.begin(),
+                          it.second.end());
+    stats.parameter_sets_injected++;
+  }
+  // the AUD must stay first
+  segment_aud_length = 0;
+  if (!segment_prefix.empty() && au_starts_with_aud &&
+      au_first_nal_unit_end != kUnknownOffset) {
+    segment_aud_length = au_first_nal_unit_end - au_start;
+  }
+  if (options.add_hvcc) {
+    WriteHvcc();
+  }
+}
+
+void H265Segmenter::WriteHvcc() noexcept {
+  std::vector<BufferSegment> nal_units;
+  for (const auto& it : parameter_sets) {
+    nal_units.push_back({it.second.data(), it.second.size()});
+  }
+  if (!H265ConfigurationBoxWriter::WriteConfigurationBox(
+          nal_units.data(), nal_units.size(),
+          H265ConfigurationBoxWriter::Options(), &segment.hvcc)) {
+    segment.hvcc.clear();
+  }
+}
+
+void H265Segmenter::EmitSegment(size_t end, uint64_t end_time_ns) noexcept {
+  segment.length = end - segment.offset;
+  segment.duration_ns = end_time_ns - segment.start_time_ns;
+  segment.spans.clear();
+  const uint8_t* body = data + segment.offset;
+  if (segment_aud_length > 0) {
+    segment.spans.push_back({body, segment_aud_length});
+  }
+  if (!segment_prefix.empty()) {
+    segment.spans.push_back({segment_prefix.data(), segment_prefix.size()});
+  }
+  if (segment.length > segment_aud_length) {
+    segment.spans.push_back(
+        {body + segment_aud_length, segment.length - segment_aud_length});
+  }
+  stats.segments++;
+  if (callback != nullptr) {
+    callback(segment, opaque);
+  }
+}
+
+}  // namespace h265nal
@@ -11,7 +11,9 @@
 #include <memory>
 #include <vector>
 
+#include "h265_budget.h"
 #include "h265_common.h"
+#include "h265_trace.h"
 
 namespace h265nal {
 
@@ -19,6 +21,47 @@ namespace h265nal {
 // You can find it on this page:
 // http://www.itu.int/rec/T-REC-H.265
 
+H265SeiMessageIterator::H265SeiMessageIterator(const uint8_t* rbsp_in,
+                                               size_t length_in) noexcept
+    : rbsp(rbsp_in), length(length_in), trailing_bits_offset(length_in) {
+  while (trailing_bits_offset > 0 && rbsp[trailing_bits_offset - 1] == 0) {
+    trailing_bits_offset--;
+  }
+  if (trailing_bits_offset > 0) {
+    trailing_bits_offset--;
+  }
+}
+
+bool H265SeiMessageIterator::Next(SeiMessage* sei_message) noexcept {
+  if (invalid || offset >= trailing_bits_offset) {
+    return false;
+  }
+  sei_message->offset = offset;
+  size_t payload_type;
+  if (!ReadValue(&payload_type) || !ReadValue(&sei_message->payload_size) ||
+      sei_message->payload_size > length - offset) {
+    invalid = true;
+    return false;
+  }
+  sei_message->payload_type = static_cast<uint32_t>(payload_type);
+  sei_message->payload_offset = offset;
+  offset += sei_message->payload_size;
+  return true;
+}
+
+bool H265SeiMessageIterator::ReadValue(size_t* value) noexcept {
+  *value = 0;
+  while (offset < length && rbsp[offset] == 0xff) {
+    *value += 255;
+    offset++;
+  }
+  if (offset >= length) {
+    return false;
+  }
+  *value += rbsp[offset++];
+  return true;
+}
+
 // Unpack RBSP and parse SEI state from the supplied buffer.
 std::unique_ptr<H265SeiMessageParser::SeiMessageState>
 H265SeiMessageParser::ParseSei(const uint8_t* data, size_t length) noexcept {
@@ -44,6 +87,7 @@ H265SeiMessageParser::ParseSei(BitBuffer* bit_buffer) noexcept {
     if (!bit_buffer->ReadBits(8, ff_byte)) {
       return nullptr;
     }
+    H265Trace::f(bit_buffer, "ff_byte/last_payload_type_byte", 8, ff_byte);
     if (payload_type > UINT32_MAX - ff_byte) {
       return nullptr;
     }
@@ -57,6 +101,7 @@ H265SeiMessageParser::ParseSei(BitBuffer* bit_buffer) noexcept {
     if (!bit_buffer->ReadBits(8, ff_byte)) {
       return nullptr;
     }
+    H265Trace::f(bit_buffer, "ff_byte/last_payload_size_byte", 8, ff_byte);
     if (payload_size > UINT32_MAX - ff_byte) {
       return nullptr;
     }
@@ -131,6 +176,8 @@ H265SeiUserDataRegisteredItuTT35Parser::parse_payload(BitBuffer* bit_buffer,
   if (!bit_buffer->ReadUInt8(payload_state->itu_t_t35_country_code)) {
     return nullptr;
   }
+  H265Trace::b(bit_buffer, "itu_t_t35_country_code", 8,
+               payload_state->itu_t_t35_country_code);
   remaining_payload_size--;
 
   if (payload_state->itu_t_t35_country_code == 0xff) {
@@ -143,15 +190,23 @@ H265SeiUserDataRegisteredItuTT35Parser::parse_payload(BitBuffer* bit_buffer,
             payload_state->itu_t_t35_country_code_extension_byte)) {
       return nullptr;
     }
+    H265Trace::b(bit_buffer, "itu_t_t35_country_code_extension_byte", 8,
+                 payload_state->itu_t_t35_country_code_extension_byte);
     remaining_payload_size--;
   }
 
+  if (!H265Budget::Charge("sei", "itu_t_t35_payload_byte", bit_buffer,
+                          remaining_payload_size, remaining_payload_size)) {
+    return nullptr;
+  }
   payload_state->payload.resize(remaining_payload_size);
   for (size_t i = 0; i < payload_state->payload.size(); ++i) {
     // itu_t_t35_payload_byte  b(8)
     if (!bit_buffer->ReadUInt8(payload_state->payload[i])) {
       return nullptr;
     }
+    H265Trace::b(bit_buffer, "itu_t_t35_payload_byte", 8,
+                 payload_state->payload[i], i);
   }
   return payload_state;
 }
@@ -175,30 +230,40 @@ H265SeiUserDataUnregisteredParser::parse_payload(BitBuffer* bit_buffer,
   if (!bit_buffer->ReadBits(32, bits_tmp)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "uuid_iso_iec_11578", 32, bits_tmp, 0);
   payload_state->uuid_iso_iec_11578_1 |= (uint64_t)bits_tmp << 32;
   if (!bit_buffer->ReadBits(32, bits_tmp)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "uuid_iso_iec_11578", 32, bits_tmp, 1);
   payload_state->uuid_iso_iec_11578_1 |= (uint64_t)bits_tmp << 0;
 
   payload_state->uuid_iso_iec_11578_2 = 0;
   if (!bit_buffer->ReadBits(32, bits_tmp)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "uuid_iso_iec_11578", 32, bits_tmp, 2);
   payload_state->uuid_iso_iec_11578_2 |= (uint64_t)bits_tmp << 32;
   if (!bit_buffer->ReadBits(32, bits_tmp)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "uuid_iso_iec_11578", 32, bits_tmp, 3);
   payload_state->uuid_iso_iec_11578_2 |= (uint64_t)bits_tmp << 0;
 
   remaining_payload_size -= 16;
 
+  if (!H265Budget::Charge("sei", "user_data_payload_byte", bit_buffer,
+                          remaining_payload_size, remaining_payload_size)) {
+    return nullptr;
+  }
   payload_state->payload.resize(remaining_payload_size);
   for (size_t i = 0; i < payload_state->payload.size(); ++i) {
     // user_data_payload_byte  b(8)
     if (!bit_buffer->ReadUInt8(payload_state->payload[i])) {
       return nullptr;
     }
+    H265Trace::b(bit_buffer, "user_data_payload_byte", 8,
+                 payload_state->payload[i], i);
   }
   return payload_state;
 }
@@ -217,18 +282,24 @@ H265SeiAlphaChannelInfoParser::parse_payload(BitBuffer* bit_buffer,
   if (!bit_buffer->ReadBits(1, payload_state->alpha_channel_cancel_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "alpha_channel_cancel_flag", 1,
+               payload_state->alpha_channel_cancel_flag);
 
   if (!payload_state->alpha_channel_cancel_flag) {
     // alpha_channel_use_idc  u(3)
     if (!bit_buffer->ReadBits(3, payload_state->alpha_channel_use_idc)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "alpha_channel_use_idc", 3,
+                 payload_state->alpha_channel_use_idc);
 
     // alpha_channel_bit_depth_minus8  u(3)
     if (!bit_buffer->ReadBits(3,
                               payload_state->alpha_channel_bit_depth_minus8)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "alpha_channel_bit_depth_minus8", 3,
+                 payload_state->alpha_channel_bit_depth_minus8);
 
     // alpha_transparent_value  u(v)
     // The number of bits used for the representation of the
@@ -238,6 +309,9 @@ H265SeiAlphaChannelInfoParser::parse_payload(BitBuffer* bit_buffer,
                               payload_state->alpha_transparent_value)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "alpha_transparent_value",
+                 payload_state->alpha_channel_bit_depth_minus8 + 9,
+                 payload_state->alpha_transparent_value);
 
     // alpha_opaque_value  u(v)
     // The number of bits used for the representation of the
@@ -246,16 +320,23 @@ H265SeiAlphaChannelInfoParser::parse_payload(BitBuffer* bit_buffer,
                               payload_state->alpha_opaque_value)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "alpha_opaque_value",
+                 payload_state->alpha_channel_bit_depth_minus8 + 9,
+                 payload_state->alpha_opaque_value);
 
     // alpha_channel_incr_flag  u(1)
     if (!bit_buffer->ReadBits(1, payload_state->alpha_channel_incr_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "alpha_channel_incr_flag", 1,
+                 payload_state->alpha_channel_incr_flag);
 
     // alpha_channel_clip_flag  u(1)
     if (!bit_buffer->ReadBits(1, payload_state->alpha_channel_clip_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "alpha_channel_clip_flag", 1,
+                 payload_state->alpha_channel_clip_flag);
 
     if (payload_state->alpha_channel_clip_flag) {
       // alpha_channel_clip_type_flag  u(1)
@@ -263,6 +344,8 @@ H265SeiAlphaChannelInfoParser::parse_payload(BitBuffer* bit_buffer,
                                 payload_state->alpha_channel_clip_type_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "alpha_channel_clip_type_flag", 1,
+                   payload_state->alpha_channel_clip_type_flag);
     }
   }
 
@@ -281,16 +364,18 @@ H265SeiMasteringDisplayColourVolumeParser::parse_payload(
       std::make_unique<H265SeiMasteringDisplayColourVolumeState>();
 
   // display_primaries_x[c] and display_primaries_y[c]  u(16) each
-  for (int c = 0; c < 3; c++) {
+  for (uint32_t c = 0; c < 3; c++) {
     uint32_t primaries_x, primaries_y;
     if (!bit_buffer->ReadBits(16, primaries_x)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "display_primaries_x", 16, primaries_x, c);
     payload_state->display_primaries_x[c] = static_cast<uint16_t>(primaries_x);
 
     if (!bit_buffer->ReadBits(16, primaries_y)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "display_primaries_y", 16, primaries_y, c);
     payload_state->display_primaries_y[c] = static_cast<uint16_t>(primaries_y);
   }
 
@@ -299,12 +384,14 @@ H265SeiMasteringDisplayColourVolumeParser::parse_payload(
   if (!bit_buffer->ReadBits(16, white_x)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "white_point_x", 16, white_x);
   payload_state->white_point_x = static_cast<uint16_t>(white_x);
 
   // white_point_y  u(16)
   if (!bit_buffer->ReadBits(16, white_y)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "white_point_y", 16, white_y);
   payload_state->white_point_y = static_cast<uint16_t>(white_y);
 
   // max_display_mastering_luminance  u(32)
@@ -312,12 +399,16 @@ H265SeiMasteringDisplayColourVolumeParser::parse_payload(
                             payload_state->max_display_mastering_luminance)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "max_display_mastering_luminance", 32,
+               payload_state->max_display_mastering_luminance);
 
   // min_display_mastering_luminance  u(32)
   if (!bit_buffer->ReadBits(32,
                             payload_state->min_display_mastering_luminance)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "min_display_mastering_luminance", 32,
+               payload_state->min_display_mastering_luminance);
 
   return payload_state;
 }
@@ -336,6 +427,7 @@ H265SeiContentLightLevelInfoParser::parse_payload(BitBuffer* bit_buffer,
   if (!bit_buffer->ReadBits(16, max_content_light)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "max_content_light_level", 16, max_content_light);
   payload_state->max_content_light_level =
       static_cast<uint16_t>(max_content_light);
 
@@ -343,6 +435,7 @@ H265SeiContentLightLevelInfoParser::parse_payload(BitBuffer* bit_buffer,
   if (!bit_buffer->ReadBits(16, max_pic_average)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "max_pic_average_light_level", 16, max_pic_average);
   payload_state->max_pic_average_light_level =
       static_cast<uint16_t>(max_pic_average);
 
@@ -362,11 +455,15 @@ H265SeiKneeFunctionInfoParser::parse_payload(BitBuffer* bit_buffer,
   if (!bit_buffer->ReadExponentialGolomb(payload_state->knee_function_id)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "knee_function_id",
+                payload_state->knee_function_id);
 
   // knee_function_cancel_flag  u(1)
   if (!bit_buffer->ReadBits(1, payload_state->knee_function_cancel_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "knee_function_cancel_flag", 1,
+               payload_state->knee_function_cancel_flag);
 
   if (!payload_state->knee_function_cancel_flag) {
     // knee_function_persistence_flag  u(1)
@@ -374,32 +471,43 @@ H265SeiKneeFunctionInfoParser::parse_payload(BitBuffer* bit_buffer,
                               payload_state->knee_function_persistence_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "knee_function_persistence_flag", 1,
+                 payload_state->knee_function_persistence_flag);
 
     // input_d_range  u(32)
     if (!bit_buffer->ReadBits(32, payload_state->input_d_range)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "input_d_range", 32, payload_state->input_d_range);
 
     // input_disp_luminance  u(32)
     if (!bit_buffer->ReadBits(32, payload_state->input_disp_luminance)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "input_disp_luminance", 32,
+                 payload_state->input_disp_luminance);
 
     // output_d_range  u(32)
     if (!bit_buffer->ReadBits(32, payload_state->output_d_range)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "output_d_range", 32,
+                 payload_state->output_d_range);
 
     // output_disp_luminance  u(32)
     if (!bit_buffer->ReadBits(32, payload_state->output_disp_luminance)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "output_disp_luminance", 32,
+                 payload_state->output_disp_luminance);
 
     // num_knee_points_minus1  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(
             payload_state->num_knee_points_minus1)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "num_knee_points_minus1",
+                  payload_state->num_knee_points_minus1);
 
     // Read knee points
     for (uint32_t i = 0; i <= payload_state->num_knee_points_minus1; i++) {
@@ -408,6 +516,7 @@ H265SeiKneeFunctionInfoParser::parse_payload(BitBuffer* bit_buffer,
       if (!bit_buffer->ReadBits(10, input_knee)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "input_knee_point", 10, input_knee, i);
       payload_state->input_knee_point.push_back(
           static_cast<uint16_t>(input_knee));
 
@@ -416,6 +525,7 @@ H265SeiKneeFunctionInfoParser::parse_payload(BitBuffer* bit_buffer,
       if (!bit_buffer->ReadBits(10, output_knee)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "output_knee_point", 10, output_knee, i);
       payload_state->output_knee_point.push_back(
           static_cast<uint16_t>(output_knee));
     }
@@ -437,11 +547,14 @@ H265SeiColourRemappingInfoParser::parse_payload(BitBuffer* bit_buffer,
   if (!bit_buffer->ReadExponentialGolomb(payload_state->colour_remap_id)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "colour_remap_id", payload_state->colour_remap_id);
 
   // colour_remap_cancel_flag  u(1)
   if (!bit_buffer->ReadBits(1, payload_state->colour_remap_cancel_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "colour_remap_cancel_flag", 1,
+               payload_state->colour_remap_cancel_flag);
 
   if (!payload_state->colour_remap_cancel_flag) {
     // colour_remap_persistence_flag  u(1)
@@ -449,12 +562,16 @@ H265SeiColourRemappingInfoParser::parse_payload(BitBuffer* bit_buffer,
                               payload_state->colour_remap_persistence_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "colour_remap_persistence_flag", 1,
+                 payload_state->colour_remap_persistence_flag);
 
     // colour_remap_video_signal_info_present_flag  u(1)
     if (!bit_buffer->ReadBits(
             1, payload_state->colour_remap_video_signal_info_present_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "colour_remap_video_signal_info_present_flag", 1,
+                 payload_state->colour_remap_video_signal_info_present_flag);
 
     if (payload_state->colour_remap_video_signal_info_present_flag) {
       // colour_remap_full_range_flag  u(1)
@@ -462,18 +579,22 @@ H265SeiColourRemappingInfoParser::parse_payload(BitBuffer* bit_buffer,
                                 payload_state->colour_remap_full_range_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "colour_remap_full_range_flag", 1,
+                   payload_state->colour_remap_full_range_flag);
 
       // colour_remap_primaries  u(8)
       uint32_t primaries, transfer, matrix;
       if (!bit_buffer->ReadBits(8, primaries)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "colour_remap_primaries", 8, primaries);
       payload_state->colour_remap_primaries = static_cast<uint8_t>(primaries);
 
       // colour_remap_transfer_function  u(8)
       if (!bit_buffer->ReadBits(8, transfer)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "colour_remap_transfer_function", 8, transfer);
       payload_state->colour_remap_transfer_function =
           static_cast<uint8_t>(transfer);
 
@@ -481,6 +602,7 @@ H265SeiColourRemappingInfoParser::parse_payload(BitBuffer* bit_buffer,
       if (!bit_buffer->ReadBits(8, matrix)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "colour_remap_matrix_coefficients", 8, matrix);
       payload_state->colour_remap_matrix_coefficients =
           static_cast<uint8_t>(matrix);
     }
@@ -490,6 +612,8 @@ H265SeiColourRemappingInfoParser::parse_payload(BitBuffer* bit_buffer,
     if (!bit_buffer->ReadBits(8, input_bit_depth)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "colour_remap_input_bit_depth", 8,
+                 input_bit_depth);
     payload_state->colour_remap_input_bit_depth =
         static_cast<uint8_t>(input_bit_depth);
 
@@ -497,6 +621,7 @@ H265SeiColourRemappingInfoParser::parse_payload(BitBuffer* bit_buffer,
     if (!bit_buffer->ReadBits(8, bit_depth)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "colour_remap_output_bit_depth", 8, bit_depth);
     payload_state->colour_remap_output_bit_depth =
         static_cast<uint8_t>(bit_depth);
 
@@ -519,6 +644,7 @@ H265SeiColourRemappingInfoParser::parse_payload(BitBuffer* bit_buffer,
       if (!bit_buffer->ReadBits(8, num_val_minus1)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "pre_lut_num_val_minus1", 8, num_val_minus1, c);
       payload_state->pre_lut_num_val_minus1[c] =
           static_cast<uint8_t>(num_val_minus1);
 
@@ -534,6 +660,8 @@ H265SeiColourRemappingInfoParser::parse_payload(BitBuffer* bit_buffer,
           if (!bit_buffer->ReadBits(bit_depth_used, coded_value)) {
             return nullptr;
           }
+          H265Trace::u(bit_buffer, "pre_lut_coded_value", bit_depth_used,
+                       coded_value, c, i);
           payload_state->pre_lut_coded_value[c].push_back(coded_value);
 
           // pre_lut_target_value[c][i]  u(v)
@@ -543,6 +671,8 @@ H265SeiColourRemappingInfoParser::parse_payload(BitBuffer* bit_buffer,
           if (!bit_buffer->ReadBits(bit_depth_used, target_value)) {
             return nullptr;
           }
+          H265Trace::u(bit_buffer, "pre_lut_target_value", bit_depth_used,
+                       target_value, c, i);
           payload_state->pre_lut_target_value[c].push_back(target_value);
         }
       }
@@ -553,12 +683,16 @@ H265SeiColourRemappingInfoParser::parse_payload(BitBuffer* bit_buffer,
             1, payload_state->colour_remap_matrix_present_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "colour_remap_matrix_present_flag", 1,
+                 payload_state->colour_remap_matrix_present_flag);
 
     if (payload_state->colour_remap_matrix_present_flag) {
       // log2_matrix_denom  u(4)
       if (!bit_buffer->ReadBits(4, payload_state->log2_matrix_denom)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "log2_matrix_denom", 4,
+                   payload_state->log2_matrix_denom);
 
       // Initialize matrix (3x3)
       payload_state->colour_remap_coeffs.resize(3);
@@ -570,6 +704,7 @@ H265SeiColourRemappingInfoParser::parse_payload(BitBuffer* bit_buffer,
           if (!bit_buffer->ReadSignedExponentialGolomb(coeff)) {
             return nullptr;
           }
+          H265Trace::se(bit_buffer, "colour_remap_coeffs", coeff, c, i);
           payload_state->colour_remap_coeffs[c][i] = coeff;
         }
       }
@@ -585,6 +720,7 @@ H265SeiColourRemappingInfoParser::parse_payload(BitBuffer* bit_buffer,
       if (!bit_buffer->ReadBits(8, num_val_minus1)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "post_lut_num_val_minus1", 8, num_val_minus1, c);
       payload_state->post_lut_num_val_minus1[c] =
           static_cast<uint8_t>(num_val_minus1);
 
@@ -601,6 +737,8 @@ H265SeiColourRemappingInfoParser::parse_payload(BitBuffer* bit_buffer,
           if (!bit_buffer->ReadBits(bit_depth_used, coded_value)) {
             return nullptr;
           }
+          H265Trace::u(bit_buffer, "post_lut_coded_value", bit_depth_used,
+                       coded_value, c, i);
           payload_state->post_lut_coded_value[c].push_back(coded_value);
 
           // [...] colour_remap_input_bit_depth is replaced by
@@ -610,6 +748,8 @@ H265SeiColourRemappingInfoParser::parse_payload(BitBuffer* bit_buffer,
           if (!bit_buffer->ReadBits(bit_depth_used, target_value)) {
             return nullptr;
           }
+          H265Trace::u(bit_buffer, "post_lut_target_value", bit_depth_used,
+                       target_value, c, i);
           payload_state->post_lut_target_value[c].push_back(target_value);
         }
       }
@@ -632,48 +772,63 @@ H265SeiContentColourVolumeParser::parse_payload(BitBuffer* bit_buffer,
   if (!bit_buffer->ReadBits(1, payload_state->ccv_cancel_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "ccv_cancel_flag", 1,
+               payload_state->ccv_cancel_flag);
 
   if (!payload_state->ccv_cancel_flag) {
     // ccv_persistence_flag  u(1)
     if (!bit_buffer->ReadBits(1, payload_state->ccv_persistence_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "ccv_persistence_flag", 1,
+                 payload_state->ccv_persistence_flag);
 
     // ccv_primaries_present_flag  u(1)
     if (!bit_buffer->ReadBits(1, payload_state->ccv_primaries_present_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "ccv_primaries_present_flag", 1,
+                 payload_state->ccv_primaries_present_flag);
 
     // ccv_min_luminance_value_present_flag  u(1)
     if (!bit_buffer->ReadBits(
             1, payload_state->ccv_min_luminance_value_present_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "ccv_min_luminance_value_present_flag", 1,
+                 payload_state->ccv_min_luminance_value_present_flag);
 
     // ccv_max_luminance_value_present_flag  u(1)
     if (!bit_buffer->ReadBits(
             1, payload_state->ccv_max_luminance_value_present_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "ccv_max_luminance_value_present_flag", 1,
+                 payload_state->ccv_max_luminance_value_present_flag);
 
     // ccv_avg_luminance_value_present_flag  u(1)
     if (!bit_buffer->ReadBits(
             1, payload_state->ccv_avg_luminance_value_present_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "ccv_avg_luminance_value_present_flag", 1,
+                 payload_state->ccv_avg_luminance_value_present_flag);
 
     // ccv_reserved_zero_2bits  u(2)
     if (!bit_buffer->ReadBits(2, payload_state->ccv_reserved_zero_2bits)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "ccv_reserved_zero_2bits", 2,
+                 payload_state->ccv_reserved_zero_2bits);
 
     if (payload_state->ccv_primaries_present_flag) {
-      for (int c = 0; c < 3; c++) {
+      for (uint32_t c = 0; c < 3; c++) {
         // ccv_primaries_x[c]  i(32)
         uint32_t primaries_x;
         if (!bit_buffer->ReadBits(32, primaries_x)) {
           return nullptr;
         }
+        H265Trace::u(bit_buffer, "ccv_primaries_x", 32, primaries_x, c);
         payload_state->ccv_primaries_x[c] = static_cast<int32_t>(primaries_x);
 
         // ccv_primaries_y[c]  i(32)
@@ -681,6 +836,7 @@ H265SeiContentColourVolumeParser::parse_payload(BitBuffer* bit_buffer,
         if (!bit_buffer->ReadBits(32, primaries_y)) {
           return nullptr;
         }
+        H265Trace::u(bit_buffer, "ccv_primaries_y", 32, primaries_y, c);
         payload_state->ccv_primaries_y[c] = static_cast<int32_t>(primaries_y);
       }
     }
@@ -690,6 +846,8 @@ H265SeiContentColourVolumeParser::parse_payload(BitBuffer* bit_buffer,
       if (!bit_buffer->ReadBits(32, payload_state->ccv_min_luminance_value)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "ccv_min_luminance_value", 32,
+                   payload_state->ccv_min_luminance_value);
     }
 
     if (payload_state->ccv_max_luminance_value_present_flag) {
@@ -697,6 +855,8 @@ H265SeiContentColourVolumeParser::parse_payload(BitBuffer* bit_buffer,
       if (!bit_buffer->ReadBits(32, payload_state->ccv_max_luminance_value)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "ccv_max_luminance_value", 32,
+                   payload_state->ccv_max_luminance_value);
     }
 
     if (payload_state->ccv_avg_luminance_value_present_flag) {
@@ -704,6 +864,8 @@ H265SeiContentColourVolumeParser::parse_payload(BitBuffer* bit_buffer,
       if (!bit_buffer->ReadBits(32, payload_state->ccv_avg_luminance_value)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "ccv_avg_luminance_value", 32,
+                   payload_state->ccv_avg_luminance_value);
     }
   }
 
@@ -726,6 +888,8 @@ H265SeiAlternativeTransferCharacteristicsParser::parse_payload(
   if (!bit_buffer->ReadBits(8, preferred_transfer_char)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "preferred_transfer_characteristics", 8,
+               preferred_transfer_char);
   payload_state->preferred_transfer_characteristics =
       static_cast<uint8_t>(preferred_transfer_char);
 
@@ -748,6 +912,7 @@ H265SeiAmbientViewingEnvironmentParser::parse_payload(BitBuffer* bit_buffer,
   if (!bit_buffer->ReadBits(32, ambient_illuminance)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "ambient_illuminance", 32, ambient_illuminance);
   payload_state->ambient_illuminance = ambient_illuminance;
 
   // ambient_light_x  u(16)
@@ -755,6 +920,7 @@ H265SeiAmbientViewingEnvironmentParser::parse_payload(BitBuffer* bit_buffer,
   if (!bit_buffer->ReadBits(16, ambient_light_x)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "ambient_light_x", 16, ambient_light_x);
   payload_state->ambient_light_x = static_cast<uint16_t>(ambient_light_x);
 
   // ambient_light_y  u(16)
@@ -762,6 +928,7 @@ H265SeiAmbientViewingEnvironmentParser::parse_payload(BitBuffer* bit_buffer,
   if (!bit_buffer->ReadBits(16, ambient_light_y)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "ambient_light_y", 16, ambient_light_y);
   payload_state->ambient_light_y = static_cast<uint16_t>(ambient_light_y);
 
   return payload_state;
@@ -777,11 +944,16 @@ H265SeiUnknownParser::parse_payload(BitBuffer* bit_buffer,
     return nullptr;
   }
   auto payload_state = std::make_unique<H265SeiUnknownState>();
+  if (!H265Budget::Charge("sei", "payload_byte", bit_buffer,
+                          remaining_payload_size, remaining_payload_size)) {
+    return nullptr;
+  }
   payload_state->payload.resize(remaining_payload_size);
   for (size_t i = 0; i < payload_state->payload.size(); ++i) {
     if (!bit_buffer->ReadUInt8(payload_state->payload[i])) {
       return nullptr;
     }
+    H265Trace::b(bit_buffer, "payload_byte", 8, payload_state->payload[i], i);
   }
   return payload_state;
 }
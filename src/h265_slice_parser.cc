@@ -12,9 +12,13 @@
 #include <memory>
 #include <vector>
 
+#include "h265_budget.h"
 #include "h265_common.h"
+#include "h265_error.h"
+#include "h265_parser_context.h"
 #include "h265_pred_weight_table_parser.h"
 #include "h265_st_ref_pic_set_parser.h"
+#include "h265_trace.h"
 
 namespace h265nal {
 
@@ -29,8 +33,12 @@ H265SliceSegmentLayerParser::ParseSliceSegmentLayer(
     struct H265BitstreamParserState* bitstream_parser_state) noexcept {
   std::vector<uint8_t> unpacked_buffer = UnescapeRbsp(data, length);
   BitBuffer bit_buffer(unpacked_buffer.data(), unpacked_buffer.size());
-  return ParseSliceSegmentLayer(&bit_buffer, nal_unit_type,
-                                bitstream_parser_state);
+  auto slice_segment_layer = ParseSliceSegmentLayer(
+      &bit_buffer, nal_unit_type, bitstream_parser_state);
+  if (slice_segment_layer != nullptr) {
+    slice_segment_layer->MapEscapedOffsets(data, length);
+  }
+  return slice_segment_layer;
 }
 
 std::unique_ptr<H265SliceSegmentLayerParser::SliceSegmentLayerState>
@@ -40,7 +48,8 @@ H265SliceSegmentLayerParser::ParseSliceSegmentLayer(
   // H265 slice segment layer (slice_segment_layer_rbsp()) NAL Unit.
   // Section 7.3.2.9 ("Slice segment layer RBSP syntax") of the H.265
   // standard for a complete description.
-  auto slice_segment_layer = std::make_unique<SliceSegmentLayerState>();
+  auto slice_segment_layer =
+      H265ParserContext::MakeState<SliceSegmentLayerState>();
 
   // input parameters
   slice_segment_layer->nal_unit_type = nal_unit_type;
@@ -53,12 +62,74 @@ H265SliceSegmentLayerParser::ParseSliceSegmentLayer(
     return nullptr;
   }
 
+  // byte_alignment() is not parsed: it takes 1 to 8 bits, so
+  // slice_segment_data() starts at the byte after the end of the header
+  size_t byte_offset, bit_offset;
+  bit_buffer->GetCurrentOffset(&byte_offset, &bit_offset);
+  slice_segment_layer->header_end_rbsp_offset = byte_offset;
+  slice_segment_layer->header_end_bit_offset = bit_offset;
+  slice_segment_layer->slice_segment_data_rbsp_offset = byte_offset + 1;
+
   // slice_segment_data()
   // rbsp_slice_segment_trailing_bits()
 
+  // no emulation prevention bytes until MapEscapedOffsets()
+  size_t length = static_cast<size_t>(
+      (byte_offset * 8 + bit_offset + bit_buffer->RemainingBitCount()) / 8);
+  slice_segment_layer->header_end_offset = byte_offset;
+  slice_segment_layer->slice_segment_data_offset = byte_offset + 1;
+  slice_segment_layer->slice_segment_data_length =
+      (length > byte_offset + 1) ? (length - byte_offset - 1) : 0;
+
   return slice_segment_layer;
 }
 
+void H265SliceSegmentLayerParser::SliceSegmentLayerState::MapEscapedOffsets(
+    const uint8_t* data, size_t length) noexcept {
+  const BufferSegment segment = {data, length};
+  MapEscapedOffsets(&segment, 1);
+}
+
+void H265SliceSegmentLayerParser::SliceSegmentLayerState::MapEscapedOffsets(
+    const BufferSegment* segments, size_t num_segments) noexcept {
+  header_end_offset =
+      RbspToEscapedOffset(segments, num_segments, header_end_rbsp_offset);
+  slice_segment_data_offset = RbspToEscapedOffset(
+      segments, num_segments, slice_segment_data_rbsp_offset);
+  num_emulation_prevention_bytes =
+      slice_segment_data_offset - slice_segment_data_rbsp_offset;
+  size_t length = GetBufferSegmentsLength(segments, num_segments);
+  slice_segment_data_length = (length > slice_segment_data_offset)
+                                   ? (length - slice_segment_data_offset)
+                                   : 0;
+}
+
+// Entry point offsets count the emulation prevention bytes (Section
+// 7.4.7.1), so the subsets are split in the escaped buffer.
+bool H265SliceSegmentLayerParser::SliceSegmentLayerState::GetSubstreams(
+    std::vector<Substream>* substreams) const noexcept {
+  substreams->clear();
+  size_t offset = slice_segment_data_offset;
+  size_t length = slice_segment_data_length;
+  if (length == 0) {
+    return false;
+  }
+  for (uint32_t entry_point_offset_minus1 :
+       slice_segment_header->entry_point_offset_minus1) {
+    size_t substream_length =
+        static_cast<size_t>(entry_point_offset_minus1) + 1;
+    if (substream_length >= length) {
+      substreams->clear();
+      return false;
+    }
+    substreams->push_back({offset, substream_length});
+    offset += substream_length;
+    length -= substream_length;
+  }
+  substreams->push_back({offset, length});
+  return true;
+}
+
 #ifdef FDUMP_DEFINE
 void H265SliceSegmentLayerParser::SliceSegmentLayerState::fdump(
     FILE* outfp, int indent_level) const {
@@ -100,7 +171,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
   // H265 slice segment header (slice_segment_layer_rbsp()) NAL Unit.
   // Section 7.3.6.1 ("General slice segment header syntax") of the H.265
   // standard for a complete description.
-  auto slice_segment_header = std::make_unique<SliceSegmentHeaderState>();
+  auto slice_segment_header =
+      H265ParserContext::MakeState<SliceSegmentHeaderState>();
 
   // input parameters
   slice_segment_header->nal_unit_type = nal_unit_type;
@@ -110,6 +182,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
           1, slice_segment_header->first_slice_segment_in_pic_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "first_slice_segment_in_pic_flag", 1,
+               slice_segment_header->first_slice_segment_in_pic_flag);
 
   if (slice_segment_header->nal_unit_type >= BLA_W_LP &&
       slice_segment_header->nal_unit_type <= RSV_IRAP_VCL23) {
@@ -118,6 +192,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
             1, slice_segment_header->no_output_of_prior_pics_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "no_output_of_prior_pics_flag", 1,
+                 slice_segment_header->no_output_of_prior_pics_flag);
   }
 
   // slice_pic_parameter_set_id  ue(v)
@@ -125,13 +201,16 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
           slice_segment_header->slice_pic_parameter_set_id)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "slice_pic_parameter_set_id",
+                slice_segment_header->slice_pic_parameter_set_id);
   uint32_t pps_id = slice_segment_header->slice_pic_parameter_set_id;
   if (bitstream_parser_state->pps.find(pps_id) ==
       bitstream_parser_state->pps.end()) {
     // non-existent PPS id
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "non-existent PPS id: %u\n", pps_id);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_MissingParameterSet,
+                              "slice_segment_header",
+                              "slice_pic_parameter_set_id", bit_buffer, pps_id,
+                              0, 0);
     return nullptr;
   }
   auto& pps = bitstream_parser_state->pps[pps_id];
@@ -141,9 +220,10 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
   if (bitstream_parser_state->sps.find(sps_id) ==
       bitstream_parser_state->sps.end()) {
     // non-existent SPS id
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "non-existent SPS id: %u\n", sps_id);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_MissingParameterSet,
+                              "slice_segment_header",
+                              "pps_seq_parameter_set_id", bit_buffer, sps_id, 0,
+                              0);
     return nullptr;
   }
   auto& sps = bitstream_parser_state->sps[sps_id];
@@ -157,15 +237,18 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
               1, slice_segment_header->dependent_slice_segment_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "dependent_slice_segment_flag", 1,
+                   slice_segment_header->dependent_slice_segment_flag);
     }
     size_t PicSizeInCtbsY = sps->getPicSizeInCtbsY();
     size_t slice_segment_address_len = static_cast<size_t>(
         std::ceil(std::log2(static_cast<float>(PicSizeInCtbsY))));
     if (slice_segment_address_len == 0) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr, "invalid slice_segment_address_len: %zu\n",
-              slice_segment_address_len);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_InvalidValue,
+                                "slice_segment_header",
+                                "slice_segment_address_len", bit_buffer,
+                                static_cast<int64_t>(slice_segment_address_len),
+                                0, 0);
       return nullptr;
     }
     // range: 0 to PicSizeInCtbsY - 1
@@ -174,6 +257,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
                               slice_segment_header->slice_segment_address)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "slice_segment_address", slice_segment_address_len,
+                 slice_segment_header->slice_segment_address);
   }
 
   if (!slice_segment_header->dependent_slice_segment_flag) {
@@ -185,6 +270,7 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
       if (!bit_buffer->ReadBits(1, bits_tmp)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "slice_reserved_flag", 1, bits_tmp, i);
       slice_segment_header->slice_reserved_flag.push_back(bits_tmp);
     }
 
@@ -192,6 +278,7 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
     if (!bit_buffer->ReadExponentialGolomb(slice_segment_header->slice_type)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "slice_type", slice_segment_header->slice_type);
 
     slice_segment_header->output_flag_present_flag =
         pps->output_flag_present_flag;
@@ -200,6 +287,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
       if (!bit_buffer->ReadBits(1, slice_segment_header->pic_output_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "pic_output_flag", 1,
+                   slice_segment_header->pic_output_flag);
     }
 
     slice_segment_header->separate_colour_plane_flag =
@@ -209,6 +298,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
       if (!bit_buffer->ReadBits(2, slice_segment_header->colour_plane_id)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "colour_plane_id", 2,
+                   slice_segment_header->colour_plane_id);
     }
 
     if (slice_segment_header->nal_unit_type != IDR_W_RADL &&
@@ -227,12 +318,17 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
               slice_segment_header->slice_pic_order_cnt_lsb)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "slice_pic_order_cnt_lsb",
+                   slice_pic_order_cnt_lsb_len,
+                   slice_segment_header->slice_pic_order_cnt_lsb);
 
       // short_term_ref_pic_set_sps_flag  u(1)
       if (!bit_buffer->ReadBits(
               1, slice_segment_header->short_term_ref_pic_set_sps_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "short_term_ref_pic_set_sps_flag", 1,
+                   slice_segment_header->short_term_ref_pic_set_sps_flag);
 
       slice_segment_header->num_short_term_ref_pic_sets =
           sps->num_short_term_ref_pic_sets;
@@ -266,6 +362,9 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
                 slice_segment_header->short_term_ref_pic_set_idx)) {
           return nullptr;
         }
+        H265Trace::u(bit_buffer, "short_term_ref_pic_set_idx",
+                     short_term_ref_pic_set_idx_len,
+                     slice_segment_header->short_term_ref_pic_set_idx);
       }
 
       slice_segment_header->long_term_ref_pics_present_flag =
@@ -279,6 +378,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
                   slice_segment_header->num_long_term_sps)) {
             return nullptr;
           }
+          H265Trace::ue(bit_buffer, "num_long_term_sps",
+                        slice_segment_header->num_long_term_sps);
         }
 
         // num_long_term_pics  ue(v)
@@ -286,11 +387,18 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
                 slice_segment_header->num_long_term_pics)) {
           return nullptr;
         }
-
-        for (uint32_t i = 0;
-             i < (uint64_t)slice_segment_header->num_long_term_sps +
-                     slice_segment_header->num_long_term_pics;
-             i++) {
+        H265Trace::ue(bit_buffer, "num_long_term_pics",
+                      slice_segment_header->num_long_term_pics);
+
+        uint64_t num_long_term =
+            (uint64_t)slice_segment_header->num_long_term_sps +
+            slice_segment_header->num_long_term_pics;
+        if (!H265Budget::Charge("slice_segment_header", "num_long_term_pics",
+                                bit_buffer, num_long_term,
+                                num_long_term * 5 * sizeof(uint32_t))) {
+          return nullptr;
+        }
+        for (uint32_t i = 0; i < num_long_term; i++) {
           if (i < slice_segment_header->num_long_term_sps) {
             if (slice_segment_header->num_long_term_ref_pics_sps > 1) {
               // lt_idx_sps[i]  u(v)
@@ -302,6 +410,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
               if (!bit_buffer->ReadBits(lt_idx_sps_len, bits_tmp)) {
                 return nullptr;
               }
+              H265Trace::u(bit_buffer, "lt_idx_sps", lt_idx_sps_len, bits_tmp,
+                           i);
               slice_segment_header->lt_idx_sps.push_back(bits_tmp);
             }
 
@@ -313,16 +423,18 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
             // num_long_term_ref_pics_sps - 1, inclusive.
             size_t poc_lsb_lt_len =
                 slice_segment_header->log2_max_pic_order_cnt_lsb_minus4 + 4;
-            // slice_pic_order_cnt_lsb  u(v)
             if (!bit_buffer->ReadBits(poc_lsb_lt_len, bits_tmp)) {
               return nullptr;
             }
+            H265Trace::u(bit_buffer, "poc_lsb_lt", poc_lsb_lt_len, bits_tmp, i);
             slice_segment_header->poc_lsb_lt.push_back(bits_tmp);
 
             // used_by_curr_pic_lt_flag[i]  u(1)
             if (!bit_buffer->ReadBits(1, bits_tmp)) {
               return nullptr;
             }
+            H265Trace::u(bit_buffer, "used_by_curr_pic_lt_flag", 1, bits_tmp,
+                         i);
             slice_segment_header->used_by_curr_pic_lt_flag.push_back(bits_tmp);
           }
 
@@ -330,6 +442,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
           if (!bit_buffer->ReadBits(1, bits_tmp)) {
             return nullptr;
           }
+          H265Trace::u(bit_buffer, "delta_poc_msb_present_flag", 1, bits_tmp,
+                       i);
           slice_segment_header->delta_poc_msb_present_flag.push_back(bits_tmp);
 
           if (slice_segment_header->delta_poc_msb_present_flag[i]) {
@@ -337,6 +451,7 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
             if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
               return nullptr;
             }
+            H265Trace::ue(bit_buffer, "delta_poc_msb_cycle_lt", golomb_tmp, i);
             slice_segment_header->delta_poc_msb_cycle_lt.push_back(golomb_tmp);
           }
         }
@@ -350,6 +465,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
                 1, slice_segment_header->slice_temporal_mvp_enabled_flag)) {
           return nullptr;
         }
+        H265Trace::u(bit_buffer, "slice_temporal_mvp_enabled_flag", 1,
+                     slice_segment_header->slice_temporal_mvp_enabled_flag);
       }
     }
 
@@ -360,6 +477,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
       if (!bit_buffer->ReadBits(1, slice_segment_header->slice_sao_luma_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "slice_sao_luma_flag", 1,
+                   slice_segment_header->slice_sao_luma_flag);
 
       // Depending on the value of separate_colour_plane_flag, the value of
       // the variable ChromaArrayType is assigned as follows:
@@ -380,6 +499,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
                 1, slice_segment_header->slice_sao_chroma_flag)) {
           return nullptr;
         }
+        H265Trace::u(bit_buffer, "slice_sao_chroma_flag", 1,
+                     slice_segment_header->slice_sao_chroma_flag);
       }
     }
 
@@ -390,6 +511,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
               1, slice_segment_header->num_ref_idx_active_override_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "num_ref_idx_active_override_flag", 1,
+                   slice_segment_header->num_ref_idx_active_override_flag);
 
       if (slice_segment_header->num_ref_idx_active_override_flag) {
         // num_ref_idx_l0_active_minus1  ue(v)
@@ -397,6 +520,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
                 slice_segment_header->num_ref_idx_l0_active_minus1)) {
           return nullptr;
         }
+        H265Trace::ue(bit_buffer, "num_ref_idx_l0_active_minus1",
+                      slice_segment_header->num_ref_idx_l0_active_minus1);
 
         if (slice_segment_header->slice_type == SliceType_B) {
           // num_ref_idx_l1_active_minus1  ue(v)
@@ -404,6 +529,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
                   slice_segment_header->num_ref_idx_l1_active_minus1)) {
             return nullptr;
           }
+          H265Trace::ue(bit_buffer, "num_ref_idx_l1_active_minus1",
+                        slice_segment_header->num_ref_idx_l1_active_minus1);
         }
       }
 
@@ -415,11 +542,9 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
           slice_segment_header->NumPicTotalCurr > 1) {
         // ref_pic_lists_modification()
         // TODO(chemag): add support for ref_pic_lists_modification()
-#ifdef FPRINT_ERRORS
-        fprintf(stderr,
-                "error: unimplemented ref_pic_lists_modification in "
-                "slice_header\n");
-#endif  // FPRINT_ERRORS
+        H265ErrorReporter::Report(H265ErrorCode_Unimplemented,
+                                  "slice_segment_header",
+                                  "ref_pic_lists_modification", bit_buffer);
       }
 
       if (slice_segment_header->slice_type == SliceType_B) {
@@ -427,6 +552,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
         if (!bit_buffer->ReadBits(1, slice_segment_header->mvd_l1_zero_flag)) {
           return nullptr;
         }
+        H265Trace::u(bit_buffer, "mvd_l1_zero_flag", 1,
+                     slice_segment_header->mvd_l1_zero_flag);
       }
 
       slice_segment_header->cabac_init_present_flag =
@@ -436,6 +563,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
         if (!bit_buffer->ReadBits(1, slice_segment_header->cabac_init_flag)) {
           return nullptr;
         }
+        H265Trace::u(bit_buffer, "cabac_init_flag", 1,
+                     slice_segment_header->cabac_init_flag);
       }
 
       if (slice_segment_header->slice_temporal_mvp_enabled_flag) {
@@ -445,6 +574,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
                   1, slice_segment_header->collocated_from_l0_flag)) {
             return nullptr;
           }
+          H265Trace::u(bit_buffer, "collocated_from_l0_flag", 1,
+                       slice_segment_header->collocated_from_l0_flag);
         }
         if ((slice_segment_header->collocated_from_l0_flag &&
              slice_segment_header->num_ref_idx_l0_active_minus1 > 0) ||
@@ -455,6 +586,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
                   slice_segment_header->collocated_ref_idx)) {
             return nullptr;
           }
+          H265Trace::ue(bit_buffer, "collocated_ref_idx",
+                        slice_segment_header->collocated_ref_idx);
         }
       }
 
@@ -479,6 +612,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
               slice_segment_header->five_minus_max_num_merge_cand)) {
         return nullptr;
       }
+      H265Trace::ue(bit_buffer, "five_minus_max_num_merge_cand",
+                    slice_segment_header->five_minus_max_num_merge_cand);
 
       slice_segment_header->motion_vector_resolution_control_idc = 0;
       if (sps->sps_scc_extension_flag) {
@@ -493,6 +628,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
                                   slice_segment_header->use_integer_mv_flag)) {
           return nullptr;
         }
+        H265Trace::u(bit_buffer, "use_integer_mv_flag", 1,
+                     slice_segment_header->use_integer_mv_flag);
       }
     }
     // slice_qp_delta  se(v)
@@ -500,6 +637,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
             slice_segment_header->slice_qp_delta)) {
       return nullptr;
     }
+    H265Trace::se(bit_buffer, "slice_qp_delta",
+                  slice_segment_header->slice_qp_delta);
 
     slice_segment_header->pps_slice_chroma_qp_offsets_present_flag =
         pps->pps_slice_chroma_qp_offsets_present_flag;
@@ -509,12 +648,16 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
               slice_segment_header->slice_cb_qp_offset)) {
         return nullptr;
       }
+      H265Trace::se(bit_buffer, "slice_cb_qp_offset",
+                    slice_segment_header->slice_cb_qp_offset);
 
       // slice_cr_qp_offset  se(v)
       if (!bit_buffer->ReadSignedExponentialGolomb(
               slice_segment_header->slice_cr_qp_offset)) {
         return nullptr;
       }
+      H265Trace::se(bit_buffer, "slice_cr_qp_offset",
+                    slice_segment_header->slice_cr_qp_offset);
     }
 
     slice_segment_header->pps_slice_act_qp_offsets_present_flag = 0;
@@ -528,18 +671,24 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
               slice_segment_header->slice_act_y_qp_offset)) {
         return nullptr;
       }
+      H265Trace::se(bit_buffer, "slice_act_y_qp_offset",
+                    slice_segment_header->slice_act_y_qp_offset);
 
       // slice_act_cb_qp_offset  se(v)
       if (!bit_buffer->ReadSignedExponentialGolomb(
               slice_segment_header->slice_act_cb_qp_offset)) {
         return nullptr;
       }
+      H265Trace::se(bit_buffer, "slice_act_cb_qp_offset",
+                    slice_segment_header->slice_act_cb_qp_offset);
 
       // slice_act_cr_qp_offset  se(v)
       if (!bit_buffer->ReadSignedExponentialGolomb(
               slice_segment_header->slice_act_cr_qp_offset)) {
         return nullptr;
       }
+      H265Trace::se(bit_buffer, "slice_act_cr_qp_offset",
+                    slice_segment_header->slice_act_cr_qp_offset);
     }
 
     // TODO(chemag): add support for pps_range_extension()
@@ -552,6 +701,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
               1, slice_segment_header->cu_chroma_qp_offset_enabled_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "cu_chroma_qp_offset_enabled_flag", 1,
+                   slice_segment_header->cu_chroma_qp_offset_enabled_flag);
     }
 
     slice_segment_header->deblocking_filter_override_enabled_flag =
@@ -562,6 +713,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
               1, slice_segment_header->deblocking_filter_override_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "deblocking_filter_override_flag", 1,
+                   slice_segment_header->deblocking_filter_override_flag);
     }
 
     if (slice_segment_header->deblocking_filter_override_flag) {
@@ -570,6 +723,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
               1, slice_segment_header->slice_deblocking_filter_disabled_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "slice_deblocking_filter_disabled_flag", 1,
+                   slice_segment_header->slice_deblocking_filter_disabled_flag);
 
       if (!slice_segment_header->slice_deblocking_filter_disabled_flag) {
         // slice_beta_offset_div2 se(v)
@@ -577,12 +732,16 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
                 slice_segment_header->slice_beta_offset_div2)) {
           return nullptr;
         }
+        H265Trace::se(bit_buffer, "slice_beta_offset_div2",
+                      slice_segment_header->slice_beta_offset_div2);
 
         // slice_tc_offset_div2 se(v)
         if (!bit_buffer->ReadSignedExponentialGolomb(
                 slice_segment_header->slice_tc_offset_div2)) {
           return nullptr;
         }
+        H265Trace::se(bit_buffer, "slice_tc_offset_div2",
+                      slice_segment_header->slice_tc_offset_div2);
       }
     }
 
@@ -598,6 +757,9 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
                      ->slice_loop_filter_across_slices_enabled_flag)) {
         return nullptr;
       }
+      H265Trace::u(
+          bit_buffer, "slice_loop_filter_across_slices_enabled_flag", 1,
+          slice_segment_header->slice_loop_filter_across_slices_enabled_flag);
     }
   }
 
@@ -611,14 +773,15 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
             slice_segment_header->num_entry_point_offsets)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "num_entry_point_offsets",
+                  slice_segment_header->num_entry_point_offsets);
     if (!slice_segment_header->isValidNumEntryPointOffsets(
             slice_segment_header->num_entry_point_offsets, sps, pps)) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "error: invalid slice_segment_header->num_entry_point_offsets: "
-              "%" PRIu32 "\n",
-              slice_segment_header->num_entry_point_offsets);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_InvalidValue,
+                                "slice_segment_header",
+                                "num_entry_point_offsets", bit_buffer,
+                                slice_segment_header->num_entry_point_offsets,
+                                0, 0);
       return nullptr;
     }
 
@@ -628,11 +791,21 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
               slice_segment_header->offset_len_minus1)) {
         return nullptr;
       }
+      H265Trace::ue(bit_buffer, "offset_len_minus1",
+                    slice_segment_header->offset_len_minus1);
       // offset_len_minus1 must be in range 0-31 per spec
       if (slice_segment_header->offset_len_minus1 > 31) {
         return nullptr;
       }
 
+      if (!H265Budget::Charge(
+              "slice_segment_header", "entry_point_offset_minus1", bit_buffer,
+              slice_segment_header->num_entry_point_offsets,
+              static_cast<uint64_t>(
+                  slice_segment_header->num_entry_point_offsets) *
+                  sizeof(uint32_t))) {
+        return nullptr;
+      }
       for (uint32_t i = 0; i < slice_segment_header->num_entry_point_offsets;
            i++) {
         // entry_point_offset_minus1[i]  u(v)
@@ -640,6 +813,8 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
                                   bits_tmp)) {
           return nullptr;
         }
+        H265Trace::u(bit_buffer, "entry_point_offset_minus1",
+                     slice_segment_header->offset_len_minus1 + 1, bits_tmp, i);
         slice_segment_header->entry_point_offset_minus1.push_back(bits_tmp);
       }
     }
@@ -653,12 +828,25 @@ H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
             slice_segment_header->slice_segment_header_extension_length)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "slice_segment_header_extension_length",
+                  slice_segment_header->slice_segment_header_extension_length);
+    if (!H265Budget::Charge(
+            "slice_segment_header", "slice_segment_header_extension_data_byte",
+            bit_buffer,
+            slice_segment_header->slice_segment_header_extension_length,
+            static_cast<uint64_t>(
+                slice_segment_header->slice_segment_header_extension_length) *
+                sizeof(uint32_t))) {
+      return nullptr;
+    }
     for (uint32_t i = 0;
          i < slice_segment_header->slice_segment_header_extension_length; i++) {
       // slice_segment_header_extension_data_byte[i]  u(8)
       if (!bit_buffer->ReadBits(8, bits_tmp)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "slice_segment_header_extension_data_byte", 8,
+                   bits_tmp, i);
       slice_segment_header->slice_segment_header_extension_data_byte.push_back(
           bits_tmp);
     }
@@ -0,0 +1,312 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_splicer.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_nal_filter.h"
+#include "h265_parameter_set_writer.h"
+#include "h265_pps_parser.h"
+#include "h265_slice_parser.h"
+#include "h265_sps_parser.h"
+#include "rtc_common.h"
+
+namespace {
+// NAL unit header size
+constexpr size_t kNalUnitHeaderSize = 2;
+// largest parameter set ids (Sections 7.4.3.2.1 and 7.4.3.3.1)
+constexpr uint32_t kMaxSpsId = 15;
+constexpr uint32_t kMaxPpsId = 63;
+// room for a longer slice_pic_parameter_set_id (ue(v) of up to 13 bits)
+// and the byte_alignment()
+constexpr size_t kSliceHeaderGrowth = 4;
+
+bool IsIrap(uint32_t nal_unit_type) {
+  return nal_unit_type >= h265nal::BLA_W_LP &&
+         nal_unit_type <= h265nal::RSV_IRAP_VCL23;
+}
+
+// Copy `bit_count` bits from `bit_buffer` to `bit_buffer_writer`.
+bool CopyBits(h265nal::BitBuffer* bit_buffer,
+              h265nal::BitBufferWriter* bit_buffer_writer, size_t bit_count) {
+  while (bit_count > 0) {
+    size_t n = std::min<size_t>(bit_count, 32);
+    uint32_t bits_tmp;
+    if (!bit_buffer->ReadBits(n, bits_tmp) ||
+        !bit_buffer_writer->WriteBits(bits_tmp, n)) {
+      return false;
+    }
+    bit_count -= n;
+  }
+  return true;
+}
+
+// Read the start of a slice segment header, up to (and including)
+// slice_pic_parameter_set_id (Section 7.3.6.1).
+bool ReadSlicePicParameterSetId(h265nal::BitBuffer* bit_buffer,
+                                uint32_t nal_unit_type,
+                                uint32_t* slice_pic_parameter_set_id) {
+  // first_slice_segment_in_pic_flag  u(1)
+  // no_output_of_prior_pics_flag  u(1)
+  // slice_pic_parameter_set_id  ue(v)
+  return bit_buffer->ConsumeBits(IsIrap(nal_unit_type) ? 2 : 1) &&
+         bit_buffer->ReadExponentialGolomb(*slice_pic_parameter_set_id);
+}
+}  // namespace
+
+namespace h265nal {
+
+H265Splicer::H265Splicer() { filter.AddStage(SpliceStage, this); }
+
+size_t H265Splicer::Splice(uint32_t stream_id_in, const uint8_t* data,
+                           size_t length,
+                           std::vector<BufferSegment>* spans) noexcept {
+  stream_id = stream_id_in;
+  stream = &streams[stream_id];
+  size_t size = filter.Filter(data, length, spans);
+  stream = nullptr;
+  return size;
+}
+
+void H265Splicer::RemoveStream(uint32_t stream_id_in) noexcept {
+  for (auto* owners : {&sps_owners, &pps_owners}) {
+    for (auto it = owners->begin(); it != owners->end();) {
+      if (it->second == stream_id_in) {
+        it = owners->erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  streams.erase(stream_id_in);
+}
+
+bool H265Splicer::GetSpsId(uint32_t stream_id_in, uint32_t sps_id,
+                           uint32_t* output_sps_id) const noexcept {
+  auto stream_it = streams.find(stream_id_in);
+  if (stream_it == streams.end()) {
+    return false;
+  }
+  auto it = stream_it->second.sps_ids.find(sps_id);
+  if (it == stream_it->second.sps_ids.end()) {
+    return false;
+  }
+  *output_sps_id = it->second;
+  return true;
+}
+
+bool H265Splicer::GetPpsId(uint32_t stream_id_in, uint32_t pps_id,
+                           uint32_t* output_pps_id) const noexcept {
+  auto stream_it = streams.find(stream_id_in);
+  if (stream_it == streams.end()) {
+    return false;
+  }
+  auto it = stream_it->second.pps_ids.find(pps_id);
+  if (it == stream_it->second.pps_ids.end()) {
+    return false;
+  }
+  *output_pps_id = it->second;
+  return true;
+}
+
+bool H265Splicer::SpliceStage(H265NalFilter::NalUnit* nal_unit,
+                              H265NalFilter* /* filter */, void* opaque) {
+  auto* splicer = static_cast<H265Splicer*>(opaque);
+  bool keep = true;
+  if (nal_unit->nal_unit_type == SPS_NUT) {
+    keep = splicer->RenumberSps(nal_unit);
+  } else if (nal_unit->nal_unit_type == PPS_NUT) {
+    keep = splicer->RenumberPps(nal_unit);
+  } else if (IsNalUnitTypeVcl(nal_unit->nal_unit_type)) {
+    keep = splicer->RewriteSlice(nal_unit);
+  }
+  if (!keep) {
+    splicer->stats.nal_units_dropped++;
+  }
+  return keep;
+}
+
+bool H265Splicer::MapId(uint32_t id, uint32_t max_id,
+                        std::map<uint32_t, uint32_t>* ids,
+                        std::map<uint32_t, uint32_t>* owners) noexcept {
+  if (ids->find(id) != ids->end()) {
+    return true;
+  }
+  // keep the id if no other stream uses it
+  uint32_t output_id = id;
+  if (owners->find(output_id) != owners->end()) {
+    for (output_id = 0; output_id <= max_id; output_id++) {
+      if (owners->find(output_id) == owners->end()) {
+        break;
+      }
+    }
+  }
+  if (output_id > max_id) {
+    return false;
+  }
+  (*ids)[id] = output_id;
+  (*owners)[output_id] = stream_id;
+  return true;
+}
+
+bool H265Splicer::RenumberSps(H265NalFilter::NalUnit* nal_unit) noexcept {
+  auto sps = H265SpsParser::ParseSps(nal_unit->data + kNalUnitHeaderSize,
+                                     nal_unit->length - kNalUnitHeaderSize);
+  if (sps == nullptr) {
+    return false;
+  }
+  uint32_t id = sps->sps_seq_parameter_set_id;
+  if (!MapId(id, kMaxSpsId, &stream->sps_ids, &sps_owners)) {
+    return false;
+  }
+  // the stream NAL units are parsed with the stream ids
+  stream->bitstream_parser_state.sps[id] = sps;
+  uint32_t output_id = stream->sps_ids[id];
+  if (output_id == id) {
+    return true;
+  }
+
+  H265ParameterSetWriter::Options options;
+  options.nuh_layer_id = nal_unit->nuh_layer_id;
+  options.nuh_temporal_id_plus1 = nal_unit->temporal_id + 1;
+  std::vector<uint8_t>* buffer = filter.GetBuffer();
+  sps->sps_seq_parameter_set_id = output_id;
+  bool written = H265ParameterSetWriter::WriteSps(*sps, options, buffer);
+  sps->sps_seq_parameter_set_id = id;
+  if (!written) {
+    return false;
+  }
+  nal_unit->data = buffer->data();
+  nal_unit->length = buffer->size();
+  stats.parameter_sets_renumbered++;
+  return true;
+}
+
+bool H265Splicer::RenumberPps(H265NalFilter::NalUnit* nal_unit) noexcept {
+  auto pps = H265PpsParser::ParsePps(nal_unit->data + kNalUnitHeaderSize,
+                                     nal_unit->length - kNalUnitHeaderSize);
+  if (pps == nullptr) {
+    return false;
+  }
+  uint32_t id = pps->pps_pic_parameter_set_id;
+  uint32_t sps_id = pps->pps_seq_parameter_set_id;
+  auto sps_it = stream->sps_ids.find(sps_id);
+  if (sps_it == stream->sps_ids.end() ||
+      !MapId(id, kMaxPpsId, &stream->pps_ids, &pps_owners)) {
+    return false;
+  }
+  stream->bitstream_parser_state.pps[id] = pps;
+  uint32_t output_id = stream->pps_ids[id];
+  uint32_t output_sps_id = sps_it->second;
+  if (output_id == id && output_sps_id == sps_id) {
+    return true;
+  }
+
+  H265ParameterSetWriter::Options options;
+  options.nuh_layer_id = nal_unit->nuh_layer_id;
+  options.nuh_temporal_id_plus1 = nal_unit->temporal_id + 1;
+  std::vector<uint8_t>* buffer = filter.GetBuffer();
+  pps->pps_pic_parameter_set_id = output_id;
+  pps->pps_seq_parameter_set_id = output_sps_id;
+  bool written = H265ParameterSetWriter::WritePps(*pps, options, buffer);
+  pps->pps_pic_parameter_set_id = id;
+  pps->pps_seq_parameter_set_id = sps_id;
+  if (!written) {
+    return false;
+  }
+  nal_unit->data = buffer->data();
+  nal_unit->length = buffer->size();
+  stats.parameter_sets_renumbered++;
+  return true;
+}
+
+bool H265Splicer::RewriteSlice(H265NalFilter::NalUnit* nal_unit) noexcept {
+  uint32_t nal_unit_type = nal_unit->nal_unit_type;
+  // slice_pic_parameter_set_id ends in the first 2 bytes of the payload,
+  // before any emulation prevention byte: read it in place
+  BitBuffer escaped_bit_buffer(nal_unit->data + kNalUnitHeaderSize,
+                               nal_unit->length - kNalUnitHeaderSize);
+  uint32_t id;
+  if (!ReadSlicePicParameterSetId(&escaped_bit_buffer, nal_unit_type, &id)) {
+    return false;
+  }
+  auto it = stream->pps_ids.find(id);
+  if (it == stream->pps_ids.end()) {
+    return false;
+  }
+  uint32_t output_id = it->second;
+  if (output_id == id) {
+    return true;
+  }
+
+  // find the end of the slice segment header
+  std::vector<uint8_t>& rbsp = rbsp_buffer;
+  UnescapeRbsp(nal_unit->data + kNalUnitHeaderSize,
+               nal_unit->length - kNalUnitHeaderSize, &rbsp);
+  BitBuffer bit_buffer(rbsp.data(), rbsp.size());
+  auto slice_segment_header =
+      H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
+          &bit_buffer, nal_unit_type, &stream->bitstream_parser_state);
+  if (slice_segment_header == nullptr) {
+    return false;
+  }
+  size_t header_byte_offset, header_bit_offset;
+  bit_buffer.GetCurrentOffset(&header_byte_offset, &header_bit_offset);
+  size_t header_end = header_byte_offset * 8 + header_bit_offset;
+  // byte_alignment() (Section 7.3.2.12)
+  // alignment_bit_equal_to_one  f(1)
+  uint32_t bits_tmp;
+  if (!bit_buffer.ReadBits(1, bits_tmp) || bits_tmp != 1) {
+    return false;
+  }
+  // slice_segment_data() starts at the next byte
+  size_t data_start = header_byte_offset + 1;
+
+  // rewrite the slice segment header
+  BitBuffer header_bit_buffer(rbsp.data(), data_start);
+  size_t id_start = IsIrap(nal_unit_type) ? 2 : 1;
+  if (!ReadSlicePicParameterSetId(&header_bit_buffer, nal_unit_type, &id)) {
+    return false;
+  }
+  size_t id_byte_offset, id_bit_offset;
+  header_bit_buffer.GetCurrentOffset(&id_byte_offset, &id_bit_offset);
+  size_t id_end = id_byte_offset * 8 + id_bit_offset;
+  std::vector<uint8_t>& slice = slice_buffer;
+  slice.assign(data_start + kSliceHeaderGrowth, 0);
+  BitBufferWriter bit_buffer_writer(slice.data(), slice.size());
+  header_bit_buffer.Seek(0, 0);
+  if (!CopyBits(&header_bit_buffer, &bit_buffer_writer, id_start) ||
+      !bit_buffer_writer.WriteExponentialGolomb(output_id) ||
+      !header_bit_buffer.Seek(id_byte_offset, id_bit_offset) ||
+      !CopyBits(&header_bit_buffer, &bit_buffer_writer, header_end - id_end) ||
+      !bit_buffer_writer.WriteBits(1, 1)) {
+    return false;
+  }
+  size_t byte_offset, bit_offset;
+  bit_buffer_writer.GetCurrentOffset(&byte_offset, &bit_offset);
+  // alignment_bit_equal_to_zero  f(1) (already zero)
+  slice.resize(byte_offset + (bit_offset > 0 ? 1 : 0));
+  // slice_segment_data() and rbsp_slice_segment_trailing_bits()
+  slice.insert(slice.end(), rbsp.data() + data_start,
+               rbsp.data() + rbsp.size());
+
+  std::vector<uint8_t>* buffer = filter.GetBuffer();
+  buffer->insert(buffer->end(), nal_unit->data,
+                 nal_unit->data + kNalUnitHeaderSize);
+  EscapeRbsp(slice.data(), slice.size(), buffer);
+  nal_unit->data = buffer->data();
+  nal_unit->length = buffer->size();
+  stats.slices_rewritten++;
+  return true;
+}
+
+}  // namespace h265nal
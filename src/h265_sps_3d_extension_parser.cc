@@ -12,6 +12,7 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_trace.h"
 
 namespace h265nal {
 
@@ -43,12 +44,14 @@ H265Sps3dExtensionParser::ParseSps3dExtension(BitBuffer* bit_buffer) noexcept {
     if (!bit_buffer->ReadBits(1, bits_tmp)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "iv_di_mc_enabled_flag", 1, bits_tmp, d);
     sps_3d_extension->iv_di_mc_enabled_flag.push_back(bits_tmp);
 
     // iv_mv_scal_enabled_flag[d]  u(1)
     if (!bit_buffer->ReadBits(1, bits_tmp)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "iv_mv_scal_enabled_flag", 1, bits_tmp, d);
     sps_3d_extension->iv_mv_scal_enabled_flag.push_back(bits_tmp);
 
     if (d == 0) {
@@ -57,68 +60,92 @@ H265Sps3dExtensionParser::ParseSps3dExtension(BitBuffer* bit_buffer) noexcept {
               sps_3d_extension->log2_ivmc_sub_pb_size_minus3)) {
         return nullptr;
       }
+      H265Trace::ue(bit_buffer, "log2_ivmc_sub_pb_size_minus3",
+                    sps_3d_extension->log2_ivmc_sub_pb_size_minus3, d);
 
       // iv_res_pred_enabled_flag[d]  u(1)
       if (!bit_buffer->ReadBits(1,
                                 sps_3d_extension->iv_res_pred_enabled_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "iv_res_pred_enabled_flag", 1,
+                   sps_3d_extension->iv_res_pred_enabled_flag, d);
 
       // depth_ref_enabled_flag[d]  u(1)
       if (!bit_buffer->ReadBits(1, sps_3d_extension->depth_ref_enabled_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "depth_ref_enabled_flag", 1,
+                   sps_3d_extension->depth_ref_enabled_flag, d);
 
       // vsp_mc_enabled_flag[d]  u(1)
       if (!bit_buffer->ReadBits(1, sps_3d_extension->vsp_mc_enabled_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "vsp_mc_enabled_flag", 1,
+                   sps_3d_extension->vsp_mc_enabled_flag, d);
 
       // dbbp_enabled_flag[d]  u(1)
       if (!bit_buffer->ReadBits(1, sps_3d_extension->dbbp_enabled_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "dbbp_enabled_flag", 1,
+                   sps_3d_extension->dbbp_enabled_flag, d);
 
     } else {
       // tex_mc_enabled_flag[d]  u(1)
       if (!bit_buffer->ReadBits(1, sps_3d_extension->tex_mc_enabled_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "tex_mc_enabled_flag", 1,
+                   sps_3d_extension->tex_mc_enabled_flag, d);
 
       // log2_texmc_sub_pb_size_minus3[d]  ue(v)
       if (!bit_buffer->ReadExponentialGolomb(
               sps_3d_extension->log2_texmc_sub_pb_size_minus3)) {
         return nullptr;
       }
+      H265Trace::ue(bit_buffer, "log2_texmc_sub_pb_size_minus3",
+                    sps_3d_extension->log2_texmc_sub_pb_size_minus3, d);
 
       // intra_contour_enabled_flag[d]  u(1)
       if (!bit_buffer->ReadBits(1,
                                 sps_3d_extension->intra_contour_enabled_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "intra_contour_enabled_flag", 1,
+                   sps_3d_extension->intra_contour_enabled_flag, d);
 
-      // intra_dc_only_wedge_enabled_flag[[d]  u(1)
+      // intra_dc_only_wedge_enabled_flag[d]  u(1)
       if (!bit_buffer->ReadBits(
               1, sps_3d_extension->intra_dc_only_wedge_enabled_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "intra_dc_only_wedge_enabled_flag", 1,
+                   sps_3d_extension->intra_dc_only_wedge_enabled_flag, d);
 
       // cqt_cu_part_pred_enabled_flag[d]  u(1)
       if (!bit_buffer->ReadBits(
               1, sps_3d_extension->cqt_cu_part_pred_enabled_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "cqt_cu_part_pred_enabled_flag", 1,
+                   sps_3d_extension->cqt_cu_part_pred_enabled_flag, d);
 
       // inter_dc_only_enabled_flag[d]  u(1)
       if (!bit_buffer->ReadBits(1,
                                 sps_3d_extension->inter_dc_only_enabled_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "inter_dc_only_enabled_flag", 1,
+                   sps_3d_extension->inter_dc_only_enabled_flag, d);
 
       // skip_intra_enabled_flag[d]  u(1)
       if (!bit_buffer->ReadBits(1, sps_3d_extension->skip_intra_enabled_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "skip_intra_enabled_flag", 1,
+                   sps_3d_extension->skip_intra_enabled_flag, d);
     }
   }
 
@@ -12,6 +12,7 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_trace.h"
 
 namespace h265nal {
 
@@ -43,6 +44,8 @@ H265SpsMultilayerExtensionParser::ParseSpsMultilayerExtension(
           1, sps_multilayer_extension->inter_view_mv_vert_constraint_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "inter_view_mv_vert_constraint_flag", 1,
+               sps_multilayer_extension->inter_view_mv_vert_constraint_flag);
 
   return sps_multilayer_extension;
 }
@@ -13,8 +13,10 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_error.h"
 #include "h265_profile_tier_level_parser.h"
 #include "h265_scaling_list_data_parser.h"
+#include "h265_trace.h"
 #include "h265_vui_parameters_parser.h"
 
 namespace {
@@ -49,16 +51,22 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
   if (!bit_buffer->ReadBits(4, sps->sps_video_parameter_set_id)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "sps_video_parameter_set_id", 4,
+               sps->sps_video_parameter_set_id);
 
   // sps_max_sub_layers_minus1  u(3)
   if (!bit_buffer->ReadBits(3, sps->sps_max_sub_layers_minus1)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "sps_max_sub_layers_minus1", 3,
+               sps->sps_max_sub_layers_minus1);
 
   // sps_temporal_id_nesting_flag  u(1)
   if (!bit_buffer->ReadBits(1, sps->sps_temporal_id_nesting_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "sps_temporal_id_nesting_flag", 1,
+               sps->sps_temporal_id_nesting_flag);
 
   // profile_tier_level(1, sps_max_sub_layers_minus1)
   sps->profile_tier_level = H265ProfileTierLevelParser::ParseProfileTierLevel(
@@ -71,16 +79,15 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
   if (!bit_buffer->ReadExponentialGolomb(sps->sps_seq_parameter_set_id)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "sps_seq_parameter_set_id",
+                sps->sps_seq_parameter_set_id);
   if (sps->sps_seq_parameter_set_id < kSpsSeqParameterSetIdMin ||
       sps->sps_seq_parameter_set_id > kSpsSeqParameterSetIdMax) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "invalid sps_seq_parameter_set_id: %" PRIu32
-            " not in range "
-            "[%" PRIu32 ", %" PRIu32 "]\n",
-            sps->sps_seq_parameter_set_id, kSpsSeqParameterSetIdMin,
-            kSpsSeqParameterSetIdMax);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "sps",
+                              "sps_seq_parameter_set_id", bit_buffer,
+                              sps->sps_seq_parameter_set_id,
+                              kSpsSeqParameterSetIdMin,
+                              kSpsSeqParameterSetIdMax);
     return nullptr;
   }
 
@@ -88,15 +95,13 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
   if (!bit_buffer->ReadExponentialGolomb(sps->chroma_format_idc)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "chroma_format_idc", sps->chroma_format_idc);
   if (sps->chroma_format_idc < kChromaFormatIdcMin ||
       sps->chroma_format_idc > kChromaFormatIdcMax) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "invalid chroma_format_idc: %" PRIu32
-            " not in range "
-            "[%" PRIu32 ", %" PRIu32 "]\n",
-            sps->chroma_format_idc, kChromaFormatIdcMin, kChromaFormatIdcMax);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "sps",
+                              "chroma_format_idc", bit_buffer,
+                              sps->chroma_format_idc, kChromaFormatIdcMin,
+                              kChromaFormatIdcMax);
     return nullptr;
   }
 
@@ -105,22 +110,23 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
     if (!bit_buffer->ReadBits(1, sps->separate_colour_plane_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "separate_colour_plane_flag", 1,
+                 sps->separate_colour_plane_flag);
   }
 
   // pic_width_in_luma_samples  ue(v)
   if (!bit_buffer->ReadExponentialGolomb(sps->pic_width_in_luma_samples)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "pic_width_in_luma_samples",
+                sps->pic_width_in_luma_samples);
   if (sps->pic_width_in_luma_samples < kPicWidthInLumaSamplesMin ||
       sps->pic_width_in_luma_samples > kPicWidthInLumaSamplesMax) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "invalid pic_width_in_luma_samples: %" PRIu32
-            " not in range "
-            "[%" PRIu32 ", %" PRIu32 "]\n",
-            sps->pic_width_in_luma_samples, kPicWidthInLumaSamplesMin,
-            kPicWidthInLumaSamplesMax);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "sps",
+                              "pic_width_in_luma_samples", bit_buffer,
+                              sps->pic_width_in_luma_samples,
+                              kPicWidthInLumaSamplesMin,
+                              kPicWidthInLumaSamplesMax);
     return nullptr;
   }
   // Rec. ITU-T H.265 v5 (02/2018) Page 78
@@ -130,10 +136,9 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
   if ((sps->pic_width_in_luma_samples == 0) ||
       ((MinCbSizeY * (sps->pic_width_in_luma_samples / MinCbSizeY)) !=
        sps->pic_width_in_luma_samples)) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "error: invalid sps->pic_width_in_luma_samples: %i\n",
-            sps->pic_width_in_luma_samples);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_InvalidValue, "sps",
+                              "pic_width_in_luma_samples", bit_buffer,
+                              sps->pic_width_in_luma_samples, 0, 0);
     return nullptr;
   }
 
@@ -141,16 +146,15 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
   if (!bit_buffer->ReadExponentialGolomb(sps->pic_height_in_luma_samples)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "pic_height_in_luma_samples",
+                sps->pic_height_in_luma_samples);
   if (sps->pic_height_in_luma_samples < kPicHeightInLumaSamplesMin ||
       sps->pic_height_in_luma_samples > kPicHeightInLumaSamplesMax) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "invalid pic_height_in_luma_samples: %" PRIu32
-            " not in range "
-            "[%" PRIu32 ", %" PRIu32 "]\n",
-            sps->pic_height_in_luma_samples, kPicHeightInLumaSamplesMin,
-            kPicHeightInLumaSamplesMax);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "sps",
+                              "pic_height_in_luma_samples", bit_buffer,
+                              sps->pic_height_in_luma_samples,
+                              kPicHeightInLumaSamplesMin,
+                              kPicHeightInLumaSamplesMax);
     return nullptr;
   }
   // Rec. ITU-T H.265 v5 (02/2018) Page 78
@@ -159,10 +163,9 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
   if ((sps->pic_height_in_luma_samples == 0) ||
       ((MinCbSizeY * (sps->pic_height_in_luma_samples / MinCbSizeY)) !=
        sps->pic_height_in_luma_samples)) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "error: invalid sps->pic_height_in_luma_samples: %i\n",
-            sps->pic_height_in_luma_samples);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_InvalidValue, "sps",
+                              "pic_height_in_luma_samples", bit_buffer,
+                              sps->pic_height_in_luma_samples, 0, 0);
     return nullptr;
   }
 
@@ -170,62 +173,59 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
   if (!bit_buffer->ReadBits(1, sps->conformance_window_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "conformance_window_flag", 1,
+               sps->conformance_window_flag);
 
   if (sps->conformance_window_flag) {
     // conf_win_left_offset  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(sps->conf_win_left_offset)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "conf_win_left_offset",
+                  sps->conf_win_left_offset);
     if (sps->conf_win_left_offset > sps->pic_width_in_luma_samples) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid conf_win_left_offset: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              sps->conf_win_left_offset, 0, sps->pic_width_in_luma_samples);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "sps",
+                                "conf_win_left_offset", bit_buffer,
+                                sps->conf_win_left_offset, 0,
+                                sps->pic_width_in_luma_samples);
       return nullptr;
     }
     // conf_win_right_offset  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(sps->conf_win_right_offset)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "conf_win_right_offset",
+                  sps->conf_win_right_offset);
     if (sps->conf_win_right_offset > sps->pic_width_in_luma_samples) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid conf_win_right_offset: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              sps->conf_win_right_offset, 0, sps->pic_width_in_luma_samples);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "sps",
+                                "conf_win_right_offset", bit_buffer,
+                                sps->conf_win_right_offset, 0,
+                                sps->pic_width_in_luma_samples);
       return nullptr;
     }
     // conf_win_top_offset  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(sps->conf_win_top_offset)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "conf_win_top_offset", sps->conf_win_top_offset);
     if (sps->conf_win_top_offset > sps->pic_height_in_luma_samples) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid conf_win_top_offset: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              sps->conf_win_top_offset, 0, sps->pic_height_in_luma_samples);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "sps",
+                                "conf_win_top_offset", bit_buffer,
+                                sps->conf_win_top_offset, 0,
+                                sps->pic_height_in_luma_samples);
       return nullptr;
     }
     // conf_win_bottom_offset  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(sps->conf_win_bottom_offset)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "conf_win_bottom_offset",
+                  sps->conf_win_bottom_offset);
     if (sps->conf_win_bottom_offset > sps->pic_height_in_luma_samples) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid conf_win_bottom_offset: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              sps->conf_win_bottom_offset, 0, sps->pic_height_in_luma_samples);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "sps",
+                                "conf_win_bottom_offset", bit_buffer,
+                                sps->conf_win_bottom_offset, 0,
+                                sps->pic_height_in_luma_samples);
       return nullptr;
     }
   }
@@ -234,32 +234,29 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
   if (!bit_buffer->ReadExponentialGolomb(sps->bit_depth_luma_minus8)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "bit_depth_luma_minus8",
+                sps->bit_depth_luma_minus8);
   if (sps->bit_depth_luma_minus8 < kBitDepthLumaMinus8Min ||
       sps->bit_depth_luma_minus8 > kBitDepthLumaMinus8Max) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "invalid bit_depth_luma_minus8: %" PRIu32
-            " not in range "
-            "[%" PRIu32 ", %" PRIu32 "]\n",
-            sps->bit_depth_luma_minus8, kBitDepthLumaMinus8Min,
-            kBitDepthLumaMinus8Max);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "sps",
+                              "bit_depth_luma_minus8", bit_buffer,
+                              sps->bit_depth_luma_minus8,
+                              kBitDepthLumaMinus8Min, kBitDepthLumaMinus8Max);
     return nullptr;
   }
   // bit_depth_chroma_minus8  ue(v)
   if (!bit_buffer->ReadExponentialGolomb(sps->bit_depth_chroma_minus8)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "bit_depth_chroma_minus8",
+                sps->bit_depth_chroma_minus8);
   if (sps->bit_depth_chroma_minus8 < kBitDepthChromaMinus8Min ||
       sps->bit_depth_chroma_minus8 > kBitDepthChromaMinus8Max) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "invalid bit_depth_chroma_minus8: %" PRIu32
-            " not in range "
-            "[%" PRIu32 ", %" PRIu32 "]\n",
-            sps->bit_depth_chroma_minus8, kBitDepthChromaMinus8Min,
-            kBitDepthChromaMinus8Max);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "sps",
+                              "bit_depth_chroma_minus8", bit_buffer,
+                              sps->bit_depth_chroma_minus8,
+                              kBitDepthChromaMinus8Min,
+                              kBitDepthChromaMinus8Max);
     return nullptr;
   }
   // log2_max_pic_order_cnt_lsb_minus4  ue(v)
@@ -267,18 +264,17 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
           sps->log2_max_pic_order_cnt_lsb_minus4)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "log2_max_pic_order_cnt_lsb_minus4",
+                sps->log2_max_pic_order_cnt_lsb_minus4);
   if (sps->log2_max_pic_order_cnt_lsb_minus4 <
           kLog2MaxPicOrderCntLsbMinus4Min ||
       sps->log2_max_pic_order_cnt_lsb_minus4 >
           kLog2MaxPicOrderCntLsbMinus4Max) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "invalid log2_max_pic_order_cnt_lsb_minus4: %" PRIu32
-            " not in range "
-            "[%" PRIu32 ", %" PRIu32 "]\n",
-            sps->log2_max_pic_order_cnt_lsb_minus4,
-            kLog2MaxPicOrderCntLsbMinus4Min, kLog2MaxPicOrderCntLsbMinus4Max);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "sps",
+                              "log2_max_pic_order_cnt_lsb_minus4", bit_buffer,
+                              sps->log2_max_pic_order_cnt_lsb_minus4,
+                              kLog2MaxPicOrderCntLsbMinus4Min,
+                              kLog2MaxPicOrderCntLsbMinus4Max);
     return nullptr;
   }
 
@@ -286,6 +282,8 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
   if (!bit_buffer->ReadBits(1, sps->sps_sub_layer_ordering_info_present_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "sps_sub_layer_ordering_info_present_flag", 1,
+               sps->sps_sub_layer_ordering_info_present_flag);
 
   for (uint32_t i = (sps->sps_sub_layer_ordering_info_present_flag
                          ? 0
@@ -295,6 +293,8 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
     if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "sps_max_dec_pic_buffering_minus1", golomb_tmp,
+                  i);
     // Section 7.4.3.2.1
     // "The value of sps_max_dec_pic_buffering_minus1[i] shall be in the
     // range of 0 to MaxDpbSize - 1, inclusive"
@@ -306,11 +306,13 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
     if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "sps_max_num_reorder_pics", golomb_tmp, i);
     sps->sps_max_num_reorder_pics.push_back(golomb_tmp);
     // sps_max_latency_increase_plus1[i]  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "sps_max_latency_increase_plus1", golomb_tmp, i);
     sps->sps_max_latency_increase_plus1.push_back(golomb_tmp);
   }
 
@@ -319,6 +321,8 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
           sps->log2_min_luma_coding_block_size_minus3)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "log2_min_luma_coding_block_size_minus3",
+                sps->log2_min_luma_coding_block_size_minus3);
   if (sps->log2_min_luma_coding_block_size_minus3 > 3) {
     return nullptr;
   }
@@ -328,6 +332,8 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
           sps->log2_diff_max_min_luma_coding_block_size)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "log2_diff_max_min_luma_coding_block_size",
+                sps->log2_diff_max_min_luma_coding_block_size);
   if (sps->log2_diff_max_min_luma_coding_block_size > 3) {
     return nullptr;
   }
@@ -337,35 +343,47 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
           sps->log2_min_luma_transform_block_size_minus2)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "log2_min_luma_transform_block_size_minus2",
+                sps->log2_min_luma_transform_block_size_minus2);
 
   // log2_diff_max_min_luma_transform_block_size  ue(v)
   if (!bit_buffer->ReadExponentialGolomb(
           sps->log2_diff_max_min_luma_transform_block_size)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "log2_diff_max_min_luma_transform_block_size",
+                sps->log2_diff_max_min_luma_transform_block_size);
 
   // max_transform_hierarchy_depth_inter  ue(v)
   if (!bit_buffer->ReadExponentialGolomb(
           sps->max_transform_hierarchy_depth_inter)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "max_transform_hierarchy_depth_inter",
+                sps->max_transform_hierarchy_depth_inter);
 
   // max_transform_hierarchy_depth_intra  ue(v)
   if (!bit_buffer->ReadExponentialGolomb(
           sps->max_transform_hierarchy_depth_intra)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "max_transform_hierarchy_depth_intra",
+                sps->max_transform_hierarchy_depth_intra);
 
   // scaling_list_enabled_flag  u(1)
   if (!bit_buffer->ReadBits(1, sps->scaling_list_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "scaling_list_enabled_flag", 1,
+               sps->scaling_list_enabled_flag);
 
   if (sps->scaling_list_enabled_flag) {
     // sps_scaling_list_data_present_flag  u(1)
     if (!bit_buffer->ReadBits(1, sps->sps_scaling_list_data_present_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "sps_scaling_list_data_present_flag", 1,
+                 sps->sps_scaling_list_data_present_flag);
     if (sps->sps_scaling_list_data_present_flag) {
       // scaling_list_data()
       sps->scaling_list_data =
@@ -380,58 +398,72 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
   if (!bit_buffer->ReadBits(1, sps->amp_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "amp_enabled_flag", 1, sps->amp_enabled_flag);
 
   // sample_adaptive_offset_enabled_flag  u(1)
   if (!bit_buffer->ReadBits(1, sps->sample_adaptive_offset_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "sample_adaptive_offset_enabled_flag", 1,
+               sps->sample_adaptive_offset_enabled_flag);
 
   // pcm_enabled_flag  u(1)
   if (!bit_buffer->ReadBits(1, sps->pcm_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "pcm_enabled_flag", 1, sps->pcm_enabled_flag);
 
   if (sps->pcm_enabled_flag) {
     // pcm_sample_bit_depth_luma_minus1  u(4)
     if (!bit_buffer->ReadBits(4, sps->pcm_sample_bit_depth_luma_minus1)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "pcm_sample_bit_depth_luma_minus1", 4,
+                 sps->pcm_sample_bit_depth_luma_minus1);
 
     // pcm_sample_bit_depth_chroma_minus1  u(4)
     if (!bit_buffer->ReadBits(4, sps->pcm_sample_bit_depth_chroma_minus1)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "pcm_sample_bit_depth_chroma_minus1", 4,
+                 sps->pcm_sample_bit_depth_chroma_minus1);
 
     // log2_min_pcm_luma_coding_block_size_minus3  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(
             sps->log2_min_pcm_luma_coding_block_size_minus3)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "log2_min_pcm_luma_coding_block_size_minus3",
+                  sps->log2_min_pcm_luma_coding_block_size_minus3);
 
     // log2_diff_max_min_pcm_luma_coding_block_size  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(
             sps->log2_diff_max_min_pcm_luma_coding_block_size)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "log2_diff_max_min_pcm_luma_coding_block_size",
+                  sps->log2_diff_max_min_pcm_luma_coding_block_size);
 
     // pcm_loop_filter_disabled_flag  u(1)
     if (!bit_buffer->ReadBits(1, sps->pcm_loop_filter_disabled_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "pcm_loop_filter_disabled_flag", 1,
+                 sps->pcm_loop_filter_disabled_flag);
   }
 
-  // num_short_term_ref_pic_sets
+  // num_short_term_ref_pic_sets  ue(v)
   if (!bit_buffer->ReadExponentialGolomb(sps->num_short_term_ref_pic_sets)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "num_short_term_ref_pic_sets",
+                sps->num_short_term_ref_pic_sets);
   if (sps->num_short_term_ref_pic_sets >
       h265limits::NUM_SHORT_TERM_REF_PIC_SETS_MAX) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "error: sps->num_short_term_ref_pic_sets == %" PRIu32
-            " > h265limits::NUM_SHORT_TERM_REF_PIC_SETS_MAX\n",
-            sps->num_short_term_ref_pic_sets);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "sps",
+                              "num_short_term_ref_pic_sets", bit_buffer,
+                              sps->num_short_term_ref_pic_sets, 0,
+                              h265limits::NUM_SHORT_TERM_REF_PIC_SETS_MAX);
     return nullptr;
   }
 
@@ -455,12 +487,16 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
   if (!bit_buffer->ReadBits(1, sps->long_term_ref_pics_present_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "long_term_ref_pics_present_flag", 1,
+               sps->long_term_ref_pics_present_flag);
 
   if (sps->long_term_ref_pics_present_flag) {
     // num_long_term_ref_pics_sps  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(sps->num_long_term_ref_pics_sps)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "num_long_term_ref_pics_sps",
+                  sps->num_long_term_ref_pics_sps);
     // num_long_term_ref_pics_sps must be in range 0-32 per spec
     if (sps->num_long_term_ref_pics_sps > 32) {
       return nullptr;
@@ -472,12 +508,15 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
                                 bits_tmp)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "lt_ref_pic_poc_lsb_sps",
+                   sps->log2_max_pic_order_cnt_lsb_minus4 + 4, bits_tmp, i);
       sps->lt_ref_pic_poc_lsb_sps.push_back(bits_tmp);
 
       // used_by_curr_pic_lt_sps_flag[i]  u(1)
       if (!bit_buffer->ReadBits(1, bits_tmp)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "used_by_curr_pic_lt_sps_flag", 1, bits_tmp, i);
       sps->used_by_curr_pic_lt_sps_flag.push_back(bits_tmp);
     }
   }
@@ -486,16 +525,22 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
   if (!bit_buffer->ReadBits(1, sps->sps_temporal_mvp_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "sps_temporal_mvp_enabled_flag", 1,
+               sps->sps_temporal_mvp_enabled_flag);
 
   // strong_intra_smoothing_enabled_flag  u(1)
   if (!bit_buffer->ReadBits(1, sps->strong_intra_smoothing_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "strong_intra_smoothing_enabled_flag", 1,
+               sps->strong_intra_smoothing_enabled_flag);
 
   // vui_parameters_present_flag  u(1)
   if (!bit_buffer->ReadBits(1, sps->vui_parameters_present_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "vui_parameters_present_flag", 1,
+               sps->vui_parameters_present_flag);
 
   if (sps->vui_parameters_present_flag) {
     // vui_parameters()
@@ -510,32 +555,44 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
   if (!bit_buffer->ReadBits(1, sps->sps_extension_present_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "sps_extension_present_flag", 1,
+               sps->sps_extension_present_flag);
 
   if (sps->sps_extension_present_flag) {
     // sps_range_extension_flag  u(1)
     if (!bit_buffer->ReadBits(1, sps->sps_range_extension_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "sps_range_extension_flag", 1,
+                 sps->sps_range_extension_flag);
 
     // sps_multilayer_extension_flag  u(1)
     if (!bit_buffer->ReadBits(1, sps->sps_multilayer_extension_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "sps_multilayer_extension_flag", 1,
+                 sps->sps_multilayer_extension_flag);
 
     // sps_3d_extension_flag  u(1)
     if (!bit_buffer->ReadBits(1, sps->sps_3d_extension_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "sps_3d_extension_flag", 1,
+                 sps->sps_3d_extension_flag);
 
     // sps_scc_extension_flag  u(1)
     if (!bit_buffer->ReadBits(1, sps->sps_scc_extension_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "sps_scc_extension_flag", 1,
+                 sps->sps_scc_extension_flag);
 
     // sps_extension_4bits  u(4)
     if (!bit_buffer->ReadBits(4, sps->sps_extension_4bits)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "sps_extension_4bits", 4,
+                 sps->sps_extension_4bits);
   }
 
   if (sps->sps_range_extension_flag) {
@@ -581,6 +638,8 @@ std::shared_ptr<H265SpsParser::SpsState> H265SpsParser::ParseSps(
       if (!bit_buffer->ReadBits(1, sps->sps_extension_data_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "sps_extension_data_flag", 1,
+                   sps->sps_extension_data_flag);
     }
   }
 
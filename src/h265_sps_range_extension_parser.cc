@@ -12,6 +12,7 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_trace.h"
 
 namespace h265nal {
 
@@ -41,54 +42,72 @@ H265SpsRangeExtensionParser::ParseSpsRangeExtension(
           1, sps_range_extension->transform_skip_rotation_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "transform_skip_rotation_enabled_flag", 1,
+               sps_range_extension->transform_skip_rotation_enabled_flag);
 
   // transform_skip_context_enabled_flag  u(1)
   if (!bit_buffer->ReadBits(
           1, sps_range_extension->transform_skip_context_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "transform_skip_context_enabled_flag", 1,
+               sps_range_extension->transform_skip_context_enabled_flag);
 
   // implicit_rdpcm_enabled_flag  u(1)
   if (!bit_buffer->ReadBits(1,
                             sps_range_extension->implicit_rdpcm_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "implicit_rdpcm_enabled_flag", 1,
+               sps_range_extension->implicit_rdpcm_enabled_flag);
 
   // explicit_rdpcm_enabled_flag  u(1)
   if (!bit_buffer->ReadBits(1,
                             sps_range_extension->explicit_rdpcm_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "explicit_rdpcm_enabled_flag", 1,
+               sps_range_extension->explicit_rdpcm_enabled_flag);
 
   // extended_precision_processing_flag  u(1)
   if (!bit_buffer->ReadBits(
           1, sps_range_extension->extended_precision_processing_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "extended_precision_processing_flag", 1,
+               sps_range_extension->extended_precision_processing_flag);
 
   // intra_smoothing_disabled_flag  u(1)
   if (!bit_buffer->ReadBits(
           1, sps_range_extension->intra_smoothing_disabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "intra_smoothing_disabled_flag", 1,
+               sps_range_extension->intra_smoothing_disabled_flag);
 
   // high_precision_offsets_enabled_flag  u(1)
   if (!bit_buffer->ReadBits(
           1, sps_range_extension->high_precision_offsets_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "high_precision_offsets_enabled_flag", 1,
+               sps_range_extension->high_precision_offsets_enabled_flag);
 
   // persistent_rice_adaptation_enabled_flag  u(1)
   if (!bit_buffer->ReadBits(
           1, sps_range_extension->persistent_rice_adaptation_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "persistent_rice_adaptation_enabled_flag", 1,
+               sps_range_extension->persistent_rice_adaptation_enabled_flag);
 
   // cabac_bypass_alignment_enabled_flag  u(1)
   if (!bit_buffer->ReadBits(
           1, sps_range_extension->cabac_bypass_alignment_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "cabac_bypass_alignment_enabled_flag", 1,
+               sps_range_extension->cabac_bypass_alignment_enabled_flag);
 
   return sps_range_extension;
 }
@@ -12,6 +12,8 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_error.h"
+#include "h265_trace.h"
 
 namespace h265nal {
 
@@ -46,11 +48,15 @@ H265SpsSccExtensionParser::ParseSpsSccExtension(
                             sps_scc_extension->sps_curr_pic_ref_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "sps_curr_pic_ref_enabled_flag", 1,
+               sps_scc_extension->sps_curr_pic_ref_enabled_flag);
 
   // palette_mode_enabled_flag  u(1)
   if (!bit_buffer->ReadBits(1, sps_scc_extension->palette_mode_enabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "palette_mode_enabled_flag", 1,
+               sps_scc_extension->palette_mode_enabled_flag);
 
   if (sps_scc_extension->palette_mode_enabled_flag) {
     // palette_max_size  ue(v)
@@ -58,16 +64,14 @@ H265SpsSccExtensionParser::ParseSpsSccExtension(
             sps_scc_extension->palette_max_size)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "palette_max_size",
+                  sps_scc_extension->palette_max_size);
     if (sps_scc_extension->palette_max_size < kPaletteMaxSizeMin ||
         sps_scc_extension->palette_max_size > kPaletteMaxSizeMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid palette_max_size: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              sps_scc_extension->palette_max_size, kPaletteMaxSizeMin,
-              kPaletteMaxSizeMax);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "sps_scc_extension",
+                                "palette_max_size", bit_buffer,
+                                sps_scc_extension->palette_max_size,
+                                kPaletteMaxSizeMin, kPaletteMaxSizeMax);
       return nullptr;
     }
 
@@ -76,19 +80,17 @@ H265SpsSccExtensionParser::ParseSpsSccExtension(
             sps_scc_extension->delta_palette_max_predictor_size)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "delta_palette_max_predictor_size",
+                  sps_scc_extension->delta_palette_max_predictor_size);
     if (sps_scc_extension->delta_palette_max_predictor_size <
             kDeltaPaletteMaxPredictorSizeMin ||
         sps_scc_extension->delta_palette_max_predictor_size >
             kDeltaPaletteMaxPredictorSizeMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid delta_palette_max_predictor_size: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              sps_scc_extension->delta_palette_max_predictor_size,
-              kDeltaPaletteMaxPredictorSizeMin,
-              kDeltaPaletteMaxPredictorSizeMax);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(
+          H265ErrorCode_OutOfRange, "sps_scc_extension",
+          "delta_palette_max_predictor_size", bit_buffer,
+          sps_scc_extension->delta_palette_max_predictor_size,
+          kDeltaPaletteMaxPredictorSizeMin, kDeltaPaletteMaxPredictorSizeMax);
       return nullptr;
     }
 
@@ -98,6 +100,9 @@ H265SpsSccExtensionParser::ParseSpsSccExtension(
                    ->sps_palette_predictor_initializers_present_flag)) {
       return nullptr;
     }
+    H265Trace::u(
+        bit_buffer, "sps_palette_predictor_initializers_present_flag", 1,
+        sps_scc_extension->sps_palette_predictor_initializers_present_flag);
 
     if (sps_scc_extension->sps_palette_predictor_initializers_present_flag) {
       // sps_num_palette_predictor_initializers_minus1  ue(v)
@@ -106,20 +111,19 @@ H265SpsSccExtensionParser::ParseSpsSccExtension(
                   ->sps_num_palette_predictor_initializers_minus1)) {
         return nullptr;
       }
+      H265Trace::ue(
+          bit_buffer, "sps_num_palette_predictor_initializers_minus1",
+          sps_scc_extension->sps_num_palette_predictor_initializers_minus1);
       if (sps_scc_extension->sps_num_palette_predictor_initializers_minus1 <
               kSpsNumPalettePredictorInitializersMinus1Min ||
           sps_scc_extension->sps_num_palette_predictor_initializers_minus1 >
               kSpsNumPalettePredictorInitializersMinus1Max) {
-#ifdef FPRINT_ERRORS
-        fprintf(
-            stderr,
-            "invalid sps_num_palette_predictor_initializers_minus1: %" PRIu32
-            " not in range "
-            "[%" PRIu32 ", %" PRIu32 "]\n",
+        H265ErrorReporter::Report(
+            H265ErrorCode_OutOfRange, "sps_scc_extension",
+            "sps_num_palette_predictor_initializers_minus1", bit_buffer,
             sps_scc_extension->sps_num_palette_predictor_initializers_minus1,
             kSpsNumPalettePredictorInitializersMinus1Min,
             kSpsNumPalettePredictorInitializersMinus1Max);
-#endif  // FPRINT_ERRORS
         return nullptr;
       }
 
@@ -140,6 +144,8 @@ H265SpsSccExtensionParser::ParseSpsSccExtension(
           if (!bit_buffer->ReadBits(bit_depth, bits_tmp)) {
             return nullptr;
           }
+          H265Trace::u(bit_buffer, "sps_palette_predictor_initializers",
+                       bit_depth, bits_tmp, comp, i);
           sps_scc_extension->sps_palette_predictor_initializers[comp].push_back(
               bits_tmp);
         }
@@ -152,12 +158,16 @@ H265SpsSccExtensionParser::ParseSpsSccExtension(
           2, sps_scc_extension->motion_vector_resolution_control_idc)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "motion_vector_resolution_control_idc", 2,
+               sps_scc_extension->motion_vector_resolution_control_idc);
 
   // intra_boundary_filtering_disabled_flag  u(1)
   if (!bit_buffer->ReadBits(
           1, sps_scc_extension->intra_boundary_filtering_disabled_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "intra_boundary_filtering_disabled_flag", 1,
+               sps_scc_extension->intra_boundary_filtering_disabled_flag);
 
   return sps_scc_extension;
 }
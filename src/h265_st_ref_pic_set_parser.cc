@@ -12,6 +12,9 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_error.h"
+#include "h265_parser_context.h"
+#include "h265_trace.h"
 
 namespace h265nal {
 
@@ -169,19 +172,17 @@ H265StRefPicSetParser::ParseStRefPicSet(
 
   if (num_short_term_ref_pic_sets >
       h265limits::NUM_SHORT_TERM_REF_PIC_SETS_MAX) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "error: num_short_term_ref_pic_sets == %" PRIu32
-            " > h265limits::NUM_SHORT_TERM_REF_PIC_SETS_MAX\n",
-            num_short_term_ref_pic_sets);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "st_ref_pic_set",
+                              "num_short_term_ref_pic_sets", bit_buffer,
+                              num_short_term_ref_pic_sets, 0,
+                              h265limits::NUM_SHORT_TERM_REF_PIC_SETS_MAX);
     return nullptr;
   }
 
   // H265 st_ref_pic_set() NAL Unit.
   // Section 7.3.7 ("Short-term reference picture set syntax parameter set
   // syntax") of the H.265 standard for a complete description.
-  auto st_ref_pic_set = std::make_unique<StRefPicSetState>();
+  auto st_ref_pic_set = H265ParserContext::MakeState<StRefPicSetState>();
 
   st_ref_pic_set->stRpsIdx = stRpsIdx;
   st_ref_pic_set->num_short_term_ref_pic_sets = num_short_term_ref_pic_sets;
@@ -192,6 +193,8 @@ H265StRefPicSetParser::ParseStRefPicSet(
             1, st_ref_pic_set->inter_ref_pic_set_prediction_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "inter_ref_pic_set_prediction_flag", 1,
+                 st_ref_pic_set->inter_ref_pic_set_prediction_flag);
   }
 
   if (st_ref_pic_set->inter_ref_pic_set_prediction_flag) {
@@ -201,17 +204,16 @@ H265StRefPicSetParser::ParseStRefPicSet(
               st_ref_pic_set->delta_idx_minus1)) {
         return nullptr;
       }
+      H265Trace::ue(bit_buffer, "delta_idx_minus1",
+                    st_ref_pic_set->delta_idx_minus1);
     }
     if (st_ref_pic_set->delta_idx_minus1 < kDeltaIdxMinus1Min ||
         st_ref_pic_set->delta_idx_minus1 > (st_ref_pic_set->stRpsIdx - 1)) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid delta_idx_minus1: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              st_ref_pic_set->delta_idx_minus1, kDeltaIdxMinus1Min,
-              st_ref_pic_set->stRpsIdx - 1);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "st_ref_pic_set",
+                                "delta_idx_minus1", bit_buffer,
+                                st_ref_pic_set->delta_idx_minus1,
+                                kDeltaIdxMinus1Min,
+                                st_ref_pic_set->stRpsIdx - 1);
       return nullptr;
     }
 
@@ -219,22 +221,22 @@ H265StRefPicSetParser::ParseStRefPicSet(
     if (!bit_buffer->ReadBits(1, st_ref_pic_set->delta_rps_sign)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "delta_rps_sign", 1,
+                 st_ref_pic_set->delta_rps_sign);
 
     // abs_delta_rps_minus1  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(
             st_ref_pic_set->abs_delta_rps_minus1)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "abs_delta_rps_minus1",
+                  st_ref_pic_set->abs_delta_rps_minus1);
     if (st_ref_pic_set->abs_delta_rps_minus1 < kAbsDeltaRpsMinus1Min ||
         st_ref_pic_set->abs_delta_rps_minus1 > kAbsDeltaRpsMinus1Max) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid abs_delta_rps_minus1: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              st_ref_pic_set->abs_delta_rps_minus1, kAbsDeltaRpsMinus1Min,
-              kAbsDeltaRpsMinus1Max);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "st_ref_pic_set",
+                                "abs_delta_rps_minus1", bit_buffer,
+                                st_ref_pic_set->abs_delta_rps_minus1,
+                                kAbsDeltaRpsMinus1Min, kAbsDeltaRpsMinus1Max);
       return nullptr;
     }
 
@@ -258,6 +260,7 @@ H265StRefPicSetParser::ParseStRefPicSet(
       if (!bit_buffer->ReadBits(1, bits_tmp)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "used_by_curr_pic_flag", 1, bits_tmp, j);
       st_ref_pic_set->used_by_curr_pic_flag.push_back(bits_tmp);
 
       if (!st_ref_pic_set->used_by_curr_pic_flag.back()) {
@@ -265,6 +268,7 @@ H265StRefPicSetParser::ParseStRefPicSet(
         if (!bit_buffer->ReadBits(1, bits_tmp)) {
           return nullptr;
         }
+        H265Trace::u(bit_buffer, "use_delta_flag", 1, bits_tmp, j);
       } else {
         // default use_delta_flag value (page 103)
         bits_tmp = 1;
@@ -281,16 +285,14 @@ H265StRefPicSetParser::ParseStRefPicSet(
     if (!bit_buffer->ReadExponentialGolomb(st_ref_pic_set->num_negative_pics)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "num_negative_pics",
+                  st_ref_pic_set->num_negative_pics);
     if (st_ref_pic_set->num_negative_pics < kNumNegativePicsMin ||
         st_ref_pic_set->num_negative_pics > max_num_pics) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid num_negative_pics: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              st_ref_pic_set->num_negative_pics, kNumNegativePicsMin,
-              max_num_pics);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "st_ref_pic_set",
+                                "num_negative_pics", bit_buffer,
+                                st_ref_pic_set->num_negative_pics,
+                                kNumNegativePicsMin, max_num_pics);
       return nullptr;
     }
 
@@ -298,17 +300,15 @@ H265StRefPicSetParser::ParseStRefPicSet(
     if (!bit_buffer->ReadExponentialGolomb(st_ref_pic_set->num_positive_pics)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "num_positive_pics",
+                  st_ref_pic_set->num_positive_pics);
     if (st_ref_pic_set->num_positive_pics < kNumPositivePicsMin ||
         st_ref_pic_set->num_positive_pics >
             (max_num_pics - st_ref_pic_set->num_negative_pics)) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid num_positive_pics: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              st_ref_pic_set->num_positive_pics, kNumPositivePicsMin,
-              max_num_pics - st_ref_pic_set->num_negative_pics);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(
+          H265ErrorCode_OutOfRange, "st_ref_pic_set", "num_positive_pics",
+          bit_buffer, st_ref_pic_set->num_positive_pics, kNumPositivePicsMin,
+          max_num_pics - st_ref_pic_set->num_negative_pics);
       return nullptr;
     }
 
@@ -317,12 +317,14 @@ H265StRefPicSetParser::ParseStRefPicSet(
       if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
         return nullptr;
       }
+      H265Trace::ue(bit_buffer, "delta_poc_s0_minus1", golomb_tmp, i);
       st_ref_pic_set->delta_poc_s0_minus1.push_back(golomb_tmp);
 
       // used_by_curr_pic_s0_flag[i] u(1)
       if (!bit_buffer->ReadBits(1, bits_tmp)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "used_by_curr_pic_s0_flag", 1, bits_tmp, i);
       st_ref_pic_set->used_by_curr_pic_s0_flag.push_back(bits_tmp);
     }
 
@@ -331,12 +333,14 @@ H265StRefPicSetParser::ParseStRefPicSet(
       if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
         return nullptr;
       }
+      H265Trace::ue(bit_buffer, "delta_poc_s1_minus1", golomb_tmp, i);
       st_ref_pic_set->delta_poc_s1_minus1.push_back(golomb_tmp);
 
       // used_by_curr_pic_s1_flag[i] u(1)
       if (!bit_buffer->ReadBits(1, bits_tmp)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "used_by_curr_pic_s1_flag", 1, bits_tmp, i);
       st_ref_pic_set->used_by_curr_pic_s1_flag.push_back(bits_tmp);
     }
   }
@@ -0,0 +1,149 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_sub_bitstream_extractor.h"
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+#include "h265_sei_parser.h"
+#include "h265_vps_parser.h"
+
+namespace {
+// NAL unit header size
+constexpr size_t kNalUnitHeaderSize = 2;
+// nuh_layer_id values (6 bits)
+constexpr uint32_t kMaxLayerId = 63;
+}  // namespace
+
+namespace h265nal {
+
+constexpr uint32_t H265SubBitstreamExtractor::kMaxTemporalId;
+
+H265SubBitstreamExtractor::H265SubBitstreamExtractor(const Options& options_in)
+    : options(options_in) {}
+
+size_t H265SubBitstreamExtractor::Extract(
+    const uint8_t* data, size_t length,
+    std::vector<BufferSegment>* spans) noexcept {
+  return Extract(data, length,
+                 H265BitstreamParser::FindNaluIndices(data, length), spans);
+}
+
+size_t H265SubBitstreamExtractor::Extract(
+    const uint8_t* data, size_t length,
+    const std::vector<H265BitstreamParser::NaluIndex>& nalu_indices,
+    std::vector<BufferSegment>* spans) noexcept {
+  size_t size = 0;
+  bool merge = false;
+  for (const auto& nalu_index : nalu_indices) {
+    if (nalu_index.payload_start_offset + nalu_index.payload_size > length) {
+      break;
+    }
+    if (!KeepNalUnit(data + nalu_index.payload_start_offset,
+                     nalu_index.payload_size)) {
+      merge = false;
+      continue;
+    }
+    // the span includes the start code
+    size_t span_length = nalu_index.payload_start_offset +
+                         nalu_index.payload_size - nalu_index.start_offset;
+    if (merge && spans->back().data + spans->back().length ==
+                     data + nalu_index.start_offset) {
+      spans->back().length += span_length;
+    } else {
+      spans->push_back({data + nalu_index.start_offset, span_length});
+    }
+    size += span_length;
+    merge = true;
+  }
+  return size;
+}
+
+bool H265SubBitstreamExtractor::KeepNalUnit(const uint8_t* data,
+                                            size_t length) noexcept {
+  stats.nal_units++;
+  if (length < kNalUnitHeaderSize) {
+    stats.nal_units_removed++;
+    return false;
+  }
+  // nal_unit_header() (Section 7.3.1.2)
+  uint32_t nal_unit_type = (data[0] >> 1) & 0x3f;
+  uint32_t nuh_layer_id = ((data[0] & 0x01) << 5) | (data[1] >> 3);
+  uint32_t nuh_temporal_id_plus1 = data[1] & 0x07;
+  if (nuh_temporal_id_plus1 == 0) {
+    stats.nal_units_removed++;
+    return false;
+  }
+  uint32_t temporal_id = nuh_temporal_id_plus1 - 1;
+
+  if (nal_unit_type == VPS_NUT) {
+    UpdateVps(data, length);
+  }
+  if (temporal_id > options.target_temporal_id ||
+      !(target_layer_ids & (1ull << nuh_layer_id))) {
+    stats.nal_units_removed++;
+    return false;
+  }
+  // the HRD SEI messages of the full bitstream do not apply to a subset of
+  // its sub-layers
+  if (nal_unit_type == PREFIX_SEI_NUT && nuh_layer_id == 0 &&
+      options.target_temporal_id < max_temporal_id &&
+      HasHrdSeiMessage(data, length)) {
+    stats.nal_units_removed++;
+    stats.sei_removed++;
+    return false;
+  }
+  return true;
+}
+
+void H265SubBitstreamExtractor::UpdateVps(const uint8_t* data,
+                                          size_t length) noexcept {
+  auto vps = H265VpsParser::ParseVps(data + kNalUnitHeaderSize,
+                                     length - kNalUnitHeaderSize);
+  if (vps == nullptr) {
+    return;
+  }
+  max_temporal_id = vps->vps_max_sub_layers_minus1;
+  // layer set 0 only includes the base layer (Section 7.4.3.1)
+  target_layer_ids = 1;
+  if (options.layer_set_idx == 0 ||
+      options.layer_set_idx > vps->layer_id_included_flag.size()) {
+    return;
+  }
+  const auto& layer_id_included_flag =
+      vps->layer_id_included_flag[options.layer_set_idx - 1];
+  target_layer_ids = 0;
+  for (uint32_t j = 0;
+       j < layer_id_included_flag.size() && j <= kMaxLayerId; j++) {
+    if (layer_id_included_flag[j]) {
+      target_layer_ids |= (1ull << j);
+    }
+  }
+}
+
+bool H265SubBitstreamExtractor::HasHrdSeiMessage(const uint8_t* data,
+                                                 size_t length) noexcept {
+  UnescapeRbsp(data + kNalUnitHeaderSize, length - kNalUnitHeaderSize,
+               &rbsp_buffer);
+  H265SeiMessageIterator it(rbsp_buffer.data(), rbsp_buffer.size());
+  H265SeiMessageIterator::SeiMessage sei_message;
+  while (it.Next(&sei_message)) {
+    if (sei_message.payload_type ==
+            static_cast<uint32_t>(SeiType::buffering_period) ||
+        sei_message.payload_type ==
+            static_cast<uint32_t>(SeiType::pic_timing) ||
+        sei_message.payload_type ==
+            static_cast<uint32_t>(SeiType::decoding_unit_info)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace h265nal
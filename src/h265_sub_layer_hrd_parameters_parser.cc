@@ -11,6 +11,7 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_trace.h"
 
 namespace h265nal {
 
@@ -54,12 +55,14 @@ H265SubLayerHrdParametersParser::ParseSubLayerHrdParameters(
     if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "bit_rate_value_minus1", golomb_tmp, i);
     sub_layer_hrd_parameters->bit_rate_value_minus1.push_back(golomb_tmp);
 
     // cpb_size_value_minus1[i]  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "cpb_size_value_minus1", golomb_tmp, i);
     sub_layer_hrd_parameters->cpb_size_value_minus1.push_back(golomb_tmp);
 
     if (sub_pic_hrd_params_present_flag) {
@@ -67,12 +70,14 @@ H265SubLayerHrdParametersParser::ParseSubLayerHrdParameters(
       if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
         return nullptr;
       }
+      H265Trace::ue(bit_buffer, "cpb_size_du_value_minus1", golomb_tmp, i);
       sub_layer_hrd_parameters->cpb_size_du_value_minus1.push_back(golomb_tmp);
 
       // bit_rate_du_value_minus1[i]  ue(v)
       if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
         return nullptr;
       }
+      H265Trace::ue(bit_buffer, "bit_rate_du_value_minus1", golomb_tmp, i);
       sub_layer_hrd_parameters->bit_rate_du_value_minus1.push_back(golomb_tmp);
     } else {
       sub_layer_hrd_parameters->cpb_size_du_value_minus1.push_back(0);
@@ -83,6 +88,7 @@ H265SubLayerHrdParametersParser::ParseSubLayerHrdParameters(
     if (!bit_buffer->ReadBits(1, bits_tmp)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "cbr_flag", 1, bits_tmp, i);
     sub_layer_hrd_parameters->cbr_flag.push_back(bits_tmp);
   }
 
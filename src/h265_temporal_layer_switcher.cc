@@ -0,0 +1,127 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_temporal_layer_switcher.h"
+
+#include <stdio.h>
+
+#include <cstdint>
+
+#include "h265_common.h"
+
+namespace h265nal {
+
+constexpr uint32_t H265TemporalLayerSwitcher::kMaxTemporalId;
+
+H265TemporalLayerSwitcher::H265TemporalLayerSwitcher(
+    uint32_t target_temporal_id_value)
+    : target_temporal_id(target_temporal_id_value > kMaxTemporalId
+                             ? kMaxTemporalId
+                             : target_temporal_id_value),
+      current_temporal_id(target_temporal_id) {}
+
+void H265TemporalLayerSwitcher::SetTargetTemporalId(
+    uint32_t target_temporal_id_value) noexcept {
+  if (target_temporal_id_value > kMaxTemporalId) {
+    target_temporal_id_value = kMaxTemporalId;
+  }
+  target_temporal_id = target_temporal_id_value;
+  // switching down is always possible
+  if (target_temporal_id < current_temporal_id) {
+    current_temporal_id = target_temporal_id;
+    stats.switches_down++;
+  }
+}
+
+bool H265TemporalLayerSwitcher::ProcessNalUnit(const uint8_t* data,
+                                               size_t length) noexcept {
+  if (data == nullptr || length < 2) {
+    stats.dropped++;
+    return false;
+  }
+  // nal_unit_header() (Section 7.3.1.2)
+  uint32_t nal_unit_type = (data[0] >> 1) & 0x3f;
+  uint32_t nuh_temporal_id_plus1 = data[1] & 0x07;
+  if (nuh_temporal_id_plus1 == 0) {
+    stats.dropped++;
+    return false;
+  }
+  // first_slice_segment_in_pic_flag is the first slice segment header bit
+  bool first_slice_segment_in_pic_flag = (length > 2) && (data[2] & 0x80);
+  return ProcessNalUnit(nal_unit_type, nuh_temporal_id_plus1 - 1,
+                        first_slice_segment_in_pic_flag);
+}
+
+bool H265TemporalLayerSwitcher::ProcessNalUnit(
+    uint32_t nal_unit_type, uint32_t temporal_id,
+    bool first_slice_segment_in_pic_flag) noexcept {
+  bool forward =
+      Decide(nal_unit_type, temporal_id, first_slice_segment_in_pic_flag);
+  if (forward) {
+    stats.forwarded++;
+  } else {
+    stats.dropped++;
+  }
+  return forward;
+}
+
+#ifdef RTP_DEFINE
+bool H265TemporalLayerSwitcher::ProcessRtpPacket(
+    const RtpPacketDescriptor& descriptor) noexcept {
+  if (!descriptor.valid) {
+    stats.dropped++;
+    return false;
+  }
+  // an FU fragment other than the first one continues the current picture
+  // (start_of_frame is only set in the start fragment)
+  return ProcessNalUnit(descriptor.nal_unit_type, descriptor.temporal_id,
+                        descriptor.start_of_frame != 0);
+}
+#endif  // RTP_DEFINE
+
+bool H265TemporalLayerSwitcher::Decide(
+    uint32_t nal_unit_type, uint32_t temporal_id,
+    bool first_slice_segment_in_pic_flag) noexcept {
+  if (!IsNalUnitTypeVcl(nal_unit_type)) {
+    // a suffix SEI belongs to the current picture
+    if (nal_unit_type == NalUnitType::SUFFIX_SEI_NUT && in_picture) {
+      return picture_forwarded;
+    }
+    return temporal_id <= current_temporal_id;
+  }
+
+  if (in_picture && !first_slice_segment_in_pic_flag) {
+    // remaining slice segments follow the decision for the first one
+    return picture_forwarded;
+  }
+
+  // start of a picture: check for a switching point (Section 7.4.2.2)
+  if (target_temporal_id > current_temporal_id) {
+    if (nal_unit_type >= NalUnitType::BLA_W_LP &&
+        nal_unit_type <= NalUnitType::RSV_IRAP_VCL23) {
+      // IRAP pictures reset the prediction structure
+      current_temporal_id = target_temporal_id;
+      stats.switches_up++;
+    } else if (temporal_id == current_temporal_id + 1) {
+      if (nal_unit_type == NalUnitType::TSA_N ||
+          nal_unit_type == NalUnitType::TSA_R) {
+        // TSA: no picture at or above this layer references a picture at
+        // or above this layer that precedes the TSA picture
+        current_temporal_id = target_temporal_id;
+        stats.switches_up++;
+      } else if (nal_unit_type == NalUnitType::STSA_N ||
+                 nal_unit_type == NalUnitType::STSA_R) {
+        // STSA: same, but only for this layer
+        current_temporal_id = temporal_id;
+        stats.switches_up++;
+      }
+    }
+  }
+
+  in_picture = true;
+  picture_forwarded = (temporal_id <= current_temporal_id);
+  return picture_forwarded;
+}
+
+}  // namespace h265nal
@@ -0,0 +1,98 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_trace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <cinttypes>
+#include <cstdint>
+
+#include "h265_common.h"
+
+namespace {
+FILE* trace_outfp = nullptr;
+
+// Section names, as used by ffmpeg's cbs_h265.
+const char* NalUnitTypeToTraceHeader(uint32_t nal_unit_type) {
+  switch (nal_unit_type) {
+    case h265nal::VPS_NUT:
+      return "Video Parameter Set";
+    case h265nal::SPS_NUT:
+      return "Sequence Parameter Set";
+    case h265nal::PPS_NUT:
+      return "Picture Parameter Set";
+    case h265nal::AUD_NUT:
+      return "Access Unit Delimiter";
+    case h265nal::EOS_NUT:
+      return "End of Sequence";
+    case h265nal::EOB_NUT:
+      return "End of Bitstream";
+    case h265nal::FD_NUT:
+      return "Filler Data";
+    case h265nal::PREFIX_SEI_NUT:
+      return "Prefix Supplemental Enhancement Information";
+    case h265nal::SUFFIX_SEI_NUT:
+      return "Suffix Supplemental Enhancement Information";
+    default:
+      break;
+  }
+  if (h265nal::IsSliceSegment(nal_unit_type)) {
+    return "Slice Segment Header";
+  }
+  return "Unknown NAL Unit";
+}
+}  // namespace
+
+namespace h265nal {
+
+void H265TraceHeadersPolicy::SetOutput(FILE* outfp) { trace_outfp = outfp; }
+
+void H265TraceHeadersPolicy::NalUnit(uint32_t nal_unit_type) {
+  FILE* outfp = (trace_outfp != nullptr) ? trace_outfp : stderr;
+  fprintf(outfp, "%s\n", NalUnitTypeToTraceHeader(nal_unit_type));
+}
+
+void H265TraceHeadersPolicy::SyntaxElement(const char* name, uint64_t i,
+                                           uint64_t j,
+                                           TraceDescriptor descriptor,
+                                           size_t bit_offset, size_t bit_count,
+                                           int64_t value) {
+  FILE* outfp = (trace_outfp != nullptr) ? trace_outfp : stderr;
+
+  // element name, including subscripts
+  char full_name[128];
+  if (i == H265Trace::kNoIndex) {
+    snprintf(full_name, sizeof(full_name), "%s", name);
+  } else if (j == H265Trace::kNoIndex) {
+    snprintf(full_name, sizeof(full_name), "%s[%" PRIu64 "]", name, i);
+  } else {
+    snprintf(full_name, sizeof(full_name), "%s[%" PRIu64 "][%" PRIu64 "]",
+             name, i, j);
+  }
+
+  // rebuild the actual bits read from the value
+  uint64_t code = static_cast<uint64_t>(value);
+  if (descriptor == TraceDescriptor_ue) {
+    code = code + 1;
+  } else if (descriptor == TraceDescriptor_se) {
+    code = (value > 0) ? (2 * code) : (2 * static_cast<uint64_t>(-value) + 1);
+  }
+  char bits[65];
+  size_t len = (bit_count > 64) ? 64 : bit_count;
+  for (size_t k = 0; k < len; k++) {
+    bits[k] = ((code >> (len - 1 - k)) & 0x1) ? '1' : '0';
+  }
+  bits[len] = '\0';
+
+  // same layout as ffmpeg's ff_cbs_trace_syntax_element()
+  size_t name_len = strlen(full_name);
+  int pad = (name_len + len > 60) ? static_cast<int>(len + 2)
+                                  : static_cast<int>(61 - name_len);
+  fprintf(outfp, "%-10zu  %s%*s = %" PRId64 "\n", bit_offset, full_name, pad,
+          bits, value);
+}
+
+}  // namespace h265nal
@@ -0,0 +1,485 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_ts_demuxer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "h265_common.h"
+#include "h265_utils.h"
+
+namespace {
+constexpr uint8_t kSyncByte = 0x47;
+constexpr uint32_t kPatPid = 0x0000;
+constexpr uint32_t kNullPid = 0x1fff;
+constexpr uint32_t kTableIdPat = 0x00;
+constexpr uint32_t kTableIdPmt = 0x02;
+// maximum PAT/PMT section size (section_length is at most 1021)
+constexpr size_t kMaxSectionSize = 1024;
+// section header (up to last_section_number) and CRC_32
+constexpr size_t kSectionHeaderSize = 8;
+constexpr size_t kSectionCrcSize = 4;
+// PES header, up to PES_header_data_length
+constexpr size_t kPesHeaderSize = 9;
+// maximum PES header size (PES_header_data_length is 8 bits)
+constexpr size_t kMaxPesHeaderSize = kPesHeaderSize + 255;
+// chunk size when reading from stdin
+constexpr size_t kReadChunkSize = h265nal::H265TsDemuxer::kPacketSize * 1024;
+
+uint32_t ReadU16(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 8) | static_cast<uint32_t>(p[1]);
+}
+
+// PTS/DTS field (ISO/IEC 13818-1 Section 2.4.3.7)
+uint64_t ReadTimestamp(const uint8_t* p) {
+  return (static_cast<uint64_t>((p[0] >> 1) & 0x07) << 30) |
+         (static_cast<uint64_t>(p[1]) << 22) |
+         (static_cast<uint64_t>(p[2] >> 1) << 15) |
+         (static_cast<uint64_t>(p[3]) << 7) | static_cast<uint64_t>(p[4] >> 1);
+}
+
+// MPEG-2 CRC-32 (ISO/IEC 13818-1 Annex A). A section including its
+// CRC_32 field has a CRC of 0.
+uint32_t Crc32(const uint8_t* data, size_t length) {
+  uint32_t crc = 0xffffffff;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= static_cast<uint32_t>(data[i]) << 24;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80000000) ? ((crc << 1) ^ 0x04c11db7) : (crc << 1);
+    }
+  }
+  return crc;
+}
+}  // namespace
+
+namespace h265nal {
+
+constexpr size_t H265TsDemuxer::kPacketSize;
+constexpr uint32_t H265TsDemuxer::kStreamTypeHevc;
+
+H265TsDemuxer::H265TsDemuxer(const Options& options_in, Callback callback_in,
+                             void* opaque_in)
+    : options(options_in), callback(callback_in), opaque(opaque_in) {
+  pat_section.table_id = kTableIdPat;
+  pmt_section.table_id = kTableIdPmt;
+}
+
+void H265TsDemuxer::AddData(const uint8_t* data, size_t length) noexcept {
+  size_t offset = 0;
+  // complete the packet carried over from the previous chunk
+  if (partial_length > 0) {
+    size_t size = std::min(kPacketSize - partial_length, length);
+    memcpy(partial_packet + partial_length, data, size);
+    partial_length += size;
+    offset = size;
+    if (partial_length < kPacketSize) {
+      return;
+    }
+    ProcessPacket(partial_packet);
+    partial_length = 0;
+  }
+  bool resync = false;
+  while (offset < length) {
+    if (data[offset] != kSyncByte ||
+        (resync && length - offset > kPacketSize &&
+         data[offset + kPacketSize] != kSyncByte)) {
+      // re-synchronize on the next sync byte (followed by another sync
+      // byte, when in the chunk)
+      const void* sync =
+          memchr(data + offset + 1, kSyncByte, length - offset - 1);
+      size_t sync_offset =
+          (sync == nullptr)
+              ? length
+              : static_cast<size_t>(static_cast<const uint8_t*>(sync) - data);
+      stats.bytes_skipped += sync_offset - offset;
+      offset = sync_offset;
+      resync = true;
+      continue;
+    }
+    if (length - offset < kPacketSize) {
+      // keep the end of the chunk for later
+      partial_length = length - offset;
+      memcpy(partial_packet, data + offset, partial_length);
+      break;
+    }
+    ProcessPacket(data + offset);
+    offset += kPacketSize;
+    resync = false;
+  }
+}
+
+void H265TsDemuxer::Flush() noexcept {
+  for (auto& stream : streams) {
+    if (stream.pes_active) {
+      EmitPes(&stream);
+    }
+  }
+  partial_length = 0;
+}
+
+bool H265TsDemuxer::ProcessFile(const char* filename) noexcept {
+  if (strcmp(filename, "-") == 0) {
+    std::vector<uint8_t> buffer(kReadChunkSize);
+    size_t size;
+    while ((size = fread(buffer.data(), 1, buffer.size(), stdin)) > 0) {
+      AddData(buffer.data(), size);
+    }
+    if (ferror(stdin)) {
+      return false;
+    }
+  } else {
+    H265MappedFile file;
+    if (!file.Open(filename)) {
+      return false;
+    }
+    AddData(file.GetData(), file.GetLength());
+  }
+  Flush();
+  return true;
+}
+
+std::vector<uint32_t> H265TsDemuxer::GetPids() const noexcept {
+  std::vector<uint32_t> pids;
+  for (const auto& stream : streams) {
+    pids.push_back(stream.pid);
+  }
+  return pids;
+}
+
+void H265TsDemuxer::ProcessPacket(const uint8_t* packet) noexcept {
+  stats.packets++;
+  bool transport_error_indicator = (packet[1] & 0x80) != 0;
+  bool payload_unit_start_indicator = (packet[1] & 0x40) != 0;
+  uint32_t pid = ((packet[1] & 0x1f) << 8) | packet[2];
+  uint32_t adaptation_field_control = (packet[3] >> 4) & 0x03;
+  int32_t continuity_counter = packet[3] & 0x0f;
+  if (pid == kNullPid) {
+    return;
+  }
+  Stream* stream = GetStream(pid);
+  if (transport_error_indicator || adaptation_field_control == 0) {
+    stats.packets_invalid++;
+    if (stream != nullptr) {
+      SignalLoss(stream);
+    }
+    return;
+  }
+
+  // adaptation field
+  size_t offset = 4;
+  bool discontinuity_indicator = false;
+  bool random_access_indicator = false;
+  if (adaptation_field_control & 0x02) {
+    size_t adaptation_field_length = packet[4];
+    offset = 5 + adaptation_field_length;
+    if (offset > kPacketSize) {
+      stats.packets_invalid++;
+      if (stream != nullptr) {
+        SignalLoss(stream);
+      }
+      return;
+    }
+    if (adaptation_field_length > 0) {
+      discontinuity_indicator = (packet[5] & 0x80) != 0;
+      random_access_indicator = (packet[5] & 0x40) != 0;
+    }
+  }
+  if (!(adaptation_field_control & 0x01)) {
+    // no payload (the continuity counter does not change)
+    return;
+  }
+  const uint8_t* payload = packet + offset;
+  size_t payload_length = kPacketSize - offset;
+
+  if (pid == kPatPid) {
+    ProcessSectionPayload(&pat_section, payload_unit_start_indicator, payload,
+                          payload_length);
+    return;
+  }
+  if (has_pmt_pid && pid == pmt_pid) {
+    ProcessSectionPayload(&pmt_section, payload_unit_start_indicator, payload,
+                          payload_length);
+    return;
+  }
+  if (stream == nullptr) {
+    return;
+  }
+
+  // continuity counter (Section 2.4.3.3)
+  if (stream->continuity_counter >= 0 && !discontinuity_indicator) {
+    if (continuity_counter == stream->continuity_counter) {
+      // duplicate packet
+      return;
+    }
+    if (continuity_counter != ((stream->continuity_counter + 1) & 0x0f)) {
+      stats.continuity_errors++;
+      SignalLoss(stream);
+    }
+  }
+  stream->continuity_counter = continuity_counter;
+  ProcessPesPayload(stream, payload_unit_start_indicator,
+                    random_access_indicator, payload, payload_length);
+}
+
+void H265TsDemuxer::ProcessSectionPayload(Section* section, bool unit_start,
+                                          const uint8_t* payload,
+                                          size_t length) noexcept {
+  if (!unit_start) {
+    if (section->active) {
+      AppendSection(section, payload, length);
+    }
+    return;
+  }
+  if (length < 1) {
+    return;
+  }
+  // the pointer_field skips the end of the previous section
+  size_t pointer_field = payload[0];
+  payload++;
+  length--;
+  if (pointer_field > length) {
+    section->active = false;
+    return;
+  }
+  if (section->active) {
+    AppendSection(section, payload, pointer_field);
+    section->active = false;
+  }
+  payload += pointer_field;
+  length -= pointer_field;
+  // new sections (until the stuffing bytes)
+  while (length > 0 && payload[0] != 0xff) {
+    section->buffer.clear();
+    section->active = true;
+    size_t size = AppendSection(section, payload, length);
+    if (section->active) {
+      // continued in the next packet
+      break;
+    }
+    payload += size;
+    length -= size;
+  }
+}
+
+size_t H265TsDemuxer::AppendSection(Section* section, const uint8_t* data,
+                                    size_t length) noexcept {
+  auto& buffer = section->buffer;
+  size_t used = 0;
+  // table_id and section_length
+  while (buffer.size() < 3 && used < length) {
+    buffer.push_back(data[used++]);
+  }
+  if (buffer.size() < 3) {
+    return used;
+  }
+  size_t section_size = 3 + (ReadU16(buffer.data() + 1) & 0x0fff);
+  if (section_size > kMaxSectionSize) {
+    stats.sections_invalid++;
+    section->active = false;
+    return length;
+  }
+  size_t size = std::min(section_size - buffer.size(), length - used);
+  buffer.insert(buffer.end(), data + used, data + used + size);
+  used += size;
+  if (buffer.size() == section_size) {
+    section->active = false;
+    ProcessSection(*section);
+  }
+  return used;
+}
+
+void H265TsDemuxer::ProcessSection(const Section& section) noexcept {
+  const uint8_t* data = section.buffer.data();
+  size_t length = section.buffer.size();
+  if (length < kSectionHeaderSize + kSectionCrcSize ||
+      Crc32(data, length) != 0) {
+    stats.sections_invalid++;
+    return;
+  }
+  // table_id, and current_next_indicator (ignore the next tables)
+  if (data[0] != section.table_id || !(data[5] & 0x01)) {
+    return;
+  }
+  if (section.table_id == kTableIdPat) {
+    ProcessPat(data, length);
+  } else {
+    ProcessPmt(data, length);
+  }
+}
+
+void H265TsDemuxer::ProcessPat(const uint8_t* section,
+                               size_t length) noexcept {
+  // program loop (Section 2.4.4.3)
+  for (size_t offset = kSectionHeaderSize;
+       offset + 4 <= length - kSectionCrcSize; offset += 4) {
+    uint32_t program_number_in = ReadU16(section + offset);
+    uint32_t pid = ReadU16(section + offset + 2) & 0x1fff;
+    if (program_number_in == 0) {
+      // network PID
+      continue;
+    }
+    if (options.program_number != 0 &&
+        program_number_in != options.program_number) {
+      continue;
+    }
+    if (!has_pmt_pid || pid != pmt_pid ||
+        program_number_in != program_number) {
+      has_pmt_pid = true;
+      pmt_pid = pid;
+      program_number = program_number_in;
+      pmt_version = -1;
+      pmt_section.active = false;
+    }
+    return;
+  }
+}
+
+void H265TsDemuxer::ProcessPmt(const uint8_t* section,
+                               size_t length) noexcept {
+  // Section 2.4.4.8
+  if (ReadU16(section + 3) != program_number) {
+    return;
+  }
+  int32_t version_number = (section[5] >> 1) & 0x1f;
+  if (version_number == pmt_version) {
+    return;
+  }
+  pmt_version = version_number;
+  if (kSectionHeaderSize + 4 > length - kSectionCrcSize) {
+    return;
+  }
+  size_t program_info_length = ReadU16(section + 10) & 0x0fff;
+  size_t end = length - kSectionCrcSize;
+
+  // elementary stream loop
+  std::vector<uint32_t> pids;
+  for (size_t offset = kSectionHeaderSize + 4 + program_info_length;
+       offset + 5 <= end;) {
+    uint32_t stream_type = section[offset];
+    uint32_t pid = ReadU16(section + offset + 1) & 0x1fff;
+    size_t es_info_length = ReadU16(section + offset + 3) & 0x0fff;
+    offset += 5 + es_info_length;
+    if (stream_type == kStreamTypeHevc &&
+        (options.pid == 0 || pid == options.pid)) {
+      pids.push_back(pid);
+    }
+  }
+
+  // drop the streams that are gone, and add the new ones
+  for (auto it = streams.begin(); it != streams.end();) {
+    if (std::find(pids.begin(), pids.end(), it->pid) == pids.end()) {
+      if (it->pes_active) {
+        EmitPes(&*it);
+      }
+      it = streams.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  for (uint32_t pid : pids) {
+    if (GetStream(pid) == nullptr) {
+      streams.emplace_back();
+      streams.back().pid = pid;
+    }
+  }
+}
+
+void H265TsDemuxer::ProcessPesPayload(Stream* stream, bool unit_start,
+                                      bool random_access,
+                                      const uint8_t* payload,
+                                      size_t length) noexcept {
+  if (unit_start) {
+    if (stream->pes_active) {
+      // unbounded PES packets end at the next one
+      EmitPes(stream);
+    }
+    stream->pes.clear();
+    stream->pes_active = true;
+    stream->random_access = random_access;
+  } else if (!stream->pes_active) {
+    // the start of the PES packet was lost (or it is complete)
+    return;
+  }
+  if (stream->pes.size() + length > options.max_pes_size + kMaxPesHeaderSize) {
+    SignalLoss(stream);
+    return;
+  }
+  stream->pes.insert(stream->pes.end(), payload, payload + length);
+
+  // bounded PES packets can be emitted as soon as they are complete
+  if (stream->pes.size() >= 6) {
+    size_t pes_packet_length = ReadU16(stream->pes.data() + 4);
+    if (pes_packet_length != 0 && stream->pes.size() >= 6 + pes_packet_length) {
+      EmitPes(stream);
+    }
+  }
+}
+
+void H265TsDemuxer::EmitPes(Stream* stream) noexcept {
+  stream->pes_active = false;
+  const uint8_t* pes = stream->pes.data();
+  size_t length = stream->pes.size();
+  // packet_start_code_prefix, and the '10' marker bits
+  if (length < kPesHeaderSize || pes[0] != 0x00 || pes[1] != 0x00 ||
+      pes[2] != 0x01 || (pes[6] & 0xc0) != 0x80) {
+    stats.access_units_dropped++;
+    return;
+  }
+  size_t pes_packet_length = ReadU16(pes + 4);
+  if (pes_packet_length != 0) {
+    if (6 + pes_packet_length > length) {
+      // truncated
+      stats.access_units_dropped++;
+      return;
+    }
+    length = 6 + pes_packet_length;
+  }
+  size_t header_size = kPesHeaderSize + pes[8];
+  if (header_size > length) {
+    stats.access_units_dropped++;
+    return;
+  }
+
+  AccessUnit access_unit;
+  access_unit.pid = stream->pid;
+  uint32_t pts_dts_flags = (pes[7] >> 6) & 0x03;
+  access_unit.has_pts = (pts_dts_flags & 0x02) && header_size >= 14;
+  access_unit.pts = access_unit.has_pts ? ReadTimestamp(pes + 9) : 0;
+  access_unit.dts = (pts_dts_flags == 0x03 && header_size >= 19)
+                        ? ReadTimestamp(pes + 14)
+                        : access_unit.pts;
+  access_unit.random_access = stream->random_access;
+  access_unit.after_loss = stream->after_loss;
+  access_unit.data = pes + header_size;
+  access_unit.length = length - header_size;
+  stream->after_loss = false;
+  stats.access_units++;
+  if (callback != nullptr) {
+    callback(access_unit, opaque);
+  }
+}
+
+void H265TsDemuxer::SignalLoss(Stream* stream) noexcept {
+  if (stream->pes_active) {
+    stats.access_units_dropped++;
+    stream->pes_active = false;
+  }
+  stream->after_loss = true;
+}
+
+H265TsDemuxer::Stream* H265TsDemuxer::GetStream(uint32_t pid) noexcept {
+  for (auto& stream : streams) {
+    if (stream.pid == pid) {
+      return &stream;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace h265nal
@@ -12,6 +12,13 @@
 #include <memory>
 #include <vector>
 
+#if !(defined WIN32 || defined _WIN32 || defined __CYGWIN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "h265_bitstream_parser.h"
 #include "h265_bitstream_parser_state.h"
 #include "h265_common.h"
@@ -42,20 +49,21 @@ namespace h265nal {
 // Calculate Luminance Slice QP values from slice header and PPS.
 namespace {
 // internal function
-std::unique_ptr<int32_t> GetSliceQpYInternal(
+bool GetSliceQpYInternal(
     uint32_t nal_unit_type,
-    std::unique_ptr<struct H265NalUnitPayloadParser::NalUnitPayloadState> const&
-        payload,
-    const struct H265BitstreamParserState* bitstream_parser_state) noexcept {
+    const struct H265NalUnitPayloadParser::NalUnitPayloadState* payload,
+    const struct H265BitstreamParserState* bitstream_parser_state,
+    int32_t* slice_qp_y) noexcept {
   // make sure the payload contains a slice header
   if (!IsSliceSegment(nal_unit_type)) {
-    return nullptr;
+    return false;
   }
 
   // check some values
   if ((payload == nullptr) || (payload->slice_segment_layer == nullptr) ||
-      (payload->slice_segment_layer->slice_segment_header == nullptr)) {
-    return nullptr;
+      (payload->slice_segment_layer->slice_segment_header == nullptr) ||
+      (bitstream_parser_state == nullptr)) {
+    return false;
   }
   auto& slice_header = payload->slice_segment_layer->slice_segment_header;
   auto pps_id = slice_header->slice_pic_parameter_set_id;
@@ -64,14 +72,26 @@ std::unique_ptr<int32_t> GetSliceQpYInternal(
   // check the PPS exists in the bitstream parser state
   auto pps = bitstream_parser_state->GetPps(pps_id);
   if (pps == nullptr) {
-    return nullptr;
+    return false;
   }
   const auto init_qp_minus26 = pps->init_qp_minus26;
 
   // Equation 7-54, Section 7.4.7.1
-  int32_t slice_qpy = 26 + init_qp_minus26 + slice_qp_delta;
+  *slice_qp_y = 26 + init_qp_minus26 + slice_qp_delta;
+  return true;
+}
 
-  return std::make_unique<int32_t>(slice_qpy);
+std::unique_ptr<int32_t> GetSliceQpYInternal(
+    uint32_t nal_unit_type,
+    std::unique_ptr<struct H265NalUnitPayloadParser::NalUnitPayloadState> const&
+        payload,
+    const struct H265BitstreamParserState* bitstream_parser_state) noexcept {
+  int32_t slice_qp_y = 0;
+  if (!GetSliceQpYInternal(nal_unit_type, payload.get(),
+                           bitstream_parser_state, &slice_qp_y)) {
+    return nullptr;
+  }
+  return std::make_unique<int32_t>(slice_qp_y);
 }
 }  // namespace
 
@@ -133,6 +153,18 @@ std::vector<int32_t> H265Utils::GetSliceQpY(
   return slice_qp_y_vector;
 }
 
+bool H265Utils::GetSliceQpY(
+    const H265NalUnitParser::NalUnitState& nal_unit,
+    const H265BitstreamParserState* bitstream_parser_state,
+    int32_t* slice_qp_y) noexcept {
+  if (nal_unit.nal_unit_header == nullptr) {
+    return false;
+  }
+  return GetSliceQpYInternal(nal_unit.nal_unit_header->nal_unit_type,
+                             nal_unit.nal_unit_payload.get(),
+                             bitstream_parser_state, slice_qp_y);
+}
+
 int H265Utils::ReadFile(const char* filename, std::vector<uint8_t>& buffer) {
   // TODO(chemag): read the infile incrementally
   FILE* infp = nullptr;
@@ -172,4 +204,137 @@ int H265Utils::ReadFile(const char* filename, std::vector<uint8_t>& buffer) {
   return 0;
 }
 
+bool H265PocCalculator::Update(
+    const H265NalUnitParser::NalUnitState& nal_unit_state) noexcept {
+  if (nal_unit_state.nal_unit_header == nullptr) {
+    return false;
+  }
+  uint32_t nal_unit_type = nal_unit_state.nal_unit_header->nal_unit_type;
+  if (nal_unit_type == NalUnitType::EOS_NUT) {
+    after_eos = true;
+    return false;
+  }
+  if (!IsSliceSegment(nal_unit_type) ||
+      nal_unit_state.nal_unit_payload == nullptr ||
+      nal_unit_state.nal_unit_payload->slice_segment_layer == nullptr) {
+    return false;
+  }
+  const auto& slice_segment_header =
+      nal_unit_state.nal_unit_payload->slice_segment_layer
+          ->slice_segment_header;
+  if (slice_segment_header == nullptr ||
+      !slice_segment_header->first_slice_segment_in_pic_flag) {
+    return false;
+  }
+
+  // Section 8.3.1
+  int32_t max_poc_lsb =
+      1 << (slice_segment_header->log2_max_pic_order_cnt_lsb_minus4 + 4);
+  int32_t poc_lsb =
+      static_cast<int32_t>(slice_segment_header->slice_pic_order_cnt_lsb);
+  bool irap = (nal_unit_type >= NalUnitType::BLA_W_LP &&
+               nal_unit_type <= NalUnitType::RSV_IRAP_VCL23);
+  // IDR and BLA pictures, and the first picture after an EOS (or in the
+  // stream), have NoRaslOutputFlag equal to 1
+  bool no_rasl_output_flag =
+      irap && (nal_unit_type <= NalUnitType::IDR_N_LP || after_eos ||
+               !has_poc);
+  int32_t poc_msb = 0;
+  if (!(irap && no_rasl_output_flag)) {
+    int32_t prev_poc_lsb = prev_tid0_poc & (max_poc_lsb - 1);
+    int32_t prev_poc_msb = prev_tid0_poc - prev_poc_lsb;
+    if ((poc_lsb < prev_poc_lsb) &&
+        ((prev_poc_lsb - poc_lsb) >= (max_poc_lsb / 2))) {
+      poc_msb = prev_poc_msb + max_poc_lsb;
+    } else if ((poc_lsb > prev_poc_lsb) &&
+               ((poc_lsb - prev_poc_lsb) > (max_poc_lsb / 2))) {
+      poc_msb = prev_poc_msb - max_poc_lsb;
+    } else {
+      poc_msb = prev_poc_msb;
+    }
+  }
+  poc = poc_msb + poc_lsb;
+  has_poc = true;
+  after_eos = false;
+
+  // prevTid0Pic: TemporalId 0, and not a RASL, RADL, or SLNR picture
+  uint32_t temporal_id =
+      nal_unit_state.nal_unit_header->nuh_temporal_id_plus1 - 1;
+  bool sub_layer_non_reference =
+      (nal_unit_type <= NalUnitType::RSV_VCL_N14) && (nal_unit_type % 2 == 0);
+  bool rasl_or_radl = (nal_unit_type >= NalUnitType::RADL_N &&
+                       nal_unit_type <= NalUnitType::RASL_R);
+  if (temporal_id == 0 && !sub_layer_non_reference && !rasl_or_radl) {
+    prev_tid0_poc = poc;
+  }
+  return true;
+}
+
+void H265PocCalculator::Reset() noexcept {
+  has_poc = false;
+  poc = 0;
+  prev_tid0_poc = 0;
+  after_eos = false;
+}
+
+H265MappedFile::~H265MappedFile() { Close(); }
+
+bool H265MappedFile::Open(const char* filename) noexcept {
+  Close();
+#if !(defined WIN32 || defined _WIN32 || defined __CYGWIN__)
+  // stdin ("-") cannot be mapped
+  if (filename != nullptr && !(strlen(filename) == 1 && filename[0] == '-')) {
+    return Map(filename);
+  }
+#endif
+  // no mmap (or stdin): read the whole file
+  if (H265Utils::ReadFile(filename, buffer) < 0) {
+    return false;
+  }
+  data = buffer.data();
+  length = buffer.size();
+  return true;
+}
+
+#if !(defined WIN32 || defined _WIN32 || defined __CYGWIN__)
+bool H265MappedFile::Map(const char* filename) noexcept {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Could not open input file: \"%s\"\n", filename);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    fprintf(stderr, "Could not determine file size: \"%s\"\n", filename);
+    close(fd);
+    return false;
+  }
+  size_t size = static_cast<size_t>(st.st_size);
+  void* ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (ptr == MAP_FAILED) {
+    fprintf(stderr, "Could not map input file: \"%s\"\n", filename);
+    return false;
+  }
+  // files are read once, front to back
+  madvise(ptr, size, MADV_SEQUENTIAL);
+  mapping = ptr;
+  data = static_cast<const uint8_t*>(ptr);
+  length = size;
+  return true;
+}
+#endif
+
+void H265MappedFile::Close() noexcept {
+#if !(defined WIN32 || defined _WIN32 || defined __CYGWIN__)
+  if (mapping != nullptr) {
+    munmap(mapping, length);
+  }
+#endif
+  mapping = nullptr;
+  buffer.clear();
+  data = nullptr;
+  length = 0;
+}
+
 }  // namespace h265nal
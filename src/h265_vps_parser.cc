@@ -11,8 +11,11 @@
 #include <memory>
 #include <vector>
 
+#include "h265_budget.h"
 #include "h265_common.h"
+#include "h265_error.h"
 #include "h265_hrd_parameters_parser.h"
+#include "h265_trace.h"
 
 namespace h265nal {
 
@@ -42,36 +45,50 @@ std::shared_ptr<H265VpsParser::VpsState> H265VpsParser::ParseVps(
   if (!bit_buffer->ReadBits(4, vps->vps_video_parameter_set_id)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "vps_video_parameter_set_id", 4,
+               vps->vps_video_parameter_set_id);
 
   // vps_base_layer_internal_flag  u(1)
   if (!bit_buffer->ReadBits(1, vps->vps_base_layer_internal_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "vps_base_layer_internal_flag", 1,
+               vps->vps_base_layer_internal_flag);
 
   // vps_base_layer_available_flag  u(1)
   if (!bit_buffer->ReadBits(1, vps->vps_base_layer_available_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "vps_base_layer_available_flag", 1,
+               vps->vps_base_layer_available_flag);
 
   // vps_max_layers_minus1  u(6)
   if (!bit_buffer->ReadBits(6, vps->vps_max_layers_minus1)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "vps_max_layers_minus1", 6,
+               vps->vps_max_layers_minus1);
 
   // vps_max_sub_layers_minus1  u(3)
   if (!bit_buffer->ReadBits(3, vps->vps_max_sub_layers_minus1)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "vps_max_sub_layers_minus1", 3,
+               vps->vps_max_sub_layers_minus1);
 
   // vps_temporal_id_nesting_flag  u(1)
   if (!bit_buffer->ReadBits(1, vps->vps_temporal_id_nesting_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "vps_temporal_id_nesting_flag", 1,
+               vps->vps_temporal_id_nesting_flag);
 
   // vps_reserved_0xffff_16bits  u(16)
   if (!bit_buffer->ReadBits(16, vps->vps_reserved_0xffff_16bits)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "vps_reserved_0xffff_16bits", 16,
+               vps->vps_reserved_0xffff_16bits);
 
   // profile_tier_level(1, vps_max_sub_layers_minus1)
   vps->profile_tier_level = H265ProfileTierLevelParser::ParseProfileTierLevel(
@@ -84,6 +101,8 @@ std::shared_ptr<H265VpsParser::VpsState> H265VpsParser::ParseVps(
   if (!bit_buffer->ReadBits(1, vps->vps_sub_layer_ordering_info_present_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "vps_sub_layer_ordering_info_present_flag", 1,
+               vps->vps_sub_layer_ordering_info_present_flag);
 
   for (uint32_t i = (vps->vps_sub_layer_ordering_info_present_flag
                          ? 0
@@ -93,16 +112,20 @@ std::shared_ptr<H265VpsParser::VpsState> H265VpsParser::ParseVps(
     if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "vps_max_dec_pic_buffering_minus1", golomb_tmp,
+                  i);
     vps->vps_max_dec_pic_buffering_minus1.push_back(golomb_tmp);
     // vps_max_num_reorder_pics[i]  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "vps_max_num_reorder_pics", golomb_tmp, i);
     vps->vps_max_num_reorder_pics.push_back(golomb_tmp);
     // vps_max_latency_increase_plus1[i]  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "vps_max_latency_increase_plus1", golomb_tmp, i);
     vps->vps_max_latency_increase_plus1.push_back(golomb_tmp);
   }
 
@@ -110,11 +133,12 @@ std::shared_ptr<H265VpsParser::VpsState> H265VpsParser::ParseVps(
   if (!bit_buffer->ReadBits(6, vps->vps_max_layer_id)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "vps_max_layer_id", 6, vps->vps_max_layer_id);
   if (vps->vps_max_layer_id > h265limits::VPS_MAX_LAYER_ID_MAX) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr, "error: vps->vps_max_layer_id value too large: %i\n",
-            vps->vps_max_layer_id);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "vps",
+                              "vps_max_layer_id", bit_buffer,
+                              vps->vps_max_layer_id, 0,
+                              h265limits::VPS_MAX_LAYER_ID_MAX);
     return nullptr;
   }
 
@@ -122,26 +146,33 @@ std::shared_ptr<H265VpsParser::VpsState> H265VpsParser::ParseVps(
   if (!bit_buffer->ReadExponentialGolomb(vps->vps_num_layer_sets_minus1)) {
     return nullptr;
   }
+  H265Trace::ue(bit_buffer, "vps_num_layer_sets_minus1",
+                vps->vps_num_layer_sets_minus1);
   if (vps->vps_num_layer_sets_minus1 < kVpsNumLayerSetsMinus1Min ||
       vps->vps_num_layer_sets_minus1 > kVpsNumLayerSetsMinus1Max) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "invalid vps_num_layer_sets_minus1: %" PRIu32
-            " not in range "
-            "[%" PRIu32 ", %" PRIu32 "]\n",
-            vps->vps_num_layer_sets_minus1, kVpsNumLayerSetsMinus1Min,
-            kVpsNumLayerSetsMinus1Max);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "vps",
+                              "vps_num_layer_sets_minus1", bit_buffer,
+                              vps->vps_num_layer_sets_minus1,
+                              kVpsNumLayerSetsMinus1Min,
+                              kVpsNumLayerSetsMinus1Max);
     return nullptr;
   }
 
   if (vps->vps_num_layer_sets_minus1 >
       h265limits::VPS_NUM_LAYER_SETS_MINUS1_MAX) {
-#ifdef FPRINT_ERRORS
-    fprintf(stderr,
-            "error: vps->vps_num_layer_sets_minus1 value too large: %i\n",
-            vps->vps_num_layer_sets_minus1);
-#endif  // FPRINT_ERRORS
+    H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "vps",
+                              "vps_num_layer_sets_minus1", bit_buffer,
+                              vps->vps_num_layer_sets_minus1, 0,
+                              h265limits::VPS_NUM_LAYER_SETS_MINUS1_MAX);
+    return nullptr;
+  }
+
+  if (!H265Budget::Charge(
+          "vps", "layer_id_included_flag", bit_buffer,
+          static_cast<uint64_t>(vps->vps_num_layer_sets_minus1) *
+              (vps->vps_max_layer_id + 1),
+          static_cast<uint64_t>(vps->vps_num_layer_sets_minus1) *
+              (vps->vps_max_layer_id + 1) * sizeof(uint32_t))) {
     return nullptr;
   }
 
@@ -152,6 +183,7 @@ std::shared_ptr<H265VpsParser::VpsState> H265VpsParser::ParseVps(
       if (!bit_buffer->ReadBits(1, bits_tmp)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "layer_id_included_flag", 1, bits_tmp, i, j);
       vps->layer_id_included_flag[i - 1].push_back(bits_tmp);
     }
   }
@@ -160,22 +192,29 @@ std::shared_ptr<H265VpsParser::VpsState> H265VpsParser::ParseVps(
   if (!bit_buffer->ReadBits(1, vps->vps_timing_info_present_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "vps_timing_info_present_flag", 1,
+               vps->vps_timing_info_present_flag);
 
   if (vps->vps_timing_info_present_flag) {
     // vps_num_units_in_tick  u(32)
     if (!bit_buffer->ReadBits(32, vps->vps_num_units_in_tick)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "vps_num_units_in_tick", 32,
+                 vps->vps_num_units_in_tick);
 
     // vps_time_scale  u(32)
     if (!bit_buffer->ReadBits(32, vps->vps_time_scale)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "vps_time_scale", 32, vps->vps_time_scale);
 
     // vps_poc_proportional_to_timing_flag  u(1)
     if (!bit_buffer->ReadBits(1, vps->vps_poc_proportional_to_timing_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "vps_poc_proportional_to_timing_flag", 1,
+                 vps->vps_poc_proportional_to_timing_flag);
 
     if (vps->vps_poc_proportional_to_timing_flag) {
       // vps_num_ticks_poc_diff_one_minus1  ue(v)
@@ -183,19 +222,18 @@ std::shared_ptr<H265VpsParser::VpsState> H265VpsParser::ParseVps(
               vps->vps_num_ticks_poc_diff_one_minus1)) {
         return nullptr;
       }
+      H265Trace::ue(bit_buffer, "vps_num_ticks_poc_diff_one_minus1",
+                    vps->vps_num_ticks_poc_diff_one_minus1);
       if (vps->vps_num_ticks_poc_diff_one_minus1 <
               kVpsNumTicksPocDiffOneMinus1Min ||
           vps->vps_num_ticks_poc_diff_one_minus1 >
               kVpsNumTicksPocDiffOneMinus1Max) {
-#ifdef FPRINT_ERRORS
-        fprintf(stderr,
-                "invalid vps_num_ticks_poc_diff_one_minus1: %" PRIu32
-                " not in range "
-                "[%" PRIu32 ", %" PRIu32 "]\n",
-                vps->vps_num_ticks_poc_diff_one_minus1,
-                kVpsNumTicksPocDiffOneMinus1Min,
-                kVpsNumTicksPocDiffOneMinus1Max);
-#endif  // FPRINT_ERRORS
+        H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "vps",
+                                  "vps_num_ticks_poc_diff_one_minus1",
+                                  bit_buffer,
+                                  vps->vps_num_ticks_poc_diff_one_minus1,
+                                  kVpsNumTicksPocDiffOneMinus1Min,
+                                  kVpsNumTicksPocDiffOneMinus1Max);
         return nullptr;
       }
     }
@@ -203,16 +241,22 @@ std::shared_ptr<H265VpsParser::VpsState> H265VpsParser::ParseVps(
     if (!bit_buffer->ReadExponentialGolomb(vps->vps_num_hrd_parameters)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "vps_num_hrd_parameters",
+                  vps->vps_num_hrd_parameters);
     if (vps->vps_num_hrd_parameters < kVpsNumHdrParameterMin ||
         vps->vps_num_hrd_parameters > vps->vps_num_layer_sets_minus1 + 1) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid vps_num_hrd_parameters: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vps->vps_num_hrd_parameters, kVpsNumHdrParameterMin,
-              vps->vps_num_layer_sets_minus1 + 1);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "vps",
+                                "vps_num_hrd_parameters", bit_buffer,
+                                vps->vps_num_hrd_parameters,
+                                kVpsNumHdrParameterMin,
+                                vps->vps_num_layer_sets_minus1 + 1);
+      return nullptr;
+    }
+
+    if (!H265Budget::Charge(
+            "vps", "hrd_parameters", bit_buffer, vps->vps_num_hrd_parameters,
+            static_cast<uint64_t>(vps->vps_num_hrd_parameters) *
+                sizeof(H265HrdParametersParser::HrdParametersState))) {
       return nullptr;
     }
 
@@ -221,6 +265,7 @@ std::shared_ptr<H265VpsParser::VpsState> H265VpsParser::ParseVps(
       if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
         return nullptr;
       }
+      H265Trace::ue(bit_buffer, "hrd_layer_set_idx", golomb_tmp, i);
       vps->hrd_layer_set_idx.push_back(golomb_tmp);
 
       if (i > 0) {
@@ -228,6 +273,7 @@ std::shared_ptr<H265VpsParser::VpsState> H265VpsParser::ParseVps(
         if (!bit_buffer->ReadExponentialGolomb(golomb_tmp)) {
           return nullptr;
         }
+        H265Trace::ue(bit_buffer, "cprms_present_flag", golomb_tmp, i);
         vps->cprms_present_flag.push_back(golomb_tmp);
       } else {
         vps->cprms_present_flag.push_back(0);
@@ -247,6 +293,7 @@ std::shared_ptr<H265VpsParser::VpsState> H265VpsParser::ParseVps(
   if (!bit_buffer->ReadBits(1, vps->vps_extension_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "vps_extension_flag", 1, vps->vps_extension_flag);
 
   if (vps->vps_extension_flag) {
     while (more_rbsp_data(bit_buffer)) {
@@ -254,6 +301,8 @@ std::shared_ptr<H265VpsParser::VpsState> H265VpsParser::ParseVps(
       if (!bit_buffer->ReadBits(1, vps->vps_extension_data_flag)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "vps_extension_data_flag", 1,
+                   vps->vps_extension_data_flag);
     }
   }
   rbsp_trailing_bits(bit_buffer);
@@ -12,7 +12,9 @@
 #include <vector>
 
 #include "h265_common.h"
+#include "h265_error.h"
 #include "h265_hrd_parameters_parser.h"
+#include "h265_trace.h"
 
 namespace h265nal {
 
@@ -45,21 +47,26 @@ H265VuiParametersParser::ParseVuiParameters(
   if (!bit_buffer->ReadBits(1, vui->aspect_ratio_info_present_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "aspect_ratio_info_present_flag", 1,
+               vui->aspect_ratio_info_present_flag);
 
   if (vui->aspect_ratio_info_present_flag) {
     // aspect_ratio_idc  u(8)
     if (!bit_buffer->ReadBits(8, vui->aspect_ratio_idc)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "aspect_ratio_idc", 8, vui->aspect_ratio_idc);
     if (vui->aspect_ratio_idc == AR_EXTENDED_SAR) {
       // sar_width  u(16)
       if (!bit_buffer->ReadBits(16, vui->sar_width)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "sar_width", 16, vui->sar_width);
       // sar_height  u(16)
       if (!bit_buffer->ReadBits(16, vui->sar_height)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "sar_height", 16, vui->sar_height);
     }
   }
 
@@ -67,45 +74,60 @@ H265VuiParametersParser::ParseVuiParameters(
   if (!bit_buffer->ReadBits(1, vui->overscan_info_present_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "overscan_info_present_flag", 1,
+               vui->overscan_info_present_flag);
 
   if (vui->overscan_info_present_flag) {
     // overscan_appropriate_flag  u(1)
     if (!bit_buffer->ReadBits(1, vui->overscan_appropriate_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "overscan_appropriate_flag", 1,
+                 vui->overscan_appropriate_flag);
   }
 
   // video_signal_type_present_flag  u(1)
   if (!bit_buffer->ReadBits(1, vui->video_signal_type_present_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "video_signal_type_present_flag", 1,
+               vui->video_signal_type_present_flag);
 
   if (vui->video_signal_type_present_flag) {
     // video_format  u(3)
     if (!bit_buffer->ReadBits(3, vui->video_format)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "video_format", 3, vui->video_format);
     // video_full_range_flag  u(1)
     if (!bit_buffer->ReadBits(1, vui->video_full_range_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "video_full_range_flag", 1,
+                 vui->video_full_range_flag);
     // colour_description_present_flag  u(1)
     if (!bit_buffer->ReadBits(1, vui->colour_description_present_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "colour_description_present_flag", 1,
+                 vui->colour_description_present_flag);
     if (vui->colour_description_present_flag) {
       // colour_primaries  u(8)
       if (!bit_buffer->ReadBits(8, vui->colour_primaries)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "colour_primaries", 8, vui->colour_primaries);
       // transfer_characteristics  u(8)
       if (!bit_buffer->ReadBits(8, vui->transfer_characteristics)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "transfer_characteristics", 8,
+                   vui->transfer_characteristics);
       // matrix_coeffs  u(8)
       if (!bit_buffer->ReadBits(8, vui->matrix_coeffs)) {
         return nullptr;
       }
+      H265Trace::u(bit_buffer, "matrix_coeffs", 8, vui->matrix_coeffs);
     }
   }
 
@@ -113,24 +135,25 @@ H265VuiParametersParser::ParseVuiParameters(
   if (!bit_buffer->ReadBits(1, vui->chroma_loc_info_present_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "chroma_loc_info_present_flag", 1,
+               vui->chroma_loc_info_present_flag);
   if (vui->chroma_loc_info_present_flag) {
     // chroma_sample_loc_type_top_field  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(
             vui->chroma_sample_loc_type_top_field)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "chroma_sample_loc_type_top_field",
+                  vui->chroma_sample_loc_type_top_field);
     if (vui->chroma_sample_loc_type_top_field <
             kChromaSampleLocTypeTopFieldMin ||
         vui->chroma_sample_loc_type_top_field >
             kChromaSampleLocTypeTopFieldMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid chroma_sample_loc_type_top_field: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vui->chroma_sample_loc_type_top_field,
-              kChromaSampleLocTypeTopFieldMin, kChromaSampleLocTypeTopFieldMax);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "vui_parameters",
+                                "chroma_sample_loc_type_top_field", bit_buffer,
+                                vui->chroma_sample_loc_type_top_field,
+                                kChromaSampleLocTypeTopFieldMin,
+                                kChromaSampleLocTypeTopFieldMax);
       return nullptr;
     }
 
@@ -139,19 +162,18 @@ H265VuiParametersParser::ParseVuiParameters(
             vui->chroma_sample_loc_type_bottom_field)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "chroma_sample_loc_type_bottom_field",
+                  vui->chroma_sample_loc_type_bottom_field);
     if (vui->chroma_sample_loc_type_bottom_field <
             kChromaSampleLocTypeBottomFieldMin ||
         vui->chroma_sample_loc_type_bottom_field >
             kChromaSampleLocTypeBottomFieldMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid chroma_sample_loc_type_bottom_field: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vui->chroma_sample_loc_type_bottom_field,
-              kChromaSampleLocTypeBottomFieldMin,
-              kChromaSampleLocTypeBottomFieldMax);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "vui_parameters",
+                                "chroma_sample_loc_type_bottom_field",
+                                bit_buffer,
+                                vui->chroma_sample_loc_type_bottom_field,
+                                kChromaSampleLocTypeBottomFieldMin,
+                                kChromaSampleLocTypeBottomFieldMax);
       return nullptr;
     }
   }
@@ -160,36 +182,42 @@ H265VuiParametersParser::ParseVuiParameters(
   if (!bit_buffer->ReadBits(1, vui->neutral_chroma_indication_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "neutral_chroma_indication_flag", 1,
+               vui->neutral_chroma_indication_flag);
 
   // field_seq_flag  u(1)
   if (!bit_buffer->ReadBits(1, vui->field_seq_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "field_seq_flag", 1, vui->field_seq_flag);
 
   // frame_field_info_present_flag  u(1)
   if (!bit_buffer->ReadBits(1, vui->frame_field_info_present_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "frame_field_info_present_flag", 1,
+               vui->frame_field_info_present_flag);
 
   // default_display_window_flag  u(1)
   if (!bit_buffer->ReadBits(1, vui->default_display_window_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "default_display_window_flag", 1,
+               vui->default_display_window_flag);
   if (vui->default_display_window_flag) {
     // def_disp_win_left_offset ue(v)
     if (!bit_buffer->ReadExponentialGolomb(vui->def_disp_win_left_offset)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "def_disp_win_left_offset",
+                  vui->def_disp_win_left_offset);
     if (vui->def_disp_win_left_offset < kDefDispWinLeftOffsetMin ||
         vui->def_disp_win_left_offset > kDefDispWinLeftOffsetMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid def_disp_win_left_offset: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vui->def_disp_win_left_offset, kDefDispWinLeftOffsetMin,
-              kDefDispWinLeftOffsetMax);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "vui_parameters",
+                                "def_disp_win_left_offset", bit_buffer,
+                                vui->def_disp_win_left_offset,
+                                kDefDispWinLeftOffsetMin,
+                                kDefDispWinLeftOffsetMax);
       return nullptr;
     }
 
@@ -197,16 +225,15 @@ H265VuiParametersParser::ParseVuiParameters(
     if (!bit_buffer->ReadExponentialGolomb(vui->def_disp_win_right_offset)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "def_disp_win_right_offset",
+                  vui->def_disp_win_right_offset);
     if (vui->def_disp_win_right_offset < kDefDispWinRightOffsetMin ||
         vui->def_disp_win_right_offset > kDefDispWinRightOffsetMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid def_disp_win_right_offset: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vui->def_disp_win_right_offset, kDefDispWinRightOffsetMin,
-              kDefDispWinRightOffsetMax);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "vui_parameters",
+                                "def_disp_win_right_offset", bit_buffer,
+                                vui->def_disp_win_right_offset,
+                                kDefDispWinRightOffsetMin,
+                                kDefDispWinRightOffsetMax);
       return nullptr;
     }
 
@@ -214,16 +241,15 @@ H265VuiParametersParser::ParseVuiParameters(
     if (!bit_buffer->ReadExponentialGolomb(vui->def_disp_win_top_offset)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "def_disp_win_top_offset",
+                  vui->def_disp_win_top_offset);
     if (vui->def_disp_win_top_offset < kDefDispWinTopOffsetMin ||
         vui->def_disp_win_top_offset > kDefDispWinTopOffsetMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid def_disp_win_top_offset: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vui->def_disp_win_top_offset, kDefDispWinTopOffsetMin,
-              kDefDispWinTopOffsetMax);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "vui_parameters",
+                                "def_disp_win_top_offset", bit_buffer,
+                                vui->def_disp_win_top_offset,
+                                kDefDispWinTopOffsetMin,
+                                kDefDispWinTopOffsetMax);
       return nullptr;
     }
 
@@ -231,16 +257,15 @@ H265VuiParametersParser::ParseVuiParameters(
     if (!bit_buffer->ReadExponentialGolomb(vui->def_disp_win_bottom_offset)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "def_disp_win_bottom_offset",
+                  vui->def_disp_win_bottom_offset);
     if (vui->def_disp_win_bottom_offset < kDefDispWinBottomOffsetMin ||
         vui->def_disp_win_bottom_offset > kDefDispWinBottomOffsetMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid def_disp_win_bottom_offset: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vui->def_disp_win_bottom_offset, kDefDispWinBottomOffsetMin,
-              kDefDispWinBottomOffsetMax);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "vui_parameters",
+                                "def_disp_win_bottom_offset", bit_buffer,
+                                vui->def_disp_win_bottom_offset,
+                                kDefDispWinBottomOffsetMin,
+                                kDefDispWinBottomOffsetMax);
       return nullptr;
     }
   }
@@ -249,38 +274,44 @@ H265VuiParametersParser::ParseVuiParameters(
   if (!bit_buffer->ReadBits(1, vui->vui_timing_info_present_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "vui_timing_info_present_flag", 1,
+               vui->vui_timing_info_present_flag);
   if (vui->vui_timing_info_present_flag) {
     // vui_num_units_in_tick  u(32)
     if (!bit_buffer->ReadBits(32, vui->vui_num_units_in_tick)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "vui_num_units_in_tick", 32,
+                 vui->vui_num_units_in_tick);
     // vui_time_scale  u(32)
     if (!bit_buffer->ReadBits(32, vui->vui_time_scale)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "vui_time_scale", 32, vui->vui_time_scale);
     // vui_poc_proportional_to_timing_flag  u(1)
     if (!bit_buffer->ReadBits(1, vui->vui_poc_proportional_to_timing_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "vui_poc_proportional_to_timing_flag", 1,
+                 vui->vui_poc_proportional_to_timing_flag);
     if (vui->vui_poc_proportional_to_timing_flag) {
       // vui_num_ticks_poc_diff_one_minus1  ue(v)
       if (!bit_buffer->ReadExponentialGolomb(
               vui->vui_num_ticks_poc_diff_one_minus1)) {
         return nullptr;
       }
+      H265Trace::ue(bit_buffer, "vui_num_ticks_poc_diff_one_minus1",
+                    vui->vui_num_ticks_poc_diff_one_minus1);
       if (vui->vui_num_ticks_poc_diff_one_minus1 <
               kVuiNumTicksPocDiffOneMinus1Min ||
           vui->vui_num_ticks_poc_diff_one_minus1 >
               kVuiNumTicksPocDiffOneMinus1Max) {
-#ifdef FPRINT_ERRORS
-        fprintf(stderr,
-                "invalid vui_num_ticks_poc_diff_one_minus1: %" PRIu32
-                " not in range "
-                "[%" PRIu32 ", %" PRIu32 "]\n",
-                vui->vui_num_ticks_poc_diff_one_minus1,
-                kVuiNumTicksPocDiffOneMinus1Min,
-                kVuiNumTicksPocDiffOneMinus1Max);
-#endif  // FPRINT_ERRORS
+        H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "vui_parameters",
+                                  "vui_num_ticks_poc_diff_one_minus1",
+                                  bit_buffer,
+                                  vui->vui_num_ticks_poc_diff_one_minus1,
+                                  kVuiNumTicksPocDiffOneMinus1Min,
+                                  kVuiNumTicksPocDiffOneMinus1Max);
         return nullptr;
       }
     }
@@ -288,6 +319,8 @@ H265VuiParametersParser::ParseVuiParameters(
     if (!bit_buffer->ReadBits(1, vui->vui_hrd_parameters_present_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "vui_hrd_parameters_present_flag", 1,
+                 vui->vui_hrd_parameters_present_flag);
     if (vui->vui_hrd_parameters_present_flag) {
       // hrd_parameters(1, sps_max_sub_layers_minus1)
       vui->hrd_parameters = H265HrdParametersParser::ParseHrdParameters(
@@ -302,66 +335,71 @@ H265VuiParametersParser::ParseVuiParameters(
   if (!bit_buffer->ReadBits(1, vui->bitstream_restriction_flag)) {
     return nullptr;
   }
+  H265Trace::u(bit_buffer, "bitstream_restriction_flag", 1,
+               vui->bitstream_restriction_flag);
   if (vui->bitstream_restriction_flag) {
     // tiles_fixed_structure_flag u(1)
     if (!bit_buffer->ReadBits(1, vui->tiles_fixed_structure_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "tiles_fixed_structure_flag", 1,
+                 vui->tiles_fixed_structure_flag);
     // motion_vectors_over_pic_boundaries_flag  u(1)
     if (!bit_buffer->ReadBits(1,
                               vui->motion_vectors_over_pic_boundaries_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "motion_vectors_over_pic_boundaries_flag", 1,
+                 vui->motion_vectors_over_pic_boundaries_flag);
     // restricted_ref_pic_lists_flag  u(1)
     if (!bit_buffer->ReadBits(1, vui->restricted_ref_pic_lists_flag)) {
       return nullptr;
     }
+    H265Trace::u(bit_buffer, "restricted_ref_pic_lists_flag", 1,
+                 vui->restricted_ref_pic_lists_flag);
     // min_spatial_segmentation_idc  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(vui->min_spatial_segmentation_idc)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "min_spatial_segmentation_idc",
+                  vui->min_spatial_segmentation_idc);
     if (vui->min_spatial_segmentation_idc < kMinSpatialSegmentationIdcMin ||
         vui->min_spatial_segmentation_idc > kMinSpatialSegmentationIdcMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid min_spatial_segmentation_idc: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vui->min_spatial_segmentation_idc, kMinSpatialSegmentationIdcMin,
-              kMinSpatialSegmentationIdcMax);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "vui_parameters",
+                                "min_spatial_segmentation_idc", bit_buffer,
+                                vui->min_spatial_segmentation_idc,
+                                kMinSpatialSegmentationIdcMin,
+                                kMinSpatialSegmentationIdcMax);
       return nullptr;
     }
     // max_bytes_per_pic_denom  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(vui->max_bytes_per_pic_denom)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "max_bytes_per_pic_denom",
+                  vui->max_bytes_per_pic_denom);
     if (vui->max_bytes_per_pic_denom < kMaxBytesPerPicDenomMin ||
         vui->max_bytes_per_pic_denom > kMaxBytesPerPicDenomMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid max_bytes_per_pic_denom: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vui->max_bytes_per_pic_denom, kMaxBytesPerPicDenomMin,
-              kMaxBytesPerPicDenomMax);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "vui_parameters",
+                                "max_bytes_per_pic_denom", bit_buffer,
+                                vui->max_bytes_per_pic_denom,
+                                kMaxBytesPerPicDenomMin,
+                                kMaxBytesPerPicDenomMax);
       return nullptr;
     }
     // max_bits_per_min_cu_denom  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(vui->max_bits_per_min_cu_denom)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "max_bits_per_min_cu_denom",
+                  vui->max_bits_per_min_cu_denom);
     if (vui->max_bits_per_min_cu_denom < kMaxBitsPerMinCuDenomMin ||
         vui->max_bits_per_min_cu_denom > kMaxBitsPerMinCuDenomMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid max_bits_per_min_cu_denom: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vui->max_bits_per_min_cu_denom, kMaxBitsPerMinCuDenomMin,
-              kMaxBitsPerMinCuDenomMax);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "vui_parameters",
+                                "max_bits_per_min_cu_denom", bit_buffer,
+                                vui->max_bits_per_min_cu_denom,
+                                kMaxBitsPerMinCuDenomMin,
+                                kMaxBitsPerMinCuDenomMax);
       return nullptr;
     }
     // log2_max_mv_length_horizontal  ue(v)
@@ -369,32 +407,30 @@ H265VuiParametersParser::ParseVuiParameters(
             vui->log2_max_mv_length_horizontal)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "log2_max_mv_length_horizontal",
+                  vui->log2_max_mv_length_horizontal);
     if (vui->log2_max_mv_length_horizontal < kLog2MaxMvLengthHorizontalMin ||
         vui->log2_max_mv_length_horizontal > kLog2MaxMvLengthHorizontalMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid log2_max_mv_length_horizontal: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vui->log2_max_mv_length_horizontal, kLog2MaxMvLengthHorizontalMin,
-              kLog2MaxMvLengthHorizontalMax);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "vui_parameters",
+                                "log2_max_mv_length_horizontal", bit_buffer,
+                                vui->log2_max_mv_length_horizontal,
+                                kLog2MaxMvLengthHorizontalMin,
+                                kLog2MaxMvLengthHorizontalMax);
       return nullptr;
     }
     // log2_max_mv_length_vertical  ue(v)
     if (!bit_buffer->ReadExponentialGolomb(vui->log2_max_mv_length_vertical)) {
       return nullptr;
     }
+    H265Trace::ue(bit_buffer, "log2_max_mv_length_vertical",
+                  vui->log2_max_mv_length_vertical);
     if (vui->log2_max_mv_length_vertical < kLog2MaxMvLengthVerticalMin ||
         vui->log2_max_mv_length_vertical > kLog2MaxMvLengthVerticalMax) {
-#ifdef FPRINT_ERRORS
-      fprintf(stderr,
-              "invalid log2_max_mv_length_vertical: %" PRIu32
-              " not in range "
-              "[%" PRIu32 ", %" PRIu32 "]\n",
-              vui->log2_max_mv_length_vertical, kLog2MaxMvLengthVerticalMin,
-              kLog2MaxMvLengthVerticalMax);
-#endif  // FPRINT_ERRORS
+      H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "vui_parameters",
+                                "log2_max_mv_length_vertical", bit_buffer,
+                                vui->log2_max_mv_length_vertical,
+                                kLog2MaxMvLengthVerticalMin,
+                                kLog2MaxMvLengthVerticalMax);
       return nullptr;
     }
   }
@@ -132,6 +132,52 @@ TEST_F(H265BitstreamParserTest, TestSampleBitstream) {
       ::testing::ElementsAreArray({0x6c, 0x88, 0x0c, 0xe4}));
 }
 
+TEST_F(H265BitstreamParserTest, TestSampleBitstreamSegments) {
+  // parse the contiguous buffer
+  H265BitstreamParserState bitstream_parser_state;
+  ParsingOptions parsing_options;
+  parsing_options.add_checksum = true;
+  auto expected = H265BitstreamParser::ParseBitstream(
+      buffer, arraysize(buffer), &bitstream_parser_state, parsing_options);
+  ASSERT_TRUE(expected != nullptr);
+  ASSERT_EQ(4, expected->nal_units.size());
+
+  // every 3-segment split must produce the same NAL units, including
+  // splits inside start codes and emulation prevention sequences
+  for (size_t split0 = 0; split0 <= arraysize(buffer); split0 += 5) {
+    for (size_t split1 = split0; split1 <= arraysize(buffer); split1++) {
+      const BufferSegment segments[] = {
+          {buffer, split0},
+          {buffer + split0, split1 - split0},
+          {buffer + split1, arraysize(buffer) - split1}};
+      EXPECT_EQ(H265BitstreamParser::FindNaluIndices(buffer, arraysize(buffer))
+                    .size(),
+                H265BitstreamParser::FindNaluIndices(segments,
+                                                     arraysize(segments))
+                    .size());
+
+      H265BitstreamParserState segments_parser_state;
+      auto bitstream = H265BitstreamParser::ParseBitstream(
+          segments, arraysize(segments), &segments_parser_state,
+          parsing_options);
+      ASSERT_TRUE(bitstream != nullptr);
+      ASSERT_EQ(expected->nal_units.size(), bitstream->nal_units.size())
+          << "split: " << split0 << ", " << split1;
+      for (size_t i = 0; i < bitstream->nal_units.size(); i++) {
+        const auto& nal_unit = bitstream->nal_units[i];
+        const auto& expected_nal_unit = expected->nal_units[i];
+        EXPECT_EQ(expected_nal_unit->offset, nal_unit->offset);
+        EXPECT_EQ(expected_nal_unit->length, nal_unit->length);
+        EXPECT_EQ(expected_nal_unit->parsed_length, nal_unit->parsed_length);
+        EXPECT_EQ(expected_nal_unit->nal_unit_header->nal_unit_type,
+                  nal_unit->nal_unit_header->nal_unit_type);
+        EXPECT_EQ(expected_nal_unit->checksum->GetPrintableChecksum(),
+                  nal_unit->checksum->GetPrintableChecksum());
+      }
+    }
+  }
+}
+
 TEST_F(H265BitstreamParserTest, TestSampleBitstreamAlt) {
   // init the BitstreamParserState
   ParsingOptions parsing_options;
@@ -0,0 +1,135 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_budget.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_error.h"
+#include "h265_nal_unit_parser.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+namespace {
+void StoreError(const H265Error& error, void* opaque) {
+  auto* errors = static_cast<std::vector<H265Error>*>(opaque);
+  errors->push_back(error);
+}
+
+// prefix SEI NAL unit with an unknown (buffering_period) payload of
+// `payload_size` bytes
+std::vector<uint8_t> GetSeiNalUnit(uint8_t payload_size) {
+  std::vector<uint8_t> buffer = {0x4e, 0x01, 0x00, payload_size};
+  buffer.insert(buffer.end(), payload_size, 0xaa);
+  buffer.push_back(0x80);
+  return buffer;
+}
+}  // namespace
+
+class H265BudgetTest : public ::testing::Test {
+ public:
+  H265BudgetTest() {}
+  ~H265BudgetTest() override {}
+
+  void SetUp() override {
+    H265ErrorReporter::Reset();
+    H265ErrorReporter::SetCallback(StoreError, &errors);
+  }
+  void TearDown() override {
+    H265ErrorReporter::SetCallback(nullptr, nullptr);
+    H265ErrorReporter::Reset();
+  }
+
+  std::vector<H265Error> errors;
+};
+
+TEST_F(H265BudgetTest, TestUnlimited) {
+  auto buffer = GetSeiNalUnit(32);
+  H265BitstreamParserState bitstream_parser_state;
+  ParsingOptions parsing_options;
+  auto nal_unit = H265NalUnitParser::ParseNalUnit(
+      buffer.data(), buffer.size(), &bitstream_parser_state, parsing_options);
+  ASSERT_TRUE(nal_unit != nullptr);
+  ASSERT_TRUE(nal_unit->nal_unit_payload->sei != nullptr);
+  EXPECT_TRUE(nal_unit->nal_unit_payload->sei->payload_state != nullptr);
+  EXPECT_TRUE(errors.empty());
+}
+
+TEST_F(H265BudgetTest, TestMaxAllocatedBytes) {
+  auto buffer = GetSeiNalUnit(32);
+  H265BitstreamParserState bitstream_parser_state;
+  ParsingOptions parsing_options;
+  parsing_options.max_allocated_bytes = 16;
+  auto nal_unit = H265NalUnitParser::ParseNalUnit(
+      buffer.data(), buffer.size(), &bitstream_parser_state, parsing_options);
+  ASSERT_TRUE(nal_unit != nullptr);
+  ASSERT_TRUE(nal_unit->nal_unit_payload->sei != nullptr);
+  // the payload is over budget
+  EXPECT_TRUE(nal_unit->nal_unit_payload->sei->payload_state == nullptr);
+
+  ASSERT_EQ(1, errors.size());
+  EXPECT_EQ(H265ErrorCode_BudgetExceeded, errors[0].code);
+  EXPECT_STREQ("sei", errors[0].parser);
+  EXPECT_STREQ("payload_byte", errors[0].element);
+  EXPECT_EQ(32, errors[0].value);
+  EXPECT_EQ(16, errors[0].max);
+
+  // the budget is per NAL unit: a small SEI fits
+  auto small_buffer = GetSeiNalUnit(8);
+  nal_unit = H265NalUnitParser::ParseNalUnit(
+      small_buffer.data(), small_buffer.size(), &bitstream_parser_state,
+      parsing_options);
+  ASSERT_TRUE(nal_unit != nullptr);
+  EXPECT_TRUE(nal_unit->nal_unit_payload->sei->payload_state != nullptr);
+  EXPECT_EQ(1, errors.size());
+}
+
+TEST_F(H265BudgetTest, TestMaxSyntaxElements) {
+  auto buffer = GetSeiNalUnit(32);
+  H265BitstreamParserState bitstream_parser_state;
+  ParsingOptions parsing_options;
+  parsing_options.max_syntax_elements = 31;
+  auto nal_unit = H265NalUnitParser::ParseNalUnit(
+      buffer.data(), buffer.size(), &bitstream_parser_state, parsing_options);
+  ASSERT_TRUE(nal_unit != nullptr);
+  EXPECT_TRUE(nal_unit->nal_unit_payload->sei->payload_state == nullptr);
+  ASSERT_EQ(1, errors.size());
+  EXPECT_EQ(H265ErrorCode_BudgetExceeded, errors[0].code);
+}
+
+TEST_F(H265BudgetTest, TestScope) {
+  ParsingOptions outer_options;
+  outer_options.max_allocations = 2;
+  H265Budget::Scope outer_scope(outer_options);
+  EXPECT_TRUE(H265Budget::Charge("test", "a", nullptr, 1, 10));
+  EXPECT_EQ(1, H265Budget::GetNumAllocations());
+  EXPECT_EQ(10, H265Budget::GetNumAllocatedBytes());
+  EXPECT_EQ(1, H265Budget::GetNumSyntaxElements());
+
+  {
+    // a nested scope starts from zero, and restores the outer one
+    ParsingOptions inner_options;
+    H265Budget::Scope inner_scope(inner_options);
+    EXPECT_EQ(0, H265Budget::GetNumAllocations());
+    for (int i = 0; i < 10; i++) {
+      EXPECT_TRUE(H265Budget::Charge("test", "b", nullptr, 1, 1));
+    }
+  }
+  EXPECT_EQ(1, H265Budget::GetNumAllocations());
+
+  EXPECT_TRUE(H265Budget::Charge("test", "c", nullptr, 1, 10));
+  EXPECT_FALSE(H265Budget::Charge("test", "d", nullptr, 1, 10));
+  ASSERT_EQ(1, errors.size());
+  EXPECT_STREQ("d", errors[0].element);
+  EXPECT_EQ(3, errors[0].value);
+  EXPECT_EQ(2, errors[0].max);
+}
+
+}  // namespace h265nal
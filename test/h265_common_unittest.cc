@@ -150,4 +150,91 @@ INSTANTIATE_TEST_SUITE_P(
     Parameter, H265CommonMoreRbspDataTest,
     ::testing::ValuesIn(kH265CommonMoreRbspDataParameterTestcases));
 
+TEST_F(H265CommonTest, TestGetBufferSegments) {
+  const uint8_t buffer[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  const BufferSegment segments[] = {
+      {buffer, 3}, {buffer + 3, 0}, {buffer + 3, 4}, {buffer + 7, 3}};
+  EXPECT_EQ(10, GetBufferSegmentsLength(segments, arraysize(segments)));
+
+  auto range = GetBufferSegments(segments, arraysize(segments), 2, 6);
+  ASSERT_EQ(3, range.size());
+  EXPECT_EQ(buffer + 2, range[0].data);
+  EXPECT_EQ(1, range[0].length);
+  EXPECT_EQ(buffer + 3, range[1].data);
+  EXPECT_EQ(4, range[1].length);
+  EXPECT_EQ(buffer + 7, range[2].data);
+  EXPECT_EQ(1, range[2].length);
+
+  // out of range
+  EXPECT_TRUE(GetBufferSegments(segments, arraysize(segments), 10, 1).empty());
+}
+
+TEST_F(H265CommonTest, TestUnescapeRbspSegments) {
+  const uint8_t buffer[] = {0x40, 0x00, 0x00, 0x03, 0x01, 0x00, 0x00,
+                            0x00, 0x03, 0x00, 0x00, 0x03, 0x03, 0x00};
+  const std::vector<uint8_t> expected =
+      UnescapeRbsp(buffer, arraysize(buffer));
+  ASSERT_EQ(arraysize(buffer) - 3, expected.size());
+
+  // every 2-segment split, including splits inside an emulation prevention
+  // sequence
+  for (size_t split = 0; split <= arraysize(buffer); split++) {
+    const BufferSegment segments[] = {
+        {buffer, split}, {buffer + split, arraysize(buffer) - split}};
+    EXPECT_EQ(expected, UnescapeRbsp(segments, arraysize(segments)))
+        << "split: " << split;
+  }
+
+  // 1-byte segments
+  std::vector<BufferSegment> segments;
+  for (size_t i = 0; i < arraysize(buffer); i++) {
+    segments.push_back({buffer + i, 1});
+  }
+  EXPECT_EQ(expected, UnescapeRbsp(segments.data(), segments.size()));
+}
+
+TEST_F(H265CommonTest, TestRbspOffsets) {
+  const uint8_t buffer[] = {0x40, 0x00, 0x00, 0x03, 0x01, 0x00,
+                            0x00, 0x03, 0x00, 0x00, 0x03, 0x03};
+  // escaped offset of each RBSP byte (and of the end)
+  const size_t escaped_offsets[] = {0, 1, 2, 4, 5, 6, 8, 9, 11, 12};
+  for (size_t i = 0; i < arraysize(escaped_offsets); i++) {
+    EXPECT_EQ(escaped_offsets[i],
+              RbspToEscapedOffset(buffer, arraysize(buffer), i))
+        << "rbsp offset: " << i;
+    EXPECT_EQ(i, EscapedToRbspOffset(buffer, arraysize(buffer),
+                                     escaped_offsets[i]))
+        << "rbsp offset: " << i;
+  }
+  // emulation prevention bytes map to the next RBSP byte
+  EXPECT_EQ(3, EscapedToRbspOffset(buffer, arraysize(buffer), 3));
+  EXPECT_EQ(8, EscapedToRbspOffset(buffer, arraysize(buffer), 10));
+  // past the end
+  EXPECT_EQ(12, RbspToEscapedOffset(buffer, arraysize(buffer), 20));
+  EXPECT_EQ(9, EscapedToRbspOffset(buffer, arraysize(buffer), 20));
+
+  // segment list, split inside an emulation prevention sequence
+  const BufferSegment segments[] = {{buffer, 3}, {buffer + 3, 7},
+                                    {buffer + 10, 2}};
+  for (size_t i = 0; i < arraysize(escaped_offsets); i++) {
+    EXPECT_EQ(escaped_offsets[i],
+              RbspToEscapedOffset(segments, arraysize(segments), i))
+        << "rbsp offset: " << i;
+  }
+}
+
+TEST_F(H265CommonTest, TestEscapeRbsp) {
+  const uint8_t rbsp[] = {0x40, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+                          0x00, 0x00, 0x04, 0x00, 0x00, 0x03, 0x00};
+  std::vector<uint8_t> out = {0x4e, 0x01};
+  EscapeRbsp(rbsp, arraysize(rbsp), &out);
+  EXPECT_THAT(out, ::testing::ElementsAreArray(
+                       {0x4e, 0x01, 0x40, 0x00, 0x00, 0x03, 0x01, 0x00,
+                        0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x04, 0x00,
+                        0x00, 0x03, 0x03, 0x00, 0x03}));
+  // round trip
+  EXPECT_EQ(std::vector<uint8_t>(rbsp, rbsp + arraysize(rbsp)),
+            UnescapeRbsp(out.data() + 2, out.size() - 3));
+}
+
 }  // namespace h265nal
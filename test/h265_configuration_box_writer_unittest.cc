@@ -0,0 +1,127 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_configuration_box_writer.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_configuration_box_parser.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+namespace {
+// hvcC (same as in the configuration box parser test)
+const uint8_t kConfigurationBox[] = {
+    // header
+    0x01, 0x01, 0x60, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x78, 0xf0, 0x00, 0xfc, 0xfd, 0xf8, 0xf8, 0x00, 0x00, 0x0f, 0x03,
+    // VPS array
+    0xa0, 0x00, 0x01, 0x00, 0x18,
+    // offset: 28
+    0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00,
+    0x80, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x78, 0x9d, 0xc0, 0x90,
+    // SPS array
+    0xa1, 0x00, 0x01, 0x00, 0x27,
+    // offset: 57
+    0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x80, 0x00, 0x00,
+    0x03, 0x00, 0x00, 0x03, 0x00, 0x78, 0xa0, 0x03, 0xc0, 0x80, 0x32, 0x16,
+    0x59, 0xde, 0x49, 0x1b, 0x6b, 0x80, 0x40, 0x00, 0x00, 0xfa, 0x00, 0x00,
+    0x17, 0x70, 0x02,
+    // PPS array
+    0xa2, 0x00, 0x01, 0x00, 0x06,
+    // offset: 101
+    0x44, 0x01, 0xc1, 0x73, 0xd1, 0x89};
+}  // namespace
+
+class H265ConfigurationBoxWriterTest : public ::testing::Test {
+ public:
+  H265ConfigurationBoxWriterTest() {}
+  ~H265ConfigurationBoxWriterTest() override {}
+};
+
+TEST_F(H265ConfigurationBoxWriterTest, TestRoundTrip) {
+  const BufferSegment nal_units[] = {{kConfigurationBox + 28, 24},
+                                     {kConfigurationBox + 57, 39},
+                                     {kConfigurationBox + 101, 6}};
+  std::vector<uint8_t> buffer;
+  EXPECT_TRUE(H265ConfigurationBoxWriter::WriteConfigurationBox(
+      nal_units, arraysize(nal_units), {}, &buffer));
+  EXPECT_THAT(buffer, ::testing::ElementsAreArray(kConfigurationBox));
+}
+
+TEST_F(H265ConfigurationBoxWriterTest, TestAnnexB) {
+  // PPS, SPS and VPS (out of order, with a repeated SPS), followed by an
+  // IDR slice (ignored)
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {
+      // PPS (3-byte start code)
+      0x00, 0x00, 0x01, 0x44, 0x01, 0xc1, 0x73, 0xd1, 0x89,
+      // VPS (with trailing_zero_8bits)
+      0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01,
+      0x60, 0x00, 0x00, 0x03, 0x00, 0x80, 0x00, 0x00, 0x03, 0x00, 0x00,
+      0x03, 0x00, 0x78, 0x9d, 0xc0, 0x90, 0x00,
+      // SPS
+      0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00,
+      0x03, 0x00, 0x80, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x78,
+      0xa0, 0x03, 0xc0, 0x80, 0x32, 0x16, 0x59, 0xde, 0x49, 0x1b, 0x6b,
+      0x80, 0x40, 0x00, 0x00, 0xfa, 0x00, 0x00, 0x17, 0x70, 0x02,
+      // SPS (repeated)
+      0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00,
+      0x03, 0x00, 0x80, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x78,
+      0xa0, 0x03, 0xc0, 0x80, 0x32, 0x16, 0x59, 0xde, 0x49, 0x1b, 0x6b,
+      0x80, 0x40, 0x00, 0x00, 0xfa, 0x00, 0x00, 0x17, 0x70, 0x02,
+      // IDR slice
+      0x00, 0x00, 0x00, 0x01, 0x26, 0x01, 0xaf, 0x09, 0x40};
+  // fuzzer::conv: begin
+  std::vector<uint8_t> box;
+  H265ConfigurationBoxWriter::Options options;
+  options.length_size_minus_one = 1;
+  H265ConfigurationBoxWriter::WriteConfigurationBox(buffer, arraysize(buffer),
+                                                    options, &box);
+  // fuzzer::conv: end
+
+  // same box, but with 2-byte length fields
+  std::vector<uint8_t> expected_box(std::begin(kConfigurationBox),
+                                    std::end(kConfigurationBox));
+  expected_box[21] = 0x0d;
+  EXPECT_THAT(box, ::testing::ElementsAreArray(expected_box));
+
+  // the parser reads it back
+  H265BitstreamParserState bitstream_parser_state;
+  auto configuration_box = H265ConfigurationBoxParser::ParseConfigurationBox(
+      box.data(), box.size(), &bitstream_parser_state, {});
+  ASSERT_TRUE(configuration_box != nullptr);
+  EXPECT_EQ(1, configuration_box->lengthSizeMinusOne);
+  EXPECT_THAT(configuration_box->NAL_unit_type,
+              ::testing::ElementsAreArray({32, 33, 34}));
+  EXPECT_EQ(1, bitstream_parser_state.sps.size());
+  EXPECT_EQ(1, bitstream_parser_state.pps.size());
+}
+
+TEST_F(H265ConfigurationBoxWriterTest, TestNoSps) {
+  const BufferSegment nal_units[] = {{kConfigurationBox + 28, 24},
+                                     {kConfigurationBox + 101, 6}};
+  std::vector<uint8_t> buffer;
+  EXPECT_FALSE(H265ConfigurationBoxWriter::WriteConfigurationBox(
+      nal_units, arraysize(nal_units), {}, &buffer));
+
+  // invalid lengthSizeMinusOne
+  const BufferSegment all_nal_units[] = {{kConfigurationBox + 28, 24},
+                                         {kConfigurationBox + 57, 39},
+                                         {kConfigurationBox + 101, 6}};
+  H265ConfigurationBoxWriter::Options options;
+  options.length_size_minus_one = 2;
+  EXPECT_FALSE(H265ConfigurationBoxWriter::WriteConfigurationBox(
+      all_nal_units, arraysize(all_nal_units), options, &buffer));
+}
+
+}  // namespace h265nal
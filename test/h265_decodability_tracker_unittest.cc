@@ -0,0 +1,227 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_decodability_tracker.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_nal_unit_parser.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+class H265DecodabilityTrackerTest : public ::testing::Test {
+ public:
+  H265DecodabilityTrackerTest() {}
+  ~H265DecodabilityTrackerTest() override {}
+
+  void SetUp() override {
+    // SPS 0 (MaxPicOrderCntLsb = 256), and PPS 0
+    auto sps = std::make_shared<H265SpsParser::SpsState>();
+    sps->log2_max_pic_order_cnt_lsb_minus4 = 4;
+    bitstream_parser_state.sps[0] = sps;
+    bitstream_parser_state.pps[0] = std::make_shared<H265PpsParser::PpsState>();
+  }
+
+  // Make a slice segment, with a short-term RPS that lists the given POC
+  // deltas (all used by the current picture).
+  std::unique_ptr<H265NalUnitParser::NalUnitState> MakeSlice(
+      uint32_t nal_unit_type, uint32_t temporal_id, int32_t poc,
+      std::vector<int32_t> negative_deltas,
+      std::vector<int32_t> positive_deltas,
+      bool first_slice_segment_in_pic_flag = true) {
+    auto nal_unit = std::make_unique<H265NalUnitParser::NalUnitState>();
+    nal_unit->nal_unit_header =
+        std::make_unique<H265NalUnitHeaderParser::NalUnitHeaderState>();
+    nal_unit->nal_unit_header->nal_unit_type = nal_unit_type;
+    nal_unit->nal_unit_header->nuh_temporal_id_plus1 = temporal_id + 1;
+    nal_unit->nal_unit_payload =
+        std::make_unique<H265NalUnitPayloadParser::NalUnitPayloadState>();
+    auto& slice_segment_layer =
+        nal_unit->nal_unit_payload->slice_segment_layer;
+    slice_segment_layer = std::make_unique<
+        H265SliceSegmentLayerParser::SliceSegmentLayerState>();
+    slice_segment_layer->slice_segment_header = std::make_unique<
+        H265SliceSegmentHeaderParser::SliceSegmentHeaderState>();
+    auto& slice_segment_header = slice_segment_layer->slice_segment_header;
+    slice_segment_header->first_slice_segment_in_pic_flag =
+        first_slice_segment_in_pic_flag;
+    slice_segment_header->log2_max_pic_order_cnt_lsb_minus4 = 4;
+    slice_segment_header->slice_pic_order_cnt_lsb =
+        static_cast<uint32_t>(poc) & 0xff;
+    slice_segment_header->st_ref_pic_set =
+        std::make_unique<H265StRefPicSetParser::StRefPicSetState>();
+    auto& st_ref_pic_set = slice_segment_header->st_ref_pic_set;
+    int32_t previous = 0;
+    for (int32_t delta : negative_deltas) {
+      st_ref_pic_set->delta_poc_s0_minus1.push_back(
+          static_cast<uint32_t>(previous - delta - 1));
+      st_ref_pic_set->used_by_curr_pic_s0_flag.push_back(1);
+      previous = delta;
+    }
+    st_ref_pic_set->num_negative_pics =
+        static_cast<uint32_t>(negative_deltas.size());
+    previous = 0;
+    for (int32_t delta : positive_deltas) {
+      st_ref_pic_set->delta_poc_s1_minus1.push_back(
+          static_cast<uint32_t>(delta - previous - 1));
+      st_ref_pic_set->used_by_curr_pic_s1_flag.push_back(1);
+      previous = delta;
+    }
+    st_ref_pic_set->num_positive_pics =
+        static_cast<uint32_t>(positive_deltas.size());
+    return nal_unit;
+  }
+
+  bool Add(const std::unique_ptr<H265NalUnitParser::NalUnitState>& nal_unit) {
+    return tracker.AddNalUnit(nal_unit.get(), &bitstream_parser_state);
+  }
+
+  H265BitstreamParserState bitstream_parser_state;
+  H265DecodabilityTracker tracker;
+};
+
+TEST_F(H265DecodabilityTrackerTest, TestLostReferencePicture) {
+  EXPECT_TRUE(Add(MakeSlice(NalUnitType::IDR_W_RADL, 0, 0, {}, {})));
+  EXPECT_TRUE(Add(MakeSlice(NalUnitType::TRAIL_R, 0, 1, {-1}, {})));
+  EXPECT_TRUE(Add(MakeSlice(NalUnitType::TRAIL_R, 0, 2, {-1}, {})));
+  EXPECT_FALSE(tracker.NeedsKeyframe());
+
+  // POC 3 is lost as a whole: POC 4 references it
+  EXPECT_FALSE(Add(MakeSlice(NalUnitType::TRAIL_R, 0, 4, {-1}, {})));
+  EXPECT_EQ(4, tracker.GetPicture().poc);
+  EXPECT_FALSE(tracker.GetPicture().references_decodable);
+  EXPECT_TRUE(tracker.GetPicture().complete);
+  EXPECT_TRUE(tracker.NeedsKeyframe());
+  // the error propagates
+  EXPECT_FALSE(Add(MakeSlice(NalUnitType::TRAIL_R, 0, 5, {-1}, {})));
+  EXPECT_TRUE(tracker.NeedsKeyframe());
+
+  // an IDR picture clears it
+  EXPECT_TRUE(Add(MakeSlice(NalUnitType::IDR_N_LP, 0, 0, {}, {})));
+  EXPECT_FALSE(tracker.NeedsKeyframe());
+  EXPECT_TRUE(Add(MakeSlice(NalUnitType::TRAIL_R, 0, 1, {-1}, {})));
+
+  const auto& stats = tracker.GetStats();
+  EXPECT_EQ(7, stats.pictures);
+  EXPECT_EQ(2, stats.pictures_missing_references);
+  EXPECT_EQ(0, stats.pictures_incomplete);
+}
+
+TEST_F(H265DecodabilityTrackerTest, TestLostSliceSegment) {
+  EXPECT_TRUE(Add(MakeSlice(NalUnitType::IDR_W_RADL, 0, 0, {}, {})));
+  EXPECT_TRUE(Add(MakeSlice(NalUnitType::TRAIL_R, 0, 1, {-1}, {})));
+  // the second slice segment of POC 1 is lost
+  tracker.SignalLoss();
+  EXPECT_FALSE(Add(MakeSlice(NalUnitType::TRAIL_R, 0, 1, {-1}, {}, false)));
+  EXPECT_FALSE(tracker.GetPicture().complete);
+  EXPECT_TRUE(tracker.NeedsKeyframe());
+  // POC 2 only references POC 0: still decodable
+  EXPECT_TRUE(Add(MakeSlice(NalUnitType::TRAIL_R, 0, 2, {-2}, {})));
+  EXPECT_FALSE(tracker.NeedsKeyframe());
+  EXPECT_EQ(1, tracker.GetStats().pictures_incomplete);
+  EXPECT_EQ(1, tracker.GetStats().losses);
+
+  // a NAL unit that could not be parsed is a loss
+  EXPECT_FALSE(tracker.AddNalUnit(nullptr, &bitstream_parser_state));
+  EXPECT_FALSE(tracker.GetPicture().IsDecodable());
+}
+
+TEST_F(H265DecodabilityTrackerTest, TestLostNonReferencePicture) {
+  // hierarchical-B: POC 2 references POC 0, and POC 1 (a sub-layer
+  // non-reference picture) references both
+  EXPECT_TRUE(Add(MakeSlice(NalUnitType::IDR_W_RADL, 0, 0, {}, {})));
+  EXPECT_TRUE(Add(MakeSlice(NalUnitType::TRAIL_R, 0, 2, {-2}, {})));
+  EXPECT_TRUE(Add(MakeSlice(NalUnitType::TRAIL_N, 1, 1, {-1}, {1})));
+  // POC 4 and 3 are lost: POC 6 references POC 4
+  EXPECT_FALSE(Add(MakeSlice(NalUnitType::TRAIL_R, 0, 6, {-2}, {})));
+  EXPECT_TRUE(tracker.NeedsKeyframe());
+
+  // a stream where only a non-reference picture is lost
+  EXPECT_TRUE(Add(MakeSlice(NalUnitType::IDR_W_RADL, 0, 0, {}, {})));
+  EXPECT_TRUE(Add(MakeSlice(NalUnitType::TRAIL_R, 0, 2, {-2}, {})));
+  // POC 1 (TRAIL_N) is lost
+  EXPECT_TRUE(Add(MakeSlice(NalUnitType::TRAIL_R, 0, 4, {-2}, {})));
+  EXPECT_TRUE(Add(MakeSlice(NalUnitType::TRAIL_N, 1, 3, {-1}, {1})));
+  EXPECT_FALSE(tracker.NeedsKeyframe());
+}
+
+TEST_F(H265DecodabilityTrackerTest, TestCraWithRaslPictures) {
+  // a stream starting with a CRA picture: its RASL pictures reference
+  // pictures that were never received, and are skipped
+  EXPECT_TRUE(Add(MakeSlice(NalUnitType::CRA_NUT, 0, 8, {-4}, {})));
+  EXPECT_FALSE(Add(MakeSlice(NalUnitType::RASL_N, 0, 6, {-2}, {2})));
+  EXPECT_FALSE(tracker.NeedsKeyframe());
+  EXPECT_TRUE(Add(MakeSlice(NalUnitType::TRAIL_R, 0, 12, {-4}, {})));
+  EXPECT_FALSE(tracker.NeedsKeyframe());
+}
+
+#ifdef RTP_DEFINE
+TEST_F(H265DecodabilityTrackerTest, TestRtpMarker) {
+  H265RtpDepacketizer::NalUnit nal_unit = {};
+  nal_unit.marker = true;
+  auto idr = MakeSlice(NalUnitType::IDR_W_RADL, 0, 0, {}, {});
+  EXPECT_TRUE(tracker.AddNalUnit(nal_unit, idr.get(), &bitstream_parser_state));
+  auto p2 = MakeSlice(NalUnitType::TRAIL_R, 0, 2, {-2}, {});
+  EXPECT_TRUE(tracker.AddNalUnit(nal_unit, p2.get(), &bitstream_parser_state));
+
+  // POC 1 (non-reference) is lost after a marker: POC 2 stays complete,
+  // and POC 4 is decodable
+  nal_unit.after_loss = true;
+  auto p4 = MakeSlice(NalUnitType::TRAIL_R, 0, 4, {-2}, {});
+  EXPECT_TRUE(tracker.AddNalUnit(nal_unit, p4.get(), &bitstream_parser_state));
+  EXPECT_FALSE(tracker.NeedsKeyframe());
+
+  // a loss inside POC 6 (no marker before the gap)
+  nal_unit.after_loss = false;
+  nal_unit.marker = false;
+  auto p6 = MakeSlice(NalUnitType::TRAIL_R, 0, 6, {-2}, {});
+  EXPECT_TRUE(tracker.AddNalUnit(nal_unit, p6.get(), &bitstream_parser_state));
+  nal_unit.after_loss = true;
+  nal_unit.marker = true;
+  auto p6b = MakeSlice(NalUnitType::TRAIL_R, 0, 6, {-2}, {}, false);
+  EXPECT_FALSE(
+      tracker.AddNalUnit(nal_unit, p6b.get(), &bitstream_parser_state));
+  EXPECT_TRUE(tracker.NeedsKeyframe());
+  EXPECT_EQ(2, tracker.GetStats().losses);
+}
+
+TEST_F(H265DecodabilityTrackerTest, TestRtpLossesWithUnknownReferences) {
+  H265RtpDepacketizer::NalUnit nal_unit = {};
+  nal_unit.marker = true;
+  auto idr = MakeSlice(NalUnitType::IDR_W_RADL, 0, 0, {}, {});
+  EXPECT_TRUE(tracker.AddNalUnit(nal_unit, idr.get(), &bitstream_parser_state));
+
+  // whole access units are lost before each picture, and the pictures use
+  // an unknown PPS: their RPS is never applied, so the DPB is only bounded
+  // when the pictures are added to it
+  nal_unit.after_loss = true;
+  for (int32_t poc = 1; poc < 1000; poc++) {
+    auto slice = MakeSlice(NalUnitType::TRAIL_R, 0, poc, {-1}, {});
+    slice->nal_unit_payload->slice_segment_layer->slice_segment_header
+        ->slice_pic_parameter_set_id = 1;
+    EXPECT_FALSE(
+        tracker.AddNalUnit(nal_unit, slice.get(), &bitstream_parser_state));
+  }
+  EXPECT_TRUE(tracker.NeedsKeyframe());
+  EXPECT_EQ(999, tracker.GetStats().losses);
+  EXPECT_EQ(999, tracker.GetStats().pictures_missing_references);
+
+  // an IDR picture clears it
+  auto idr2 = MakeSlice(NalUnitType::IDR_N_LP, 0, 0, {}, {});
+  EXPECT_TRUE(
+      tracker.AddNalUnit(nal_unit, idr2.get(), &bitstream_parser_state));
+  EXPECT_FALSE(tracker.NeedsKeyframe());
+}
+#endif  // RTP_DEFINE
+
+}  // namespace h265nal
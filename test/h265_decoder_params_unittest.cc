@@ -0,0 +1,391 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_decoder_params.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_pps_parser.h"
+#include "h265_pred_weight_table_parser.h"
+#include "h265_scaling_list_data_parser.h"
+#include "h265_slice_parser.h"
+#include "h265_sps_parser.h"
+#include "h265_st_ref_pic_set_parser.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+namespace {
+// Add a 1920x1080 SPS (id 0, 64x64 CTBs) and a PPS (id 0) to the state.
+void AddParameterSets(H265BitstreamParserState* bitstream_parser_state) {
+  auto sps = std::make_shared<H265SpsParser::SpsState>();
+  sps->chroma_format_idc = 1;
+  sps->pic_width_in_luma_samples = 1920;
+  sps->pic_height_in_luma_samples = 1080;
+  sps->log2_min_luma_coding_block_size_minus3 = 0;
+  sps->log2_diff_max_min_luma_coding_block_size = 3;
+  sps->log2_min_luma_transform_block_size_minus2 = 0;
+  sps->log2_diff_max_min_luma_transform_block_size = 3;
+  bitstream_parser_state->sps[0] = sps;
+  auto pps = std::make_shared<H265PpsParser::PpsState>();
+  bitstream_parser_state->pps[0] = pps;
+}
+}  // namespace
+
+class H265DecoderParamsTest : public ::testing::Test {
+ public:
+  H265DecoderParamsTest() {}
+  ~H265DecoderParamsTest() override {}
+};
+
+TEST_F(H265DecoderParamsTest, TestStream) {
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {
+      // VPS
+      0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+      0x00, 0x00, 0x03, 0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+      0x5d, 0xac, 0x59,
+      // SPS
+      0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03,
+      0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x5d, 0xa0, 0x02,
+      0x80, 0x80, 0x2e, 0x1f, 0x13, 0x96, 0xbb, 0x93, 0x24, 0xbb, 0x95, 0x82,
+      0x83, 0x03, 0x01, 0x76, 0x85, 0x09, 0x40,
+      // PPS
+      0x00, 0x00, 0x00, 0x01, 0x44, 0x01, 0xc0, 0xf3, 0xc0, 0x02, 0x10,
+      // IDR_W_RADL
+      0x00, 0x00, 0x00, 0x01, 0x26, 0x01, 0xaf, 0x09, 0x40, 0xf3, 0xb8, 0xd5,
+      0x39, 0xba, 0x1f, 0xe4, 0xa6, 0x08, 0x5c, 0x6e, 0xb1, 0x8f, 0x00, 0x38,
+      0xf1, 0xa6, 0xfc, 0xf1, 0x40, 0x04, 0x3a, 0x86, 0xcb, 0x90, 0x74, 0xce,
+      0xf0, 0x46, 0x61, 0x93, 0x72, 0xd6, 0xfc, 0x35, 0xe3, 0xc5, 0x6f, 0x0a,
+      0xc4, 0x9e, 0x27, 0xc4, 0xdb, 0xe3, 0xfb, 0x38, 0x98, 0xd0, 0x8b, 0xd5,
+      0xb9, 0xb9, 0x15, 0xb4, 0x92, 0x49, 0x97, 0xe5, 0x3d, 0x36, 0x4d, 0x45,
+      0x32, 0x5c, 0xe6, 0x89, 0x53, 0x76, 0xce, 0xbb, 0x83, 0xa1, 0x27, 0x35,
+      0xfb, 0xf3, 0xc7, 0xd4, 0x85, 0x32, 0x37, 0x94, 0x09, 0xec, 0x10};
+
+  // fuzzer::conv: begin
+  H265BitstreamParserState bitstream_parser_state;
+  ParsingOptions parsing_options;
+  auto bitstream = H265BitstreamParser::ParseBitstream(
+      buffer, arraysize(buffer), &bitstream_parser_state, parsing_options);
+
+  H265DecoderParams decoder_params;
+  std::vector<H265DecoderParams::SliceParams> slice_params_list;
+  if (bitstream != nullptr) {
+    for (const auto& nal_unit : bitstream->nal_units) {
+      if (nal_unit->nal_unit_payload == nullptr ||
+          nal_unit->nal_unit_payload->slice_segment_layer == nullptr) {
+        continue;
+      }
+      H265DecoderParams::SliceParams slice_params;
+      if (decoder_params.GetSliceParams(
+              *nal_unit->nal_unit_payload->slice_segment_layer
+                   ->slice_segment_header,
+              bitstream_parser_state, &slice_params)) {
+        slice_params_list.push_back(slice_params);
+      }
+    }
+  }
+  // fuzzer::conv: end
+
+  ASSERT_EQ(1, slice_params_list.size());
+  const auto& slice_params = slice_params_list[0];
+  const auto* pic_params =
+      decoder_params.GetPicParams(0, bitstream_parser_state);
+  ASSERT_TRUE(pic_params != nullptr);
+  // 1280x720, 8-bit 4:2:0, 32x32 CTBs
+  EXPECT_EQ(1, pic_params->ChromaArrayType);
+  EXPECT_EQ(8, pic_params->BitDepthY);
+  EXPECT_EQ(8, pic_params->BitDepthC);
+  EXPECT_EQ(5, pic_params->CtbLog2SizeY);
+  EXPECT_EQ(32, pic_params->CtbSizeY);
+  EXPECT_EQ(40, pic_params->PicWidthInCtbsY);
+  EXPECT_EQ(23, pic_params->PicHeightInCtbsY);
+  EXPECT_EQ(920, pic_params->PicSizeInCtbsY);
+  EXPECT_EQ(1, pic_params->num_tile_columns);
+  EXPECT_EQ(1, pic_params->num_tile_rows);
+  EXPECT_EQ(40, pic_params->colWidth[0]);
+  EXPECT_EQ(23, pic_params->rowHeight[0]);
+  // scaling lists not enabled
+  EXPECT_EQ(16, pic_params->ScalingFactor8x8[0][63]);
+
+  // cached
+  EXPECT_EQ(pic_params, decoder_params.GetPicParams(0, bitstream_parser_state));
+
+  // IDR slice: no reference pictures
+  EXPECT_EQ(SliceType_I, slice_params.slice_type);
+  EXPECT_EQ(0, slice_params.ctb_addr_in_ts);
+  EXPECT_EQ(35, slice_params.SliceQpY);
+  EXPECT_EQ(0, slice_params.num_ref_idx_l0_active);
+  EXPECT_EQ(0, slice_params.NumPicTotalCurr);
+}
+
+TEST_F(H265DecoderParamsTest, TestTiles) {
+  H265BitstreamParserState bitstream_parser_state;
+  AddParameterSets(&bitstream_parser_state);
+  H265DecoderParams decoder_params;
+
+  // uniform spacing: 4x3 tiles over 30x17 CTBs
+  auto pps = std::make_shared<H265PpsParser::PpsState>();
+  pps->tiles_enabled_flag = 1;
+  pps->num_tile_columns_minus1 = 3;
+  pps->num_tile_rows_minus1 = 2;
+  pps->uniform_spacing_flag = 1;
+  bitstream_parser_state.pps[0] = pps;
+  const auto* pic_params =
+      decoder_params.GetPicParams(0, bitstream_parser_state);
+  ASSERT_TRUE(pic_params != nullptr);
+  EXPECT_EQ(30, pic_params->PicWidthInCtbsY);
+  EXPECT_EQ(17, pic_params->PicHeightInCtbsY);
+  EXPECT_EQ(4, pic_params->num_tile_columns);
+  EXPECT_EQ(3, pic_params->num_tile_rows);
+  EXPECT_THAT(std::vector<uint32_t>(pic_params->colWidth,
+                                    pic_params->colWidth + 4),
+              ::testing::ElementsAreArray({7, 8, 7, 8}));
+  EXPECT_THAT(std::vector<uint32_t>(pic_params->colBd, pic_params->colBd + 5),
+              ::testing::ElementsAreArray({0, 7, 15, 22, 30}));
+  EXPECT_THAT(std::vector<uint32_t>(pic_params->rowHeight,
+                                    pic_params->rowHeight + 3),
+              ::testing::ElementsAreArray({5, 6, 6}));
+  EXPECT_THAT(std::vector<uint32_t>(pic_params->rowBd, pic_params->rowBd + 4),
+              ::testing::ElementsAreArray({0, 5, 11, 17}));
+
+  const auto* ctb_addr_rs_to_ts =
+      decoder_params.GetCtbAddrRsToTs(0, bitstream_parser_state);
+  ASSERT_TRUE(ctb_addr_rs_to_ts != nullptr);
+  ASSERT_EQ(30 * 17, ctb_addr_rs_to_ts->size());
+  // first CTB of the first tiles
+  EXPECT_EQ(0, (*ctb_addr_rs_to_ts)[0]);
+  EXPECT_EQ(7 * 5, (*ctb_addr_rs_to_ts)[7]);
+  EXPECT_EQ(30 * 5, (*ctb_addr_rs_to_ts)[30 * 5]);
+  // second row of the first tile
+  EXPECT_EQ(7, (*ctb_addr_rs_to_ts)[30]);
+  // last CTB
+  EXPECT_EQ(30 * 17 - 1, (*ctb_addr_rs_to_ts)[30 * 17 - 1]);
+
+  // explicit spacing (a new PPS is derived again)
+  pps = std::make_shared<H265PpsParser::PpsState>();
+  pps->tiles_enabled_flag = 1;
+  pps->num_tile_columns_minus1 = 1;
+  pps->num_tile_rows_minus1 = 1;
+  pps->column_width_minus1 = {9};
+  pps->row_height_minus1 = {3};
+  bitstream_parser_state.pps[0] = pps;
+  pic_params = decoder_params.GetPicParams(0, bitstream_parser_state);
+  ASSERT_TRUE(pic_params != nullptr);
+  EXPECT_EQ(2, pic_params->num_tile_columns);
+  EXPECT_EQ(10, pic_params->colWidth[0]);
+  EXPECT_EQ(20, pic_params->colWidth[1]);
+  EXPECT_EQ(4, pic_params->rowHeight[0]);
+  EXPECT_EQ(13, pic_params->rowHeight[1]);
+
+  // columns wider than the picture
+  pps = std::make_shared<H265PpsParser::PpsState>();
+  pps->tiles_enabled_flag = 1;
+  pps->num_tile_columns_minus1 = 1;
+  pps->column_width_minus1 = {29};
+  pps->row_height_minus1 = {};
+  bitstream_parser_state.pps[0] = pps;
+  EXPECT_TRUE(decoder_params.GetPicParams(0, bitstream_parser_state) ==
+              nullptr);
+}
+
+TEST_F(H265DecoderParamsTest, TestScalingFactors) {
+  H265BitstreamParserState bitstream_parser_state;
+  AddParameterSets(&bitstream_parser_state);
+  H265DecoderParams decoder_params;
+
+  // default lists
+  bitstream_parser_state.sps[0]->scaling_list_enabled_flag = 1;
+  const auto* pic_params =
+      decoder_params.GetPicParams(0, bitstream_parser_state);
+  ASSERT_TRUE(pic_params != nullptr);
+  EXPECT_EQ(16, pic_params->ScalingFactor4x4[0][15]);
+  // (x, y) = (1, 2): scan position 7
+  EXPECT_EQ(16, pic_params->ScalingFactor8x8[0][0]);
+  EXPECT_EQ(16, pic_params->ScalingFactor8x8[0][2 * 8 + 1]);
+  EXPECT_EQ(115, pic_params->ScalingFactor8x8[0][63]);
+  EXPECT_EQ(91, pic_params->ScalingFactor8x8[3][63]);
+  EXPECT_EQ(115, pic_params->ScalingFactor32x32[0][63]);
+  EXPECT_EQ(91, pic_params->ScalingFactor32x32[1][63]);
+  EXPECT_EQ(16, pic_params->ScalingFactorDc16x16[0]);
+
+  // explicit PPS lists: 1..64 in scan order
+  auto pps = std::make_shared<H265PpsParser::PpsState>();
+  pps->pps_scaling_list_data_present_flag = 1;
+  pps->scaling_list_data =
+      std::make_unique<H265ScalingListDataParser::ScalingListDataState>();
+  auto& scaling_list_data = *pps->scaling_list_data;
+  scaling_list_data.scaling_list_pred_mode_flag.assign(
+      4, std::vector<uint32_t>(6, 0));
+  scaling_list_data.scaling_list_pred_matrix_id_delta.assign(
+      4, std::vector<uint32_t>(6, 0));
+  scaling_list_data.scaling_list_dc_coef_minus8.assign(
+      4, std::vector<int32_t>(6, 0));
+  scaling_list_data.ScalingList.assign(
+      4, std::vector<std::vector<uint32_t>>(6));
+  for (uint32_t sizeId : {1u, 3u}) {
+    scaling_list_data.scaling_list_pred_mode_flag[sizeId][0] = 1;
+    for (uint32_t i = 0; i < 64; i++) {
+      scaling_list_data.ScalingList[sizeId][0].push_back(i + 1);
+    }
+    // copy of matrixId 0
+    scaling_list_data.scaling_list_pred_matrix_id_delta[sizeId][3] =
+        (sizeId == 3) ? 1 : 3;
+  }
+  scaling_list_data.scaling_list_dc_coef_minus8[1][0] = 2;
+  bitstream_parser_state.pps[0] = pps;
+  pic_params = decoder_params.GetPicParams(0, bitstream_parser_state);
+  ASSERT_TRUE(pic_params != nullptr);
+  // scan positions: (0, 0): 0, (0, 1): 1, (1, 0): 2, (7, 7): 63
+  EXPECT_EQ(1, pic_params->ScalingFactor8x8[0][0]);
+  EXPECT_EQ(2, pic_params->ScalingFactor8x8[0][1 * 8 + 0]);
+  EXPECT_EQ(3, pic_params->ScalingFactor8x8[0][0 * 8 + 1]);
+  EXPECT_EQ(64, pic_params->ScalingFactor8x8[0][63]);
+  EXPECT_EQ(3, pic_params->ScalingFactor8x8[3][0 * 8 + 1]);
+  // other lists are the defaults
+  EXPECT_EQ(115, pic_params->ScalingFactor8x8[1][63]);
+  EXPECT_EQ(3, pic_params->ScalingFactor32x32[0][0 * 8 + 1]);
+  EXPECT_EQ(3, pic_params->ScalingFactor32x32[1][0 * 8 + 1]);
+  EXPECT_EQ(10, pic_params->ScalingFactorDc32x32[0]);
+  EXPECT_EQ(10, pic_params->ScalingFactorDc32x32[1]);
+
+  // invalid reference matrix
+  scaling_list_data.scaling_list_pred_matrix_id_delta[1][1] = 2;
+  bitstream_parser_state.pps[0] =
+      std::make_shared<H265PpsParser::PpsState>();
+  bitstream_parser_state.pps[0]->pps_scaling_list_data_present_flag = 1;
+  bitstream_parser_state.pps[0]->scaling_list_data =
+      std::move(pps->scaling_list_data);
+  EXPECT_TRUE(decoder_params.GetPicParams(0, bitstream_parser_state) ==
+              nullptr);
+}
+
+TEST_F(H265DecoderParamsTest, TestSliceParams) {
+  H265BitstreamParserState bitstream_parser_state;
+  AddParameterSets(&bitstream_parser_state);
+  auto& sps = bitstream_parser_state.sps[0];
+  sps->long_term_ref_pics_present_flag = 1;
+  sps->lt_ref_pic_poc_lsb_sps = {5, 9};
+  sps->used_by_curr_pic_lt_sps_flag = {1, 0};
+  auto& pps = bitstream_parser_state.pps[0];
+  pps->init_qp_minus26 = 4;
+  pps->num_ref_idx_l0_default_active_minus1 = 2;
+  H265DecoderParams decoder_params;
+
+  // P slice
+  H265SliceSegmentHeaderParser::SliceSegmentHeaderState header;
+  header.nal_unit_type = TRAIL_R;
+  header.first_slice_segment_in_pic_flag = 1;
+  header.slice_type = SliceType_P;
+  header.slice_qp_delta = -2;
+  header.five_minus_max_num_merge_cand = 2;
+  header.st_ref_pic_set =
+      std::make_unique<H265StRefPicSetParser::StRefPicSetState>();
+  header.st_ref_pic_set->num_negative_pics = 2;
+  header.st_ref_pic_set->delta_poc_s0_minus1 = {0, 1};
+  header.st_ref_pic_set->used_by_curr_pic_s0_flag = {1, 0};
+  header.st_ref_pic_set->num_positive_pics = 1;
+  header.st_ref_pic_set->delta_poc_s1_minus1 = {2};
+  header.st_ref_pic_set->used_by_curr_pic_s1_flag = {1};
+  header.long_term_ref_pics_present_flag = 1;
+  header.num_long_term_sps = 1;
+  header.lt_idx_sps = {1};
+  header.num_long_term_pics = 2;
+  header.poc_lsb_lt = {7, 3};
+  header.used_by_curr_pic_lt_flag = {1, 1};
+  header.delta_poc_msb_present_flag = {1, 1, 1};
+  header.delta_poc_msb_cycle_lt = {2, 3, 4};
+  header.pred_weight_table =
+      std::make_unique<H265PredWeightTableParser::PredWeightTableState>();
+  auto& pred_weight_table = *header.pred_weight_table;
+  pred_weight_table.ChromaArrayType = 1;
+  pred_weight_table.luma_log2_weight_denom = 6;
+  pred_weight_table.delta_chroma_log2_weight_denom = -1;
+  pred_weight_table.luma_weight_l0_flag = {1, 0};
+  pred_weight_table.delta_luma_weight_l0 = {3};
+  pred_weight_table.luma_offset_l0 = {-2};
+  pred_weight_table.chroma_weight_l0_flag = {0, 1};
+  pred_weight_table.delta_chroma_weight_l0 = {{1, -1}};
+  pred_weight_table.delta_chroma_offset_l0 = {{10, -10}};
+
+  H265DecoderParams::SliceParams slice_params;
+  ASSERT_TRUE(decoder_params.GetSliceParams(header, bitstream_parser_state,
+                                            &slice_params));
+  EXPECT_EQ(28, slice_params.SliceQpY);
+  EXPECT_EQ(3, slice_params.MaxNumMergeCand);
+  EXPECT_EQ(3, slice_params.num_ref_idx_l0_active);
+  EXPECT_EQ(0, slice_params.num_ref_idx_l1_active);
+
+  EXPECT_EQ(2, slice_params.NumNegativePics);
+  EXPECT_EQ(-1, slice_params.DeltaPocS0[0]);
+  EXPECT_EQ(-3, slice_params.DeltaPocS0[1]);
+  EXPECT_EQ(1, slice_params.UsedByCurrPicS0[0]);
+  EXPECT_EQ(0, slice_params.UsedByCurrPicS0[1]);
+  EXPECT_EQ(1, slice_params.NumPositivePics);
+  EXPECT_EQ(3, slice_params.DeltaPocS1[0]);
+  EXPECT_EQ(3, slice_params.num_long_term);
+  EXPECT_EQ(9, slice_params.PocLsbLt[0]);
+  EXPECT_EQ(0, slice_params.UsedByCurrPicLt[0]);
+  EXPECT_EQ(7, slice_params.PocLsbLt[1]);
+  EXPECT_EQ(3, slice_params.PocLsbLt[2]);
+  // accumulated within the SPS and the slice entries
+  EXPECT_EQ(2, slice_params.DeltaPocMsbCycleLt[0]);
+  EXPECT_EQ(3, slice_params.DeltaPocMsbCycleLt[1]);
+  EXPECT_EQ(7, slice_params.DeltaPocMsbCycleLt[2]);
+  EXPECT_EQ(1, slice_params.NumPocStCurrBefore);
+  EXPECT_EQ(1, slice_params.NumPocStCurrAfter);
+  EXPECT_EQ(2, slice_params.NumPocLtCurr);
+  EXPECT_EQ(4, slice_params.NumPicTotalCurr);
+
+  EXPECT_EQ(6, slice_params.luma_log2_weight_denom);
+  EXPECT_EQ(5, slice_params.ChromaLog2WeightDenom);
+  EXPECT_EQ(67, slice_params.LumaWeightL0[0]);
+  EXPECT_EQ(-2, slice_params.luma_offset_l0[0]);
+  EXPECT_EQ(64, slice_params.LumaWeightL0[1]);
+  EXPECT_EQ(0, slice_params.luma_offset_l0[1]);
+  EXPECT_EQ(32, slice_params.ChromaWeightL0[0][0]);
+  EXPECT_EQ(0, slice_params.ChromaOffsetL0[0][0]);
+  EXPECT_EQ(33, slice_params.ChromaWeightL0[1][0]);
+  EXPECT_EQ(31, slice_params.ChromaWeightL0[1][1]);
+  // Equation 7-56: 128 + 10 - ((128 * 33) >> 5), 128 - 10 - ((128 * 31) >> 5)
+  EXPECT_EQ(6, slice_params.ChromaOffsetL0[1][0]);
+  EXPECT_EQ(-6, slice_params.ChromaOffsetL0[1][1]);
+
+  // dependent slice segment: same values, new address
+  H265SliceSegmentHeaderParser::SliceSegmentHeaderState dependent_header;
+  dependent_header.nal_unit_type = TRAIL_R;
+  dependent_header.dependent_slice_segment_flag = 1;
+  dependent_header.slice_segment_address = 40;
+  H265DecoderParams::SliceParams dependent_slice_params;
+  ASSERT_TRUE(decoder_params.GetSliceParams(
+      dependent_header, bitstream_parser_state, &dependent_slice_params));
+  EXPECT_EQ(1, dependent_slice_params.dependent_slice_segment_flag);
+  EXPECT_EQ(40, dependent_slice_params.slice_segment_address);
+  EXPECT_EQ(40, dependent_slice_params.ctb_addr_in_ts);
+  EXPECT_EQ(28, dependent_slice_params.SliceQpY);
+  EXPECT_EQ(4, dependent_slice_params.NumPicTotalCurr);
+
+  // out of range
+  dependent_header.slice_segment_address = 30 * 17;
+  EXPECT_FALSE(decoder_params.GetSliceParams(
+      dependent_header, bitstream_parser_state, &dependent_slice_params));
+  header.lt_idx_sps = {2};
+  EXPECT_FALSE(decoder_params.GetSliceParams(header, bitstream_parser_state,
+                                             &slice_params));
+  header.lt_idx_sps = {1};
+  pred_weight_table.delta_chroma_weight_l0 = {{128, 0}};
+  EXPECT_FALSE(decoder_params.GetSliceParams(header, bitstream_parser_state,
+                                             &slice_params));
+}
+
+}  // namespace h265nal
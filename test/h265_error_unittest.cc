@@ -0,0 +1,121 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_error.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+namespace {
+void StoreError(const H265Error& error, void* opaque) {
+  auto* errors = static_cast<std::vector<H265Error>*>(opaque);
+  errors->push_back(error);
+}
+}  // namespace
+
+class H265ErrorTest : public ::testing::Test {
+ public:
+  H265ErrorTest() {}
+  ~H265ErrorTest() override {}
+
+  void SetUp() override {
+    H265ErrorReporter::Reset();
+    H265ErrorReporter::SetCallback(StoreError, &errors);
+  }
+  void TearDown() override {
+    H265ErrorReporter::SetCallback(nullptr, nullptr);
+    H265ErrorReporter::Reset();
+  }
+
+  std::vector<H265Error> errors;
+};
+
+TEST_F(H265ErrorTest, TestMissingPps) {
+  // AUD, followed by an IDR slice that refers to a non-existent PPS
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {0x00, 0x00, 0x00, 0x01, 0x46, 0x01, 0x50,
+                            0x00, 0x00, 0x00, 0x01, 0x26, 0x01, 0xa0};
+  // fuzzer::conv: begin
+  auto bitstream =
+      H265BitstreamParser::ParseBitstream(buffer, arraysize(buffer), {});
+  // fuzzer::conv: end
+
+  EXPECT_TRUE(bitstream != nullptr);
+  EXPECT_EQ(2, bitstream->nal_units.size());
+
+  // the slice header parser reports the missing PPS
+  ASSERT_EQ(1, errors.size());
+  EXPECT_EQ(H265ErrorCode_MissingParameterSet, errors[0].code);
+  EXPECT_STREQ("slice_segment_header", errors[0].parser);
+  EXPECT_STREQ("slice_pic_parameter_set_id", errors[0].element);
+  EXPECT_EQ(0, errors[0].value);
+  EXPECT_EQ(1, errors[0].nal_index);
+  // nal_unit_header (16 bits), first_slice_segment_in_pic_flag,
+  // no_output_of_prior_pics_flag, slice_pic_parameter_set_id
+  EXPECT_EQ(19, errors[0].bit_offset);
+
+  EXPECT_EQ(1, H265ErrorReporter::GetErrorCount());
+  auto ring = H265ErrorReporter::GetErrors();
+  ASSERT_EQ(1, ring.size());
+  EXPECT_EQ(H265ErrorCode_MissingParameterSet, ring[0].code);
+}
+
+TEST_F(H265ErrorTest, TestRing) {
+  const size_t num_errors = H265ErrorReporter::kRingSize + 5;
+  for (size_t i = 0; i < num_errors; i++) {
+    H265ErrorReporter::SetNalIndex(i);
+    H265ErrorReporter::Report(H265ErrorCode_OutOfRange, "test", "element",
+                              nullptr, static_cast<int64_t>(i), 0, 1);
+  }
+  EXPECT_EQ(num_errors, errors.size());
+  EXPECT_EQ(num_errors, H265ErrorReporter::GetErrorCount());
+
+  // only the last kRingSize errors are kept, oldest first
+  auto ring = H265ErrorReporter::GetErrors();
+  ASSERT_EQ(H265ErrorReporter::kRingSize, ring.size());
+  EXPECT_EQ(5, ring.front().value);
+  EXPECT_EQ(5, ring.front().nal_index);
+  EXPECT_EQ(num_errors - 1, ring.back().nal_index);
+
+  H265ErrorReporter::Reset();
+  EXPECT_EQ(0, H265ErrorReporter::GetErrorCount());
+  EXPECT_TRUE(H265ErrorReporter::GetErrors().empty());
+}
+
+TEST_F(H265ErrorTest, TestPrint) {
+  H265Error error;
+  error.code = H265ErrorCode_OutOfRange;
+  error.parser = "sps";
+  error.element = "chroma_format_idc";
+  error.value = 4;
+  error.min = 0;
+  error.max = 3;
+  error.nal_index = 2;
+  error.bit_offset = 120;
+
+  FILE* outfp = tmpfile();
+  ASSERT_TRUE(outfp != nullptr);
+  H265ErrorReporter::Print(outfp, error);
+  rewind(outfp);
+  char line[256] = {0};
+  EXPECT_TRUE(fgets(line, sizeof(line), outfp) != nullptr);
+  fclose(outfp);
+
+  EXPECT_EQ(
+      "error: sps: nal_index: 2 bit_offset: 120: chroma_format_idc: 4 not in "
+      "range [0, 3] (out of range)\n",
+      std::string(line));
+}
+
+}  // namespace h265nal
@@ -0,0 +1,245 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_mkv_reader.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+namespace {
+void StoreBlock(const H265MkvReader::Block& block, void* opaque) {
+  auto* blocks = static_cast<std::vector<H265MkvReader::Block>*>(opaque);
+  blocks->push_back(block);
+}
+
+void Append(std::vector<uint8_t>* buffer, const std::vector<uint8_t>& data) {
+  buffer->insert(buffer->end(), data.begin(), data.end());
+}
+
+// An element (with an 8-byte size, or an unknown size).
+std::vector<uint8_t> MakeElement(uint32_t id,
+                                 const std::vector<uint8_t>& payload,
+                                 bool unknown_size = false) {
+  std::vector<uint8_t> element;
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    if ((id >> shift) != 0) {
+      element.push_back(static_cast<uint8_t>(id >> shift));
+    }
+  }
+  element.push_back(0x01);
+  for (int shift = 48; shift >= 0; shift -= 8) {
+    element.push_back(unknown_size ? 0xff
+                                   : static_cast<uint8_t>(payload.size() >>
+                                                          shift));
+  }
+  Append(&element, payload);
+  return element;
+}
+
+// A SimpleBlock (track number < 127).
+std::vector<uint8_t> MakeSimpleBlock(uint8_t track_number,
+                                     int16_t relative_timecode, uint8_t flags,
+                                     const std::vector<uint8_t>& data) {
+  std::vector<uint8_t> block = {
+      static_cast<uint8_t>(0x80 | track_number),
+      static_cast<uint8_t>(static_cast<uint16_t>(relative_timecode) >> 8),
+      static_cast<uint8_t>(relative_timecode), flags};
+  Append(&block, data);
+  return MakeElement(0xa3, block);
+}
+
+// EBML header, and a TrackEntry for an H.265 track (TrackNumber: 1,
+// lengthSizeMinusOne: 1) and an audio track (TrackNumber: 2).
+std::vector<uint8_t> MakeHeaders(std::vector<uint8_t>* tracks) {
+  std::vector<uint8_t> hevc_entry = MakeElement(0xd7, {0x01});
+  Append(&hevc_entry,
+         MakeElement(0x86, {'V', '_', 'M', 'P', 'E', 'G', 'H', '/', 'I', 'S',
+                            'O', '/', 'H', 'E', 'V', 'C'}));
+  Append(&hevc_entry,
+         MakeElement(0x63a2, {0x01, 0x01, 0x60, 0x00, 0x00, 0x00, 0x80, 0x00,
+                              0x00, 0x00, 0x00, 0x00, 0x78, 0xf0, 0x00, 0xfc,
+                              0xfd, 0xf8, 0xf8, 0x00, 0x00, 0x0d, 0x00}));
+  std::vector<uint8_t> audio_entry = MakeElement(0xd7, {0x02});
+  Append(&audio_entry, MakeElement(0x86, {'A', '_', 'O', 'P', 'U', 'S'}));
+  std::vector<uint8_t> entries = MakeElement(0xae, hevc_entry);
+  Append(&entries, MakeElement(0xae, audio_entry));
+  *tracks = MakeElement(0x1654ae6b, entries);
+  return MakeElement(0x1a45dfa3, MakeElement(0x4282, {'w', 'e', 'b', 'm'}));
+}
+}  // namespace
+
+class H265MkvReaderTest : public ::testing::Test {
+ public:
+  H265MkvReaderTest() {}
+  ~H265MkvReaderTest() override {}
+};
+
+TEST_F(H265MkvReaderTest, TestMkv) {
+  // WebM file with an H.265 track, two clusters, and cues
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {
+      // EBML header (DocType: webm)
+      0x1a, 0x45, 0xdf, 0xa3, 0x87, 0x42, 0x82, 0x84, 0x77, 0x65, 0x62, 0x6d,
+      // Segment
+      0x18, 0x53, 0x80, 0x67, 0x40, 0xbe,
+      // SeekHead: Cues
+      0x11, 0x4d, 0x9b, 0x74, 0x8f, 0x4d, 0xbb, 0x8c, 0x53, 0xab, 0x84, 0x1c,
+      0x53, 0xbb, 0x6b, 0x53, 0xac, 0x82, 0x00, 0x9d,
+      // Info: TimecodeScale: 1000000
+      0x15, 0x49, 0xa9, 0x66, 0x87, 0x2a, 0xd7, 0xb1, 0x83, 0x0f, 0x42, 0x40,
+      // Tracks: TrackEntry: TrackNumber: 1, CodecID: V_MPEGH/ISO/HEVC,
+      // CodecPrivate (hvcC without arrays, lengthSizeMinusOne: 3), 64x48
+      0x16, 0x54, 0xae, 0x6b, 0xbc, 0xae, 0xba, 0xd7, 0x81, 0x01, 0x83, 0x81,
+      0x01, 0x86, 0x90, 0x56, 0x5f, 0x4d, 0x50, 0x45, 0x47, 0x48, 0x2f, 0x49,
+      0x53, 0x4f, 0x2f, 0x48, 0x45, 0x56, 0x43, 0x63, 0xa2, 0x97, 0x01, 0x01,
+      0x60, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x78, 0xf0,
+      0x00, 0xfc, 0xfd, 0xf8, 0xf8, 0x00, 0x00, 0x0f, 0x00, 0xe0, 0x86, 0xb0,
+      0x81, 0x40, 0xba, 0x81, 0x30,
+      // Cluster: Timecode: 0, SimpleBlock (keyframe), SimpleBlock (+33)
+      // (a length-prefixed AUD each)
+      0x1f, 0x43, 0xb6, 0x75, 0x9d, 0xe7, 0x81, 0x00, 0xa3, 0x8b, 0x81, 0x00,
+      0x00, 0x80, 0x00, 0x00, 0x00, 0x03, 0x46, 0x01, 0x50, 0xa3, 0x8b, 0x81,
+      0x00, 0x21, 0x00, 0x00, 0x00, 0x00, 0x03, 0x46, 0x01, 0x50,
+      // Cluster: Timecode: 100, BlockGroup: Block, ReferenceBlock
+      0x1f, 0x43, 0xb6, 0x75, 0x95, 0xe7, 0x81, 0x64, 0xa0, 0x90, 0xa1, 0x8b,
+      0x81, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x46, 0x01, 0x50, 0xfb,
+      0x81, 0xdf,
+      // Cues: 0 (first cluster), 100 (second cluster)
+      0x1c, 0x53, 0xbb, 0x6b, 0x9c, 0xbb, 0x8c, 0xb3, 0x81, 0x00, 0xb7, 0x87,
+      0xf7, 0x81, 0x01, 0xf1, 0x82, 0x00, 0x61, 0xbb, 0x8c, 0xb3, 0x81, 0x64,
+      0xb7, 0x87, 0xf7, 0x81, 0x01, 0xf1, 0x82, 0x00, 0x83};
+  // fuzzer::conv: begin
+  std::vector<H265MkvReader::Block> blocks;
+  H265MkvReader mkv_reader({});
+  if (mkv_reader.OpenBuffer(buffer, arraysize(buffer))) {
+    mkv_reader.ReadBlocks(
+        [](const H265MkvReader::Block& block, void* opaque) {
+          using Blocks = std::vector<H265MkvReader::Block>;
+          static_cast<Blocks*>(opaque)->push_back(block);
+        },
+        &blocks);
+  }
+  // fuzzer::conv: end
+
+  EXPECT_EQ(1000000, mkv_reader.GetTimecodeScale());
+  ASSERT_EQ(1, mkv_reader.GetTracks().size());
+  const auto& track = mkv_reader.GetTracks()[0];
+  EXPECT_EQ(1, track.track_number);
+  EXPECT_EQ(64, track.width);
+  EXPECT_EQ(48, track.height);
+  EXPECT_EQ(23, track.codec_private_length);
+  EXPECT_EQ(4, track.length_size);
+
+  ASSERT_EQ(2, mkv_reader.GetCuePoints().size());
+  EXPECT_EQ(100, mkv_reader.GetCuePoints()[1].time);
+
+  const std::vector<uint8_t> aud = {0x00, 0x00, 0x00, 0x03,
+                                    0x46, 0x01, 0x50};
+  ASSERT_EQ(3, blocks.size());
+  EXPECT_EQ(0, blocks[0].timecode);
+  EXPECT_EQ(0, blocks[0].timestamp_ns);
+  EXPECT_TRUE(blocks[0].keyframe);
+  EXPECT_EQ(33, blocks[1].timecode);
+  EXPECT_EQ(33000000, blocks[1].timestamp_ns);
+  EXPECT_FALSE(blocks[1].keyframe);
+  // BlockGroup with a ReferenceBlock
+  EXPECT_EQ(100, blocks[2].timecode);
+  EXPECT_FALSE(blocks[2].keyframe);
+  for (const auto& block : blocks) {
+    EXPECT_EQ(1, block.track_number);
+    EXPECT_EQ(4, block.length_size);
+    EXPECT_EQ(aud, std::vector<uint8_t>(block.data, block.data + block.length));
+  }
+  EXPECT_EQ(2, mkv_reader.GetStats().clusters);
+  EXPECT_EQ(3, mkv_reader.GetStats().blocks);
+
+  // the blocks go directly into the NALU-length parser
+  auto bitstream = H265BitstreamParser::ParseBitstreamNALULength(
+      blocks[0].data, blocks[0].length, blocks[0].length_size, {});
+  ASSERT_TRUE(bitstream != nullptr);
+  EXPECT_EQ(1, bitstream->nal_units.size());
+
+  // seek: only the second cluster is read
+  blocks.clear();
+  EXPECT_TRUE(mkv_reader.Seek(150000000));
+  EXPECT_TRUE(mkv_reader.ReadBlocks(StoreBlock, &blocks));
+  ASSERT_EQ(1, blocks.size());
+  EXPECT_EQ(100, blocks[0].timecode);
+
+  blocks.clear();
+  EXPECT_TRUE(mkv_reader.Seek(50000000));
+  EXPECT_TRUE(mkv_reader.ReadBlocks(StoreBlock, &blocks));
+  EXPECT_EQ(3, blocks.size());
+}
+
+TEST_F(H265MkvReaderTest, TestUnknownSize) {
+  // live WebM: unknown-size segment and clusters, no cues
+  std::vector<uint8_t> tracks;
+  std::vector<uint8_t> buffer = MakeHeaders(&tracks);
+  std::vector<uint8_t> segment = tracks;
+  const std::vector<uint8_t> data = {0x00, 0x03, 0x46, 0x01, 0x50};
+  for (uint8_t timecode : {0, 40}) {
+    std::vector<uint8_t> cluster = MakeElement(0xe7, {timecode});
+    Append(&cluster, MakeSimpleBlock(1, 0, 0x80, data));
+    // audio block
+    Append(&cluster, MakeSimpleBlock(2, 0, 0x80, {0x01, 0x02}));
+    // laced block
+    Append(&cluster, MakeSimpleBlock(1, 20, 0x02, data));
+    Append(&segment, MakeElement(0x1f43b675, cluster, true));
+  }
+  Append(&buffer, MakeElement(0x18538067, segment, true));
+
+  std::vector<H265MkvReader::Block> blocks;
+  H265MkvReader mkv_reader({});
+  ASSERT_TRUE(mkv_reader.OpenBuffer(buffer.data(), buffer.size()));
+  ASSERT_EQ(1, mkv_reader.GetTracks().size());
+  EXPECT_EQ(2, mkv_reader.GetTracks()[0].length_size);
+  EXPECT_TRUE(mkv_reader.GetCuePoints().empty());
+  EXPECT_FALSE(mkv_reader.Seek(0));
+  EXPECT_TRUE(mkv_reader.ReadBlocks(StoreBlock, &blocks));
+
+  ASSERT_EQ(2, blocks.size());
+  EXPECT_EQ(0, blocks[0].timecode);
+  EXPECT_EQ(40, blocks[1].timecode);
+  EXPECT_EQ(40000000, blocks[1].timestamp_ns);
+  EXPECT_EQ(data, std::vector<uint8_t>(blocks[1].data,
+                                       blocks[1].data + blocks[1].length));
+  EXPECT_EQ(2, mkv_reader.GetStats().clusters);
+  EXPECT_EQ(2, mkv_reader.GetStats().blocks_invalid);
+}
+
+TEST_F(H265MkvReaderTest, TestInvalid) {
+  // no H.265 track
+  std::vector<uint8_t> tracks;
+  std::vector<uint8_t> buffer = MakeHeaders(&tracks);
+  H265MkvReader::Options options;
+  options.track_number = 2;
+  H265MkvReader mkv_reader(options);
+  std::vector<uint8_t> file = buffer;
+  Append(&file, MakeElement(0x18538067, tracks));
+  EXPECT_FALSE(mkv_reader.OpenBuffer(file.data(), file.size()));
+
+  // truncated segment
+  file = buffer;
+  Append(&file, MakeElement(0x18538067, tracks));
+  file.resize(file.size() - 1);
+  H265MkvReader mkv_reader2({});
+  EXPECT_FALSE(mkv_reader2.OpenBuffer(file.data(), file.size()));
+
+  // not a Matroska file
+  EXPECT_FALSE(mkv_reader2.OpenBuffer(tracks.data(), tracks.size()));
+  EXPECT_FALSE(mkv_reader2.Open("/nonexistent/file.mkv"));
+}
+
+}  // namespace h265nal
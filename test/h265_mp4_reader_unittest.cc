@@ -0,0 +1,366 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_mp4_reader.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+namespace {
+void StoreSample(const H265Mp4Reader::Sample& sample, void* opaque) {
+  auto* samples = static_cast<std::vector<H265Mp4Reader::Sample>*>(opaque);
+  samples->push_back(sample);
+}
+
+void PutU16(std::vector<uint8_t>* buffer, uint32_t value) {
+  buffer->push_back(static_cast<uint8_t>(value >> 8));
+  buffer->push_back(static_cast<uint8_t>(value));
+}
+
+void PutU32(std::vector<uint8_t>* buffer, uint32_t value) {
+  PutU16(buffer, value >> 16);
+  PutU16(buffer, value & 0xffff);
+}
+
+void Append(std::vector<uint8_t>* buffer, const std::vector<uint8_t>& data) {
+  buffer->insert(buffer->end(), data.begin(), data.end());
+}
+
+std::vector<uint8_t> MakeBox(const char* type,
+                             const std::vector<uint8_t>& payload) {
+  std::vector<uint8_t> box;
+  PutU32(&box, static_cast<uint32_t>(8 + payload.size()));
+  box.insert(box.end(), type, type + 4);
+  Append(&box, payload);
+  return box;
+}
+
+std::vector<uint8_t> MakeFullBox(const char* type, uint32_t version_flags,
+                                 const std::vector<uint32_t>& fields) {
+  std::vector<uint8_t> payload;
+  PutU32(&payload, version_flags);
+  for (uint32_t field : fields) {
+    PutU32(&payload, field);
+  }
+  return MakeBox(type, payload);
+}
+
+// moov with an hvc1 track (track_ID: 1, timescale: 90000), with the given
+// sample tables (stts, stsc, stsz, stco), and with track extends (default
+// sample duration: 3000, non-sync)
+std::vector<uint8_t> MakeMoov(const std::vector<uint8_t>& sample_tables) {
+  std::vector<uint8_t> entry(78, 0);
+  entry[7] = 1;
+  // width, height
+  entry[24] = 0x05;
+  entry[26] = 0x02;
+  entry[27] = 0xd0;
+  // hvcC without arrays (lengthSizeMinusOne: 1)
+  Append(&entry, MakeBox("hvcC", {0x01, 0x01, 0x60, 0x00, 0x00, 0x00, 0x80,
+                                  0x00, 0x00, 0x00, 0x00, 0x00, 0x78, 0xf0,
+                                  0x00, 0xfc, 0xfd, 0xf8, 0xf8, 0x00, 0x00,
+                                  0x0d, 0x00}));
+  std::vector<uint8_t> stsd;
+  PutU32(&stsd, 0);
+  PutU32(&stsd, 1);
+  Append(&stsd, MakeBox("hvc1", entry));
+  std::vector<uint8_t> stbl = MakeBox("stsd", stsd);
+  Append(&stbl, sample_tables);
+  std::vector<uint8_t> mdia =
+      MakeFullBox("mdhd", 0, {0, 0, 90000, 0, 0x55c40000});
+  Append(&mdia, MakeBox("minf", MakeBox("stbl", stbl)));
+  std::vector<uint8_t> trak =
+      MakeFullBox("tkhd", 3, {0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                              0, 0, 0, 0});
+  Append(&trak, MakeBox("mdia", mdia));
+  std::vector<uint8_t> moov = MakeBox("trak", trak);
+  Append(&moov, MakeBox("mvex", MakeFullBox("trex", 0,
+                                            {1, 1, 3000, 0, 0x00010000})));
+  return MakeBox("moov", moov);
+}
+
+// moov with an hvc1 track without samples (see MakeMoov())
+std::vector<uint8_t> MakeFragmentedMoov() {
+  std::vector<uint8_t> sample_tables = MakeFullBox("stts", 0, {0});
+  Append(&sample_tables, MakeFullBox("stsc", 0, {0}));
+  Append(&sample_tables, MakeFullBox("stsz", 0, {0, 0}));
+  Append(&sample_tables, MakeFullBox("stco", 0, {0}));
+  return MakeMoov(sample_tables);
+}
+
+// moof and mdat with `num_samples` AUD samples (2-byte length fields). The
+// first sample is a sync sample.
+std::vector<uint8_t> MakeFragment(uint32_t sequence_number, bool add_tfdt,
+                                  uint32_t base_media_decode_time,
+                                  uint32_t num_samples) {
+  const std::vector<uint8_t> sample = {0x00, 0x03, 0x46, 0x01, 0x50};
+  // tfhd: default-base-is-moof
+  std::vector<uint8_t> traf = MakeFullBox("tfhd", 0x020000, {1});
+  if (add_tfdt) {
+    Append(&traf, MakeFullBox("tfdt", 0, {base_media_decode_time}));
+  }
+  // trun: data offset, first sample flags, sample sizes
+  std::vector<uint32_t> trun_fields = {num_samples, 0, 0x02000000};
+  for (uint32_t i = 0; i < num_samples; i++) {
+    trun_fields.push_back(static_cast<uint32_t>(sample.size()));
+  }
+  size_t moof_size = 8 + 16 + 8 + traf.size() + 12 + 4 * trun_fields.size();
+  // data_offset: the samples follow the mdat header
+  trun_fields[1] = static_cast<uint32_t>(moof_size + 8);
+  Append(&traf, MakeFullBox("trun", 0x000205, trun_fields));
+  std::vector<uint8_t> moof = MakeFullBox("mfhd", 0, {sequence_number});
+  Append(&moof, MakeBox("traf", traf));
+  std::vector<uint8_t> fragment = MakeBox("moof", moof);
+  std::vector<uint8_t> mdat;
+  for (uint32_t i = 0; i < num_samples; i++) {
+    Append(&mdat, sample);
+  }
+  Append(&fragment, MakeBox("mdat", mdat));
+  return fragment;
+}
+}  // namespace
+
+class H265Mp4ReaderTest : public ::testing::Test {
+ public:
+  H265Mp4ReaderTest() {}
+  ~H265Mp4ReaderTest() override {}
+};
+
+TEST_F(H265Mp4ReaderTest, TestMp4) {
+  // mp4 file with an hvc1 track, and two samples (moov after mdat)
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {
+      // ftyp
+      0x00, 0x00, 0x00, 0x18, 0x66, 0x74, 0x79, 0x70, 0x69, 0x73, 0x6f, 0x6d,
+      0x00, 0x00, 0x02, 0x00, 0x69, 0x73, 0x6f, 0x6d, 0x68, 0x76, 0x63, 0x31,
+      // mdat: 2 samples (a length-prefixed AUD each)
+      0x00, 0x00, 0x00, 0x16, 0x6d, 0x64, 0x61, 0x74, 0x00, 0x00, 0x00, 0x03,
+      0x46, 0x01, 0x50, 0x00, 0x00, 0x00, 0x03, 0x46, 0x01, 0x50,
+      // moov
+      0x00, 0x00, 0x01, 0xc1, 0x6d, 0x6f, 0x6f, 0x76,
+      // trak
+      0x00, 0x00, 0x01, 0xb9, 0x74, 0x72, 0x61, 0x6b,
+      // tkhd (track_ID: 1)
+      0x00, 0x00, 0x00, 0x5c, 0x74, 0x6b, 0x68, 0x64, 0x00, 0x00, 0x00, 0x03,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0xd0, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x40, 0x00, 0x00, 0x00, 0x30, 0x00, 0x00,
+      // mdia
+      0x00, 0x00, 0x01, 0x55, 0x6d, 0x64, 0x69, 0x61,
+      // mdhd (timescale: 30000)
+      0x00, 0x00, 0x00, 0x20, 0x6d, 0x64, 0x68, 0x64, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x75, 0x30,
+      0x00, 0x00, 0x07, 0xd0, 0x55, 0xc4, 0x00, 0x00,
+      // minf
+      0x00, 0x00, 0x01, 0x2d, 0x6d, 0x69, 0x6e, 0x66,
+      // stbl
+      0x00, 0x00, 0x01, 0x25, 0x73, 0x74, 0x62, 0x6c,
+      // stsd: hvc1 (64x48), hvcC (lengthSizeMinusOne: 3, no arrays)
+      0x00, 0x00, 0x00, 0x85, 0x73, 0x74, 0x73, 0x64, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x75, 0x68, 0x76, 0x63, 0x31,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x40, 0x00, 0x30, 0x00, 0x48, 0x00, 0x00, 0x00, 0x48, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x18, 0xff, 0xff, 0x00, 0x00, 0x00, 0x1f, 0x68, 0x76,
+      0x63, 0x43, 0x01, 0x01, 0x60, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x78, 0xf0, 0x00, 0xfc, 0xfd, 0xf8, 0xf8, 0x00, 0x00, 0x0f,
+      0x00,
+      // stts: 2 samples of 1000
+      0x00, 0x00, 0x00, 0x18, 0x73, 0x74, 0x74, 0x73, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x03, 0xe8,
+      // ctts: 1000, 0
+      0x00, 0x00, 0x00, 0x20, 0x63, 0x74, 0x74, 0x73, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x03, 0xe8,
+      0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+      // stss: sample 1
+      0x00, 0x00, 0x00, 0x14, 0x73, 0x74, 0x73, 0x73, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
+      // stsc: 2 samples per chunk
+      0x00, 0x00, 0x00, 0x1c, 0x73, 0x74, 0x73, 0x63, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02,
+      0x00, 0x00, 0x00, 0x01,
+      // stsz: 7, 7
+      0x00, 0x00, 0x00, 0x1c, 0x73, 0x74, 0x73, 0x7a, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x07,
+      0x00, 0x00, 0x00, 0x07,
+      // stco: 32
+      0x00, 0x00, 0x00, 0x14, 0x73, 0x74, 0x63, 0x6f, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x20};
+  // fuzzer::conv: begin
+  std::vector<H265Mp4Reader::Sample> samples;
+  H265Mp4Reader mp4_reader({});
+  if (mp4_reader.OpenBuffer(buffer, arraysize(buffer))) {
+    mp4_reader.ReadSamples(
+        [](const H265Mp4Reader::Sample& sample, void* opaque) {
+          using Samples = std::vector<H265Mp4Reader::Sample>;
+          static_cast<Samples*>(opaque)->push_back(sample);
+        },
+        &samples);
+  }
+  // fuzzer::conv: end
+
+  ASSERT_EQ(1, mp4_reader.GetTracks().size());
+  const auto& track = mp4_reader.GetTracks()[0];
+  EXPECT_EQ(1, track.track_id);
+  EXPECT_EQ(30000, track.timescale);
+  EXPECT_EQ(64, track.width);
+  EXPECT_EQ(48, track.height);
+  EXPECT_EQ(4, track.length_size);
+  EXPECT_EQ(23, track.hvcc_length);
+
+  ASSERT_EQ(2, samples.size());
+  EXPECT_EQ(0, samples[0].index);
+  EXPECT_EQ(0, samples[0].decode_time);
+  EXPECT_EQ(1000, samples[0].composition_time);
+  EXPECT_EQ(1000, samples[0].duration);
+  EXPECT_EQ(30000, samples[0].timescale);
+  EXPECT_TRUE(samples[0].sync);
+  EXPECT_EQ(buffer + 32, samples[0].data);
+  EXPECT_EQ(7, samples[0].length);
+  EXPECT_EQ(1, samples[1].index);
+  EXPECT_EQ(1000, samples[1].decode_time);
+  EXPECT_EQ(1000, samples[1].composition_time);
+  EXPECT_FALSE(samples[1].sync);
+  EXPECT_EQ(buffer + 39, samples[1].data);
+  EXPECT_EQ(2, mp4_reader.GetStats().samples);
+
+  // the samples go directly into the NALU-length parser
+  auto bitstream = H265BitstreamParser::ParseBitstreamNALULength(
+      samples[1].data, samples[1].length, samples[1].length_size, {});
+  ASSERT_TRUE(bitstream != nullptr);
+  ASSERT_EQ(1, bitstream->nal_units.size());
+  EXPECT_EQ(NalUnitType::AUD_NUT,
+            bitstream->nal_units[0]->nal_unit_header->nal_unit_type);
+
+  // track filter
+  H265Mp4Reader::Options options;
+  options.track_id = 2;
+  H265Mp4Reader other_reader(options);
+  EXPECT_FALSE(other_reader.OpenBuffer(buffer, arraysize(buffer)));
+}
+
+TEST_F(H265Mp4ReaderTest, TestFragmentedMp4) {
+  std::vector<uint8_t> buffer = MakeFragmentedMoov();
+  Append(&buffer, MakeFragment(1, true, 90000, 2));
+  // no tfdt: the decode time follows the previous fragment
+  Append(&buffer, MakeFragment(2, false, 0, 3));
+
+  std::vector<H265Mp4Reader::Sample> samples;
+  H265Mp4Reader mp4_reader({});
+  ASSERT_TRUE(mp4_reader.OpenBuffer(buffer.data(), buffer.size()));
+  ASSERT_EQ(1, mp4_reader.GetTracks().size());
+  EXPECT_EQ(2, mp4_reader.GetTracks()[0].length_size);
+  EXPECT_EQ(1280, mp4_reader.GetTracks()[0].width);
+  EXPECT_EQ(720, mp4_reader.GetTracks()[0].height);
+  EXPECT_TRUE(mp4_reader.ReadSamples(StoreSample, &samples));
+
+  ASSERT_EQ(5, samples.size());
+  const uint64_t decode_times[] = {90000, 93000, 96000, 99000, 102000};
+  const bool syncs[] = {true, false, true, false, false};
+  for (size_t i = 0; i < samples.size(); i++) {
+    EXPECT_EQ(i, samples[i].index);
+    EXPECT_EQ(decode_times[i], samples[i].decode_time);
+    EXPECT_EQ(3000, samples[i].duration);
+    EXPECT_EQ(syncs[i], samples[i].sync);
+    ASSERT_EQ(5, samples[i].length);
+    EXPECT_EQ(0x46, samples[i].data[2]);
+  }
+  const auto& stats = mp4_reader.GetStats();
+  EXPECT_EQ(2, stats.fragments);
+  EXPECT_EQ(5, stats.samples);
+  EXPECT_EQ(0, stats.samples_invalid);
+}
+
+TEST_F(H265Mp4ReaderTest, TestInvalidSamples) {
+  std::vector<uint8_t> buffer = MakeFragmentedMoov();
+  Append(&buffer, MakeFragment(1, true, 0, 2));
+  // the last sample is cut short
+  buffer.resize(buffer.size() - 1);
+
+  std::vector<H265Mp4Reader::Sample> samples;
+  H265Mp4Reader mp4_reader({});
+  ASSERT_TRUE(mp4_reader.OpenBuffer(buffer.data(), buffer.size()));
+  // the truncated mdat box is still walked
+  EXPECT_TRUE(mp4_reader.ReadSamples(StoreSample, &samples));
+  EXPECT_EQ(1, samples.size());
+  EXPECT_EQ(1, mp4_reader.GetStats().samples_invalid);
+
+  // no moov
+  const uint8_t mdat[] = {0x00, 0x00, 0x00, 0x08, 0x6d, 0x64, 0x61, 0x74};
+  H265Mp4Reader other_reader({});
+  EXPECT_FALSE(other_reader.OpenBuffer(mdat, arraysize(mdat)));
+}
+
+TEST_F(H265Mp4ReaderTest, TestHugeSampleCounts) {
+  // moov: 2^32 - 1 samples of 1 byte (stsz without size table), all in
+  // the first chunk
+  std::vector<uint8_t> sample_tables = MakeFullBox("stts", 0, {0});
+  Append(&sample_tables, MakeFullBox("stsc", 0, {1, 1, 0xffffffff, 1}));
+  Append(&sample_tables, MakeFullBox("stsz", 0, {1, 0xffffffff}));
+  Append(&sample_tables, MakeFullBox("stco", 0, {1, 0}));
+  std::vector<uint8_t> buffer = MakeMoov(sample_tables);
+  const uint64_t length = buffer.size();
+
+  H265Mp4Reader mp4_reader({});
+  ASSERT_TRUE(mp4_reader.OpenBuffer(buffer.data(), buffer.size()));
+  // the samples beyond the file size are not walked
+  EXPECT_TRUE(mp4_reader.ReadSamples(nullptr, nullptr));
+  EXPECT_EQ(length, mp4_reader.GetStats().samples);
+  EXPECT_EQ(0xffffffff - length, mp4_reader.GetStats().samples_invalid);
+
+  // moof: a trun with 2^32 - 1 samples, and no per-sample fields (empty
+  // samples, as there is no default sample size)
+  buffer = MakeFragmentedMoov();
+  std::vector<uint8_t> traf = MakeFullBox("tfhd", 0x020000, {1});
+  Append(&traf, MakeFullBox("trun", 0, {0xffffffff}));
+  Append(&buffer, MakeBox("moof", MakeBox("traf", traf)));
+  const uint64_t fragmented_length = buffer.size();
+
+  H265Mp4Reader fragmented_reader({});
+  ASSERT_TRUE(fragmented_reader.OpenBuffer(buffer.data(), buffer.size()));
+  EXPECT_TRUE(fragmented_reader.ReadSamples(nullptr, nullptr));
+  const auto& stats = fragmented_reader.GetStats();
+  EXPECT_EQ(1, stats.fragments);
+  EXPECT_EQ(fragmented_length, stats.samples);
+  EXPECT_EQ(0xffffffff - fragmented_length, stats.samples_invalid);
+}
+
+TEST_F(H265Mp4ReaderTest, TestOpen) {
+  std::vector<uint8_t> buffer = MakeFragmentedMoov();
+  Append(&buffer, MakeFragment(1, true, 0, 2));
+  std::string filename = ::testing::TempDir() + "h265_mp4_reader_test.mp4";
+  FILE* fp = fopen(filename.c_str(), "wb");
+  ASSERT_TRUE(fp != nullptr);
+  ASSERT_EQ(buffer.size(), fwrite(buffer.data(), 1, buffer.size(), fp));
+  fclose(fp);
+
+  std::vector<H265Mp4Reader::Sample> samples;
+  H265Mp4Reader mp4_reader({});
+  ASSERT_TRUE(mp4_reader.Open(filename.c_str()));
+  EXPECT_TRUE(mp4_reader.ReadSamples(StoreSample, &samples));
+  EXPECT_EQ(2, samples.size());
+  mp4_reader.Close();
+  remove(filename.c_str());
+  EXPECT_TRUE(mp4_reader.GetTracks().empty());
+}
+
+}  // namespace h265nal
@@ -0,0 +1,282 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_nal_filter.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+namespace {
+std::vector<uint8_t> Concatenate(const std::vector<BufferSegment>& spans) {
+  std::vector<uint8_t> out;
+  for (const auto& span : spans) {
+    out.insert(out.end(), span.data, span.data + span.length);
+  }
+  return out;
+}
+
+// NAL unit types of an Annex B buffer.
+std::vector<uint32_t> GetNalUnitTypes(const std::vector<uint8_t>& buffer) {
+  std::vector<uint32_t> nal_unit_types;
+  for (const auto& nalu_index :
+       H265BitstreamParser::FindNaluIndices(buffer.data(), buffer.size())) {
+    nal_unit_types.push_back(
+        (buffer[nalu_index.payload_start_offset] >> 1) & 0x3f);
+  }
+  return nal_unit_types;
+}
+}  // namespace
+
+class H265NalFilterTest : public ::testing::Test {
+ public:
+  H265NalFilterTest() {}
+  ~H265NalFilterTest() override {}
+};
+
+TEST_F(H265NalFilterTest, TestFilter) {
+  // AUD, VPS, SPS, PPS, SEI (user data unregistered and picture timing),
+  // IDR, FD, AUD, TRAIL_R, AUD, CRA.
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {
+      // AUD
+      0x00, 0x00, 0x00, 0x01, 0x46, 0x01, 0x50,
+      // VPS
+      0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+      0x00, 0x00, 0x03, 0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+      0x5d, 0xac, 0x59,
+      // SPS
+      0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03,
+      0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x5d, 0xa0, 0x02,
+      0x80, 0x80, 0x2e, 0x1f, 0x13, 0x96, 0xbb, 0x93, 0x24, 0xbb, 0x95, 0x82,
+      0x83, 0x03, 0x01, 0x76, 0x85, 0x09, 0x40,
+      // PPS
+      0x00, 0x00, 0x00, 0x01, 0x44, 0x01, 0xc0, 0xf3, 0xc0, 0x02, 0x10,
+      // SEI
+      0x00, 0x00, 0x01, 0x4e, 0x01, 0x05, 0x02, 0xaa, 0xbb, 0x01, 0x01, 0xcc,
+      0x80,
+      // IDR_W_RADL
+      0x00, 0x00, 0x01, 0x26, 0x01, 0xaf, 0x09,
+      // FD
+      0x00, 0x00, 0x01, 0x4c, 0x01, 0xff, 0xff, 0x80,
+      // AUD
+      0x00, 0x00, 0x01, 0x46, 0x01, 0x50,
+      // TRAIL_R
+      0x00, 0x00, 0x01, 0x02, 0x01, 0xd0,
+      // AUD
+      0x00, 0x00, 0x01, 0x46, 0x01, 0x50,
+      // CRA
+      0x00, 0x00, 0x01, 0x2a, 0x01, 0xa0};
+  // fuzzer::conv: begin
+  H265NalFilter filter;
+  filter.AddDropNalUnitTypes({NalUnitType::FD_NUT, NalUnitType::AUD_NUT});
+  filter.AddDropSeiPayloadTypes({1});
+  filter.AddKeepIrapOnly();
+  filter.AddInsertParameterSets();
+  std::vector<h265nal::BufferSegment> spans;
+  filter.Filter(buffer, arraysize(buffer), &spans);
+  // fuzzer::conv: end
+
+  // VPS, SPS, PPS, and the SEI start code (contiguous)
+  ASSERT_EQ(7, spans.size());
+  EXPECT_EQ(buffer + 7, spans[0].data);
+  EXPECT_EQ(84, spans[0].length);
+  // rewritten SEI (without the picture timing message)
+  EXPECT_THAT(std::vector<uint8_t>(spans[1].data,
+                                   spans[1].data + spans[1].length),
+              ::testing::ElementsAreArray(
+                  {0x4e, 0x01, 0x05, 0x02, 0xaa, 0xbb, 0x80}));
+  // IDR (parameter sets already present)
+  EXPECT_EQ(buffer + 101, spans[2].data);
+  EXPECT_EQ(7, spans[2].length);
+  // parameter sets inserted before the CRA
+  EXPECT_THAT(std::vector<uint8_t>(spans[3].data,
+                                   spans[3].data + spans[3].length),
+              ::testing::ElementsAreArray(buffer + 7, buffer + 34));
+  EXPECT_THAT(std::vector<uint8_t>(spans[4].data,
+                                   spans[4].data + spans[4].length),
+              ::testing::ElementsAreArray(buffer + 34, buffer + 77));
+  EXPECT_THAT(std::vector<uint8_t>(spans[5].data,
+                                   spans[5].data + spans[5].length),
+              ::testing::ElementsAreArray(buffer + 77, buffer + 88));
+  // CRA
+  EXPECT_EQ(buffer + 134, spans[6].data);
+  EXPECT_EQ(6, spans[6].length);
+
+  EXPECT_THAT(GetNalUnitTypes(Concatenate(spans)),
+              ::testing::ElementsAre(NalUnitType::VPS_NUT,
+                                     NalUnitType::SPS_NUT,
+                                     NalUnitType::PPS_NUT,
+                                     NalUnitType::PREFIX_SEI_NUT,
+                                     NalUnitType::IDR_W_RADL,
+                                     NalUnitType::VPS_NUT,
+                                     NalUnitType::SPS_NUT,
+                                     NalUnitType::PPS_NUT,
+                                     NalUnitType::CRA_NUT));
+
+  const auto& stats = filter.GetStats();
+  EXPECT_EQ(11, stats.nal_units);
+  EXPECT_EQ(5, stats.nal_units_dropped);
+  EXPECT_EQ(1, stats.nal_units_rewritten);
+  EXPECT_EQ(3, stats.nal_units_inserted);
+}
+
+TEST_F(H265NalFilterTest, TestPassThrough) {
+  const uint8_t buffer[] = {0x00, 0x00, 0x00, 0x01, 0x46, 0x01, 0x50,
+                            0x00, 0x00, 0x01, 0x26, 0x01, 0xaf, 0x09,
+                            0x00, 0x00, 0x01, 0x02, 0x01, 0xd0};
+  // no stages: a single span, pointing to the input
+  H265NalFilter filter;
+  std::vector<BufferSegment> spans;
+  EXPECT_EQ(arraysize(buffer),
+            filter.Filter(buffer, arraysize(buffer), &spans));
+  ASSERT_EQ(1, spans.size());
+  EXPECT_EQ(buffer, spans[0].data);
+  EXPECT_EQ(arraysize(buffer), spans[0].length);
+  EXPECT_EQ(3, filter.GetStats().nal_units);
+
+  // dropping the middle NAL unit splits the span
+  H265NalFilter drop_filter;
+  drop_filter.AddDropNalUnitTypes({NalUnitType::IDR_W_RADL});
+  spans.clear();
+  EXPECT_EQ(13, drop_filter.Filter(buffer, arraysize(buffer), &spans));
+  ASSERT_EQ(2, spans.size());
+  EXPECT_EQ(buffer, spans[0].data);
+  EXPECT_EQ(7, spans[0].length);
+  EXPECT_EQ(buffer + 14, spans[1].data);
+  EXPECT_EQ(6, spans[1].length);
+}
+
+TEST_F(H265NalFilterTest, TestDropSeiPayloadTypes) {
+  // SEI with a picture timing message, and a user data unregistered one
+  // whose payload needs emulation prevention
+  const uint8_t buffer[] = {0x00, 0x00, 0x01, 0x4e, 0x01, 0x01, 0x01, 0xcc,
+                            0x05, 0x03, 0x00, 0x00, 0x03, 0x01, 0x80};
+  H265NalFilter filter;
+  filter.AddDropSeiPayloadTypes({1});
+  std::vector<BufferSegment> spans;
+  filter.Filter(buffer, arraysize(buffer), &spans);
+  EXPECT_THAT(Concatenate(spans),
+              ::testing::ElementsAreArray({0x00, 0x00, 0x01, 0x4e, 0x01, 0x05,
+                                           0x03, 0x00, 0x00, 0x03, 0x01,
+                                           0x80}));
+  EXPECT_EQ(1, filter.GetStats().nal_units_rewritten);
+
+  // no message left: the SEI is dropped
+  H265NalFilter drop_filter;
+  drop_filter.AddDropSeiPayloadTypes({1, 5});
+  spans.clear();
+  EXPECT_EQ(0, drop_filter.Filter(buffer, arraysize(buffer), &spans));
+  EXPECT_TRUE(spans.empty());
+  EXPECT_EQ(1, drop_filter.GetStats().nal_units_dropped);
+}
+
+TEST_F(H265NalFilterTest, TestDropSeiPayloadTypesStructureOfPictures) {
+  // SEI with structure of pictures (payloadType 128, whose first byte is
+  // the same as the RBSP trailing bits), buffering period, structure of
+  // pictures and picture timing messages
+  const uint8_t buffer[] = {0x00, 0x00, 0x01, 0x4e, 0x01, 0x80, 0x01,
+                            0x11, 0x00, 0x01, 0x22, 0x80, 0x01, 0x33,
+                            0x01, 0x01, 0x44, 0x80};
+  H265NalFilter filter;
+  filter.AddDropSeiPayloadTypes({0});
+  std::vector<BufferSegment> spans;
+  filter.Filter(buffer, arraysize(buffer), &spans);
+  EXPECT_THAT(Concatenate(spans),
+              ::testing::ElementsAreArray({0x00, 0x00, 0x01, 0x4e, 0x01, 0x80,
+                                           0x01, 0x11, 0x80, 0x01, 0x33, 0x01,
+                                           0x01, 0x44, 0x80}));
+  EXPECT_EQ(1, filter.GetStats().nal_units_rewritten);
+
+  // buffering period first: the messages after it are kept
+  const uint8_t buffer2[] = {0x00, 0x00, 0x01, 0x4e, 0x01, 0x00, 0x01, 0x22,
+                             0x80, 0x01, 0x33, 0x01, 0x01, 0x44, 0x80};
+  spans.clear();
+  filter.Filter(buffer2, arraysize(buffer2), &spans);
+  EXPECT_THAT(Concatenate(spans),
+              ::testing::ElementsAreArray({0x00, 0x00, 0x01, 0x4e, 0x01, 0x80,
+                                           0x01, 0x33, 0x01, 0x01, 0x44,
+                                           0x80}));
+  EXPECT_EQ(0, filter.GetStats().nal_units_dropped);
+
+  // nothing to drop: the SEI passes unchanged
+  H265NalFilter keep_filter;
+  keep_filter.AddDropSeiPayloadTypes({5});
+  spans.clear();
+  keep_filter.Filter(buffer, arraysize(buffer), &spans);
+  ASSERT_EQ(1, spans.size());
+  EXPECT_EQ(buffer, spans[0].data);
+  EXPECT_EQ(arraysize(buffer), spans[0].length);
+}
+
+TEST_F(H265NalFilterTest, TestCustomStage) {
+  const uint8_t buffer[] = {0x00, 0x00, 0x01, 0x26, 0x01, 0xaf, 0x09,
+                            0x00, 0x00, 0x01, 0x02, 0x01, 0xd0,
+                            0x00, 0x00, 0x01, 0x02, 0x03, 0xd2};
+  // drop TemporalId 2, and insert an AUD before each picture left
+  H265NalFilter filter;
+  int pictures = 0;
+  filter.AddStage(
+      [](H265NalFilter::NalUnit* nal_unit, H265NalFilter* nal_filter,
+         void* opaque) {
+        if (nal_unit->temporal_id == 2) {
+          return false;
+        }
+        (*static_cast<int*>(opaque))++;
+        const uint8_t aud[] = {0x46, 0x01, 0x50};
+        nal_filter->InsertNalUnit(aud, arraysize(aud));
+        return true;
+      },
+      &pictures);
+  std::vector<BufferSegment> spans;
+  EXPECT_EQ(27, filter.Filter(buffer, arraysize(buffer), &spans));
+  EXPECT_EQ(2, pictures);
+  // inserted spans are not merged with the input ones
+  ASSERT_EQ(4, spans.size());
+  EXPECT_EQ(buffer, spans[1].data);
+  EXPECT_EQ(buffer + 7, spans[3].data);
+  EXPECT_THAT(Concatenate(spans),
+              ::testing::ElementsAreArray(
+                  {0x00, 0x00, 0x00, 0x01, 0x46, 0x01, 0x50, 0x00, 0x00,
+                   0x01, 0x26, 0x01, 0xaf, 0x09, 0x00, 0x00, 0x00, 0x01,
+                   0x46, 0x01, 0x50, 0x00, 0x00, 0x01, 0x02, 0x01, 0xd0}));
+  EXPECT_EQ(2, filter.GetStats().nal_units_inserted);
+  EXPECT_EQ(1, filter.GetStats().nal_units_dropped);
+
+  // a NAL unit dropped by a later stage drops the NAL units inserted
+  // before it
+  H265NalFilter insert_filter;
+  insert_filter.AddStage(
+      [](H265NalFilter::NalUnit* /* nal_unit */, H265NalFilter* nal_filter,
+         void* /* opaque */) {
+        const uint8_t aud[] = {0x46, 0x01, 0x50};
+        nal_filter->InsertNalUnit(aud, arraysize(aud));
+        return true;
+      },
+      nullptr);
+  insert_filter.AddStage(
+      [](H265NalFilter::NalUnit* nal_unit, H265NalFilter* /* nal_filter */,
+         void* /* opaque */) { return nal_unit->temporal_id != 2; },
+      nullptr);
+  spans.clear();
+  EXPECT_EQ(27, insert_filter.Filter(buffer, arraysize(buffer), &spans));
+  EXPECT_THAT(Concatenate(spans),
+              ::testing::ElementsAreArray(
+                  {0x00, 0x00, 0x00, 0x01, 0x46, 0x01, 0x50, 0x00, 0x00,
+                   0x01, 0x26, 0x01, 0xaf, 0x09, 0x00, 0x00, 0x00, 0x01,
+                   0x46, 0x01, 0x50, 0x00, 0x00, 0x01, 0x02, 0x01, 0xd0}));
+  EXPECT_EQ(2, insert_filter.GetStats().nal_units_inserted);
+  EXPECT_EQ(1, insert_filter.GetStats().nal_units_dropped);
+}
+
+}  // namespace h265nal
@@ -123,6 +123,32 @@ TEST_F(H265NalUnitParserTest, TestSampleNalUnit) {
   EXPECT_EQ(0, vps->vps_extension_data_flag);
 }
 
+TEST_F(H265NalUnitParserTest, TestSampleNalUnitSegments) {
+  // VPS for a 1280x720 camera capture, split in the middle of an
+  // emulation prevention sequence (0x00, 0x00 | 0x03)
+  const uint8_t buffer0[] = {0x40, 0x01, 0x0c, 0x01, 0xff, 0xff,
+                             0x01, 0x60, 0x00, 0x00};
+  const uint8_t buffer1[] = {0x03, 0x00, 0xb0, 0x00, 0x00, 0x03, 0x00};
+  const uint8_t buffer2[] = {0x00, 0x03, 0x00, 0x5d, 0xac, 0x59, 0x00};
+  const BufferSegment segments[] = {{buffer0, arraysize(buffer0)},
+                                    {buffer1, arraysize(buffer1)},
+                                    {buffer2, arraysize(buffer2)}};
+  H265BitstreamParserState bitstream_parser_state;
+  ParsingOptions parsing_options;
+  parsing_options.add_checksum = true;
+  auto nal_unit = H265NalUnitParser::ParseNalUnit(
+      segments, arraysize(segments), &bitstream_parser_state, parsing_options);
+
+  EXPECT_TRUE(nal_unit != nullptr);
+  // same results as the contiguous version
+  EXPECT_EQ(20, nal_unit->parsed_length);
+  char checksum_printable[64] = {};
+  nal_unit->checksum->fdump(checksum_printable, 64);
+  EXPECT_STREQ(checksum_printable, "bfa24594");
+  EXPECT_EQ(NalUnitType::VPS_NUT, nal_unit->nal_unit_header->nal_unit_type);
+  EXPECT_EQ(0, nal_unit->nal_unit_payload->vps->vps_extension_flag);
+}
+
 TEST_F(H265NalUnitParserTest, TestEmptyNalUnit) {
   const uint8_t buffer[] = {0};
   H265BitstreamParserState bitstream_parser_state;
@@ -0,0 +1,321 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_parameter_set_writer.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_common.h"
+#include "h265_pps_parser.h"
+#include "h265_scaling_list_data_parser.h"
+#include "h265_sps_parser.h"
+#include "h265_vps_parser.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+namespace {
+// NAL unit header size
+constexpr size_t kNalUnitHeaderSize = 2;
+
+// parameter sets (NAL unit header and escaped RBSP) from the media/ and
+// video/ files
+const std::vector<std::vector<uint8_t>> kVpsNalUnits = {
+    // media/foo.265
+    {0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00,
+     0x80, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x78, 0x9d, 0xc0, 0x90},
+    // media/nvenc.265
+    {0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x40, 0x00, 0x00, 0x03, 0x00,
+     0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x78, 0xac, 0x09},
+    // video/akiyo.kvazaar.*
+    {0x40, 0x01, 0x0c, 0x02, 0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03,
+     0x00, 0x80, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0xba, 0x00,
+     0x00, 0x2c, 0x09},
+    // video/akiyo.turing.*
+    {0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03,
+     0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x3c,
+     0x94, 0x90, 0x24},
+    // video/akiyo.x265.*
+    {0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00,
+     0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x3c, 0x95, 0x98, 0x09},
+    // video/iphone_11s.*
+    {0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00,
+     0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x5d, 0x95, 0x98, 0x09},
+};
+
+const std::vector<std::vector<uint8_t>> kSpsNalUnits = {
+    // media/foo.265
+    {0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x80, 0x00,
+     0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x78, 0xa0, 0x03, 0xc0, 0x80,
+     0x32, 0x16, 0x59, 0xde, 0x49, 0x1b, 0x6b, 0x80, 0x40, 0x00, 0x00,
+     0xfa, 0x00, 0x00, 0x17, 0x70, 0x02},
+    // media/nvenc.265
+    {0x42, 0x01, 0x01, 0x01, 0x40, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03,
+     0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x78, 0xa0, 0x02, 0x80,
+     0x80, 0x2e, 0x1f, 0x13, 0x96, 0xb4, 0xa4, 0x25, 0x92, 0xe3, 0x01,
+     0x01, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00, 0x3c,
+     0x60, 0x05, 0xde, 0x51, 0x00, 0x01, 0x6e, 0x36, 0x00, 0x01, 0xe8,
+     0x48, 0x10},
+    // video/akiyo.kvazaar.*
+    {0x42, 0x01, 0x02, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x80, 0x00,
+     0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0xba, 0x00, 0x00, 0xa0, 0x0b,
+     0x08, 0x04, 0x85, 0xde, 0x49, 0x32, 0xaf, 0xfc, 0x02, 0x00, 0x01,
+     0xd4, 0x04, 0x00, 0x00, 0x0f, 0xa4, 0x00, 0x01, 0xd4, 0xc0, 0x20},
+    // video/akiyo.turing.*
+    {0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03,
+     0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x3c, 0xa0, 0x0b, 0x08,
+     0x04, 0x85, 0xb1, 0x49, 0x92, 0x44, 0x8a, 0xc8},
+    // video/akiyo.x265.*
+    {0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00,
+     0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x3c, 0xa0, 0x0b, 0x08, 0x04,
+     0x85, 0x96, 0x56, 0x69, 0x24, 0xca, 0xff, 0xf0, 0x08, 0x00, 0x07,
+     0x56, 0x80, 0x80, 0x00, 0x01, 0xf4, 0x80, 0x00, 0x3a, 0x98, 0x04},
+    // video/iphone_11s.*
+    {0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00,
+     0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x5d, 0xa0, 0x05, 0x82, 0x00,
+     0x50, 0x16, 0x59, 0x59, 0xa4, 0x93, 0x2b, 0x9b, 0x02, 0x00, 0x00,
+     0x03, 0x00, 0x02, 0x00, 0x00, 0x03, 0x00, 0x32, 0x10},
+};
+
+const std::vector<std::vector<uint8_t>> kPpsNalUnits = {
+    // media/foo.265
+    {0x44, 0x01, 0xc1, 0x73, 0xd1, 0x89},
+    // media/nvenc.265
+    {0x44, 0x01, 0xc0, 0xf7, 0xc0, 0xcc, 0x90},
+    // video/akiyo.kvazaar.qp15.265, qp30, qp50
+    {0x44, 0x01, 0xc1, 0x61, 0x71, 0x82, 0x99, 0x20},
+    {0x44, 0x01, 0xc1, 0x62, 0x06, 0x0a, 0x64, 0x80},
+    {0x44, 0x01, 0xc1, 0x60, 0xc0, 0x60, 0xa6, 0x48},
+    // video/akiyo.turing.qp15.265, qp30, qp50
+    {0x44, 0x01, 0xc1, 0x61, 0x71, 0x82, 0x12},
+    {0x44, 0x01, 0xc1, 0x62, 0x06, 0x08, 0x48},
+    {0x44, 0x01, 0xc1, 0x60, 0xc0, 0x60, 0x84, 0x80},
+    // video/akiyo.x265.*
+    {0x44, 0x01, 0xc1, 0x71, 0xa3, 0x12},
+    // video/iphone_11s.*
+    {0x44, 0x01, 0xc1, 0x72, 0xb4, 0x62, 0x40},
+};
+}  // namespace
+
+class H265ParameterSetWriterTest : public ::testing::Test {
+ public:
+  H265ParameterSetWriterTest() {}
+  ~H265ParameterSetWriterTest() override {}
+};
+
+TEST_F(H265ParameterSetWriterTest, TestWriteSps) {
+  // SPS (media/nvenc.265), with VUI and HRD parameters
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {
+      0x01, 0x01, 0x40, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x00,
+      0x03, 0x00, 0x00, 0x03, 0x00, 0x78, 0xa0, 0x02, 0x80, 0x80, 0x2e,
+      0x1f, 0x13, 0x96, 0xb4, 0xa4, 0x25, 0x92, 0xe3, 0x01, 0x01, 0x00,
+      0x00, 0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00, 0x3c, 0x60, 0x05,
+      0xde, 0x51, 0x00, 0x01, 0x6e, 0x36, 0x00, 0x01, 0xe8, 0x48, 0x10};
+  // fuzzer::conv: begin
+  auto sps = H265SpsParser::ParseSps(buffer, arraysize(buffer));
+  std::vector<uint8_t> nal_unit;
+  if (sps != nullptr) {
+    H265ParameterSetWriter::WriteSps(*sps, H265ParameterSetWriter::Options(),
+                                     &nal_unit);
+  }
+  // fuzzer::conv: end
+
+  ASSERT_TRUE(sps != nullptr);
+  std::vector<uint8_t> expected_nal_unit = {0x42, 0x01};
+  expected_nal_unit.insert(expected_nal_unit.end(), std::begin(buffer),
+                           std::end(buffer));
+  EXPECT_THAT(nal_unit, ::testing::ElementsAreArray(expected_nal_unit));
+}
+
+TEST_F(H265ParameterSetWriterTest, TestRoundTrip) {
+  std::vector<uint8_t> nal_unit;
+  for (const auto& expected : kVpsNalUnits) {
+    auto vps = H265VpsParser::ParseVps(expected.data() + kNalUnitHeaderSize,
+                                       expected.size() - kNalUnitHeaderSize);
+    ASSERT_TRUE(vps != nullptr);
+    EXPECT_TRUE(H265ParameterSetWriter::WriteVps(
+        *vps, H265ParameterSetWriter::Options(), &nal_unit));
+    EXPECT_THAT(nal_unit, ::testing::ElementsAreArray(expected));
+  }
+  for (const auto& expected : kSpsNalUnits) {
+    auto sps = H265SpsParser::ParseSps(expected.data() + kNalUnitHeaderSize,
+                                       expected.size() - kNalUnitHeaderSize);
+    ASSERT_TRUE(sps != nullptr);
+    EXPECT_TRUE(H265ParameterSetWriter::WriteSps(
+        *sps, H265ParameterSetWriter::Options(), &nal_unit));
+    EXPECT_THAT(nal_unit, ::testing::ElementsAreArray(expected));
+  }
+  for (const auto& expected : kPpsNalUnits) {
+    auto pps = H265PpsParser::ParsePps(expected.data() + kNalUnitHeaderSize,
+                                       expected.size() - kNalUnitHeaderSize);
+    ASSERT_TRUE(pps != nullptr);
+    EXPECT_TRUE(H265ParameterSetWriter::WritePps(
+        *pps, H265ParameterSetWriter::Options(), &nal_unit));
+    EXPECT_THAT(nal_unit, ::testing::ElementsAreArray(expected));
+  }
+}
+
+TEST_F(H265ParameterSetWriterTest, TestEditVui) {
+  const auto& original = kSpsNalUnits[1];
+  auto sps = H265SpsParser::ParseSps(original.data() + kNalUnitHeaderSize,
+                                     original.size() - kNalUnitHeaderSize);
+  ASSERT_TRUE(sps != nullptr);
+  ASSERT_TRUE(sps->vui_parameters != nullptr);
+  auto* vui = sps->vui_parameters.get();
+  ASSERT_EQ(1, vui->vui_hrd_parameters_present_flag);
+
+  // set the colour description (BT.2020 PQ), halve the frame rate, and
+  // drop the HRD parameters
+  vui->video_signal_type_present_flag = 1;
+  vui->video_format = 5;
+  vui->colour_description_present_flag = 1;
+  vui->colour_primaries = 9;
+  vui->transfer_characteristics = 16;
+  vui->matrix_coeffs = 9;
+  vui->vui_num_units_in_tick *= 2;
+  vui->vui_hrd_parameters_present_flag = 0;
+  vui->hrd_parameters.reset();
+  std::vector<uint8_t> nal_unit;
+  ASSERT_TRUE(H265ParameterSetWriter::WriteSps(
+      *sps, H265ParameterSetWriter::Options(), &nal_unit));
+  EXPECT_EQ(NalUnitType::SPS_NUT, (nal_unit[0] >> 1) & 0x3f);
+  EXPECT_LT(nal_unit.size(), original.size());
+
+  // the parser reads it back
+  auto edited_sps = H265SpsParser::ParseSps(
+      nal_unit.data() + kNalUnitHeaderSize,
+      nal_unit.size() - kNalUnitHeaderSize);
+  ASSERT_TRUE(edited_sps != nullptr);
+  ASSERT_TRUE(edited_sps->vui_parameters != nullptr);
+  const auto* edited_vui = edited_sps->vui_parameters.get();
+  EXPECT_EQ(1, edited_vui->colour_description_present_flag);
+  EXPECT_EQ(9, edited_vui->colour_primaries);
+  EXPECT_EQ(16, edited_vui->transfer_characteristics);
+  EXPECT_EQ(9, edited_vui->matrix_coeffs);
+  EXPECT_EQ(vui->vui_num_units_in_tick, edited_vui->vui_num_units_in_tick);
+  EXPECT_EQ(vui->vui_time_scale, edited_vui->vui_time_scale);
+  EXPECT_EQ(0, edited_vui->vui_hrd_parameters_present_flag);
+  EXPECT_EQ(sps->pic_width_in_luma_samples,
+            edited_sps->pic_width_in_luma_samples);
+}
+
+TEST_F(H265ParameterSetWriterTest, TestScalingListAndInterRps) {
+  // SPS with inter-predicted short-term RPSs, and multilayer and 3D
+  // extensions
+  const uint8_t buffer[] = {
+      0x01, 0x01, 0x60, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x99, 0xa0, 0x03, 0xc0, 0x80, 0x11, 0x07, 0xf9, 0x65, 0x26, 0x49, 0x1b,
+      0x61, 0xa5, 0x88, 0xaa, 0x93, 0x13, 0x0c, 0xbe, 0xcf, 0xaf, 0x37, 0xe5,
+      0x9f, 0x5e, 0x14, 0x46, 0x27, 0x2e, 0xda, 0xc0, 0xff, 0xff};
+  auto sps = H265SpsParser::ParseSps(buffer, arraysize(buffer));
+  ASSERT_TRUE(sps != nullptr);
+  ASSERT_EQ(1, sps->sps_multilayer_extension_flag);
+  ASSERT_EQ(1, sps->sps_3d_extension_flag);
+
+  // add a scaling list
+  const std::vector<uint8_t> scaling_list_data(120, 0xa5);
+  sps->scaling_list_enabled_flag = 1;
+  sps->sps_scaling_list_data_present_flag = 1;
+  sps->scaling_list_data = H265ScalingListDataParser::ParseScalingListData(
+      scaling_list_data.data(), scaling_list_data.size());
+  ASSERT_TRUE(sps->scaling_list_data != nullptr);
+  std::vector<uint8_t> nal_unit;
+  ASSERT_TRUE(H265ParameterSetWriter::WriteSps(
+      *sps, H265ParameterSetWriter::Options(), &nal_unit));
+
+  // the parser reads it back, and the writer gives back the same NAL unit
+  auto written_sps = H265SpsParser::ParseSps(
+      nal_unit.data() + kNalUnitHeaderSize,
+      nal_unit.size() - kNalUnitHeaderSize);
+  ASSERT_TRUE(written_sps != nullptr);
+  ASSERT_TRUE(written_sps->scaling_list_data != nullptr);
+  EXPECT_EQ(sps->scaling_list_data->ScalingList,
+            written_sps->scaling_list_data->ScalingList);
+  ASSERT_EQ(sps->num_short_term_ref_pic_sets,
+            written_sps->num_short_term_ref_pic_sets);
+  for (uint32_t i = 0; i < sps->num_short_term_ref_pic_sets; i++) {
+    const auto& st_ref_pic_set = sps->st_ref_pic_set[i];
+    const auto& written_st_ref_pic_set = written_sps->st_ref_pic_set[i];
+    EXPECT_EQ(st_ref_pic_set->inter_ref_pic_set_prediction_flag,
+              written_st_ref_pic_set->inter_ref_pic_set_prediction_flag);
+    EXPECT_EQ(st_ref_pic_set->used_by_curr_pic_flag,
+              written_st_ref_pic_set->used_by_curr_pic_flag);
+    EXPECT_EQ(st_ref_pic_set->use_delta_flag,
+              written_st_ref_pic_set->use_delta_flag);
+  }
+  std::vector<uint8_t> rewritten_nal_unit;
+  ASSERT_TRUE(H265ParameterSetWriter::WriteSps(
+      *written_sps, H265ParameterSetWriter::Options(), &rewritten_nal_unit));
+  EXPECT_EQ(nal_unit, rewritten_nal_unit);
+}
+
+TEST_F(H265ParameterSetWriterTest, TestLargePps) {
+  const auto& original = kPpsNalUnits[0];
+  auto pps = H265PpsParser::ParsePps(original.data() + kNalUnitHeaderSize,
+                                     original.size() - kNalUnitHeaderSize);
+  ASSERT_TRUE(pps != nullptr);
+
+  // a PPS larger than the initial RBSP buffer
+  pps->tiles_enabled_flag = 1;
+  pps->num_tile_columns_minus1 = 19;
+  pps->num_tile_rows_minus1 = 21;
+  pps->uniform_spacing_flag = 0;
+  pps->column_width_minus1.assign(19, 1000000000);
+  pps->row_height_minus1.assign(21, 1000000000);
+  std::vector<uint8_t> nal_unit;
+  ASSERT_TRUE(H265ParameterSetWriter::WritePps(
+      *pps, H265ParameterSetWriter::Options(), &nal_unit));
+  EXPECT_LT(256, nal_unit.size());
+
+  auto written_pps = H265PpsParser::ParsePps(
+      nal_unit.data() + kNalUnitHeaderSize,
+      nal_unit.size() - kNalUnitHeaderSize);
+  ASSERT_TRUE(written_pps != nullptr);
+  EXPECT_EQ(pps->column_width_minus1, written_pps->column_width_minus1);
+  EXPECT_EQ(pps->row_height_minus1, written_pps->row_height_minus1);
+}
+
+TEST_F(H265ParameterSetWriterTest, TestWriteFailure) {
+  const auto& original = kPpsNalUnits[0];
+  auto pps = H265PpsParser::ParsePps(original.data() + kNalUnitHeaderSize,
+                                     original.size() - kNalUnitHeaderSize);
+  ASSERT_TRUE(pps != nullptr);
+  std::vector<uint8_t> nal_unit;
+
+  // values that do not fit their syntax element
+  pps->num_extra_slice_header_bits = 8;
+  EXPECT_FALSE(H265ParameterSetWriter::WritePps(
+      *pps, H265ParameterSetWriter::Options(), &nal_unit));
+  pps->num_extra_slice_header_bits = 0;
+
+  // extension data that the parser does not keep
+  pps->pps_extension_present_flag = 1;
+  pps->pps_extension_4bits = 1;
+  EXPECT_FALSE(H265ParameterSetWriter::WritePps(
+      *pps, H265ParameterSetWriter::Options(), &nal_unit));
+  pps->pps_extension_4bits = 0;
+
+  // invalid NAL unit header
+  H265ParameterSetWriter::Options options;
+  options.nuh_temporal_id_plus1 = 0;
+  EXPECT_FALSE(H265ParameterSetWriter::WritePps(*pps, options, &nal_unit));
+
+  // a PPS with an (empty) extension
+  EXPECT_TRUE(H265ParameterSetWriter::WritePps(
+      *pps, H265ParameterSetWriter::Options(), &nal_unit));
+  auto extended_pps = H265PpsParser::ParsePps(
+      nal_unit.data() + kNalUnitHeaderSize,
+      nal_unit.size() - kNalUnitHeaderSize);
+  ASSERT_TRUE(extended_pps != nullptr);
+  EXPECT_EQ(1, extended_pps->pps_extension_present_flag);
+  EXPECT_EQ(pps->init_qp_minus26, extended_pps->init_qp_minus26);
+}
+
+}  // namespace h265nal
@@ -0,0 +1,407 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_parser_context.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdlib.h>
+
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_nal_unit_parser.h"
+#include "h265_pps_parser.h"
+#include "h265_slice_parser.h"
+#include "h265_sps_parser.h"
+#include "h265_vps_parser.h"
+#include "rtc_common.h"
+
+namespace {
+// allocation-counting hook
+bool count_allocations = false;
+size_t num_allocations = 0;
+}  // namespace
+
+void* operator new(size_t size) {
+  if (count_allocations) {
+    num_allocations++;
+  }
+  void* ptr = malloc(size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+namespace h265nal {
+
+class H265ParserContextTest : public ::testing::Test {
+ public:
+  H265ParserContextTest() {}
+  ~H265ParserContextTest() override {}
+};
+
+// VPS, SPS, PPS for a 1280x720 camera capture.
+const uint8_t kParameterSets[] = {
+    // VPS
+    0x00, 0x00, 0x00, 0x01,
+    0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+    0x00, 0x00, 0x03, 0x00, 0xb0, 0x00, 0x00, 0x03,
+    0x00, 0x00, 0x03, 0x00, 0x5d, 0xac, 0x59,
+    // SPS
+    0x00, 0x00, 0x00, 0x01,
+    0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03,
+    0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03,
+    0x00, 0x5d, 0xa0, 0x02, 0x80, 0x80, 0x2e, 0x1f,
+    0x13, 0x96, 0xbb, 0x93, 0x24, 0xbb, 0x95, 0x82,
+    0x83, 0x03, 0x01, 0x76, 0x85, 0x09, 0x40,
+    // PPS
+    0x00, 0x00, 0x00, 0x01,
+    0x44, 0x01, 0xc0, 0xf3, 0xc0, 0x02, 0x10
+};
+
+// P-frame slices (no start code)
+const uint8_t kPSlice0[] = {
+    // slice (P-frame)
+    0x02, 0x01, 0xd0, 0x0f, 0xe4, 0x16, 0x80, 0xf4,
+    0x5a, 0xb4, 0x85, 0x6b, 0x17, 0xaa, 0xc1, 0x94,
+    0xa8, 0x9f, 0x32, 0x11, 0xe4, 0x44, 0xa5, 0xfd,
+    0xe7, 0x80, 0xda, 0xea, 0x21, 0x4c, 0x08, 0x23,
+    0xea, 0x58, 0x15, 0xa3, 0x4c, 0x1a, 0xb3, 0x80,
+    0x9b, 0x63, 0x50, 0x11, 0x75, 0x9a, 0xcc, 0x06,
+    0x09, 0x69, 0x97, 0x75, 0xa0, 0x02, 0x24, 0x22,
+    0x1c, 0x06, 0xa5, 0x69, 0x6e, 0xba, 0x9c, 0x79,
+    0x58, 0x1e, 0x52, 0xa8, 0x26, 0xfe, 0x98, 0x6f,
+    0x65, 0xee, 0x57, 0x10, 0x4f, 0x67, 0xe8, 0x43,
+    0xde, 0x8e, 0xe6, 0x40, 0x28, 0x36, 0x45, 0x06,
+    0x5e, 0xe8, 0x80, 0x34, 0xc0, 0x06, 0xf2, 0x16,
+    0x4b, 0x78, 0x5f, 0x98, 0x56, 0xcc, 0xd9, 0x59,
+    0x7a, 0xf3, 0x30, 0x5d, 0xa9, 0xc7, 0x84, 0x4a,
+    0xe0, 0x16, 0xbf, 0x07, 0x24, 0x32, 0x65, 0xbd,
+    0x39, 0xe2, 0x30, 0xbf, 0x27, 0xd3, 0x61, 0x25,
+    0x02, 0xae, 0x5a, 0xa1, 0x08, 0x9b, 0x90, 0x14,
+    0x2a, 0x09, 0xd1, 0x4a
+};
+
+const uint8_t kPSlice1[] = {
+    // slice (P-frame)
+    0x02, 0x01, 0xd0, 0x17, 0xe4, 0x08, 0x20, 0xfc,
+    0xc1, 0xf5, 0x88, 0x40, 0xcf, 0xf0, 0x00, 0x00,
+    0x03, 0x00, 0x05, 0xe0, 0x46, 0x9d, 0x90, 0xa1,
+    0x98, 0x43, 0x28, 0x48, 0xe9, 0xc6, 0xf3, 0x11,
+    0xeb, 0x29, 0x19, 0xcd, 0x34, 0x85, 0x8b, 0xc5,
+    0x21, 0xf5, 0x5a, 0x46, 0xd7, 0x5a, 0xa5, 0x34,
+    0xa6, 0xad, 0x91, 0xd6, 0x5e, 0x71, 0x18, 0x94,
+    0xe9, 0x44, 0x2a, 0x84, 0x04, 0x2c, 0x80, 0xb0,
+    0xb4, 0x03, 0xf0, 0xa0, 0xe6, 0xe6, 0x14, 0xb3,
+    0xf2, 0xfa, 0x57, 0x5e, 0x29, 0xd1, 0xe1, 0x4d,
+    0x9b, 0x17, 0xea, 0xf8, 0x5c, 0xd5, 0x0a, 0x72,
+    0xe6, 0x5e, 0x42, 0xed, 0xdd, 0xbe, 0x64, 0x38,
+    0x04, 0x5d, 0x84, 0xc7, 0x02, 0xb0, 0x50, 0x21,
+    0x3f, 0x02, 0x89, 0x83
+};
+
+TEST_F(H265ParserContextTest, TestSteadyStateAllocations) {
+  H265BitstreamParserState bitstream_parser_state;
+  ParsingOptions parsing_options;
+  parsing_options.add_checksum = true;
+  H265ParserContext context;
+  auto bitstream = H265BitstreamParser::ParseBitstream(
+      kParameterSets, arraysize(kParameterSets), &bitstream_parser_state,
+      parsing_options, &context);
+  ASSERT_TRUE(bitstream != nullptr);
+  ASSERT_EQ(3, bitstream->nal_units.size());
+
+  const struct {
+    const uint8_t* data;
+    size_t length;
+  } slices[] = {{kPSlice0, arraysize(kPSlice0)},
+                 {kPSlice1, arraysize(kPSlice1)}};
+
+  // without a context, every NAL unit allocates its state
+  num_allocations = 0;
+  count_allocations = true;
+  auto reference = H265NalUnitParser::ParseNalUnit(
+      kPSlice0, arraysize(kPSlice0), &bitstream_parser_state, parsing_options);
+  count_allocations = false;
+  ASSERT_TRUE(reference != nullptr);
+  EXPECT_LT(0, num_allocations);
+
+  // warm up the context
+  for (int i = 0; i < 2; i++) {
+    for (const auto& slice : slices) {
+      auto nal_unit = H265NalUnitParser::ParseNalUnit(
+          slice.data, slice.length, &bitstream_parser_state, parsing_options,
+          &context);
+      ASSERT_TRUE(nal_unit != nullptr);
+      context.Recycle(std::move(nal_unit));
+    }
+  }
+
+  // steady state: no heap allocations per NAL unit
+  for (int i = 0; i < 10; i++) {
+    for (const auto& slice : slices) {
+      num_allocations = 0;
+      count_allocations = true;
+      auto nal_unit = H265NalUnitParser::ParseNalUnit(
+          slice.data, slice.length, &bitstream_parser_state, parsing_options,
+          &context);
+      count_allocations = false;
+      ASSERT_TRUE(nal_unit != nullptr);
+      EXPECT_EQ(0, num_allocations);
+
+      count_allocations = true;
+      context.Recycle(std::move(nal_unit));
+      count_allocations = false;
+      EXPECT_EQ(0, num_allocations);
+    }
+  }
+}
+
+namespace {
+// Write a TRAIL_R slice segment (P or B) for the mock parameter sets in
+// TestSteadyStateInterSlices, with an explicit short-term reference picture
+// set, a long-term reference picture, a pred_weight_table (P slices) and
+// entry points.
+std::vector<uint8_t> WriteInterSlice(uint32_t slice_type, uint32_t poc,
+                                     uint32_t num_entry_point_offsets) {
+  uint8_t rbsp[64] = {};
+  BitBufferWriter writer(rbsp, sizeof(rbsp));
+  // first_slice_segment_in_pic_flag
+  writer.WriteBits(1, 1);
+  // slice_pic_parameter_set_id
+  writer.WriteExponentialGolomb(0);
+  writer.WriteExponentialGolomb(slice_type);
+  // slice_pic_order_cnt_lsb
+  writer.WriteBits(poc, 4);
+  // short_term_ref_pic_set_sps_flag
+  writer.WriteBits(0, 1);
+  // st_ref_pic_set(0): 2 negative and 1 positive pictures
+  writer.WriteExponentialGolomb(2);
+  writer.WriteExponentialGolomb(1);
+  for (uint32_t i = 0; i < 3; i++) {
+    // delta_poc_sX_minus1, used_by_curr_pic_sX_flag
+    writer.WriteExponentialGolomb(i);
+    writer.WriteBits(1, 1);
+  }
+  // num_long_term_pics
+  writer.WriteExponentialGolomb(1);
+  // poc_lsb_lt, used_by_curr_pic_lt_flag, delta_poc_msb_present_flag,
+  // delta_poc_msb_cycle_lt
+  writer.WriteBits(poc ^ 0x08, 4);
+  writer.WriteBits(0, 1);
+  writer.WriteBits(1, 1);
+  writer.WriteExponentialGolomb(1);
+  // slice_sao_luma_flag, slice_sao_chroma_flag
+  writer.WriteBits(0, 2);
+  // num_ref_idx_active_override_flag, num_ref_idx_lX_active_minus1
+  writer.WriteBits(1, 1);
+  writer.WriteExponentialGolomb(1);
+  if (slice_type == SliceType_B) {
+    writer.WriteExponentialGolomb(1);
+    // mvd_l1_zero_flag
+    writer.WriteBits(0, 1);
+  } else {
+    // pred_weight_table(): luma_log2_weight_denom,
+    // delta_chroma_log2_weight_denom
+    writer.WriteExponentialGolomb(6);
+    writer.WriteSignedExponentialGolomb(-1);
+    // luma_weight_l0_flag[], chroma_weight_l0_flag[]
+    writer.WriteBits(0x0f, 4);
+    for (int32_t i = 0; i < 2; i++) {
+      // delta_luma_weight_l0, luma_offset_l0
+      writer.WriteSignedExponentialGolomb(i + 1);
+      writer.WriteSignedExponentialGolomb(-i);
+      for (int32_t j = 0; j < 2; j++) {
+        // delta_chroma_weight_l0, delta_chroma_offset_l0
+        writer.WriteSignedExponentialGolomb(j);
+        writer.WriteSignedExponentialGolomb(-j);
+      }
+    }
+  }
+  // five_minus_max_num_merge_cand
+  writer.WriteExponentialGolomb(0);
+  // slice_qp_delta
+  writer.WriteSignedExponentialGolomb(-2);
+  // num_entry_point_offsets, offset_len_minus1, entry_point_offset_minus1[]
+  writer.WriteExponentialGolomb(num_entry_point_offsets);
+  if (num_entry_point_offsets > 0) {
+    writer.WriteExponentialGolomb(3);
+    for (uint32_t i = 0; i < num_entry_point_offsets; i++) {
+      writer.WriteBits(i, 4);
+    }
+  }
+  // byte_alignment(), and some slice_segment_data()
+  writer.WriteBits(1, 1);
+  size_t byte_offset = 0;
+  size_t bit_offset = 0;
+  writer.GetCurrentOffset(&byte_offset, &bit_offset);
+  size_t rbsp_length = byte_offset + (bit_offset > 0 ? 1 : 0) + 8;
+  for (size_t i = rbsp_length - 8; i < rbsp_length; i++) {
+    rbsp[i] = 0xa5;
+  }
+  std::vector<uint8_t> nal_unit = {0x02, 0x01};
+  EscapeRbsp(rbsp, rbsp_length, &nal_unit);
+  return nal_unit;
+}
+}  // namespace
+
+TEST_F(H265ParserContextTest, TestSteadyStateInterSlices) {
+  // mock parameter sets: 64x64 (8 rows of 8x8 CTBs), long-term reference
+  // pictures, SAO, weighted (uni)prediction, and WPP
+  H265BitstreamParserState bitstream_parser_state;
+  bitstream_parser_state.vps[0] = std::make_shared<H265VpsParser::VpsState>();
+  auto sps = std::make_shared<H265SpsParser::SpsState>();
+  sps->chroma_format_idc = 1;
+  sps->pic_width_in_luma_samples = 64;
+  sps->pic_height_in_luma_samples = 64;
+  sps->long_term_ref_pics_present_flag = 1;
+  sps->sample_adaptive_offset_enabled_flag = 1;
+  bitstream_parser_state.sps[0] = sps;
+  auto pps = std::make_shared<H265PpsParser::PpsState>();
+  pps->weighted_pred_flag = 1;
+  pps->entropy_coding_sync_enabled_flag = 1;
+  bitstream_parser_state.pps[0] = pps;
+  ParsingOptions parsing_options;
+  parsing_options.add_checksum = true;
+
+  // slices with a varying number of entry points
+  const std::vector<std::vector<uint8_t>> slices = {
+      WriteInterSlice(SliceType_P, 1, 7), WriteInterSlice(SliceType_B, 2, 3),
+      WriteInterSlice(SliceType_P, 3, 0), WriteInterSlice(SliceType_B, 4, 5)};
+
+  // check the slices parse as written
+  auto reference = H265NalUnitParser::ParseNalUnit(
+      slices[0].data(), slices[0].size(), &bitstream_parser_state,
+      parsing_options);
+  ASSERT_TRUE(reference != nullptr);
+  ASSERT_TRUE(reference->nal_unit_payload->slice_segment_layer != nullptr);
+  const auto& header =
+      reference->nal_unit_payload->slice_segment_layer->slice_segment_header;
+  ASSERT_TRUE(header != nullptr);
+  ASSERT_TRUE(header->st_ref_pic_set != nullptr);
+  EXPECT_EQ(2, header->st_ref_pic_set->num_negative_pics);
+  EXPECT_EQ(1, header->st_ref_pic_set->num_positive_pics);
+  EXPECT_THAT(header->poc_lsb_lt, ::testing::ElementsAreArray({9}));
+  ASSERT_TRUE(header->pred_weight_table != nullptr);
+  EXPECT_EQ(2, header->pred_weight_table->delta_chroma_weight_l0.size());
+  EXPECT_EQ(-2, header->slice_qp_delta);
+  EXPECT_EQ(7, header->num_entry_point_offsets);
+
+  // warm up the context
+  H265ParserContext context;
+  for (int i = 0; i < 2; i++) {
+    for (const auto& slice : slices) {
+      auto nal_unit = H265NalUnitParser::ParseNalUnit(
+          slice.data(), slice.size(), &bitstream_parser_state,
+          parsing_options, &context);
+      ASSERT_TRUE(nal_unit != nullptr);
+      context.Recycle(std::move(nal_unit));
+    }
+  }
+
+  // steady state: no heap allocations per NAL unit
+  for (int i = 0; i < 10; i++) {
+    for (const auto& slice : slices) {
+      num_allocations = 0;
+      count_allocations = true;
+      auto nal_unit = H265NalUnitParser::ParseNalUnit(
+          slice.data(), slice.size(), &bitstream_parser_state,
+          parsing_options, &context);
+      count_allocations = false;
+      ASSERT_TRUE(nal_unit != nullptr);
+      EXPECT_EQ(0, num_allocations);
+
+      // recycled states are cleared
+      const auto& slice_segment_header =
+          nal_unit->nal_unit_payload->slice_segment_layer
+              ->slice_segment_header;
+      EXPECT_EQ(1, slice_segment_header->lt_idx_sps.size() +
+                       slice_segment_header->poc_lsb_lt.size());
+      EXPECT_EQ(slice_segment_header->num_entry_point_offsets,
+                slice_segment_header->entry_point_offset_minus1.size());
+      EXPECT_EQ(2, slice_segment_header->st_ref_pic_set
+                       ->used_by_curr_pic_s0_flag.size());
+      if (slice_segment_header->slice_type == SliceType_P) {
+        EXPECT_EQ(2, slice_segment_header->pred_weight_table
+                         ->delta_chroma_offset_l0.size());
+        EXPECT_EQ(2, slice_segment_header->pred_weight_table
+                         ->delta_chroma_offset_l0[1].size());
+      } else {
+        EXPECT_TRUE(slice_segment_header->pred_weight_table == nullptr);
+      }
+
+      count_allocations = true;
+      context.Recycle(std::move(nal_unit));
+      count_allocations = false;
+      EXPECT_EQ(0, num_allocations);
+    }
+  }
+
+  // length-prefixed version
+  std::vector<uint8_t> buffer;
+  for (const auto& slice : slices) {
+    buffer.insert(buffer.end(), {0x00, 0x00, 0x00,
+                                 static_cast<uint8_t>(slice.size())});
+    buffer.insert(buffer.end(), slice.begin(), slice.end());
+  }
+  auto bitstream = H265BitstreamParser::ParseBitstreamNALULength(
+      buffer.data(), buffer.size(), 4, &bitstream_parser_state,
+      parsing_options, &context);
+  ASSERT_TRUE(bitstream != nullptr);
+  ASSERT_EQ(4, bitstream->nal_units.size());
+  for (auto& nal_unit : bitstream->nal_units) {
+    ASSERT_TRUE(nal_unit->nal_unit_payload->slice_segment_layer != nullptr);
+    context.Recycle(std::move(nal_unit));
+  }
+}
+
+TEST_F(H265ParserContextTest, TestRecycledState) {
+  H265BitstreamParserState bitstream_parser_state;
+  ParsingOptions parsing_options;
+  parsing_options.add_checksum = true;
+  auto bitstream = H265BitstreamParser::ParseBitstream(
+      kParameterSets, arraysize(kParameterSets), &bitstream_parser_state,
+      parsing_options);
+  ASSERT_TRUE(bitstream != nullptr);
+
+  // parsing with a context produces the same state as without
+  H265ParserContext context;
+  auto expected = H265NalUnitParser::ParseNalUnit(
+      kPSlice1, arraysize(kPSlice1), &bitstream_parser_state, parsing_options);
+  ASSERT_TRUE(expected != nullptr);
+  for (int i = 0; i < 3; i++) {
+    context.Recycle(H265NalUnitParser::ParseNalUnit(
+        kPSlice0, arraysize(kPSlice0), &bitstream_parser_state,
+        parsing_options, &context));
+    auto nal_unit = H265NalUnitParser::ParseNalUnit(
+        kPSlice1, arraysize(kPSlice1), &bitstream_parser_state,
+        parsing_options, &context);
+    ASSERT_TRUE(nal_unit != nullptr);
+    EXPECT_EQ(expected->parsed_length, nal_unit->parsed_length);
+    EXPECT_EQ(expected->checksum->GetPrintableChecksum(),
+              nal_unit->checksum->GetPrintableChecksum());
+    EXPECT_EQ(expected->nal_unit_header->nal_unit_type,
+              nal_unit->nal_unit_header->nal_unit_type);
+    const auto& expected_header =
+        expected->nal_unit_payload->slice_segment_layer->slice_segment_header;
+    const auto& header =
+        nal_unit->nal_unit_payload->slice_segment_layer->slice_segment_header;
+    EXPECT_EQ(expected_header->slice_type, header->slice_type);
+    EXPECT_EQ(expected_header->slice_pic_order_cnt_lsb,
+              header->slice_pic_order_cnt_lsb);
+    EXPECT_EQ(expected_header->slice_qp_delta, header->slice_qp_delta);
+    context.Recycle(std::move(nal_unit));
+  }
+}
+
+}  // namespace h265nal
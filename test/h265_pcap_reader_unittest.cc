@@ -0,0 +1,350 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_pcap_reader.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_rtp_parser.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+namespace {
+void StorePacket(const H265PcapReader::Packet& packet, void* opaque) {
+  auto* packets = static_cast<std::vector<H265PcapReader::Packet>*>(opaque);
+  packets->push_back(packet);
+}
+
+void PutU16(std::vector<uint8_t>* buffer, uint32_t value) {
+  buffer->push_back(static_cast<uint8_t>(value >> 8));
+  buffer->push_back(static_cast<uint8_t>(value));
+}
+
+void PutU32(std::vector<uint8_t>* buffer, uint32_t value) {
+  PutU16(buffer, value >> 16);
+  PutU16(buffer, value & 0xffff);
+}
+
+// RTP packet with an AUD NAL unit
+std::vector<uint8_t> MakeRtp(uint16_t sequence_number, uint32_t ssrc,
+                             uint32_t payload_type) {
+  std::vector<uint8_t> rtp = {0x80, static_cast<uint8_t>(payload_type)};
+  PutU16(&rtp, sequence_number);
+  PutU32(&rtp, 3000u * sequence_number);
+  PutU32(&rtp, ssrc);
+  rtp.insert(rtp.end(), {0x46, 0x01, 0x50});
+  return rtp;
+}
+
+std::vector<uint8_t> MakeUdp(uint16_t src_port, uint16_t dst_port,
+                             const std::vector<uint8_t>& payload) {
+  std::vector<uint8_t> udp;
+  PutU16(&udp, src_port);
+  PutU16(&udp, dst_port);
+  PutU16(&udp, static_cast<uint32_t>(8 + payload.size()));
+  PutU16(&udp, 0);
+  udp.insert(udp.end(), payload.begin(), payload.end());
+  return udp;
+}
+
+std::vector<uint8_t> MakeIpv4(uint8_t protocol,
+                              const std::vector<uint8_t>& payload) {
+  std::vector<uint8_t> ip = {0x45, 0x00};
+  PutU16(&ip, static_cast<uint32_t>(20 + payload.size()));
+  ip.insert(ip.end(), {0x00, 0x00, 0x40, 0x00, 0x40, protocol, 0x00, 0x00,
+                       0xc0, 0xa8, 0x00, 0x01, 0xc0, 0xa8, 0x00, 0x02});
+  ip.insert(ip.end(), payload.begin(), payload.end());
+  return ip;
+}
+
+// IPv6 packet with a hop-by-hop options extension header
+std::vector<uint8_t> MakeIpv6(const std::vector<uint8_t>& payload) {
+  std::vector<uint8_t> ip = {0x60, 0x00, 0x00, 0x00};
+  PutU16(&ip, static_cast<uint32_t>(8 + payload.size()));
+  // next header (hop-by-hop), hop limit
+  ip.insert(ip.end(), {0x00, 0x40});
+  ip.insert(ip.end(), 32, 0x00);
+  // hop-by-hop: next header (UDP), length, padding
+  ip.insert(ip.end(), {17, 0x00, 0x01, 0x04, 0x00, 0x00, 0x00, 0x00});
+  ip.insert(ip.end(), payload.begin(), payload.end());
+  return ip;
+}
+
+std::vector<uint8_t> MakeEthernet(uint16_t ether_type,
+                                  const std::vector<uint8_t>& payload,
+                                  bool vlan) {
+  std::vector<uint8_t> frame = {0x02, 0x00, 0x00, 0x00, 0x00, 0x02,
+                                0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+  if (vlan) {
+    PutU16(&frame, 0x8100);
+    PutU16(&frame, 42);
+  }
+  PutU16(&frame, ether_type);
+  frame.insert(frame.end(), payload.begin(), payload.end());
+  return frame;
+}
+
+// Classic (big-endian, microsecond) pcap file with Ethernet frames.
+std::vector<uint8_t> MakePcap(const std::vector<std::vector<uint8_t>>& frames) {
+  std::vector<uint8_t> pcap;
+  PutU32(&pcap, 0xa1b2c3d4);
+  PutU16(&pcap, 2);
+  PutU16(&pcap, 4);
+  PutU32(&pcap, 0);
+  PutU32(&pcap, 0);
+  PutU32(&pcap, 65535);
+  PutU32(&pcap, 1);
+  for (size_t i = 0; i < frames.size(); i++) {
+    PutU32(&pcap, 10);
+    PutU32(&pcap, static_cast<uint32_t>(i));
+    PutU32(&pcap, static_cast<uint32_t>(frames[i].size()));
+    PutU32(&pcap, static_cast<uint32_t>(frames[i].size()));
+    pcap.insert(pcap.end(), frames[i].begin(), frames[i].end());
+  }
+  return pcap;
+}
+}  // namespace
+
+class H265PcapReaderTest : public ::testing::Test {
+ public:
+  H265PcapReaderTest() {}
+  ~H265PcapReaderTest() override {}
+};
+
+TEST_F(H265PcapReaderTest, TestPcap) {
+  // little-endian pcap file with one Ethernet/IPv4/UDP frame, carrying an
+  // RTP packet with an AUD NAL unit
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {
+      // pcap header (linktype: ethernet)
+      0xd4, 0xc3, 0xb2, 0xa1, 0x02, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+      // record header (1.5 seconds, 57 bytes)
+      0x01, 0x00, 0x00, 0x00, 0x20, 0xa1, 0x07, 0x00, 0x39, 0x00, 0x00, 0x00,
+      0x39, 0x00, 0x00, 0x00,
+      // ethernet
+      0x02, 0x00, 0x00, 0x00, 0x00, 0x02, 0x02, 0x00, 0x00, 0x00, 0x00, 0x01,
+      0x08, 0x00,
+      // ipv4
+      0x45, 0x00, 0x00, 0x2b, 0x00, 0x00, 0x40, 0x00, 0x40, 0x11, 0x00, 0x00,
+      0xc0, 0xa8, 0x00, 0x01, 0xc0, 0xa8, 0x00, 0x02,
+      // udp (5004 -> 6000)
+      0x13, 0x8c, 0x17, 0x70, 0x00, 0x17, 0x00, 0x00,
+      // rtp
+      0x80, 0x60, 0x00, 0x01, 0x00, 0x00, 0x00, 0x0a, 0x12, 0x34, 0x56, 0x78,
+      0x46, 0x01, 0x50};
+  // fuzzer::conv: begin
+  std::vector<H265PcapReader::Packet> packets;
+  H265PcapReader pcap_reader({});
+  pcap_reader.OpenBuffer(buffer, arraysize(buffer));
+  pcap_reader.ReadPackets(
+      [](const H265PcapReader::Packet& packet, void* opaque) {
+        using Packets = std::vector<H265PcapReader::Packet>;
+        static_cast<Packets*>(opaque)->push_back(packet);
+      },
+      &packets);
+  // fuzzer::conv: end
+
+  ASSERT_EQ(1, packets.size());
+  const auto& packet = packets[0];
+  EXPECT_EQ(1500000000, packet.timestamp_ns);
+  EXPECT_EQ(5004, packet.src_port);
+  EXPECT_EQ(6000, packet.dst_port);
+  EXPECT_EQ(1, packet.rtp_header.sequence_number);
+  EXPECT_EQ(10, packet.rtp_header.timestamp);
+  EXPECT_EQ(0x12345678, packet.rtp_header.ssrc);
+  EXPECT_EQ(96, packet.rtp_header.payload_type);
+  EXPECT_EQ(15, packet.length);
+  EXPECT_EQ(buffer + 82, packet.data);
+  ASSERT_EQ(3, packet.payload_length);
+  EXPECT_EQ(buffer + 94, packet.payload);
+
+  // the payload goes directly into the RTP parser
+  H265BitstreamParserState bitstream_parser_state;
+  auto rtp = H265RtpParser::ParseRtp(packet.payload, packet.payload_length,
+                                     &bitstream_parser_state);
+  ASSERT_TRUE(rtp != nullptr);
+  ASSERT_TRUE(rtp->rtp_single != nullptr);
+  EXPECT_EQ(NalUnitType::AUD_NUT, rtp->nal_unit_header->nal_unit_type);
+
+  const auto& stats = pcap_reader.GetStats();
+  EXPECT_EQ(1, stats.records);
+  EXPECT_EQ(0, stats.records_skipped);
+  EXPECT_EQ(1, stats.rtp_packets);
+}
+
+TEST_F(H265PcapReaderTest, TestPcapng) {
+  // big-endian pcapng file with a nanosecond-resolution interface, and a
+  // VLAN-tagged Ethernet/IPv6/UDP frame
+  std::vector<uint8_t> frame = MakeEthernet(
+      0x86dd, MakeIpv6(MakeUdp(5004, 6000, MakeRtp(7, 0x1234, 96))), true);
+  std::vector<uint8_t> pcapng;
+  // section header block
+  PutU32(&pcapng, 0x0a0d0d0a);
+  PutU32(&pcapng, 28);
+  PutU32(&pcapng, 0x1a2b3c4d);
+  PutU16(&pcapng, 1);
+  PutU16(&pcapng, 0);
+  PutU32(&pcapng, 0xffffffff);
+  PutU32(&pcapng, 0xffffffff);
+  PutU32(&pcapng, 28);
+  // interface description block (if_tsresol: 10^-9)
+  PutU32(&pcapng, 1);
+  PutU32(&pcapng, 32);
+  PutU16(&pcapng, 1);
+  PutU16(&pcapng, 0);
+  PutU32(&pcapng, 65535);
+  PutU16(&pcapng, 9);
+  PutU16(&pcapng, 1);
+  PutU32(&pcapng, 0x09000000);
+  PutU32(&pcapng, 0);
+  PutU32(&pcapng, 32);
+  // enhanced packet block
+  size_t padding = (4 - frame.size() % 4) % 4;
+  uint32_t block_length = static_cast<uint32_t>(32 + frame.size() + padding);
+  PutU32(&pcapng, 6);
+  PutU32(&pcapng, block_length);
+  PutU32(&pcapng, 0);
+  // 2.000000123 seconds
+  PutU32(&pcapng, 0);
+  PutU32(&pcapng, 2000000123);
+  PutU32(&pcapng, static_cast<uint32_t>(frame.size()));
+  PutU32(&pcapng, static_cast<uint32_t>(frame.size()));
+  pcapng.insert(pcapng.end(), frame.begin(), frame.end());
+  pcapng.insert(pcapng.end(), padding, 0x00);
+  PutU32(&pcapng, block_length);
+
+  std::vector<H265PcapReader::Packet> packets;
+  H265PcapReader pcap_reader({});
+  ASSERT_TRUE(pcap_reader.OpenBuffer(pcapng.data(), pcapng.size()));
+  EXPECT_TRUE(pcap_reader.ReadPackets(StorePacket, &packets));
+  ASSERT_EQ(1, packets.size());
+  EXPECT_EQ(2000000123, packets[0].timestamp_ns);
+  EXPECT_EQ(5004, packets[0].src_port);
+  EXPECT_EQ(7, packets[0].rtp_header.sequence_number);
+  EXPECT_EQ(0x1234, packets[0].rtp_header.ssrc);
+  EXPECT_EQ(3, packets[0].payload_length);
+  EXPECT_EQ(0x46, packets[0].payload[0]);
+}
+
+TEST_F(H265PcapReaderTest, TestFilters) {
+  // RTCP receiver report
+  std::vector<uint8_t> rtcp = {0x80, 0xc9, 0x00, 0x01,
+                               0x00, 0x00, 0x12, 0x34};
+  std::vector<uint8_t> pcap = MakePcap({
+      MakeEthernet(0x0800, MakeIpv4(17, MakeUdp(5004, 6000, MakeRtp(1, 1, 96))),
+                   false),
+      MakeEthernet(0x0800, MakeIpv4(17, MakeUdp(5006, 6002, MakeRtp(2, 2, 96))),
+                   false),
+      MakeEthernet(0x0800, MakeIpv4(17, MakeUdp(5004, 6000, MakeRtp(3, 1, 97))),
+                   false),
+      MakeEthernet(0x0800, MakeIpv4(17, MakeUdp(5005, 6001, rtcp)), false),
+      // TCP
+      MakeEthernet(0x0800, MakeIpv4(6, std::vector<uint8_t>(20, 0)), false),
+      // ARP
+      MakeEthernet(0x0806, std::vector<uint8_t>(28, 0), false),
+  });
+
+  {
+    // no filter
+    std::vector<H265PcapReader::Packet> packets;
+    H265PcapReader pcap_reader({});
+    ASSERT_TRUE(pcap_reader.OpenBuffer(pcap.data(), pcap.size()));
+    EXPECT_TRUE(pcap_reader.ReadPackets(StorePacket, &packets));
+    ASSERT_EQ(3, packets.size());
+    EXPECT_EQ(1, packets[0].rtp_header.sequence_number);
+    EXPECT_EQ(2, packets[1].rtp_header.sequence_number);
+    EXPECT_EQ(3, packets[2].rtp_header.sequence_number);
+    // record timestamps are 10 seconds plus i microseconds
+    EXPECT_EQ(10000002000, packets[2].timestamp_ns);
+    const auto& stats = pcap_reader.GetStats();
+    EXPECT_EQ(6, stats.records);
+    EXPECT_EQ(2, stats.records_skipped);
+    EXPECT_EQ(1, stats.udp_not_rtp);
+    EXPECT_EQ(0, stats.rtp_filtered);
+    EXPECT_EQ(3, stats.rtp_packets);
+  }
+
+  {
+    // port filter (source or destination)
+    H265PcapReader::Options options;
+    options.port = 6002;
+    std::vector<H265PcapReader::Packet> packets;
+    H265PcapReader pcap_reader(options);
+    ASSERT_TRUE(pcap_reader.OpenBuffer(pcap.data(), pcap.size()));
+    EXPECT_TRUE(pcap_reader.ReadPackets(StorePacket, &packets));
+    ASSERT_EQ(1, packets.size());
+    EXPECT_EQ(2, packets[0].rtp_header.sequence_number);
+  }
+
+  {
+    // SSRC and payload type filters
+    H265PcapReader::Options options;
+    options.filter_ssrc = true;
+    options.ssrc = 1;
+    options.filter_payload_type = true;
+    options.payload_type = 96;
+    std::vector<H265PcapReader::Packet> packets;
+    H265PcapReader pcap_reader(options);
+    ASSERT_TRUE(pcap_reader.OpenBuffer(pcap.data(), pcap.size()));
+    EXPECT_TRUE(pcap_reader.ReadPackets(StorePacket, &packets));
+    ASSERT_EQ(1, packets.size());
+    EXPECT_EQ(1, packets[0].rtp_header.sequence_number);
+    EXPECT_EQ(2, pcap_reader.GetStats().rtp_filtered);
+  }
+}
+
+TEST_F(H265PcapReaderTest, TestTruncated) {
+  std::vector<uint8_t> frame =
+      MakeEthernet(0x0800, MakeIpv4(17, MakeUdp(5004, 6000, MakeRtp(1, 1, 96))),
+                   false);
+  std::vector<uint8_t> pcap = MakePcap({frame, frame});
+  // the last record is cut short: it is ignored
+  pcap.resize(pcap.size() - 4);
+  std::vector<H265PcapReader::Packet> packets;
+  H265PcapReader pcap_reader({});
+  ASSERT_TRUE(pcap_reader.OpenBuffer(pcap.data(), pcap.size()));
+  EXPECT_TRUE(pcap_reader.ReadPackets(StorePacket, &packets));
+  EXPECT_EQ(1, packets.size());
+
+  // not a capture file
+  const uint8_t buffer[] = {0x00, 0x00, 0x00, 0x01, 0x46, 0x01, 0x50, 0x00,
+                            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+  H265PcapReader other_reader({});
+  ASSERT_TRUE(other_reader.OpenBuffer(buffer, arraysize(buffer)));
+  EXPECT_FALSE(other_reader.ReadPackets(StorePacket, &packets));
+}
+
+TEST_F(H265PcapReaderTest, TestOpen) {
+  std::vector<uint8_t> pcap = MakePcap({MakeEthernet(
+      0x0800, MakeIpv4(17, MakeUdp(5004, 6000, MakeRtp(1, 1, 96))), false)});
+  std::string filename = ::testing::TempDir() + "h265_pcap_reader_test.pcap";
+  FILE* fp = fopen(filename.c_str(), "wb");
+  ASSERT_TRUE(fp != nullptr);
+  ASSERT_EQ(pcap.size(), fwrite(pcap.data(), 1, pcap.size(), fp));
+  fclose(fp);
+
+  std::vector<H265PcapReader::Packet> packets;
+  H265PcapReader pcap_reader({});
+  ASSERT_TRUE(pcap_reader.Open(filename.c_str()));
+  EXPECT_TRUE(pcap_reader.ReadPackets(StorePacket, &packets));
+  ASSERT_EQ(1, packets.size());
+  EXPECT_EQ(0x46, packets[0].payload[0]);
+  pcap_reader.Close();
+  remove(filename.c_str());
+
+  EXPECT_FALSE(pcap_reader.Open(filename.c_str()));
+}
+
+}  // namespace h265nal
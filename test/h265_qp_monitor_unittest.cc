@@ -0,0 +1,186 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_qp_monitor.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_nal_unit_parser.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+namespace {
+struct CallbackData {
+  std::vector<H265QpMonitor::FrameQp> frames;
+  std::vector<H265QpMonitor::WindowQp> windows;
+};
+
+void StoreFrame(const H265QpMonitor::FrameQp& frame,
+                const H265QpMonitor::WindowQp& window, void* opaque) {
+  auto* data = static_cast<CallbackData*>(opaque);
+  data->frames.push_back(frame);
+  data->windows.push_back(window);
+}
+
+// VPS, SPS, PPS, and an IDR slice (QP 35) for a 1280x720 camera capture.
+const uint8_t buffer[] = {
+    0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+    0x00, 0x00, 0x03, 0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+    0x5d, 0xac, 0x59, 0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01, 0x60,
+    0x00, 0x00, 0x03, 0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+    0x5d, 0xa0, 0x02, 0x80, 0x80, 0x2e, 0x1f, 0x13, 0x96, 0xbb, 0x93, 0x24,
+    0xbb, 0x95, 0x82, 0x83, 0x03, 0x01, 0x76, 0x85, 0x09, 0x40, 0x00, 0x00,
+    0x00, 0x01, 0x44, 0x01, 0xc0, 0xf3, 0xc0, 0x02, 0x10, 0x00, 0x00, 0x00,
+    0x01, 0x26, 0x01, 0xaf, 0x09, 0x40, 0xf3, 0xb8, 0xd5, 0x39, 0xba, 0x1f,
+    0xe4, 0xa6, 0x08, 0x5c, 0x6e, 0xb1, 0x8f, 0x00, 0x38, 0xf1, 0xa6, 0xfc,
+    0xf1, 0x40, 0x04, 0x3a, 0x86, 0xcb, 0x90, 0x74, 0xce, 0xf0, 0x46, 0x61,
+    0x93, 0x72, 0xd6, 0xfc, 0x35, 0xe3, 0xc5, 0x6f, 0x0a, 0xc4, 0x9e, 0x27,
+    0xc4, 0xdb, 0xe3, 0xfb, 0x38, 0x98, 0xd0, 0x8b, 0xd5, 0xb9, 0xb9, 0x15,
+    0xb4, 0x92, 0x49, 0x97, 0xe5, 0x3d, 0x36, 0x4d, 0x45, 0x32, 0x5c, 0xe6,
+    0x89, 0x53, 0x76, 0xce, 0xbb, 0x83, 0xa1, 0x27, 0x35, 0xfb, 0xf3, 0xc7,
+    0xd4, 0x85, 0x32, 0x37, 0x94, 0x09, 0xec, 0x10};
+}  // namespace
+
+class H265QpMonitorTest : public ::testing::Test {
+ public:
+  H265QpMonitorTest() {}
+  ~H265QpMonitorTest() override {}
+
+  void SetUp() override {
+    bitstream_parser_state.pps[0] = std::make_shared<H265PpsParser::PpsState>();
+  }
+
+  // Make a slice segment with the given QP (init_qp_minus26 is 0).
+  std::unique_ptr<H265NalUnitParser::NalUnitState> MakeSlice(
+      int32_t slice_qp_y, bool first_slice_segment_in_pic_flag,
+      bool dependent_slice_segment_flag = false) {
+    auto nal_unit = std::make_unique<H265NalUnitParser::NalUnitState>();
+    nal_unit->nal_unit_header =
+        std::make_unique<H265NalUnitHeaderParser::NalUnitHeaderState>();
+    nal_unit->nal_unit_header->nal_unit_type = NalUnitType::TRAIL_R;
+    nal_unit->nal_unit_header->nuh_temporal_id_plus1 = 1;
+    nal_unit->nal_unit_payload =
+        std::make_unique<H265NalUnitPayloadParser::NalUnitPayloadState>();
+    auto& slice_segment_layer =
+        nal_unit->nal_unit_payload->slice_segment_layer;
+    slice_segment_layer = std::make_unique<
+        H265SliceSegmentLayerParser::SliceSegmentLayerState>();
+    slice_segment_layer->slice_segment_header = std::make_unique<
+        H265SliceSegmentHeaderParser::SliceSegmentHeaderState>();
+    auto& slice_segment_header = slice_segment_layer->slice_segment_header;
+    slice_segment_header->first_slice_segment_in_pic_flag =
+        first_slice_segment_in_pic_flag;
+    slice_segment_header->dependent_slice_segment_flag =
+        dependent_slice_segment_flag;
+    slice_segment_header->slice_qp_delta = slice_qp_y - 26;
+    return nal_unit;
+  }
+
+  H265BitstreamParserState bitstream_parser_state;
+  CallbackData data;
+};
+
+TEST_F(H265QpMonitorTest, TestFrameAndWindow) {
+  H265QpMonitor::Options options;
+  options.window_size = 2;
+  H265QpMonitor monitor(options, StoreFrame, &data);
+
+  // frame 1: 3 slice segments (the last one is a dependent one)
+  monitor.AddNalUnit(*MakeSlice(30, true), 100, &bitstream_parser_state);
+  monitor.AddNalUnit(*MakeSlice(40, false), 300, &bitstream_parser_state);
+  monitor.AddNalUnit(*MakeSlice(0, false, true), 100,
+                     &bitstream_parser_state);
+  EXPECT_EQ(0, data.frames.size());
+  // an AUD starts the next access unit
+  H265NalUnitParser::NalUnitState aud;
+  aud.nal_unit_header =
+      std::make_unique<H265NalUnitHeaderParser::NalUnitHeaderState>();
+  aud.nal_unit_header->nal_unit_type = NalUnitType::AUD_NUT;
+  monitor.AddNalUnit(aud, 3, &bitstream_parser_state);
+  ASSERT_EQ(1, data.frames.size());
+  EXPECT_EQ(3, data.frames[0].num_slices);
+  EXPECT_EQ(500, data.frames[0].bytes);
+  EXPECT_EQ(30, data.frames[0].min_qp);
+  EXPECT_EQ(40, data.frames[0].max_qp);
+  // (30 * 100 + 40 * 300 + 40 * 100) / 500
+  EXPECT_DOUBLE_EQ(38.0, data.frames[0].avg_qp);
+  EXPECT_EQ(1, data.windows[0].num_frames);
+
+  // frames 2 and 3 (a new picture ends the previous one)
+  monitor.AddNalUnit(*MakeSlice(20, true), 100, &bitstream_parser_state);
+  monitor.AddNalUnit(*MakeSlice(24, true), 300, &bitstream_parser_state);
+  ASSERT_EQ(2, data.frames.size());
+  monitor.Flush();
+  ASSERT_EQ(3, data.frames.size());
+
+  // the window only covers the last 2 frames
+  const auto& window = data.windows[2];
+  EXPECT_EQ(2, window.num_frames);
+  EXPECT_EQ(400, window.bytes);
+  EXPECT_EQ(20, window.min_qp);
+  EXPECT_EQ(24, window.max_qp);
+  EXPECT_DOUBLE_EQ(23.0, window.avg_qp);
+  EXPECT_DOUBLE_EQ(23.0, monitor.GetWindowQp().avg_qp);
+}
+
+TEST_F(H265QpMonitorTest, TestAnnexB) {
+  H265QpMonitor monitor({}, StoreFrame, &data);
+  auto nalu_indices =
+      H265BitstreamParser::FindNaluIndices(buffer, arraysize(buffer));
+  ASSERT_EQ(4, nalu_indices.size());
+  // send the access unit twice
+  for (int i = 0; i < 2; i++) {
+    for (const auto& nalu_index : nalu_indices) {
+      monitor.AddNalUnit(buffer + nalu_index.payload_start_offset,
+                         nalu_index.payload_size);
+    }
+  }
+  // the VPS of the second access unit completes the first one
+  ASSERT_EQ(1, data.frames.size());
+  monitor.Flush();
+  ASSERT_EQ(2, data.frames.size());
+  EXPECT_EQ(1, data.frames[0].num_slices);
+  EXPECT_EQ(35, data.frames[0].min_qp);
+  EXPECT_EQ(35, data.frames[0].max_qp);
+  EXPECT_DOUBLE_EQ(35.0, data.frames[0].avg_qp);
+  EXPECT_TRUE(data.frames[0].keyframe);
+  EXPECT_EQ(nalu_indices[3].payload_size, data.frames[0].bytes);
+  EXPECT_EQ(2, data.windows[1].num_frames);
+}
+
+#ifdef RTP_DEFINE
+TEST_F(H265QpMonitorTest, TestRtp) {
+  H265QpMonitor monitor({}, StoreFrame, &data);
+  auto nalu_indices =
+      H265BitstreamParser::FindNaluIndices(buffer, arraysize(buffer));
+  uint16_t sequence_number = 0;
+  // one single NAL unit packet per NAL unit, marker on the slice
+  for (const auto& nalu_index : nalu_indices) {
+    bool marker = (&nalu_index == &nalu_indices.back());
+    std::vector<uint8_t> packet = {
+        0x80, static_cast<uint8_t>((marker ? 0x80 : 0x00) | 96), 0x00,
+        static_cast<uint8_t>(sequence_number++), 0x00, 0x00, 0x00, 0x00,
+        0x01, 0x02, 0x03, 0x04};
+    packet.insert(packet.end(), buffer + nalu_index.payload_start_offset,
+                  buffer + nalu_index.payload_start_offset +
+                      nalu_index.payload_size);
+    EXPECT_TRUE(monitor.AddRtpPacket(packet.data(), packet.size()));
+  }
+  // the marker bit completes the frame
+  ASSERT_EQ(1, data.frames.size());
+  EXPECT_EQ(35, data.frames[0].min_qp);
+}
+#endif  // RTP_DEFINE
+
+}  // namespace h265nal
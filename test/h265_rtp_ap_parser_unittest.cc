@@ -68,4 +68,57 @@ TEST_F(H265RtpApParserTest, TestSampleAUD) {
   // check the parser state
 }
 
+TEST_F(H265RtpApParserTest, TestSampleDond) {
+  // AP (Aggregation Packet) containing VPS, SPS, PPS, with DONL/DOND fields
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {
+      // AP header
+      0x60, 0x01,
+      // NALU 1 DONL
+      0xff, 0xfe,
+      // NALU 1 size
+      0x00, 0x17,
+      // NALU 1 (VPS)
+      0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00,
+      0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x5d, 0xac, 0x09,
+      // NALU 2 DOND
+      0x00,
+      // NALU 2 size
+      0x00, 0x27,
+      // NALU 2 (SPS)
+      0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0xb0, 0x00, 0x00,
+      0x03, 0x00, 0x00, 0x03, 0x00, 0x5d, 0xa0, 0x02, 0x80, 0x80, 0x2e, 0x1f,
+      0x13, 0x96, 0xbb, 0x93, 0x24, 0xba, 0x94, 0x82, 0x81, 0x01, 0x01, 0x76,
+      0x85, 0x09, 0x40,
+      // NALU 3 DOND
+      0x02,
+      // NALU 3 size
+      0x00, 0x0a,
+      // NALU 3 (PPS)
+      0x44, 0x01, 0xc0, 0xe2, 0x4f, 0x09, 0x41, 0xec, 0x10, 0x80};
+  // fuzzer::conv: begin
+  H265BitstreamParserState bitstream_parser_state;
+  RtpDonParameters don_parameters;
+  don_parameters.sprop_max_don_diff = 4;
+  auto rtp_ap = H265RtpApParser::ParseRtpAp(
+      buffer, arraysize(buffer), &bitstream_parser_state, don_parameters);
+  // fuzzer::conv: end
+
+  ASSERT_TRUE(rtp_ap != nullptr);
+
+  // check there are 3 valid NAL units
+  EXPECT_EQ(3, rtp_ap->nal_unit_sizes.size());
+  ASSERT_EQ(3, rtp_ap->nal_unit_headers.size());
+  EXPECT_EQ(NalUnitType::VPS_NUT, rtp_ap->nal_unit_headers[0]->nal_unit_type);
+  EXPECT_EQ(NalUnitType::SPS_NUT, rtp_ap->nal_unit_headers[1]->nal_unit_type);
+  EXPECT_EQ(NalUnitType::PPS_NUT, rtp_ap->nal_unit_headers[2]->nal_unit_type);
+
+  // check the decoding order numbers (with wraparound)
+  EXPECT_TRUE(rtp_ap->don_present);
+  EXPECT_EQ(0xfffe, rtp_ap->donl);
+  EXPECT_THAT(rtp_ap->nal_unit_donds, ::testing::ElementsAreArray({0, 0, 2}));
+  EXPECT_THAT(rtp_ap->nal_unit_dons,
+              ::testing::ElementsAreArray({0xfffe, 0xffff, 2}));
+}
+
 }  // namespace h265nal
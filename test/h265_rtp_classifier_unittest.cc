@@ -0,0 +1,153 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_rtp_classifier.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <cstdint>
+
+#include "h265_common.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+class H265RtpClassifierTest : public ::testing::Test {
+ public:
+  H265RtpClassifierTest() {}
+  ~H265RtpClassifierTest() override {}
+};
+
+TEST_F(H265RtpClassifierTest, TestSingle) {
+  // RTP packet (marker bit set) with an IDR slice (first slice segment)
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {0x80, 0xe0, 0x00, 0x01, 0x00, 0x00, 0x00,
+                            0x00, 0x01, 0x02, 0x03, 0x04, 0x26, 0x01,
+                            0xaf, 0x09, 0x40, 0xf3, 0xb8, 0xd5};
+  // fuzzer::conv: begin
+  auto descriptor = H265RtpClassifier::ClassifyRtp(buffer, arraysize(buffer));
+  // fuzzer::conv: end
+
+  EXPECT_EQ(1, descriptor.valid);
+  EXPECT_EQ(RtpPacketDescriptor::kSingle, descriptor.packet_type);
+  EXPECT_EQ(NalUnitType::IDR_W_RADL, descriptor.nal_unit_type);
+  EXPECT_EQ(0, descriptor.layer_id);
+  EXPECT_EQ(0, descriptor.temporal_id);
+  EXPECT_EQ(1, descriptor.keyframe);
+  EXPECT_EQ(1, descriptor.start_of_frame);
+  EXPECT_EQ(1, descriptor.end_of_frame);
+  EXPECT_EQ(0, descriptor.parameter_sets);
+  EXPECT_EQ(1, descriptor.switching_point);
+  EXPECT_EQ(1, descriptor.num_nal_units);
+
+  // P slice (not the first slice segment), no marker bit
+  const uint8_t payload[] = {0x02, 0x01, 0x50, 0x0f, 0xe4};
+  descriptor =
+      H265RtpClassifier::ClassifyPayload(payload, arraysize(payload), false);
+  EXPECT_EQ(1, descriptor.valid);
+  EXPECT_EQ(NalUnitType::TRAIL_R, descriptor.nal_unit_type);
+  EXPECT_EQ(0, descriptor.keyframe);
+  EXPECT_EQ(0, descriptor.start_of_frame);
+  EXPECT_EQ(0, descriptor.end_of_frame);
+  EXPECT_EQ(0, descriptor.switching_point);
+
+  // TSA slice in temporal layer 1
+  const uint8_t payload2[] = {0x04, 0x02, 0x80, 0x00};
+  descriptor =
+      H265RtpClassifier::ClassifyPayload(payload2, arraysize(payload2), true);
+  EXPECT_EQ(NalUnitType::TSA_N, descriptor.nal_unit_type);
+  EXPECT_EQ(1, descriptor.temporal_id);
+  EXPECT_EQ(0, descriptor.keyframe);
+  EXPECT_EQ(1, descriptor.switching_point);
+  EXPECT_EQ(1, descriptor.start_of_frame);
+
+  // single NAL unit packet with a DONL field
+  const uint8_t payload3[] = {0x26, 0x01, 0x00, 0x07, 0xaf, 0x09};
+  descriptor = H265RtpClassifier::ClassifyPayload(payload3, arraysize(payload3),
+                                                  false, true);
+  EXPECT_EQ(1, descriptor.start_of_frame);
+}
+
+TEST_F(H265RtpClassifierTest, TestAp) {
+  // AP with a VPS, a PPS, and an IDR slice
+  const uint8_t payload[] = {
+      0x60, 0x01,
+      // VPS (truncated)
+      0x00, 0x04, 0x40, 0x01, 0x0c, 0x01,
+      // PPS
+      0x00, 0x07, 0x44, 0x01, 0xc0, 0xf3, 0xc0, 0x02, 0x10,
+      // IDR slice (truncated)
+      0x00, 0x04, 0x26, 0x01, 0xaf, 0x09};
+  auto descriptor =
+      H265RtpClassifier::ClassifyPayload(payload, arraysize(payload), true);
+  EXPECT_EQ(1, descriptor.valid);
+  EXPECT_EQ(RtpPacketDescriptor::kAp, descriptor.packet_type);
+  EXPECT_EQ(NalUnitType::IDR_W_RADL, descriptor.nal_unit_type);
+  EXPECT_EQ(3, descriptor.num_nal_units);
+  EXPECT_EQ(1, descriptor.parameter_sets);
+  EXPECT_EQ(1, descriptor.keyframe);
+  EXPECT_EQ(1, descriptor.start_of_frame);
+
+  // parameter sets only
+  descriptor =
+      H265RtpClassifier::ClassifyPayload(payload, 17, false);
+  EXPECT_EQ(1, descriptor.valid);
+  EXPECT_EQ(NalUnitType::VPS_NUT, descriptor.nal_unit_type);
+  EXPECT_EQ(2, descriptor.num_nal_units);
+  EXPECT_EQ(0, descriptor.keyframe);
+  EXPECT_EQ(0, descriptor.start_of_frame);
+
+  // NAL unit size beyond the end of the packet
+  descriptor = H265RtpClassifier::ClassifyPayload(payload, 12, false);
+  EXPECT_EQ(0, descriptor.valid);
+}
+
+TEST_F(H265RtpClassifierTest, TestFu) {
+  // first fragment of an IDR slice
+  const uint8_t payload[] = {0x62, 0x01, 0x93, 0xaf, 0x0d, 0x70};
+  auto descriptor =
+      H265RtpClassifier::ClassifyPayload(payload, arraysize(payload), false);
+  EXPECT_EQ(1, descriptor.valid);
+  EXPECT_EQ(RtpPacketDescriptor::kFu, descriptor.packet_type);
+  EXPECT_EQ(NalUnitType::IDR_W_RADL, descriptor.nal_unit_type);
+  EXPECT_EQ(1, descriptor.fu_start);
+  EXPECT_EQ(0, descriptor.fu_end);
+  EXPECT_EQ(1, descriptor.keyframe);
+  EXPECT_EQ(1, descriptor.start_of_frame);
+
+  // last fragment: no slice segment header
+  const uint8_t payload2[] = {0x62, 0x01, 0x53, 0xff, 0xff};
+  descriptor =
+      H265RtpClassifier::ClassifyPayload(payload2, arraysize(payload2), true);
+  EXPECT_EQ(0, descriptor.fu_start);
+  EXPECT_EQ(1, descriptor.fu_end);
+  EXPECT_EQ(1, descriptor.keyframe);
+  EXPECT_EQ(0, descriptor.start_of_frame);
+  EXPECT_EQ(1, descriptor.end_of_frame);
+}
+
+TEST_F(H265RtpClassifierTest, TestInvalid) {
+  // forbidden_zero_bit set
+  const uint8_t payload[] = {0xa6, 0x01, 0xaf};
+  EXPECT_EQ(0, H265RtpClassifier::ClassifyPayload(payload, arraysize(payload),
+                                                  false)
+                   .valid);
+  // nuh_temporal_id_plus1 equal to 0
+  const uint8_t payload2[] = {0x26, 0x00, 0xaf};
+  EXPECT_EQ(0, H265RtpClassifier::ClassifyPayload(payload2,
+                                                  arraysize(payload2), false)
+                   .valid);
+  // not an RTP packet
+  EXPECT_EQ(0, H265RtpClassifier::ClassifyRtp(payload, arraysize(payload))
+                   .valid);
+  // truncated FU
+  const uint8_t payload3[] = {0x62, 0x01};
+  EXPECT_EQ(0, H265RtpClassifier::ClassifyPayload(payload3,
+                                                  arraysize(payload3), false)
+                   .valid);
+}
+
+}  // namespace h265nal
@@ -0,0 +1,147 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_rtp_deinterleaver.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_common.h"
+#include "h265_rtp_depacketizer.h"
+#include "h265_rtp_don.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+namespace {
+void StoreDon(const H265RtpDepacketizer::NalUnit& nal_unit, void* opaque) {
+  auto* dons = static_cast<std::vector<uint32_t>*>(opaque);
+  // the last NAL unit byte is a copy of the DON (low byte)
+  ASSERT_LE(1, nal_unit.length);
+  EXPECT_EQ(nal_unit.don & 0xff, nal_unit.data[nal_unit.length - 1]);
+  dons->push_back(nal_unit.don);
+}
+}  // namespace
+
+class H265RtpDeinterleaverTest : public ::testing::Test {
+ public:
+  H265RtpDeinterleaverTest() {}
+  ~H265RtpDeinterleaverTest() override {}
+
+  void AddNalUnit(H265RtpDeinterleaver* deinterleaver, uint32_t don) {
+    uint8_t data = static_cast<uint8_t>(don & 0xff);
+    H265RtpDepacketizer::NalUnit nal_unit = {&data, 1, 0, 0,
+                                             false, false, don};
+    deinterleaver->AddNalUnit(nal_unit);
+  }
+
+  std::vector<uint32_t> dons;
+};
+
+TEST_F(H265RtpDeinterleaverTest, TestParseFmtp) {
+  RtpDonParameters don_parameters;
+  EXPECT_TRUE(RtpDonParameters::ParseFmtp(
+      "profile-id=1; sprop-max-don-diff=3;sprop-depack-buf-nalus=8;"
+      "sprop-depack-buf-bytes=4096",
+      &don_parameters));
+  EXPECT_TRUE(don_parameters.DonPresent());
+  EXPECT_EQ(3, don_parameters.sprop_max_don_diff);
+  EXPECT_EQ(8, don_parameters.sprop_depack_buf_nalus);
+  EXPECT_EQ(4096, don_parameters.sprop_depack_buf_bytes);
+
+  RtpDonParameters don_parameters2;
+  EXPECT_FALSE(RtpDonParameters::ParseFmtp("sprop-max-don-diff=x",
+                                           &don_parameters2));
+  EXPECT_FALSE(RtpDonParameters::ParseFmtp("sprop-max-don-diff=40000",
+                                           &don_parameters2));
+
+  EXPECT_EQ(2, RtpDonParameters::DonDiff(65535, 1));
+  EXPECT_EQ(-2, RtpDonParameters::DonDiff(1, 65535));
+  EXPECT_EQ(0, RtpDonParameters::DonDiff(7, 7));
+}
+
+TEST_F(H265RtpDeinterleaverTest, TestReorder) {
+  RtpDonParameters don_parameters;
+  don_parameters.sprop_max_don_diff = 2;
+  H265RtpDeinterleaver deinterleaver(don_parameters, StoreDon, &dons);
+
+  // interleaved transmission order, with DON wraparound
+  for (uint32_t don : {65534u, 0u, 65535u, 2u, 1u, 3u, 4u}) {
+    AddNalUnit(&deinterleaver, don);
+  }
+  // a NAL unit is released once a NAL unit more than 2 DONs later arrives
+  EXPECT_THAT(dons, ::testing::ElementsAreArray({65534, 65535, 0, 1}));
+  deinterleaver.Flush();
+  EXPECT_THAT(dons,
+              ::testing::ElementsAreArray({65534, 65535, 0, 1, 2, 3, 4}));
+
+  // a NAL unit that arrives after its successors were emitted is dropped
+  AddNalUnit(&deinterleaver, 3);
+  deinterleaver.Flush();
+  EXPECT_EQ(7, dons.size());
+  const auto& stats = deinterleaver.GetStats();
+  EXPECT_EQ(8, stats.nal_units_received);
+  EXPECT_EQ(7, stats.nal_units_emitted);
+  EXPECT_EQ(1, stats.nal_units_dropped);
+}
+
+TEST_F(H265RtpDeinterleaverTest, TestDepackBufNalus) {
+  RtpDonParameters don_parameters;
+  don_parameters.sprop_max_don_diff = 100;
+  don_parameters.sprop_depack_buf_nalus = 2;
+  H265RtpDeinterleaver deinterleaver(don_parameters, StoreDon, &dons);
+
+  // the buffer never holds more than sprop-depack-buf-nalus NAL units
+  for (uint32_t don : {11u, 10u, 13u, 12u, 14u}) {
+    AddNalUnit(&deinterleaver, don);
+  }
+  EXPECT_THAT(dons, ::testing::ElementsAreArray({10, 11, 12}));
+  EXPECT_EQ(3, deinterleaver.GetStats().max_buffered_nal_units);
+  deinterleaver.Flush();
+  EXPECT_THAT(dons, ::testing::ElementsAreArray({10, 11, 12, 13, 14}));
+}
+
+TEST_F(H265RtpDeinterleaverTest, TestChain) {
+  // depacketizer -> de-interleaver
+  RtpDonParameters don_parameters;
+  don_parameters.sprop_max_don_diff = 1;
+  H265RtpDeinterleaver deinterleaver(don_parameters, StoreDon, &dons);
+  H265RtpDepacketizer::Options options;
+  options.don_parameters = don_parameters;
+  H265RtpDepacketizer depacketizer(
+      options, H265RtpDeinterleaver::AddNalUnitCallback, &deinterleaver);
+
+  // single NAL unit packets (with a 1-byte NAL unit "payload" equal to the
+  // DON) sent in the interleaved order 1, 0, 3, 2
+  uint8_t sequence_number = 10;
+  for (uint32_t don : {1u, 0u, 3u, 2u}) {
+    const uint8_t packet[] = {0x80,
+                              0x60,
+                              0x00,
+                              sequence_number++,
+                              0x00,
+                              0x00,
+                              0x00,
+                              0x00,
+                              0x00,
+                              0x00,
+                              0x00,
+                              0x01,
+                              0x02,
+                              0x01,
+                              0x00,
+                              static_cast<uint8_t>(don),
+                              static_cast<uint8_t>(don)};
+    EXPECT_TRUE(depacketizer.AddPacket(packet, arraysize(packet)));
+  }
+  depacketizer.Flush();
+  deinterleaver.Flush();
+  EXPECT_THAT(dons, ::testing::ElementsAreArray({0, 1, 2, 3}));
+}
+
+}  // namespace h265nal
@@ -0,0 +1,359 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_rtp_depacketizer.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_common.h"
+#include "h265_rtp_header.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+namespace {
+struct EmittedNalUnit {
+  std::vector<uint8_t> data;
+  uint32_t rtp_timestamp;
+  uint16_t sequence_number;
+  bool marker;
+  bool after_loss;
+  uint32_t don;
+};
+
+void StoreNalUnit(const H265RtpDepacketizer::NalUnit& nal_unit,
+                  void* opaque) {
+  auto* nal_units = static_cast<std::vector<EmittedNalUnit>*>(opaque);
+  nal_units->push_back({std::vector<uint8_t>(nal_unit.data,
+                                             nal_unit.data + nal_unit.length),
+                        nal_unit.rtp_timestamp, nal_unit.sequence_number,
+                        nal_unit.marker, nal_unit.after_loss, nal_unit.don});
+}
+
+// build an RTP packet (PT 96, SSRC 0x01020304)
+std::vector<uint8_t> MakePacket(uint16_t sequence_number, uint32_t timestamp,
+                                bool marker,
+                                const std::vector<uint8_t>& payload) {
+  std::vector<uint8_t> packet = {
+      0x80,
+      static_cast<uint8_t>((marker ? 0x80 : 0x00) | 96),
+      static_cast<uint8_t>(sequence_number >> 8),
+      static_cast<uint8_t>(sequence_number & 0xff),
+      static_cast<uint8_t>(timestamp >> 24),
+      static_cast<uint8_t>((timestamp >> 16) & 0xff),
+      static_cast<uint8_t>((timestamp >> 8) & 0xff),
+      static_cast<uint8_t>(timestamp & 0xff),
+      0x01,
+      0x02,
+      0x03,
+      0x04};
+  packet.insert(packet.end(), payload.begin(), payload.end());
+  return packet;
+}
+
+// TRAIL_R slice NAL unit
+const std::vector<uint8_t> kNalUnit0 = {0x02, 0x01, 0xd0, 0x10, 0x20, 0x30};
+// PPS NAL unit
+const std::vector<uint8_t> kNalUnit1 = {0x44, 0x01, 0xc1, 0x72, 0xb4};
+}  // namespace
+
+class H265RtpDepacketizerTest : public ::testing::Test {
+ public:
+  H265RtpDepacketizerTest() {}
+  ~H265RtpDepacketizerTest() override {}
+
+  void AddPacket(H265RtpDepacketizer* depacketizer,
+                 const std::vector<uint8_t>& packet) {
+    EXPECT_TRUE(depacketizer->AddPacket(packet.data(), packet.size()));
+  }
+
+  std::vector<EmittedNalUnit> nal_units;
+};
+
+TEST_F(H265RtpDepacketizerTest, TestRtpHeader) {
+  // CSRC count 1, extension (1 word), padding (2 bytes)
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {0xb1, 0xe0, 0x12, 0x34, 0x00, 0x00, 0x10, 0x00,
+                            0xaa, 0xbb, 0xcc, 0xdd, 0x11, 0x22, 0x33, 0x44,
+                            0xbe, 0xde, 0x00, 0x01, 0x10, 0xff, 0x00, 0x00,
+                            0x02, 0x01, 0xd0, 0x00, 0x02};
+  // fuzzer::conv: begin
+  RtpHeader header;
+  EXPECT_TRUE(RtpHeader::Parse(buffer, arraysize(buffer), &header));
+  // fuzzer::conv: end
+
+  EXPECT_EQ(2, header.version);
+  EXPECT_EQ(1, header.padding);
+  EXPECT_EQ(1, header.extension);
+  EXPECT_EQ(1, header.csrc_count);
+  EXPECT_EQ(1, header.marker);
+  EXPECT_EQ(96, header.payload_type);
+  EXPECT_EQ(0x1234, header.sequence_number);
+  EXPECT_EQ(0x1000, header.timestamp);
+  EXPECT_EQ(0xaabbccdd, header.ssrc);
+  EXPECT_EQ(24, header.payload_offset);
+  EXPECT_EQ(3, header.payload_length);
+
+  // invalid version
+  const uint8_t buffer2[] = {0x40, 0x60, 0x00, 0x00, 0x00, 0x00,
+                             0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+  EXPECT_FALSE(RtpHeader::Parse(buffer2, arraysize(buffer2), &header));
+  // truncated
+  EXPECT_FALSE(RtpHeader::Parse(buffer, 11, &header));
+  // CSRC list beyond the end of the packet
+  const uint8_t buffer3[] = {0x8f, 0x60, 0x00, 0x00, 0x00, 0x00, 0x00,
+                             0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+  EXPECT_FALSE(RtpHeader::Parse(buffer3, arraysize(buffer3), &header));
+}
+
+TEST_F(H265RtpDepacketizerTest, TestSingleAndAp) {
+  H265RtpDepacketizer depacketizer({}, StoreNalUnit, &nal_units);
+
+  // single NAL unit packet
+  AddPacket(&depacketizer, MakePacket(100, 3000, false, kNalUnit0));
+  // AP with 2 NAL units
+  std::vector<uint8_t> ap = {0x60, 0x01};
+  ap.push_back(0x00);
+  ap.push_back(static_cast<uint8_t>(kNalUnit1.size()));
+  ap.insert(ap.end(), kNalUnit1.begin(), kNalUnit1.end());
+  ap.push_back(0x00);
+  ap.push_back(static_cast<uint8_t>(kNalUnit0.size()));
+  ap.insert(ap.end(), kNalUnit0.begin(), kNalUnit0.end());
+  AddPacket(&depacketizer, MakePacket(101, 6000, true, ap));
+
+  ASSERT_EQ(3, nal_units.size());
+  EXPECT_EQ(kNalUnit0, nal_units[0].data);
+  EXPECT_EQ(3000, nal_units[0].rtp_timestamp);
+  EXPECT_EQ(100, nal_units[0].sequence_number);
+  EXPECT_FALSE(nal_units[0].marker);
+  EXPECT_EQ(kNalUnit1, nal_units[1].data);
+  EXPECT_EQ(6000, nal_units[1].rtp_timestamp);
+  // only the last NAL unit in the AP carries the marker
+  EXPECT_FALSE(nal_units[1].marker);
+  EXPECT_EQ(kNalUnit0, nal_units[2].data);
+  EXPECT_TRUE(nal_units[2].marker);
+  for (const auto& nal_unit : nal_units) {
+    EXPECT_FALSE(nal_unit.after_loss);
+  }
+
+  const auto& stats = depacketizer.GetStats();
+  EXPECT_EQ(2, stats.packets_received);
+  EXPECT_EQ(0, stats.packets_lost);
+  EXPECT_EQ(3, stats.nal_units);
+}
+
+TEST_F(H265RtpDepacketizerTest, TestFuReassembly) {
+  H265RtpDepacketizer depacketizer({}, StoreNalUnit, &nal_units);
+
+  // TRAIL_R (type 1) NAL unit in 3 FUs
+  // payload header: type 49, layer id 0, tid 1
+  AddPacket(&depacketizer,
+            MakePacket(65534, 9000, false, {0x62, 0x01, 0x81, 0xd0, 0x10}));
+  AddPacket(&depacketizer,
+            MakePacket(65535, 9000, false, {0x62, 0x01, 0x01, 0x20}));
+  EXPECT_EQ(0, nal_units.size());
+  // sequence number wraparound
+  AddPacket(&depacketizer,
+            MakePacket(0, 9000, true, {0x62, 0x01, 0x41, 0x30}));
+
+  ASSERT_EQ(1, nal_units.size());
+  EXPECT_EQ(kNalUnit0, nal_units[0].data);
+  EXPECT_EQ(0, nal_units[0].sequence_number);
+  EXPECT_TRUE(nal_units[0].marker);
+  EXPECT_FALSE(nal_units[0].after_loss);
+  EXPECT_EQ(0, depacketizer.GetStats().nal_units_dropped);
+}
+
+TEST_F(H265RtpDepacketizerTest, TestReorder) {
+  H265RtpDepacketizer depacketizer({}, StoreNalUnit, &nal_units);
+
+  AddPacket(&depacketizer,
+            MakePacket(10, 9000, false, {0x62, 0x01, 0x81, 0xd0, 0x10}));
+  // out of order: 12 arrives before 11
+  AddPacket(&depacketizer,
+            MakePacket(12, 9000, false, {0x62, 0x01, 0x41, 0x30}));
+  EXPECT_EQ(0, nal_units.size());
+  AddPacket(&depacketizer,
+            MakePacket(11, 9000, false, {0x62, 0x01, 0x01, 0x20}));
+  ASSERT_EQ(1, nal_units.size());
+  EXPECT_EQ(kNalUnit0, nal_units[0].data);
+
+  // duplicate and late packets are dropped
+  AddPacket(&depacketizer, MakePacket(11, 9000, false, kNalUnit1));
+  AddPacket(&depacketizer, MakePacket(13, 9000, false, kNalUnit1));
+  AddPacket(&depacketizer, MakePacket(13, 9000, false, kNalUnit1));
+  EXPECT_EQ(2, nal_units.size());
+
+  const auto& stats = depacketizer.GetStats();
+  EXPECT_EQ(6, stats.packets_received);
+  EXPECT_EQ(1, stats.packets_reordered);
+  EXPECT_EQ(2, stats.packets_dropped);
+  EXPECT_EQ(0, stats.packets_lost);
+}
+
+TEST_F(H265RtpDepacketizerTest, TestReorderWraparound) {
+  // a window size that does not divide 65536
+  H265RtpDepacketizer::Options options;
+  options.reorder_window = 3;
+  H265RtpDepacketizer depacketizer(options, StoreNalUnit, &nal_units);
+
+  AddPacket(&depacketizer, MakePacket(65533, 9000, false, kNalUnit0));
+  // out of order around the wraparound: 65535 and 0 are buffered together
+  AddPacket(&depacketizer, MakePacket(65535, 9000, false, kNalUnit1));
+  AddPacket(&depacketizer, MakePacket(0, 9000, false, kNalUnit0));
+  EXPECT_EQ(1, nal_units.size());
+  AddPacket(&depacketizer, MakePacket(65534, 9000, false, kNalUnit0));
+  AddPacket(&depacketizer, MakePacket(1, 9000, true, kNalUnit1));
+  ASSERT_EQ(5, nal_units.size());
+  const uint16_t sequence_numbers[] = {65533, 65534, 65535, 0, 1};
+  for (size_t i = 0; i < nal_units.size(); i++) {
+    EXPECT_EQ(sequence_numbers[i], nal_units[i].sequence_number);
+    EXPECT_FALSE(nal_units[i].after_loss);
+  }
+
+  // a jump with nothing buffered, then out of order packets
+  AddPacket(&depacketizer, MakePacket(7, 12000, false, kNalUnit0));
+  AddPacket(&depacketizer, MakePacket(9, 12000, false, kNalUnit0));
+  AddPacket(&depacketizer, MakePacket(8, 12000, true, kNalUnit1));
+  ASSERT_EQ(8, nal_units.size());
+  EXPECT_EQ(7, nal_units[5].sequence_number);
+  EXPECT_TRUE(nal_units[5].after_loss);
+  EXPECT_EQ(8, nal_units[6].sequence_number);
+  EXPECT_EQ(9, nal_units[7].sequence_number);
+
+  const auto& stats = depacketizer.GetStats();
+  EXPECT_EQ(0, stats.packets_dropped);
+  EXPECT_EQ(2, stats.packets_reordered);
+  EXPECT_EQ(5, stats.packets_lost);
+}
+
+TEST_F(H265RtpDepacketizerTest, TestLoss) {
+  H265RtpDepacketizer::Options options;
+  options.reorder_window = 4;
+  H265RtpDepacketizer depacketizer(options, StoreNalUnit, &nal_units);
+
+  // FU start, then the middle fragment (21) is lost
+  AddPacket(&depacketizer,
+            MakePacket(20, 9000, false, {0x62, 0x01, 0x81, 0xd0, 0x10}));
+  AddPacket(&depacketizer,
+            MakePacket(22, 9000, true, {0x62, 0x01, 0x41, 0x30}));
+  AddPacket(&depacketizer, MakePacket(23, 12000, false, kNalUnit1));
+  AddPacket(&depacketizer, MakePacket(24, 12000, true, kNalUnit0));
+  EXPECT_EQ(0, nal_units.size());
+  // 25 does not fit in the window: 21 is declared lost
+  AddPacket(&depacketizer, MakePacket(25, 15000, true, kNalUnit0));
+
+  // the partial FU is dropped, and the next NAL unit is flagged
+  ASSERT_EQ(3, nal_units.size());
+  EXPECT_EQ(kNalUnit1, nal_units[0].data);
+  EXPECT_EQ(23, nal_units[0].sequence_number);
+  EXPECT_TRUE(nal_units[0].after_loss);
+  EXPECT_EQ(kNalUnit0, nal_units[1].data);
+  EXPECT_FALSE(nal_units[1].after_loss);
+  EXPECT_EQ(25, nal_units[2].sequence_number);
+  EXPECT_FALSE(nal_units[2].after_loss);
+
+  // a gap at the end of the stream
+  AddPacket(&depacketizer, MakePacket(27, 18000, true, kNalUnit0));
+  EXPECT_EQ(3, nal_units.size());
+  depacketizer.Flush();
+  ASSERT_EQ(4, nal_units.size());
+  EXPECT_TRUE(nal_units[3].after_loss);
+
+  const auto& stats = depacketizer.GetStats();
+  EXPECT_EQ(2, stats.packets_lost);
+  EXPECT_EQ(1, stats.nal_units_dropped);
+  EXPECT_EQ(4, stats.nal_units);
+}
+
+TEST_F(H265RtpDepacketizerTest, TestSequenceNumberRestart) {
+  H265RtpDepacketizer::Options options;
+  options.reorder_window = 4;
+  H265RtpDepacketizer depacketizer(options, StoreNalUnit, &nal_units);
+
+  AddPacket(&depacketizer, MakePacket(40000, 9000, true, kNalUnit0));
+  AddPacket(&depacketizer, MakePacket(40001, 12000, true, kNalUnit1));
+  // a late packet
+  AddPacket(&depacketizer, MakePacket(39990, 6000, true, kNalUnit1));
+  ASSERT_EQ(2, nal_units.size());
+
+  // the sender restarts its sequence numbers: the first packet is dropped
+  // as too late, and the second one confirms the restart
+  AddPacket(&depacketizer, MakePacket(10000, 15000, true, kNalUnit0));
+  EXPECT_EQ(2, nal_units.size());
+  AddPacket(&depacketizer, MakePacket(10001, 18000, true, kNalUnit1));
+  AddPacket(&depacketizer, MakePacket(10003, 24000, true, kNalUnit1));
+  AddPacket(&depacketizer, MakePacket(10002, 21000, true, kNalUnit0));
+  ASSERT_EQ(5, nal_units.size());
+  EXPECT_EQ(10001, nal_units[2].sequence_number);
+  EXPECT_TRUE(nal_units[2].after_loss);
+  EXPECT_EQ(10002, nal_units[3].sequence_number);
+  EXPECT_FALSE(nal_units[3].after_loss);
+  EXPECT_EQ(10003, nal_units[4].sequence_number);
+
+  // non-sequential packets far behind are still dropped
+  AddPacket(&depacketizer, MakePacket(5000, 27000, true, kNalUnit0));
+  AddPacket(&depacketizer, MakePacket(5002, 27000, true, kNalUnit0));
+  EXPECT_EQ(5, nal_units.size());
+
+  const auto& stats = depacketizer.GetStats();
+  EXPECT_EQ(1, stats.sequence_restarts);
+  EXPECT_EQ(4, stats.packets_dropped);
+  EXPECT_EQ(1, stats.packets_reordered);
+}
+
+TEST_F(H265RtpDepacketizerTest, TestInvalid) {
+  H265RtpDepacketizer depacketizer({}, StoreNalUnit, &nal_units);
+
+  // not an RTP packet
+  const uint8_t buffer[] = {0x00, 0x01, 0x02};
+  EXPECT_FALSE(depacketizer.AddPacket(buffer, arraysize(buffer)));
+  // AP with a NAL unit size beyond the end of the packet
+  AddPacket(&depacketizer,
+            MakePacket(1, 0, false, {0x60, 0x01, 0x00, 0x10, 0x02, 0x01}));
+  // PACI packet
+  AddPacket(&depacketizer, MakePacket(2, 0, false, {0x64, 0x01, 0x00, 0x00}));
+  EXPECT_EQ(0, nal_units.size());
+  EXPECT_EQ(3, depacketizer.GetStats().packets_invalid);
+}
+
+TEST_F(H265RtpDepacketizerTest, TestDon) {
+  H265RtpDepacketizer::Options options;
+  options.don_parameters.sprop_max_don_diff = 2;
+  H265RtpDepacketizer depacketizer(options, StoreNalUnit, &nal_units);
+
+  // single NAL unit packet: payload header, DONL, NAL unit payload
+  AddPacket(&depacketizer, MakePacket(1, 3000, false,
+                                      {0x44, 0x01, 0x00, 0x05, 0xc1, 0x72,
+                                       0xb4}));
+  // AP: DONL, size, NAL unit, DOND, size, NAL unit
+  std::vector<uint8_t> ap = {0x60, 0x01, 0x00, 0x07, 0x00, 0x06};
+  ap.insert(ap.end(), kNalUnit0.begin(), kNalUnit0.end());
+  ap.insert(ap.end(), {0x01, 0x00, 0x05});
+  ap.insert(ap.end(), kNalUnit1.begin(), kNalUnit1.end());
+  AddPacket(&depacketizer, MakePacket(2, 3000, false, ap));
+  // FU: DONL in the first fragment only
+  AddPacket(&depacketizer, MakePacket(3, 3000, false,
+                                      {0x62, 0x01, 0x81, 0x00, 0x06, 0xd0,
+                                       0x10}));
+  AddPacket(&depacketizer,
+            MakePacket(4, 3000, true, {0x62, 0x01, 0x41, 0x20, 0x30}));
+
+  ASSERT_EQ(4, nal_units.size());
+  EXPECT_EQ(kNalUnit1, nal_units[0].data);
+  EXPECT_EQ(5, nal_units[0].don);
+  EXPECT_EQ(kNalUnit0, nal_units[1].data);
+  EXPECT_EQ(7, nal_units[1].don);
+  EXPECT_EQ(kNalUnit1, nal_units[2].data);
+  EXPECT_EQ(9, nal_units[2].don);
+  EXPECT_EQ(kNalUnit0, nal_units[3].data);
+  EXPECT_EQ(6, nal_units[3].don);
+}
+
+}  // namespace h265nal
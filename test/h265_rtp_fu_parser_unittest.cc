@@ -128,4 +128,46 @@ TEST_F(H265RtpFuParserTest, TestSampleEnd) {
   EXPECT_EQ(NalUnitType::IDR_W_RADL, rtp_fu->fu_type);
 }
 
+TEST_F(H265RtpFuParserTest, TestSampleStartDonl) {
+  // FU containing the start of an IDR_W_RADL, with a DONL field.
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {
+    0x62, 0x01, 0x93, 0x00, 0x07, 0xaf, 0x0d, 0x70,
+    0xfd, 0xf4, 0x6e, 0xf0, 0x3c, 0x7e, 0x63, 0xc8,
+    0x15, 0xf5, 0xf7, 0x6e, 0x52, 0x0f, 0xd3, 0xb5,
+    0x44, 0x61, 0x58, 0x24, 0x68, 0xe0
+  };
+  // fuzzer::conv: begin
+  // get some mock state
+  H265BitstreamParserState bitstream_parser_state;
+  auto vps = std::make_shared<H265VpsParser::VpsState>();
+  bitstream_parser_state.vps[0] = vps;
+  auto sps = std::make_shared<H265SpsParser::SpsState>();
+  sps->sample_adaptive_offset_enabled_flag = 1;
+  sps->chroma_format_idc = 1;
+  bitstream_parser_state.sps[0] = sps;
+  auto pps = std::make_shared<H265PpsParser::PpsState>();
+  bitstream_parser_state.pps[0] = pps;
+
+  RtpDonParameters don_parameters;
+  don_parameters.sprop_max_don_diff = 1;
+  auto rtp_fu = H265RtpFuParser::ParseRtpFu(
+      buffer, arraysize(buffer), &bitstream_parser_state, don_parameters);
+  // fuzzer::conv: end
+
+  ASSERT_TRUE(rtp_fu != nullptr);
+  EXPECT_EQ(1, rtp_fu->s_bit);
+  EXPECT_EQ(NalUnitType::IDR_W_RADL, rtp_fu->fu_type);
+  EXPECT_TRUE(rtp_fu->don_present);
+  EXPECT_EQ(7, rtp_fu->donl);
+
+  auto& nal_unit_payload = rtp_fu->nal_unit_payload;
+  ASSERT_TRUE(nal_unit_payload != nullptr);
+  auto& slice_segment_header =
+      nal_unit_payload->slice_segment_layer->slice_segment_header;
+  ASSERT_TRUE(slice_segment_header != nullptr);
+  EXPECT_EQ(1, slice_segment_header->first_slice_segment_in_pic_flag);
+  EXPECT_EQ(2, slice_segment_header->slice_type);
+}
+
 }  // namespace h265nal
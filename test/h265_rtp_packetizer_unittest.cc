@@ -0,0 +1,180 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_rtp_packetizer.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+#include "h265_rtp_depacketizer.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+namespace {
+void StoreNalUnit(const H265RtpDepacketizer::NalUnit& nal_unit,
+                  void* opaque) {
+  auto* nal_units = static_cast<std::vector<std::vector<uint8_t>>*>(opaque);
+  nal_units->emplace_back(nal_unit.data, nal_unit.data + nal_unit.length);
+}
+
+// NAL unit with the given header and size (payload bytes are a counter)
+std::vector<uint8_t> MakeNalUnit(uint8_t byte0, uint8_t byte1, size_t size) {
+  std::vector<uint8_t> nal_unit = {byte0, byte1};
+  for (size_t i = 2; i < size; ++i) {
+    nal_unit.push_back(static_cast<uint8_t>(i));
+  }
+  return nal_unit;
+}
+}  // namespace
+
+class H265RtpPacketizerTest : public ::testing::Test {
+ public:
+  H265RtpPacketizerTest() {}
+  ~H265RtpPacketizerTest() override {}
+
+  // Loopback: send the packetizer output through a depacketizer.
+  void Loopback(const H265RtpPacketizer& packetizer) {
+    for (const auto& packet : packetizer.GetPackets()) {
+      // RTP header, then the payload segments
+      std::vector<uint8_t> buffer = {
+          0x80,
+          static_cast<uint8_t>((packet.marker ? 0x80 : 0x00) | 96),
+          static_cast<uint8_t>(sequence_number >> 8),
+          static_cast<uint8_t>(sequence_number & 0xff),
+          0x00,
+          0x00,
+          0x00,
+          0x00,
+          0x01,
+          0x02,
+          0x03,
+          0x04};
+      sequence_number++;
+      const BufferSegment* segments = packetizer.GetSegments(packet);
+      for (size_t i = 0; i < packet.num_segments; ++i) {
+        buffer.insert(buffer.end(), segments[i].data,
+                      segments[i].data + segments[i].length);
+      }
+      EXPECT_EQ(packet.length + 12, buffer.size());
+      EXPECT_TRUE(depacketizer.AddPacket(buffer.data(), buffer.size()));
+    }
+  }
+
+  std::vector<std::vector<uint8_t>> received;
+  H265RtpDepacketizer depacketizer{{}, StoreNalUnit, &received};
+  uint16_t sequence_number = 0;
+};
+
+TEST_F(H265RtpPacketizerTest, TestPacketize) {
+  // VPS, SPS, PPS (aggregated), a large IDR slice (fragmented), and a
+  // medium-size slice (single)
+  std::vector<std::vector<uint8_t>> nal_units = {
+      MakeNalUnit(0x40, 0x01, 24), MakeNalUnit(0x42, 0x01, 40),
+      MakeNalUnit(0x44, 0x01, 8), MakeNalUnit(0x26, 0x01, 250),
+      MakeNalUnit(0x02, 0x01, 90)};
+  std::vector<BufferSegment> nal_unit_list;
+  for (const auto& nal_unit : nal_units) {
+    nal_unit_list.push_back({nal_unit.data(), nal_unit.size()});
+  }
+
+  H265RtpPacketizer::Options options;
+  options.max_payload_size = 100;
+  H265RtpPacketizer packetizer(options);
+  ASSERT_TRUE(packetizer.Packetize(nal_unit_list.data(), nal_unit_list.size()));
+
+  const auto& packets = packetizer.GetPackets();
+  // AP(VPS, SPS, PPS), 3 FUs (248 bytes in 97-byte fragments), single
+  ASSERT_EQ(5, packets.size());
+  EXPECT_EQ(H265RtpPacketizer::kAp, packets[0].type);
+  EXPECT_EQ(2 + 2 + 24 + 2 + 40 + 2 + 8, packets[0].length);
+  EXPECT_EQ(H265RtpPacketizer::kFu, packets[1].type);
+  EXPECT_EQ(H265RtpPacketizer::kFu, packets[2].type);
+  EXPECT_EQ(H265RtpPacketizer::kFu, packets[3].type);
+  EXPECT_EQ(H265RtpPacketizer::kSingle, packets[4].type);
+  for (const auto& packet : packets) {
+    EXPECT_LE(packet.length, options.max_payload_size);
+    EXPECT_EQ(&packet == &packets.back(), packet.marker);
+  }
+
+  // zero-copy: the payload data points into the NAL units
+  const BufferSegment* segments = packetizer.GetSegments(packets[4]);
+  ASSERT_EQ(1, packets[4].num_segments);
+  EXPECT_EQ(nal_units[4].data(), segments[0].data);
+  segments = packetizer.GetSegments(packets[2]);
+  ASSERT_EQ(2, packets[2].num_segments);
+  EXPECT_EQ(3, segments[0].length);
+  EXPECT_EQ(nal_units[3].data() + 2 + 97, segments[1].data);
+
+  // check the payload headers
+  segments = packetizer.GetSegments(packets[0]);
+  EXPECT_EQ(0x60, segments[0].data[0]);
+  EXPECT_EQ(0x01, segments[0].data[1]);
+  segments = packetizer.GetSegments(packets[1]);
+  EXPECT_EQ(0x62, segments[0].data[0]);
+  EXPECT_EQ(0x01, segments[0].data[1]);
+  EXPECT_EQ(0x80 | NalUnitType::IDR_W_RADL, segments[0].data[2]);
+  segments = packetizer.GetSegments(packets[3]);
+  EXPECT_EQ(0x40 | NalUnitType::IDR_W_RADL, segments[0].data[2]);
+
+  // loopback
+  Loopback(packetizer);
+  EXPECT_EQ(nal_units, received);
+}
+
+TEST_F(H265RtpPacketizerTest, TestPacketizeNaluIndices) {
+  // Annex B stream: AUD, PPS, slice
+  const uint8_t buffer[] = {0x00, 0x00, 0x00, 0x01, 0x46, 0x01, 0x10,
+                            0x00, 0x00, 0x01, 0x44, 0x01, 0xc0, 0xf3,
+                            0xc0, 0x02, 0x10, 0x00, 0x00, 0x00, 0x01,
+                            0x02, 0x01, 0xd0, 0x0f, 0xe4, 0x16, 0x80};
+  auto nalu_indices =
+      H265BitstreamParser::FindNaluIndices(buffer, arraysize(buffer));
+  ASSERT_EQ(3, nalu_indices.size());
+
+  // no aggregation
+  H265RtpPacketizer::Options options;
+  options.aggregate = false;
+  H265RtpPacketizer packetizer(options);
+  ASSERT_TRUE(packetizer.Packetize(buffer, nalu_indices));
+  ASSERT_EQ(3, packetizer.GetPackets().size());
+  for (const auto& packet : packetizer.GetPackets()) {
+    EXPECT_EQ(H265RtpPacketizer::kSingle, packet.type);
+  }
+
+  // a second access unit: the packetizer reuses its buffers
+  options.aggregate = true;
+  H265RtpPacketizer packetizer2(options);
+  ASSERT_TRUE(packetizer2.Packetize(buffer, nalu_indices));
+  ASSERT_EQ(1, packetizer2.GetPackets().size());
+  EXPECT_EQ(H265RtpPacketizer::kAp, packetizer2.GetPackets()[0].type);
+  Loopback(packetizer2);
+  ASSERT_TRUE(packetizer2.Packetize(buffer, nalu_indices));
+  Loopback(packetizer2);
+  ASSERT_EQ(6, received.size());
+  EXPECT_EQ(std::vector<uint8_t>({0x46, 0x01, 0x10}), received[0]);
+  EXPECT_EQ(received[0], received[3]);
+}
+
+TEST_F(H265RtpPacketizerTest, TestInvalid) {
+  H265RtpPacketizer::Options options;
+  options.max_payload_size = 3;
+  H265RtpPacketizer packetizer(options);
+  auto nal_unit = MakeNalUnit(0x02, 0x01, 10);
+  BufferSegment nal_unit_segment = {nal_unit.data(), nal_unit.size()};
+  // payload too small to fragment
+  EXPECT_FALSE(packetizer.Packetize(&nal_unit_segment, 1));
+  // NAL unit shorter than its header
+  H265RtpPacketizer packetizer2({});
+  BufferSegment short_segment = {nal_unit.data(), 1};
+  EXPECT_FALSE(packetizer2.Packetize(&short_segment, 1));
+}
+
+}  // namespace h265nal
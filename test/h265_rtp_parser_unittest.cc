@@ -7,7 +7,10 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include "h265_common.h"
+#include "h265_parser_context.h"
 #include "h265_utils.h"
 #include "rtc_common.h"
 
@@ -56,6 +59,51 @@ TEST_F(H265RtpParserTest, TestSampleSingle) {
             bitstream_parser_state.sps[sps_id]->pic_height_in_luma_samples);
 }
 
+TEST_F(H265RtpParserTest, TestSampleSingleSegments) {
+  // Single NAL Unit Packet (SPS for a 1280x736 camera capture), received
+  // as a chain of 3 packet buffers
+  const uint8_t buffer0[] = {0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00};
+  const uint8_t buffer1[] = {0x03, 0x00, 0xb0, 0x00, 0x00, 0x03, 0x00,
+                             0x00, 0x03, 0x00, 0x5d, 0xa0, 0x02, 0x80};
+  const uint8_t buffer2[] = {0x80, 0x2e, 0x1f, 0x13, 0x96, 0xbb, 0x93,
+                             0x24, 0xbb, 0x95, 0x82, 0x83, 0x03, 0x01,
+                             0x76, 0x85, 0x09, 0x40};
+  const BufferSegment segments[] = {{buffer0, arraysize(buffer0)},
+                                    {buffer1, arraysize(buffer1)},
+                                    {buffer2, arraysize(buffer2)}};
+  H265BitstreamParserState bitstream_parser_state;
+  auto rtp = H265RtpParser::ParseRtp(segments, arraysize(segments),
+                                     &bitstream_parser_state);
+
+  EXPECT_TRUE(rtp != nullptr);
+  EXPECT_EQ(NalUnitType::SPS_NUT, rtp->nal_unit_header->nal_unit_type);
+  auto &sps = rtp->rtp_single->nal_unit_payload->sps;
+  EXPECT_EQ(1280, sps->pic_width_in_luma_samples);
+  EXPECT_EQ(736, sps->pic_height_in_luma_samples);
+
+  // same, with a parser context: the payload is unescaped into its buffer
+  H265ParserContext context;
+  auto rtp_context = H265RtpParser::ParseRtp(
+      segments, arraysize(segments), &bitstream_parser_state, &context);
+  ASSERT_TRUE(rtp_context != nullptr);
+  EXPECT_EQ(1280, rtp_context->rtp_single->nal_unit_payload->sps
+                      ->pic_width_in_luma_samples);
+  // 39 bytes, minus 3 emulation prevention bytes
+  EXPECT_EQ(36, context.GetUnescapeBuffer()->size());
+
+  // DON-aware version (no DONL field with sprop-max-don-diff = 0)
+  std::vector<uint8_t> buffer;
+  for (const auto &segment : segments) {
+    buffer.insert(buffer.end(), segment.data, segment.data + segment.length);
+  }
+  auto rtp_don = H265RtpParser::ParseRtp(buffer.data(), buffer.size(),
+                                         &bitstream_parser_state,
+                                         RtpDonParameters(), &context);
+  ASSERT_TRUE(rtp_don != nullptr);
+  EXPECT_EQ(736, rtp_don->rtp_single->nal_unit_payload->sps
+                     ->pic_height_in_luma_samples);
+}
+
 TEST_F(H265RtpParserTest, TestSampleApAndFu) {
   // AP (Aggregation Packet) containing VPS, PPS, SPS
   // fuzzer::conv: data
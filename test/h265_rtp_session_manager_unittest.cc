@@ -0,0 +1,311 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_rtp_session_manager.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "h265_common.h"
+#include "h265_nal_unit_parser.h"
+#include "h265_rtp_depacketizer.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+namespace {
+struct CallbackState {
+  std::atomic<uint64_t> nal_units{0};
+  std::atomic<uint64_t> parsed_nal_units{0};
+  std::atomic<uint64_t> slices{0};
+};
+
+void CountNalUnit(uint32_t /* ssrc */,
+                  const H265RtpDepacketizer::NalUnit& /* nal_unit */,
+                  const H265NalUnitParser::NalUnitState* nal_unit_state,
+                  void* opaque) {
+  auto* state = static_cast<CallbackState*>(opaque);
+  state->nal_units++;
+  if (nal_unit_state != nullptr) {
+    state->parsed_nal_units++;
+    if (IsSliceSegment(nal_unit_state->nal_unit_header->nal_unit_type)) {
+      state->slices++;
+    }
+  }
+}
+
+// VPS, SPS, PPS for a 1280x720 camera capture.
+const std::vector<std::vector<uint8_t>> kParameterSets = {
+    {0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00,
+     0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x5d, 0xac, 0x59, 0x00},
+    {0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0xb0,
+     0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x5d, 0xa0, 0x02,
+     0x80, 0x80, 0x2e, 0x1f, 0x13, 0x96, 0xbb, 0x93, 0x24, 0xbb,
+     0x95, 0x82, 0x83, 0x03, 0x01, 0x76, 0x85, 0x09, 0x40, 0x00},
+    {0x44, 0x01, 0xc0, 0xf3, 0xc0, 0x02, 0x10, 0x00},
+};
+
+// IDR slice (first bytes)
+const uint8_t kIdrSlice[] = {0x26, 0x01, 0xaf, 0x09, 0x40, 0xf3, 0xb8, 0xd5,
+                             0x39, 0xba, 0x1f, 0xe4, 0xa6, 0x08, 0x5c, 0x6e,
+                             0xb1, 0x8f, 0x00, 0x38, 0xf1, 0xa6, 0xfc, 0xf1};
+
+// P-frame slices
+const uint8_t kPSlice0[] = {
+    // slice (P-frame)
+    0x02, 0x01, 0xd0, 0x0f, 0xe4, 0x16, 0x80, 0xf4,
+    0x5a, 0xb4, 0x85, 0x6b, 0x17, 0xaa, 0xc1, 0x94,
+    0xa8, 0x9f, 0x32, 0x11, 0xe4, 0x44, 0xa5, 0xfd,
+    0xe7, 0x80, 0xda, 0xea, 0x21, 0x4c, 0x08, 0x23,
+    0xea, 0x58, 0x15, 0xa3, 0x4c, 0x1a, 0xb3, 0x80,
+    0x9b, 0x63, 0x50, 0x11, 0x75, 0x9a, 0xcc, 0x06,
+    0x09, 0x69, 0x97, 0x75, 0xa0, 0x02, 0x24, 0x22,
+    0x1c, 0x06, 0xa5, 0x69, 0x6e, 0xba, 0x9c, 0x79,
+    0x58, 0x1e, 0x52, 0xa8, 0x26, 0xfe, 0x98, 0x6f,
+    0x65, 0xee, 0x57, 0x10, 0x4f, 0x67, 0xe8, 0x43,
+    0xde, 0x8e, 0xe6, 0x40, 0x28, 0x36, 0x45, 0x06,
+    0x5e, 0xe8, 0x80, 0x34, 0xc0, 0x06, 0xf2, 0x16,
+    0x4b, 0x78, 0x5f, 0x98, 0x56, 0xcc, 0xd9, 0x59,
+    0x7a, 0xf3, 0x30, 0x5d, 0xa9, 0xc7, 0x84, 0x4a,
+    0xe0, 0x16, 0xbf, 0x07, 0x24, 0x32, 0x65, 0xbd,
+    0x39, 0xe2, 0x30, 0xbf, 0x27, 0xd3, 0x61, 0x25,
+    0x02, 0xae, 0x5a, 0xa1, 0x08, 0x9b, 0x90, 0x14,
+    0x2a, 0x09, 0xd1, 0x4a
+};
+
+const uint8_t kPSlice1[] = {
+    // slice (P-frame)
+    0x02, 0x01, 0xd0, 0x17, 0xe4, 0x08, 0x20, 0xfc,
+    0xc1, 0xf5, 0x88, 0x40, 0xcf, 0xf0, 0x00, 0x00,
+    0x03, 0x00, 0x05, 0xe0, 0x46, 0x9d, 0x90, 0xa1,
+    0x98, 0x43, 0x28, 0x48, 0xe9, 0xc6, 0xf3, 0x11,
+    0xeb, 0x29, 0x19, 0xcd, 0x34, 0x85, 0x8b, 0xc5,
+    0x21, 0xf5, 0x5a, 0x46, 0xd7, 0x5a, 0xa5, 0x34,
+    0xa6, 0xad, 0x91, 0xd6, 0x5e, 0x71, 0x18, 0x94,
+    0xe9, 0x44, 0x2a, 0x84, 0x04, 0x2c, 0x80, 0xb0,
+    0xb4, 0x03, 0xf0, 0xa0, 0xe6, 0xe6, 0x14, 0xb3,
+    0xf2, 0xfa, 0x57, 0x5e, 0x29, 0xd1, 0xe1, 0x4d,
+    0x9b, 0x17, 0xea, 0xf8, 0x5c, 0xd5, 0x0a, 0x72,
+    0xe6, 0x5e, 0x42, 0xed, 0xdd, 0xbe, 0x64, 0x38,
+    0x04, 0x5d, 0x84, 0xc7, 0x02, 0xb0, 0x50, 0x21,
+    0x3f, 0x02, 0x89, 0x83
+};
+
+// build an RTP packet (PT 96)
+std::vector<uint8_t> MakePacket(uint32_t ssrc, uint16_t sequence_number,
+                                const uint8_t* payload, size_t length) {
+  std::vector<uint8_t> packet = {0x80,
+                                 0xe0,
+                                 static_cast<uint8_t>(sequence_number >> 8),
+                                 static_cast<uint8_t>(sequence_number & 0xff),
+                                 0x00,
+                                 0x00,
+                                 0x00,
+                                 0x00,
+                                 static_cast<uint8_t>(ssrc >> 24),
+                                 static_cast<uint8_t>((ssrc >> 16) & 0xff),
+                                 static_cast<uint8_t>((ssrc >> 8) & 0xff),
+                                 static_cast<uint8_t>(ssrc & 0xff)};
+  packet.insert(packet.end(), payload, payload + length);
+  return packet;
+}
+
+// all the packets of a stream: VPS, SPS, PPS, IDR, P, P
+std::vector<std::vector<uint8_t>> MakeStream(uint32_t ssrc) {
+  std::vector<std::vector<uint8_t>> packets;
+  uint16_t sequence_number = 0;
+  for (const auto& parameter_set : kParameterSets) {
+    packets.push_back(MakePacket(ssrc, sequence_number++, parameter_set.data(),
+                                 parameter_set.size()));
+  }
+  packets.push_back(
+      MakePacket(ssrc, sequence_number++, kIdrSlice, arraysize(kIdrSlice)));
+  packets.push_back(
+      MakePacket(ssrc, sequence_number++, kPSlice0, arraysize(kPSlice0)));
+  packets.push_back(
+      MakePacket(ssrc, sequence_number++, kPSlice1, arraysize(kPSlice1)));
+  return packets;
+}
+}  // namespace
+
+class H265RtpSessionManagerTest : public ::testing::Test {
+ public:
+  H265RtpSessionManagerTest() {}
+  ~H265RtpSessionManagerTest() override {}
+
+  CallbackState state;
+};
+
+TEST_F(H265RtpSessionManagerTest, TestSessions) {
+  H265RtpSessionManager::Options options;
+  options.idle_timeout_ms = 1000;
+  H265RtpSessionManager manager(options, CountNalUnit, &state);
+
+  // interleave 2 streams in a single batch
+  auto stream0 = MakeStream(0x11111111);
+  auto stream1 = MakeStream(0x22222222);
+  std::vector<BufferSegment> batch;
+  for (size_t i = 0; i < stream0.size(); ++i) {
+    batch.push_back({stream0[i].data(), stream0[i].size()});
+    batch.push_back({stream1[i].data(), stream1[i].size()});
+  }
+  manager.ProcessPackets(batch.data(), batch.size(), 100);
+
+  EXPECT_EQ(2, manager.GetNumSessions());
+  EXPECT_EQ(12, state.nal_units);
+  EXPECT_EQ(12, state.parsed_nal_units);
+  EXPECT_EQ(6, state.slices);
+
+  // each session keeps its own parameter sets and POC
+  for (uint32_t ssrc : {0x11111111u, 0x22222222u}) {
+    H265RtpSessionManager::SessionStats session_stats;
+    ASSERT_TRUE(manager.GetSessionStats(ssrc, &session_stats));
+    EXPECT_EQ(6, session_stats.packets);
+    EXPECT_EQ(6, session_stats.nal_units);
+    EXPECT_EQ(100, session_stats.last_seen_ms);
+    EXPECT_EQ(1, session_stats.num_vps);
+    EXPECT_EQ(1, session_stats.num_sps);
+    EXPECT_EQ(1, session_stats.num_pps);
+    EXPECT_TRUE(session_stats.has_poc);
+    EXPECT_EQ(2, session_stats.last_poc);
+    EXPECT_LT(0, session_stats.memory_bytes);
+  }
+  EXPECT_LT(0, manager.GetTotalBytes());
+
+  // invalid packet
+  const uint8_t buffer[] = {0x00, 0x01, 0x02};
+  EXPECT_FALSE(manager.ProcessPacket(buffer, arraysize(buffer), 200));
+
+  // idle eviction
+  EXPECT_EQ(0, manager.EvictIdleSessions(1000));
+  EXPECT_EQ(2, manager.EvictIdleSessions(1200));
+  EXPECT_EQ(0, manager.GetNumSessions());
+  EXPECT_EQ(0, manager.GetTotalBytes());
+
+  auto stats = manager.GetStats();
+  EXPECT_EQ(13, stats.packets);
+  EXPECT_EQ(1, stats.packets_rejected);
+  EXPECT_EQ(2, stats.sessions_created);
+  EXPECT_EQ(2, stats.sessions_evicted_idle);
+}
+
+TEST_F(H265RtpSessionManagerTest, TestLimits) {
+  H265RtpSessionManager::Options options;
+  options.num_shards = 1;
+  options.max_sessions = 2;
+  H265RtpSessionManager manager(options, CountNalUnit, &state);
+
+  auto stream0 = MakeStream(1);
+  auto stream1 = MakeStream(2);
+  auto stream2 = MakeStream(3);
+  EXPECT_TRUE(manager.ProcessPacket(stream0[0].data(), stream0[0].size(), 1));
+  EXPECT_TRUE(manager.ProcessPacket(stream1[0].data(), stream1[0].size(), 2));
+  // a third session evicts the least recently used one
+  EXPECT_TRUE(manager.ProcessPacket(stream2[0].data(), stream2[0].size(), 3));
+  EXPECT_EQ(2, manager.GetNumSessions());
+  H265RtpSessionManager::SessionStats session_stats;
+  EXPECT_FALSE(manager.GetSessionStats(1, &session_stats));
+  EXPECT_TRUE(manager.GetSessionStats(2, &session_stats));
+  EXPECT_TRUE(manager.GetSessionStats(3, &session_stats));
+  EXPECT_EQ(1, manager.GetStats().sessions_evicted_count);
+
+  // the least recently used session is the one with the oldest packet
+  EXPECT_TRUE(manager.ProcessPacket(stream1[1].data(), stream1[1].size(), 4));
+  EXPECT_TRUE(manager.ProcessPacket(stream0[0].data(), stream0[0].size(), 5));
+  EXPECT_TRUE(manager.GetSessionStats(1, &session_stats));
+  EXPECT_TRUE(manager.GetSessionStats(2, &session_stats));
+  EXPECT_FALSE(manager.GetSessionStats(3, &session_stats));
+  EXPECT_EQ(2, manager.GetStats().sessions_evicted_count);
+
+  EXPECT_TRUE(manager.RemoveSession(2));
+  EXPECT_FALSE(manager.RemoveSession(2));
+  EXPECT_EQ(1, manager.GetNumSessions());
+  // a new session after a removal does not evict
+  EXPECT_TRUE(manager.ProcessPacket(stream2[0].data(), stream2[0].size(), 6));
+  EXPECT_TRUE(manager.GetSessionStats(1, &session_stats));
+  EXPECT_EQ(2, manager.GetStats().sessions_evicted_count);
+  EXPECT_TRUE(manager.RemoveSession(3));
+
+  // the session limit is split over the shards (SSRCs 2 and 3 go to the
+  // first shard, SSRC 1 to the second one)
+  H265RtpSessionManager::Options sharded_options;
+  sharded_options.num_shards = 2;
+  sharded_options.max_sessions = 2;
+  H265RtpSessionManager sharded_manager(sharded_options, CountNalUnit, &state);
+  EXPECT_TRUE(
+      sharded_manager.ProcessPacket(stream1[0].data(), stream1[0].size(), 1));
+  // a second session in the first shard evicts the first one
+  EXPECT_TRUE(
+      sharded_manager.ProcessPacket(stream2[0].data(), stream2[0].size(), 2));
+  EXPECT_FALSE(sharded_manager.GetSessionStats(2, &session_stats));
+  // a session in the second shard is not rejected
+  EXPECT_TRUE(
+      sharded_manager.ProcessPacket(stream0[0].data(), stream0[0].size(), 3));
+  EXPECT_TRUE(sharded_manager.GetSessionStats(1, &session_stats));
+  EXPECT_TRUE(sharded_manager.GetSessionStats(3, &session_stats));
+  EXPECT_EQ(2, sharded_manager.GetNumSessions());
+  EXPECT_EQ(1, sharded_manager.GetStats().sessions_evicted_count);
+  EXPECT_EQ(0, sharded_manager.GetStats().packets_rejected);
+
+  // a session limit under the number of shards
+  H265RtpSessionManager::Options small_options;
+  small_options.max_sessions = 1;
+  H265RtpSessionManager small_manager(small_options, CountNalUnit, &state);
+  EXPECT_TRUE(
+      small_manager.ProcessPacket(stream0[0].data(), stream0[0].size(), 1));
+  EXPECT_TRUE(
+      small_manager.ProcessPacket(stream1[0].data(), stream1[0].size(), 2));
+  EXPECT_EQ(1, small_manager.GetNumSessions());
+
+  // per-session memory cap: drop the depacketization state
+  H265RtpSessionManager::Options options2;
+  options2.max_session_bytes = 1;
+  H265RtpSessionManager manager2(options2, CountNalUnit, &state);
+  EXPECT_TRUE(manager2.ProcessPacket(stream0[0].data(), stream0[0].size(), 1));
+  EXPECT_EQ(1, manager2.GetStats().session_resets);
+  EXPECT_EQ(1, manager2.GetNumSessions());
+}
+
+TEST_F(H265RtpSessionManagerTest, TestThreads) {
+  H265RtpSessionManager::Options options;
+  H265RtpSessionManager manager(options, CountNalUnit, &state);
+
+  // each thread routes batches of packets for its own streams
+  const size_t num_threads = 4;
+  const uint32_t streams_per_thread = 8;
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&manager, t, streams_per_thread]() {
+      std::vector<std::vector<std::vector<uint8_t>>> streams;
+      for (uint32_t s = 0; s < streams_per_thread; ++s) {
+        streams.push_back(
+            MakeStream(static_cast<uint32_t>(t) * 1000 + s + 1));
+      }
+      for (size_t i = 0; i < streams[0].size(); ++i) {
+        std::vector<BufferSegment> batch;
+        for (const auto& stream : streams) {
+          batch.push_back({stream[i].data(), stream[i].size()});
+        }
+        manager.ProcessPackets(batch.data(), batch.size(),
+                               static_cast<int64_t>(i));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(num_threads * streams_per_thread, manager.GetNumSessions());
+  EXPECT_EQ(num_threads * streams_per_thread * 6, state.nal_units);
+  EXPECT_EQ(num_threads * streams_per_thread * 3, state.slices);
+  EXPECT_EQ(0, manager.GetStats().packets_rejected);
+}
+
+}  // namespace h265nal
@@ -142,4 +142,29 @@ TEST_F(H265RtpSingleParserTest, TestMultipleRtpPackets) {
   }
 }
 
+TEST_F(H265RtpSingleParserTest, TestSampleVpsDonl) {
+  // VPS for a 1280x720 camera capture, with a DONL field.
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {0x40, 0x01, 0x12, 0x34, 0x0c, 0x01, 0xff, 0xff,
+                            0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0xb0, 0x00,
+                            0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x5d, 0xac,
+                            0x59, 0x00};
+  // fuzzer::conv: begin
+  H265BitstreamParserState bitstream_parser_state;
+  RtpDonParameters don_parameters;
+  don_parameters.sprop_max_don_diff = 2;
+  auto rtp_single = H265RtpSingleParser::ParseRtpSingle(
+      buffer, arraysize(buffer), &bitstream_parser_state, don_parameters);
+  // fuzzer::conv: end
+
+  ASSERT_TRUE(rtp_single != nullptr);
+  EXPECT_EQ(NalUnitType::VPS_NUT, rtp_single->nal_unit_header->nal_unit_type);
+  EXPECT_TRUE(rtp_single->don_present);
+  EXPECT_EQ(0x1234, rtp_single->donl);
+  auto &vps = rtp_single->nal_unit_payload->vps;
+  ASSERT_TRUE(vps != nullptr);
+  EXPECT_EQ(0, vps->vps_video_parameter_set_id);
+  EXPECT_EQ(1, vps->vps_max_sub_layers_minus1 + 1);
+}
+
 }  // namespace h265nal
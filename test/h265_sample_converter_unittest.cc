@@ -0,0 +1,134 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_sample_converter.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_common.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+namespace {
+std::vector<uint8_t> Concatenate(const std::vector<BufferSegment>& segments) {
+  std::vector<uint8_t> buffer;
+  for (const BufferSegment& segment : segments) {
+    buffer.insert(buffer.end(), segment.data, segment.data + segment.length);
+  }
+  return buffer;
+}
+}  // namespace
+
+class H265SampleConverterTest : public ::testing::Test {
+ public:
+  H265SampleConverterTest() {}
+  ~H265SampleConverterTest() override {}
+};
+
+TEST_F(H265SampleConverterTest, TestAnnexBToLengthPrefixed) {
+  // AUD (4-byte start code), IDR slice (3-byte start code, followed by
+  // trailing_zero_8bits)
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {0x00, 0x00, 0x00, 0x01, 0x46, 0x01, 0x50,
+                            0x00, 0x00, 0x01, 0x26, 0x01, 0xaf, 0x09,
+                            0x40, 0x00, 0x00};
+  // fuzzer::conv: begin
+  std::vector<uint8_t> length_fields;
+  std::vector<h265nal::BufferSegment> segments;
+  H265SampleConverter::AnnexBToLengthPrefixed(buffer, arraysize(buffer), 4,
+                                              &length_fields, &segments);
+  // fuzzer::conv: end
+
+  ASSERT_EQ(4, segments.size());
+  // the NAL units are not copied
+  EXPECT_EQ(buffer + 4, segments[1].data);
+  EXPECT_EQ(buffer + 10, segments[3].data);
+  EXPECT_THAT(Concatenate(segments),
+              ::testing::ElementsAreArray({0x00, 0x00, 0x00, 0x03, 0x46, 0x01,
+                                           0x50, 0x00, 0x00, 0x00, 0x05, 0x26,
+                                           0x01, 0xaf, 0x09, 0x40}));
+
+  // 1-byte length fields
+  EXPECT_TRUE(H265SampleConverter::AnnexBToLengthPrefixed(
+      buffer, arraysize(buffer), 1, &length_fields, &segments));
+  EXPECT_THAT(Concatenate(segments),
+              ::testing::ElementsAreArray({0x03, 0x46, 0x01, 0x50, 0x05, 0x26,
+                                           0x01, 0xaf, 0x09, 0x40}));
+
+  // invalid length field size
+  EXPECT_FALSE(H265SampleConverter::AnnexBToLengthPrefixed(
+      buffer, arraysize(buffer), 5, &length_fields, &segments));
+}
+
+TEST_F(H265SampleConverterTest, TestAnnexBToLengthPrefixedInPlace) {
+  std::vector<uint8_t> buffer = {0x00, 0x00, 0x00, 0x01, 0x46, 0x01,
+                                 0x50, 0x00, 0x00, 0x01, 0x26, 0x01,
+                                 0xaf, 0x09, 0x40, 0x00, 0x00};
+  // 3-byte start code and 4-byte length fields: does not fit
+  std::vector<uint8_t> original = buffer;
+  size_t length = buffer.size();
+  EXPECT_FALSE(H265SampleConverter::AnnexBToLengthPrefixedInPlace(
+      buffer.data(), &length, 4));
+  EXPECT_EQ(original, buffer);
+  EXPECT_EQ(original.size(), length);
+
+  // 2-byte length fields
+  EXPECT_TRUE(H265SampleConverter::AnnexBToLengthPrefixedInPlace(
+      buffer.data(), &length, 2));
+  buffer.resize(length);
+  EXPECT_THAT(buffer, ::testing::ElementsAreArray({0x00, 0x03, 0x46, 0x01,
+                                                   0x50, 0x00, 0x05, 0x26,
+                                                   0x01, 0xaf, 0x09, 0x40}));
+}
+
+TEST_F(H265SampleConverterTest, TestLengthPrefixedToAnnexB) {
+  const uint8_t buffer[] = {0x00, 0x00, 0x00, 0x03, 0x46, 0x01,
+                            0x50, 0x00, 0x00, 0x00, 0x05, 0x26,
+                            0x01, 0xaf, 0x09, 0x40};
+  std::vector<BufferSegment> segments;
+  EXPECT_TRUE(H265SampleConverter::LengthPrefixedToAnnexB(
+      buffer, arraysize(buffer), 4, &segments));
+  ASSERT_EQ(4, segments.size());
+  EXPECT_EQ(buffer + 4, segments[1].data);
+  EXPECT_EQ(buffer + 11, segments[3].data);
+  const std::vector<uint8_t> annexb = {0x00, 0x00, 0x00, 0x01, 0x46, 0x01,
+                                       0x50, 0x00, 0x00, 0x00, 0x01, 0x26,
+                                       0x01, 0xaf, 0x09, 0x40};
+  EXPECT_EQ(annexb, Concatenate(segments));
+
+  // in place
+  std::vector<uint8_t> sample(std::begin(buffer), std::end(buffer));
+  EXPECT_TRUE(H265SampleConverter::LengthPrefixedToAnnexBInPlace(
+      sample.data(), sample.size(), 4));
+  EXPECT_EQ(annexb, sample);
+
+  // in place needs 4-byte length fields
+  const uint8_t short_buffer[] = {0x03, 0x46, 0x01, 0x50};
+  std::vector<uint8_t> short_sample(std::begin(short_buffer),
+                                    std::end(short_buffer));
+  EXPECT_FALSE(H265SampleConverter::LengthPrefixedToAnnexBInPlace(
+      short_sample.data(), short_sample.size(), 1));
+  EXPECT_TRUE(H265SampleConverter::LengthPrefixedToAnnexB(
+      short_buffer, arraysize(short_buffer), 1, &segments));
+  EXPECT_THAT(Concatenate(segments),
+              ::testing::ElementsAreArray({0x00, 0x00, 0x00, 0x01, 0x46, 0x01,
+                                           0x50}));
+
+  // truncated sample: left untouched
+  sample.assign(std::begin(buffer), std::end(buffer) - 1);
+  std::vector<uint8_t> original = sample;
+  EXPECT_FALSE(H265SampleConverter::LengthPrefixedToAnnexB(
+      sample.data(), sample.size(), 4, &segments));
+  EXPECT_FALSE(H265SampleConverter::LengthPrefixedToAnnexBInPlace(
+      sample.data(), sample.size(), 4));
+  EXPECT_EQ(original, sample);
+}
+
+}  // namespace h265nal
@@ -0,0 +1,248 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_segmenter.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+namespace {
+// segments, with a copy of their contents
+using Segments = std::vector<std::pair<H265Segmenter::Segment,
+                                       std::vector<uint8_t>>>;
+
+void StoreSegment(const H265Segmenter::Segment& segment, void* opaque) {
+  std::vector<uint8_t> contents;
+  for (const auto& span : segment.spans) {
+    contents.insert(contents.end(), span.data, span.data + span.length);
+  }
+  static_cast<Segments*>(opaque)->emplace_back(segment, contents);
+}
+
+// NAL unit types of an Annex B buffer.
+std::vector<uint32_t> GetNalUnitTypes(const std::vector<uint8_t>& buffer) {
+  std::vector<uint32_t> nal_unit_types;
+  for (const auto& nalu_index :
+       H265BitstreamParser::FindNaluIndices(buffer.data(), buffer.size())) {
+    nal_unit_types.push_back(
+        (buffer[nalu_index.payload_start_offset] >> 1) & 0x3f);
+  }
+  return nal_unit_types;
+}
+
+// VPS, SPS, PPS, IDR, TRAIL_R, AUD, CRA (2 slices), TRAIL_R, PPS, IDR,
+// TRAIL_R. The SPS has no VUI timing information.
+const uint8_t kStream[] = {
+    // VPS
+    0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+    0x00, 0x00, 0x03, 0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+    0x5d, 0xac, 0x59,
+    // SPS
+    0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03,
+    0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x5d, 0xa0, 0x02,
+    0x80, 0x80, 0x2e, 0x1f, 0x13, 0x96, 0xbb, 0x93, 0x24, 0xbb, 0x95, 0x82,
+    0x83, 0x03, 0x01, 0x76, 0x85, 0x09, 0x40,
+    // PPS
+    0x00, 0x00, 0x00, 0x01, 0x44, 0x01, 0xc0, 0xf3, 0xc0, 0x02, 0x10,
+    // IDR_W_RADL
+    0x00, 0x00, 0x01, 0x26, 0x01, 0xaf, 0x09,
+    // TRAIL_R
+    0x00, 0x00, 0x01, 0x02, 0x01, 0xd0,
+    // AUD
+    0x00, 0x00, 0x01, 0x46, 0x01, 0x50,
+    // CRA (first_slice_segment_in_pic_flag: 1, then 0)
+    0x00, 0x00, 0x01, 0x2a, 0x01, 0xa0,
+    0x00, 0x00, 0x01, 0x2a, 0x01, 0x40,
+    // TRAIL_R
+    0x00, 0x00, 0x01, 0x02, 0x01, 0xd1,
+    // PPS
+    0x00, 0x00, 0x01, 0x44, 0x01, 0xc0, 0xf3, 0xc0, 0x02, 0x10,
+    // IDR_N_LP
+    0x00, 0x00, 0x01, 0x28, 0x01, 0xaf, 0x0a,
+    // TRAIL_R
+    0x00, 0x00, 0x01, 0x02, 0x01, 0xd2};
+}  // namespace
+
+class H265SegmenterTest : public ::testing::Test {
+ public:
+  H265SegmenterTest() {}
+  ~H265SegmenterTest() override {}
+};
+
+TEST_F(H265SegmenterTest, TestSegmenter) {
+  // VPS, SPS, PPS, IDR, TRAIL_R, AUD, CRA, TRAIL_R
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {
+      0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+      0x00, 0x00, 0x03, 0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+      0x5d, 0xac, 0x59, 0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01, 0x60,
+      0x00, 0x00, 0x03, 0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+      0x5d, 0xa0, 0x02, 0x80, 0x80, 0x2e, 0x1f, 0x13, 0x96, 0xbb, 0x93, 0x24,
+      0xbb, 0x95, 0x82, 0x83, 0x03, 0x01, 0x76, 0x85, 0x09, 0x40, 0x00, 0x00,
+      0x00, 0x01, 0x44, 0x01, 0xc0, 0xf3, 0xc0, 0x02, 0x10, 0x00, 0x00, 0x01,
+      0x26, 0x01, 0xaf, 0x09, 0x00, 0x00, 0x01, 0x02, 0x01, 0xd0, 0x00, 0x00,
+      0x01, 0x46, 0x01, 0x50, 0x00, 0x00, 0x01, 0x2a, 0x01, 0xa0, 0x00, 0x00,
+      0x01, 0x02, 0x01, 0xd1};
+  // fuzzer::conv: begin
+  H265BitstreamParserState bitstream_parser_state;
+  H265Segmenter::Options options;
+  options.target_duration_ms = 0;
+  options.add_hvcc = true;
+  H265Segmenter segmenter(options, &bitstream_parser_state);
+  std::vector<std::pair<H265Segmenter::Segment, std::vector<uint8_t>>>
+      segments;
+  segmenter.Process(
+      buffer, arraysize(buffer),
+      [](const H265Segmenter::Segment& segment, void* opaque) {
+        std::vector<uint8_t> contents;
+        for (const auto& span : segment.spans) {
+          contents.insert(contents.end(), span.data, span.data + span.length);
+        }
+        static_cast<std::vector<
+            std::pair<H265Segmenter::Segment, std::vector<uint8_t>>>*>(
+            opaque)
+            ->emplace_back(segment, contents);
+      },
+      &segments);
+  // fuzzer::conv: end
+
+  // a segment per IRAP picture
+  ASSERT_EQ(2, segments.size());
+  const auto& segment0 = segments[0].first;
+  EXPECT_EQ(0, segment0.index);
+  EXPECT_EQ(0, segment0.first_picture);
+  EXPECT_EQ(2, segment0.num_pictures);
+  EXPECT_TRUE(segment0.starts_with_irap);
+  EXPECT_EQ(0, segment0.offset);
+  EXPECT_EQ(94, segment0.length);
+  ASSERT_EQ(1, segment0.spans.size());
+  EXPECT_EQ(buffer, segment0.spans[0].data);
+  EXPECT_FALSE(segment0.hvcc.empty());
+
+  // the parameter sets are injected after the AUD
+  const auto& segment1 = segments[1].first;
+  EXPECT_EQ(1, segment1.index);
+  EXPECT_EQ(2, segment1.first_picture);
+  EXPECT_EQ(2, segment1.num_pictures);
+  EXPECT_TRUE(segment1.starts_with_irap);
+  EXPECT_EQ(94, segment1.offset);
+  EXPECT_EQ(18, segment1.length);
+  ASSERT_EQ(3, segment1.spans.size());
+  EXPECT_EQ(buffer + 94, segment1.spans[0].data);
+  EXPECT_EQ(6, segment1.spans[0].length);
+  EXPECT_EQ(81, segment1.spans[1].length);
+  EXPECT_EQ(buffer + 100, segment1.spans[2].data);
+  EXPECT_EQ(12, segment1.spans[2].length);
+  EXPECT_THAT(GetNalUnitTypes(segments[1].second),
+              ::testing::ElementsAre(NalUnitType::AUD_NUT,
+                                     NalUnitType::VPS_NUT,
+                                     NalUnitType::SPS_NUT,
+                                     NalUnitType::PPS_NUT,
+                                     NalUnitType::CRA_NUT,
+                                     NalUnitType::TRAIL_R));
+  EXPECT_EQ(segments[0].first.hvcc, segment1.hvcc);
+
+  // the parameter sets are in the bitstream parser state
+  EXPECT_NE(nullptr, bitstream_parser_state.GetVps(0));
+  EXPECT_NE(nullptr, bitstream_parser_state.GetSps(0));
+  EXPECT_NE(nullptr, bitstream_parser_state.GetPps(0));
+  EXPECT_EQ(3, segmenter.GetStats().parameter_sets_injected);
+}
+
+TEST_F(H265SegmenterTest, TestDuration) {
+  H265BitstreamParserState bitstream_parser_state;
+  H265Segmenter::Options options;
+  options.target_duration_ms = 200;
+  options.frames_per_second = 10;
+  H265Segmenter segmenter(options, &bitstream_parser_state);
+  Segments segments;
+  segmenter.Process(kStream, arraysize(kStream), StoreSegment, &segments);
+
+  ASSERT_EQ(3, segments.size());
+  EXPECT_EQ(0, segments[0].first.start_time_ns);
+  EXPECT_EQ(200000000, segments[0].first.duration_ns);
+  EXPECT_EQ(200000000, segments[1].first.start_time_ns);
+  EXPECT_EQ(200000000, segments[1].first.duration_ns);
+  EXPECT_EQ(400000000, segments[2].first.start_time_ns);
+  EXPECT_EQ(200000000, segments[2].first.duration_ns);
+  EXPECT_EQ(94, segments[1].first.offset);
+  EXPECT_EQ(24, segments[1].first.length);
+  // the last access unit carries its PPS: only the VPS and SPS are injected
+  EXPECT_EQ(118, segments[2].first.offset);
+  EXPECT_EQ(23, segments[2].first.length);
+  EXPECT_THAT(GetNalUnitTypes(segments[2].second),
+              ::testing::ElementsAre(NalUnitType::VPS_NUT,
+                                     NalUnitType::SPS_NUT,
+                                     NalUnitType::PPS_NUT,
+                                     NalUnitType::IDR_N_LP,
+                                     NalUnitType::TRAIL_R));
+  ASSERT_EQ(2, segments[2].first.spans.size());
+  EXPECT_EQ(kStream + 118, segments[2].first.spans[1].data);
+
+  // the input ranges cover the stream
+  size_t offset = 0;
+  for (const auto& segment : segments) {
+    EXPECT_EQ(offset, segment.first.offset);
+    offset += segment.first.length;
+  }
+  EXPECT_EQ(arraysize(kStream), offset);
+
+  const auto& stats = segmenter.GetStats();
+  EXPECT_EQ(12, stats.nal_units);
+  EXPECT_EQ(6, stats.pictures);
+  EXPECT_EQ(3, stats.segments);
+  EXPECT_EQ(5, stats.parameter_sets_injected);
+}
+
+TEST_F(H265SegmenterTest, TestSize) {
+  H265BitstreamParserState bitstream_parser_state;
+  H265Segmenter::Options options;
+  options.target_duration_ms = 0;
+  options.target_size = 50;
+  H265Segmenter segmenter(options, &bitstream_parser_state);
+  Segments segments;
+  segmenter.Process(kStream, arraysize(kStream), StoreSegment, &segments);
+
+  // the IDR at offset 118 is too close to the CRA at offset 94
+  ASSERT_EQ(2, segments.size());
+  EXPECT_EQ(94, segments[0].first.length);
+  EXPECT_EQ(94, segments[1].first.offset);
+  EXPECT_EQ(4, segments[1].first.num_pictures);
+}
+
+TEST_F(H265SegmenterTest, TestNoIrap) {
+  // no IRAP picture: a single segment
+  const uint8_t buffer[] = {0x00, 0x00, 0x01, 0x02, 0x01, 0xd0,
+                            0x00, 0x00, 0x01, 0x02, 0x01, 0xd1};
+  H265BitstreamParserState bitstream_parser_state;
+  H265Segmenter::Options options;
+  options.target_duration_ms = 0;
+  H265Segmenter segmenter(options, &bitstream_parser_state);
+  Segments segments;
+  segmenter.Process(buffer, arraysize(buffer), StoreSegment, &segments);
+  ASSERT_EQ(1, segments.size());
+  EXPECT_FALSE(segments[0].first.starts_with_irap);
+  EXPECT_EQ(2, segments[0].first.num_pictures);
+  EXPECT_EQ(arraysize(buffer), segments[0].first.length);
+  EXPECT_TRUE(segments[0].first.hvcc.empty());
+
+  // empty input: no segment
+  segments.clear();
+  segmenter.Process(buffer, 0, StoreSegment, &segments);
+  EXPECT_TRUE(segments.empty());
+}
+
+}  // namespace h265nal
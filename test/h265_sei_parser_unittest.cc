@@ -360,4 +360,35 @@ TEST_F(H265SeiParserTest, TestColourRemappingInfoSei) {
   EXPECT_EQ(colour_remap_sei->colour_remap_cancel_flag, 1);
 }
 
+TEST_F(H265SeiParserTest, TestSeiMessageIterator) {
+  // structure_of_pictures_info (payloadType 128), a 2-byte payloadType
+  // (255 + 2), buffering_period, rbsp_trailing_bits, cabac_zero_words
+  const uint8_t buffer[] = {0x80, 0x01, 0xaa, 0xff, 0x02, 0x00, 0x00,
+                            0x02, 0x80, 0x00, 0x80, 0x00, 0x00};
+
+  H265SeiMessageIterator it(buffer, arraysize(buffer));
+  H265SeiMessageIterator::SeiMessage sei_message;
+  ASSERT_TRUE(it.Next(&sei_message));
+  EXPECT_EQ(128, sei_message.payload_type);
+  EXPECT_EQ(1, sei_message.payload_size);
+  EXPECT_EQ(0, sei_message.offset);
+  EXPECT_EQ(2, sei_message.payload_offset);
+  ASSERT_TRUE(it.Next(&sei_message));
+  EXPECT_EQ(257, sei_message.payload_type);
+  EXPECT_EQ(0, sei_message.payload_size);
+  EXPECT_EQ(3, sei_message.offset);
+  ASSERT_TRUE(it.Next(&sei_message));
+  EXPECT_EQ(0, sei_message.payload_type);
+  EXPECT_EQ(2, sei_message.payload_size);
+  EXPECT_EQ(8, sei_message.payload_offset);
+  EXPECT_FALSE(it.Next(&sei_message));
+  EXPECT_FALSE(it.IsInvalid());
+
+  // a truncated payload
+  const uint8_t truncated[] = {0x05, 0x10, 0x01, 0x02, 0x80};
+  H265SeiMessageIterator truncated_it(truncated, arraysize(truncated));
+  EXPECT_FALSE(truncated_it.Next(&sei_message));
+  EXPECT_TRUE(truncated_it.IsInvalid());
+}
+
 }  // namespace h265nal
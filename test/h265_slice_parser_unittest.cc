@@ -228,6 +228,103 @@ TEST_F(H265SliceSegmentLayerParserTest, TestSliceContainsShortTermRefPicSet) {
   ASSERT_TRUE(slice_segment_header != nullptr);
 
   EXPECT_EQ(39, slice_segment_header->num_entry_point_offsets);
+  // the entry points are past the end of the (truncated) slice
+  std::vector<H265SliceSegmentLayerParser::SliceSegmentLayerState::Substream>
+      substreams;
+  EXPECT_FALSE(
+      result->nal_unit_payload->slice_segment_layer->GetSubstreams(
+          &substreams));
+  EXPECT_TRUE(substreams.empty());
+}
+
+TEST_F(H265SliceSegmentLayerParserTest, TestSliceSegmentDataOffsets) {
+  // get some mock state (WPP, 8 CTB rows)
+  H265BitstreamParserState bitstream_parser_state;
+  auto vps = std::make_shared<H265VpsParser::VpsState>();
+  bitstream_parser_state.vps[0] = vps;
+  auto sps = std::make_shared<H265SpsParser::SpsState>();
+  sps->chroma_format_idc = 1;
+  sps->pic_width_in_luma_samples = 64;
+  sps->pic_height_in_luma_samples = 64;
+  bitstream_parser_state.sps[0] = sps;
+  auto pps = std::make_shared<H265PpsParser::PpsState>();
+  pps->entropy_coding_sync_enabled_flag = 1;
+  bitstream_parser_state.pps[0] = pps;
+
+  // IDR slice with 2 entry points (offset_len_minus1: 11, entry points: 0
+  // and 2), and emulation prevention bytes in the header and in the data
+  const uint8_t buffer[] = {
+      0x26, 0x01, 0xae, 0xc6, 0x00, 0x00, 0x03, 0x01,
+      0x40, 0x80, 0x00, 0x00, 0x03, 0x01, 0x23, 0x80
+  };
+  auto nal_unit = H265NalUnitParser::ParseNalUnit(
+      buffer, arraysize(buffer), &bitstream_parser_state, ParsingOptions());
+  ASSERT_TRUE(nal_unit != nullptr);
+  auto& slice_segment_layer = nal_unit->nal_unit_payload->slice_segment_layer;
+  ASSERT_TRUE(slice_segment_layer != nullptr);
+  auto& slice_segment_header = slice_segment_layer->slice_segment_header;
+  EXPECT_EQ(2, slice_segment_header->num_entry_point_offsets);
+  EXPECT_EQ(11, slice_segment_header->offset_len_minus1);
+
+  // the header (41 bits) ends in byte 7 (RBSP) or 8 (escaped)
+  EXPECT_EQ(7, slice_segment_layer->header_end_rbsp_offset);
+  EXPECT_EQ(8, slice_segment_layer->header_end_offset);
+  EXPECT_EQ(1, slice_segment_layer->header_end_bit_offset);
+  EXPECT_EQ(8, slice_segment_layer->slice_segment_data_rbsp_offset);
+  EXPECT_EQ(9, slice_segment_layer->slice_segment_data_offset);
+  EXPECT_EQ(1, slice_segment_layer->num_emulation_prevention_bytes);
+  EXPECT_EQ(7, slice_segment_layer->slice_segment_data_length);
+  // the entry points count the emulation prevention bytes
+  std::vector<H265SliceSegmentLayerParser::SliceSegmentLayerState::Substream>
+      substreams;
+  ASSERT_TRUE(slice_segment_layer->GetSubstreams(&substreams));
+  ASSERT_EQ(3, substreams.size());
+  EXPECT_EQ(9, substreams[0].offset);
+  EXPECT_EQ(1, substreams[0].length);
+  EXPECT_EQ(10, substreams[1].offset);
+  EXPECT_EQ(3, substreams[1].length);
+  EXPECT_EQ(13, substreams[2].offset);
+  EXPECT_EQ(3, substreams[2].length);
+
+  // segment list, split inside an emulation prevention sequence
+  const BufferSegment segments[] = {{buffer, 5}, {buffer + 5, 11}};
+  nal_unit = H265NalUnitParser::ParseNalUnit(
+      segments, arraysize(segments), &bitstream_parser_state,
+      ParsingOptions());
+  ASSERT_TRUE(nal_unit != nullptr);
+  auto& segments_layer = nal_unit->nal_unit_payload->slice_segment_layer;
+  ASSERT_TRUE(segments_layer != nullptr);
+  EXPECT_EQ(9, segments_layer->slice_segment_data_offset);
+  EXPECT_EQ(1, segments_layer->num_emulation_prevention_bytes);
+  ASSERT_TRUE(segments_layer->GetSubstreams(&substreams));
+  ASSERT_EQ(3, substreams.size());
+  EXPECT_EQ(13, substreams[2].offset);
+
+  // payload only: offsets from the end of the NAL unit header
+  auto payload_layer = H265SliceSegmentLayerParser::ParseSliceSegmentLayer(
+      buffer + 2, arraysize(buffer) - 2, NalUnitType::IDR_W_RADL,
+      &bitstream_parser_state);
+  ASSERT_TRUE(payload_layer != nullptr);
+  EXPECT_EQ(5, payload_layer->header_end_rbsp_offset);
+  EXPECT_EQ(7, payload_layer->slice_segment_data_offset);
+  ASSERT_TRUE(payload_layer->GetSubstreams(&substreams));
+  ASSERT_EQ(3, substreams.size());
+  EXPECT_EQ(11, substreams[2].offset);
+  EXPECT_EQ(3, substreams[2].length);
+
+  // unescaped buffer: both domains are the same
+  const std::vector<uint8_t> rbsp = UnescapeRbsp(buffer, arraysize(buffer));
+  nal_unit = H265NalUnitParser::ParseNalUnitUnescaped(
+      rbsp.data(), rbsp.size(), &bitstream_parser_state, ParsingOptions());
+  ASSERT_TRUE(nal_unit != nullptr);
+  auto& rbsp_layer = nal_unit->nal_unit_payload->slice_segment_layer;
+  ASSERT_TRUE(rbsp_layer != nullptr);
+  EXPECT_EQ(8, rbsp_layer->slice_segment_data_offset);
+  EXPECT_EQ(0, rbsp_layer->num_emulation_prevention_bytes);
+  ASSERT_TRUE(rbsp_layer->GetSubstreams(&substreams));
+  ASSERT_EQ(3, substreams.size());
+  EXPECT_EQ(12, substreams[2].offset);
+  EXPECT_EQ(2, substreams[2].length);
 }
 
 }  // namespace h265nal
@@ -0,0 +1,233 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_splicer.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_bitstream_parser_state.h"
+#include "h265_common.h"
+#include "h265_slice_parser.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+namespace {
+// VPS, SPS (id 0), PPS (id 0), IDR slice (PPS id 0) for a 1280x720 camera
+// capture
+const uint8_t kStream[] = {
+    // VPS
+    0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+    0x00, 0x00, 0x03, 0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+    0x5d, 0xac, 0x59,
+    // SPS
+    0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03,
+    0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x5d, 0xa0, 0x02,
+    0x80, 0x80, 0x2e, 0x1f, 0x13, 0x96, 0xbb, 0x93, 0x24, 0xbb, 0x95, 0x82,
+    0x83, 0x03, 0x01, 0x76, 0x85, 0x09, 0x40,
+    // PPS
+    0x00, 0x00, 0x00, 0x01, 0x44, 0x01, 0xc0, 0xf3, 0xc0, 0x02, 0x10,
+    // IDR_W_RADL
+    0x00, 0x00, 0x00, 0x01, 0x26, 0x01, 0xaf, 0x09, 0x40, 0xf3, 0xb8, 0xd5,
+    0x39, 0xba, 0x1f, 0xe4, 0xa6, 0x08, 0x5c, 0x6e, 0xb1, 0x8f, 0x00, 0x38,
+    0xf1, 0xa6, 0xfc, 0xf1, 0x40, 0x04, 0x3a, 0x86, 0xcb, 0x90, 0x74, 0xce,
+    0xf0, 0x46, 0x61, 0x93, 0x72, 0xd6, 0xfc, 0x35, 0xe3, 0xc5, 0x6f, 0x0a,
+    0xc4, 0x9e, 0x27, 0xc4, 0xdb, 0xe3, 0xfb, 0x38, 0x98, 0xd0, 0x8b, 0xd5,
+    0xb9, 0xb9, 0x15, 0xb4, 0x92, 0x49, 0x97, 0xe5, 0x3d, 0x36, 0x4d, 0x45,
+    0x32, 0x5c, 0xe6, 0x89, 0x53, 0x76, 0xce, 0xbb, 0x83, 0xa1, 0x27, 0x35,
+    0xfb, 0xf3, 0xc7, 0xd4, 0x85, 0x32, 0x37, 0x94, 0x09, 0xec, 0x10};
+// offset of the IDR slice in kStream
+constexpr size_t kSliceOffset = 81;
+
+// Splice a buffer, and return the output.
+std::vector<uint8_t> Splice(H265Splicer* splicer, uint32_t stream_id,
+                            const uint8_t* data, size_t length) {
+  std::vector<BufferSegment> spans;
+  splicer->Splice(stream_id, data, length, &spans);
+  std::vector<uint8_t> output;
+  for (const auto& span : spans) {
+    output.insert(output.end(), span.data, span.data + span.length);
+  }
+  return output;
+}
+
+// RBSP of the slice segment data (after the slice segment header and
+// byte_alignment()) of the last NAL unit of an Annex B buffer.
+std::vector<uint8_t> GetSliceSegmentData(const std::vector<uint8_t>& buffer) {
+  H265BitstreamParserState bitstream_parser_state;
+  auto bitstream = H265BitstreamParser::ParseBitstream(
+      buffer.data(), buffer.size(), &bitstream_parser_state, ParsingOptions());
+  auto nalu_indices =
+      H265BitstreamParser::FindNaluIndices(buffer.data(), buffer.size());
+  if (bitstream == nullptr || nalu_indices.empty()) {
+    return {};
+  }
+  const auto& nalu_index = nalu_indices.back();
+  std::vector<uint8_t> rbsp =
+      UnescapeRbsp(buffer.data() + nalu_index.payload_start_offset + 2,
+                   nalu_index.payload_size - 2);
+  BitBuffer bit_buffer(rbsp.data(), rbsp.size());
+  uint32_t nal_unit_type =
+      (buffer[nalu_index.payload_start_offset] >> 1) & 0x3f;
+  if (H265SliceSegmentHeaderParser::ParseSliceSegmentHeader(
+          &bit_buffer, nal_unit_type, &bitstream_parser_state) == nullptr) {
+    return {};
+  }
+  size_t byte_offset, bit_offset;
+  bit_buffer.GetCurrentOffset(&byte_offset, &bit_offset);
+  return std::vector<uint8_t>(rbsp.data() + byte_offset + 1,
+                              rbsp.data() + rbsp.size());
+}
+}  // namespace
+
+class H265SplicerTest : public ::testing::Test {
+ public:
+  H265SplicerTest() {}
+  ~H265SplicerTest() override {}
+};
+
+TEST_F(H265SplicerTest, TestSplicer) {
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {
+      0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+      0x00, 0x00, 0x03, 0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+      0x5d, 0xac, 0x59, 0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01, 0x60,
+      0x00, 0x00, 0x03, 0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+      0x5d, 0xa0, 0x02, 0x80, 0x80, 0x2e, 0x1f, 0x13, 0x96, 0xbb, 0x93, 0x24,
+      0xbb, 0x95, 0x82, 0x83, 0x03, 0x01, 0x76, 0x85, 0x09, 0x40, 0x00, 0x00,
+      0x00, 0x01, 0x44, 0x01, 0xc0, 0xf3, 0xc0, 0x02, 0x10, 0x00, 0x00, 0x00,
+      0x01, 0x26, 0x01, 0xaf, 0x09, 0x40, 0xf3, 0xb8, 0xd5, 0x39, 0xba, 0x1f,
+      0xe4, 0xa6, 0x08, 0x5c, 0x6e, 0xb1, 0x8f, 0x00, 0x38, 0xf1, 0xa6, 0xfc,
+      0xf1, 0x40, 0x04, 0x3a, 0x86, 0xcb, 0x90, 0x74, 0xce, 0xf0, 0x46, 0x61,
+      0x93, 0x72, 0xd6, 0xfc, 0x35, 0xe3, 0xc5, 0x6f, 0x0a, 0xc4, 0x9e, 0x27,
+      0xc4, 0xdb, 0xe3, 0xfb, 0x38, 0x98, 0xd0, 0x8b, 0xd5, 0xb9, 0xb9, 0x15,
+      0xb4, 0x92, 0x49, 0x97, 0xe5, 0x3d, 0x36, 0x4d, 0x45, 0x32, 0x5c, 0xe6,
+      0x89, 0x53, 0x76, 0xce, 0xbb, 0x83, 0xa1, 0x27, 0x35, 0xfb, 0xf3, 0xc7,
+      0xd4, 0x85, 0x32, 0x37, 0x94, 0x09, 0xec, 0x10};
+  // fuzzer::conv: begin
+  // the same stream twice (program, then ad), with colliding ids
+  H265Splicer splicer;
+  std::vector<h265nal::BufferSegment> program_spans;
+  splicer.Splice(0, buffer, arraysize(buffer), &program_spans);
+  std::vector<h265nal::BufferSegment> ad_spans;
+  splicer.Splice(1, buffer, arraysize(buffer), &ad_spans);
+  // fuzzer::conv: end
+
+  // the program passes unchanged
+  ASSERT_EQ(1, program_spans.size());
+  EXPECT_EQ(buffer, program_spans[0].data);
+  EXPECT_EQ(arraysize(buffer), program_spans[0].length);
+
+  // the ad gets new ids
+  uint32_t output_id;
+  ASSERT_TRUE(splicer.GetSpsId(1, 0, &output_id));
+  EXPECT_EQ(1, output_id);
+  ASSERT_TRUE(splicer.GetPpsId(1, 0, &output_id));
+  EXPECT_EQ(1, output_id);
+  EXPECT_EQ(2, splicer.GetStats().parameter_sets_renumbered);
+  EXPECT_EQ(1, splicer.GetStats().slices_rewritten);
+  EXPECT_EQ(0, splicer.GetStats().nal_units_dropped);
+
+  std::vector<uint8_t> output;
+  for (const auto& span : ad_spans) {
+    output.insert(output.end(), span.data, span.data + span.length);
+  }
+  H265BitstreamParserState bitstream_parser_state;
+  auto bitstream = H265BitstreamParser::ParseBitstream(
+      output.data(), output.size(), &bitstream_parser_state,
+      ParsingOptions());
+  ASSERT_TRUE(bitstream != nullptr);
+  ASSERT_EQ(4, bitstream->nal_units.size());
+  // the VPS passes unchanged
+  EXPECT_EQ(buffer, ad_spans[0].data);
+  const auto& sps = bitstream->nal_units[1]->nal_unit_payload->sps;
+  ASSERT_TRUE(sps != nullptr);
+  EXPECT_EQ(1, sps->sps_seq_parameter_set_id);
+  EXPECT_EQ(1280, sps->pic_width_in_luma_samples);
+  const auto& pps = bitstream->nal_units[2]->nal_unit_payload->pps;
+  ASSERT_TRUE(pps != nullptr);
+  EXPECT_EQ(1, pps->pps_pic_parameter_set_id);
+  EXPECT_EQ(1, pps->pps_seq_parameter_set_id);
+  const auto& slice_segment_layer =
+      bitstream->nal_units[3]->nal_unit_payload->slice_segment_layer;
+  ASSERT_TRUE(slice_segment_layer != nullptr);
+  const auto& slice_segment_header = slice_segment_layer->slice_segment_header;
+  ASSERT_TRUE(slice_segment_header != nullptr);
+  EXPECT_EQ(1, slice_segment_header->slice_pic_parameter_set_id);
+  EXPECT_EQ(1, slice_segment_header->first_slice_segment_in_pic_flag);
+  EXPECT_EQ(1, slice_segment_header->slice_sao_luma_flag);
+}
+
+TEST_F(H265SplicerTest, TestSliceSegmentData) {
+  H265Splicer splicer;
+  Splice(&splicer, 0, kStream, arraysize(kStream));
+  auto output = Splice(&splicer, 1, kStream, arraysize(kStream));
+  ASSERT_EQ(1, splicer.GetStats().slices_rewritten);
+
+  // the slice segment header grows by 2 bits (ue(v) of 1 instead of 0),
+  // but the slice segment data is kept as is
+  std::vector<uint8_t> input(std::begin(kStream), std::end(kStream));
+  auto slice_segment_data = GetSliceSegmentData(input);
+  ASSERT_FALSE(slice_segment_data.empty());
+  EXPECT_EQ(slice_segment_data, GetSliceSegmentData(output));
+}
+
+TEST_F(H265SplicerTest, TestResume) {
+  H265Splicer splicer;
+  Splice(&splicer, 0, kStream, arraysize(kStream));
+  Splice(&splicer, 1, kStream, arraysize(kStream));
+
+  // the program resumes without its parameter sets: its slices keep their
+  // ids, and pass unchanged
+  auto output = Splice(&splicer, 0, kStream + kSliceOffset,
+                       arraysize(kStream) - kSliceOffset);
+  EXPECT_THAT(output, ::testing::ElementsAreArray(kStream + kSliceOffset,
+                                                  arraysize(kStream) -
+                                                      kSliceOffset));
+  // the ad slices are rewritten again
+  Splice(&splicer, 1, kStream + kSliceOffset,
+         arraysize(kStream) - kSliceOffset);
+  EXPECT_EQ(2, splicer.GetStats().slices_rewritten);
+
+  // a stream without parameter sets cannot be mapped
+  output = Splice(&splicer, 2, kStream + kSliceOffset,
+                  arraysize(kStream) - kSliceOffset);
+  EXPECT_TRUE(output.empty());
+  EXPECT_EQ(1, splicer.GetStats().nal_units_dropped);
+}
+
+TEST_F(H265SplicerTest, TestIdExhaustion) {
+  H265Splicer splicer;
+  // 16 SPS ids
+  for (uint32_t stream_id = 0; stream_id < 16; stream_id++) {
+    Splice(&splicer, stream_id, kStream, arraysize(kStream));
+    uint32_t output_id;
+    ASSERT_TRUE(splicer.GetSpsId(stream_id, 0, &output_id));
+    EXPECT_EQ(stream_id, output_id);
+  }
+  EXPECT_EQ(0, splicer.GetStats().nal_units_dropped);
+
+  // no SPS id left (the SPS, PPS and slice are dropped)
+  auto output = Splice(&splicer, 16, kStream, arraysize(kStream));
+  // (only the VPS is left)
+  EXPECT_EQ(27, output.size());
+  EXPECT_EQ(3, splicer.GetStats().nal_units_dropped);
+  uint32_t output_id;
+  EXPECT_FALSE(splicer.GetSpsId(16, 0, &output_id));
+
+  // removing a stream releases its ids
+  splicer.RemoveStream(3);
+  Splice(&splicer, 17, kStream, arraysize(kStream));
+  ASSERT_TRUE(splicer.GetSpsId(17, 0, &output_id));
+  EXPECT_EQ(3, output_id);
+  EXPECT_EQ(3, splicer.GetStats().nal_units_dropped);
+}
+
+}  // namespace h265nal
@@ -0,0 +1,190 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_sub_bitstream_extractor.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+namespace {
+// VPS (3 sub-layers, layer set 1 is {0, 1}), prefix SEIs (picture timing,
+// and user data unregistered), and slices with different TemporalId and
+// nuh_layer_id values.
+const uint8_t kStream[] = {
+    // VPS
+    0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x05, 0xff, 0xff, 0x01, 0x60,
+    0x00, 0x00, 0x03, 0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+    0x5d, 0x00, 0x00, 0x17, 0x05, 0x64,
+    // SEI (pic_timing)
+    0x00, 0x00, 0x01, 0x4e, 0x01, 0x01, 0x01, 0xaa, 0x80,
+    // SEI (user_data_unregistered)
+    0x00, 0x00, 0x01, 0x4e, 0x01, 0x05, 0x02, 0xbb, 0xcc, 0x80,
+    // TRAIL_R: TemporalId 0
+    0x00, 0x00, 0x01, 0x02, 0x01, 0xd0,
+    // TRAIL_R: TemporalId 2
+    0x00, 0x00, 0x01, 0x02, 0x03, 0xd2,
+    // TRAIL_R: TemporalId 1
+    0x00, 0x00, 0x01, 0x02, 0x02, 0xd1,
+    // TRAIL_R: nuh_layer_id 1
+    0x00, 0x00, 0x01, 0x02, 0x09, 0xe1,
+    // TRAIL_R: nuh_layer_id 2
+    0x00, 0x00, 0x01, 0x02, 0x11, 0xe2,
+    // TRAIL_R: TemporalId 0
+    0x00, 0x00, 0x01, 0x02, 0x01, 0xd3};
+
+std::vector<uint8_t> Concatenate(const std::vector<BufferSegment>& spans) {
+  std::vector<uint8_t> out;
+  for (const auto& span : spans) {
+    out.insert(out.end(), span.data, span.data + span.length);
+  }
+  return out;
+}
+}  // namespace
+
+class H265SubBitstreamExtractorTest : public ::testing::Test {
+ public:
+  H265SubBitstreamExtractorTest() {}
+  ~H265SubBitstreamExtractorTest() override {}
+};
+
+TEST_F(H265SubBitstreamExtractorTest, TestExtract) {
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {
+      0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x05, 0xff, 0xff, 0x01, 0x60,
+      0x00, 0x00, 0x03, 0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+      0x5d, 0x00, 0x00, 0x17, 0x05, 0x64, 0x00, 0x00, 0x01, 0x4e, 0x01, 0x01,
+      0x01, 0xaa, 0x80, 0x00, 0x00, 0x01, 0x02, 0x01, 0xd0, 0x00, 0x00, 0x01,
+      0x02, 0x03, 0xd2, 0x00, 0x00, 0x01, 0x02, 0x02, 0xd1};
+  // fuzzer::conv: begin
+  H265SubBitstreamExtractor::Options options;
+  options.target_temporal_id = 1;
+  H265SubBitstreamExtractor extractor(options);
+  std::vector<h265nal::BufferSegment> spans;
+  extractor.Extract(buffer, arraysize(buffer), &spans);
+  // fuzzer::conv: end
+
+  // the SEI (HRD) and the TemporalId 2 slice are dropped
+  ASSERT_EQ(3, spans.size());
+  EXPECT_EQ(buffer, spans[0].data);
+  EXPECT_EQ(30, spans[0].length);
+  EXPECT_EQ(buffer + 39, spans[1].data);
+  EXPECT_EQ(6, spans[1].length);
+  EXPECT_EQ(buffer + 51, spans[2].data);
+  EXPECT_EQ(6, spans[2].length);
+  EXPECT_EQ(42, Concatenate(spans).size());
+  EXPECT_EQ(5, extractor.GetStats().nal_units);
+  EXPECT_EQ(2, extractor.GetStats().nal_units_removed);
+  EXPECT_EQ(1, extractor.GetStats().sei_removed);
+}
+
+TEST_F(H265SubBitstreamExtractorTest, TestTemporalIds) {
+  // tIdTarget 0: the base sub-layer
+  H265SubBitstreamExtractor::Options options;
+  options.target_temporal_id = 0;
+  H265SubBitstreamExtractor extractor(options);
+  std::vector<BufferSegment> spans;
+  size_t size = extractor.Extract(kStream, arraysize(kStream), &spans);
+  EXPECT_EQ(1, extractor.GetTargetLayerIds());
+  EXPECT_EQ(1, extractor.GetStats().sei_removed);
+  // VPS, SEI (user data), and both TemporalId 0 slices
+  EXPECT_EQ(3, spans.size());
+  EXPECT_EQ(52, size);
+  EXPECT_THAT(Concatenate(spans),
+              ::testing::ElementsAreArray(
+                  {0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x05, 0xff,
+                   0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0xb0, 0x00,
+                   0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x5d, 0x00, 0x00,
+                   0x17, 0x05, 0x64, 0x00, 0x00, 0x01, 0x4e, 0x01, 0x05,
+                   0x02, 0xbb, 0xcc, 0x80, 0x00, 0x00, 0x01, 0x02, 0x01,
+                   0xd0, 0x00, 0x00, 0x01, 0x02, 0x01, 0xd3}));
+
+  // all the sub-layers: the HRD SEI is kept
+  H265SubBitstreamExtractor full_extractor({});
+  spans.clear();
+  size = full_extractor.Extract(kStream, arraysize(kStream), &spans);
+  EXPECT_EQ(0, full_extractor.GetStats().sei_removed);
+  // only the nuh_layer_id 1 and 2 slices are dropped
+  ASSERT_EQ(2, spans.size());
+  EXPECT_EQ(kStream, spans[0].data);
+  EXPECT_EQ(67, spans[0].length);
+  EXPECT_EQ(kStream + 79, spans[1].data);
+  EXPECT_EQ(6, spans[1].length);
+  EXPECT_EQ(73, size);
+}
+
+TEST_F(H265SubBitstreamExtractorTest, TestStructureOfPictures) {
+  // VPS, SEI (structure_of_pictures_info, whose payloadType 128 is the same
+  // byte as the RBSP trailing bits, and buffering_period), and a TemporalId
+  // 0 slice
+  const uint8_t buffer[] = {
+      0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x05, 0xff, 0xff, 0x01, 0x60,
+      0x00, 0x00, 0x03, 0x00, 0xb0, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+      0x5d, 0x00, 0x00, 0x17, 0x05, 0x64, 0x00, 0x00, 0x01, 0x4e, 0x01, 0x80,
+      0x01, 0xaa, 0x00, 0x01, 0xbb, 0x80, 0x00, 0x00, 0x01, 0x02, 0x01, 0xd0};
+  H265SubBitstreamExtractor::Options options;
+  options.target_temporal_id = 1;
+  H265SubBitstreamExtractor extractor(options);
+  std::vector<BufferSegment> spans;
+  extractor.Extract(buffer, arraysize(buffer), &spans);
+  // the SEI (HRD) is dropped
+  ASSERT_EQ(2, spans.size());
+  EXPECT_EQ(buffer, spans[0].data);
+  EXPECT_EQ(30, spans[0].length);
+  EXPECT_EQ(buffer + 42, spans[1].data);
+  EXPECT_EQ(6, spans[1].length);
+  EXPECT_EQ(1, extractor.GetStats().sei_removed);
+}
+
+TEST_F(H265SubBitstreamExtractorTest, TestLayerSet) {
+  H265SubBitstreamExtractor::Options options;
+  options.target_temporal_id = 2;
+  options.layer_set_idx = 1;
+  H265SubBitstreamExtractor extractor(options);
+  std::vector<BufferSegment> spans;
+  // use the NAL unit index
+  auto nalu_indices =
+      H265BitstreamParser::FindNaluIndices(kStream, arraysize(kStream));
+  ASSERT_EQ(9, nalu_indices.size());
+  size_t size =
+      extractor.Extract(kStream, arraysize(kStream), nalu_indices, &spans);
+  EXPECT_EQ(0x3, extractor.GetTargetLayerIds());
+  // only the nuh_layer_id 2 slice is dropped
+  ASSERT_EQ(2, spans.size());
+  EXPECT_EQ(73, spans[0].length);
+  EXPECT_EQ(kStream + 79, spans[1].data);
+  EXPECT_EQ(79, size);
+  EXPECT_EQ(9, extractor.GetStats().nal_units);
+  EXPECT_EQ(1, extractor.GetStats().nal_units_removed);
+}
+
+TEST_F(H265SubBitstreamExtractorTest, TestKeepNalUnit) {
+  H265SubBitstreamExtractor::Options options;
+  options.target_temporal_id = 1;
+  H265SubBitstreamExtractor extractor(options);
+  // no VPS: the base layer only
+  const uint8_t tid0[] = {0x02, 0x01, 0xd0};
+  const uint8_t tid2[] = {0x02, 0x03, 0xd2};
+  const uint8_t layer1[] = {0x02, 0x09, 0xe1};
+  // forbidden nuh_temporal_id_plus1 value
+  const uint8_t invalid[] = {0x02, 0x00, 0xd0};
+  EXPECT_TRUE(extractor.KeepNalUnit(tid0, arraysize(tid0)));
+  EXPECT_FALSE(extractor.KeepNalUnit(tid2, arraysize(tid2)));
+  EXPECT_FALSE(extractor.KeepNalUnit(layer1, arraysize(layer1)));
+  EXPECT_FALSE(extractor.KeepNalUnit(invalid, arraysize(invalid)));
+  EXPECT_FALSE(extractor.KeepNalUnit(tid0, 1));
+  EXPECT_EQ(5, extractor.GetStats().nal_units);
+  EXPECT_EQ(4, extractor.GetStats().nal_units_removed);
+}
+
+}  // namespace h265nal
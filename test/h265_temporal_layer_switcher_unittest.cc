@@ -0,0 +1,143 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_temporal_layer_switcher.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "h265_common.h"
+#ifdef RTP_DEFINE
+#include "h265_rtp_classifier.h"
+#endif  // RTP_DEFINE
+#include "rtc_common.h"
+
+namespace h265nal {
+
+namespace {
+// A slice segment NAL unit (header and first slice header byte).
+std::vector<uint8_t> MakeSlice(uint32_t nal_unit_type, uint32_t temporal_id,
+                               bool first_slice_segment_in_pic_flag = true) {
+  return {static_cast<uint8_t>(nal_unit_type << 1),
+          static_cast<uint8_t>(temporal_id + 1),
+          static_cast<uint8_t>(first_slice_segment_in_pic_flag ? 0x80 : 0x00)};
+}
+}  // namespace
+
+class H265TemporalLayerSwitcherTest : public ::testing::Test {
+ public:
+  H265TemporalLayerSwitcherTest() {}
+  ~H265TemporalLayerSwitcherTest() override {}
+
+  bool Process(H265TemporalLayerSwitcher* switcher,
+               const std::vector<uint8_t>& nal_unit) {
+    return switcher->ProcessNalUnit(nal_unit.data(), nal_unit.size());
+  }
+};
+
+TEST_F(H265TemporalLayerSwitcherTest, TestSwitchDown) {
+  H265TemporalLayerSwitcher switcher;
+  EXPECT_EQ(H265TemporalLayerSwitcher::kMaxTemporalId,
+            switcher.GetCurrentTemporalId());
+  EXPECT_TRUE(Process(&switcher, MakeSlice(NalUnitType::IDR_W_RADL, 0)));
+  // first slice segment of a TemporalId 2 picture
+  EXPECT_TRUE(Process(&switcher, MakeSlice(NalUnitType::TRAIL_N, 2)));
+
+  // switching down is immediate, but the current picture is completed
+  switcher.SetTargetTemporalId(1);
+  EXPECT_EQ(1, switcher.GetCurrentTemporalId());
+  EXPECT_FALSE(switcher.IsSwitchPending());
+  EXPECT_TRUE(Process(&switcher, MakeSlice(NalUnitType::TRAIL_N, 2, false)));
+  EXPECT_TRUE(Process(&switcher, MakeSlice(NalUnitType::TRAIL_R, 1)));
+  EXPECT_FALSE(Process(&switcher, MakeSlice(NalUnitType::TRAIL_N, 2)));
+  EXPECT_FALSE(Process(&switcher, MakeSlice(NalUnitType::TRAIL_N, 2, false)));
+  EXPECT_TRUE(Process(&switcher, MakeSlice(NalUnitType::TRAIL_R, 0)));
+
+  // non-VCL NAL units: VPS (TemporalId 0), suffix SEI of a dropped picture
+  EXPECT_TRUE(Process(&switcher, {0x40, 0x01}));
+  EXPECT_FALSE(Process(&switcher, MakeSlice(NalUnitType::TRAIL_N, 2)));
+  EXPECT_FALSE(Process(&switcher, {0x50, 0x03, 0x00}));
+
+  const auto& stats = switcher.GetStats();
+  EXPECT_EQ(6, stats.forwarded);
+  EXPECT_EQ(4, stats.dropped);
+  EXPECT_EQ(1, stats.switches_down);
+  EXPECT_EQ(0, stats.switches_up);
+}
+
+TEST_F(H265TemporalLayerSwitcherTest, TestSwitchUp) {
+  H265TemporalLayerSwitcher switcher(0);
+  EXPECT_TRUE(Process(&switcher, MakeSlice(NalUnitType::TRAIL_R, 0)));
+  EXPECT_FALSE(Process(&switcher, MakeSlice(NalUnitType::TRAIL_N, 1)));
+
+  switcher.SetTargetTemporalId(2);
+  EXPECT_TRUE(switcher.IsSwitchPending());
+  EXPECT_EQ(0, switcher.GetCurrentTemporalId());
+  // not a switching point
+  EXPECT_FALSE(Process(&switcher, MakeSlice(NalUnitType::TRAIL_N, 1)));
+  // an STSA picture two layers up is not a switching point either
+  EXPECT_FALSE(Process(&switcher, MakeSlice(NalUnitType::STSA_N, 2)));
+  // STSA at TemporalId 1: switch up one layer
+  EXPECT_TRUE(Process(&switcher, MakeSlice(NalUnitType::STSA_R, 1)));
+  EXPECT_TRUE(Process(&switcher, MakeSlice(NalUnitType::STSA_R, 1, false)));
+  EXPECT_EQ(1, switcher.GetCurrentTemporalId());
+  EXPECT_TRUE(switcher.IsSwitchPending());
+  EXPECT_FALSE(Process(&switcher, MakeSlice(NalUnitType::TRAIL_N, 2)));
+  EXPECT_TRUE(Process(&switcher, MakeSlice(NalUnitType::TRAIL_N, 1)));
+  // TSA at TemporalId 2: switch up to the target
+  EXPECT_TRUE(Process(&switcher, MakeSlice(NalUnitType::TSA_N, 2)));
+  EXPECT_EQ(2, switcher.GetCurrentTemporalId());
+  EXPECT_FALSE(switcher.IsSwitchPending());
+  EXPECT_EQ(2, switcher.GetStats().switches_up);
+}
+
+TEST_F(H265TemporalLayerSwitcherTest, TestSwitchUpAtIrap) {
+  H265TemporalLayerSwitcher switcher(0);
+  switcher.SetTargetTemporalId(10);
+  EXPECT_EQ(H265TemporalLayerSwitcher::kMaxTemporalId,
+            switcher.GetTargetTemporalId());
+  EXPECT_FALSE(Process(&switcher, MakeSlice(NalUnitType::TSA_N, 3)));
+  EXPECT_TRUE(Process(&switcher, MakeSlice(NalUnitType::CRA_NUT, 0)));
+  EXPECT_EQ(H265TemporalLayerSwitcher::kMaxTemporalId,
+            switcher.GetCurrentTemporalId());
+  EXPECT_TRUE(Process(&switcher, MakeSlice(NalUnitType::TRAIL_N, 3)));
+
+  // invalid NAL units
+  EXPECT_FALSE(Process(&switcher, {0x02}));
+  EXPECT_FALSE(Process(&switcher, {0x02, 0x00, 0x80}));
+}
+
+#ifdef RTP_DEFINE
+TEST_F(H265TemporalLayerSwitcherTest, TestRtpPacket) {
+  H265TemporalLayerSwitcher switcher(0);
+  // single NAL unit packet: IDR slice
+  const uint8_t idr[] = {0x26, 0x01, 0xaf};
+  // FU (TemporalId 1, TSA_N): start and end fragments
+  const uint8_t fu_start[] = {0x62, 0x02, 0x82, 0xaf, 0x00};
+  const uint8_t fu_end[] = {0x62, 0x02, 0x42, 0x00, 0x00};
+
+  EXPECT_TRUE(switcher.ProcessRtpPacket(
+      H265RtpClassifier::ClassifyPayload(idr, arraysize(idr), true)));
+  EXPECT_FALSE(switcher.ProcessRtpPacket(
+      H265RtpClassifier::ClassifyPayload(fu_start, arraysize(fu_start),
+                                         false)));
+  EXPECT_FALSE(switcher.ProcessRtpPacket(
+      H265RtpClassifier::ClassifyPayload(fu_end, arraysize(fu_end), true)));
+
+  // switch up at the TSA picture: all its fragments are forwarded
+  switcher.SetTargetTemporalId(1);
+  EXPECT_TRUE(switcher.ProcessRtpPacket(
+      H265RtpClassifier::ClassifyPayload(fu_start, arraysize(fu_start),
+                                         false)));
+  EXPECT_TRUE(switcher.ProcessRtpPacket(
+      H265RtpClassifier::ClassifyPayload(fu_end, arraysize(fu_end), true)));
+  EXPECT_EQ(1, switcher.GetCurrentTemporalId());
+}
+#endif  // RTP_DEFINE
+
+}  // namespace h265nal
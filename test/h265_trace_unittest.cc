@@ -0,0 +1,167 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_trace.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "h265_common.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+// A trace policy that keeps all the callbacks it gets.
+struct RecordingTracePolicy {
+  struct Element {
+    std::string name;
+    uint64_t i;
+    uint64_t j;
+    TraceDescriptor descriptor;
+    size_t bit_offset;
+    size_t bit_count;
+    int64_t value;
+  };
+  static constexpr bool kEnabled = true;
+  static void NalUnit(uint32_t nal_unit_type) {
+    nal_unit_types.push_back(nal_unit_type);
+  }
+  static void SyntaxElement(const char* name, uint64_t i, uint64_t j,
+                            TraceDescriptor descriptor, size_t bit_offset,
+                            size_t bit_count, int64_t value) {
+    elements.push_back({name, i, j, descriptor, bit_offset, bit_count, value});
+  }
+  static std::vector<uint32_t> nal_unit_types;
+  static std::vector<Element> elements;
+};
+
+std::vector<uint32_t> RecordingTracePolicy::nal_unit_types;
+std::vector<RecordingTracePolicy::Element> RecordingTracePolicy::elements;
+
+typedef H265SyntaxTracer<RecordingTracePolicy> RecordingTrace;
+
+class H265TraceTest : public ::testing::Test {
+ public:
+  H265TraceTest() {}
+  ~H265TraceTest() override {}
+
+  void SetUp() override {
+    RecordingTracePolicy::nal_unit_types.clear();
+    RecordingTracePolicy::elements.clear();
+  }
+};
+
+TEST_F(H265TraceTest, TestRecordingPolicy) {
+  // 101 00111 011 00000
+  // u(3) = 5, ue(v) = 6, se(v) = -1
+  const uint8_t buffer[] = {0xa7, 0x60};
+  BitBuffer bit_buffer(buffer, arraysize(buffer));
+  uint32_t u_value;
+  uint32_t ue_value;
+  int32_t se_value;
+
+  EXPECT_TRUE(bit_buffer.ReadBits(3, u_value));
+  RecordingTrace::u(&bit_buffer, "foo", 3, u_value);
+  EXPECT_TRUE(bit_buffer.ReadExponentialGolomb(ue_value));
+  RecordingTrace::ue(&bit_buffer, "bar", ue_value, 2);
+  EXPECT_TRUE(bit_buffer.ReadSignedExponentialGolomb(se_value));
+  RecordingTrace::se(&bit_buffer, "baz", se_value, 1, 4);
+
+  const auto& elements = RecordingTracePolicy::elements;
+  ASSERT_EQ(3, elements.size());
+
+  EXPECT_EQ("foo", elements[0].name);
+  EXPECT_EQ(RecordingTrace::kNoIndex, elements[0].i);
+  EXPECT_EQ(RecordingTrace::kNoIndex, elements[0].j);
+  EXPECT_EQ(TraceDescriptor_u, elements[0].descriptor);
+  EXPECT_EQ(0, elements[0].bit_offset);
+  EXPECT_EQ(3, elements[0].bit_count);
+  EXPECT_EQ(5, elements[0].value);
+
+  EXPECT_EQ("bar", elements[1].name);
+  EXPECT_EQ(2, elements[1].i);
+  EXPECT_EQ(RecordingTrace::kNoIndex, elements[1].j);
+  EXPECT_EQ(TraceDescriptor_ue, elements[1].descriptor);
+  EXPECT_EQ(3, elements[1].bit_offset);
+  EXPECT_EQ(5, elements[1].bit_count);
+  EXPECT_EQ(6, elements[1].value);
+
+  EXPECT_EQ("baz", elements[2].name);
+  EXPECT_EQ(1, elements[2].i);
+  EXPECT_EQ(4, elements[2].j);
+  EXPECT_EQ(TraceDescriptor_se, elements[2].descriptor);
+  EXPECT_EQ(8, elements[2].bit_offset);
+  EXPECT_EQ(3, elements[2].bit_count);
+  EXPECT_EQ(-1, elements[2].value);
+}
+
+TEST_F(H265TraceTest, TestNalUnit) {
+  // nal_unit_header() of an SPS
+  const uint8_t buffer[] = {0x42, 0x01};
+  BitBuffer bit_buffer(buffer, arraysize(buffer));
+
+  RecordingTrace::nal_unit(&bit_buffer);
+  ASSERT_EQ(1, RecordingTracePolicy::nal_unit_types.size());
+  EXPECT_EQ(SPS_NUT, RecordingTracePolicy::nal_unit_types[0]);
+
+  // peeking must not advance the bit buffer
+  size_t byte_offset, bit_offset;
+  bit_buffer.GetCurrentOffset(&byte_offset, &bit_offset);
+  EXPECT_EQ(0, byte_offset);
+  EXPECT_EQ(0, bit_offset);
+}
+
+TEST_F(H265TraceTest, TestNullPolicy) {
+  const uint8_t buffer[] = {0xa7, 0x60};
+  BitBuffer bit_buffer(buffer, arraysize(buffer));
+  uint32_t u_value;
+
+  EXPECT_TRUE(bit_buffer.ReadBits(3, u_value));
+  H265SyntaxTracer<H265NullTracePolicy>::u(&bit_buffer, "foo", 3, u_value);
+  EXPECT_TRUE(RecordingTracePolicy::elements.empty());
+}
+
+TEST_F(H265TraceTest, TestTraceHeadersPolicy) {
+  // 101 00111 011 00000
+  const uint8_t buffer[] = {0xa7, 0x60};
+  BitBuffer bit_buffer(buffer, arraysize(buffer));
+  uint32_t u_value;
+  int32_t se_value;
+  uint32_t ue_value;
+
+  FILE* outfp = tmpfile();
+  ASSERT_TRUE(outfp != nullptr);
+  H265TraceHeadersPolicy::SetOutput(outfp);
+  typedef H265SyntaxTracer<H265TraceHeadersPolicy> TraceHeaders;
+  H265TraceHeadersPolicy::NalUnit(PPS_NUT);
+  EXPECT_TRUE(bit_buffer.ReadBits(3, u_value));
+  TraceHeaders::u(&bit_buffer, "foo", 3, u_value);
+  EXPECT_TRUE(bit_buffer.ReadExponentialGolomb(ue_value));
+  TraceHeaders::ue(&bit_buffer, "bar", ue_value, 2);
+  EXPECT_TRUE(bit_buffer.ReadSignedExponentialGolomb(se_value));
+  TraceHeaders::se(&bit_buffer, "baz", se_value, 1, 4);
+  H265TraceHeadersPolicy::SetOutput(nullptr);
+
+  std::string output;
+  rewind(outfp);
+  char line[256];
+  while (fgets(line, sizeof(line), outfp) != nullptr) {
+    output += line;
+  }
+  fclose(outfp);
+
+  // same layout as ffmpeg's trace_headers: the bits are right-aligned at
+  // column 73, followed by the value
+  std::string expected = "Picture Parameter Set\n";
+  expected += "0           foo" + std::string(55, ' ') + "101 = 5\n";
+  expected += "3           bar[2]" + std::string(50, ' ') + "00111 = 6\n";
+  expected += "8           baz[1][4]" + std::string(49, ' ') + "011 = -1\n";
+  EXPECT_EQ(expected, output);
+}
+
+}  // namespace h265nal
@@ -0,0 +1,345 @@
+/*
+ *  Copyright (c) Facebook, Inc. and its affiliates.
+ */
+
+#include "h265_ts_demuxer.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "h265_bitstream_parser.h"
+#include "h265_common.h"
+#include "rtc_common.h"
+
+namespace h265nal {
+
+namespace {
+// access units, with a copy of their data
+using AccessUnits =
+    std::vector<std::pair<H265TsDemuxer::AccessUnit, std::vector<uint8_t>>>;
+
+void StoreAccessUnit(const H265TsDemuxer::AccessUnit& access_unit,
+                     void* opaque) {
+  auto* access_units = static_cast<AccessUnits*>(opaque);
+  access_units->emplace_back(
+      access_unit, std::vector<uint8_t>(access_unit.data,
+                                        access_unit.data + access_unit.length));
+}
+
+uint32_t Crc32(const std::vector<uint8_t>& data) {
+  uint32_t crc = 0xffffffff;
+  for (uint8_t byte : data) {
+    crc ^= static_cast<uint32_t>(byte) << 24;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80000000) ? ((crc << 1) ^ 0x04c11db7) : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+// A TS packet. Payloads shorter than 184 bytes are padded with adaptation
+// field stuffing.
+std::vector<uint8_t> MakePacket(uint32_t pid, bool unit_start, uint32_t cc,
+                                const uint8_t* payload, size_t length,
+                                bool random_access) {
+  std::vector<uint8_t> packet = {
+      0x47, static_cast<uint8_t>((unit_start ? 0x40 : 0x00) | (pid >> 8)),
+      static_cast<uint8_t>(pid & 0xff), static_cast<uint8_t>(0x10 | cc)};
+  if (length < 184 || random_access) {
+    packet[3] |= 0x20;
+    size_t adaptation_field_length = 183 - length;
+    packet.push_back(static_cast<uint8_t>(adaptation_field_length));
+    if (adaptation_field_length > 0) {
+      packet.push_back(random_access ? 0x40 : 0x00);
+      packet.insert(packet.end(), adaptation_field_length - 1, 0xff);
+    }
+  }
+  packet.insert(packet.end(), payload, payload + length);
+  return packet;
+}
+
+// A PSI packet (pointer_field, section, and CRC_32).
+std::vector<uint8_t> MakeSectionPacket(uint32_t pid,
+                                       std::vector<uint8_t> section) {
+  uint32_t crc = Crc32(section);
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    section.push_back(static_cast<uint8_t>(crc >> shift));
+  }
+  section.insert(section.begin(), 0x00);
+  section.resize(184, 0xff);
+  return MakePacket(pid, true, 0, section.data(), section.size(), false);
+}
+
+// PAT (program 1 in PID 0x100), and PMT (H.265 stream in PID 0x101).
+std::vector<uint8_t> MakePsi() {
+  std::vector<uint8_t> ts = MakeSectionPacket(
+      0x0000, {0x00, 0xb0, 0x0d, 0x00, 0x01, 0xc1, 0x00, 0x00, 0x00, 0x01,
+               0xe1, 0x00});
+  std::vector<uint8_t> pmt = MakeSectionPacket(
+      0x0100, {0x02, 0xb0, 0x12, 0x00, 0x01, 0xc1, 0x00, 0x00, 0xe1,
+               0x01, 0xf0, 0x00, 0x24, 0xe1, 0x01, 0xf0, 0x00});
+  ts.insert(ts.end(), pmt.begin(), pmt.end());
+  return ts;
+}
+
+void PutTimestamp(std::vector<uint8_t>* pes, uint32_t prefix,
+                  uint64_t timestamp) {
+  pes->push_back(static_cast<uint8_t>((prefix << 4) |
+                                      ((timestamp >> 29) & 0x0e) | 0x01));
+  pes->push_back(static_cast<uint8_t>(timestamp >> 22));
+  pes->push_back(static_cast<uint8_t>(((timestamp >> 14) & 0xfe) | 0x01));
+  pes->push_back(static_cast<uint8_t>(timestamp >> 7));
+  pes->push_back(static_cast<uint8_t>(((timestamp << 1) & 0xfe) | 0x01));
+}
+
+// Packetize a PES packet with a PTS, in PID 0x101.
+std::vector<uint8_t> MakePes(const std::vector<uint8_t>& data, uint64_t pts,
+                             bool bounded, uint32_t* cc) {
+  std::vector<uint8_t> pes = {0x00, 0x00, 0x01, 0xe0, 0x00, 0x00,
+                              0x80, 0x80, 0x05};
+  PutTimestamp(&pes, 0x2, pts);
+  pes.insert(pes.end(), data.begin(), data.end());
+  if (bounded) {
+    size_t pes_packet_length = pes.size() - 6;
+    pes[4] = static_cast<uint8_t>(pes_packet_length >> 8);
+    pes[5] = static_cast<uint8_t>(pes_packet_length);
+  }
+  std::vector<uint8_t> ts;
+  for (size_t offset = 0; offset < pes.size();) {
+    // leave room for the random_access_indicator in the first packet
+    size_t length = std::min<size_t>((offset == 0) ? 182 : 184,
+                                     pes.size() - offset);
+    std::vector<uint8_t> packet =
+        MakePacket(0x101, offset == 0, *cc, pes.data() + offset, length,
+                   offset == 0);
+    *cc = (*cc + 1) & 0x0f;
+    offset += length;
+    ts.insert(ts.end(), packet.begin(), packet.end());
+  }
+  return ts;
+}
+
+// An access unit of `size` bytes (AUD, and a filler data NAL unit).
+std::vector<uint8_t> MakeAccessUnit(size_t size, uint8_t value) {
+  std::vector<uint8_t> data = {0x00, 0x00, 0x00, 0x01, 0x46, 0x01,
+                               0x50, 0x00, 0x00, 0x00, 0x01, 0x4c, 0x01};
+  data.resize(size, value);
+  return data;
+}
+}  // namespace
+
+class H265TsDemuxerTest : public ::testing::Test {
+ public:
+  H265TsDemuxerTest() {}
+  ~H265TsDemuxerTest() override {}
+};
+
+TEST_F(H265TsDemuxerTest, TestTs) {
+  // PAT, PMT, and an unbounded PES packet with an access unit
+  // fuzzer::conv: data
+  const uint8_t buffer[] = {
+      // PAT (PID 0): program_number: 1, program_map_PID: 0x100
+      0x47, 0x40, 0x00, 0x10, 0x00, 0x00, 0xb0, 0x0d, 0x00, 0x01, 0xc1, 0x00,
+      0x00, 0x00, 0x01, 0xe1, 0x00, 0xe8, 0xf9, 0x5e, 0x7d, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      // PMT (PID 0x100): PCR_PID: 0x101, stream_type: 0x24,
+      // elementary_PID: 0x101
+      0x47, 0x41, 0x00, 0x10, 0x00, 0x02, 0xb0, 0x12, 0x00, 0x01, 0xc1, 0x00,
+      0x00, 0xe1, 0x01, 0xf0, 0x00, 0x24, 0xe1, 0x01, 0xf0, 0x00, 0x75, 0x79,
+      0x1e, 0xaa, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      // PES (PID 0x101): random_access_indicator: 1 (adaptation field
+      // stuffing), stream_id: 0xe0, PTS: 180000, DTS: 177000, and an
+      // access unit (AUD, end of sequence)
+      0x47, 0x41, 0x01, 0x30, 0x97, 0x40, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0x00, 0x00, 0x01, 0xe0, 0x00, 0x00, 0x80, 0xc0, 0x0a, 0x31, 0x00, 0x0b,
+      0x7e, 0x41, 0x11, 0x00, 0x0b, 0x66, 0xd1, 0x00, 0x00, 0x00, 0x01, 0x46,
+      0x01, 0x50, 0x00, 0x00, 0x00, 0x01, 0x48, 0x01};
+  // fuzzer::conv: begin
+  std::vector<std::pair<H265TsDemuxer::AccessUnit, std::vector<uint8_t>>>
+      access_units;
+  H265TsDemuxer demuxer(
+      {},
+      [](const H265TsDemuxer::AccessUnit& access_unit, void* opaque) {
+        using AccessUnitsT = std::vector<
+            std::pair<H265TsDemuxer::AccessUnit, std::vector<uint8_t>>>;
+        static_cast<AccessUnitsT*>(opaque)->emplace_back(
+            access_unit,
+            std::vector<uint8_t>(access_unit.data,
+                                 access_unit.data + access_unit.length));
+      },
+      &access_units);
+  demuxer.AddData(buffer, arraysize(buffer));
+  demuxer.Flush();
+  // fuzzer::conv: end
+
+  EXPECT_THAT(demuxer.GetPids(), ::testing::ElementsAre(0x101));
+  ASSERT_EQ(1, access_units.size());
+  const auto& access_unit = access_units[0].first;
+  EXPECT_EQ(0x101, access_unit.pid);
+  EXPECT_TRUE(access_unit.has_pts);
+  EXPECT_EQ(180000, access_unit.pts);
+  EXPECT_EQ(177000, access_unit.dts);
+  EXPECT_TRUE(access_unit.random_access);
+  EXPECT_FALSE(access_unit.after_loss);
+  EXPECT_THAT(access_units[0].second,
+              ::testing::ElementsAreArray({0x00, 0x00, 0x00, 0x01, 0x46, 0x01,
+                                           0x50, 0x00, 0x00, 0x00, 0x01, 0x48,
+                                           0x01}));
+
+  const auto& stats = demuxer.GetStats();
+  EXPECT_EQ(3, stats.packets);
+  EXPECT_EQ(0, stats.bytes_skipped);
+  EXPECT_EQ(0, stats.packets_invalid);
+  EXPECT_EQ(0, stats.continuity_errors);
+  EXPECT_EQ(0, stats.sections_invalid);
+  EXPECT_EQ(1, stats.access_units);
+
+  // the access units go directly into the Annex B parser
+  auto bitstream = H265BitstreamParser::ParseBitstream(
+      access_units[0].second.data(), access_units[0].second.size(), {});
+  ASSERT_TRUE(bitstream != nullptr);
+  EXPECT_EQ(2, bitstream->nal_units.size());
+}
+
+TEST_F(H265TsDemuxerTest, TestChunks) {
+  // garbage, PSI, a bounded PES packet spanning 3 TS packets, and an
+  // unbounded one
+  std::vector<uint8_t> ts = {0x00, 0x47, 0x12};
+  std::vector<uint8_t> psi = MakePsi();
+  ts.insert(ts.end(), psi.begin(), psi.end());
+  uint32_t cc = 0;
+  std::vector<uint8_t> au0 = MakeAccessUnit(400, 0xaa);
+  std::vector<uint8_t> pes0 = MakePes(au0, 3000, true, &cc);
+  ts.insert(ts.end(), pes0.begin(), pes0.end());
+  std::vector<uint8_t> au1 = MakeAccessUnit(100, 0xbb);
+  std::vector<uint8_t> pes1 = MakePes(au1, 6000, false, &cc);
+  ts.insert(ts.end(), pes1.begin(), pes1.end());
+
+  // feed the stream in small chunks (after the PSI)
+  AccessUnits access_units;
+  H265TsDemuxer demuxer({}, StoreAccessUnit, &access_units);
+  demuxer.AddData(ts.data(), 3 + psi.size());
+  for (size_t offset = 3 + psi.size(); offset < ts.size(); offset += 7) {
+    demuxer.AddData(ts.data() + offset,
+                    std::min<size_t>(7, ts.size() - offset));
+  }
+  // the bounded PES packet is emitted as soon as it is complete
+  ASSERT_EQ(1, access_units.size());
+  EXPECT_EQ(3000, access_units[0].first.pts);
+  EXPECT_EQ(3000, access_units[0].first.dts);
+  EXPECT_EQ(au0, access_units[0].second);
+
+  // the unbounded one at the end of the stream
+  demuxer.Flush();
+  ASSERT_EQ(2, access_units.size());
+  EXPECT_EQ(6000, access_units[1].first.pts);
+  EXPECT_EQ(au1, access_units[1].second);
+
+  const auto& stats = demuxer.GetStats();
+  EXPECT_EQ(2 + 3 + 1, stats.packets);
+  // the second garbage byte is a fake sync byte
+  EXPECT_EQ(3, stats.bytes_skipped);
+  EXPECT_EQ(2, stats.access_units);
+}
+
+TEST_F(H265TsDemuxerTest, TestContinuityError) {
+  std::vector<uint8_t> ts = MakePsi();
+  uint32_t cc = 0;
+  std::vector<uint8_t> pes0 = MakePes(MakeAccessUnit(400, 0xaa), 3000, false,
+                                      &cc);
+  // lose the second packet of the first PES packet
+  ts.insert(ts.end(), pes0.begin(), pes0.begin() + 188);
+  ts.insert(ts.end(), pes0.begin() + 2 * 188, pes0.end());
+  std::vector<uint8_t> au1 = MakeAccessUnit(100, 0xbb);
+  std::vector<uint8_t> pes1 = MakePes(au1, 6000, false, &cc);
+  ts.insert(ts.end(), pes1.begin(), pes1.end());
+  // a duplicate packet is not a loss
+  ts.insert(ts.end(), pes1.begin(), pes1.end());
+  std::vector<uint8_t> au2 = MakeAccessUnit(50, 0xcc);
+  std::vector<uint8_t> pes2 = MakePes(au2, 9000, false, &cc);
+  ts.insert(ts.end(), pes2.begin(), pes2.end());
+
+  AccessUnits access_units;
+  H265TsDemuxer demuxer({}, StoreAccessUnit, &access_units);
+  demuxer.AddData(ts.data(), ts.size());
+  demuxer.Flush();
+
+  // the first access unit is dropped, and the next one flagged
+  ASSERT_EQ(2, access_units.size());
+  EXPECT_EQ(6000, access_units[0].first.pts);
+  EXPECT_TRUE(access_units[0].first.after_loss);
+  EXPECT_EQ(au1, access_units[0].second);
+  EXPECT_EQ(9000, access_units[1].first.pts);
+  EXPECT_FALSE(access_units[1].first.after_loss);
+  EXPECT_EQ(au2, access_units[1].second);
+
+  const auto& stats = demuxer.GetStats();
+  EXPECT_EQ(1, stats.continuity_errors);
+  EXPECT_EQ(1, stats.access_units_dropped);
+  EXPECT_EQ(2, stats.access_units);
+}
+
+TEST_F(H265TsDemuxerTest, TestInvalidPsi) {
+  // PAT with a CRC error: the PMT (and the H.265 stream) are not found
+  std::vector<uint8_t> ts = MakePsi();
+  ts[5 + 4] ^= 0x01;
+  uint32_t cc = 0;
+  std::vector<uint8_t> pes = MakePes(MakeAccessUnit(100, 0xaa), 3000, true,
+                                     &cc);
+  ts.insert(ts.end(), pes.begin(), pes.end());
+
+  AccessUnits access_units;
+  H265TsDemuxer demuxer({}, StoreAccessUnit, &access_units);
+  demuxer.AddData(ts.data(), ts.size());
+  demuxer.Flush();
+
+  EXPECT_TRUE(demuxer.GetPids().empty());
+  EXPECT_TRUE(access_units.empty());
+  EXPECT_EQ(1, demuxer.GetStats().sections_invalid);
+}
+
+}  // namespace h265nal
@@ -23,6 +23,7 @@
 
 #include <cerrno>
 #include <climits>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -32,6 +33,15 @@
 #include "h265_bitstream_parser.h"
 #include "h265_common.h"
 #include "h265_configuration_box_parser.h"
+#include "h265_mkv_reader.h"
+#include "h265_mp4_reader.h"
+#include "h265_nal_filter.h"
+#ifdef RTP_DEFINE
+#include "h265_pcap_reader.h"
+#include "h265_rtp_parser.h"
+#endif  // RTP_DEFINE
+#include "h265_sub_bitstream_extractor.h"
+#include "h265_ts_demuxer.h"
 #include "h265_utils.h"
 #include "rtc_common.h"
 
@@ -52,6 +62,15 @@ typedef struct arg_options {
   int nalu_length_bytes;
   int frames_per_second;
   char* hvcc_file;
+  char* mp4_file;
+  char* mkv_file;
+  char* ts_file;
+  char* pcap_file;
+  int pcap_port;
+  int64_t pcap_ssrc;
+  int pcap_payload_type;
+  int extract_tid;
+  char* filter;
   char* infile;
   char* outfile;
 } arg_options;
@@ -70,6 +89,15 @@ arg_options DEFAULT_OPTIONS{
     .nalu_length_bytes = -1,
     .frames_per_second = 30,
     .hvcc_file = nullptr,
+    .mp4_file = nullptr,
+    .mkv_file = nullptr,
+    .ts_file = nullptr,
+    .pcap_file = nullptr,
+    .pcap_port = 0,
+    .pcap_ssrc = -1,
+    .pcap_payload_type = -1,
+    .extract_tid = -1,
+    .filter = nullptr,
     .infile = nullptr,
     .outfile = nullptr,
 };
@@ -84,6 +112,39 @@ void usage(char* name) {
   fprintf(stderr,
           "\t--hvcc-file <infile>:\t\thvcC file to parse bitstream state from "
           "[default: none]\n");
+  fprintf(stderr,
+          "\t--mp4-file <infile>:\t\tmp4 (or fragmented mp4) file to parse "
+          "[default: none]\n");
+  fprintf(stderr,
+          "\t--mkv-file <infile>:\t\tMatroska/WebM file to parse "
+          "[default: none]\n");
+  fprintf(stderr,
+          "\t--ts-file <infile>:\t\tMPEG-TS file to parse (\"-\" for stdin) "
+          "[default: none]\n");
+#ifdef RTP_DEFINE
+  fprintf(stderr,
+          "\t--pcap-file <infile>:\t\tpcap/pcapng capture to parse RTP "
+          "packets from [default: none]\n");
+  fprintf(stderr,
+          "\t--pcap-port <port>:\tOnly use UDP packets from/to this port "
+          "[default: any]\n");
+  fprintf(stderr,
+          "\t--pcap-ssrc <ssrc>:\tOnly use RTP packets with this SSRC "
+          "[default: any]\n");
+  fprintf(stderr,
+          "\t--pcap-payload-type <pt>:\tOnly use RTP packets with this "
+          "payload type [default: any]\n");
+#endif  // RTP_DEFINE
+  fprintf(stderr,
+          "\t--extract-tid <tid>:\tWrite the sub-bitstream of the infile "
+          "with the temporal sub-layers up to this TemporalId to the "
+          "output, instead of parsing it [default: none]\n");
+  fprintf(stderr,
+          "\t--filter <stages>:\tWrite the infile through a NAL unit filter "
+          "to the output, instead of parsing it. Stages (comma-separated, "
+          "run in the given order): drop-fd, drop-aud, "
+          "drop-nal=<nal_unit_type>, drop-sei=<payload_type>, irap-only, "
+          "insert-ps [default: none]\n");
   fprintf(stderr, "\t-o <output>:\t\tH265 parsing output [default: stdout]\n");
   fprintf(stderr, "\t--dump-all\t\tDump all the parsed contents\n");
   fprintf(stderr, "\t--dump-length\t\tDump only the length information\n");
@@ -149,6 +210,15 @@ enum {
   ADD_CONTENTS_FLAG_OPTION,
   NO_ADD_CONTENTS_FLAG_OPTION,
   HVCC_FILE_OPTION,
+  MP4_FILE_OPTION,
+  MKV_FILE_OPTION,
+  TS_FILE_OPTION,
+  PCAP_FILE_OPTION,
+  PCAP_PORT_OPTION,
+  PCAP_SSRC_OPTION,
+  PCAP_PAYLOAD_TYPE_OPTION,
+  EXTRACT_TID_OPTION,
+  FILTER_OPTION,
   NALU_LENGTH_BYTES_OPTION,
   FRAMES_PER_SECOND_OPTION,
   VERSION_OPTION,
@@ -190,6 +260,18 @@ int parse_args(int argc, char** argv, arg_options* options) {
       {"add-contents", no_argument, NULL, ADD_CONTENTS_FLAG_OPTION},
       {"no-add-contents", no_argument, NULL, NO_ADD_CONTENTS_FLAG_OPTION},
       {"hvcc-file", required_argument, NULL, HVCC_FILE_OPTION},
+      {"mp4-file", required_argument, NULL, MP4_FILE_OPTION},
+      {"mkv-file", required_argument, NULL, MKV_FILE_OPTION},
+      {"ts-file", required_argument, NULL, TS_FILE_OPTION},
+#ifdef RTP_DEFINE
+      // pcap input is only available in RTP builds
+      {"pcap-file", required_argument, NULL, PCAP_FILE_OPTION},
+      {"pcap-port", required_argument, NULL, PCAP_PORT_OPTION},
+      {"pcap-ssrc", required_argument, NULL, PCAP_SSRC_OPTION},
+      {"pcap-payload-type", required_argument, NULL, PCAP_PAYLOAD_TYPE_OPTION},
+#endif  // RTP_DEFINE
+      {"extract-tid", required_argument, NULL, EXTRACT_TID_OPTION},
+      {"filter", required_argument, NULL, FILTER_OPTION},
       {"nalu-length-bytes", required_argument, NULL, NALU_LENGTH_BYTES_OPTION},
       {"frames-per-second", required_argument, NULL, FRAMES_PER_SECOND_OPTION},
       {"version", no_argument, NULL, VERSION_OPTION},
@@ -295,6 +377,74 @@ int parse_args(int argc, char** argv, arg_options* options) {
         options->hvcc_file = optarg;
         break;
 
+      case MP4_FILE_OPTION:
+        options->mp4_file = optarg;
+        break;
+
+      case MKV_FILE_OPTION:
+        options->mkv_file = optarg;
+        break;
+
+      case TS_FILE_OPTION:
+        options->ts_file = optarg;
+        break;
+
+#ifdef RTP_DEFINE
+      case PCAP_FILE_OPTION:
+        options->pcap_file = optarg;
+        break;
+
+      case PCAP_PORT_OPTION: {
+        char* end;
+        errno = 0;
+        long val = strtol(optarg, &end, 10);
+        if (errno != 0 || *end != '\0' || val < 0 || val > 65535) {
+          fprintf(stderr, "error: invalid pcap_port: %s\n", optarg);
+          return -1;
+        }
+        options->pcap_port = static_cast<int>(val);
+      } break;
+
+      case PCAP_SSRC_OPTION: {
+        char* end;
+        errno = 0;
+        // accept hex (0x...) values
+        long long val = strtoll(optarg, &end, 0);
+        if (errno != 0 || *end != '\0' || val < 0 || val > UINT32_MAX) {
+          fprintf(stderr, "error: invalid pcap_ssrc: %s\n", optarg);
+          return -1;
+        }
+        options->pcap_ssrc = static_cast<int64_t>(val);
+      } break;
+
+      case PCAP_PAYLOAD_TYPE_OPTION: {
+        char* end;
+        errno = 0;
+        long val = strtol(optarg, &end, 10);
+        if (errno != 0 || *end != '\0' || val < 0 || val > 127) {
+          fprintf(stderr, "error: invalid pcap_payload_type: %s\n", optarg);
+          return -1;
+        }
+        options->pcap_payload_type = static_cast<int>(val);
+      } break;
+#endif  // RTP_DEFINE
+
+      case EXTRACT_TID_OPTION: {
+        char* end;
+        errno = 0;
+        long val = strtol(optarg, &end, 10);
+        if (errno != 0 || *end != '\0' || val < 0 ||
+            val > h265nal::H265SubBitstreamExtractor::kMaxTemporalId) {
+          fprintf(stderr, "error: invalid extract_tid: %s\n", optarg);
+          return -1;
+        }
+        options->extract_tid = static_cast<int>(val);
+      } break;
+
+      case FILTER_OPTION:
+        options->filter = optarg;
+        break;
+
       case NALU_LENGTH_BYTES_OPTION: {
         char* end;
         errno = 0;
@@ -334,14 +484,278 @@ int parse_args(int argc, char** argv, arg_options* options) {
   }
 
   // check there is at least a valid input file to parser
-  if (options->infile == nullptr && options->hvcc_file == nullptr) {
+  if (options->infile == nullptr && options->hvcc_file == nullptr &&
+      options->mp4_file == nullptr && options->mkv_file == nullptr &&
+      options->ts_file == nullptr &&
+      options->pcap_file == nullptr) {
     fprintf(stderr, "error: need at least one input file to parse\n");
     usage(argv[0]);
   }
 
+  // extraction and filtering work on an Annex B infile
+  if ((options->extract_tid >= 0 || options->filter != nullptr) &&
+      (options->infile == nullptr || options->nalu_length_bytes >= 0)) {
+    fprintf(stderr,
+            "error: --extract-tid and --filter need an Annex B infile\n");
+    usage(argv[0]);
+  }
+  if (options->extract_tid >= 0 && options->filter != nullptr) {
+    fprintf(stderr, "error: cannot use --extract-tid and --filter together\n");
+    usage(argv[0]);
+  }
+
   return 0;
 }
 
+#ifdef FDUMP_DEFINE
+struct Mp4DumpContext {
+  FILE* outfp;
+  int indent_level;
+  h265nal::ParsingOptions parsing_options;
+  h265nal::H265BitstreamParserState* bitstream_parser_state;
+};
+
+void DumpMp4Sample(const h265nal::H265Mp4Reader::Sample& sample,
+                   void* opaque) {
+  auto* context = static_cast<Mp4DumpContext*>(opaque);
+  auto bitstream = h265nal::H265BitstreamParser::ParseBitstreamNALULength(
+      sample.data, sample.length, sample.length_size,
+      context->bitstream_parser_state, context->parsing_options);
+  if (bitstream == nullptr) {
+    return;
+  }
+  for (auto& nal_unit : bitstream->nal_units) {
+    fprintf(context->outfp,
+            "track_id: %u sample: %llu decode_time: %llu "
+            "composition_time: %lld timescale: %u sync: %i ",
+            sample.track_id, static_cast<unsigned long long>(sample.index),
+            static_cast<unsigned long long>(sample.decode_time),
+            static_cast<long long>(sample.composition_time), sample.timescale,
+            sample.sync ? 1 : 0);
+    nal_unit->fdump(context->outfp, context->indent_level,
+                    context->parsing_options);
+    fprintf(context->outfp, "\n");
+  }
+}
+
+struct MkvDumpContext {
+  FILE* outfp;
+  int indent_level;
+  h265nal::ParsingOptions parsing_options;
+  h265nal::H265BitstreamParserState* bitstream_parser_state;
+};
+
+void DumpMkvBlock(const h265nal::H265MkvReader::Block& block, void* opaque) {
+  auto* context = static_cast<MkvDumpContext*>(opaque);
+  auto bitstream = h265nal::H265BitstreamParser::ParseBitstreamNALULength(
+      block.data, block.length, block.length_size,
+      context->bitstream_parser_state, context->parsing_options);
+  if (bitstream == nullptr) {
+    return;
+  }
+  for (auto& nal_unit : bitstream->nal_units) {
+    fprintf(context->outfp,
+            "track_number: %llu timecode: %lld timestamp_ns: %lld "
+            "keyframe: %i ",
+            static_cast<unsigned long long>(block.track_number),
+            static_cast<long long>(block.timecode),
+            static_cast<long long>(block.timestamp_ns),
+            block.keyframe ? 1 : 0);
+    nal_unit->fdump(context->outfp, context->indent_level,
+                    context->parsing_options);
+    fprintf(context->outfp, "\n");
+  }
+}
+
+struct TsDumpContext {
+  FILE* outfp;
+  int indent_level;
+  h265nal::ParsingOptions parsing_options;
+  h265nal::H265BitstreamParserState* bitstream_parser_state;
+};
+
+void DumpTsAccessUnit(const h265nal::H265TsDemuxer::AccessUnit& access_unit,
+                      void* opaque) {
+  auto* context = static_cast<TsDumpContext*>(opaque);
+  auto bitstream = h265nal::H265BitstreamParser::ParseBitstream(
+      access_unit.data, access_unit.length, context->bitstream_parser_state,
+      context->parsing_options);
+  if (bitstream == nullptr) {
+    return;
+  }
+  for (auto& nal_unit : bitstream->nal_units) {
+    fprintf(context->outfp,
+            "pid: 0x%x pts: %llu dts: %llu random_access: %i after_loss: %i ",
+            access_unit.pid, static_cast<unsigned long long>(access_unit.pts),
+            static_cast<unsigned long long>(access_unit.dts),
+            access_unit.random_access ? 1 : 0, access_unit.after_loss ? 1 : 0);
+    nal_unit->fdump(context->outfp, context->indent_level,
+                    context->parsing_options);
+    fprintf(context->outfp, "\n");
+  }
+}
+#endif  // FDUMP_DEFINE
+
+#if defined(RTP_DEFINE) && defined(FDUMP_DEFINE)
+struct PcapDumpContext {
+  FILE* outfp;
+  int indent_level;
+  h265nal::ParsingOptions parsing_options;
+  h265nal::H265BitstreamParserState* bitstream_parser_state;
+};
+
+void DumpPcapPacket(const h265nal::H265PcapReader::Packet& packet,
+                    void* opaque) {
+  auto* context = static_cast<PcapDumpContext*>(opaque);
+  fprintf(context->outfp,
+          "timestamp_ns: %lld ssrc: 0x%08x sequence_number: %u "
+          "rtp_timestamp: %u marker: %u ",
+          static_cast<long long>(packet.timestamp_ns), packet.rtp_header.ssrc,
+          packet.rtp_header.sequence_number, packet.rtp_header.timestamp,
+          packet.rtp_header.marker);
+  auto rtp = h265nal::H265RtpParser::ParseRtp(packet.payload,
+                                              packet.payload_length,
+                                              context->bitstream_parser_state);
+  if (rtp == nullptr) {
+    fprintf(context->outfp, "error: cannot parse RTP payload\n");
+    return;
+  }
+  rtp->fdump(context->outfp, context->indent_level, context->parsing_options);
+  fprintf(context->outfp, "\n");
+}
+#endif  // RTP_DEFINE && FDUMP_DEFINE
+
+// Write a span list to the outfile.
+int write_spans(const std::vector<h265nal::BufferSegment>& spans,
+                const arg_options& options) {
+  FILE* outfp = stdout;
+  if (options.outfile != nullptr &&
+      !(strlen(options.outfile) == 1 && options.outfile[0] == '-')) {
+    outfp = fopen(options.outfile, "wb");
+    if (outfp == nullptr) {
+      fprintf(stderr, "Could not open output file: \"%s\"\n", options.outfile);
+      return -1;
+    }
+  }
+  int ret = 0;
+  for (const auto& span : spans) {
+    if (fwrite(span.data, 1, span.length, outfp) != span.length) {
+      fprintf(stderr, "error: cannot write the output\n");
+      ret = -1;
+      break;
+    }
+  }
+  if (outfp != stdout) {
+    fclose(outfp);
+  }
+  return ret;
+}
+
+// Write the temporal sub-bitstream of an Annex B buffer to the outfile.
+int extract_sub_bitstream(const uint8_t* data, size_t length,
+                          const arg_options& options) {
+  h265nal::H265SubBitstreamExtractor::Options extractor_options;
+  extractor_options.target_temporal_id =
+      static_cast<uint32_t>(options.extract_tid);
+  h265nal::H265SubBitstreamExtractor extractor(extractor_options);
+  std::vector<h265nal::BufferSegment> spans;
+  extractor.Extract(data, length, &spans);
+  if (options.debug > 0) {
+    const auto& stats = extractor.GetStats();
+    fprintf(stderr, "nal_units: %llu nal_units_removed: %llu\n",
+            static_cast<unsigned long long>(stats.nal_units),
+            static_cast<unsigned long long>(stats.nal_units_removed));
+  }
+  return write_spans(spans, options);
+}
+
+// Write an Annex B buffer through a NAL unit filter to the outfile. The
+// stages are set up from the comma-separated `--filter` list, in order
+// (consecutive drop-fd/drop-aud/drop-nal, or drop-sei, entries share a
+// stage).
+int filter_bitstream(const uint8_t* data, size_t length,
+                     const arg_options& options) {
+  h265nal::H265NalFilter filter;
+  // the drop stage being set up, and its values
+  enum { kNoStage, kDropNalStage, kDropSeiStage } pending_stage = kNoStage;
+  std::vector<uint32_t> pending_values;
+  auto add_pending_stage = [&]() {
+    if (pending_stage == kDropNalStage) {
+      filter.AddDropNalUnitTypes(pending_values);
+    } else if (pending_stage == kDropSeiStage) {
+      filter.AddDropSeiPayloadTypes(pending_values);
+    }
+    pending_stage = kNoStage;
+    pending_values.clear();
+  };
+  auto set_pending_stage = [&](decltype(pending_stage) stage) {
+    if (pending_stage != stage) {
+      add_pending_stage();
+      pending_stage = stage;
+    }
+  };
+
+  std::string stages(options.filter);
+  size_t start = 0;
+  while (start <= stages.size()) {
+    size_t end = stages.find(',', start);
+    if (end == std::string::npos) {
+      end = stages.size();
+    }
+    std::string stage = stages.substr(start, end - start);
+    start = end + 1;
+    size_t equal = stage.find('=');
+    std::string name = stage.substr(0, equal);
+    long value = -1;
+    if (equal != std::string::npos) {
+      char* value_end;
+      errno = 0;
+      value = strtol(stage.c_str() + equal + 1, &value_end, 0);
+      if (errno != 0 || *value_end != '\0' || value < 0 || value > INT_MAX) {
+        value = -1;
+      }
+    }
+    if (name == "drop-fd" && equal == std::string::npos) {
+      set_pending_stage(kDropNalStage);
+      pending_values.push_back(h265nal::NalUnitType::FD_NUT);
+    } else if (name == "drop-aud" && equal == std::string::npos) {
+      set_pending_stage(kDropNalStage);
+      pending_values.push_back(h265nal::NalUnitType::AUD_NUT);
+    } else if (name == "drop-nal" && value >= 0 && value < 64) {
+      set_pending_stage(kDropNalStage);
+      pending_values.push_back(static_cast<uint32_t>(value));
+    } else if (name == "drop-sei" && value >= 0) {
+      set_pending_stage(kDropSeiStage);
+      pending_values.push_back(static_cast<uint32_t>(value));
+    } else if (name == "irap-only" && equal == std::string::npos) {
+      add_pending_stage();
+      filter.AddKeepIrapOnly();
+    } else if (name == "insert-ps" && equal == std::string::npos) {
+      add_pending_stage();
+      filter.AddInsertParameterSets();
+    } else {
+      fprintf(stderr, "error: invalid filter stage: \"%s\"\n",
+              stage.c_str());
+      return -1;
+    }
+  }
+  add_pending_stage();
+
+  std::vector<h265nal::BufferSegment> spans;
+  filter.Filter(data, length, &spans);
+  if (options.debug > 0) {
+    const auto& stats = filter.GetStats();
+    fprintf(stderr,
+            "nal_units: %llu nal_units_dropped: %llu nal_units_rewritten: "
+            "%llu nal_units_inserted: %llu\n",
+            static_cast<unsigned long long>(stats.nal_units),
+            static_cast<unsigned long long>(stats.nal_units_dropped),
+            static_cast<unsigned long long>(stats.nal_units_rewritten),
+            static_cast<unsigned long long>(stats.nal_units_inserted));
+  }
+  return write_spans(spans, options);
+}
+
 inline std::string opt_value(int value, bool has_value) {
   return has_value ? std::to_string(value) : std::string{};
 }
@@ -422,6 +836,19 @@ int main(int argc, char** argv) {
   std::vector<uint8_t> buffer;
   std::unique_ptr<h265nal::H265BitstreamParser::BitstreamState> bitstream;
   if (options.infile != nullptr) {
+    if (options.extract_tid >= 0 || options.filter != nullptr) {
+      // 3.1. map infile, and write the sub-bitstream or the filtered
+      // bitstream (no parsing)
+      h265nal::H265MappedFile infile;
+      if (!infile.Open(options.infile)) {
+        return -1;
+      }
+      if (options.extract_tid >= 0) {
+        return extract_sub_bitstream(infile.GetData(), infile.GetLength(),
+                                     options);
+      }
+      return filter_bitstream(infile.GetData(), infile.GetLength(), options);
+    }
     // 3.1. read infile into buffer
     if (h265nal::H265Utils::ReadFile(options.infile, buffer) < 0) {
       return -1;
@@ -466,6 +893,104 @@ int main(int argc, char** argv) {
     fprintf(outfp, "\n");
   }
 
+  if (options.mp4_file != nullptr) {
+    // 4.3. parse and dump the hvcC and the samples of each H.265 track (the
+    // file is mapped, not read into memory)
+    h265nal::H265Mp4Reader mp4_reader({});
+    if (!mp4_reader.Open(options.mp4_file)) {
+      fprintf(stderr, "error: cannot read mp4 file: \"%s\"\n",
+              options.mp4_file);
+      if (must_close_fp) {
+        fclose(outfp);
+      }
+      return -1;
+    }
+    for (const auto& track : mp4_reader.GetTracks()) {
+      auto mp4_configuration_box =
+          h265nal::H265ConfigurationBoxParser::ParseConfigurationBox(
+              track.hvcc, track.hvcc_length, &bitstream_parser_state,
+              parsing_options);
+      if (mp4_configuration_box != nullptr) {
+        fprintf(outfp, "track_id: %u ", track.track_id);
+        mp4_configuration_box->fdump(outfp, indent_level, parsing_options);
+        fprintf(outfp, "\n");
+      }
+    }
+    Mp4DumpContext mp4_context = {outfp, indent_level, parsing_options,
+                                  &bitstream_parser_state};
+    mp4_reader.ReadSamples(DumpMp4Sample, &mp4_context);
+  }
+
+  if (options.mkv_file != nullptr) {
+    // 4.4. parse and dump the CodecPrivate (hvcC) and the blocks of each
+    // H.265 track (the file is mapped, not read into memory)
+    h265nal::H265MkvReader mkv_reader({});
+    if (!mkv_reader.Open(options.mkv_file)) {
+      fprintf(stderr, "error: cannot read Matroska file: \"%s\"\n",
+              options.mkv_file);
+      if (must_close_fp) {
+        fclose(outfp);
+      }
+      return -1;
+    }
+    for (const auto& track : mkv_reader.GetTracks()) {
+      auto mkv_configuration_box =
+          h265nal::H265ConfigurationBoxParser::ParseConfigurationBox(
+              track.codec_private, track.codec_private_length,
+              &bitstream_parser_state, parsing_options);
+      if (mkv_configuration_box != nullptr) {
+        fprintf(outfp, "track_number: %llu ",
+                static_cast<unsigned long long>(track.track_number));
+        mkv_configuration_box->fdump(outfp, indent_level, parsing_options);
+        fprintf(outfp, "\n");
+      }
+    }
+    MkvDumpContext mkv_context = {outfp, indent_level, parsing_options,
+                                  &bitstream_parser_state};
+    mkv_reader.ReadBlocks(DumpMkvBlock, &mkv_context);
+  }
+
+  if (options.ts_file != nullptr) {
+    // 4.5. demux, parse, and dump the access units of the H.265 streams
+    // (the file is mapped, not read into memory)
+    TsDumpContext ts_context = {outfp, indent_level, parsing_options,
+                                &bitstream_parser_state};
+    h265nal::H265TsDemuxer ts_demuxer({}, DumpTsAccessUnit, &ts_context);
+    if (!ts_demuxer.ProcessFile(options.ts_file)) {
+      fprintf(stderr, "error: cannot read MPEG-TS file: \"%s\"\n",
+              options.ts_file);
+      if (must_close_fp) {
+        fclose(outfp);
+      }
+      return -1;
+    }
+  }
+
+#ifdef RTP_DEFINE
+  if (options.pcap_file != nullptr) {
+    // 4.6. parse and dump the RTP packets in the capture (in capture order)
+    h265nal::H265PcapReader::Options pcap_options;
+    pcap_options.port = static_cast<uint16_t>(options.pcap_port);
+    pcap_options.filter_ssrc = (options.pcap_ssrc >= 0);
+    pcap_options.ssrc = static_cast<uint32_t>(options.pcap_ssrc);
+    pcap_options.filter_payload_type = (options.pcap_payload_type >= 0);
+    pcap_options.payload_type =
+        static_cast<uint32_t>(options.pcap_payload_type);
+    h265nal::H265PcapReader pcap_reader(pcap_options);
+    PcapDumpContext pcap_context = {outfp, indent_level, parsing_options,
+                                    &bitstream_parser_state};
+    if (!pcap_reader.Open(options.pcap_file) ||
+        !pcap_reader.ReadPackets(DumpPcapPacket, &pcap_context)) {
+      fprintf(stderr, "error: cannot read capture file: \"%s\"\n",
+              options.pcap_file);
+      if (must_close_fp) {
+        fclose(outfp);
+      }
+      return -1;
+    }
+  }
+#endif  // RTP_DEFINE
+
   if (options.infile != nullptr) {
     if (options.dumpmode == dump_length) {
       // add a CSV header
@@ -474,7 +999,7 @@ int main(int argc, char** argv) {
               "nal_length_bytes,bitrate_bps,first_slice_segment_in_pic_flag,"
               "slice_segment_address,slice_pic_order_cnt_lsb\n");
     }
-    // 4.3. dump the contents of each NALU
+    // 4.7. dump the contents of each NALU
     size_t total_bytes = 0;
     size_t nal_num = 0;
     size_t frame_num = 0;